@@ -244,6 +244,7 @@ static uint64_t g_number_ios;
 static uint64_t g_elapsed_time_in_usec;
 static int g_warmup_time_in_sec;
 static uint32_t g_max_completions;
+static uint32_t g_poll_group_budget;
 static uint32_t g_disable_sq_cmb;
 static bool g_enable_interrupt;
 static bool g_use_uring;
@@ -1039,6 +1040,7 @@ nvme_init_ns_worker_ctx(struct ns_worker_ctx *ns_ctx)
 	}
 
 	group = ns_ctx->u.nvme.group;
+	spdk_nvme_poll_group_set_completion_budget(group, g_poll_group_budget);
 	for (i = 0; i < ns_ctx->u.nvme.num_all_qpairs; i++) {
 		ns_ctx->u.nvme.qpair[i] = spdk_nvme_ctrlr_alloc_io_qpair(entry->u.nvme.ctrlr, &opts,
 					  sizeof(opts));
@@ -1922,6 +1924,8 @@ usage(char *program_name)
 	printf("\t-g, --mem-single-seg use single file descriptor for DPDK memory segments\n");
 	printf("\t-C, --max-completion-per-poll <val> max completions per poll\n");
 	printf("\t\t(default: 0 - unlimited)\n");
+	printf("\t--poll-group-budget <val> max completions per poll shared by all qpairs of a namespace\n");
+	printf("\t\t(default: 0 - unlimited, qpairs polled independently)\n");
 	printf("\t-i, --shmem-grp-id <id> shared memory group ID\n");
 	printf("\t-d, --number-ios <val> number of I/O to perform per thread on each namespace. Note: this is additional exit criteria.\n");
 	printf("\t\t(default: 0 - unlimited)\n");
@@ -2535,6 +2539,8 @@ static const struct option g_perf_cmdline_opts[] = {
 	{"use-every-core", no_argument, NULL, PERF_USE_EVERY_CORE},
 #define PERF_NO_HUGE		270
 	{"no-huge", no_argument, NULL, PERF_NO_HUGE},
+#define PERF_POLL_GROUP_BUDGET	271
+	{"poll-group-budget", required_argument, NULL, PERF_POLL_GROUP_BUDGET},
 	/* Should be the last element */
 	{0, 0, 0, 0}
 };
@@ -2562,6 +2568,7 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 		case PERF_NUM_UNUSED_IO_QPAIRS:
 		case PERF_CONTINUE_ON_ERROR:
 		case PERF_RDMA_SRQ_SIZE:
+		case PERF_POLL_GROUP_BUDGET:
 			val = spdk_strtol(optarg, 10);
 			if (val < 0) {
 				fprintf(stderr, "Converting a string to integer failed\n");
@@ -2600,6 +2607,9 @@ parse_args(int argc, char **argv, struct spdk_env_opts *env_opts)
 			case PERF_RDMA_SRQ_SIZE:
 				g_rdma_srq_size = val;
 				break;
+			case PERF_POLL_GROUP_BUDGET:
+				g_poll_group_budget = val;
+				break;
 			}
 			break;
 		case PERF_IO_SIZE:
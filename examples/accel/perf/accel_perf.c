@@ -12,6 +12,7 @@
 #include "spdk/string.h"
 #include "spdk/accel.h"
 #include "spdk/crc32.h"
+#include "spdk/crc_impl.h"
 #include "spdk/util.h"
 #include "spdk/xor.h"
 #include "spdk/dif.h"
@@ -42,6 +43,7 @@ static bool g_verify = false;
 static const char *g_workload_type = NULL;
 static enum spdk_accel_opcode g_workload_selection = SPDK_ACCEL_OPC_LAST;
 static const char *g_module_name = NULL;
+static enum spdk_crc_impl g_crc_impl = SPDK_CRC_IMPL_AUTO;
 static struct worker_thread *g_workers = NULL;
 static int g_num_workers = 0;
 static char *g_cd_file_in_name = NULL;
@@ -157,6 +159,7 @@ dump_user_config(void)
 	}
 	printf("Vector count    %u\n", g_chained_count);
 	printf("Module:         %s\n", module_name);
+	printf("CRC impl:       %s\n", spdk_crc_impl_get_name(spdk_crc_get_impl()));
 	if (g_workload_selection == SPDK_ACCEL_OPC_COMPRESS ||
 	    g_workload_selection == SPDK_ACCEL_OPC_DECOMPRESS) {
 		printf("File Name:      %s\n", g_cd_file_in_name);
@@ -187,6 +190,7 @@ usage(void)
 	printf("\t[-f for fill workload, use this BYTE value (default 255)\n");
 	printf("\t[-x for xor workload, use this number of source buffers (default, minimum: 2)]\n");
 	printf("\t[-y verify result if this switch is on]\n");
+	printf("\t[-k software CRC implementation: auto, base, clmul or vpclmul (default: auto)]\n");
 	printf("\t[-a tasks to allocate per core (default: same value as -q)]\n");
 	printf("\t\tCan be used to spread operations across a wider range of memory.\n");
 }
@@ -296,6 +300,25 @@ parse_args(int ch, char *arg)
 	case 'M':
 		g_module_name = optarg;
 		break;
+	case 'k':
+		if (!strcmp(optarg, "auto")) {
+			g_crc_impl = SPDK_CRC_IMPL_AUTO;
+		} else if (!strcmp(optarg, "base")) {
+			g_crc_impl = SPDK_CRC_IMPL_BASE;
+		} else if (!strcmp(optarg, "clmul")) {
+			g_crc_impl = SPDK_CRC_IMPL_CLMUL;
+		} else if (!strcmp(optarg, "vpclmul")) {
+			g_crc_impl = SPDK_CRC_IMPL_VPCLMUL;
+		} else {
+			fprintf(stderr, "Unsupported CRC implementation: %s\n", optarg);
+			usage();
+			return 1;
+		}
+		if (spdk_crc_set_impl(g_crc_impl) != 0) {
+			fprintf(stderr, "CRC implementation %s is not supported\n", optarg);
+			return 1;
+		}
+		break;
 
 	default:
 		usage();
@@ -1497,7 +1520,7 @@ main(int argc, char **argv)
 	g_opts.shutdown_cb = shutdown_cb;
 	g_opts.rpc_addr = NULL;
 
-	rc = spdk_app_parse_args(argc, argv, &g_opts, "a:C:o:q:t:yw:M:P:f:T:l:S:x:", NULL,
+	rc = spdk_app_parse_args(argc, argv, &g_opts, "a:C:o:q:t:yw:M:P:f:T:l:S:x:k:", NULL,
 				 parse_args, usage);
 	if (rc != SPDK_APP_PARSE_ARGS_SUCCESS) {
 		return rc == SPDK_APP_PARSE_ARGS_HELP ? 0 : 1;
@@ -1503,10 +1503,13 @@ bdevperf_job_run(void *ctx)
 							10 * SPDK_SEC_TO_USEC);
 	}
 
+	/* Hand the initial burst to the bdev module as a batch where supported. */
+	spdk_bdev_channel_plug(job->ch);
 	for (i = 0; i < job->queue_depth; i++) {
 		task = bdevperf_job_get_task(job);
 		bdevperf_submit_single(job, task);
 	}
+	spdk_bdev_channel_unplug(job->ch);
 }
 
 static void
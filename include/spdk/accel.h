@@ -56,7 +56,8 @@ enum spdk_accel_opcode {
 	SPDK_ACCEL_OPC_DIF_GENERATE_COPY	= 14,
 	SPDK_ACCEL_OPC_DIX_GENERATE		= 15,
 	SPDK_ACCEL_OPC_DIX_VERIFY		= 16,
-	SPDK_ACCEL_OPC_LAST			= 17,
+	SPDK_ACCEL_OPC_PQ_GEN			= 17,
+	SPDK_ACCEL_OPC_LAST			= 18,
 };
 
 enum spdk_accel_cipher {
@@ -385,6 +386,27 @@ int spdk_accel_get_compress_level_range(enum spdk_accel_comp_algo comp_algo,
 int spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uint32_t nsrcs,
 			  uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/**
+ * Submit a P+Q parity generation request.
+ *
+ * P is the xor of all the sources and Q is the Reed-Solomon syndrome over GF(2^8), as
+ * calculated by spdk_xor_gen_pq().
+ *
+ * \param ch I/O channel associated with this call.
+ * \param p Destination to write the P parity to.
+ * \param q Destination to write the Q parity to.
+ * \param sources Array of source buffers.
+ * \param nsrcs Number of source buffers in the array.
+ * \param nbytes Length in bytes.
+ * \param cb_fn Called when this operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_pq_gen(struct spdk_io_channel *ch, void *p, void *q, void **sources,
+			     uint32_t nsrcs, uint64_t nbytes, spdk_accel_completion_cb cb_fn,
+			     void *cb_arg);
+
 /**
  * Build and submit a data encryption request.
  *
@@ -193,7 +193,14 @@ struct spdk_bdev_io_stat {
 	 */
 	struct spdk_bdev_io_error_stat *io_error;
 
-	/* For efficient deep copy, no members should be added after io_error. */
+	/* Members after io_error are copied separately by the deep copy. */
+
+	/* I/Os merged by the coalescing stage and the merged I/Os they were submitted as */
+	uint64_t num_coalesced_ops;
+	uint64_t num_coalesce_merges;
+	/* Time I/Os were held back by the coalescing stage before submission */
+	uint64_t coalesce_latency_ticks;
+	uint64_t max_coalesce_latency_ticks;
 };
 
 struct spdk_bdev_opts {
@@ -615,6 +622,49 @@ int spdk_for_each_bdev_leaf(void *ctx, spdk_for_each_bdev_fn fn);
  */
 struct spdk_bdev *spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc);
 
+/**
+ * Fair-share QoS parameters of a bdev descriptor.
+ */
+struct spdk_bdev_desc_qos_opts {
+	/* Size of this structure in bytes. */
+	size_t size;
+
+	/* Relative share of the bdev fair-share capacity. 0 disables fair-share QoS. */
+	uint32_t weight;
+
+	uint32_t reserved;
+
+	/* I/Os per second guaranteed to the descriptor, 0 or a multiple of 1000. */
+	uint64_t min_ios_per_sec;
+
+	/* Upper limit of I/Os per second, 0 or a multiple of 1000. 0 means unlimited. */
+	uint64_t max_ios_per_sec;
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_desc_qos_opts) == 32, "Incorrect size");
+
+/**
+ * Configure fair-share QoS for the I/O submitted through a descriptor.
+ *
+ * Reads, writes and NVMe I/O passthru submitted through the descriptor consume
+ * tokens that are refilled every 1ms timeslice as described in
+ * spdk_bdev_set_fair_share_ios_per_sec(). I/O without a token is queued on its channel
+ * until the next refill. Tokens are taken by each channel directly, there is no
+ * dedicated QoS thread.
+ *
+ * \param desc Open block device descriptor.
+ * \param opts Fair-share parameters. A weight of 0 disables fair-share QoS on desc.
+ * \return 0 on success, -EINVAL if the parameters are invalid.
+ */
+int spdk_bdev_desc_set_qos(struct spdk_bdev_desc *desc, const struct spdk_bdev_desc_qos_opts *opts);
+
+/**
+ * Get the fair-share QoS parameters of a descriptor.
+ *
+ * \param desc Open block device descriptor.
+ * \param opts Output parameters. opts->size must be set by the caller.
+ */
+void spdk_bdev_desc_get_qos(struct spdk_bdev_desc *desc, struct spdk_bdev_desc_qos_opts *opts);
+
 /**
  * Get logical block size, specific to a bdev descriptor.
  *
@@ -836,6 +886,58 @@ void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 void spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				   void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
 
+/**
+ * Get the I/O coalescing settings of a bdev.
+ *
+ * \param bdev Block device to query.
+ * \param max_ios Output parameter for the maximum number of I/Os merged into one,
+ * 0 if coalescing is disabled.
+ * \param max_delay_us Output parameter for the maximum time an I/O is held back.
+ */
+void spdk_bdev_get_coalesce(struct spdk_bdev *bdev, uint32_t *max_ios, uint64_t *max_delay_us);
+
+/**
+ * Enable, update or disable I/O coalescing on a bdev.
+ *
+ * With coalescing enabled, reads and writes to contiguous blocks that are submitted on
+ * the same channel while other I/O is outstanding on it are held back for up to
+ * max_delay_us and submitted to the bdev module as a single I/O. The completion of the
+ * merged I/O completes each of the original I/Os.
+ *
+ * \param bdev Block device.
+ * \param max_ios Maximum number of I/Os merged into one, at most 32. 0 or 1 disables
+ * coalescing.
+ * \param max_delay_us Maximum time an I/O may be held back. Must be non-zero when
+ * coalescing is enabled.
+ * \param cb_fn Callback function to be called when all channels have been updated.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_set_coalesce(struct spdk_bdev *bdev, uint32_t max_ios, uint64_t max_delay_us,
+			    void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Get the fair-share capacity of a bdev.
+ *
+ * \param bdev Block device to query.
+ * \return I/Os per second shared between weighted descriptors, 0 if unset.
+ */
+uint64_t spdk_bdev_get_fair_share_ios_per_sec(struct spdk_bdev *bdev);
+
+/**
+ * Set the number of I/Os per second that are shared between descriptors with a weight
+ * configured by spdk_bdev_desc_set_qos().
+ *
+ * Every 1ms timeslice, each weighted descriptor first gets its reserved minimum. The rest
+ * of the capacity is split between the descriptors that submitted I/O during the previous
+ * timeslice, in proportion to their weights and up to their maximums. When the capacity
+ * is 0, only the per-descriptor maximums are enforced.
+ *
+ * \param bdev Block device.
+ * \param ios_per_sec Capacity in I/Os per second, 0 or a multiple of 1000.
+ * \return 0 on success, -EINVAL if ios_per_sec is not a multiple of 1000.
+ */
+int spdk_bdev_set_fair_share_ios_per_sec(struct spdk_bdev *bdev, uint64_t ios_per_sec);
+
 /**
  * Get minimum I/O buffer address alignment for a bdev.
  *
@@ -1079,6 +1181,30 @@ uint64_t spdk_bdev_get_weighted_io_time(const struct spdk_bdev *bdev);
  */
 struct spdk_io_channel *spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc);
 
+/**
+ * Plug the bdev I/O channel. While the channel is plugged, I/Os submitted on it
+ * may be held back and handed to the bdev module as a single batch once the
+ * channel is unplugged, allowing the module to amortize per-submission costs
+ * such as doorbell writes or system calls. Modules that do not support batched
+ * submission are unaffected.
+ *
+ * Plugging nests: the channel is unplugged only after a matching number of
+ * calls to spdk_bdev_channel_unplug(). Both functions must be called from the
+ * thread the channel was obtained on, and the channel must be unplugged before
+ * it is released.
+ *
+ * \param ch I/O channel obtained via spdk_bdev_get_io_channel().
+ */
+void spdk_bdev_channel_plug(struct spdk_io_channel *ch);
+
+/**
+ * Unplug the bdev I/O channel. When the outermost plug is released, all I/Os held
+ * back on the channel are submitted to the bdev module.
+ *
+ * \param ch I/O channel previously plugged with spdk_bdev_channel_plug().
+ */
+void spdk_bdev_channel_unplug(struct spdk_io_channel *ch);
+
 /**
  * Obtain a bdev module context for the block device opened by the specified
  * descriptor.
@@ -373,6 +373,18 @@ struct spdk_bdev_fn_table {
 
 	/** Check if bdev can handle spdk_accel_sequence to handle I/O of specific type. */
 	bool (*accel_sequence_supported)(void *ctx, enum spdk_bdev_io_type type);
+
+	/**
+	 * Process a vector of I/Os submitted while the bdev channel was plugged (see
+	 * \ref spdk_bdev_channel_plug). Optional - may be NULL, in which case each I/O is
+	 * passed to submit_request individually.
+	 *
+	 * The module takes ownership of all num_ios I/Os and must complete each of them,
+	 * exactly as if they had been submitted one by one via submit_request. This allows
+	 * the module to amortize doorbell writes or system calls across the whole vector.
+	 */
+	void (*submit_request_batch)(struct spdk_io_channel *ch, struct spdk_bdev_io **bdev_ios,
+				     uint32_t num_ios);
 };
 
 /** bdev I/O completion status */
@@ -769,6 +781,22 @@ struct spdk_bdev {
 		bool	histogram_in_progress;
 		uint8_t	histogram_io_type;
 
+		/** I/O coalescing settings, see spdk_bdev_set_coalesce() */
+		struct {
+			uint32_t	max_ios;
+			uint64_t	max_delay_us;
+			bool		in_progress;
+		} coalesce;
+
+		/** Fair-share QoS between descriptors, see spdk_bdev_set_fair_share_ios_per_sec() */
+		struct {
+			uint64_t	ios_per_sec;
+			/* Incremented on each timeslice refill */
+			uint64_t	epoch;
+			uint64_t	slice_start_tsc;
+			uint64_t	next_desc_id;
+		} fair_share;
+
 		/** Currently locked ranges for this bdev.  Used to populate new channels. */
 		lba_range_tailq_t locked_ranges;
 
@@ -315,8 +315,17 @@ struct spdk_bs_opts {
 	 * Context to pass with esnap_bs_dev_create.
 	 */
 	void *esnap_ctx;
+
+	/**
+	 * Maximum number of extent pages kept in memory for the open blobs whose extent pages
+	 * are loaded on demand. When not 0, the cluster map of a blob that uses an extent table
+	 * is not kept in memory as a whole once the blob is loaded. Its extent pages are read
+	 * when I/O needs them, and the least recently used ones are evicted. 0 keeps the whole
+	 * cluster map of every open blob in memory.
+	 */
+	uint32_t extent_page_cache_size;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 88, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 92, "Incorrect size");
 
 /**
  * Initialize a spdk_bs_opts structure to the default blobstore option values.
@@ -476,6 +485,64 @@ uint64_t spdk_bs_free_cluster_count(struct spdk_blob_store *bs);
  */
 uint64_t spdk_bs_total_data_cluster_count(struct spdk_blob_store *bs);
 
+/**
+ * Statistics of cluster deduplication of a blobstore, see spdk_bs_blob_dedup().
+ */
+struct spdk_bs_dedup_stats {
+	/** Number of allocated clusters compared with the data of the backing device. */
+	uint64_t clusters_scanned;
+
+	/** Number of clusters released because their data matched the backing device. */
+	uint64_t clusters_released;
+
+	/** Number of times I/O to a blob was frozen to release a cluster. */
+	uint64_t io_freeze_count;
+
+	/** Total time I/O to blobs was frozen, in microseconds. */
+	uint64_t io_freeze_total_us;
+
+	/** Longest time I/O to a blob was frozen, in microseconds. */
+	uint64_t io_freeze_max_us;
+};
+
+/**
+ * Get the statistics of cluster deduplication of the blobstore since it was loaded.
+ *
+ * \param bs blobstore to query.
+ * \param stats Filled with the statistics of cluster deduplication.
+ */
+void spdk_bs_get_dedup_stats(struct spdk_blob_store *bs, struct spdk_bs_dedup_stats *stats);
+
+/**
+ * Statistics of the extent pages loaded on demand by a blobstore, see
+ * spdk_bs_opts.extent_page_cache_size.
+ */
+struct spdk_bs_extent_page_cache_stats {
+	/** Number of I/O lookups of an extent page that found it in memory on the first attempt. */
+	uint64_t hits;
+
+	/** Number of extent pages read from disk because I/O needed them. */
+	uint64_t misses;
+
+	/** Number of extent pages evicted from memory. */
+	uint64_t evictions;
+
+	/** Number of extent pages in memory. */
+	uint32_t num_pages;
+
+	/** Maximum number of extent pages kept in memory. */
+	uint32_t max_pages;
+};
+
+/**
+ * Get the statistics of the extent pages loaded on demand by the blobstore since it was loaded.
+ *
+ * \param bs blobstore to query.
+ * \param stats Filled with the statistics of the extent pages loaded on demand.
+ */
+void spdk_bs_get_extent_page_cache_stats(struct spdk_blob_store *bs,
+		struct spdk_bs_extent_page_cache_stats *stats);
+
 /**
  * Get the blob id.
  *
@@ -589,8 +656,17 @@ struct spdk_blob_opts {
 	 * The size of data referenced by esnap_id, in bytes.
 	 */
 	uint64_t esnap_id_len;
+
+	/**
+	 * Granularity, in bytes, of the copy from the parent on the first write to a cluster of a
+	 * thin provisioned blob. Only the sub-clusters that the write touches are copied, the rest
+	 * are still read from the parent until they are written. Must divide the cluster size into
+	 * at most 64 sub-clusters and be a multiple of the io unit size. 0 or the cluster size copy
+	 * whole clusters. Snapshots and clones inherit it from the blob they are created from.
+	 */
+	uint32_t sub_cluster_sz;
 };
-SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 80, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 88, "Incorrect size");
 
 /**
  * Initialize a spdk_blob_opts structure to the default blob option values.
@@ -658,6 +734,24 @@ void spdk_bs_create_clone(struct spdk_blob_store *bs, spdk_blob_id blobid,
 			  const struct spdk_blob_xattr_opts *clone_xattrs,
 			  spdk_blob_op_with_id_complete cb_fn, void *cb_arg);
 
+/**
+ * Create a clone of specified read-only blob with the given sub-cluster size.
+ *
+ * Structure clone_xattrs as well as anything it references (like e.g. names
+ * array) must be valid until the completion is called.
+ *
+ * \param bs blobstore.
+ * \param blobid Id of the read only blob used as a snapshot for new clone.
+ * \param clone_xattrs xattrs specified for clone.
+ * \param sub_cluster_sz Sub-cluster size of the clone, see \c sub_cluster_sz in
+ * \struct spdk_blob_opts. 0 inherits the sub-cluster size of the snapshot.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_create_clone_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			      const struct spdk_blob_xattr_opts *clone_xattrs, uint32_t sub_cluster_sz,
+			      spdk_blob_op_with_id_complete cb_fn, void *cb_arg);
+
 /**
  * Provide table with blob id's of clones are dependent on specified snapshot.
  *
@@ -791,6 +885,27 @@ void spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *ch
 void spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
 				  spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Deduplicate clusters of a thin provisioned blob against its backing device.
+ *
+ * This call compares each allocated cluster of the blob with the data the blob
+ * would read from its parent snapshot, external snapshot or zeroes if the cluster
+ * was not allocated. Clusters holding the same data are released, so the data is
+ * shared with the parent again. I/O to the blob is frozen while a cluster is released.
+ * The data of released clusters is not unmapped from the device.
+ *
+ * Nothing is done for blobs that are not thin provisioned. Snapshots which have clones
+ * are not deduplicated and the operation fails with -EBUSY.
+ *
+ * \param bs blobstore.
+ * \param channel IO channel used to read the clusters.
+ * \param blobid The id of the blob.
+ * \param cb_fn Called when the operation is complete.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg);
+
 /**
  * Perform a shallow copy of a blob to a blobstore device.
  *
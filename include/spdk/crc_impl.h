@@ -0,0 +1,64 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+/**
+ * \file
+ * Selection of the CRC implementation used by the CRC utility functions
+ */
+
+#ifndef SPDK_CRC_IMPL_H
+#define SPDK_CRC_IMPL_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Implementations of spdk_crc16_t10dif(), spdk_crc32c_update() and spdk_crc64_nvme().
+ */
+enum spdk_crc_impl {
+	/** Best implementation available on this CPU. This is the default. */
+	SPDK_CRC_IMPL_AUTO,
+	/** ISA-L if SPDK is built with it, otherwise table-driven or CRC instructions. */
+	SPDK_CRC_IMPL_BASE,
+	/** Folding with 128-bit PCLMULQDQ, x86-64 only. */
+	SPDK_CRC_IMPL_CLMUL,
+	/** Folding with 512-bit VPCLMULQDQ and AVX-512, x86-64 only. */
+	SPDK_CRC_IMPL_VPCLMUL,
+};
+
+/**
+ * Select the CRC implementation for the whole process.
+ *
+ * This is meant for benchmarking and is not thread safe with respect to CRCs being
+ * computed concurrently.
+ *
+ * \param impl Implementation to use.
+ * \return 0 on success, -ENOTSUP if the implementation is not supported by this CPU or build.
+ */
+int spdk_crc_set_impl(enum spdk_crc_impl impl);
+
+/**
+ * Get the CRC implementation in use.
+ *
+ * \return Implementation in use, never SPDK_CRC_IMPL_AUTO.
+ */
+enum spdk_crc_impl spdk_crc_get_impl(void);
+
+/**
+ * Get the name of a CRC implementation.
+ *
+ * \param impl CRC implementation.
+ * \return Name of the implementation: "auto", "base", "clmul" or "vpclmul".
+ */
+const char *spdk_crc_impl_get_name(enum spdk_crc_impl impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPDK_CRC_IMPL_H */
@@ -197,6 +197,28 @@ int spdk_lvs_destroy(struct spdk_lvol_store *lvol_store,
 int spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 		     bool thin_provisioned, enum lvol_clear_method clear_method,
 		     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
+
+/**
+ * Create lvol on given lvolstore with specified size and sub-cluster size.
+ *
+ * \param lvs Handle to lvolstore.
+ * \param name Name of lvol.
+ * \param sz size of lvol in bytes.
+ * \param thin_provisioned Enables thin provisioning.
+ * \param clear_method Changes default data clusters clear method
+ * \param sub_cluster_sz Granularity, in bytes, of the copy from the parent on the first
+ * write to a cluster of a thin provisioned lvol, which its snapshots and clones inherit.
+ * See \c sub_cluster_sz in \struct spdk_blob_opts. 0 copies whole clusters.
+ * \param cb_fn Completion callback.
+ * \param cb_arg Completion callback custom arguments.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_lvol_create_ext(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
+			 bool thin_provisioned, enum lvol_clear_method clear_method,
+			 uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn,
+			 void *cb_arg);
+
 /**
  * Create snapshot of given lvol.
  *
@@ -219,6 +241,21 @@ void spdk_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_name
 void spdk_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 			    spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
 
+/**
+ * Create clone of given snapshot with specified sub-cluster size.
+ *
+ * \param lvol Handle to lvol snapshot.
+ * \param clone_name Name of created clone.
+ * \param sub_cluster_sz Granularity, in bytes, of the copy from the snapshot on the first
+ * write to a cluster of the clone. See \c sub_cluster_sz in \struct spdk_blob_opts.
+ * 0 inherits the sub-cluster size of the snapshot.
+ * \param cb_fn Completion callback.
+ * \param cb_arg Completion callback custom arguments.
+ */
+void spdk_lvol_create_clone_ext(struct spdk_lvol *lvol, const char *clone_name,
+				uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn,
+				void *cb_arg);
+
 /**
  * Create clone of given non-lvol device.
  *
@@ -386,6 +423,20 @@ void spdk_lvol_inflate(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void
  */
 void spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Deduplicate lvol against its parent
+ *
+ * Clusters allocated by the lvol that hold the same data as its parent snapshot
+ * or external snapshot (or zeroes, if it has none) are released, so that they
+ * are shared with the parent again. The lvol must be thin provisioned, otherwise
+ * this is a no-op. IO to the lvol is briefly paused each time a cluster is released.
+ *
+ * \param lvol Handle to lvol
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void spdk_lvol_dedup(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
+
 /**
  * Determine if an lvol is degraded. A degraded lvol cannot perform IO.
  *
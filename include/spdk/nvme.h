@@ -3108,6 +3108,24 @@ int spdk_nvme_poll_group_all_connected(struct spdk_nvme_poll_group *group);
  */
 void *spdk_nvme_poll_group_get_ctx(struct spdk_nvme_poll_group *group);
 
+/**
+ * Set the number of completions shared by all qpairs of a poll group within a single call to
+ * spdk_nvme_poll_group_process_completions().
+ *
+ * When a budget is set, qpairs with no pending completions are skipped without entering the
+ * generic completion path, the completion queue entry of the next qpair is prefetched while the
+ * current one is processed, and polling stops once the budget is consumed.  The following call
+ * resumes with the first qpair that was not polled, so that no qpair is starved.  The
+ * completions_per_qpair limit still applies to each qpair.
+ *
+ * The budget is currently honored by the PCIe transport only.
+ *
+ * \param group The poll group.
+ * \param budget Maximum number of completions per call, 0 to disable (default).
+ */
+void spdk_nvme_poll_group_set_completion_budget(struct spdk_nvme_poll_group *group,
+		uint32_t budget);
+
 /**
  * Retrieves transport statistics for the given poll group.
  *
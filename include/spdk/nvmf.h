@@ -172,6 +172,12 @@ struct spdk_nvmf_poll_group_stat {
 	uint64_t pending_bdev_io;
 	/* NVMe IO commands completed (excludes admin commands) */
 	uint64_t completed_nvme_io;
+	/* ticks spent in polls that found work to do */
+	uint64_t busy_tsc;
+	/* io qpairs migrated from another poll group to this one */
+	uint32_t migrated_in_qpairs;
+	/* io qpairs migrated from this poll group to another one */
+	uint32_t migrated_out_qpairs;
 };
 
 /**
@@ -288,6 +294,85 @@ struct spdk_nvmf_tgt *spdk_nvmf_get_next_tgt(struct spdk_nvmf_tgt *prev);
  */
 void spdk_nvmf_tgt_write_config_json(struct spdk_json_write_ctx *w, struct spdk_nvmf_tgt *tgt);
 
+/**
+ * Policies for the placement of qpairs on the poll groups of a target.
+ */
+enum spdk_nvmf_poll_group_policy {
+	/**
+	 * The transport picks the poll group of a new qpair, e.g. round robin or by the
+	 * placement id of its socket. Qpairs stay on their poll group.
+	 */
+	SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT = 0,
+
+	/**
+	 * New qpairs are placed on the poll group with the lowest measured load, i.e. busy
+	 * ticks and outstanding I/O. Established I/O qpairs are migrated away from a poll
+	 * group that stays busier than the others, if the transport supports it.
+	 */
+	SPDK_NVMF_POLL_GROUP_POLICY_LOAD,
+};
+
+struct spdk_nvmf_poll_group_policy_opts {
+	/**
+	 * The size of spdk_nvmf_poll_group_policy_opts according to the caller of this library is
+	 * used for ABI compatibility. The library uses this field to know how many fields in this
+	 * structure are valid. And the library will populate any remaining fields with default values.
+	 * New added fields should be put at the end of the struct.
+	 */
+	size_t opts_size;
+
+	enum spdk_nvmf_poll_group_policy policy;
+
+	/** Interval at which the load of the poll groups is sampled, in milliseconds. */
+	uint32_t balance_period_ms;
+
+	/**
+	 * Difference between the busy percentage of the busiest and the least busy poll group
+	 * above which a sampling period counts as imbalanced.
+	 */
+	uint32_t imbalance_threshold;
+
+	/**
+	 * Number of consecutive imbalanced periods after which an I/O qpair is migrated from
+	 * the busiest to the least busy poll group. 0 disables migration.
+	 */
+	uint32_t imbalance_periods;
+};
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_poll_group_policy_opts) == 24, "Incorrect size");
+
+/**
+ * Initialize poll group policy options with their defaults.
+ *
+ * \param opts Poll group policy options.
+ * \param opts_size Must be set to sizeof(struct spdk_nvmf_poll_group_policy_opts).
+ */
+void spdk_nvmf_poll_group_policy_opts_init(struct spdk_nvmf_poll_group_policy_opts *opts,
+		size_t opts_size);
+
+/**
+ * Set the policy used to place qpairs on the poll groups of the target.
+ *
+ * The load of the poll groups is sampled by a poller on the calling thread, so this
+ * should be called from the thread that manages the target.
+ *
+ * \param tgt The NVMe-oF target.
+ * \param opts Poll group policy options.
+ *
+ * \return 0 on success, -EINVAL if the options are invalid.
+ */
+int spdk_nvmf_tgt_set_poll_group_policy(struct spdk_nvmf_tgt *tgt,
+					const struct spdk_nvmf_poll_group_policy_opts *opts);
+
+/**
+ * Get the policy used to place qpairs on the poll groups of the target.
+ *
+ * \param tgt The NVMe-oF target.
+ * \param opts Filled with the poll group policy options.
+ * \param opts_size Must be set to sizeof(struct spdk_nvmf_poll_group_policy_opts).
+ */
+void spdk_nvmf_tgt_get_poll_group_policy(struct spdk_nvmf_tgt *tgt,
+		struct spdk_nvmf_poll_group_policy_opts *opts, size_t opts_size);
+
 /**
  * Begin accepting new connections at the address provided.
  *
@@ -1065,8 +1150,24 @@ struct spdk_nvmf_ns_opts {
 	 * Enable hide_metadata option to the bdev.
 	 */
 	bool hide_metadata;
+
+	/**
+	 * Weight of the namespace in the fair-share QoS of the bdev, 0 to disable.
+	 * See spdk_bdev_desc_set_qos().
+	 */
+	uint32_t qos_weight;
+
+	/**
+	 * I/Os per second reserved for the namespace when qos_weight is set.
+	 */
+	uint64_t qos_min_ios_per_sec;
+
+	/**
+	 * Upper limit of I/Os per second when qos_weight is set, 0 for unlimited.
+	 */
+	uint64_t qos_max_ios_per_sec;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ns_opts) == 73, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ns_opts) == 93, "Incorrect size");
 
 /**
  * Get default namespace creation options.
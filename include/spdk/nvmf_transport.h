@@ -174,6 +174,10 @@ struct spdk_nvmf_qpair {
 	/* Number of IO outstanding at transport level */
 	uint16_t				queue_depth;
 
+	/* NVMe IO commands completed in the current and in the last load sampling period */
+	uint32_t				period_nvme_io;
+	uint32_t				last_period_nvme_io;
+
 	struct spdk_nvmf_qpair_auth		*auth;
 
 	struct {
@@ -217,9 +221,30 @@ struct spdk_nvmf_poll_group {
 	/* All of the queue pairs that belong to this poll group */
 	TAILQ_HEAD(, spdk_nvmf_qpair)			qpairs;
 
+	/* Set while the poll group poller runs; namespace bdev channels used during
+	 * a poll are plugged and listed in plugged_ns until the poll ends. */
+	bool						in_poll;
+	TAILQ_HEAD(, spdk_nvmf_subsystem_pg_ns_info)	plugged_ns;
+
 	/* Statistics */
 	struct spdk_nvmf_poll_group_stat		stat;
 
+	/* Load sampled at the end of the last period of the target's poll group policy */
+	struct {
+		uint64_t				last_tsc;
+		uint64_t				last_busy_tsc;
+		/* Percentage of the period spent in busy polls */
+		uint32_t				busy_pct;
+		/* IO outstanding at transport level */
+		uint32_t				outstanding;
+		/* NVMe IO commands completed during the period */
+		uint64_t				nvme_io;
+	} load;
+
+	/* IO qpair to be migrated to migrate_dst once it has no work in progress */
+	struct spdk_nvmf_qpair				*migrate_qpair;
+	struct spdk_nvmf_poll_group			*migrate_dst;
+
 	spdk_nvmf_poll_group_destroy_done_fn		destroy_cb_fn;
 	void						*destroy_cb_arg;
 
@@ -493,6 +518,21 @@ struct spdk_nvmf_transport_ops {
 	void (*subsystem_dump_host)(struct spdk_nvmf_transport *transport,
 				    const struct spdk_nvmf_subsystem *subsystem,
 				    const char *hostnqn, struct spdk_json_write_ctx *w);
+
+	/*
+	 * Detach a qpair from its poll group, so that it can be attached to another poll group
+	 * of the transport by poll_group_migrate_in. Returns -EBUSY if the qpair has work in
+	 * progress, in which case it stays in the poll group and the migration is retried later.
+	 * This callback is optional, qpairs are only migrated by transports implementing both.
+	 */
+	int (*poll_group_migrate_out)(struct spdk_nvmf_transport_poll_group *group,
+				      struct spdk_nvmf_qpair *qpair);
+
+	/*
+	 * Attach a qpair detached by poll_group_migrate_out to a poll group, on its thread.
+	 */
+	int (*poll_group_migrate_in)(struct spdk_nvmf_transport_poll_group *group,
+				     struct spdk_nvmf_qpair *qpair);
 };
 
 /**
@@ -628,6 +628,31 @@ int spdk_sock_group_close(struct spdk_sock_group **group);
 int spdk_sock_get_optimal_sock_group(struct spdk_sock *sock, struct spdk_sock_group **group,
 				     struct spdk_sock_group *hint);
 
+/**
+ * Send statistics of a socket group.
+ */
+struct spdk_sock_group_stats {
+	/** Number of bytes sent without copying the data into the kernel. */
+	uint64_t send_zcopy_bytes;
+
+	/** Number of bytes sent by copying the data into the kernel. */
+	uint64_t send_copy_bytes;
+
+	/** Number of zero-copy send notifications received from the kernel. */
+	uint64_t send_zcopy_notifications;
+};
+
+/**
+ * Get the send statistics of a socket group.
+ *
+ * The statistics are summed over all socket implementations used by the group.
+ * Implementations that do not keep statistics do not contribute to them.
+ *
+ * \param group Socket group.
+ * \param stats Structure filled with the statistics.
+ */
+void spdk_sock_group_get_stats(struct spdk_sock_group *group, struct spdk_sock_group_stats *stats);
+
 /**
  * Get current socket implementation options.
  *
@@ -1292,6 +1292,20 @@ typedef void (*spdk_iobuf_get_stats_cb)(struct spdk_iobuf_module_stats *modules,
  */
 int spdk_iobuf_get_stats(spdk_iobuf_get_stats_cb cb_fn, void *cb_arg);
 
+/**
+ * Get the memory regions backing the iobuf pools.
+ *
+ * Every buffer returned by `spdk_iobuf_get()` lies within one of these regions, so they can be
+ * registered once with a device or a kernel interface instead of on each I/O.  The regions are
+ * valid between `spdk_iobuf_initialize()` and `spdk_iobuf_finish()`.
+ *
+ * \param regions Array filled with the regions.  May be NULL if count is 0.
+ * \param count Number of entries in the regions array.
+ *
+ * \return Total number of regions.  Only the first count of them are written to regions.
+ */
+uint32_t spdk_iobuf_get_regions(struct iovec *regions, uint32_t count);
+
 #ifdef __cplusplus
 }
 #endif
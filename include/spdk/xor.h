@@ -28,6 +28,21 @@ extern "C" {
  */
 int spdk_xor_gen(void *dest, void **sources, uint32_t n, uint32_t len);
 
+/**
+ * Generate P (XOR) and Q (Reed-Solomon) parity from multiple source buffers.
+ *
+ * Q is calculated over GF(2^8) with the 0x11d polynomial and generator 2, i.e.
+ * Q = sum(2^i * sources[i]), which is the same syndrome as used by Linux md RAID-6.
+ *
+ * \param p Destination buffer for P parity.
+ * \param q Destination buffer for Q parity.
+ * \param sources Array of source buffers.
+ * \param n Number of source buffers in the array.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_xor_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len);
+
 /**
  * Get the optimal buffer alignment for XOR functions.
  *
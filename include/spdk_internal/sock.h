@@ -114,6 +114,8 @@ struct spdk_net_impl {
 					     spdk_interrupt_fn fn, void *arg, const char *name);
 	void (*group_impl_unregister_interrupt)(struct spdk_sock_group_impl *group);
 	int (*group_impl_close)(struct spdk_sock_group_impl *group);
+	void (*group_impl_get_stats)(struct spdk_sock_group_impl *group,
+				     struct spdk_sock_group_stats *stats);
 
 	int (*get_opts)(struct spdk_sock_impl_opts *opts, size_t *len);
 	int (*set_opts)(const struct spdk_sock_impl_opts *opts, size_t len);
@@ -80,7 +80,7 @@ static const char *g_opcode_strings[SPDK_ACCEL_OPC_LAST] = {
 	"copy", "fill", "dualcast", "compare", "crc32c", "copy_crc32c",
 	"compress", "decompress", "encrypt", "decrypt", "xor",
 	"dif_verify", "dif_verify_copy", "dif_generate", "dif_generate_copy",
-	"dix_generate", "dix_verify"
+	"dix_generate", "dix_verify", "pq_gen"
 };
 
 enum accel_sequence_state {
@@ -881,6 +881,38 @@ spdk_accel_submit_xor(struct spdk_io_channel *ch, void *dst, void **sources, uin
 	return accel_submit_task(accel_ch, accel_task);
 }
 
+int
+spdk_accel_submit_pq_gen(struct spdk_io_channel *ch, void *p, void *q, void **sources,
+			 uint32_t nsrcs, uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (spdk_unlikely(accel_task == NULL)) {
+		return -ENOMEM;
+	}
+
+	ACCEL_TASK_ALLOC_AUX_BUF(accel_task);
+
+	accel_task->d.iovs = &accel_task->aux->iovs[SPDK_ACCEL_AUX_IOV_DST];
+	accel_task->d2.iovs = &accel_task->aux->iovs[SPDK_ACCEL_AUX_IOV_DST2];
+	accel_task->nsrcs.srcs = sources;
+	accel_task->nsrcs.cnt = nsrcs;
+	accel_task->d.iovs[0].iov_base = p;
+	accel_task->d.iovs[0].iov_len = nbytes;
+	accel_task->d.iovcnt = 1;
+	accel_task->d2.iovs[0].iov_base = q;
+	accel_task->d2.iovs[0].iov_len = nbytes;
+	accel_task->d2.iovcnt = 1;
+	accel_task->nbytes = nbytes;
+	accel_task->op_code = SPDK_ACCEL_OPC_PQ_GEN;
+	accel_task->src_domain = NULL;
+	accel_task->dst_domain = NULL;
+
+	return accel_submit_task(accel_ch, accel_task);
+}
+
 int
 spdk_accel_submit_dif_verify(struct spdk_io_channel *ch,
 			     struct iovec *iovs, size_t iovcnt, uint32_t num_blocks,
@@ -113,6 +113,7 @@ sw_accel_supports_opcode(enum spdk_accel_opcode opc)
 	case SPDK_ACCEL_OPC_DIF_VERIFY_COPY:
 	case SPDK_ACCEL_OPC_DIX_GENERATE:
 	case SPDK_ACCEL_OPC_DIX_VERIFY:
+	case SPDK_ACCEL_OPC_PQ_GEN:
 		return true;
 	default:
 		return false;
@@ -615,6 +616,16 @@ _sw_accel_xor(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_t
 			    accel_task->d.iovs[0].iov_len);
 }
 
+static int
+_sw_accel_pq_gen(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	return spdk_xor_gen_pq(accel_task->d.iovs[0].iov_base,
+			       accel_task->d2.iovs[0].iov_base,
+			       accel_task->nsrcs.srcs,
+			       accel_task->nsrcs.cnt,
+			       accel_task->d.iovs[0].iov_len);
+}
+
 static int
 _sw_accel_dif_verify(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
 {
@@ -776,6 +787,9 @@ sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_
 		case SPDK_ACCEL_OPC_DIX_VERIFY:
 			rc = _sw_accel_dix_verify(sw_ch, accel_task);
 			break;
+		case SPDK_ACCEL_OPC_PQ_GEN:
+			rc = _sw_accel_pq_gen(sw_ch, accel_task);
+			break;
 		default:
 			assert(false);
 			break;
@@ -37,6 +37,8 @@ int __itt_init_ittlib(const char *, __itt_group_id);
 
 #define SPDK_BDEV_IO_POOL_SIZE			(64 * 1024 - 1)
 #define SPDK_BDEV_IO_CACHE_SIZE			256
+/* Max number of bdev_ios moved between a thread's cache and the global pool at once */
+#define BDEV_IO_CACHE_BATCH_SIZE		32
 #define SPDK_BDEV_AUTO_EXAMINE			true
 #define BUF_SMALL_CACHE_SIZE			128
 #define BUF_LARGE_CACHE_SIZE			16
@@ -219,6 +221,25 @@ struct spdk_bdev_mgmt_channel {
 	uint32_t	per_thread_cache_count;
 	uint32_t	bdev_io_cache_size;
 
+	/*
+	 * Number of bdev_ios taken from the global pool when the cache is empty, or
+	 * returned to it when the cache is full. Moving them in batches keeps the
+	 * cache from bouncing between empty and full on every I/O when a thread
+	 * allocates and frees in bursts.
+	 */
+	uint32_t	bdev_io_cache_batch_size;
+
+	struct {
+		/* Number of bdev_ios allocated from the cache */
+		uint64_t	hits;
+		/* Number of bdev_ios allocated when the cache was empty */
+		uint64_t	misses;
+		/* Number of batches taken from the global pool */
+		uint64_t	refills;
+		/* Number of batches returned to the global pool */
+		uint64_t	returns;
+	} bdev_io_cache_stat;
+
 	struct spdk_iobuf_channel iobuf;
 
 	TAILQ_HEAD(, spdk_bdev_shared_resource)	shared_resources;
@@ -265,6 +286,65 @@ struct spdk_bdev_shared_resource {
 #define BDEV_CH_RESET_IN_PROGRESS	(1 << 0)
 #define BDEV_CH_QOS_ENABLED		(1 << 1)
 
+/* Maximum number of I/Os held back on a plugged channel before they are flushed to the module */
+#define BDEV_CH_PLUG_MAX_IO		32
+
+/* Maximum number of merged I/Os in flight per channel when coalescing is enabled */
+#define BDEV_COALESCE_NUM_GROUPS	16
+
+struct bdev_coalesce_channel;
+
+/* A run of contiguous I/Os submitted to the module as a single merged I/O */
+struct bdev_coalesce_group {
+	struct bdev_coalesce_channel	*coalesce_ch;
+	bdev_io_tailq_t			ios;
+	uint32_t			num_ios;
+	uint8_t				type;
+	struct spdk_bdev_desc		*desc;
+	uint32_t			dif_check_flags;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	int				iovcnt;
+	uint64_t			start_tsc;
+	struct iovec			iovs[SPDK_BDEV_IO_NUM_CHILD_IOV];
+	STAILQ_ENTRY(bdev_coalesce_group) link;
+};
+
+struct bdev_coalesce_channel {
+	struct spdk_bdev_channel	*bdev_ch;
+	uint32_t			max_ios;
+	uint64_t			max_delay_ticks;
+
+	/* Group currently accepting I/O, NULL if none */
+	struct bdev_coalesce_group	*pending;
+	struct spdk_poller		*poller;
+
+	/* Number of merged I/Os submitted and not yet completed */
+	uint32_t			num_inflight;
+	/* Set once the channel no longer coalesces; freed when num_inflight drops to 0 */
+	bool				detached;
+
+	STAILQ_HEAD(, bdev_coalesce_group) free_groups;
+	struct bdev_coalesce_group	groups[BDEV_COALESCE_NUM_GROUPS];
+};
+
+/* Fair-share tokens are refilled every timeslice and taken by channels in small batches */
+#define BDEV_FAIR_SHARE_SLICE_US	1000
+#define BDEV_FAIR_SHARE_TOKEN_BATCH	4
+/* Per-channel descriptor entries unused for this many timeslices are freed */
+#define BDEV_FAIR_SHARE_IDLE_SLICES	1000
+
+/* Per-channel fair-share state of a descriptor */
+struct bdev_desc_qos_channel {
+	struct spdk_bdev_desc		*desc;
+	uint64_t			desc_id;
+	/* Tokens taken from the descriptor during epoch and not used yet */
+	int64_t				tokens;
+	uint64_t			epoch;
+	bdev_io_tailq_t			queued_io;
+	TAILQ_ENTRY(bdev_desc_qos_channel) link;
+};
+
 struct spdk_bdev_channel {
 	struct spdk_bdev	*bdev;
 
@@ -322,6 +402,21 @@ struct spdk_bdev_channel {
 
 	/** List of I/Os queued by QoS. */
 	bdev_io_tailq_t		qos_queued_io;
+
+	/* Nesting depth of spdk_bdev_channel_plug() calls */
+	uint32_t		plug_depth;
+
+	/* I/Os held back while the channel is plugged, submitted via submit_request_batch */
+	uint32_t		plugged_io_count;
+	struct spdk_bdev_io	*plugged_io[BDEV_CH_PLUG_MAX_IO];
+
+	/* I/O coalescing state, NULL if coalescing is disabled */
+	struct bdev_coalesce_channel *coalesce;
+
+	/* Fair-share state of the descriptors that submitted I/O on this channel */
+	TAILQ_HEAD(, bdev_desc_qos_channel) desc_qos;
+	/* Retries I/O queued for lack of fair-share tokens */
+	struct spdk_poller	*desc_qos_poller;
 };
 
 struct media_event_entry {
@@ -355,6 +450,20 @@ struct spdk_bdev_desc {
 	void			*cb_arg;
 	struct spdk_poller	*io_timeout_poller;
 	struct spdk_bdev_module_claim	*claim;
+
+	/* Fair-share QoS, see spdk_bdev_desc_set_qos() */
+	struct {
+		struct spdk_bdev_desc_qos_opts	opts;
+		bool				enabled;
+		/* Unique among the descriptors of the bdev, assigned when QoS is first configured */
+		uint64_t			id;
+		/* Tokens left for the current timeslice, taken atomically by channels */
+		int64_t				tokens;
+		/* Last fair-share epoch in which I/O was submitted through the descriptor */
+		uint64_t			active_epoch;
+		/* Share computed for the next timeslice, protected by the bdev spinlock */
+		int64_t				share;
+	} qos;
 };
 
 struct spdk_bdev_iostat_ctx {
@@ -432,7 +541,10 @@ static int bdev_unlock_lba_range(struct spdk_bdev_desc *desc, struct spdk_io_cha
 				 lock_range_cb cb_fn, void *cb_arg);
 
 static bool bdev_abort_queued_io(bdev_io_tailq_t *queue, struct spdk_bdev_io *bio_to_abort);
+static void bdev_abort_all_queued_io(bdev_io_tailq_t *queue, struct spdk_bdev_channel *ch);
 static bool bdev_abort_buf_io(struct spdk_bdev_mgmt_channel *ch, struct spdk_bdev_io *bio_to_abort);
+static bool bdev_coalesce_abort_io(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bio_to_abort);
+static bool bdev_desc_qos_abort_io(struct spdk_bdev_channel *ch, struct spdk_bdev_io *bio_to_abort);
 
 static bool claim_type_is_v2(enum spdk_bdev_claim_type type);
 static void bdev_desc_release_claims(struct spdk_bdev_desc *desc);
@@ -1584,8 +1696,7 @@ spdk_bdev_io_put_aux_buf(struct spdk_bdev_io *bdev_io, void *buf)
 }
 
 static inline void
-bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
-		    struct spdk_bdev_io *bdev_io)
+bdev_io_release_accel_sequence(struct spdk_bdev_io *bdev_io)
 {
 	/* After a request is submitted to a bdev module, the ownership of an accel sequence
 	 * associated with that bdev_io is transferred to the bdev module. So, clear the internal
@@ -1595,10 +1706,45 @@ bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
 		assert(!bdev_io_needs_sequence_exec(bdev_io->internal.desc, bdev_io));
 		bdev_io->internal.f.has_accel_sequence = false;
 	}
+}
 
+static inline void
+bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
+		    struct spdk_bdev_io *bdev_io)
+{
+	bdev_io_release_accel_sequence(bdev_io);
 	bdev->fn_table->submit_request(ioch, bdev_io);
 }
 
+static void
+bdev_channel_flush_plugged_io(struct spdk_bdev_channel *bdev_ch)
+{
+	struct spdk_bdev *bdev = bdev_ch->bdev;
+	struct spdk_bdev_io *bdev_ios[BDEV_CH_PLUG_MAX_IO];
+	uint32_t i, num_ios;
+
+	num_ios = bdev_ch->plugged_io_count;
+	if (num_ios == 0) {
+		return;
+	}
+
+	/* The module may complete I/Os inline and their callbacks may submit new I/O on this
+	 * channel, so take the I/Os off the channel before handing them over. */
+	memcpy(bdev_ios, bdev_ch->plugged_io, num_ios * sizeof(bdev_ios[0]));
+	bdev_ch->plugged_io_count = 0;
+
+	for (i = 0; i < num_ios; i++) {
+		bdev_io_release_accel_sequence(bdev_ios[i]);
+		bdev_ios[i]->internal.f.in_submit_request = true;
+	}
+
+	bdev->fn_table->submit_request_batch(bdev_ch->channel, bdev_ios, num_ios);
+
+	for (i = 0; i < num_ios; i++) {
+		bdev_ios[i]->internal.f.in_submit_request = false;
+	}
+}
+
 static inline void
 bdev_ch_resubmit_io(struct spdk_bdev_shared_resource *shared_resource, struct spdk_bdev_io *bdev_io)
 {
@@ -2042,6 +2188,43 @@ bdev_module_get_max_ctx_size(void)
 	return max_bdev_module_size;
 }
 
+static void
+bdev_coalesce_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	if (bdev->internal.coalesce.max_ios == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_set_coalesce");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", bdev->name);
+	spdk_json_write_named_uint32(w, "max_ios", bdev->internal.coalesce.max_ios);
+	spdk_json_write_named_uint64(w, "max_delay_us", bdev->internal.coalesce.max_delay_us);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
+static void
+bdev_fair_share_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	if (bdev->internal.fair_share.ios_per_sec == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_set_fair_share");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", bdev->name);
+	spdk_json_write_named_uint64(w, "ios_per_sec", bdev->internal.fair_share.ios_per_sec);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 static void
 bdev_enable_histogram_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
@@ -2133,6 +2316,8 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 
 		bdev_qos_config_json(bdev, w);
 		bdev_enable_histogram_config_json(bdev, w);
+		bdev_coalesce_config_json(bdev, w);
+		bdev_fair_share_config_json(bdev, w);
 	}
 
 	spdk_spin_unlock(&g_bdev_mgr.spinlock);
@@ -2181,6 +2366,12 @@ bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 
 	STAILQ_INIT(&ch->per_thread_cache);
 	ch->bdev_io_cache_size = g_bdev_opts.bdev_io_cache_size;
+	ch->bdev_io_cache_batch_size = spdk_min(BDEV_IO_CACHE_BATCH_SIZE,
+					       spdk_max(ch->bdev_io_cache_size / 2, 1));
+	if (ch->bdev_io_cache_size == 0) {
+		ch->bdev_io_cache_batch_size = 0;
+	}
+	memset(&ch->bdev_io_cache_stat, 0, sizeof(ch->bdev_io_cache_stat));
 
 	/* Pre-populate bdev_io cache to ensure this thread cannot be starved. */
 	ch->per_thread_cache_count = 0;
@@ -2626,6 +2817,51 @@ spdk_bdev_finish(spdk_bdev_fini_cb cb_fn, void *cb_arg)
 	}
 }
 
+static struct spdk_bdev_io *
+bdev_io_cache_refill(struct spdk_bdev_mgmt_channel *ch)
+{
+	void *bdev_ios[BDEV_IO_CACHE_BATCH_SIZE];
+	struct spdk_bdev_io *bdev_io;
+	uint32_t i, count = ch->bdev_io_cache_batch_size;
+
+	assert(ch->per_thread_cache_count == 0);
+
+	if (count <= 1 || spdk_mempool_get_bulk(g_bdev_mgr.bdev_io_pool, bdev_ios, count) != 0) {
+		/* Not enough bdev_ios left for a whole batch, try to get a single one */
+		return spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+	}
+
+	ch->bdev_io_cache_stat.refills++;
+
+	for (i = 1; i < count; i++) {
+		bdev_io = bdev_ios[i];
+		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
+	}
+	ch->per_thread_cache_count = count - 1;
+
+	return bdev_ios[0];
+}
+
+static void
+bdev_io_cache_return(struct spdk_bdev_mgmt_channel *ch)
+{
+	void *bdev_ios[BDEV_IO_CACHE_BATCH_SIZE];
+	struct spdk_bdev_io *bdev_io;
+	uint32_t i, count = ch->bdev_io_cache_batch_size;
+
+	assert(count <= ch->per_thread_cache_count);
+
+	for (i = 0; i < count; i++) {
+		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
+		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
+		bdev_ios[i] = bdev_io;
+	}
+	ch->per_thread_cache_count -= count;
+
+	spdk_mempool_put_bulk(g_bdev_mgr.bdev_io_pool, bdev_ios, count);
+	ch->bdev_io_cache_stat.returns++;
+}
+
 struct spdk_bdev_io *
 bdev_channel_get_io(struct spdk_bdev_channel *channel)
 {
@@ -2636,6 +2872,7 @@ bdev_channel_get_io(struct spdk_bdev_channel *channel)
 		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
 		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
 		ch->per_thread_cache_count--;
+		ch->bdev_io_cache_stat.hits++;
 	} else if (spdk_unlikely(!TAILQ_EMPTY(&ch->io_wait_queue))) {
 		/*
 		 * Don't try to look for bdev_ios in the global pool if there are
@@ -2643,7 +2880,8 @@ bdev_channel_get_io(struct spdk_bdev_channel *channel)
 		 */
 		bdev_io = NULL;
 	} else {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		ch->bdev_io_cache_stat.misses++;
+		bdev_io = bdev_io_cache_refill(ch);
 	}
 
 	return bdev_io;
@@ -2663,6 +2901,12 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 		bdev_io_put_buf(bdev_io);
 	}
 
+	if (spdk_unlikely(ch->per_thread_cache_count >= ch->bdev_io_cache_size &&
+			  ch->bdev_io_cache_batch_size > 0)) {
+		assert(TAILQ_EMPTY(&ch->io_wait_queue));
+		bdev_io_cache_return(ch);
+	}
+
 	if (ch->per_thread_cache_count < ch->bdev_io_cache_size) {
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
@@ -2680,6 +2924,23 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 	}
 }
 
+void
+bdev_dump_io_cache_stat_json(struct spdk_io_channel *_ch, struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_channel *channel = __io_ch_to_bdev_ch(_ch);
+	struct spdk_bdev_mgmt_channel *ch = channel->shared_resource->mgmt_ch;
+
+	spdk_json_write_named_object_begin(w, "bdev_io_cache");
+	spdk_json_write_named_uint32(w, "size", ch->bdev_io_cache_size);
+	spdk_json_write_named_uint32(w, "count", ch->per_thread_cache_count);
+	spdk_json_write_named_uint32(w, "batch_size", ch->bdev_io_cache_batch_size);
+	spdk_json_write_named_uint64(w, "hits", ch->bdev_io_cache_stat.hits);
+	spdk_json_write_named_uint64(w, "misses", ch->bdev_io_cache_stat.misses);
+	spdk_json_write_named_uint64(w, "refills", ch->bdev_io_cache_stat.refills);
+	spdk_json_write_named_uint64(w, "returns", ch->bdev_io_cache_stat.returns);
+	spdk_json_write_object_end(w);
+}
+
 static bool
 bdev_qos_is_iops_rate_limit(enum spdk_bdev_qos_rate_limit_type limit)
 {
@@ -2922,7 +3183,9 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 		struct spdk_bdev_io *bio_to_abort = bdev_io->u.abort.bio_to_abort;
 
 		if (bdev_abort_queued_io(&shared_resource->nomem_io, bio_to_abort) ||
-		    bdev_abort_buf_io(mgmt_channel, bio_to_abort)) {
+		    bdev_abort_buf_io(mgmt_channel, bio_to_abort) ||
+		    bdev_coalesce_abort_io(bdev_ch, bio_to_abort) ||
+		    bdev_desc_qos_abort_io(bdev_ch, bio_to_abort)) {
 			_bdev_io_complete_in_submit(bdev_ch, bdev_io,
 						    SPDK_BDEV_IO_STATUS_SUCCESS);
 			return;
@@ -2940,6 +3203,13 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 
 	if (spdk_likely(TAILQ_EMPTY(&shared_resource->nomem_io))) {
 		bdev_io_increment_outstanding(bdev_ch, shared_resource);
+		if (bdev_ch->plug_depth > 0 && bdev->fn_table->submit_request_batch != NULL) {
+			bdev_ch->plugged_io[bdev_ch->plugged_io_count++] = bdev_io;
+			if (bdev_ch->plugged_io_count == BDEV_CH_PLUG_MAX_IO) {
+				bdev_channel_flush_plugged_io(bdev_ch);
+			}
+			return;
+		}
 		bdev_io->internal.f.in_submit_request = true;
 		bdev_submit_request(bdev, ch, bdev_io);
 		bdev_io->internal.f.in_submit_request = false;
@@ -3521,141 +3791,811 @@ bdev_io_complete_parent_sequence_cb(void *ctx, int status)
 {
 	struct spdk_bdev_io *bdev_io = ctx;
 
-	/* u.bdev.accel_sequence should have already been cleared at this point */
-	assert(bdev_io->u.bdev.accel_sequence == NULL);
-	assert(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
-	bdev_io->internal.f.has_accel_sequence = false;
+	/* u.bdev.accel_sequence should have already been cleared at this point */
+	assert(bdev_io->u.bdev.accel_sequence == NULL);
+	assert(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	bdev_io->internal.f.has_accel_sequence = false;
+
+	if (spdk_unlikely(status != 0)) {
+		SPDK_ERRLOG("Failed to execute accel sequence, status=%d\n", status);
+	}
+
+	parent_bdev_io_complete(bdev_io, status);
+}
+
+static void
+bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *parent_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	assert(parent_io->internal.f.split);
+
+	if (!success) {
+		parent_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
+		/* If any child I/O failed, stop further splitting process. */
+		parent_io->internal.split.current_offset_blocks += parent_io->internal.split.remaining_num_blocks;
+		parent_io->internal.split.remaining_num_blocks = 0;
+	}
+	parent_io->internal.split.outstanding--;
+	if (parent_io->internal.split.outstanding != 0) {
+		return;
+	}
+
+	/*
+	 * Parent I/O finishes when all blocks are consumed.
+	 */
+	if (parent_io->internal.split.remaining_num_blocks == 0) {
+		assert(parent_io->internal.cb != bdev_io_split_done);
+		bdev_ch_remove_from_io_submitted(parent_io);
+		spdk_trace_record(TRACE_BDEV_IO_DONE, parent_io->internal.ch->trace_id,
+				  0, (uintptr_t)parent_io, bdev_io->internal.caller_ctx,
+				  parent_io->internal.ch->queue_depth);
+
+		if (spdk_likely(parent_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS)) {
+			if (bdev_io_needs_sequence_exec(parent_io->internal.desc, parent_io)) {
+				bdev_io_exec_sequence(parent_io, bdev_io_complete_parent_sequence_cb);
+				return;
+			} else if (parent_io->internal.f.has_bounce_buf &&
+				   !bdev_io_use_accel_sequence(bdev_io)) {
+				/* bdev IO will be completed in the callback */
+				_bdev_io_push_bounce_data_buffer(parent_io, parent_bdev_io_complete);
+				return;
+			}
+		}
+
+		parent_bdev_io_complete(parent_io, 0);
+		return;
+	}
+
+	/*
+	 * Continue with the splitting process.  This function will complete the parent I/O if the
+	 * splitting is done.
+	 */
+	switch (parent_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		_bdev_rw_split(parent_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		bdev_unmap_split(parent_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		bdev_write_zeroes_split(parent_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		bdev_copy_split(parent_io);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+static void bdev_rw_split_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
+				     bool success);
+
+static void
+bdev_io_split(struct spdk_bdev_io *bdev_io)
+{
+	assert(bdev_io_should_split(bdev_io));
+	assert(bdev_io->internal.f.split);
+
+	bdev_io->internal.split.current_offset_blocks = bdev_io->u.bdev.offset_blocks;
+	bdev_io->internal.split.remaining_num_blocks = bdev_io->u.bdev.num_blocks;
+	bdev_io->internal.split.outstanding = 0;
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (_is_buf_allocated(bdev_io->u.bdev.iovs)) {
+			_bdev_rw_split(bdev_io);
+		} else {
+			assert(bdev_io->type == SPDK_BDEV_IO_TYPE_READ);
+			spdk_bdev_io_get_buf(bdev_io, bdev_rw_split_get_buf_cb,
+					     bdev_io->u.bdev.num_blocks * bdev_io_get_block_size(bdev_io));
+		}
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		bdev_unmap_split(bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		bdev_write_zeroes_split(bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_COPY:
+		bdev_copy_split(bdev_io);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+static void
+bdev_rw_split_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	_bdev_rw_split(bdev_io);
+}
+
+static inline void _bdev_io_submit(struct spdk_bdev_io *bdev_io);
+
+static void
+bdev_coalesce_put_group(struct bdev_coalesce_group *group)
+{
+	struct bdev_coalesce_channel *coalesce_ch = group->coalesce_ch;
+
+	STAILQ_INSERT_HEAD(&coalesce_ch->free_groups, group, link);
+}
+
+static void
+bdev_coalesce_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct bdev_coalesce_group *group = cb_arg;
+	struct bdev_coalesce_channel *coalesce_ch = group->coalesce_ch;
+	struct spdk_bdev_io *orig_io;
+
+	while ((orig_io = TAILQ_FIRST(&group->ios)) != NULL) {
+		TAILQ_REMOVE(&group->ios, orig_io, internal.link);
+		orig_io->internal.status = bdev_io->internal.status;
+		orig_io->internal.error = bdev_io->internal.error;
+		bdev_io_complete(orig_io);
+	}
+
+	spdk_bdev_free_io(bdev_io);
+	bdev_coalesce_put_group(group);
+
+	assert(coalesce_ch->num_inflight > 0);
+	if (--coalesce_ch->num_inflight == 0 && coalesce_ch->detached) {
+		free(coalesce_ch);
+	}
+}
+
+/* Submit the I/Os of a group one by one, bypassing the coalescing stage. */
+static void
+bdev_coalesce_submit_each(struct bdev_coalesce_group *group)
+{
+	struct spdk_bdev_io *orig_io;
+
+	while ((orig_io = TAILQ_FIRST(&group->ios)) != NULL) {
+		TAILQ_REMOVE(&group->ios, orig_io, internal.link);
+		_bdev_io_submit(orig_io);
+	}
+	bdev_coalesce_put_group(group);
+}
+
+static void
+bdev_coalesce_flush(struct bdev_coalesce_channel *coalesce_ch)
+{
+	struct bdev_coalesce_group *group = coalesce_ch->pending;
+	struct spdk_bdev_channel *bdev_ch = coalesce_ch->bdev_ch;
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(bdev_ch);
+	struct spdk_bdev_io *orig_io;
+	uint64_t tsc, delay;
+	int rc;
+
+	if (group == NULL) {
+		return;
+	}
+	coalesce_ch->pending = NULL;
+
+	tsc = spdk_get_ticks();
+	TAILQ_FOREACH(orig_io, &group->ios, internal.link) {
+		delay = tsc - orig_io->internal.submit_tsc;
+		bdev_ch->stat->coalesce_latency_ticks += delay;
+		if (bdev_ch->stat->max_coalesce_latency_ticks < delay) {
+			bdev_ch->stat->max_coalesce_latency_ticks = delay;
+		}
+	}
+
+	/* The group's I/Os were already admitted past any locked LBA range, which may since
+	 * have been locked by someone waiting on them, so don't resubmit them as a new I/O. */
+	if (group->num_ios == 1 || !TAILQ_EMPTY(&bdev_ch->locked_ranges)) {
+		bdev_coalesce_submit_each(group);
+		return;
+	}
+
+	coalesce_ch->num_inflight++;
+	if (group->type == SPDK_BDEV_IO_TYPE_READ) {
+		rc = bdev_readv_blocks_with_md(group->desc, ch, group->iovs, group->iovcnt, NULL,
+					       group->offset_blocks, group->num_blocks, NULL, NULL,
+					       NULL, group->dif_check_flags, bdev_coalesce_done, group);
+	} else {
+		rc = bdev_writev_blocks_with_md(group->desc, ch, group->iovs, group->iovcnt, NULL,
+						group->offset_blocks, group->num_blocks, NULL, NULL,
+						NULL, group->dif_check_flags, 0, 0,
+						bdev_coalesce_done, group);
+	}
+	if (spdk_unlikely(rc != 0)) {
+		coalesce_ch->num_inflight--;
+		bdev_coalesce_submit_each(group);
+		return;
+	}
+
+	bdev_ch->stat->num_coalesced_ops += group->num_ios;
+	bdev_ch->stat->num_coalesce_merges++;
+}
+
+static int
+bdev_coalesce_poll(void *ctx)
+{
+	struct bdev_coalesce_channel *coalesce_ch = ctx;
+	struct bdev_coalesce_group *group = coalesce_ch->pending;
+
+	if (group == NULL) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Nothing left to overlap with, or the latency cap would be exceeded by the next poll.
+	 * The poller runs at half the cap, so no I/O is held back longer than max_delay_us. */
+	if (coalesce_ch->bdev_ch->io_outstanding == 0 ||
+	    spdk_get_ticks() - group->start_tsc >= coalesce_ch->max_delay_ticks / 2) {
+		bdev_coalesce_flush(coalesce_ch);
+		return SPDK_POLLER_BUSY;
+	}
+
+	return SPDK_POLLER_IDLE;
+}
+
+static bool
+bdev_io_can_coalesce(struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
+
+	if (bdev_io->type != SPDK_BDEV_IO_TYPE_READ && bdev_io->type != SPDK_BDEV_IO_TYPE_WRITE) {
+		return false;
+	}
+
+	if (bdev_io->internal.cb == bdev_coalesce_done || bdev_io->internal.cb == bdev_io_split_done) {
+		return false;
+	}
+
+	if (bdev_io->internal.f.has_accel_sequence || bdev_io->internal.f.has_memory_domain ||
+	    bdev_io->u.bdev.md_buf != NULL || !_is_buf_allocated(bdev_io->u.bdev.iovs) ||
+	    bdev_io->u.bdev.iovcnt > SPDK_BDEV_IO_NUM_CHILD_IOV) {
+		return false;
+	}
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
+	    (bdev_io->u.bdev.nvme_cdw12.raw != 0 || bdev_io->u.bdev.nvme_cdw13.raw != 0)) {
+		return false;
+	}
+
+	/* QoS charges each submitted I/O, a merged I/O would be charged once for all of them */
+	return bdev_ch->flags == 0 && !bdev_io->internal.desc->qos.enabled;
+}
+
+static bool
+bdev_coalesce_group_fits(struct bdev_coalesce_group *group, struct spdk_bdev_io *bdev_io)
+{
+	return group->type == bdev_io->type &&
+	       group->desc == bdev_io->internal.desc &&
+	       group->dif_check_flags == bdev_io->u.bdev.dif_check_flags &&
+	       group->offset_blocks + group->num_blocks == bdev_io->u.bdev.offset_blocks &&
+	       group->iovcnt + bdev_io->u.bdev.iovcnt <= SPDK_BDEV_IO_NUM_CHILD_IOV;
+}
+
+static void
+bdev_coalesce_group_add(struct bdev_coalesce_group *group, struct spdk_bdev_io *bdev_io)
+{
+	memcpy(&group->iovs[group->iovcnt], bdev_io->u.bdev.iovs,
+	       bdev_io->u.bdev.iovcnt * sizeof(struct iovec));
+	group->iovcnt += bdev_io->u.bdev.iovcnt;
+	group->num_blocks += bdev_io->u.bdev.num_blocks;
+	group->num_ios++;
+	TAILQ_INSERT_TAIL(&group->ios, bdev_io, internal.link);
+}
+
+/*
+ * Try to hold back bdev_io so that it can be merged with contiguous I/O that follows it.
+ * Returns false if the I/O should be submitted right away.
+ */
+static bool
+bdev_io_coalesce(struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
+	struct bdev_coalesce_channel *coalesce_ch = bdev_ch->coalesce;
+	struct bdev_coalesce_group *group = coalesce_ch->pending;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_ABORT) {
+		return false;
+	}
+
+	/* Anything that can't be merged must not overtake the I/Os held back */
+	if (!bdev_io_can_coalesce(bdev_io)) {
+		bdev_coalesce_flush(coalesce_ch);
+		return false;
+	}
+
+	if (group != NULL && !bdev_coalesce_group_fits(group, bdev_io)) {
+		bdev_coalesce_flush(coalesce_ch);
+		group = NULL;
+	}
+
+	if (group == NULL) {
+		/* Only wait for more I/O while the module has something to work on already */
+		if (bdev_ch->io_outstanding == 0) {
+			return false;
+		}
+
+		group = STAILQ_FIRST(&coalesce_ch->free_groups);
+		if (group == NULL) {
+			return false;
+		}
+		STAILQ_REMOVE_HEAD(&coalesce_ch->free_groups, link);
+
+		group->type = bdev_io->type;
+		group->desc = bdev_io->internal.desc;
+		group->dif_check_flags = bdev_io->u.bdev.dif_check_flags;
+		group->offset_blocks = bdev_io->u.bdev.offset_blocks;
+		group->num_blocks = 0;
+		group->iovcnt = 0;
+		group->num_ios = 0;
+		group->start_tsc = bdev_io->internal.submit_tsc;
+		coalesce_ch->pending = group;
+	}
+
+	bdev_coalesce_group_add(group, bdev_io);
+
+	if (group->num_ios == coalesce_ch->max_ios ||
+	    bdev_io->internal.submit_tsc - group->start_tsc >= coalesce_ch->max_delay_ticks) {
+		bdev_coalesce_flush(coalesce_ch);
+	}
+
+	return true;
+}
+
+static bool
+bdev_coalesce_abort_io(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bio_to_abort)
+{
+	struct bdev_coalesce_channel *coalesce_ch = bdev_ch->coalesce;
+	struct bdev_coalesce_group *group;
+	struct spdk_bdev_io *bdev_io;
+
+	if (coalesce_ch == NULL || coalesce_ch->pending == NULL) {
+		return false;
+	}
+
+	group = coalesce_ch->pending;
+	TAILQ_FOREACH(bdev_io, &group->ios, internal.link) {
+		if (bdev_io == bio_to_abort) {
+			break;
+		}
+	}
+	if (bdev_io == NULL) {
+		return false;
+	}
+
+	/* The rest of the group is no longer contiguous, submit it as is */
+	TAILQ_REMOVE(&group->ios, bio_to_abort, internal.link);
+	coalesce_ch->pending = NULL;
+	bdev_coalesce_submit_each(group);
+
+	bio_to_abort->internal.status = SPDK_BDEV_IO_STATUS_ABORTED;
+	bdev_io_complete(bio_to_abort);
+
+	return true;
+}
+
+/* Complete the I/Os held in the pending group as aborted, without submitting them. */
+static void
+bdev_coalesce_abort_pending(struct bdev_coalesce_channel *coalesce_ch)
+{
+	struct bdev_coalesce_group *group = coalesce_ch->pending;
+	struct spdk_bdev_io *bdev_io;
+
+	if (group == NULL) {
+		return;
+	}
+	coalesce_ch->pending = NULL;
+
+	while ((bdev_io = TAILQ_FIRST(&group->ios)) != NULL) {
+		TAILQ_REMOVE(&group->ios, bdev_io, internal.link);
+		bdev_io->internal.status = SPDK_BDEV_IO_STATUS_ABORTED;
+		bdev_io_complete(bdev_io);
+	}
+	bdev_coalesce_put_group(group);
+}
+
+static struct bdev_coalesce_channel *
+bdev_coalesce_channel_create(struct spdk_bdev_channel *bdev_ch, uint32_t max_ios,
+			     uint64_t max_delay_us)
+{
+	struct bdev_coalesce_channel *coalesce_ch;
+	int i;
+
+	coalesce_ch = calloc(1, sizeof(*coalesce_ch));
+	if (coalesce_ch == NULL) {
+		return NULL;
+	}
+
+	coalesce_ch->poller = SPDK_POLLER_REGISTER(bdev_coalesce_poll, coalesce_ch, max_delay_us / 2);
+	if (coalesce_ch->poller == NULL) {
+		free(coalesce_ch);
+		return NULL;
+	}
+
+	coalesce_ch->bdev_ch = bdev_ch;
+	coalesce_ch->max_ios = max_ios;
+	coalesce_ch->max_delay_ticks = max_delay_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	STAILQ_INIT(&coalesce_ch->free_groups);
+	for (i = 0; i < BDEV_COALESCE_NUM_GROUPS; i++) {
+		coalesce_ch->groups[i].coalesce_ch = coalesce_ch;
+		TAILQ_INIT(&coalesce_ch->groups[i].ios);
+		STAILQ_INSERT_TAIL(&coalesce_ch->free_groups, &coalesce_ch->groups[i], link);
+	}
+
+	return coalesce_ch;
+}
+
+static void
+bdev_coalesce_channel_destroy(struct bdev_coalesce_channel *coalesce_ch)
+{
+	bdev_coalesce_flush(coalesce_ch);
+	spdk_poller_unregister(&coalesce_ch->poller);
+
+	/* Merged I/Os still in flight reference their groups, free on the last completion */
+	if (coalesce_ch->num_inflight > 0) {
+		coalesce_ch->detached = true;
+	} else {
+		free(coalesce_ch);
+	}
+}
+
+static int
+bdev_channel_set_coalesce(struct spdk_bdev_channel *bdev_ch, uint32_t max_ios,
+			  uint64_t max_delay_us)
+{
+	if (bdev_ch->coalesce != NULL) {
+		bdev_coalesce_channel_destroy(bdev_ch->coalesce);
+		bdev_ch->coalesce = NULL;
+	}
+
+	if (max_ios > 1) {
+		bdev_ch->coalesce = bdev_coalesce_channel_create(bdev_ch, max_ios, max_delay_us);
+		if (bdev_ch->coalesce == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static inline int64_t
+bdev_fair_share_slice_tokens(uint64_t ios_per_sec)
+{
+	return ios_per_sec * BDEV_FAIR_SHARE_SLICE_US / SPDK_SEC_TO_USEC;
+}
+
+static inline int64_t
+bdev_desc_qos_max_tokens(struct spdk_bdev_desc *desc)
+{
+	if (desc->qos.opts.max_ios_per_sec == 0) {
+		return INT64_MAX;
+	}
+
+	return bdev_fair_share_slice_tokens(desc->qos.opts.max_ios_per_sec);
+}
+
+/*
+ * Compute the shares of the next timeslice.  Each descriptor first gets its reserved
+ * minimum, then the rest of the capacity is water-filled by weight between the
+ * descriptors that submitted I/O during the closing timeslice, up to their maximums.
+ */
+static void
+bdev_fair_share_refill(struct spdk_bdev *bdev)
+{
+	struct spdk_bdev_desc *desc;
+	uint64_t epoch, weight_sum = 0, next_weight_sum;
+	int64_t capacity, remaining, distributed, max, extra;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	epoch = bdev->internal.fair_share.epoch;
+	capacity = bdev_fair_share_slice_tokens(bdev->internal.fair_share.ios_per_sec);
+	remaining = capacity;
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		if (!desc->qos.enabled) {
+			continue;
+		}
+
+		max = bdev_desc_qos_max_tokens(desc);
+		if (capacity == 0) {
+			desc->qos.share = max;
+			continue;
+		}
+
+		desc->qos.share = spdk_min(bdev_fair_share_slice_tokens(desc->qos.opts.min_ios_per_sec), max);
+		if (desc->qos.active_epoch == epoch) {
+			remaining -= spdk_min(desc->qos.share, remaining);
+			if (desc->qos.share < max) {
+				weight_sum += desc->qos.opts.weight;
+			}
+		}
+	}
+
+	while (remaining > 0 && weight_sum > 0) {
+		distributed = 0;
+		next_weight_sum = 0;
+
+		TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+			if (!desc->qos.enabled || desc->qos.active_epoch != epoch) {
+				continue;
+			}
+
+			max = bdev_desc_qos_max_tokens(desc);
+			if (desc->qos.share >= max) {
+				continue;
+			}
+
+			/* Rounding leftovers go to the first descriptors */
+			extra = spdk_max(remaining * desc->qos.opts.weight / weight_sum, 1);
+			extra = spdk_min(extra, remaining - distributed);
+			extra = spdk_min(extra, max - desc->qos.share);
+			desc->qos.share += extra;
+			distributed += extra;
+			if (desc->qos.share < max) {
+				next_weight_sum += desc->qos.opts.weight;
+			}
+		}
+
+		if (distributed == 0) {
+			break;
+		}
+		remaining -= distributed;
+		weight_sum = next_weight_sum;
+	}
+
+	TAILQ_FOREACH(desc, &bdev->internal.open_descs, link) {
+		if (desc->qos.enabled) {
+			__atomic_store_n(&desc->qos.tokens, desc->qos.share, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_store_n(&bdev->internal.fair_share.epoch, epoch + 1, __ATOMIC_RELEASE);
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+static inline uint64_t
+bdev_fair_share_slice_ticks(void)
+{
+	return spdk_get_ticks_hz() * BDEV_FAIR_SHARE_SLICE_US / SPDK_SEC_TO_USEC;
+}
+
+/* Make the next submission refill the tokens with the current configuration */
+static void
+bdev_fair_share_expire_slice(struct spdk_bdev *bdev)
+{
+	__atomic_store_n(&bdev->internal.fair_share.slice_start_tsc,
+			 spdk_get_ticks() - bdev_fair_share_slice_ticks(), __ATOMIC_RELAXED);
+}
+
+/* Return the current fair-share epoch, refilling the tokens if the timeslice expired */
+static uint64_t
+bdev_fair_share_get_epoch(struct spdk_bdev *bdev)
+{
+	uint64_t now = spdk_get_ticks();
+	uint64_t start;
+
+	start = __atomic_load_n(&bdev->internal.fair_share.slice_start_tsc, __ATOMIC_RELAXED);
+	if (now - start >= bdev_fair_share_slice_ticks() &&
+	    __atomic_compare_exchange_n(&bdev->internal.fair_share.slice_start_tsc, &start, now, false,
+					__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		/* Only the channel that won the race refills */
+		bdev_fair_share_refill(bdev);
+	}
+
+	return __atomic_load_n(&bdev->internal.fair_share.epoch, __ATOMIC_ACQUIRE);
+}
+
+static bool
+bdev_desc_qos_take_token(struct bdev_desc_qos_channel *desc_ch)
+{
+	struct spdk_bdev_desc *desc = desc_ch->desc;
+	uint64_t epoch = bdev_fair_share_get_epoch(desc->bdev);
+	int64_t avail, batch;
+
+	if (desc_ch->epoch != epoch) {
+		/* Tokens left over from a previous timeslice are not carried over */
+		desc_ch->epoch = epoch;
+		desc_ch->tokens = 0;
+	}
+
+	if (__atomic_load_n(&desc->qos.active_epoch, __ATOMIC_RELAXED) != epoch) {
+		__atomic_store_n(&desc->qos.active_epoch, epoch, __ATOMIC_RELAXED);
+	}
+
+	if (desc_ch->tokens > 0) {
+		desc_ch->tokens--;
+		return true;
+	}
+
+	avail = __atomic_load_n(&desc->qos.tokens, __ATOMIC_RELAXED);
+	while (avail > 0) {
+		batch = spdk_min(avail, BDEV_FAIR_SHARE_TOKEN_BATCH);
+		if (__atomic_compare_exchange_n(&desc->qos.tokens, &avail, avail - batch, false,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			desc_ch->tokens = batch - 1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static struct bdev_desc_qos_channel *
+bdev_desc_qos_get_channel(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_desc *desc)
+{
+	struct bdev_desc_qos_channel *desc_ch, *tmp;
+	uint64_t epoch;
+
+	TAILQ_FOREACH(desc_ch, &bdev_ch->desc_qos, link) {
+		if (desc_ch->desc == desc && desc_ch->desc_id == desc->qos.id) {
+			return desc_ch;
+		}
+	}
+
+	/*
+	 * Descriptors do not notify the channels when they are closed, so free the entries
+	 * that have not been used for a while.  Their descriptor is not dereferenced as it
+	 * may be gone.
+	 */
+	epoch = __atomic_load_n(&bdev_ch->bdev->internal.fair_share.epoch, __ATOMIC_ACQUIRE);
+	TAILQ_FOREACH_SAFE(desc_ch, &bdev_ch->desc_qos, link, tmp) {
+		if (TAILQ_EMPTY(&desc_ch->queued_io) &&
+		    desc_ch->epoch + BDEV_FAIR_SHARE_IDLE_SLICES < epoch) {
+			TAILQ_REMOVE(&bdev_ch->desc_qos, desc_ch, link);
+			free(desc_ch);
+		}
+	}
+
+	desc_ch = calloc(1, sizeof(*desc_ch));
+	if (desc_ch == NULL) {
+		return NULL;
+	}
+
+	desc_ch->desc = desc;
+	desc_ch->desc_id = desc->qos.id;
+	desc_ch->epoch = epoch;
+	TAILQ_INIT(&desc_ch->queued_io);
+	TAILQ_INSERT_HEAD(&bdev_ch->desc_qos, desc_ch, link);
+
+	return desc_ch;
+}
+
+static void _bdev_io_submit_admitted(struct spdk_bdev_io *bdev_io);
+
+static int
+bdev_desc_qos_poll(void *arg)
+{
+	struct spdk_bdev_channel *bdev_ch = arg;
+	struct bdev_desc_qos_channel *desc_ch;
+	struct spdk_bdev_io *bdev_io;
+	bool queued = false;
+	int submitted = 0;
+
+	TAILQ_FOREACH(desc_ch, &bdev_ch->desc_qos, link) {
+		while ((bdev_io = TAILQ_FIRST(&desc_ch->queued_io)) != NULL) {
+			/* Queued I/O keeps its descriptor open, so it is safe to dereference */
+			if (desc_ch->desc->qos.enabled) {
+				if (!bdev_desc_qos_take_token(desc_ch)) {
+					queued = true;
+					break;
+				}
+			} else {
+				/* Fair-share QoS was disabled, release the I/O.  Keep the entry fresh
+				 * so that it is not freed from under this loop. */
+				desc_ch->epoch = bdev_fair_share_get_epoch(bdev_ch->bdev);
+			}
+
+			TAILQ_REMOVE(&desc_ch->queued_io, bdev_io, internal.link);
+			_bdev_io_submit_admitted(bdev_io);
+			submitted++;
+		}
+	}
+
+	if (!queued) {
+		spdk_poller_unregister(&bdev_ch->desc_qos_poller);
+	}
+
+	return submitted > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+/* Return true if the I/O may be submitted now, false if it was queued for lack of tokens */
+static bool
+bdev_desc_qos_admit(struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
+	struct bdev_desc_qos_channel *desc_ch;
+
+	desc_ch = bdev_desc_qos_get_channel(bdev_ch, bdev_io->internal.desc);
+	if (spdk_unlikely(desc_ch == NULL)) {
+		/* Do not fail the I/O only because it could not be throttled */
+		return true;
+	}
+
+	if (TAILQ_EMPTY(&desc_ch->queued_io) && bdev_desc_qos_take_token(desc_ch)) {
+		return true;
+	}
 
-	if (spdk_unlikely(status != 0)) {
-		SPDK_ERRLOG("Failed to execute accel sequence, status=%d\n", status);
+	if (bdev_ch->desc_qos_poller == NULL) {
+		bdev_ch->desc_qos_poller = SPDK_POLLER_REGISTER(bdev_desc_qos_poll, bdev_ch,
+					   BDEV_FAIR_SHARE_SLICE_US / 4);
+		if (bdev_ch->desc_qos_poller == NULL) {
+			return true;
+		}
 	}
 
-	parent_bdev_io_complete(bdev_io, status);
+	TAILQ_INSERT_TAIL(&desc_ch->queued_io, bdev_io, internal.link);
+
+	return false;
 }
 
 static void
-bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+bdev_desc_qos_abort_all_io(struct spdk_bdev_channel *bdev_ch)
 {
-	struct spdk_bdev_io *parent_io = cb_arg;
-
-	spdk_bdev_free_io(bdev_io);
-
-	assert(parent_io->internal.f.split);
+	struct bdev_desc_qos_channel *desc_ch;
 
-	if (!success) {
-		parent_io->internal.status = SPDK_BDEV_IO_STATUS_FAILED;
-		/* If any child I/O failed, stop further splitting process. */
-		parent_io->internal.split.current_offset_blocks += parent_io->internal.split.remaining_num_blocks;
-		parent_io->internal.split.remaining_num_blocks = 0;
-	}
-	parent_io->internal.split.outstanding--;
-	if (parent_io->internal.split.outstanding != 0) {
-		return;
+	TAILQ_FOREACH(desc_ch, &bdev_ch->desc_qos, link) {
+		bdev_abort_all_queued_io(&desc_ch->queued_io, bdev_ch);
 	}
+}
 
-	/*
-	 * Parent I/O finishes when all blocks are consumed.
-	 */
-	if (parent_io->internal.split.remaining_num_blocks == 0) {
-		assert(parent_io->internal.cb != bdev_io_split_done);
-		bdev_ch_remove_from_io_submitted(parent_io);
-		spdk_trace_record(TRACE_BDEV_IO_DONE, parent_io->internal.ch->trace_id,
-				  0, (uintptr_t)parent_io, bdev_io->internal.caller_ctx,
-				  parent_io->internal.ch->queue_depth);
+static bool
+bdev_desc_qos_abort_io(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bio_to_abort)
+{
+	struct bdev_desc_qos_channel *desc_ch;
+	struct spdk_bdev_io *bdev_io;
 
-		if (spdk_likely(parent_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS)) {
-			if (bdev_io_needs_sequence_exec(parent_io->internal.desc, parent_io)) {
-				bdev_io_exec_sequence(parent_io, bdev_io_complete_parent_sequence_cb);
-				return;
-			} else if (parent_io->internal.f.has_bounce_buf &&
-				   !bdev_io_use_accel_sequence(bdev_io)) {
-				/* bdev IO will be completed in the callback */
-				_bdev_io_push_bounce_data_buffer(parent_io, parent_bdev_io_complete);
-				return;
+	TAILQ_FOREACH(desc_ch, &bdev_ch->desc_qos, link) {
+		TAILQ_FOREACH(bdev_io, &desc_ch->queued_io, internal.link) {
+			if (bdev_io == bio_to_abort) {
+				TAILQ_REMOVE(&desc_ch->queued_io, bio_to_abort, internal.link);
+				/* The I/O was never submitted, see bdev_abort_all_queued_io() */
+				bdev_io_increment_outstanding(bdev_ch, bdev_ch->shared_resource);
+				spdk_bdev_io_complete(bio_to_abort, SPDK_BDEV_IO_STATUS_ABORTED);
+				return true;
 			}
 		}
-
-		parent_bdev_io_complete(parent_io, 0);
-		return;
 	}
 
-	/*
-	 * Continue with the splitting process.  This function will complete the parent I/O if the
-	 * splitting is done.
-	 */
-	switch (parent_io->type) {
-	case SPDK_BDEV_IO_TYPE_READ:
-	case SPDK_BDEV_IO_TYPE_WRITE:
-		_bdev_rw_split(parent_io);
-		break;
-	case SPDK_BDEV_IO_TYPE_UNMAP:
-		bdev_unmap_split(parent_io);
-		break;
-	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
-		bdev_write_zeroes_split(parent_io);
-		break;
-	case SPDK_BDEV_IO_TYPE_COPY:
-		bdev_copy_split(parent_io);
-		break;
-	default:
-		assert(false);
-		break;
-	}
+	return false;
 }
 
-static void bdev_rw_split_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
-				     bool success);
-
 static void
-bdev_io_split(struct spdk_bdev_io *bdev_io)
+bdev_desc_qos_channel_destroy(struct spdk_bdev_channel *bdev_ch)
 {
-	assert(bdev_io_should_split(bdev_io));
-	assert(bdev_io->internal.f.split);
+	struct bdev_desc_qos_channel *desc_ch;
 
-	bdev_io->internal.split.current_offset_blocks = bdev_io->u.bdev.offset_blocks;
-	bdev_io->internal.split.remaining_num_blocks = bdev_io->u.bdev.num_blocks;
-	bdev_io->internal.split.outstanding = 0;
-	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	bdev_desc_qos_abort_all_io(bdev_ch);
+	spdk_poller_unregister(&bdev_ch->desc_qos_poller);
 
-	switch (bdev_io->type) {
-	case SPDK_BDEV_IO_TYPE_READ:
-	case SPDK_BDEV_IO_TYPE_WRITE:
-		if (_is_buf_allocated(bdev_io->u.bdev.iovs)) {
-			_bdev_rw_split(bdev_io);
-		} else {
-			assert(bdev_io->type == SPDK_BDEV_IO_TYPE_READ);
-			spdk_bdev_io_get_buf(bdev_io, bdev_rw_split_get_buf_cb,
-					     bdev_io->u.bdev.num_blocks * bdev_io_get_block_size(bdev_io));
-		}
-		break;
-	case SPDK_BDEV_IO_TYPE_UNMAP:
-		bdev_unmap_split(bdev_io);
-		break;
-	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
-		bdev_write_zeroes_split(bdev_io);
-		break;
-	case SPDK_BDEV_IO_TYPE_COPY:
-		bdev_copy_split(bdev_io);
-		break;
-	default:
-		assert(false);
-		break;
+	while ((desc_ch = TAILQ_FIRST(&bdev_ch->desc_qos)) != NULL) {
+		TAILQ_REMOVE(&bdev_ch->desc_qos, desc_ch, link);
+		free(desc_ch);
 	}
 }
 
-static void
-bdev_rw_split_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+static inline void
+_bdev_io_submit(struct spdk_bdev_io *bdev_io)
 {
-	if (!success) {
-		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	if (spdk_unlikely(bdev_io->internal.desc->qos.enabled) &&
+	    bdev_qos_io_to_limit(bdev_io) &&
+	    !(bdev_io->internal.ch->flags & BDEV_CH_RESET_IN_PROGRESS) &&
+	    !bdev_desc_qos_admit(bdev_io)) {
 		return;
 	}
 
-	_bdev_rw_split(bdev_io);
+	_bdev_io_submit_admitted(bdev_io);
 }
 
-static inline void
-_bdev_io_submit(struct spdk_bdev_io *bdev_io)
+static void
+_bdev_io_submit_admitted(struct spdk_bdev_io *bdev_io)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
 	struct spdk_bdev_channel *bdev_ch = bdev_io->internal.ch;
@@ -3774,6 +4714,10 @@ bdev_io_submit(struct spdk_bdev_io *bdev_io)
 		return;
 	}
 
+	if (spdk_unlikely(ch->coalesce != NULL) && bdev_io_coalesce(bdev_io)) {
+		return;
+	}
+
 	_bdev_io_submit(bdev_io);
 }
 
@@ -4409,6 +5353,8 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	struct spdk_bdev_mgmt_channel	*mgmt_ch;
 	struct spdk_bdev_shared_resource *shared_resource;
 	struct lba_range		*range;
+	uint32_t			coalesce_max_ios;
+	uint64_t			coalesce_max_delay_us;
 
 	ch->bdev = bdev;
 	ch->channel = bdev->fn_table->get_io_channel(bdev->ctxt);
@@ -4470,6 +5416,7 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	ch->io_outstanding = 0;
 	TAILQ_INIT(&ch->locked_ranges);
 	TAILQ_INIT(&ch->qos_queued_io);
+	TAILQ_INIT(&ch->desc_qos);
 	ch->flags = 0;
 	ch->trace_id = bdev->internal.trace_id;
 	ch->shared_resource = shared_resource;
@@ -4526,8 +5473,15 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 		TAILQ_INSERT_TAIL(&ch->locked_ranges, new_range, tailq);
 	}
 
+	coalesce_max_ios = bdev->internal.coalesce.max_ios;
+	coalesce_max_delay_us = bdev->internal.coalesce.max_delay_us;
+
 	spdk_spin_unlock(&bdev->internal.spinlock);
 
+	if (bdev_channel_set_coalesce(ch, coalesce_max_ios, coalesce_max_delay_us) != 0) {
+		SPDK_ERRLOG("Could not enable I/O coalescing\n");
+	}
+
 	return 0;
 }
 
@@ -4711,6 +5665,12 @@ spdk_bdev_add_io_stat(struct spdk_bdev_io_stat *total, struct spdk_bdev_io_stat
 	total->write_latency_ticks += add->write_latency_ticks;
 	total->unmap_latency_ticks += add->unmap_latency_ticks;
 	total->copy_latency_ticks += add->copy_latency_ticks;
+	total->num_coalesced_ops += add->num_coalesced_ops;
+	total->num_coalesce_merges += add->num_coalesce_merges;
+	total->coalesce_latency_ticks += add->coalesce_latency_ticks;
+	if (total->max_coalesce_latency_ticks < add->max_coalesce_latency_ticks) {
+		total->max_coalesce_latency_ticks = add->max_coalesce_latency_ticks;
+	}
 	if (total->max_read_latency_ticks < add->max_read_latency_ticks) {
 		total->max_read_latency_ticks = add->max_read_latency_ticks;
 	}
@@ -4741,6 +5701,8 @@ static void
 bdev_get_io_stat(struct spdk_bdev_io_stat *to_stat, struct spdk_bdev_io_stat *from_stat)
 {
 	memcpy(to_stat, from_stat, offsetof(struct spdk_bdev_io_stat, io_error));
+	memcpy(&to_stat->num_coalesced_ops, &from_stat->num_coalesced_ops,
+	       sizeof(*to_stat) - offsetof(struct spdk_bdev_io_stat, num_coalesced_ops));
 
 	if (to_stat->io_error != NULL && from_stat->io_error != NULL) {
 		memcpy(to_stat->io_error, from_stat->io_error,
@@ -4763,6 +5725,7 @@ spdk_bdev_reset_io_stat(struct spdk_bdev_io_stat *stat, enum spdk_bdev_reset_sta
 	stat->min_unmap_latency_ticks = UINT64_MAX;
 	stat->max_copy_latency_ticks = 0;
 	stat->min_copy_latency_ticks = UINT64_MAX;
+	stat->max_coalesce_latency_ticks = 0;
 
 	if (mode != SPDK_BDEV_RESET_STAT_ALL) {
 		return;
@@ -4780,6 +5743,9 @@ spdk_bdev_reset_io_stat(struct spdk_bdev_io_stat *stat, enum spdk_bdev_reset_sta
 	stat->write_latency_ticks = 0;
 	stat->unmap_latency_ticks = 0;
 	stat->copy_latency_ticks = 0;
+	stat->num_coalesced_ops = 0;
+	stat->num_coalesce_merges = 0;
+	stat->coalesce_latency_ticks = 0;
 
 	if (stat->io_error != NULL) {
 		memset(stat->io_error, 0, sizeof(struct spdk_bdev_io_error_stat));
@@ -4853,6 +5819,10 @@ spdk_bdev_dump_io_stat_json(struct spdk_bdev_io_stat *stat, struct spdk_json_wri
 	spdk_json_write_named_uint64(w, "min_copy_latency_ticks",
 				     stat->min_copy_latency_ticks != UINT64_MAX ?
 				     stat->min_copy_latency_ticks : 0);
+	spdk_json_write_named_uint64(w, "num_coalesced_ops", stat->num_coalesced_ops);
+	spdk_json_write_named_uint64(w, "num_coalesce_merges", stat->num_coalesce_merges);
+	spdk_json_write_named_uint64(w, "coalesce_latency_ticks", stat->coalesce_latency_ticks);
+	spdk_json_write_named_uint64(w, "max_coalesce_latency_ticks", stat->max_coalesce_latency_ticks);
 
 	if (stat->io_error != NULL) {
 		spdk_json_write_named_object_begin(w, "io_error");
@@ -4887,12 +5857,22 @@ bdev_channel_destroy(void *io_device, void *ctx_buf)
 	spdk_trace_record(TRACE_BDEV_IOCH_DESTROY, ch->bdev->internal.trace_id, 0, 0,
 			  spdk_thread_get_id(spdk_io_channel_get_thread(ch->channel)));
 
+	/* Don't submit held I/Os on a channel that is being torn down */
+	if (ch->coalesce != NULL) {
+		bdev_coalesce_abort_pending(ch->coalesce);
+		bdev_coalesce_channel_destroy(ch->coalesce);
+		ch->coalesce = NULL;
+	}
+
+	bdev_channel_abort_queued_ios(ch);
+	bdev_desc_qos_channel_destroy(ch);
+
 	/* This channel is going away, so add its statistics into the bdev so that they don't get lost. */
 	spdk_spin_lock(&ch->bdev->internal.spinlock);
 	spdk_bdev_add_io_stat(ch->bdev->internal.stat, ch->stat);
 	spdk_spin_unlock(&ch->bdev->internal.spinlock);
 
-	bdev_channel_abort_queued_ios(ch);
+	assert(ch->plugged_io_count == 0);
 
 	if (ch->histogram) {
 		spdk_histogram_data_free(ch->histogram);
@@ -5023,6 +6003,25 @@ spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
 	return spdk_get_io_channel(__bdev_to_io_dev(spdk_bdev_desc_get_bdev(desc)));
 }
 
+void
+spdk_bdev_channel_plug(struct spdk_io_channel *ch)
+{
+	struct spdk_bdev_channel *bdev_ch = __io_ch_to_bdev_ch(ch);
+
+	bdev_ch->plug_depth++;
+}
+
+void
+spdk_bdev_channel_unplug(struct spdk_io_channel *ch)
+{
+	struct spdk_bdev_channel *bdev_ch = __io_ch_to_bdev_ch(ch);
+
+	assert(bdev_ch->plug_depth > 0);
+	if (--bdev_ch->plug_depth == 0) {
+		bdev_channel_flush_plugged_io(bdev_ch);
+	}
+}
+
 void *
 spdk_bdev_get_module_ctx(struct spdk_bdev_desc *desc)
 {
@@ -5981,6 +6980,8 @@ bdev_write_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *c
 	bdev_io->u.bdev.memory_domain_ctx = NULL;
 	bdev_io->u.bdev.accel_sequence = NULL;
 	bdev_io->u.bdev.dif_check_flags = bdev->dif_check_flags;
+	bdev_io->u.bdev.nvme_cdw12.raw = 0;
+	bdev_io->u.bdev.nvme_cdw13.raw = 0;
 	bdev_io_init(bdev_io, bdev, cb_arg, cb);
 
 	bdev_io_submit(bdev_io);
@@ -6926,6 +7927,7 @@ bdev_reset_freeze_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 	bdev_abort_all_queued_io(&shared_resource->nomem_io, channel);
 	bdev_abort_all_buf_io(mgmt_channel, channel);
 	bdev_abort_all_queued_io(&tmp_queued, channel);
+	bdev_desc_qos_abort_all_io(channel);
 
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
@@ -7698,6 +8700,12 @@ bdev_io_complete(void *ctx)
 	spdk_trace_record_tsc(tsc, TRACE_BDEV_IO_DONE, bdev_ch->trace_id, 0, (uintptr_t)bdev_io,
 			      bdev_io->internal.caller_ctx, bdev_ch->queue_depth);
 
+	/* A merged I/O is accounted through the original I/Os it completes */
+	if (spdk_unlikely(bdev_io->internal.cb == bdev_coalesce_done)) {
+		_bdev_io_complete(bdev_io);
+		return;
+	}
+
 	if (bdev_ch->histogram) {
 		if (bdev_io->bdev->internal.histogram_io_type == 0 ||
 		    bdev_io->bdev->internal.histogram_io_type == bdev_io->type) {
@@ -10042,6 +11050,188 @@ spdk_bdev_histogram_enable_ext(struct spdk_bdev *bdev, spdk_bdev_histogram_statu
 	}
 }
 
+struct spdk_bdev_coalesce_ctx {
+	void (*cb_fn)(void *cb_arg, int status);
+	void *cb_arg;
+	uint32_t max_ios;
+	uint64_t max_delay_us;
+};
+
+static void
+bdev_set_coalesce_channel_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct spdk_bdev_coalesce_ctx *ctx = _ctx;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	bdev->internal.coalesce.in_progress = false;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+	free(ctx);
+}
+
+static void
+bdev_set_coalesce_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+			  struct spdk_io_channel *_ch, void *_ctx)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+	struct spdk_bdev_coalesce_ctx *ctx = _ctx;
+
+	spdk_bdev_for_each_channel_continue(i, bdev_channel_set_coalesce(ch, ctx->max_ios,
+					    ctx->max_delay_us));
+}
+
+void
+spdk_bdev_get_coalesce(struct spdk_bdev *bdev, uint32_t *max_ios, uint64_t *max_delay_us)
+{
+	spdk_spin_lock(&bdev->internal.spinlock);
+	*max_ios = bdev->internal.coalesce.max_ios;
+	*max_delay_us = bdev->internal.coalesce.max_delay_us;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+void
+spdk_bdev_set_coalesce(struct spdk_bdev *bdev, uint32_t max_ios, uint64_t max_delay_us,
+		       void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct spdk_bdev_coalesce_ctx *ctx;
+
+	if (max_ios > SPDK_BDEV_IO_NUM_CHILD_IOV) {
+		SPDK_ERRLOG("max_ios %" PRIu32 " exceeds the maximum of %d\n", max_ios,
+			    SPDK_BDEV_IO_NUM_CHILD_IOV);
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	if (max_ios <= 1) {
+		max_ios = 0;
+		max_delay_us = 0;
+	} else if (max_delay_us == 0) {
+		SPDK_ERRLOG("max_delay_us must be non-zero to enable coalescing\n");
+		cb_fn(cb_arg, -EINVAL);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->max_ios = max_ios;
+	ctx->max_delay_us = max_delay_us;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.coalesce.in_progress) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	bdev->internal.coalesce.in_progress = true;
+	bdev->internal.coalesce.max_ios = max_ios;
+	bdev->internal.coalesce.max_delay_us = max_delay_us;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	spdk_bdev_for_each_channel(bdev, bdev_set_coalesce_channel, ctx,
+				   bdev_set_coalesce_channel_done);
+}
+
+uint64_t
+spdk_bdev_get_fair_share_ios_per_sec(struct spdk_bdev *bdev)
+{
+	uint64_t ios_per_sec;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	ios_per_sec = bdev->internal.fair_share.ios_per_sec;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	return ios_per_sec;
+}
+
+int
+spdk_bdev_set_fair_share_ios_per_sec(struct spdk_bdev *bdev, uint64_t ios_per_sec)
+{
+	if (ios_per_sec % SPDK_BDEV_QOS_MIN_IOS_PER_SEC) {
+		SPDK_ERRLOG("ios_per_sec %" PRIu64 " is not a multiple of %u\n", ios_per_sec,
+			    SPDK_BDEV_QOS_MIN_IOS_PER_SEC);
+		return -EINVAL;
+	}
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	bdev->internal.fair_share.ios_per_sec = ios_per_sec;
+	bdev_fair_share_expire_slice(bdev);
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	return 0;
+}
+
+int
+spdk_bdev_desc_set_qos(struct spdk_bdev_desc *desc, const struct spdk_bdev_desc_qos_opts *opts)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	struct spdk_bdev_desc_qos_opts qos_opts = {};
+
+	if (opts == NULL || opts->size == 0) {
+		SPDK_ERRLOG("opts must be set with a non-zero size\n");
+		return -EINVAL;
+	}
+
+#define SET_FIELD(field) \
+	if (offsetof(struct spdk_bdev_desc_qos_opts, field) + sizeof(opts->field) <= opts->size) { \
+		qos_opts.field = opts->field; \
+	} \
+
+	SET_FIELD(weight);
+	SET_FIELD(min_ios_per_sec);
+	SET_FIELD(max_ios_per_sec);
+	qos_opts.size = sizeof(qos_opts);
+
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_desc_qos_opts) == 32, "Incorrect size");
+
+#undef SET_FIELD
+
+	if (qos_opts.min_ios_per_sec % SPDK_BDEV_QOS_MIN_IOS_PER_SEC ||
+	    qos_opts.max_ios_per_sec % SPDK_BDEV_QOS_MIN_IOS_PER_SEC) {
+		SPDK_ERRLOG("I/O limits must be multiples of %u\n", SPDK_BDEV_QOS_MIN_IOS_PER_SEC);
+		return -EINVAL;
+	}
+
+	if (qos_opts.max_ios_per_sec != 0 && qos_opts.min_ios_per_sec > qos_opts.max_ios_per_sec) {
+		SPDK_ERRLOG("min_ios_per_sec %" PRIu64 " exceeds max_ios_per_sec %" PRIu64 "\n",
+			    qos_opts.min_ios_per_sec, qos_opts.max_ios_per_sec);
+		return -EINVAL;
+	}
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	desc->qos.opts = qos_opts;
+	if (desc->qos.id == 0) {
+		desc->qos.id = ++bdev->internal.fair_share.next_desc_id;
+	}
+	/* Take part in the next refill, which happens on the next submission */
+	desc->qos.active_epoch = bdev->internal.fair_share.epoch;
+	bdev_fair_share_expire_slice(bdev);
+	desc->qos.enabled = qos_opts.weight != 0;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	return 0;
+}
+
+void
+spdk_bdev_desc_get_qos(struct spdk_bdev_desc *desc, struct spdk_bdev_desc_qos_opts *opts)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	size_t opts_size = opts->size;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	memcpy(opts, &desc->qos.opts, spdk_min(opts_size, sizeof(desc->qos.opts)));
+	spdk_spin_unlock(&bdev->internal.spinlock);
+	opts->size = opts_size;
+}
+
 void
 spdk_bdev_enable_histogram_opts_init(struct spdk_bdev_enable_histogram_opts *opts, size_t size)
 {
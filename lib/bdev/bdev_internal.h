@@ -16,6 +16,11 @@ struct spdk_bdev_channel;
 
 struct spdk_bdev_io *bdev_channel_get_io(struct spdk_bdev_channel *channel);
 
+struct spdk_io_channel;
+struct spdk_json_write_ctx;
+
+void bdev_dump_io_cache_stat_json(struct spdk_io_channel *ch, struct spdk_json_write_ctx *w);
+
 void bdev_io_init(struct spdk_bdev_io *bdev_io, struct spdk_bdev *bdev, void *cb_arg,
 		  spdk_bdev_io_completion_cb cb);
 
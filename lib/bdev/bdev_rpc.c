@@ -306,6 +306,7 @@ bdev_get_per_channel_stat(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_uint64(w, "thread_id", spdk_thread_get_id(spdk_get_thread()));
 	spdk_bdev_dump_io_stat_json(bdev_ctx->stat, w);
+	bdev_dump_io_cache_stat_json(ch, w);
 	spdk_json_write_object_end(w);
 
 	spdk_bdev_for_each_channel_continue(i, 0);
@@ -985,6 +986,131 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_set_qos_limit", rpc_bdev_set_qos_limit, SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_set_coalesce {
+	char		*name;
+	uint32_t	max_ios;
+	uint64_t	max_delay_us;
+};
+
+static void
+free_rpc_bdev_set_coalesce(struct rpc_bdev_set_coalesce *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_set_coalesce_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_coalesce, name), spdk_json_decode_string},
+	{"max_ios", offsetof(struct rpc_bdev_set_coalesce, max_ios), spdk_json_decode_uint32},
+	{"max_delay_us", offsetof(struct rpc_bdev_set_coalesce, max_delay_us), spdk_json_decode_uint64, true},
+};
+
+static void
+rpc_bdev_set_coalesce_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to configure I/O coalescing: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_set_coalesce(struct spdk_jsonrpc_request *request,
+		      const struct spdk_json_val *params)
+{
+	/* Hold I/O back for at most 100us unless specified otherwise */
+	struct rpc_bdev_set_coalesce req = {NULL, 0, 100};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_coalesce_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_coalesce_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_set_coalesce(spdk_bdev_desc_get_bdev(desc), req.max_ios, req.max_delay_us,
+			       rpc_bdev_set_coalesce_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_set_coalesce(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_set_coalesce", rpc_bdev_set_coalesce, SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_set_fair_share {
+	char		*name;
+	uint64_t	ios_per_sec;
+};
+
+static void
+free_rpc_bdev_set_fair_share(struct rpc_bdev_set_fair_share *r)
+{
+	free(r->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_set_fair_share_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_set_fair_share, name), spdk_json_decode_string},
+	{"ios_per_sec", offsetof(struct rpc_bdev_set_fair_share, ios_per_sec), spdk_json_decode_uint64},
+};
+
+static void
+rpc_bdev_set_fair_share(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_fair_share req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_fair_share_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_fair_share_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_set_fair_share_ios_per_sec(spdk_bdev_desc_get_bdev(desc), req.ios_per_sec);
+	spdk_bdev_close(desc);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_set_fair_share(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_set_fair_share", rpc_bdev_set_fair_share, SPDK_RPC_RUNTIME)
+
 /* SPDK_RPC_ENABLE_BDEV_HISTOGRAM */
 
 struct rpc_bdev_enable_histogram_request {
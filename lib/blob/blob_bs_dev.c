@@ -179,7 +179,8 @@ blob_bs_is_zeroes(struct spdk_bs_dev *dev, uint64_t lba, uint64_t lba_count)
 	assert(lba == bs_cluster_to_lba(blob->bs, bs_lba_to_cluster(blob->bs, lba)));
 	assert(lba_count == bs_dev_byte_to_lba(dev, blob->bs->cluster_sz));
 
-	if (bs_io_unit_is_allocated(blob, lba)) {
+	if (bs_io_unit_is_allocated(blob, lba) ||
+	    bs_cluster_invalid_sub_clusters(blob, bs_io_unit_to_cluster_number(blob, lba)) != 0) {
 		return false;
 	}
 
@@ -223,9 +224,15 @@ blob_bs_translate_lba(struct spdk_bs_dev *dev, uint64_t lba, uint64_t *base_lba)
 	bool is_valid_range;
 
 	assert(base_lba != NULL);
+	if (bs_cluster_invalid_sub_clusters(blob, bs_io_unit_to_cluster_number(blob, lba)) != 0) {
+		/* Only a part of the cluster is in this blob */
+		return false;
+	}
+
 	if (bs_io_unit_is_allocated(blob, lba)) {
-		*base_lba = bs_blob_io_unit_to_lba(blob, lba);
-		return true;
+		/* The cluster is not looked up if its extent page is not in memory,
+		 * the data is then read through the blob instead. */
+		return bs_blob_io_unit_to_lba_resident(blob, lba, base_lba) && *base_lba != 0;
 	}
 
 	assert(blob->back_bs_dev != NULL);
@@ -7,6 +7,7 @@
 #include "spdk/stdinc.h"
 
 #include "spdk/blob.h"
+#include "spdk/barrier.h"
 #include "spdk/crc32.h"
 #include "spdk/env.h"
 #include "spdk/queue.h"
@@ -29,11 +30,11 @@
 static int bs_register_md_thread(struct spdk_blob_store *bs);
 static int bs_unregister_md_thread(struct spdk_blob_store *bs);
 static void blob_close_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
-static void blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
-		uint64_t cluster, uint32_t extent, struct spdk_blob_md_page *page,
-		spdk_blob_op_complete cb_fn, void *cb_arg);
+static void blob_insert_cluster_persist(struct spdk_blob *blob, struct spdk_io_channel *channel,
+					uint32_t cluster_num, uint64_t cluster, uint64_t sub_cluster_mask, uint32_t extent,
+					spdk_blob_op_complete mapped_fn, spdk_blob_op_complete cb_fn, void *cb_arg);
 static void blob_free_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
-		uint32_t extent_page, struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg);
+		uint32_t extent_page, spdk_blob_op_complete cb_fn, void *cb_arg);
 
 static int blob_set_xattr(struct spdk_blob *blob, const char *name, const void *value,
 			  uint16_t value_len, bool internal);
@@ -44,6 +45,8 @@ static int blob_remove_xattr(struct spdk_blob *blob, const char *name, bool inte
 static void blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
 				   struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg);
 static void blob_freeze_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg);
+static void blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg);
+static void blob_ep_segments_free(struct spdk_blob *blob);
 
 static void bs_shallow_copy_cluster_find_next(void *cb_arg);
 
@@ -156,18 +159,43 @@ bs_release_cluster(struct spdk_blob_store *bs, uint32_t cluster_num)
 	bs->num_free_clusters++;
 }
 
-static int
-blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
+/* Map a cluster of the blob to lba, or unmap it if lba is 0. Called with md_lock held. */
+static void
+blob_set_cluster_lba(struct spdk_blob *blob, uint64_t cluster_num, uint64_t lba)
 {
-	uint64_t *cluster_lba = &blob->active.clusters[cluster_num];
+	assert(spdk_spin_held(&blob->md_lock));
 
-	blob_verify_md_op(blob);
+	*bs_blob_cluster_lba(blob, cluster_num) = lba;
+	if (spdk_unlikely(blob->ep_on_demand)) {
+		/* I/O looks the cluster up once it finds it allocated, so map it first */
+		spdk_smp_wmb();
+		if (lba != 0) {
+			spdk_bit_array_set(blob->allocated_clusters, cluster_num);
+		} else {
+			spdk_bit_array_clear(blob->allocated_clusters, cluster_num);
+		}
+	}
+}
+
+static int
+blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster,
+		    uint64_t sub_cluster_mask)
+{
+	assert(spdk_spin_held(&blob->md_lock));
 
-	if (*cluster_lba != 0) {
+	if (*bs_blob_cluster_lba(blob, cluster_num) != 0) {
 		return -EEXIST;
 	}
 
-	*cluster_lba = bs_cluster_to_lba(blob->bs, cluster);
+	if (cluster_num < blob->num_sub_cluster_masks) {
+		/* I/O looks the mask up once it finds the cluster allocated, so set it first */
+		blob->sub_cluster_masks[cluster_num] = sub_cluster_mask;
+		spdk_smp_wmb();
+	} else {
+		assert(sub_cluster_mask == 0);
+	}
+
+	blob_set_cluster_lba(blob, cluster_num, bs_cluster_to_lba(blob->bs, cluster));
 	blob->active.num_allocated_clusters++;
 
 	return 0;
@@ -187,6 +215,7 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 		return -ENOSPC;
 	}
 
+	spdk_spin_lock(&blob->md_lock);
 	if (blob->use_extent_table) {
 		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
 		if (*extent_page == 0) {
@@ -199,6 +228,7 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 					       *lowest_free_md_page);
 			if (*lowest_free_md_page == UINT32_MAX) {
 				/* No more free md pages. Cannot satisfy the request */
+				spdk_spin_unlock(&blob->md_lock);
 				bs_release_cluster(blob->bs, *cluster);
 				return -ENOSPC;
 			}
@@ -210,11 +240,113 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 		      blob->id);
 
 	if (update_map) {
-		blob_insert_cluster(blob, cluster_num, *cluster);
+		blob_insert_cluster(blob, cluster_num, *cluster, 0);
 		if (blob->use_extent_table && *extent_page == 0) {
 			*extent_page = *lowest_free_md_page;
 		}
 	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	return 0;
+}
+
+static void
+bs_channel_reserve_clusters(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	uint32_t batch, cluster;
+
+	assert(ch->cluster_cache_idx == ch->num_cached_clusters);
+	ch->cluster_cache_idx = 0;
+	ch->num_cached_clusters = 0;
+
+	spdk_spin_lock(&bs->used_lock);
+
+	/* Reserve less as the blobstore fills up, so that channels do not hold on to the
+	 * last free clusters.
+	 */
+	batch = spdk_max(spdk_min(bs->num_free_clusters / SPDK_BS_CHANNEL_CLUSTER_BATCH,
+				  SPDK_BS_CHANNEL_CLUSTER_BATCH), 1);
+
+	while (ch->num_cached_clusters < batch) {
+		cluster = bs_claim_cluster(bs);
+		if (cluster == UINT32_MAX) {
+			break;
+		}
+		ch->cluster_cache[ch->num_cached_clusters++] = cluster;
+	}
+
+	if (ch->num_cached_clusters > 0) {
+		__atomic_fetch_add(&bs->num_reserved_clusters, ch->num_cached_clusters, __ATOMIC_RELAXED);
+		bs->cluster_reserve_gen++;
+	}
+
+	spdk_spin_unlock(&bs->used_lock);
+}
+
+static void
+bs_channel_release_clusters(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+
+	if (ch->cluster_cache_idx == ch->num_cached_clusters) {
+		return;
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+	__atomic_fetch_sub(&bs->num_reserved_clusters, ch->num_cached_clusters - ch->cluster_cache_idx,
+			   __ATOMIC_RELAXED);
+	while (ch->cluster_cache_idx < ch->num_cached_clusters) {
+		bs_release_cluster(bs, ch->cluster_cache[ch->cluster_cache_idx++]);
+	}
+	spdk_spin_unlock(&bs->used_lock);
+}
+
+/*
+ * Allocate a cluster for a first write to a thin provisioned blob from the clusters reserved
+ * by the channel. used_lock is taken only to refill the reservation and to claim a new extent
+ * page.
+ */
+static int
+bs_channel_allocate_cluster(struct spdk_bs_channel *ch, struct spdk_blob *blob,
+			    uint32_t cluster_num, uint64_t *cluster, uint32_t *lowest_free_md_page)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint32_t *extent_page;
+
+	if (ch->cluster_cache_idx == ch->num_cached_clusters) {
+		bs_channel_reserve_clusters(ch);
+		if (ch->num_cached_clusters == 0) {
+			/* No more free clusters. Cannot satisfy the request */
+			return -ENOSPC;
+		}
+	}
+
+	if (blob->use_extent_table) {
+		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
+		if (*extent_page == 0) {
+			/* Extent page shall never occupy md_page so start the search from 1 */
+			if (*lowest_free_md_page == 0) {
+				*lowest_free_md_page = 1;
+			}
+			spdk_spin_lock(&bs->used_lock);
+			*lowest_free_md_page = spdk_bit_array_find_first_clear(bs->used_md_pages,
+					       *lowest_free_md_page);
+			if (*lowest_free_md_page == UINT32_MAX) {
+				/* No more free md pages. Cannot satisfy the request */
+				spdk_spin_unlock(&bs->used_lock);
+				return -ENOSPC;
+			}
+			bs_claim_md_page(bs, *lowest_free_md_page);
+			spdk_spin_unlock(&bs->used_lock);
+		}
+	}
+
+	*cluster = ch->cluster_cache[ch->cluster_cache_idx++];
+	__atomic_fetch_sub(&bs->num_reserved_clusters, 1, __ATOMIC_RELAXED);
+
+	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob 0x%" PRIx64 "\n", *cluster,
+		      blob->id);
 
 	return 0;
 }
@@ -261,6 +393,7 @@ spdk_blob_opts_init(struct spdk_blob_opts *opts, size_t opts_size)
 	}
 
 	SET_FIELD(use_extent_table, true);
+	SET_FIELD(sub_cluster_sz, 0);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -327,6 +460,12 @@ blob_alloc(struct spdk_blob_store *bs, spdk_blob_id id)
 	TAILQ_INIT(&blob->xattrs_internal);
 	TAILQ_INIT(&blob->pending_persists);
 	TAILQ_INIT(&blob->persists_to_complete);
+	TAILQ_INIT(&blob->sub_cluster_fills);
+	TAILQ_INIT(&blob->sub_cluster_fill_waiters);
+	TAILQ_INIT(&blob->ep_flushes);
+	TAILQ_INIT(&blob->free_ep_flushes);
+	TAILQ_INIT(&blob->ep_flush_waiters);
+	spdk_spin_init(&blob->md_lock);
 
 	return blob;
 }
@@ -351,12 +490,39 @@ blob_unref_back_bs_dev(struct spdk_blob *blob)
 	blob->back_bs_dev = NULL;
 }
 
+struct spdk_blob_ep_flush {
+	struct spdk_blob			*blob;
+	uint32_t				extent;
+	uint64_t				cluster_num;
+	struct spdk_blob_md_page		*page;
+
+	/* Channel of the first cluster op in writing, the write is issued on its thread */
+	struct spdk_io_channel			*channel;
+
+	/* Cluster ops persisted by the write in progress, and by the next one */
+	TAILQ_HEAD(, spdk_blob_cluster_op_ctx)	writing;
+	TAILQ_HEAD(, spdk_blob_cluster_op_ctx)	queued;
+
+	TAILQ_ENTRY(spdk_blob_ep_flush)		link;
+};
+
 static void
 blob_free(struct spdk_blob *blob)
 {
+	struct spdk_blob_ep_flush *flush;
+
 	assert(blob != NULL);
 	assert(TAILQ_EMPTY(&blob->pending_persists));
 	assert(TAILQ_EMPTY(&blob->persists_to_complete));
+	assert(TAILQ_EMPTY(&blob->ep_flushes));
+
+	while ((flush = TAILQ_FIRST(&blob->free_ep_flushes)) != NULL) {
+		TAILQ_REMOVE(&blob->free_ep_flushes, flush, link);
+		spdk_free(flush->page);
+		free(flush);
+	}
+	blob_ep_segments_free(blob);
+	spdk_spin_destroy(&blob->md_lock);
 
 	free(blob->active.extent_pages);
 	free(blob->clean.extent_pages);
@@ -364,6 +530,7 @@ blob_free(struct spdk_blob *blob)
 	free(blob->clean.clusters);
 	free(blob->active.pages);
 	free(blob->clean.pages);
+	free(blob->sub_cluster_masks);
 
 	xattrs_free(&blob->xattrs);
 	xattrs_free(&blob->xattrs_internal);
@@ -480,6 +647,7 @@ blob_set_back_bs_dev(struct spdk_blob *blob, struct spdk_bs_dev *back_bs_dev,
 struct freeze_io_ctx {
 	struct spdk_bs_cpl cpl;
 	struct spdk_blob *blob;
+	TAILQ_ENTRY(freeze_io_ctx) link;
 };
 
 static void
@@ -512,15 +680,40 @@ blob_execute_queued_io(struct spdk_io_channel_iter *i)
 }
 
 static void
-blob_io_cpl(struct spdk_io_channel_iter *i, int status)
+blob_io_done(void *arg)
 {
-	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct freeze_io_ctx *ctx = arg;
 
 	ctx->cpl.u.blob_basic.cb_fn(ctx->cpl.u.blob_basic.cb_arg, 0);
 
 	free(ctx);
 }
 
+static void
+blob_io_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	blob_io_done(spdk_io_channel_iter_get_ctx(i));
+}
+
+static void
+blob_freeze_io_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob *blob = ctx->blob;
+
+	/* Extent pages may still be written by the threads that inserted clusters before the
+	 * freeze. Wait for them, so that the metadata of a frozen blob is only updated here. */
+	spdk_spin_lock(&blob->md_lock);
+	if (!TAILQ_EMPTY(&blob->ep_flushes)) {
+		TAILQ_INSERT_TAIL(&blob->ep_flush_waiters, ctx, link);
+		spdk_spin_unlock(&blob->md_lock);
+		return;
+	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	blob_io_done(ctx);
+}
+
 static void
 blob_freeze_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
@@ -542,7 +735,7 @@ blob_freeze_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg
 	/* Freeze I/O on blob */
 	blob->frozen_refcnt++;
 
-	spdk_for_each_channel(blob->bs, blob_io_sync, ctx, blob_io_cpl);
+	spdk_for_each_channel(blob->bs, blob_io_sync, ctx, blob_freeze_io_cpl);
 }
 
 static void
@@ -585,18 +778,16 @@ blob_mark_clean(struct spdk_blob *blob)
 		if (!extent_pages) {
 			return -ENOMEM;
 		}
-		memcpy(extent_pages, blob->active.extent_pages,
-		       blob->active.num_extent_pages * sizeof(*extent_pages));
 	}
 
-	if (blob->active.num_clusters) {
+	/* The cluster map of a blob that loads its extent pages on demand is in its extent pages */
+	if (blob->active.num_clusters && !blob->ep_on_demand) {
 		assert(blob->active.clusters);
 		clusters = calloc(blob->active.num_clusters, sizeof(*blob->active.clusters));
 		if (!clusters) {
 			free(extent_pages);
 			return -ENOMEM;
 		}
-		memcpy(clusters, blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
 	}
 
 	if (blob->active.num_pages) {
@@ -614,6 +805,16 @@ blob_mark_clean(struct spdk_blob *blob)
 	free(blob->clean.clusters);
 	free(blob->clean.pages);
 
+	/* Clusters may be inserted by other threads while the arrays are copied and swapped */
+	spdk_spin_lock(&blob->md_lock);
+	if (extent_pages != NULL) {
+		memcpy(extent_pages, blob->active.extent_pages,
+		       blob->active.num_extent_pages * sizeof(*extent_pages));
+	}
+	if (clusters != NULL) {
+		memcpy(clusters, blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
+	}
+
 	blob->clean.num_extent_pages = blob->active.num_extent_pages;
 	blob->clean.extent_pages = blob->active.extent_pages;
 	blob->clean.num_clusters = blob->active.num_clusters;
@@ -625,6 +826,7 @@ blob_mark_clean(struct spdk_blob *blob)
 	blob->active.extent_pages = extent_pages;
 	blob->active.clusters = clusters;
 	blob->active.pages = pages;
+	spdk_spin_unlock(&blob->md_lock);
 
 	/* If the metadata was dirtied again while the metadata was being written to disk,
 	 *  we do not want to revert the DIRTY state back to CLEAN here.
@@ -679,6 +881,21 @@ blob_deserialize_xattr(struct spdk_blob *blob,
 }
 
 
+static bool
+bs_sub_cluster_sz_is_valid(struct spdk_blob_store *bs, uint64_t sub_cluster_sz)
+{
+	return sub_cluster_sz != 0 && sub_cluster_sz % bs->io_unit_size == 0 &&
+	       bs->cluster_sz % sub_cluster_sz == 0 && bs->cluster_sz / sub_cluster_sz <= 64;
+}
+
+static uint64_t
+bs_sub_cluster_full_mask(struct spdk_blob *blob)
+{
+	uint64_t num_sub_clusters = blob->bs->io_units_per_cluster / blob->io_units_per_sub_cluster;
+
+	return num_sub_clusters == 64 ? UINT64_MAX : (1ULL << num_sub_clusters) - 1;
+}
+
 static int
 blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 {
@@ -901,6 +1118,58 @@ blob_parse_page(const struct spdk_blob_md_page *page, struct spdk_blob *blob)
 			assert(desc_extent->start_cluster_idx + cluster_count == blob->active.num_clusters);
 			assert(blob->remaining_clusters_in_et >= cluster_count);
 			blob->remaining_clusters_in_et -= cluster_count;
+		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_SUB_CLUSTERS) {
+			struct spdk_blob_md_descriptor_sub_clusters	*desc_sub;
+			uint64_t					io_units_per_sub_cluster;
+			uint64_t					num_masks;
+			size_t						entries_length;
+			unsigned int					i;
+
+			desc_sub = (struct spdk_blob_md_descriptor_sub_clusters *)desc;
+			if (desc_sub->length < SPDK_MD_SUB_CLUSTERS_HDR_LENGTH) {
+				return -EINVAL;
+			}
+
+			entries_length = desc_sub->length - SPDK_MD_SUB_CLUSTERS_HDR_LENGTH;
+			if (entries_length % sizeof(desc_sub->clusters[0]) != 0) {
+				return -EINVAL;
+			}
+
+			if (!bs_sub_cluster_sz_is_valid(blob->bs, desc_sub->sub_cluster_sz)) {
+				return -EINVAL;
+			}
+
+			io_units_per_sub_cluster = desc_sub->sub_cluster_sz / blob->bs->io_unit_size;
+			if (blob->io_units_per_sub_cluster != 0 &&
+			    blob->io_units_per_sub_cluster != io_units_per_sub_cluster) {
+				/* All descriptors of a blob have the same sub-cluster size */
+				return -EINVAL;
+			}
+			blob->io_units_per_sub_cluster = io_units_per_sub_cluster;
+
+			/* The map is sized to the blob later, once all of its clusters are known */
+			num_masks = blob->num_sub_cluster_masks;
+			for (i = 0; i < entries_length / sizeof(desc_sub->clusters[0]); i++) {
+				num_masks = spdk_max(num_masks, (uint64_t)desc_sub->clusters[i].cluster_idx + 1);
+			}
+
+			if (num_masks > blob->num_sub_cluster_masks) {
+				tmp = realloc(blob->sub_cluster_masks,
+					      num_masks * sizeof(*blob->sub_cluster_masks));
+				if (tmp == NULL) {
+					return -ENOMEM;
+				}
+				blob->sub_cluster_masks = tmp;
+				memset(blob->sub_cluster_masks + blob->num_sub_cluster_masks, 0,
+				       (num_masks - blob->num_sub_cluster_masks) *
+				       sizeof(*blob->sub_cluster_masks));
+				blob->num_sub_cluster_masks = num_masks;
+			}
+
+			for (i = 0; i < entries_length / sizeof(desc_sub->clusters[0]); i++) {
+				blob->sub_cluster_masks[desc_sub->clusters[i].cluster_idx] =
+					desc_sub->clusters[i].invalid_mask;
+			}
 		} else if (desc->type == SPDK_MD_DESCRIPTOR_TYPE_XATTR) {
 			int rc;
 
@@ -1279,7 +1548,7 @@ blob_serialize_extent_page(const struct spdk_blob *blob,
 	desc_extent->start_cluster_idx = start_cluster_idx;
 	extent_idx = 0;
 	for (i = start_cluster_idx; i < blob->active.num_clusters; i++) {
-		lba = blob->active.clusters[i];
+		lba = *bs_blob_cluster_lba(blob, i);
 		desc_extent->cluster_idx[extent_idx++] = lba / lba_per_cluster;
 		if (extent_idx >= SPDK_EXTENTS_PER_EP) {
 			break;
@@ -1289,6 +1558,87 @@ blob_serialize_extent_page(const struct spdk_blob *blob,
 			      sizeof(desc_extent->cluster_idx[0]) * extent_idx;
 }
 
+static bool
+blob_serialize_sub_clusters_entry(const struct spdk_blob *blob,
+				  uint64_t start_cluster, uint64_t *next_cluster,
+				  uint8_t **buf, size_t *remaining_sz)
+{
+	struct spdk_blob_md_descriptor_sub_clusters *desc;
+	size_t cur_sz;
+	uint64_t i;
+	uint32_t idx;
+
+	/* The buffer must have room for at least the sub-cluster size */
+	cur_sz = sizeof(struct spdk_blob_md_descriptor) + SPDK_MD_SUB_CLUSTERS_HDR_LENGTH;
+	if (*remaining_sz < cur_sz) {
+		*next_cluster = start_cluster;
+		return false;
+	}
+
+	desc = (struct spdk_blob_md_descriptor_sub_clusters *)*buf;
+	desc->type = SPDK_MD_DESCRIPTOR_TYPE_SUB_CLUSTERS;
+	desc->sub_cluster_sz = blob->io_units_per_sub_cluster * blob->bs->io_unit_size;
+
+	idx = 0;
+	for (i = start_cluster; i < blob->active.num_clusters; i++) {
+		if (blob->sub_cluster_masks[i] == 0) {
+			continue;
+		}
+
+		if (*remaining_sz < cur_sz + sizeof(desc->clusters[0])) {
+			/* If we ran out of buffer space, return */
+			break;
+		}
+
+		desc->clusters[idx].cluster_idx = i;
+		desc->clusters[idx].invalid_mask = blob->sub_cluster_masks[i];
+		idx++;
+		cur_sz += sizeof(desc->clusters[0]);
+	}
+	*next_cluster = i;
+
+	desc->length = SPDK_MD_SUB_CLUSTERS_HDR_LENGTH + sizeof(desc->clusters[0]) * idx;
+	*remaining_sz -= sizeof(struct spdk_blob_md_descriptor) + desc->length;
+	*buf += sizeof(struct spdk_blob_md_descriptor) + desc->length;
+
+	return true;
+}
+
+static int
+blob_serialize_sub_clusters(const struct spdk_blob *blob,
+			    struct spdk_blob_md_page **pages,
+			    struct spdk_blob_md_page *cur_page,
+			    uint32_t *page_count, uint8_t **buf,
+			    size_t *remaining_sz)
+{
+	uint64_t	last_cluster;
+	bool		written;
+	int		rc;
+
+	assert(blob->num_sub_cluster_masks >= blob->active.num_clusters);
+
+	/* At least single descriptor has to be always persisted, it holds the sub-cluster size */
+	last_cluster = 0;
+	while (true) {
+		written = blob_serialize_sub_clusters_entry(blob, last_cluster, &last_cluster, buf,
+				remaining_sz);
+
+		if (written && last_cluster == blob->active.num_clusters) {
+			break;
+		}
+
+		rc = blob_serialize_add_page(blob, pages, page_count, &cur_page);
+		if (rc < 0) {
+			return rc;
+		}
+
+		*buf = (uint8_t *)cur_page->descriptors;
+		*remaining_sz = sizeof(cur_page->descriptors);
+	}
+
+	return 0;
+}
+
 static void
 blob_serialize_flags(const struct spdk_blob *blob,
 		     uint8_t *buf, size_t *buf_sz)
@@ -1415,6 +1765,11 @@ blob_serialize(const struct spdk_blob *blob, struct spdk_blob_md_page **pages,
 		rc = blob_serialize_extents_rle(blob, pages, cur_page, page_count, &buf, &remaining_sz);
 	}
 
+	if (rc == 0 && blob->io_units_per_sub_cluster != 0) {
+		/* Serialize masks of partially copied clusters */
+		rc = blob_serialize_sub_clusters(blob, pages, cur_page, page_count, &buf, &remaining_sz);
+	}
+
 	return rc;
 }
 
@@ -1426,6 +1781,11 @@ struct spdk_blob_load_ctx {
 	uint32_t			next_extent_page;
 	spdk_bs_sequence_t	        *seq;
 
+	/* First extent page read by the last batch, and the clusters of one that is not kept in
+	 * memory, when the extent pages of the blob are loaded on demand */
+	uint32_t			ep_batch_start;
+	uint64_t			*ep_clusters;
+
 	spdk_bs_sequence_cpl		cb_fn;
 	void				*cb_arg;
 };
@@ -1443,693 +1803,1485 @@ blob_md_page_calc_crc(void *page)
 
 }
 
-static void
-blob_load_final(struct spdk_blob_load_ctx *ctx, int bserrno)
+/* START extent pages loaded on demand */
+
+/*
+ * With spdk_bs_opts.extent_page_cache_size set, the cluster map of a blob that uses an extent
+ * table is not kept in memory once the blob is opened. Each extent page is kept in a segment,
+ * which is read from disk when I/O needs it and pinned until that I/O completes. Segments that
+ * are not pinned are kept in a list shared by all the blobs of the blobstore, and the least
+ * recently used ones are evicted once there are more than extent_page_cache_size of them.
+ * The clusters that are allocated are tracked in a bit array, so that I/O that only needs to
+ * know that does not have to read the extent pages.
+ *
+ * Metadata operations that walk the cluster map read all the extent pages of the blob first,
+ * and keep its cluster map in active.clusters until it is closed.
+ */
+
+/* Number of extent pages read at once when a blob is opened */
+#define SPDK_BLOB_EP_LOAD_BATCH	32
+
+struct spdk_blob_ep_waiter {
+	struct spdk_thread		*thread;
+	spdk_blob_op_complete		cb_fn;
+	void				*cb_arg;
+	int				bserrno;
+	TAILQ_ENTRY(spdk_blob_ep_waiter) link;
+};
+
+/* Parse the extent page of the segment index of a blob that loads its extent pages on demand */
+static int
+blob_parse_ep_segment(struct spdk_blob *blob, struct spdk_blob_md_page *page, uint64_t index,
+		      uint64_t *clusters)
 {
-	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_md_descriptor_extent_page *desc_extent;
+	uint64_t start_cluster_idx = index * SPDK_EXTENTS_PER_EP;
+	size_t cluster_idx_length;
+	uint64_t cluster_count, i;
 
-	if (bserrno == 0) {
-		blob_mark_clean(blob);
+	if (page->next != SPDK_INVALID_MD_PAGE || !bs_load_cur_extent_page_valid(page)) {
+		return -EINVAL;
 	}
 
-	ctx->cb_fn(ctx->seq, ctx->cb_arg, bserrno);
+	desc_extent = (struct spdk_blob_md_descriptor_extent_page *)page->descriptors;
+	if (desc_extent->length <= sizeof(desc_extent->start_cluster_idx)) {
+		return -EINVAL;
+	}
+	cluster_idx_length = desc_extent->length - sizeof(desc_extent->start_cluster_idx);
+	if (cluster_idx_length % sizeof(desc_extent->cluster_idx[0]) != 0) {
+		return -EINVAL;
+	}
 
-	/* Free the memory */
-	spdk_free(ctx->pages);
-	free(ctx);
+	cluster_count = cluster_idx_length / sizeof(desc_extent->cluster_idx[0]);
+	if (desc_extent->start_cluster_idx != start_cluster_idx ||
+	    cluster_count != spdk_min(SPDK_EXTENTS_PER_EP,
+				      blob->active.num_clusters - start_cluster_idx)) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < cluster_count; i++) {
+		if (desc_extent->cluster_idx[i] != 0) {
+			clusters[i] = bs_cluster_to_lba(blob->bs, desc_extent->cluster_idx[i]);
+		} else if (spdk_blob_is_thin_provisioned(blob)) {
+			clusters[i] = 0;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
 }
 
-static void
-blob_load_snapshot_cpl(void *cb_arg, struct spdk_blob *snapshot, int bserrno)
+static struct spdk_blob_ep_segment *
+blob_ep_segment_alloc(struct spdk_blob *blob, uint64_t index)
 {
-	struct spdk_blob_load_ctx	*ctx = cb_arg;
-	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_ep_segment *segment;
 
-	if (bserrno == 0) {
-		blob->back_bs_dev = bs_create_blob_bs_dev(snapshot);
-		if (blob->back_bs_dev == NULL) {
-			bserrno = -ENOMEM;
-		}
-	}
-	if (bserrno != 0) {
-		SPDK_ERRLOG("Snapshot fail\n");
+	segment = calloc(1, sizeof(*segment) + SPDK_EXTENTS_PER_EP * sizeof(segment->clusters[0]));
+	if (segment == NULL) {
+		return NULL;
 	}
 
-	blob_load_final(ctx, bserrno);
-}
+	segment->blob = blob;
+	segment->index = index;
+	TAILQ_INIT(&segment->waiters);
 
-static void blob_update_clear_method(struct spdk_blob *blob);
+	return segment;
+}
 
-static int
-blob_load_esnap(struct spdk_blob *blob, void *blob_ctx)
+/* Evict the least recently used segments over the limit. Called with ep_cache_lock held. */
+static void
+bs_ep_cache_evict(struct spdk_blob_store *bs)
 {
-	struct spdk_blob_store *bs = blob->bs;
-	struct spdk_bs_dev *bs_dev = NULL;
-	const void *esnap_id = NULL;
-	size_t id_len = 0;
-	int rc;
+	struct spdk_blob_ep_segment *segment;
 
-	if (bs->esnap_bs_dev_create == NULL) {
-		SPDK_NOTICELOG("blob 0x%" PRIx64 " is an esnap clone but the blobstore was opened "
-			       "without support for esnap clones\n", blob->id);
-		return -ENOTSUP;
-	}
-	assert(blob->back_bs_dev == NULL);
+	assert(spdk_spin_held(&bs->ep_cache_lock));
 
-	rc = blob_get_xattr_value(blob, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id, &id_len, true);
-	if (rc != 0) {
-		SPDK_ERRLOG("blob 0x%" PRIx64 " is an esnap clone but has no esnap ID\n", blob->id);
-		return -EINVAL;
+	while (bs->ep_cache_num_pages > bs->ep_cache_size) {
+		segment = TAILQ_FIRST(&bs->ep_lru);
+		if (segment == NULL) {
+			/* All the others are pinned */
+			break;
+		}
+
+		TAILQ_REMOVE(&bs->ep_lru, segment, lru_link);
+		segment->blob->ep_segments[segment->index] = NULL;
+		bs->ep_cache_num_pages--;
+		bs->ep_cache_evictions++;
+		free(segment);
 	}
-	assert(id_len > 0 && id_len < UINT32_MAX);
+}
 
-	SPDK_INFOLOG(blob, "Creating external snapshot device\n");
+/*
+ * Pin the segment of a cluster of a blob in memory. Returns -ENOENT if the extent page has to be
+ * read first, see blob_ep_segment_load(). *_segment is set to NULL if the blob does not load its
+ * extent pages on demand, and nothing has to be pinned. count_hit is false for pins which are not
+ * a first lookup of the extent page, so that they are not counted as cache hits.
+ */
+static int
+blob_ep_segment_pin(struct spdk_blob *blob, uint64_t cluster_num, bool count_hit,
+		    struct spdk_blob_ep_segment **_segment)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t index = bs_cluster_to_extent_table_id(cluster_num);
+	struct spdk_blob_ep_segment *segment;
 
-	rc = bs->esnap_bs_dev_create(bs->esnap_ctx, blob_ctx, blob, esnap_id, (uint32_t)id_len,
-				     &bs_dev);
-	if (rc != 0) {
-		SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": failed to load back_bs_dev "
-			      "with error %d\n", blob->id, rc);
-		return rc;
+	*_segment = NULL;
+
+	spdk_spin_lock(&bs->ep_cache_lock);
+	if (!blob->ep_on_demand) {
+		spdk_spin_unlock(&bs->ep_cache_lock);
+		return 0;
 	}
 
-	/*
-	 * Note: bs_dev might be NULL if the consumer chose to not open the external snapshot.
-	 * This especially might happen during spdk_bs_load() iteration.
-	 */
-	if (bs_dev != NULL) {
-		SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": loaded back_bs_dev\n", blob->id);
-		if ((bs->io_unit_size % bs_dev->blocklen) != 0) {
-			SPDK_NOTICELOG("blob 0x%" PRIx64 " external snapshot device block size %u "
-				       "is not compatible with blobstore block size %u\n",
-				       blob->id, bs_dev->blocklen, bs->io_unit_size);
-			bs_dev->destroy(bs_dev);
-			return -EINVAL;
+	segment = blob->ep_segments[index];
+	if (segment == NULL && blob->active.extent_pages[index] == 0) {
+		/* No cluster of the extent page is allocated, there is nothing to read */
+		segment = blob_ep_segment_alloc(blob, index);
+		if (segment == NULL) {
+			spdk_spin_unlock(&bs->ep_cache_lock);
+			return -ENOMEM;
 		}
+		segment->loaded = true;
+		blob->ep_segments[index] = segment;
+		bs->ep_cache_num_pages++;
+	} else if (segment == NULL || !segment->loaded) {
+		spdk_spin_unlock(&bs->ep_cache_lock);
+		return -ENOENT;
+	} else if (segment->pin_cnt == 0) {
+		TAILQ_REMOVE(&bs->ep_lru, segment, lru_link);
 	}
 
-	blob->back_bs_dev = bs_dev;
-	blob->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+	segment->pin_cnt++;
+	if (count_hit && blob->active.extent_pages[index] != 0) {
+		/* Extent pages that were never written are not read, nor cached */
+		bs->ep_cache_hits++;
+	}
+	spdk_spin_unlock(&bs->ep_cache_lock);
 
+	*_segment = segment;
 	return 0;
 }
 
-static void
-blob_load_backing_dev(spdk_bs_sequence_t *seq, void *cb_arg)
+void
+bs_ep_segment_unpin(struct spdk_blob_ep_segment *segment)
 {
-	struct spdk_blob_load_ctx	*ctx = cb_arg;
-	struct spdk_blob		*blob = ctx->blob;
-	const void			*value;
-	size_t				len;
-	int				rc;
+	struct spdk_blob *blob;
+	struct spdk_blob_store *bs;
 
-	if (blob_is_esnap_clone(blob)) {
-		rc = blob_load_esnap(blob, seq->cpl.u.blob_handle.esnap_ctx);
-		blob_load_final(ctx, rc);
+	if (segment == NULL) {
 		return;
 	}
 
-	if (spdk_blob_is_thin_provisioned(blob)) {
-		rc = blob_get_xattr_value(blob, BLOB_SNAPSHOT, &value, &len, true);
-		if (rc == 0) {
-			if (len != sizeof(spdk_blob_id)) {
-				blob_load_final(ctx, -EINVAL);
-				return;
-			}
-			/* open snapshot blob and continue in the callback function */
-			blob->parent_id = *(spdk_blob_id *)value;
-			spdk_bs_open_blob(blob->bs, blob->parent_id,
-					  blob_load_snapshot_cpl, ctx);
-			return;
+	blob = segment->blob;
+	bs = blob->bs;
+
+	spdk_spin_lock(&bs->ep_cache_lock);
+	assert(segment->pin_cnt > 0);
+	if (--segment->pin_cnt == 0) {
+		if (segment->detached) {
+			blob->ep_segments[segment->index] = NULL;
+			free(segment);
 		} else {
-			/* add zeroes_dev for thin provisioned blob */
-			blob->back_bs_dev = bs_create_zeroes_dev();
+			TAILQ_INSERT_TAIL(&bs->ep_lru, segment, lru_link);
+			bs_ep_cache_evict(bs);
 		}
-	} else {
-		/* standard blob */
-		blob->back_bs_dev = NULL;
 	}
-	blob_load_final(ctx, 0);
+	spdk_spin_unlock(&bs->ep_cache_lock);
 }
 
 static void
-blob_load_cpl_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_ep_waiter_wake(void *arg)
 {
-	struct spdk_blob_load_ctx	*ctx = cb_arg;
-	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_md_page	*page;
-	uint64_t			i;
-	uint32_t			crc;
-	uint64_t			lba;
-	void				*tmp;
-	uint64_t			sz;
+	struct spdk_blob_ep_waiter *waiter = arg;
 
-	if (bserrno) {
-		SPDK_ERRLOG("Extent page read failed: %d\n", bserrno);
-		blob_load_final(ctx, bserrno);
-		return;
-	}
+	waiter->cb_fn(waiter->cb_arg, waiter->bserrno);
+	free(waiter);
+}
 
-	if (ctx->pages == NULL) {
-		/* First iteration of this function, allocate buffer for single EXTENT_PAGE */
-		ctx->pages = spdk_zmalloc(blob->bs->md_page_size, 0,
-					  NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
-		if (!ctx->pages) {
-			blob_load_final(ctx, -ENOMEM);
-			return;
-		}
-		ctx->num_pages = 1;
-		ctx->next_extent_page = 0;
-	} else {
-		page = &ctx->pages[0];
-		crc = blob_md_page_calc_crc(page);
-		if (crc != page->crc) {
-			blob_load_final(ctx, -EINVAL);
-			return;
-		}
+static void
+blob_ep_segment_read_done(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_ep_segment *segment = cb_arg;
+	struct spdk_blob *blob = segment->blob;
+	struct spdk_blob_store *bs = blob->bs;
+	TAILQ_HEAD(, spdk_blob_ep_waiter) waiters;
+	struct spdk_blob_ep_waiter *waiter;
 
-		if (page->next != SPDK_INVALID_MD_PAGE) {
-			blob_load_final(ctx, -EINVAL);
-			return;
-		}
+	spdk_free(segment->page);
+	segment->page = NULL;
 
-		bserrno = blob_parse_extent_page(page, blob);
-		if (bserrno) {
-			blob_load_final(ctx, bserrno);
-			return;
-		}
-	}
+	TAILQ_INIT(&waiters);
 
-	for (i = ctx->next_extent_page; i < blob->active.num_extent_pages; i++) {
-		if (blob->active.extent_pages[i] != 0) {
-			/* Extent page was allocated, read and parse it. */
-			lba = bs_md_page_to_lba(blob->bs, blob->active.extent_pages[i]);
-			ctx->next_extent_page = i + 1;
+	spdk_spin_lock(&bs->ep_cache_lock);
+	TAILQ_SWAP(&segment->waiters, &waiters, spdk_blob_ep_waiter, link);
+	if (bserrno == 0) {
+		/* The waiters pin it once they are woken up */
+		segment->loaded = true;
+		TAILQ_INSERT_TAIL(&bs->ep_lru, segment, lru_link);
+	} else {
+		blob->ep_segments[segment->index] = NULL;
+		bs->ep_cache_num_pages--;
+	}
+	spdk_spin_unlock(&bs->ep_cache_lock);
 
-			bs_sequence_read_dev(seq, &ctx->pages[0], lba,
-					     bs_byte_to_lba(blob->bs, blob->bs->md_page_size),
-					     blob_load_cpl_extents_cpl, ctx);
-			return;
-		} else {
-			/* Thin provisioned blobs can point to unallocated extent pages.
-			 * In this case blob size should be increased by up to the amount left in remaining_clusters_in_et. */
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to read extent page %" PRIu64 " of blob 0x%" PRIx64 ": %d\n",
+			    segment->index, blob->id, bserrno);
+		free(segment);
+	}
 
-			sz = spdk_min(blob->remaining_clusters_in_et, SPDK_EXTENTS_PER_EP);
-			blob->active.num_clusters += sz;
-			blob->remaining_clusters_in_et -= sz;
+	while ((waiter = TAILQ_FIRST(&waiters)) != NULL) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->bserrno = bserrno;
+		spdk_thread_send_msg(waiter->thread, blob_ep_waiter_wake, waiter);
+	}
+}
 
-			assert(spdk_blob_is_thin_provisioned(blob));
-			assert(i + 1 < blob->active.num_extent_pages || blob->remaining_clusters_in_et == 0);
+static void
+blob_ep_segment_read_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_ep_segment *segment = cb_arg;
 
-			tmp = realloc(blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
-			if (tmp == NULL) {
-				blob_load_final(ctx, -ENOMEM);
-				return;
-			}
-			memset(tmp + sizeof(*blob->active.clusters) * blob->active.cluster_array_size, 0,
-			       sizeof(*blob->active.clusters) * (blob->active.num_clusters - blob->active.cluster_array_size));
-			blob->active.clusters = tmp;
-			blob->active.cluster_array_size = blob->active.num_clusters;
-		}
+	if (bserrno == 0) {
+		bserrno = blob_parse_ep_segment(segment->blob, segment->page, segment->index,
+						segment->clusters);
 	}
 
-	blob_load_backing_dev(seq, ctx);
+	bs_sequence_finish(seq, bserrno);
 }
 
+/*
+ * Read the extent page of a cluster of a blob into memory. cb_fn is called on the current thread
+ * once the segment of the cluster can be pinned, or the read failed. The channel must belong to
+ * the current thread.
+ */
 static void
-blob_load_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_ep_segment_load(struct spdk_blob *blob, struct spdk_io_channel *channel, uint64_t cluster_num,
+		     spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	struct spdk_blob_load_ctx	*ctx = cb_arg;
-	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_md_page	*page;
-	int				rc;
-	uint32_t			crc;
-	uint32_t			current_page;
-
-	if (ctx->num_pages == 1) {
-		current_page = bs_blobid_to_page(blob->id);
-	} else {
-		assert(ctx->num_pages != 0);
-		page = &ctx->pages[ctx->num_pages - 2];
-		current_page = page->next;
-	}
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t index = bs_cluster_to_extent_table_id(cluster_num);
+	struct spdk_blob_ep_segment *segment = NULL;
+	struct spdk_blob_ep_waiter *waiter;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_sequence_t *seq;
+	uint32_t extent_page = 0;
 
-	if (bserrno) {
-		SPDK_ERRLOG("Metadata page %d read failed for blobid 0x%" PRIx64 ": %d\n",
-			    current_page, blob->id, bserrno);
-		blob_load_final(ctx, bserrno);
+	waiter = calloc(1, sizeof(*waiter));
+	if (waiter == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
+	waiter->thread = spdk_get_thread();
+	waiter->cb_fn = cb_fn;
+	waiter->cb_arg = cb_arg;
 
-	page = &ctx->pages[ctx->num_pages - 1];
-	crc = blob_md_page_calc_crc(page);
-	if (crc != page->crc) {
-		SPDK_ERRLOG("Metadata page %d crc mismatch for blobid 0x%" PRIx64 "\n",
-			    current_page, blob->id);
-		blob_load_final(ctx, -EINVAL);
-		return;
+	spdk_spin_lock(&bs->ep_cache_lock);
+	if (blob->ep_on_demand) {
+		segment = blob->ep_segments[index];
+		extent_page = blob->active.extent_pages[index];
 	}
-
-	if (page->next != SPDK_INVALID_MD_PAGE) {
-		struct spdk_blob_md_page *tmp_pages;
-		uint32_t next_page = page->next;
-		uint64_t next_lba = bs_md_page_to_lba(blob->bs, next_page);
-
-		/* Read the next page */
-		tmp_pages = spdk_realloc(ctx->pages, (sizeof(*page) * (ctx->num_pages + 1)), 0);
-		if (tmp_pages == NULL) {
-			blob_load_final(ctx, -ENOMEM);
+	if (segment == NULL && extent_page != 0) {
+		segment = blob_ep_segment_alloc(blob, index);
+		if (segment == NULL) {
+			spdk_spin_unlock(&bs->ep_cache_lock);
+			free(waiter);
+			cb_fn(cb_arg, -ENOMEM);
 			return;
 		}
-		ctx->num_pages++;
-		ctx->pages = tmp_pages;
-
-		bs_sequence_read_dev(seq, &ctx->pages[ctx->num_pages - 1],
-				     next_lba,
-				     bs_byte_to_lba(blob->bs, sizeof(*page)),
-				     blob_load_cpl, ctx);
+		blob->ep_segments[index] = segment;
+		bs->ep_cache_num_pages++;
+		bs->ep_cache_misses++;
+	} else if (segment == NULL || segment->loaded) {
+		/* Loaded, evicted or made resident in the meantime, try to pin it again */
+		spdk_spin_unlock(&bs->ep_cache_lock);
+		spdk_thread_send_msg(waiter->thread, blob_ep_waiter_wake, waiter);
 		return;
+	} else {
+		/* Another request reads it already */
+		extent_page = 0;
 	}
+	TAILQ_INSERT_TAIL(&segment->waiters, waiter, link);
+	spdk_spin_unlock(&bs->ep_cache_lock);
 
-	/* Parse the pages */
-	rc = blob_parse(ctx->pages, ctx->num_pages, blob);
-	if (rc) {
-		blob_load_final(ctx, rc);
+	if (extent_page == 0) {
 		return;
 	}
 
-	if (blob->extent_table_found == true) {
-		/* If EXTENT_TABLE was found, that means support for it should be enabled. */
-		assert(blob->extent_rle_found == false);
-		blob->use_extent_table = true;
-	} else {
-		/* If EXTENT_RLE or no extent_* descriptor was found disable support
-		 * for extent table. No extent_* descriptors means that blob has length of 0
-		 * and no extent_rle descriptors were persisted for it.
-		 * EXTENT_TABLE if used, is always present in metadata regardless of length. */
-		blob->use_extent_table = false;
+	segment->page = spdk_zmalloc(bs->md_page_size, 0, NULL, SPDK_ENV_NUMA_ID_ANY,
+				     SPDK_MALLOC_DMA);
+	if (segment->page == NULL) {
+		blob_ep_segment_read_done(segment, -ENOMEM);
+		return;
 	}
 
-	/* Check the clear_method stored in metadata vs what may have been passed
-	 * via spdk_bs_open_blob_ext() and update accordingly.
-	 */
-	blob_update_clear_method(blob);
-
-	spdk_free(ctx->pages);
-	ctx->pages = NULL;
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_ep_segment_read_done;
+	cpl.u.blob_basic.cb_arg = segment;
 
-	if (blob->extent_table_found) {
-		blob_load_cpl_extents_cpl(seq, ctx, 0);
-	} else {
-		blob_load_backing_dev(seq, ctx);
+	seq = bs_sequence_start_bs(channel, &cpl);
+	if (seq == NULL) {
+		blob_ep_segment_read_done(segment, -ENOMEM);
+		return;
 	}
+
+	bs_sequence_read_dev(seq, segment->page, bs_md_page_to_lba(bs, extent_page),
+			     bs_byte_to_lba(bs, bs->md_page_size), blob_ep_segment_read_cpl, segment);
 }
 
-/* Load a blob from disk given a blobid */
-static void
-blob_load(spdk_bs_sequence_t *seq, struct spdk_blob *blob,
-	  spdk_bs_sequence_cpl cb_fn, void *cb_arg)
+bool
+bs_blob_io_unit_to_lba_resident(struct spdk_blob *blob, uint64_t io_unit, uint64_t *lba)
 {
-	struct spdk_blob_load_ctx *ctx;
-	struct spdk_blob_store *bs;
-	uint32_t page_num;
-	uint64_t lba;
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t cluster_num = bs_io_unit_to_cluster_number(blob, io_unit);
+	struct spdk_blob_ep_segment *segment;
+	uint64_t cluster_lba;
 
-	blob_verify_md_op(blob);
-
-	bs = blob->bs;
+	if (spdk_likely(!blob->ep_on_demand)) {
+		*lba = bs_blob_io_unit_to_lba(blob, io_unit);
+		return true;
+	}
 
-	ctx = calloc(1, sizeof(*ctx));
-	if (!ctx) {
-		cb_fn(seq, cb_arg, -ENOMEM);
-		return;
+	spdk_spin_lock(&bs->ep_cache_lock);
+	if (!blob->ep_on_demand) {
+		spdk_spin_unlock(&bs->ep_cache_lock);
+		*lba = bs_blob_io_unit_to_lba(blob, io_unit);
+		return true;
 	}
 
-	ctx->blob = blob;
-	ctx->pages = spdk_realloc(ctx->pages, bs->md_page_size, 0);
-	if (!ctx->pages) {
-		free(ctx);
-		cb_fn(seq, cb_arg, -ENOMEM);
-		return;
+	segment = blob->ep_segments[bs_cluster_to_extent_table_id(cluster_num)];
+	if (segment == NULL || !segment->loaded) {
+		spdk_spin_unlock(&bs->ep_cache_lock);
+		return false;
 	}
-	ctx->num_pages = 1;
-	ctx->cb_fn = cb_fn;
-	ctx->cb_arg = cb_arg;
-	ctx->seq = seq;
+	cluster_lba = segment->clusters[cluster_num % SPDK_EXTENTS_PER_EP];
+	spdk_spin_unlock(&bs->ep_cache_lock);
 
-	page_num = bs_blobid_to_page(blob->id);
-	lba = bs_md_page_to_lba(blob->bs, page_num);
+	*lba = cluster_lba == 0 ? 0 : cluster_lba + io_unit % bs_io_units_per_cluster(blob);
+	return true;
+}
 
-	blob->state = SPDK_BLOB_STATE_LOADING;
+static void
+blob_ep_segments_free(struct spdk_blob *blob)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	struct spdk_blob_ep_segment *segment;
+	uint64_t i;
 
-	bs_sequence_read_dev(seq, &ctx->pages[0], lba,
-			     bs_byte_to_lba(bs, bs->md_page_size),
-			     blob_load_cpl, ctx);
-}
+	spdk_spin_lock(&bs->ep_cache_lock);
+	for (i = 0; i < blob->num_ep_segments; i++) {
+		segment = blob->ep_segments[i];
+		if (segment == NULL) {
+			continue;
+		}
 
-struct spdk_blob_persist_ctx {
-	struct spdk_blob		*blob;
+		/* Detached segments are freed when they are unpinned */
+		assert(segment->pin_cnt == 0 && segment->loaded && !segment->detached);
+		TAILQ_REMOVE(&bs->ep_lru, segment, lru_link);
+		bs->ep_cache_num_pages--;
+		free(segment);
+	}
+	spdk_spin_unlock(&bs->ep_cache_lock);
 
-	struct spdk_blob_md_page	*pages;
-	uint32_t			next_extent_page;
-	struct spdk_blob_md_page	*extent_page;
+	free(blob->ep_segments);
+	blob->ep_segments = NULL;
+	spdk_bit_array_free(&blob->allocated_clusters);
+}
 
-	spdk_bs_sequence_t		*seq;
-	spdk_bs_sequence_cpl		cb_fn;
+struct blob_ep_resident_ctx {
+	struct spdk_blob		*blob;
+	struct spdk_blob_ep_segment	**segments;
+	uint64_t			num_pinned;
+	spdk_blob_op_complete		cb_fn;
 	void				*cb_arg;
-	TAILQ_ENTRY(spdk_blob_persist_ctx) link;
 };
 
-static void
-bs_batch_clear_dev(struct spdk_blob *blob, spdk_bs_batch_t *batch, uint64_t lba,
-		   uint64_t lba_count)
-{
-	switch (blob->clear_method) {
-	case BLOB_CLEAR_WITH_DEFAULT:
-	case BLOB_CLEAR_WITH_UNMAP:
-		bs_batch_unmap_dev(batch, lba, lba_count);
-		break;
-	case BLOB_CLEAR_WITH_WRITE_ZEROES:
-		bs_batch_write_zeroes_dev(batch, lba, lba_count);
-		break;
-	case BLOB_CLEAR_WITH_NONE:
-	default:
-		break;
-	}
-}
-
+/* Move the cluster map of the blob from the segments pinned by ctx to active.clusters */
 static int
-bs_super_validate(struct spdk_bs_super_block *super, struct spdk_blob_store *bs)
+blob_ep_resident_switch(struct blob_ep_resident_ctx *ctx)
 {
-	uint32_t	crc;
-	static const char zeros[SPDK_BLOBSTORE_TYPE_LENGTH];
-
-	if (super->version > SPDK_BS_VERSION ||
-	    super->version < SPDK_BS_INITIAL_VERSION) {
-		return -EILSEQ;
-	}
-
-	if (memcmp(super->signature, SPDK_BS_SUPER_BLOCK_SIG,
-		   sizeof(super->signature)) != 0) {
-		return -EILSEQ;
-	}
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t *clusters;
+	uint64_t i, count;
 
-	crc = blob_md_page_calc_crc(super);
-	if (crc != super->crc) {
-		return -EILSEQ;
+	clusters = calloc(blob->active.num_clusters, sizeof(*clusters));
+	if (clusters == NULL) {
+		return -ENOMEM;
 	}
 
-	if (memcmp(&bs->bstype, &super->bstype, SPDK_BLOBSTORE_TYPE_LENGTH) == 0) {
-		SPDK_DEBUGLOG(blob, "Bstype matched - loading blobstore\n");
-	} else if (memcmp(&bs->bstype, zeros, SPDK_BLOBSTORE_TYPE_LENGTH) == 0) {
-		SPDK_DEBUGLOG(blob, "Bstype wildcard used - loading blobstore regardless bstype\n");
-	} else {
-		SPDK_DEBUGLOG(blob, "Unexpected bstype\n");
-		SPDK_LOGDUMP(blob, "Expected:", bs->bstype.bstype, SPDK_BLOBSTORE_TYPE_LENGTH);
-		SPDK_LOGDUMP(blob, "Found:", super->bstype.bstype, SPDK_BLOBSTORE_TYPE_LENGTH);
-		return -ENXIO;
+	spdk_spin_lock(&blob->md_lock);
+	spdk_spin_lock(&bs->ep_cache_lock);
+	for (i = 0; i < blob->num_ep_segments; i++) {
+		count = spdk_min(SPDK_EXTENTS_PER_EP, blob->active.num_clusters - i * SPDK_EXTENTS_PER_EP);
+		memcpy(&clusters[i * SPDK_EXTENTS_PER_EP], ctx->segments[i]->clusters,
+		       count * sizeof(*clusters));
+		ctx->segments[i]->detached = true;
 	}
+	bs->ep_cache_num_pages -= blob->num_ep_segments;
 
-	if (super->size > bs->dev->blockcnt * bs->dev->blocklen) {
-		SPDK_NOTICELOG("Size mismatch, dev size: %" PRIu64 ", blobstore size: %" PRIu64 "\n",
-			       bs->dev->blockcnt * bs->dev->blocklen, super->size);
-		return -EILSEQ;
-	}
+	free(blob->active.clusters);
+	blob->active.clusters = clusters;
+	blob->active.cluster_array_size = blob->active.num_clusters;
+	/* I/O that finds the blob no longer loading its extent pages on demand looks the clusters
+	 * up in active.clusters */
+	spdk_smp_wmb();
+	blob->ep_on_demand = false;
+	spdk_spin_unlock(&bs->ep_cache_lock);
+	spdk_spin_unlock(&blob->md_lock);
 
 	return 0;
 }
 
-static void bs_mark_dirty(spdk_bs_sequence_t *seq, struct spdk_blob_store *bs,
-			  spdk_bs_sequence_cpl cb_fn, void *cb_arg);
-
 static void
-blob_persist_complete_cb(void *arg)
+blob_ep_resident_next(void *cb_arg, int bserrno)
 {
-	struct spdk_blob_persist_ctx *ctx = arg;
+	struct blob_ep_resident_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_ep_segment *segment;
+	uint64_t i;
 
-	/* Call user callback */
-	ctx->cb_fn(ctx->seq, ctx->cb_arg, 0);
+	while (bserrno == 0 && ctx->num_pinned < blob->num_ep_segments) {
+		bserrno = blob_ep_segment_pin(blob, ctx->num_pinned * SPDK_EXTENTS_PER_EP, false,
+					      &segment);
+		if (bserrno == -ENOENT) {
+			blob_ep_segment_load(blob, blob->bs->md_channel, ctx->num_pinned * SPDK_EXTENTS_PER_EP,
+					     blob_ep_resident_next, ctx);
+			return;
+		}
+		if (bserrno == 0 && segment == NULL) {
+			/* Made resident by another metadata operation in the meantime */
+			break;
+		}
+		if (bserrno == 0) {
+			ctx->segments[ctx->num_pinned++] = segment;
+		}
+	}
 
-	/* Free the memory */
-	spdk_free(ctx->pages);
+	if (bserrno == 0 && blob->ep_on_demand) {
+		bserrno = blob_ep_resident_switch(ctx);
+	}
+
+	for (i = 0; i < ctx->num_pinned; i++) {
+		bs_ep_segment_unpin(ctx->segments[i]);
+	}
+
+	ctx->cb_fn(ctx->cb_arg, bserrno);
+	free(ctx->segments);
 	free(ctx);
 }
 
-static void blob_persist_start(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
-
+/*
+ * Read all the extent pages of a blob that loads them on demand, and keep its whole cluster map
+ * in active.clusters until the blob is closed. Called on md_thread by the metadata operations
+ * that walk the cluster map.
+ */
 static void
-blob_persist_complete(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx, int bserrno)
+blob_load_extent_pages(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	struct spdk_blob_persist_ctx	*next_persist, *tmp;
-	struct spdk_blob		*blob = ctx->blob;
+	struct blob_ep_resident_ctx *ctx;
 
-	if (bserrno == 0) {
-		blob_mark_clean(blob);
-	}
+	blob_verify_md_op(blob);
 
-	assert(ctx == TAILQ_FIRST(&blob->persists_to_complete));
+	if (!blob->ep_on_demand) {
+		cb_fn(cb_arg, 0);
+		return;
+	}
 
-	/* Complete all persists that were pending when the current persist started */
-	TAILQ_FOREACH_SAFE(next_persist, &blob->persists_to_complete, link, tmp) {
-		TAILQ_REMOVE(&blob->persists_to_complete, next_persist, link);
-		spdk_thread_send_msg(spdk_get_thread(), blob_persist_complete_cb, next_persist);
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
 	}
 
-	if (TAILQ_EMPTY(&blob->pending_persists)) {
+	ctx->segments = calloc(blob->num_ep_segments, sizeof(*ctx->segments));
+	if (ctx->segments == NULL) {
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
 
-	/* Queue up all pending persists for completion and start blob persist with first one */
-	TAILQ_SWAP(&blob->persists_to_complete, &blob->pending_persists, spdk_blob_persist_ctx, link);
-	next_persist = TAILQ_FIRST(&blob->persists_to_complete);
+	ctx->blob = blob;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
 
-	blob->state = SPDK_BLOB_STATE_DIRTY;
-	bs_mark_dirty(seq, blob->bs, blob_persist_start, next_persist);
+	blob_ep_resident_next(ctx, 0);
+}
+
+struct bs_open_resident_ctx {
+	struct spdk_blob			*blob;
+	int					bserrno;
+	spdk_blob_op_with_handle_complete	cb_fn;
+	void					*cb_arg;
+};
+
+static void
+bs_open_resident_close_cpl(void *cb_arg, int bserrno)
+{
+	struct bs_open_resident_ctx *ctx = cb_arg;
+
+	ctx->cb_fn(ctx->cb_arg, NULL, ctx->bserrno);
+	free(ctx);
 }
 
 static void
-blob_persist_clear_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+bs_open_resident_load_cpl(void *cb_arg, int bserrno)
 {
-	struct spdk_blob_persist_ctx	*ctx = cb_arg;
-	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_store		*bs = blob->bs;
-	size_t				i;
+	struct bs_open_resident_ctx *ctx = cb_arg;
 
 	if (bserrno != 0) {
-		blob_persist_complete(seq, ctx, bserrno);
+		ctx->bserrno = bserrno;
+		spdk_blob_close(ctx->blob, bs_open_resident_close_cpl, ctx);
 		return;
 	}
 
-	spdk_spin_lock(&bs->used_lock);
+	ctx->cb_fn(ctx->cb_arg, ctx->blob, 0);
+	free(ctx);
+}
 
-	/* Release all extent_pages that were truncated */
-	for (i = blob->active.num_extent_pages; i < blob->active.extent_pages_array_size; i++) {
-		/* Nothing to release if it was not allocated */
-		if (blob->active.extent_pages[i] != 0) {
-			bs_release_md_page(bs, blob->active.extent_pages[i]);
-		}
+static void
+bs_open_resident_open_cpl(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct bs_open_resident_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		ctx->cb_fn(ctx->cb_arg, NULL, bserrno);
+		free(ctx);
+		return;
 	}
 
-	spdk_spin_unlock(&bs->used_lock);
+	ctx->blob = blob;
+	blob_load_extent_pages(blob, bs_open_resident_load_cpl, ctx);
+}
 
-	if (blob->active.num_extent_pages == 0) {
-		free(blob->active.extent_pages);
-		blob->active.extent_pages = NULL;
-		blob->active.extent_pages_array_size = 0;
-	} else if (blob->active.num_extent_pages != blob->active.extent_pages_array_size) {
-#ifndef __clang_analyzer__
-		void *tmp;
+/* Open a blob for a metadata operation that walks its cluster map, see blob_load_extent_pages() */
+static void
+bs_open_blob_resident(struct spdk_blob_store *bs, spdk_blob_id blobid,
+		      spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	struct bs_open_resident_ctx *ctx;
 
-		/* scan-build really can't figure reallocs, workaround it */
-		tmp = realloc(blob->active.extent_pages, sizeof(uint32_t) * blob->active.num_extent_pages);
-		assert(tmp != NULL);
-		blob->active.extent_pages = tmp;
-#endif
-		blob->active.extent_pages_array_size = blob->active.num_extent_pages;
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, NULL, -ENOMEM);
+		return;
 	}
 
-	blob_persist_complete(seq, ctx, bserrno);
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_bs_open_blob(bs, blobid, bs_open_resident_open_cpl, ctx);
 }
 
-static void
-blob_persist_clear_extents(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx)
+void
+spdk_bs_get_extent_page_cache_stats(struct spdk_blob_store *bs,
+				    struct spdk_bs_extent_page_cache_stats *stats)
 {
-	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_store		*bs = blob->bs;
-	size_t				i;
-	uint64_t                        lba;
-	uint64_t                        lba_count;
-	spdk_bs_batch_t                 *batch;
+	spdk_spin_lock(&bs->ep_cache_lock);
+	stats->hits = bs->ep_cache_hits;
+	stats->misses = bs->ep_cache_misses;
+	stats->evictions = bs->ep_cache_evictions;
+	stats->num_pages = bs->ep_cache_num_pages;
+	stats->max_pages = bs->ep_cache_size;
+	spdk_spin_unlock(&bs->ep_cache_lock);
+}
 
-	batch = bs_sequence_to_batch(seq, blob_persist_clear_extents_cpl, ctx);
-	lba_count = bs_byte_to_lba(bs, bs->md_page_size);
+/* END extent pages loaded on demand */
 
-	/* Clear all extent_pages that were truncated */
-	for (i = blob->active.num_extent_pages; i < blob->active.extent_pages_array_size; i++) {
-		/* Nothing to clear if it was not allocated */
-		if (blob->active.extent_pages[i] != 0) {
-			lba = bs_md_page_to_lba(bs, blob->active.extent_pages[i]);
-			bs_batch_write_zeroes_dev(batch, lba, lba_count);
+/*
+ * Size the sub-cluster masks to the blob and drop the masks of clusters that are not allocated.
+ * The mask of a new cluster is persisted before the extent page that allocates it, so such
+ * masks may be left behind by a crash.
+ */
+static int
+blob_load_sub_clusters(struct spdk_blob *blob)
+{
+	uint64_t	full_mask;
+	uint64_t	*tmp;
+	uint64_t	i;
+
+	if (blob->io_units_per_sub_cluster == 0) {
+		return 0;
+	}
+
+	if (blob->active.num_clusters > blob->num_sub_cluster_masks) {
+		tmp = realloc(blob->sub_cluster_masks,
+			      blob->active.num_clusters * sizeof(*blob->sub_cluster_masks));
+		if (tmp == NULL) {
+			return -ENOMEM;
 		}
+		memset(tmp + blob->num_sub_cluster_masks, 0,
+		       (blob->active.num_clusters - blob->num_sub_cluster_masks) * sizeof(*tmp));
+		blob->sub_cluster_masks = tmp;
+		blob->num_sub_cluster_masks = blob->active.num_clusters;
 	}
 
-	bs_batch_close(batch);
+	full_mask = bs_sub_cluster_full_mask(blob);
+	for (i = 0; i < blob->num_sub_cluster_masks; i++) {
+		if (i >= blob->active.num_clusters || !bs_cluster_is_allocated(blob, i)) {
+			blob->sub_cluster_masks[i] = 0;
+		} else {
+			blob->sub_cluster_masks[i] &= full_mask;
+		}
+	}
+
+	return 0;
 }
 
 static void
-blob_persist_clear_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_load_final(struct spdk_blob_load_ctx *ctx, int bserrno)
 {
-	struct spdk_blob_persist_ctx	*ctx = cb_arg;
 	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_store		*bs = blob->bs;
-	size_t				i;
 
-	if (bserrno != 0) {
-		blob_persist_complete(seq, ctx, bserrno);
-		return;
+	if (bserrno == 0) {
+		bserrno = blob_load_sub_clusters(blob);
 	}
 
-	spdk_spin_lock(&bs->used_lock);
-	/* Release all clusters that were truncated */
-	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
-		uint32_t cluster_num = bs_lba_to_cluster(bs, blob->active.clusters[i]);
+	if (bserrno == 0) {
+		blob_mark_clean(blob);
+	}
 
-		/* Nothing to release if it was not allocated */
-		if (blob->active.clusters[i] != 0) {
-			bs_release_cluster(bs, cluster_num);
+	ctx->cb_fn(ctx->seq, ctx->cb_arg, bserrno);
+
+	/* Free the memory */
+	spdk_free(ctx->pages);
+	free(ctx->ep_clusters);
+	free(ctx);
+}
+
+static void
+blob_load_snapshot_cpl(void *cb_arg, struct spdk_blob *snapshot, int bserrno)
+{
+	struct spdk_blob_load_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+
+	if (bserrno == 0) {
+		blob->back_bs_dev = bs_create_blob_bs_dev(snapshot);
+		if (blob->back_bs_dev == NULL) {
+			bserrno = -ENOMEM;
 		}
 	}
-	spdk_spin_unlock(&bs->used_lock);
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Snapshot fail\n");
+	}
 
-	if (blob->active.num_clusters == 0) {
-		free(blob->active.clusters);
-		blob->active.clusters = NULL;
-		blob->active.cluster_array_size = 0;
-	} else if (blob->active.num_clusters != blob->active.cluster_array_size) {
-#ifndef __clang_analyzer__
-		void *tmp;
+	blob_load_final(ctx, bserrno);
+}
 
-		/* scan-build really can't figure reallocs, workaround it */
-		tmp = realloc(blob->active.clusters, sizeof(*blob->active.clusters) * blob->active.num_clusters);
-		assert(tmp != NULL);
-		blob->active.clusters = tmp;
+static void blob_update_clear_method(struct spdk_blob *blob);
 
-#endif
-		blob->active.cluster_array_size = blob->active.num_clusters;
+static int
+blob_load_esnap(struct spdk_blob *blob, void *blob_ctx)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	struct spdk_bs_dev *bs_dev = NULL;
+	const void *esnap_id = NULL;
+	size_t id_len = 0;
+	int rc;
+
+	if (bs->esnap_bs_dev_create == NULL) {
+		SPDK_NOTICELOG("blob 0x%" PRIx64 " is an esnap clone but the blobstore was opened "
+			       "without support for esnap clones\n", blob->id);
+		return -ENOTSUP;
 	}
+	assert(blob->back_bs_dev == NULL);
 
-	/* Move on to clearing extent pages */
-	blob_persist_clear_extents(seq, ctx);
+	rc = blob_get_xattr_value(blob, BLOB_EXTERNAL_SNAPSHOT_ID, &esnap_id, &id_len, true);
+	if (rc != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 " is an esnap clone but has no esnap ID\n", blob->id);
+		return -EINVAL;
+	}
+	assert(id_len > 0 && id_len < UINT32_MAX);
+
+	SPDK_INFOLOG(blob, "Creating external snapshot device\n");
+
+	rc = bs->esnap_bs_dev_create(bs->esnap_ctx, blob_ctx, blob, esnap_id, (uint32_t)id_len,
+				     &bs_dev);
+	if (rc != 0) {
+		SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": failed to load back_bs_dev "
+			      "with error %d\n", blob->id, rc);
+		return rc;
+	}
+
+	/*
+	 * Note: bs_dev might be NULL if the consumer chose to not open the external snapshot.
+	 * This especially might happen during spdk_bs_load() iteration.
+	 */
+	if (bs_dev != NULL) {
+		SPDK_DEBUGLOG(blob_esnap, "blob 0x%" PRIx64 ": loaded back_bs_dev\n", blob->id);
+		if ((bs->io_unit_size % bs_dev->blocklen) != 0) {
+			SPDK_NOTICELOG("blob 0x%" PRIx64 " external snapshot device block size %u "
+				       "is not compatible with blobstore block size %u\n",
+				       blob->id, bs_dev->blocklen, bs->io_unit_size);
+			bs_dev->destroy(bs_dev);
+			return -EINVAL;
+		}
+	}
+
+	blob->back_bs_dev = bs_dev;
+	blob->parent_id = SPDK_BLOBID_EXTERNAL_SNAPSHOT;
+
+	return 0;
 }
 
 static void
-blob_persist_clear_clusters(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx)
+blob_load_backing_dev(spdk_bs_sequence_t *seq, void *cb_arg)
 {
+	struct spdk_blob_load_ctx	*ctx = cb_arg;
 	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_store		*bs = blob->bs;
-	spdk_bs_batch_t			*batch;
-	size_t				i;
-	uint64_t			lba;
-	uint64_t			lba_count;
+	const void			*value;
+	size_t				len;
+	int				rc;
 
-	/* Clusters don't move around in blobs. The list shrinks or grows
-	 * at the end, but no changes ever occur in the middle of the list.
-	 */
+	if (blob_is_esnap_clone(blob)) {
+		rc = blob_load_esnap(blob, seq->cpl.u.blob_handle.esnap_ctx);
+		blob_load_final(ctx, rc);
+		return;
+	}
 
-	batch = bs_sequence_to_batch(seq, blob_persist_clear_clusters_cpl, ctx);
+	if (spdk_blob_is_thin_provisioned(blob)) {
+		rc = blob_get_xattr_value(blob, BLOB_SNAPSHOT, &value, &len, true);
+		if (rc == 0) {
+			if (len != sizeof(spdk_blob_id)) {
+				blob_load_final(ctx, -EINVAL);
+				return;
+			}
+			/* open snapshot blob and continue in the callback function */
+			blob->parent_id = *(spdk_blob_id *)value;
+			spdk_bs_open_blob(blob->bs, blob->parent_id,
+					  blob_load_snapshot_cpl, ctx);
+			return;
+		} else {
+			/* add zeroes_dev for thin provisioned blob */
+			blob->back_bs_dev = bs_create_zeroes_dev();
+		}
+	} else {
+		/* standard blob */
+		blob->back_bs_dev = NULL;
+	}
+	blob_load_final(ctx, 0);
+}
 
-	/* Clear all clusters that were truncated */
-	lba = 0;
-	lba_count = 0;
-	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
-		uint64_t next_lba = blob->active.clusters[i];
-		uint64_t next_lba_count = bs_cluster_to_lba(bs, 1);
+/* Parse the extent pages read by the last batch, and keep them in memory if there is room */
+static int
+blob_load_ep_on_demand_parse(struct spdk_blob_load_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = blob->bs;
+	struct spdk_blob_ep_segment *segment;
+	uint64_t *clusters = ctx->ep_clusters;
+	uint64_t i, j, count;
+	int rc;
 
-		if (next_lba > 0 && (lba + lba_count) == next_lba) {
-			/* This cluster is contiguous with the previous one. */
-			lba_count += next_lba_count;
-			continue;
-		} else if (next_lba == 0) {
+	for (i = ctx->ep_batch_start; i < ctx->next_extent_page; i++) {
+		if (blob->active.extent_pages[i] == 0) {
 			continue;
 		}
 
-		/* This cluster is not contiguous with the previous one. */
+		/* Checked without the lock, the limit is enforced once the segment is added */
+		segment = NULL;
+		if (bs->ep_cache_num_pages < bs->ep_cache_size) {
+			segment = blob_ep_segment_alloc(blob, i);
+			if (segment == NULL) {
+				return -ENOMEM;
+			}
+			clusters = segment->clusters;
+		}
 
-		/* If a run of LBAs previously existing, clear them now */
-		if (lba_count > 0) {
-			bs_batch_clear_dev(ctx->blob, batch, lba, lba_count);
+		rc = blob_parse_ep_segment(blob, &ctx->pages[i - ctx->ep_batch_start], i, clusters);
+		if (rc != 0) {
+			free(segment);
+			return rc;
 		}
 
-		/* Start building the next batch */
-		lba = next_lba;
-		if (next_lba > 0) {
-			lba_count = next_lba_count;
-		} else {
-			lba_count = 0;
+		count = spdk_min(SPDK_EXTENTS_PER_EP, blob->active.num_clusters - i * SPDK_EXTENTS_PER_EP);
+		for (j = 0; j < count; j++) {
+			if (clusters[j] == 0) {
+				continue;
+			}
+			if (!spdk_bit_pool_is_allocated(bs->used_clusters, bs_lba_to_cluster(bs, clusters[j]))) {
+				free(segment);
+				return -EINVAL;
+			}
+			spdk_bit_array_set(blob->allocated_clusters, i * SPDK_EXTENTS_PER_EP + j);
+			blob->active.num_allocated_clusters++;
 		}
-	}
 
-	/* If we ended with a contiguous set of LBAs, clear them now */
-	if (lba_count > 0) {
-		bs_batch_clear_dev(ctx->blob, batch, lba, lba_count);
+		if (segment != NULL) {
+			segment->loaded = true;
+			spdk_spin_lock(&bs->ep_cache_lock);
+			blob->ep_segments[i] = segment;
+			bs->ep_cache_num_pages++;
+			TAILQ_INSERT_TAIL(&bs->ep_lru, segment, lru_link);
+			bs_ep_cache_evict(bs);
+			spdk_spin_unlock(&bs->ep_cache_lock);
+			clusters = ctx->ep_clusters;
+		}
 	}
 
-	bs_batch_close(batch);
+	return 0;
 }
 
+/*
+ * Read the extent pages of a blob that loads them on demand. Each one is read once to find the
+ * allocated clusters, several at a time, and only as many are kept in memory as there is room for.
+ */
 static void
-blob_persist_zero_pages_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_load_ep_on_demand_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
-	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob_load_ctx	*ctx = cb_arg;
 	struct spdk_blob		*blob = ctx->blob;
 	struct spdk_blob_store		*bs = blob->bs;
-	size_t				i;
+	spdk_bs_batch_t			*batch;
+	uint64_t			i, end;
 
+	if (bserrno == 0) {
+		bserrno = blob_load_ep_on_demand_parse(ctx);
+	} else {
+		SPDK_ERRLOG("Extent page read failed: %d\n", bserrno);
+	}
 	if (bserrno != 0) {
-		blob_persist_complete(seq, ctx, bserrno);
+		blob_load_final(ctx, bserrno);
 		return;
 	}
 
-	spdk_spin_lock(&bs->used_lock);
+	/* Thin provisioned blobs can point to unallocated extent pages, skip those */
+	while (ctx->next_extent_page < blob->num_ep_segments &&
+	       blob->active.extent_pages[ctx->next_extent_page] == 0) {
+		ctx->next_extent_page++;
+	}
 
-	/* This loop starts at 1 because the first page is special and handled
-	 * below. The pages (except the first) are never written in place,
-	 * so any pages in the clean list must be zeroed.
-	 */
-	for (i = 1; i < blob->clean.num_pages; i++) {
-		bs_release_md_page(bs, blob->clean.pages[i]);
+	if (ctx->next_extent_page == blob->num_ep_segments) {
+		blob_load_backing_dev(seq, ctx);
+		return;
 	}
 
-	if (blob->active.num_pages == 0) {
-		uint32_t page_num;
+	ctx->ep_batch_start = ctx->next_extent_page;
+	end = spdk_min(ctx->ep_batch_start + SPDK_BLOB_EP_LOAD_BATCH, blob->num_ep_segments);
 
-		page_num = bs_blobid_to_page(blob->id);
-		bs_release_md_page(bs, page_num);
+	batch = bs_sequence_to_batch(seq, blob_load_ep_on_demand_cpl, ctx);
+	for (i = ctx->ep_batch_start; i < end; i++) {
+		if (blob->active.extent_pages[i] != 0) {
+			bs_batch_read_dev(batch, &ctx->pages[i - ctx->ep_batch_start],
+					  bs_md_page_to_lba(bs, blob->active.extent_pages[i]),
+					  bs_byte_to_lba(bs, bs->md_page_size));
+		}
 	}
+	ctx->next_extent_page = end;
 
-	spdk_spin_unlock(&bs->used_lock);
+	bs_batch_close(batch);
+}
 
-	/* Move on to clearing clusters */
-	blob_persist_clear_clusters(seq, ctx);
+/* Start loading the extent pages of the blob on demand, if the blobstore and the blob allow it */
+static bool
+blob_load_ep_on_demand(spdk_bs_sequence_t *seq, struct spdk_blob_load_ctx *ctx)
+{
+	struct spdk_blob	*blob = ctx->blob;
+	struct spdk_blob_store	*bs = blob->bs;
+	uint64_t		num_clusters = blob->remaining_clusters_in_et;
+
+	if (bs->ep_cache_size == 0 || num_clusters == 0 || blob->active.num_clusters != 0 ||
+	    blob->active.num_extent_pages != spdk_divide_round_up(num_clusters, SPDK_EXTENTS_PER_EP)) {
+		return false;
+	}
+
+	ctx->pages = spdk_zmalloc(SPDK_BLOB_EP_LOAD_BATCH * bs->md_page_size, 0,
+				  NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->ep_clusters = calloc(SPDK_EXTENTS_PER_EP, sizeof(*ctx->ep_clusters));
+	blob->ep_segments = calloc(blob->active.num_extent_pages, sizeof(*blob->ep_segments));
+	blob->allocated_clusters = spdk_bit_array_create(num_clusters);
+	if (ctx->pages == NULL || ctx->ep_clusters == NULL || blob->ep_segments == NULL ||
+	    blob->allocated_clusters == NULL) {
+		/* The blob is freed once loading it fails */
+		blob_load_final(ctx, -ENOMEM);
+		return true;
+	}
+
+	blob->ep_on_demand = true;
+	blob->num_ep_segments = blob->active.num_extent_pages;
+	blob->active.num_clusters = num_clusters;
+	blob->active.cluster_array_size = num_clusters;
+	blob->remaining_clusters_in_et = 0;
+
+	ctx->num_pages = SPDK_BLOB_EP_LOAD_BATCH;
+	ctx->next_extent_page = 0;
+	ctx->ep_batch_start = 0;
+
+	blob_load_ep_on_demand_cpl(seq, ctx, 0);
+	return true;
 }
 
 static void
-blob_persist_zero_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_load_cpl_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
-	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob_load_ctx	*ctx = cb_arg;
 	struct spdk_blob		*blob = ctx->blob;
-	struct spdk_blob_store		*bs = blob->bs;
+	struct spdk_blob_md_page	*page;
+	uint64_t			i;
+	uint32_t			crc;
 	uint64_t			lba;
-	uint64_t			lba_count;
-	spdk_bs_batch_t			*batch;
-	size_t				i;
+	void				*tmp;
+	uint64_t			sz;
 
-	if (bserrno != 0) {
-		blob_persist_complete(seq, ctx, bserrno);
+	if (bserrno) {
+		SPDK_ERRLOG("Extent page read failed: %d\n", bserrno);
+		blob_load_final(ctx, bserrno);
 		return;
 	}
 
-	batch = bs_sequence_to_batch(seq, blob_persist_zero_pages_cpl, ctx);
+	if (ctx->pages == NULL) {
+		if (blob_load_ep_on_demand(seq, ctx)) {
+			return;
+		}
+
+		/* First iteration of this function, allocate buffer for single EXTENT_PAGE */
+		ctx->pages = spdk_zmalloc(blob->bs->md_page_size, 0,
+					  NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+		if (!ctx->pages) {
+			blob_load_final(ctx, -ENOMEM);
+			return;
+		}
+		ctx->num_pages = 1;
+		ctx->next_extent_page = 0;
+	} else {
+		page = &ctx->pages[0];
+		crc = blob_md_page_calc_crc(page);
+		if (crc != page->crc) {
+			blob_load_final(ctx, -EINVAL);
+			return;
+		}
+
+		if (page->next != SPDK_INVALID_MD_PAGE) {
+			blob_load_final(ctx, -EINVAL);
+			return;
+		}
+
+		bserrno = blob_parse_extent_page(page, blob);
+		if (bserrno) {
+			blob_load_final(ctx, bserrno);
+			return;
+		}
+	}
+
+	for (i = ctx->next_extent_page; i < blob->active.num_extent_pages; i++) {
+		if (blob->active.extent_pages[i] != 0) {
+			/* Extent page was allocated, read and parse it. */
+			lba = bs_md_page_to_lba(blob->bs, blob->active.extent_pages[i]);
+			ctx->next_extent_page = i + 1;
+
+			bs_sequence_read_dev(seq, &ctx->pages[0], lba,
+					     bs_byte_to_lba(blob->bs, blob->bs->md_page_size),
+					     blob_load_cpl_extents_cpl, ctx);
+			return;
+		} else {
+			/* Thin provisioned blobs can point to unallocated extent pages.
+			 * In this case blob size should be increased by up to the amount left in remaining_clusters_in_et. */
+
+			sz = spdk_min(blob->remaining_clusters_in_et, SPDK_EXTENTS_PER_EP);
+			blob->active.num_clusters += sz;
+			blob->remaining_clusters_in_et -= sz;
+
+			assert(spdk_blob_is_thin_provisioned(blob));
+			assert(i + 1 < blob->active.num_extent_pages || blob->remaining_clusters_in_et == 0);
+
+			tmp = realloc(blob->active.clusters, blob->active.num_clusters * sizeof(*blob->active.clusters));
+			if (tmp == NULL) {
+				blob_load_final(ctx, -ENOMEM);
+				return;
+			}
+			memset(tmp + sizeof(*blob->active.clusters) * blob->active.cluster_array_size, 0,
+			       sizeof(*blob->active.clusters) * (blob->active.num_clusters - blob->active.cluster_array_size));
+			blob->active.clusters = tmp;
+			blob->active.cluster_array_size = blob->active.num_clusters;
+		}
+	}
+
+	blob_load_backing_dev(seq, ctx);
+}
+
+static void
+blob_load_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_load_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_md_page	*page;
+	int				rc;
+	uint32_t			crc;
+	uint32_t			current_page;
+
+	if (ctx->num_pages == 1) {
+		current_page = bs_blobid_to_page(blob->id);
+	} else {
+		assert(ctx->num_pages != 0);
+		page = &ctx->pages[ctx->num_pages - 2];
+		current_page = page->next;
+	}
+
+	if (bserrno) {
+		SPDK_ERRLOG("Metadata page %d read failed for blobid 0x%" PRIx64 ": %d\n",
+			    current_page, blob->id, bserrno);
+		blob_load_final(ctx, bserrno);
+		return;
+	}
+
+	page = &ctx->pages[ctx->num_pages - 1];
+	crc = blob_md_page_calc_crc(page);
+	if (crc != page->crc) {
+		SPDK_ERRLOG("Metadata page %d crc mismatch for blobid 0x%" PRIx64 "\n",
+			    current_page, blob->id);
+		blob_load_final(ctx, -EINVAL);
+		return;
+	}
+
+	if (page->next != SPDK_INVALID_MD_PAGE) {
+		struct spdk_blob_md_page *tmp_pages;
+		uint32_t next_page = page->next;
+		uint64_t next_lba = bs_md_page_to_lba(blob->bs, next_page);
+
+		/* Read the next page */
+		tmp_pages = spdk_realloc(ctx->pages, (sizeof(*page) * (ctx->num_pages + 1)), 0);
+		if (tmp_pages == NULL) {
+			blob_load_final(ctx, -ENOMEM);
+			return;
+		}
+		ctx->num_pages++;
+		ctx->pages = tmp_pages;
+
+		bs_sequence_read_dev(seq, &ctx->pages[ctx->num_pages - 1],
+				     next_lba,
+				     bs_byte_to_lba(blob->bs, sizeof(*page)),
+				     blob_load_cpl, ctx);
+		return;
+	}
+
+	/* Parse the pages */
+	rc = blob_parse(ctx->pages, ctx->num_pages, blob);
+	if (rc) {
+		blob_load_final(ctx, rc);
+		return;
+	}
+
+	if (blob->extent_table_found == true) {
+		/* If EXTENT_TABLE was found, that means support for it should be enabled. */
+		assert(blob->extent_rle_found == false);
+		blob->use_extent_table = true;
+	} else {
+		/* If EXTENT_RLE or no extent_* descriptor was found disable support
+		 * for extent table. No extent_* descriptors means that blob has length of 0
+		 * and no extent_rle descriptors were persisted for it.
+		 * EXTENT_TABLE if used, is always present in metadata regardless of length. */
+		blob->use_extent_table = false;
+	}
+
+	/* Check the clear_method stored in metadata vs what may have been passed
+	 * via spdk_bs_open_blob_ext() and update accordingly.
+	 */
+	blob_update_clear_method(blob);
+
+	spdk_free(ctx->pages);
+	ctx->pages = NULL;
+
+	if (blob->extent_table_found) {
+		blob_load_cpl_extents_cpl(seq, ctx, 0);
+	} else {
+		blob_load_backing_dev(seq, ctx);
+	}
+}
+
+/* Load a blob from disk given a blobid */
+static void
+blob_load(spdk_bs_sequence_t *seq, struct spdk_blob *blob,
+	  spdk_bs_sequence_cpl cb_fn, void *cb_arg)
+{
+	struct spdk_blob_load_ctx *ctx;
+	struct spdk_blob_store *bs;
+	uint32_t page_num;
+	uint64_t lba;
+
+	blob_verify_md_op(blob);
+
+	bs = blob->bs;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(seq, cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->blob = blob;
+	ctx->pages = spdk_realloc(ctx->pages, bs->md_page_size, 0);
+	if (!ctx->pages) {
+		free(ctx);
+		cb_fn(seq, cb_arg, -ENOMEM);
+		return;
+	}
+	ctx->num_pages = 1;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->seq = seq;
+
+	page_num = bs_blobid_to_page(blob->id);
+	lba = bs_md_page_to_lba(blob->bs, page_num);
+
+	blob->state = SPDK_BLOB_STATE_LOADING;
+
+	bs_sequence_read_dev(seq, &ctx->pages[0], lba,
+			     bs_byte_to_lba(bs, bs->md_page_size),
+			     blob_load_cpl, ctx);
+}
+
+struct spdk_blob_persist_ctx {
+	struct spdk_blob		*blob;
+
+	struct spdk_blob_md_page	*pages;
+	uint32_t			next_extent_page;
+	struct spdk_blob_md_page	*extent_page;
+
+	spdk_bs_sequence_t		*seq;
+	spdk_bs_sequence_cpl		cb_fn;
+	void				*cb_arg;
+	TAILQ_ENTRY(spdk_blob_persist_ctx) link;
+};
+
+static void
+bs_batch_clear_dev(struct spdk_blob *blob, spdk_bs_batch_t *batch, uint64_t lba,
+		   uint64_t lba_count)
+{
+	switch (blob->clear_method) {
+	case BLOB_CLEAR_WITH_DEFAULT:
+	case BLOB_CLEAR_WITH_UNMAP:
+		bs_batch_unmap_dev(batch, lba, lba_count);
+		break;
+	case BLOB_CLEAR_WITH_WRITE_ZEROES:
+		bs_batch_write_zeroes_dev(batch, lba, lba_count);
+		break;
+	case BLOB_CLEAR_WITH_NONE:
+	default:
+		break;
+	}
+}
+
+static int
+bs_super_validate(struct spdk_bs_super_block *super, struct spdk_blob_store *bs)
+{
+	uint32_t	crc;
+	static const char zeros[SPDK_BLOBSTORE_TYPE_LENGTH];
+
+	if (super->version > SPDK_BS_VERSION ||
+	    super->version < SPDK_BS_INITIAL_VERSION) {
+		return -EILSEQ;
+	}
+
+	if (memcmp(super->signature, SPDK_BS_SUPER_BLOCK_SIG,
+		   sizeof(super->signature)) != 0) {
+		return -EILSEQ;
+	}
+
+	crc = blob_md_page_calc_crc(super);
+	if (crc != super->crc) {
+		return -EILSEQ;
+	}
+
+	if (memcmp(&bs->bstype, &super->bstype, SPDK_BLOBSTORE_TYPE_LENGTH) == 0) {
+		SPDK_DEBUGLOG(blob, "Bstype matched - loading blobstore\n");
+	} else if (memcmp(&bs->bstype, zeros, SPDK_BLOBSTORE_TYPE_LENGTH) == 0) {
+		SPDK_DEBUGLOG(blob, "Bstype wildcard used - loading blobstore regardless bstype\n");
+	} else {
+		SPDK_DEBUGLOG(blob, "Unexpected bstype\n");
+		SPDK_LOGDUMP(blob, "Expected:", bs->bstype.bstype, SPDK_BLOBSTORE_TYPE_LENGTH);
+		SPDK_LOGDUMP(blob, "Found:", super->bstype.bstype, SPDK_BLOBSTORE_TYPE_LENGTH);
+		return -ENXIO;
+	}
+
+	if (super->size > bs->dev->blockcnt * bs->dev->blocklen) {
+		SPDK_NOTICELOG("Size mismatch, dev size: %" PRIu64 ", blobstore size: %" PRIu64 "\n",
+			       bs->dev->blockcnt * bs->dev->blocklen, super->size);
+		return -EILSEQ;
+	}
+
+	return 0;
+}
+
+static void bs_mark_dirty(spdk_bs_sequence_t *seq, struct spdk_blob_store *bs,
+			  spdk_bs_sequence_cpl cb_fn, void *cb_arg);
+
+static void
+blob_persist_complete_cb(void *arg)
+{
+	struct spdk_blob_persist_ctx *ctx = arg;
+
+	/* Call user callback */
+	ctx->cb_fn(ctx->seq, ctx->cb_arg, 0);
+
+	/* Free the memory */
+	spdk_free(ctx->pages);
+	free(ctx);
+}
+
+static void blob_persist_start(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
+
+static void
+blob_persist_complete(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*next_persist, *tmp;
+	struct spdk_blob		*blob = ctx->blob;
+
+	if (bserrno == 0) {
+		blob_mark_clean(blob);
+	}
+
+	assert(ctx == TAILQ_FIRST(&blob->persists_to_complete));
+
+	/* Complete all persists that were pending when the current persist started */
+	TAILQ_FOREACH_SAFE(next_persist, &blob->persists_to_complete, link, tmp) {
+		TAILQ_REMOVE(&blob->persists_to_complete, next_persist, link);
+		spdk_thread_send_msg(spdk_get_thread(), blob_persist_complete_cb, next_persist);
+	}
+
+	if (TAILQ_EMPTY(&blob->pending_persists)) {
+		return;
+	}
+
+	/* Queue up all pending persists for completion and start blob persist with first one */
+	TAILQ_SWAP(&blob->persists_to_complete, &blob->pending_persists, spdk_blob_persist_ctx, link);
+	next_persist = TAILQ_FIRST(&blob->persists_to_complete);
+
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	bs_mark_dirty(seq, blob->bs, blob_persist_start, next_persist);
+}
+
+static void
+blob_persist_clear_extents_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	size_t				i;
+
+	if (bserrno != 0) {
+		blob_persist_complete(seq, ctx, bserrno);
+		return;
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+
+	/* Release all extent_pages that were truncated */
+	for (i = blob->active.num_extent_pages; i < blob->active.extent_pages_array_size; i++) {
+		/* Nothing to release if it was not allocated */
+		if (blob->active.extent_pages[i] != 0) {
+			bs_release_md_page(bs, blob->active.extent_pages[i]);
+		}
+	}
+
+	spdk_spin_unlock(&bs->used_lock);
+
+	spdk_spin_lock(&blob->md_lock);
+	if (blob->active.num_extent_pages == 0) {
+		free(blob->active.extent_pages);
+		blob->active.extent_pages = NULL;
+		blob->active.extent_pages_array_size = 0;
+	} else if (blob->active.num_extent_pages != blob->active.extent_pages_array_size) {
+#ifndef __clang_analyzer__
+		void *tmp;
+
+		/* scan-build really can't figure reallocs, workaround it */
+		tmp = realloc(blob->active.extent_pages, sizeof(uint32_t) * blob->active.num_extent_pages);
+		assert(tmp != NULL);
+		blob->active.extent_pages = tmp;
+#endif
+		blob->active.extent_pages_array_size = blob->active.num_extent_pages;
+	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	blob_persist_complete(seq, ctx, bserrno);
+}
+
+static void
+blob_persist_clear_extents(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx)
+{
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	size_t				i;
+	uint64_t                        lba;
+	uint64_t                        lba_count;
+	spdk_bs_batch_t                 *batch;
+
+	batch = bs_sequence_to_batch(seq, blob_persist_clear_extents_cpl, ctx);
+	lba_count = bs_byte_to_lba(bs, bs->md_page_size);
+
+	/* Clear all extent_pages that were truncated */
+	for (i = blob->active.num_extent_pages; i < blob->active.extent_pages_array_size; i++) {
+		/* Nothing to clear if it was not allocated */
+		if (blob->active.extent_pages[i] != 0) {
+			lba = bs_md_page_to_lba(bs, blob->active.extent_pages[i]);
+			bs_batch_write_zeroes_dev(batch, lba, lba_count);
+		}
+	}
+
+	bs_batch_close(batch);
+}
+
+static void
+blob_persist_clear_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	size_t				i;
+
+	if (bserrno != 0) {
+		blob_persist_complete(seq, ctx, bserrno);
+		return;
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+	/* Release all clusters that were truncated */
+	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
+		uint32_t cluster_num = bs_lba_to_cluster(bs, blob->active.clusters[i]);
+
+		/* Nothing to release if it was not allocated */
+		if (blob->active.clusters[i] != 0) {
+			bs_release_cluster(bs, cluster_num);
+		}
+
+		if (i < blob->num_sub_cluster_masks) {
+			blob->sub_cluster_masks[i] = 0;
+		}
+	}
+	spdk_spin_unlock(&bs->used_lock);
+
+	spdk_spin_lock(&blob->md_lock);
+	if (blob->active.num_clusters == 0) {
+		free(blob->active.clusters);
+		blob->active.clusters = NULL;
+		blob->active.cluster_array_size = 0;
+	} else if (blob->active.num_clusters != blob->active.cluster_array_size) {
+#ifndef __clang_analyzer__
+		void *tmp;
+
+		/* scan-build really can't figure reallocs, workaround it */
+		tmp = realloc(blob->active.clusters, sizeof(*blob->active.clusters) * blob->active.num_clusters);
+		assert(tmp != NULL);
+		blob->active.clusters = tmp;
+
+#endif
+		blob->active.cluster_array_size = blob->active.num_clusters;
+	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	/* Move on to clearing extent pages */
+	blob_persist_clear_extents(seq, ctx);
+}
+
+static void
+blob_persist_clear_clusters(spdk_bs_sequence_t *seq, struct spdk_blob_persist_ctx *ctx)
+{
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	spdk_bs_batch_t			*batch;
+	size_t				i;
+	uint64_t			lba;
+	uint64_t			lba_count;
+
+	/* Clusters don't move around in blobs. The list shrinks or grows
+	 * at the end, but no changes ever occur in the middle of the list.
+	 */
+
+	batch = bs_sequence_to_batch(seq, blob_persist_clear_clusters_cpl, ctx);
+
+	/* Clear all clusters that were truncated */
+	lba = 0;
+	lba_count = 0;
+	for (i = blob->active.num_clusters; i < blob->active.cluster_array_size; i++) {
+		uint64_t next_lba = blob->active.clusters[i];
+		uint64_t next_lba_count = bs_cluster_to_lba(bs, 1);
+
+		if (next_lba > 0 && (lba + lba_count) == next_lba) {
+			/* This cluster is contiguous with the previous one. */
+			lba_count += next_lba_count;
+			continue;
+		} else if (next_lba == 0) {
+			continue;
+		}
+
+		/* This cluster is not contiguous with the previous one. */
+
+		/* If a run of LBAs previously existing, clear them now */
+		if (lba_count > 0) {
+			bs_batch_clear_dev(ctx->blob, batch, lba, lba_count);
+		}
+
+		/* Start building the next batch */
+		lba = next_lba;
+		if (next_lba > 0) {
+			lba_count = next_lba_count;
+		} else {
+			lba_count = 0;
+		}
+	}
+
+	/* If we ended with a contiguous set of LBAs, clear them now */
+	if (lba_count > 0) {
+		bs_batch_clear_dev(ctx->blob, batch, lba, lba_count);
+	}
+
+	bs_batch_close(batch);
+}
+
+static void
+blob_persist_zero_pages_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	size_t				i;
+
+	if (bserrno != 0) {
+		blob_persist_complete(seq, ctx, bserrno);
+		return;
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+
+	/* This loop starts at 1 because the first page is special and handled
+	 * below. The pages (except the first) are never written in place,
+	 * so any pages in the clean list must be zeroed.
+	 */
+	for (i = 1; i < blob->clean.num_pages; i++) {
+		bs_release_md_page(bs, blob->clean.pages[i]);
+	}
+
+	if (blob->active.num_pages == 0) {
+		uint32_t page_num;
+
+		page_num = bs_blobid_to_page(blob->id);
+		bs_release_md_page(bs, page_num);
+	}
+
+	spdk_spin_unlock(&bs->used_lock);
+
+	/* Move on to clearing clusters */
+	blob_persist_clear_clusters(seq, ctx);
+}
+
+static void
+blob_persist_zero_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_persist_ctx	*ctx = cb_arg;
+	struct spdk_blob		*blob = ctx->blob;
+	struct spdk_blob_store		*bs = blob->bs;
+	uint64_t			lba;
+	uint64_t			lba_count;
+	spdk_bs_batch_t			*batch;
+	size_t				i;
+
+	if (bserrno != 0) {
+		blob_persist_complete(seq, ctx, bserrno);
+		return;
+	}
+
+	batch = bs_sequence_to_batch(seq, blob_persist_zero_pages_cpl, ctx);
 
 	lba_count = bs_byte_to_lba(bs, bs->md_page_size);
 
@@ -2310,6 +3462,19 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 			blob->active.extent_pages = ep_tmp;
 			blob->active.extent_pages_array_size = new_num_ep;
 		}
+
+		/* Expand the sub-cluster masks, which are never shrunk */
+		if (blob->io_units_per_sub_cluster != 0 && sz > blob->num_sub_cluster_masks) {
+			tmp = realloc(blob->sub_cluster_masks, sizeof(*blob->sub_cluster_masks) * sz);
+			if (tmp == NULL) {
+				rc = -ENOMEM;
+				goto out;
+			}
+			memset(tmp + blob->num_sub_cluster_masks, 0,
+			       sizeof(*blob->sub_cluster_masks) * (sz - blob->num_sub_cluster_masks));
+			blob->sub_cluster_masks = tmp;
+			blob->num_sub_cluster_masks = sz;
+		}
 	}
 
 	blob->state = SPDK_BLOB_STATE_DIRTY;
@@ -2627,28 +3792,49 @@ struct spdk_blob_copy_cluster_ctx {
 	uint64_t new_cluster;
 	uint32_t new_extent_page;
 	spdk_bs_sequence_t *seq;
-	struct spdk_blob_md_page *new_cluster_page;
+	/* Range copied from the backing device, in io units from the start of the cluster */
+	uint64_t copy_offset;
+	uint64_t copy_length;
+	/* Sub-clusters left in the backing device by a new cluster, or copied by a fill */
+	uint64_t sub_cluster_mask;
+	/* Thread that copies sub-clusters into an allocated cluster */
+	struct spdk_thread *thread;
+	TAILQ_ENTRY(spdk_blob_copy_cluster_ctx) link;
+	/* Set once the new cluster is in the in-memory cluster map of the blob */
+	bool mapped;
+	/* Set once the metadata update of the new cluster is persisted */
+	bool persisted;
+	int bserrno;
+	/* User ops to the new cluster that were issued before the metadata was persisted */
+	uint32_t num_held_ops;
+	TAILQ_HEAD(, spdk_blob_held_op) held_ops;
+};
+
+/* Completion of a user op held until the metadata of the cluster it wrote to is persisted */
+struct spdk_blob_held_op {
+	struct spdk_blob_copy_cluster_ctx *ctx;
+	spdk_blob_op_complete cb_fn;
+	void *cb_arg;
+	int bserrno;
+	TAILQ_ENTRY(spdk_blob_held_op) link;
 };
 
 struct spdk_blob_free_cluster_ctx {
 	struct spdk_blob *blob;
 	uint64_t page;
-	struct spdk_blob_md_page *md_page;
 	uint64_t cluster_num;
 	uint32_t extent_page;
 	spdk_bs_sequence_t *seq;
 };
 
 static void
-blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
+bs_channel_resume_cluster_alloc(struct spdk_bs_channel *ch, int bserrno)
 {
-	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
-	struct spdk_bs_request_set *set = (struct spdk_bs_request_set *)ctx->seq;
 	TAILQ_HEAD(, spdk_bs_request_set) requests;
 	spdk_bs_user_op_t *op;
 
 	TAILQ_INIT(&requests);
-	TAILQ_SWAP(&set->channel->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+	TAILQ_SWAP(&ch->need_cluster_alloc, &requests, spdk_bs_request_set, link);
 
 	while (!TAILQ_EMPTY(&requests)) {
 		op = TAILQ_FIRST(&requests);
@@ -2659,11 +3845,188 @@ blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
 			bs_user_op_abort(op, bserrno);
 		}
 	}
+}
 
+static void
+blob_copy_cluster_ctx_free(struct spdk_blob_copy_cluster_ctx *ctx)
+{
 	spdk_free(ctx->buf);
 	free(ctx);
 }
 
+static void
+blob_held_op_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_held_op *held = cb_arg;
+	struct spdk_blob_copy_cluster_ctx *ctx = held->ctx;
+
+	if (!ctx->persisted) {
+		held->bserrno = bserrno;
+		TAILQ_INSERT_TAIL(&ctx->held_ops, held, link);
+		return;
+	}
+
+	held->cb_fn(held->cb_arg, bserrno ? bserrno : ctx->bserrno);
+	free(held);
+
+	if (--ctx->num_held_ops == 0) {
+		blob_copy_cluster_ctx_free(ctx);
+	}
+}
+
+static bool
+blob_copy_cluster_op_overlaps(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op)
+{
+	struct spdk_bs_user_op_args *args = &((struct spdk_bs_request_set *)op)->u.user_op;
+
+	if (args->blob != ctx->blob || args->type == SPDK_BLOB_READ ||
+	    args->type == SPDK_BLOB_READV) {
+		return false;
+	}
+
+	return args->offset < ctx->io_unit + bs_io_units_per_cluster(ctx->blob) &&
+	       args->offset + args->length > ctx->io_unit;
+}
+
+/*
+ * Called on the allocating thread as soon as the new cluster is inserted into the in-memory
+ * cluster map, while the metadata update is still being persisted. The queued user ops are
+ * issued right away, so that the data write of the first write to a cluster overlaps with the
+ * metadata write instead of following it. Writes to the new cluster complete only once the
+ * metadata is persisted too.
+ *
+ * This does not change what a crash may leave behind: the new cluster either holds the data
+ * copied from the backing device or, for clusters backed by zeroes, was cleared when it was
+ * freed. Until the user op completes, the cluster reads the same whether or not the metadata
+ * or the data write made it to disk.
+ */
+static void
+blob_insert_cluster_mapped(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+	struct spdk_bs_request_set *set = (struct spdk_bs_request_set *)ctx->seq;
+	struct spdk_bs_channel *ch = set->channel;
+	TAILQ_HEAD(, spdk_bs_request_set) requests;
+	struct spdk_blob_held_op *held;
+	spdk_bs_user_op_t *op;
+
+	ctx->mapped = true;
+
+	TAILQ_INIT(&requests);
+	TAILQ_SWAP(&ch->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+
+	while (!TAILQ_EMPTY(&requests)) {
+		op = TAILQ_FIRST(&requests);
+		TAILQ_REMOVE(&requests, op, link);
+
+		if (blob_copy_cluster_op_overlaps(ctx, op)) {
+			held = calloc(1, sizeof(*held));
+			if (held == NULL) {
+				bs_user_op_abort(op, -ENOMEM);
+				continue;
+			}
+
+			set = (struct spdk_bs_request_set *)op;
+			held->ctx = ctx;
+			held->cb_fn = set->cpl.u.blob_basic.cb_fn;
+			held->cb_arg = set->cpl.u.blob_basic.cb_arg;
+			set->cpl.u.blob_basic.cb_fn = blob_held_op_cpl;
+			set->cpl.u.blob_basic.cb_arg = held;
+			ctx->num_held_ops++;
+		}
+
+		bs_user_op_execute(op);
+	}
+}
+
+static void
+blob_allocate_and_copy_cluster_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+	struct spdk_bs_request_set *set = (struct spdk_bs_request_set *)ctx->seq;
+	struct spdk_blob_held_op *held;
+
+	if (!ctx->mapped) {
+		bs_channel_resume_cluster_alloc(set->channel, bserrno);
+	}
+
+	ctx->persisted = true;
+	ctx->bserrno = bserrno;
+
+	while (!TAILQ_EMPTY(&ctx->held_ops)) {
+		held = TAILQ_FIRST(&ctx->held_ops);
+		TAILQ_REMOVE(&ctx->held_ops, held, link);
+		held->cb_fn(held->cb_arg, held->bserrno ? held->bserrno : bserrno);
+		free(held);
+		ctx->num_held_ops--;
+	}
+
+	if (ctx->num_held_ops == 0) {
+		blob_copy_cluster_ctx_free(ctx);
+	}
+}
+
+static void
+bs_channel_release_clusters_iter(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+
+	bs_channel_release_clusters(spdk_io_channel_get_ctx(_ch));
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static bool
+bs_has_reserved_clusters(struct spdk_blob_store *bs)
+{
+	return __atomic_load_n(&bs->num_reserved_clusters, __ATOMIC_RELAXED) > 0;
+}
+
+static void
+bs_reclaim_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_ctx(i);
+
+	bs_channel_resume_cluster_alloc(spdk_io_channel_get_ctx(_ch), status);
+
+	spdk_put_io_channel(_ch);
+}
+
+/*
+ * The free clusters may all be reserved by other channels. Return the reservations of all
+ * channels to the blobstore and retry the queued user ops. Return false if no channel
+ * reserved clusters since the last time they were reclaimed for this channel.
+ */
+static bool
+bs_channel_reclaim_clusters(struct spdk_bs_channel *ch, spdk_bs_user_op_t *op)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	struct spdk_io_channel *_ch;
+	uint64_t gen;
+
+	spdk_spin_lock(&bs->used_lock);
+	gen = bs->cluster_reserve_gen;
+	spdk_spin_unlock(&bs->used_lock);
+
+	if (gen == ch->cluster_reclaim_gen) {
+		return false;
+	}
+
+	/* Hold a reference so that the channel outlives the iteration. */
+	_ch = spdk_get_io_channel(bs);
+	if (_ch == NULL) {
+		return false;
+	}
+	assert(spdk_io_channel_get_ctx(_ch) == ch);
+
+	ch->cluster_reclaim_gen = gen;
+	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+
+	spdk_for_each_channel(bs, bs_channel_release_clusters_iter, _ch, bs_reclaim_clusters_done);
+
+	return true;
+}
+
 static void
 blob_free_cluster_cpl(void *cb_arg, int bserrno)
 {
@@ -2714,103 +4077,400 @@ blob_insert_cluster_clear(struct spdk_blob_copy_cluster_ctx *ctx)
 	 * reading from this thick-provisioned blob before writing data, we should read zeroes.
 	 */
 
-	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-	cpl.u.blob_basic.cb_fn = blob_insert_cluster_clear_cpl;
-	cpl.u.blob_basic.cb_arg = ctx;
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_insert_cluster_clear_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	batch = bs_batch_open(ch, &cpl, ctx->blob);
+	if (!batch) {
+		blob_insert_cluster_clear_cpl(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_batch_clear_dev(ctx->blob, batch, bs_cluster_to_lba(ctx->blob->bs, ctx->new_cluster),
+			   bs_cluster_to_lba(ctx->blob->bs, 1));
+	bs_batch_close(batch);
+}
+
+static void
+blob_insert_cluster_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+
+	if (bserrno) {
+		if (bserrno == -EEXIST) {
+			/* The metadata insert failed because another thread
+			 * allocated the cluster first. Clear and free our cluster
+			 * but continue without error. */
+			blob_insert_cluster_clear(ctx);
+			return;
+		}
+
+		blob_insert_cluster_revert(ctx);
+	}
+
+	bs_sequence_finish(ctx->seq, bserrno);
+}
+
+static void
+blob_write_copy_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+	uint32_t cluster_number;
+
+	if (bserrno) {
+		/* The write failed, so jump to the final completion handler */
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	cluster_number = bs_io_unit_to_cluster(ctx->blob->bs, ctx->io_unit);
+
+	blob_insert_cluster_persist(ctx->blob, spdk_io_channel_from_ctx(ctx->seq->channel),
+				    cluster_number, ctx->new_cluster, ctx->sub_cluster_mask,
+				    ctx->new_extent_page, blob_insert_cluster_mapped,
+				    blob_insert_cluster_cpl, ctx);
+}
+
+static void
+blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		/* The read failed, so jump to the final completion handler */
+		bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	/* Write the copied part of the cluster */
+	bs_sequence_write_dev(seq, ctx->buf,
+			      bs_cluster_to_lba(ctx->blob->bs, ctx->new_cluster) + ctx->copy_offset,
+			      ctx->copy_length,
+			      blob_write_copy_cpl, ctx);
+}
+
+static bool
+blob_can_copy(struct spdk_blob *blob, uint64_t cluster_start_io_unit, uint64_t *base_lba)
+{
+	uint64_t lba = bs_dev_io_unit_to_lba(blob, blob->back_bs_dev, cluster_start_io_unit);
+
+	return (!blob_is_esnap_clone(blob) && blob->bs->dev->copy != NULL) &&
+	       blob->back_bs_dev->translate_lba(blob->back_bs_dev, lba, base_lba);
+}
+
+static void
+blob_copy(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op, uint64_t src_lba)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t lba_count = bs_dev_byte_to_lba(blob->back_bs_dev,
+						ctx->copy_length * blob->bs->io_unit_size);
+
+	bs_sequence_copy_dev(ctx->seq,
+			     bs_cluster_to_lba(blob->bs, ctx->new_cluster) + ctx->copy_offset,
+			     src_lba + ctx->copy_offset,
+			     lba_count,
+			     blob_write_copy_cpl, ctx);
+}
+
+/* Given a user op, look up the sub-clusters it touches in the cluster at ctx->io_unit */
+static uint64_t
+blob_user_op_sub_cluster_mask(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op)
+{
+	struct spdk_bs_user_op_args *args = &((struct spdk_bs_request_set *)op)->u.user_op;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t start, end;
+
+	start = spdk_max(args->offset, ctx->io_unit);
+	end = spdk_min(args->offset + args->length, ctx->io_unit + bs_io_units_per_cluster(blob));
+	assert(start < end);
+
+	return bs_io_units_to_sub_cluster_mask(blob, start, end - start);
+}
+
+/*
+ * Limit the copy of a new cluster from the backing device to the sub-clusters that the user op
+ * touches. The other sub-clusters are left in the backing device, and read from there, until
+ * they are written to. Returns the mask of the sub-clusters that are not copied.
+ */
+static uint64_t
+blob_sub_cluster_copy_range(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op)
+{
+	struct spdk_bs_user_op_args *args = &((struct spdk_bs_request_set *)op)->u.user_op;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t touched;
+	uint32_t first, last;
+
+	ctx->copy_offset = 0;
+	ctx->copy_length = bs_io_units_per_cluster(blob);
+
+	/* Inflate and decouple touch clusters with 0 length ops, those copy whole clusters */
+	if (blob->io_units_per_sub_cluster == 0 || args->length == 0) {
+		return 0;
+	}
+
+	touched = blob_user_op_sub_cluster_mask(ctx, op);
+	first = __builtin_ctzll(touched);
+	last = 63 - __builtin_clzll(touched);
+
+	ctx->copy_offset = first * blob->io_units_per_sub_cluster;
+	ctx->copy_length = (last - first + 1) * blob->io_units_per_sub_cluster;
+
+	return bs_sub_cluster_full_mask(blob) & ~touched;
+}
+
+static void blob_claim_sub_clusters_msg(void *arg);
+static void blob_fill_sub_clusters_copy(struct spdk_blob_copy_cluster_ctx *ctx);
+
+static void
+blob_fill_sub_clusters_done(void *arg)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = arg;
+
+	bs_sequence_finish(ctx->seq, ctx->bserrno);
+}
+
+static void
+blob_fill_sub_clusters_mapped(void *arg)
+{
+	blob_insert_cluster_mapped(arg, 0);
+}
+
+static void
+blob_fill_sub_clusters_persist_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+
+	ctx->bserrno = bserrno;
+	spdk_thread_send_msg(ctx->thread, blob_fill_sub_clusters_done, ctx);
+}
+
+/* Runs on md_thread once the claimed sub-clusters are copied, or failed to be */
+static void
+blob_fill_sub_clusters_msg(void *arg)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint32_t cluster_num = bs_io_unit_to_cluster_number(blob, ctx->io_unit);
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) waiters;
+	struct spdk_blob_copy_cluster_ctx *waiter;
+
+	TAILQ_REMOVE(&blob->sub_cluster_fills, ctx, link);
+
+	if (ctx->bserrno == 0 && cluster_num < blob->num_sub_cluster_masks) {
+		blob->sub_cluster_masks[cluster_num] &= ~ctx->sub_cluster_mask;
+	}
+
+	/* The fills that waited for these sub-clusters check again what is left to copy */
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&blob->sub_cluster_fill_waiters, &waiters, spdk_blob_copy_cluster_ctx, link);
+	while (!TAILQ_EMPTY(&waiters)) {
+		waiter = TAILQ_FIRST(&waiters);
+		TAILQ_REMOVE(&waiters, waiter, link);
+		blob_claim_sub_clusters_msg(waiter);
+	}
+
+	if (ctx->bserrno != 0) {
+		spdk_thread_send_msg(ctx->thread, blob_fill_sub_clusters_done, ctx);
+		return;
+	}
+
+	/* Messages to a thread are executed in order, so this one runs before the completion
+	 * of the metadata update below. */
+	spdk_thread_send_msg(ctx->thread, blob_fill_sub_clusters_mapped, ctx);
+
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	blob_sync_md(blob, blob_fill_sub_clusters_persist_cpl, ctx);
+}
 
-	batch = bs_batch_open(ch, &cpl, ctx->blob);
-	if (!batch) {
-		blob_insert_cluster_clear_cpl(ctx, -ENOMEM);
+static void
+blob_fill_sub_clusters_failed(struct spdk_blob_copy_cluster_ctx *ctx, int bserrno)
+{
+	ctx->bserrno = bserrno;
+	spdk_thread_send_msg(ctx->blob->bs->md_thread, blob_fill_sub_clusters_msg, ctx);
+}
+
+static void
+blob_fill_sub_clusters_write_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		blob_fill_sub_clusters_failed(ctx, bserrno);
 		return;
 	}
 
-	bs_batch_clear_dev(ctx->blob, batch, bs_cluster_to_lba(ctx->blob->bs, ctx->new_cluster),
-			   bs_cluster_to_lba(ctx->blob->bs, 1));
-	bs_batch_close(batch);
+	ctx->copy_offset += ctx->copy_length;
+	blob_fill_sub_clusters_copy(ctx);
 }
 
 static void
-blob_insert_cluster_cpl(void *cb_arg, int bserrno)
+blob_fill_sub_clusters_read_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
 	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
 
-	if (bserrno) {
-		if (bserrno == -EEXIST) {
-			/* The metadata insert failed because another thread
-			 * allocated the cluster first. Clear and free our cluster
-			 * but continue without error. */
-			blob_insert_cluster_clear(ctx);
-			return;
-		}
-
-		blob_insert_cluster_revert(ctx);
+	if (bserrno != 0) {
+		blob_fill_sub_clusters_failed(ctx, bserrno);
+		return;
 	}
 
-	bs_sequence_finish(ctx->seq, bserrno);
+	bs_sequence_write_dev(seq, ctx->buf,
+			      bs_blob_io_unit_to_lba(ctx->blob, ctx->io_unit + ctx->copy_offset),
+			      ctx->copy_length, blob_fill_sub_clusters_write_cpl, ctx);
 }
 
+/* Copy the next run of claimed sub-clusters, starting at ctx->copy_offset */
 static void
-blob_write_copy_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_fill_sub_clusters_copy(struct spdk_blob_copy_cluster_ctx *ctx)
 {
-	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
-	uint32_t cluster_number;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t next = ctx->copy_offset / blob->io_units_per_sub_cluster;
+	uint64_t mask, run;
+	uint32_t first, count;
 
-	if (bserrno) {
-		/* The write failed, so jump to the final completion handler */
-		bs_sequence_finish(seq, bserrno);
+	mask = next < 64 ? ctx->sub_cluster_mask & (UINT64_MAX << next) : 0;
+	if (mask == 0) {
+		spdk_thread_send_msg(blob->bs->md_thread, blob_fill_sub_clusters_msg, ctx);
 		return;
 	}
 
-	cluster_number = bs_io_unit_to_cluster(ctx->blob->bs, ctx->io_unit);
+	first = __builtin_ctzll(mask);
+	run = ~(mask >> first);
+	count = run == 0 ? 64 - first : (uint32_t)__builtin_ctzll(run);
+
+	ctx->copy_offset = first * blob->io_units_per_sub_cluster;
+	ctx->copy_length = count * blob->io_units_per_sub_cluster;
 
-	blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
-					 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
+	bs_sequence_read_bs_dev(ctx->seq, blob->back_bs_dev, ctx->buf,
+				bs_dev_io_unit_to_lba(blob, blob->back_bs_dev, ctx->io_unit + ctx->copy_offset),
+				bs_dev_byte_to_lba(blob->back_bs_dev, ctx->copy_length * blob->bs->io_unit_size),
+				blob_fill_sub_clusters_read_cpl, ctx);
 }
 
 static void
-blob_write_copy(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+blob_fill_sub_clusters_start(void *arg)
 {
-	struct spdk_blob_copy_cluster_ctx *ctx = cb_arg;
+	struct spdk_blob_copy_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t num_sub_clusters;
+	uint64_t buf_sz;
 
-	if (bserrno != 0) {
-		/* The read failed, so jump to the final completion handler */
-		bs_sequence_finish(seq, bserrno);
+	/* A buffer for the span of the claimed sub-clusters fits all of their runs */
+	num_sub_clusters = 64 - __builtin_clzll(ctx->sub_cluster_mask) -
+			   __builtin_ctzll(ctx->sub_cluster_mask);
+	buf_sz = num_sub_clusters * blob->io_units_per_sub_cluster * blob->bs->io_unit_size;
+	ctx->buf = spdk_malloc(buf_sz, blob->back_bs_dev->blocklen, NULL, SPDK_ENV_NUMA_ID_ANY,
+			       SPDK_MALLOC_DMA);
+	if (ctx->buf == NULL) {
+		blob_fill_sub_clusters_failed(ctx, -ENOMEM);
 		return;
 	}
 
-	/* Write whole cluster */
-	bs_sequence_write_dev(seq, ctx->buf,
-			      bs_cluster_to_lba(ctx->blob->bs, ctx->new_cluster),
-			      bs_cluster_to_lba(ctx->blob->bs, 1),
-			      blob_write_copy_cpl, ctx);
+	ctx->copy_offset = 0;
+	blob_fill_sub_clusters_copy(ctx);
 }
 
-static bool
-blob_can_copy(struct spdk_blob *blob, uint64_t cluster_start_io_unit, uint64_t *base_lba)
+/*
+ * Runs on md_thread. Claim the sub-clusters that still have to be copied, so that each is
+ * copied only once and never over data written to it after it was copied.
+ */
+static void
+blob_claim_sub_clusters_msg(void *arg)
 {
-	uint64_t lba = bs_dev_io_unit_to_lba(blob, blob->back_bs_dev, cluster_start_io_unit);
+	struct spdk_blob_copy_cluster_ctx *ctx = arg;
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_copy_cluster_ctx *fill;
+	uint64_t claimed = 0;
+	uint64_t mask;
 
-	return (!blob_is_esnap_clone(blob) && blob->bs->dev->copy != NULL) &&
-	       blob->back_bs_dev->translate_lba(blob->back_bs_dev, lba, base_lba);
+	mask = bs_cluster_invalid_sub_clusters(blob, bs_io_unit_to_cluster_number(blob, ctx->io_unit)) &
+	       ctx->sub_cluster_mask;
+
+	TAILQ_FOREACH(fill, &blob->sub_cluster_fills, link) {
+		if (fill->io_unit == ctx->io_unit) {
+			claimed |= fill->sub_cluster_mask;
+		}
+	}
+
+	if ((mask & claimed) != 0) {
+		TAILQ_INSERT_TAIL(&blob->sub_cluster_fill_waiters, ctx, link);
+		return;
+	}
+
+	ctx->sub_cluster_mask = mask;
+	if (mask == 0) {
+		/* Nothing left to copy, the user op is just issued again */
+		ctx->bserrno = 0;
+		spdk_thread_send_msg(ctx->thread, blob_fill_sub_clusters_done, ctx);
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&blob->sub_cluster_fills, ctx, link);
+	spdk_thread_send_msg(ctx->thread, blob_fill_sub_clusters_start, ctx);
 }
 
+/*
+ * The cluster the user op touches is allocated, but some of the sub-clusters it touches are not
+ * copied from the backing device yet. Copy them, then issue the op again. A 0 length op copies
+ * all the sub-clusters that are left. The pin on the extent page of the cluster, if any, is
+ * held until the copy completes.
+ */
 static void
-blob_copy(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op, uint64_t src_lba)
+bs_fill_sub_clusters(struct spdk_blob *blob, struct spdk_io_channel *_ch,
+		     uint64_t io_unit, spdk_bs_user_op_t *op, struct spdk_blob_ep_segment *segment)
 {
-	struct spdk_blob *blob = ctx->blob;
-	uint64_t lba_count = bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_bs_user_op_args *args = &((struct spdk_bs_request_set *)op)->u.user_op;
+	struct spdk_blob_copy_cluster_ctx *ctx;
+	struct spdk_bs_cpl cpl;
 
-	bs_sequence_copy_dev(ctx->seq,
-			     bs_cluster_to_lba(blob->bs, ctx->new_cluster),
-			     src_lba,
-			     lba_count,
-			     blob_write_copy_cpl, ctx);
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		bs_ep_segment_unpin(segment);
+		bs_user_op_abort(op, -ENOMEM);
+		return;
+	}
+
+	ctx->blob = blob;
+	ctx->io_unit = bs_io_unit_to_cluster_start(blob, io_unit);
+	ctx->thread = spdk_get_thread();
+	TAILQ_INIT(&ctx->held_ops);
+
+	if (blob->io_units_per_sub_cluster == 0 || args->length == 0) {
+		ctx->sub_cluster_mask = UINT64_MAX;
+	} else {
+		ctx->sub_cluster_mask = blob_user_op_sub_cluster_mask(ctx, op);
+	}
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_allocate_and_copy_cluster_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	ctx->seq = bs_sequence_start_blob(_ch, &cpl, blob);
+	if (!ctx->seq) {
+		free(ctx);
+		bs_ep_segment_unpin(segment);
+		bs_user_op_abort(op, -ENOMEM);
+		return;
+	}
+	ctx->seq->ep_segment = segment;
+
+	/* Queue the user op to block other incoming operations */
+	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+
+	spdk_thread_send_msg(blob->bs->md_thread, blob_claim_sub_clusters_msg, ctx);
 }
 
+/*
+ * Allocate the cluster the user op touches, copy it from the backing device if needed, then
+ * issue the op again. segment is the extent page of the cluster the op pinned, if any. The pin
+ * is held until the cluster is persisted.
+ */
 static void
 bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 			     struct spdk_io_channel *_ch,
-			     uint64_t io_unit, spdk_bs_user_op_t *op)
+			     uint64_t io_unit, spdk_bs_user_op_t *op,
+			     struct spdk_blob_ep_segment *segment)
 {
 	struct spdk_bs_cpl cpl;
 	struct spdk_bs_channel *ch;
@@ -2830,6 +4490,7 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		 * and return because it will be re-executed when the outstanding
 		 * cluster allocation completes. */
 		TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+		bs_ep_segment_unpin(segment);
 		return;
 	}
 
@@ -2840,8 +4501,15 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	 * cluster is supposed to be at. */
 	cluster_number = bs_io_unit_to_cluster_number(blob, io_unit);
 
+	if (bs_cluster_is_allocated(blob, cluster_number)) {
+		/* Allocated in the meantime, or only partially copied */
+		bs_fill_sub_clusters(blob, _ch, io_unit, op, segment);
+		return;
+	}
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
+		bs_ep_segment_unpin(segment);
 		bs_user_op_abort(op, -ENOMEM);
 		return;
 	}
@@ -2850,8 +4518,7 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 
 	ctx->blob = blob;
 	ctx->io_unit = cluster_start_io_unit;
-	ctx->new_cluster_page = ch->new_cluster_page;
-	memset(ctx->new_cluster_page, 0, blob->bs->md_page_size);
+	TAILQ_INIT(&ctx->held_ops);
 
 	/* Check if the cluster that we intend to do CoW for is valid for
 	 * the backing dev. For zeroes backing dev, it'll be always valid.
@@ -2866,25 +4533,32 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	is_zeroes = is_valid_range && blob->back_bs_dev->is_zeroes(blob->back_bs_dev,
 			bs_dev_io_unit_to_lba(blob, blob->back_bs_dev, cluster_start_io_unit),
 			bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz));
-	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes && !can_copy) {
-		ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen,
-				       NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
-		if (!ctx->buf) {
-			SPDK_ERRLOG("DMA allocation for cluster of size = %" PRIu32 " failed.\n",
-				    blob->bs->cluster_sz);
-			free(ctx);
-			bs_user_op_abort(op, -ENOMEM);
-			return;
+	if (blob->parent_id != SPDK_BLOBID_INVALID && !is_zeroes) {
+		ctx->sub_cluster_mask = blob_sub_cluster_copy_range(ctx, op);
+		if (!can_copy) {
+			ctx->buf = spdk_malloc(ctx->copy_length * blob->bs->io_unit_size,
+					       blob->back_bs_dev->blocklen,
+					       NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+			if (!ctx->buf) {
+				SPDK_ERRLOG("DMA allocation for cluster of size = %" PRIu32 " failed.\n",
+					    blob->bs->cluster_sz);
+				free(ctx);
+				bs_ep_segment_unpin(segment);
+				bs_user_op_abort(op, -ENOMEM);
+				return;
+			}
 		}
 	}
 
-	spdk_spin_lock(&blob->bs->used_lock);
-	rc = bs_allocate_cluster(blob, cluster_number, &ctx->new_cluster, &ctx->new_extent_page,
-				 false);
-	spdk_spin_unlock(&blob->bs->used_lock);
+	rc = bs_channel_allocate_cluster(ch, blob, cluster_number, &ctx->new_cluster,
+					 &ctx->new_extent_page);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
 		free(ctx);
+		bs_ep_segment_unpin(segment);
+		if (rc == -ENOSPC && bs_channel_reclaim_clusters(ch, op)) {
+			return;
+		}
 		bs_user_op_abort(op, rc);
 		return;
 	}
@@ -2897,12 +4571,17 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 	if (!ctx->seq) {
 		spdk_spin_lock(&blob->bs->used_lock);
 		bs_release_cluster(blob->bs, ctx->new_cluster);
+		if (ctx->new_extent_page != 0) {
+			bs_release_md_page(blob->bs, ctx->new_extent_page);
+		}
 		spdk_spin_unlock(&blob->bs->used_lock);
 		spdk_free(ctx->buf);
 		free(ctx);
+		bs_ep_segment_unpin(segment);
 		bs_user_op_abort(op, -ENOMEM);
 		return;
 	}
+	ctx->seq->ep_segment = segment;
 
 	/* Queue the user op to block other incoming operations */
 	TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
@@ -2911,17 +4590,38 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		if (can_copy) {
 			blob_copy(ctx, op, copy_src_lba);
 		} else {
-			/* Read cluster from backing device */
+			/* Read the part of the cluster to copy from backing device */
 			bs_sequence_read_bs_dev(ctx->seq, blob->back_bs_dev, ctx->buf,
-						bs_dev_io_unit_to_lba(blob, blob->back_bs_dev, cluster_start_io_unit),
-						bs_dev_byte_to_lba(blob->back_bs_dev, blob->bs->cluster_sz),
+						bs_dev_io_unit_to_lba(blob, blob->back_bs_dev,
+								cluster_start_io_unit + ctx->copy_offset),
+						bs_dev_byte_to_lba(blob->back_bs_dev,
+								ctx->copy_length * blob->bs->io_unit_size),
 						blob_write_copy, ctx);
 		}
 
 	} else {
-		blob_insert_cluster_on_md_thread(ctx->blob, cluster_number, ctx->new_cluster,
-						 ctx->new_extent_page, ctx->new_cluster_page, blob_insert_cluster_cpl, ctx);
+		blob_insert_cluster_persist(ctx->blob, spdk_io_channel_from_ctx(ctx->seq->channel),
+					    cluster_number, ctx->new_cluster, 0, ctx->new_extent_page,
+					    blob_insert_cluster_mapped, blob_insert_cluster_cpl, ctx);
+	}
+}
+
+/* Given an io_unit range within a cluster of a blob, look up if any sub-cluster it touches
+ * is still read from the backing device. The range may have been split at a cluster boundary
+ * before a partially copied cluster was inserted by another thread.
+ */
+static inline bool
+blob_io_units_are_partial(struct spdk_blob *blob, uint64_t io_unit, uint64_t length)
+{
+	uint32_t cluster_num = bs_io_unit_to_cluster_number(blob, io_unit);
+	uint64_t invalid_mask;
+
+	invalid_mask = bs_cluster_invalid_sub_clusters(blob, cluster_num);
+	if (invalid_mask == 0 || length == 0) {
+		return false;
 	}
+
+	return (invalid_mask & bs_io_units_to_sub_cluster_mask(blob, io_unit, length)) != 0;
 }
 
 static inline bool
@@ -2930,7 +4630,8 @@ blob_calculate_lba_and_lba_count(struct spdk_blob *blob, uint64_t io_unit, uint6
 {
 	*lba_count = length;
 
-	if (!bs_io_unit_is_allocated(blob, io_unit)) {
+	if (!bs_io_unit_is_allocated(blob, io_unit) ||
+	    blob_io_units_are_partial(blob, io_unit, length)) {
 		assert(blob->back_bs_dev != NULL);
 		*lba = bs_io_unit_to_back_dev_lba(blob, io_unit);
 		*lba_count = bs_io_unit_to_back_dev_lba(blob, *lba_count);
@@ -3080,7 +4781,10 @@ blob_request_submit_op_split(struct spdk_io_channel *ch, struct spdk_blob *blob,
 	cpl.u.blob_basic.cb_fn = cb_fn;
 	cpl.u.blob_basic.cb_arg = cb_arg;
 
-	seq = bs_sequence_start_blob(ch, &cpl, blob);
+	/* The sequence only completes the split operations, which do I/O on the blob on their own.
+	 * Those may be queued while the blob is frozen, so the sequence itself is not tracked as
+	 * I/O to the blob. */
+	seq = bs_sequence_start_bs(ch, &cpl);
 	if (!seq) {
 		free(ctx);
 		cb_fn(cb_arg, -ENOMEM);
@@ -3110,7 +4814,62 @@ spdk_free_cluster_unmap_complete(void *cb_arg, int bserrno)
 	}
 
 	blob_free_cluster_on_md_thread(ctx->blob, ctx->cluster_num,
-				       ctx->extent_page, ctx->md_page, blob_free_cluster_cpl, ctx);
+				       ctx->extent_page, blob_free_cluster_cpl, ctx);
+}
+
+static void
+blob_ep_segment_op_resume(void *cb_arg, int bserrno)
+{
+	spdk_bs_user_op_t *op = cb_arg;
+	struct spdk_bs_channel *channel = op->channel;
+
+	if (bserrno != 0) {
+		bs_user_op_abort(op, bserrno);
+		return;
+	}
+
+	/* Issued again, now that its extent page can be pinned. Its lookup was counted as a miss
+	 * already. */
+	channel->ep_op_resumed = true;
+	bs_user_op_execute(op);
+	channel->ep_op_resumed = false;
+}
+
+/*
+ * Pin the extent page of the cluster an op looks up, for a blob that loads its extent pages on
+ * demand. Returns false if the op is issued again once the extent page is read, or failed.
+ */
+static bool
+blob_request_pin_extent_page(struct spdk_io_channel *_ch, struct spdk_blob *blob,
+			     struct spdk_bs_cpl *cpl, enum spdk_blob_op_type op_type,
+			     void *payload, int iovcnt, uint64_t offset, uint64_t length,
+			     struct spdk_blob_ext_io_opts *ext_io_opts,
+			     struct spdk_blob_ep_segment **segment)
+{
+	struct spdk_bs_channel *channel = spdk_io_channel_get_ctx(_ch);
+	uint64_t cluster_num = bs_io_unit_to_cluster_number(blob, offset);
+	bool count_hit = !channel->ep_op_resumed;
+	spdk_bs_user_op_t *op;
+	int rc;
+
+	channel->ep_op_resumed = false;
+	rc = blob_ep_segment_pin(blob, cluster_num, count_hit, segment);
+	if (spdk_likely(rc == 0)) {
+		return true;
+	}
+
+	if (rc == -ENOENT) {
+		op = bs_user_op_alloc(_ch, cpl, op_type, blob, payload, iovcnt, offset, length);
+		if (op != NULL) {
+			op->ext_io_opts = ext_io_opts;
+			blob_ep_segment_load(blob, _ch, cluster_num, blob_ep_segment_op_resume, op);
+			return false;
+		}
+		rc = -ENOMEM;
+	}
+
+	cpl->u.blob_basic.cb_fn(cpl->u.blob_basic.cb_arg, rc);
+	return false;
 }
 
 static void
@@ -3119,6 +4878,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			      spdk_blob_op_complete cb_fn, void *cb_arg, enum spdk_blob_op_type op_type)
 {
 	struct spdk_bs_cpl cpl;
+	struct spdk_blob_ep_segment *segment = NULL;
 	uint64_t lba;
 	uint64_t lba_count;
 	bool is_allocated;
@@ -3145,6 +4905,12 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 		return;
 	}
 
+	if (spdk_unlikely(blob->ep_on_demand) &&
+	    !blob_request_pin_extent_page(_ch, blob, &cpl, op_type, payload, 0, offset, length, NULL,
+					  &segment)) {
+		return;
+	}
+
 	is_allocated = blob_calculate_lba_and_lba_count(blob, offset, length, &lba, &lba_count);
 
 	switch (op_type) {
@@ -3153,9 +4919,11 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 
 		batch = bs_batch_open(_ch, &cpl, blob);
 		if (!batch) {
+			bs_ep_segment_unpin(segment);
 			cb_fn(cb_arg, -ENOMEM);
 			return;
 		}
+		batch->ep_segment = segment;
 
 		if (is_allocated) {
 			/* Read from the blob */
@@ -3175,15 +4943,18 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			spdk_bs_batch_t *batch;
 
 			if (lba_count == 0) {
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, 0);
 				return;
 			}
 
 			batch = bs_batch_open(_ch, &cpl, blob);
 			if (!batch) {
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
+			batch->ep_segment = segment;
 
 			if (op_type == SPDK_BLOB_WRITE) {
 				bs_batch_write_dev(batch, payload, lba, lba_count);
@@ -3198,11 +4969,12 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 
 			op = bs_user_op_alloc(_ch, &cpl, op_type, blob, payload, 0, offset, length);
 			if (!op) {
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
 
-			bs_allocate_and_copy_cluster(blob, _ch, offset, op);
+			bs_allocate_and_copy_cluster(blob, _ch, offset, op, segment);
 		}
 		break;
 	}
@@ -3214,7 +4986,6 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 		if (spdk_blob_is_thin_provisioned(blob) && is_allocated &&
 		    blob_backed_with_zeroes_dev(blob) &&
 		    bs_io_units_per_cluster(blob) == length) {
-			struct spdk_bs_channel *bs_channel = spdk_io_channel_get_ctx(_ch);
 			uint64_t cluster_start_page;
 			uint32_t cluster_number;
 
@@ -3229,6 +5000,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 
 			ctx = calloc(1, sizeof(*ctx));
 			if (!ctx) {
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
@@ -3242,13 +5014,16 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 			ctx->blob = blob;
 			ctx->page = cluster_start_page;
 			ctx->cluster_num = cluster_number;
-			ctx->md_page = bs_channel->new_cluster_page;
 			ctx->seq = bs_sequence_start_bs(_ch, &cpl);
 			if (!ctx->seq) {
 				free(ctx);
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
+			/* The extent page is updated once the cluster is released */
+			ctx->seq->ep_segment = segment;
+			segment = NULL;
 
 			if (blob->use_extent_table) {
 				ctx->extent_page = *bs_cluster_to_extent_page(blob, cluster_number);
@@ -3260,10 +5035,17 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 
 		batch = bs_batch_open(_ch, &cpl, blob);
 		if (!batch) {
-			free(ctx);
-			cb_fn(cb_arg, -ENOMEM);
+			if (ctx != NULL) {
+				/* Completes the op, and releases the pin it holds */
+				bs_sequence_finish(ctx->seq, -ENOMEM);
+				free(ctx);
+			} else {
+				bs_ep_segment_unpin(segment);
+				cb_fn(cb_arg, -ENOMEM);
+			}
 			return;
 		}
+		batch->ep_segment = segment;
 
 		if (is_allocated) {
 			bs_batch_unmap_dev(batch, lba, lba_count);
@@ -3275,6 +5057,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 	case SPDK_BLOB_READV:
 	case SPDK_BLOB_WRITEV:
 		SPDK_ERRLOG("readv/write not valid\n");
+		bs_ep_segment_unpin(segment);
 		cb_fn(cb_arg, -EINVAL);
 		break;
 	}
@@ -3442,6 +5225,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 	 *  when the batch was completed, to allow for freeing the memory for the iov arrays.
 	 */
 	if (spdk_likely(length <= bs_num_io_units_to_cluster_boundary(blob, offset))) {
+		struct spdk_blob_ep_segment *segment = NULL;
 		uint64_t lba_count;
 		uint64_t lba;
 		bool is_allocated;
@@ -3468,6 +5252,13 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 			return;
 		}
 
+		if (spdk_unlikely(blob->ep_on_demand) &&
+		    !blob_request_pin_extent_page(_channel, blob, &cpl,
+						  read ? SPDK_BLOB_READV : SPDK_BLOB_WRITEV,
+						  iov, iovcnt, offset, length, ext_io_opts, &segment)) {
+			return;
+		}
+
 		is_allocated = blob_calculate_lba_and_lba_count(blob, offset, length, &lba, &lba_count);
 
 		if (read) {
@@ -3475,11 +5266,13 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 
 			seq = bs_sequence_start_blob(_channel, &cpl, blob);
 			if (!seq) {
+				bs_ep_segment_unpin(segment);
 				cb_fn(cb_arg, -ENOMEM);
 				return;
 			}
 
 			seq->ext_io_opts = ext_io_opts;
+			seq->ep_segment = segment;
 
 			if (is_allocated) {
 				bs_sequence_readv_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
@@ -3493,11 +5286,13 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 
 				seq = bs_sequence_start_blob(_channel, &cpl, blob);
 				if (!seq) {
+					bs_ep_segment_unpin(segment);
 					cb_fn(cb_arg, -ENOMEM);
 					return;
 				}
 
 				seq->ext_io_opts = ext_io_opts;
+				seq->ep_segment = segment;
 
 				bs_sequence_writev_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
@@ -3507,13 +5302,14 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 				op = bs_user_op_alloc(_channel, &cpl, SPDK_BLOB_WRITEV, blob, iov, iovcnt, offset,
 						      length);
 				if (!op) {
+					bs_ep_segment_unpin(segment);
 					cb_fn(cb_arg, -ENOMEM);
 					return;
 				}
 
 				op->ext_io_opts = ext_io_opts;
 
-				bs_allocate_and_copy_cluster(blob, _channel, offset, op);
+				bs_allocate_and_copy_cluster(blob, _channel, offset, op, segment);
 			}
 		}
 	} else {
@@ -3615,15 +5411,6 @@ bs_channel_create(void *io_device, void *ctx_buf)
 		return -1;
 	}
 
-	channel->new_cluster_page = spdk_zmalloc(bs->md_page_size, 0, NULL, SPDK_ENV_NUMA_ID_ANY,
-				    SPDK_MALLOC_DMA);
-	if (!channel->new_cluster_page) {
-		SPDK_ERRLOG("Failed to allocate new cluster page\n");
-		free(channel->req_mem);
-		channel->dev->destroy_channel(channel->dev, channel->dev_channel);
-		return -1;
-	}
-
 	TAILQ_INIT(&channel->need_cluster_alloc);
 	TAILQ_INIT(&channel->queued_io);
 	RB_INIT(&channel->esnap_channels);
@@ -3651,8 +5438,9 @@ bs_channel_destroy(void *io_device, void *ctx_buf)
 
 	blob_esnap_destroy_bs_channel(channel);
 
+	bs_channel_release_clusters(channel);
+
 	free(channel->req_mem);
-	spdk_free(channel->new_cluster_page);
 	channel->dev->destroy_channel(channel->dev, channel->dev_channel);
 }
 
@@ -3671,6 +5459,7 @@ bs_dev_destroy(void *io_device)
 	}
 
 	spdk_spin_destroy(&bs->used_lock);
+	spdk_spin_destroy(&bs->ep_cache_lock);
 
 	spdk_bit_array_free(&bs->open_blobids);
 	spdk_bit_array_free(&bs->used_blobids);
@@ -3821,6 +5610,7 @@ spdk_bs_opts_init(struct spdk_bs_opts *opts, size_t opts_size)
 	SET_FIELD(force_recover, false);
 	SET_FIELD(esnap_bs_dev_create, NULL);
 	SET_FIELD(esnap_ctx, NULL);
+	SET_FIELD(extent_page_cache_size, 0);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -3971,6 +5761,8 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	memcpy(&bs->bstype, &opts->bstype, sizeof(opts->bstype));
 	bs->esnap_bs_dev_create = opts->esnap_bs_dev_create;
 	bs->esnap_ctx = opts->esnap_ctx;
+	bs->ep_cache_size = opts->extent_page_cache_size;
+	TAILQ_INIT(&bs->ep_lru);
 
 	/* The metadata is assumed to be at least 1 page */
 	bs->used_md_pages = spdk_bit_array_create(1);
@@ -3978,6 +5770,7 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	bs->open_blobids = spdk_bit_array_create(0);
 
 	spdk_spin_init(&bs->used_lock);
+	spdk_spin_init(&bs->ep_cache_lock);
 
 	spdk_io_device_register(bs, bs_channel_create, bs_channel_destroy,
 				sizeof(struct spdk_bs_channel), "blobstore");
@@ -3985,6 +5778,7 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 	if (rc == -1) {
 		spdk_io_device_unregister(bs, NULL);
 		spdk_spin_destroy(&bs->used_lock);
+		spdk_spin_destroy(&bs->ep_cache_lock);
 		spdk_bit_array_free(&bs->open_blobids);
 		spdk_bit_array_free(&bs->used_blobids);
 		spdk_bit_array_free(&bs->used_md_pages);
@@ -4173,13 +5967,13 @@ bs_delete_corrupted_close_cb(void *cb_arg, int bserrno)
 }
 
 static void
-bs_delete_corrupted_blob(void *cb_arg, int bserrno)
+bs_delete_corrupted_blob_clear(void *cb_arg, int bserrno)
 {
 	struct spdk_bs_load_ctx *ctx = cb_arg;
 	uint64_t i;
 
 	if (bserrno != 0) {
-		SPDK_ERRLOG("Failed to close clone of a corrupted blob\n");
+		SPDK_ERRLOG("Failed to load extent pages of a corrupted blob\n");
 		spdk_bs_iter_next(ctx->bs, ctx->blob, bs_load_iter, ctx);
 		return;
 	}
@@ -4206,6 +6000,21 @@ bs_delete_corrupted_blob(void *cb_arg, int bserrno)
 	spdk_blob_close(ctx->blob, bs_delete_corrupted_close_cb, ctx);
 }
 
+static void
+bs_delete_corrupted_blob(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_load_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to close clone of a corrupted blob\n");
+		spdk_bs_iter_next(ctx->bs, ctx->blob, bs_load_iter, ctx);
+		return;
+	}
+
+	/* The whole cluster map is cleared below */
+	blob_load_extent_pages(ctx->blob, bs_delete_corrupted_blob_clear, ctx);
+}
+
 static void
 bs_update_corrupted_blob(void *cb_arg, int bserrno)
 {
@@ -5020,12 +6829,13 @@ bs_opts_copy(struct spdk_bs_opts *src, struct spdk_bs_opts *dst)
 	SET_FIELD(force_recover);
 	SET_FIELD(esnap_bs_dev_create);
 	SET_FIELD(esnap_ctx);
+	SET_FIELD(extent_page_cache_size);
 
 	dst->opts_size = src->opts_size;
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 88, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_opts) == 92, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -5875,6 +7685,17 @@ bs_unload_read_super_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 	bs_write_used_md(seq, cb_arg, bs_unload_write_used_pages_cpl);
 }
 
+static void
+bs_unload_release_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_load_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	/* Read super block */
+	bs_sequence_read_dev(ctx->seq, ctx->super, bs_page_to_lba(ctx->bs, 0),
+			     bs_byte_to_lba(ctx->bs, sizeof(*ctx->super)),
+			     bs_unload_read_super_cpl, ctx);
+}
+
 void
 spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_arg)
 {
@@ -5941,10 +7762,9 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 		return;
 	}
 
-	/* Read super block */
-	bs_sequence_read_dev(ctx->seq, ctx->super, bs_page_to_lba(bs, 0),
-			     bs_byte_to_lba(bs, sizeof(*ctx->super)),
-			     bs_unload_read_super_cpl, ctx);
+	/* Return the clusters reserved by I/O channels before the used cluster mask is written. */
+	spdk_for_each_channel(bs, bs_channel_release_clusters_iter, ctx,
+			      bs_unload_release_clusters_done);
 }
 
 /* END spdk_bs_unload */
@@ -6078,7 +7898,10 @@ spdk_bs_get_io_unit_size(struct spdk_blob_store *bs)
 uint64_t
 spdk_bs_free_cluster_count(struct spdk_blob_store *bs)
 {
-	return bs->num_free_clusters;
+	/* Clusters reserved by I/O channels are free until a blob actually uses them. Thick
+	 * allocations that would fail without them return the reservations to the blobstore.
+	 */
+	return bs->num_free_clusters + __atomic_load_n(&bs->num_reserved_clusters, __ATOMIC_RELAXED);
 }
 
 uint64_t
@@ -6087,6 +7910,18 @@ spdk_bs_total_data_cluster_count(struct spdk_blob_store *bs)
 	return bs->total_data_clusters;
 }
 
+void
+spdk_bs_get_dedup_stats(struct spdk_blob_store *bs, struct spdk_bs_dedup_stats *stats)
+{
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+
+	stats->clusters_scanned = bs->dedup_clusters_scanned;
+	stats->clusters_released = bs->dedup_clusters_released;
+	stats->io_freeze_count = bs->dedup_freeze_count;
+	stats->io_freeze_total_us = bs->dedup_freeze_ticks * SPDK_SEC_TO_USEC / ticks_hz;
+	stats->io_freeze_max_us = bs->dedup_freeze_max_ticks * SPDK_SEC_TO_USEC / ticks_hz;
+}
+
 static int
 bs_register_md_thread(struct spdk_blob_store *bs)
 {
@@ -6222,26 +8057,108 @@ blob_opts_copy(const struct spdk_blob_opts *src, struct spdk_blob_opts *dst)
                 dst->field = src->field; \
         } \
 
-	SET_FIELD(num_clusters);
-	SET_FIELD(thin_provision);
-	SET_FIELD(clear_method);
+	SET_FIELD(num_clusters);
+	SET_FIELD(thin_provision);
+	SET_FIELD(clear_method);
+
+	if (FIELD_OK(xattrs)) {
+		memcpy(&dst->xattrs, &src->xattrs, sizeof(src->xattrs));
+	}
+
+	SET_FIELD(use_extent_table);
+	SET_FIELD(esnap_id);
+	SET_FIELD(esnap_id_len);
+	SET_FIELD(sub_cluster_sz);
+
+	dst->opts_size = src->opts_size;
+
+	/* You should not remove this statement, but need to update the assert statement
+	 * if you add a new field, and also add a corresponding SET_FIELD statement */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 88, "Incorrect size");
+
+#undef FIELD_OK
+#undef SET_FIELD
+}
+
+static void
+bs_create_blob_finish(struct spdk_blob_store *bs, struct spdk_blob *blob, uint32_t page_idx,
+		      uint64_t num_clusters, int rc, spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_cpl	cpl;
+	spdk_bs_sequence_t	*seq;
+
+	if (rc == 0) {
+		cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
+		cpl.u.blobid.cb_fn = cb_fn;
+		cpl.u.blobid.cb_arg = cb_arg;
+		cpl.u.blobid.blobid = blob->id;
+
+		seq = bs_sequence_start_bs(bs->md_channel, &cpl);
+		if (seq) {
+			blob_persist(seq, blob, bs_create_blob_cpl, blob);
+			return;
+		}
+		rc = -ENOMEM;
+	}
+
+	SPDK_ERRLOG("Failed to create blob: %s, size in clusters/size: %lu (clusters)\n",
+		    spdk_strerror(rc), num_clusters);
+	if (blob != NULL) {
+		blob_free(blob);
+	}
+	spdk_spin_lock(&bs->used_lock);
+	spdk_bit_array_clear(bs->used_blobids, page_idx);
+	bs_release_md_page(bs, page_idx);
+	spdk_spin_unlock(&bs->used_lock);
+	cb_fn(cb_arg, 0, rc);
+}
+
+struct spdk_bs_create_reclaim_ctx {
+	struct spdk_blob		*blob;
+	uint32_t			page_idx;
+	uint64_t			num_clusters;
+	spdk_blob_op_with_id_complete	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+bs_create_blob_reclaim_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_create_reclaim_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob *blob = ctx->blob;
+	int rc;
+
+	rc = blob_resize(blob, ctx->num_clusters);
+	bs_create_blob_finish(blob->bs, blob, ctx->page_idx, ctx->num_clusters, rc, ctx->cb_fn,
+			      ctx->cb_arg);
+	free(ctx);
+}
 
-	if (FIELD_OK(xattrs)) {
-		memcpy(&dst->xattrs, &src->xattrs, sizeof(src->xattrs));
-	}
+/*
+ * The free clusters may be reserved by I/O channels. Return the reservations of all channels
+ * to the blobstore and retry the allocation of the new blob.
+ */
+static int
+bs_create_blob_reclaim_clusters(struct spdk_blob *blob, uint32_t page_idx, uint64_t num_clusters,
+				spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_create_reclaim_ctx *ctx;
 
-	SET_FIELD(use_extent_table);
-	SET_FIELD(esnap_id);
-	SET_FIELD(esnap_id_len);
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		return -ENOMEM;
+	}
 
-	dst->opts_size = src->opts_size;
+	ctx->blob = blob;
+	ctx->page_idx = page_idx;
+	ctx->num_clusters = num_clusters;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
 
-	/* You should not remove this statement, but need to update the assert statement
-	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_blob_opts) == 80, "Incorrect size");
+	spdk_for_each_channel(blob->bs, bs_channel_release_clusters_iter, ctx,
+			      bs_create_blob_reclaim_clusters_done);
 
-#undef FIELD_OK
-#undef SET_FIELD
+	return 0;
 }
 
 static void
@@ -6252,10 +8169,8 @@ bs_create_blob(struct spdk_blob_store *bs,
 {
 	struct spdk_blob	*blob;
 	uint32_t		page_idx;
-	struct spdk_bs_cpl	cpl;
 	struct spdk_blob_opts	opts_local;
 	struct spdk_blob_xattr_opts internal_xattrs_default;
-	spdk_bs_sequence_t	*seq;
 	spdk_blob_id		id;
 	int rc;
 
@@ -6292,6 +8207,17 @@ bs_create_blob(struct spdk_blob_store *bs,
 		blob->invalid_flags |= SPDK_BLOB_EXTENT_TABLE;
 	}
 
+	if (opts_local.sub_cluster_sz != 0 && opts_local.sub_cluster_sz != bs->cluster_sz) {
+		if (!bs_sub_cluster_sz_is_valid(bs, opts_local.sub_cluster_sz)) {
+			SPDK_ERRLOG("Sub-cluster size %" PRIu32 " is not valid for cluster size %" PRIu32 "\n",
+				    opts_local.sub_cluster_sz, bs->cluster_sz);
+			rc = -EINVAL;
+			goto error;
+		}
+		blob->io_units_per_sub_cluster = opts_local.sub_cluster_sz / bs->io_unit_size;
+		blob->invalid_flags |= SPDK_BLOB_SUB_CLUSTERS;
+	}
+
 	if (!internal_xattrs) {
 		blob_xattrs_init(&internal_xattrs_default);
 		internal_xattrs = &internal_xattrs_default;
@@ -6321,457 +8247,822 @@ bs_create_blob(struct spdk_blob_store *bs,
 			goto error;
 
 		}
-		blob_set_thin_provision(blob);
-		blob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
-		rc = blob_set_xattr(blob, BLOB_EXTERNAL_SNAPSHOT_ID,
-				    opts_local.esnap_id, opts_local.esnap_id_len, true);
-		if (rc != 0) {
-			goto error;
-		}
+		blob_set_thin_provision(blob);
+		blob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		rc = blob_set_xattr(blob, BLOB_EXTERNAL_SNAPSHOT_ID,
+				    opts_local.esnap_id, opts_local.esnap_id_len, true);
+		if (rc != 0) {
+			goto error;
+		}
+	}
+
+	rc = blob_resize(blob, opts_local.num_clusters);
+	if (rc == -ENOSPC && bs_has_reserved_clusters(bs)) {
+		rc = bs_create_blob_reclaim_clusters(blob, page_idx, opts_local.num_clusters,
+						     cb_fn, cb_arg);
+		if (rc == 0) {
+			return;
+		}
+	}
+	if (rc < 0) {
+		goto error;
+	}
+
+	bs_create_blob_finish(bs, blob, page_idx, opts_local.num_clusters, 0, cb_fn, cb_arg);
+	return;
+
+error:
+	bs_create_blob_finish(bs, blob, page_idx, opts_local.num_clusters, rc, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_create_blob(struct spdk_blob_store *bs,
+		    spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	bs_create_blob(bs, NULL, NULL, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_create_blob_ext(struct spdk_blob_store *bs, const struct spdk_blob_opts *opts,
+			spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	bs_create_blob(bs, opts, NULL, cb_fn, cb_arg);
+}
+
+/* END spdk_bs_create_blob */
+
+/* START blob_cleanup */
+
+struct spdk_clone_snapshot_ctx {
+	struct spdk_bs_cpl      cpl;
+	int bserrno;
+	bool frozen;
+
+	struct spdk_io_channel *channel;
+
+	/* Current cluster for inflate operation */
+	uint64_t cluster;
+
+	/* For inflation force allocation of all unallocated clusters and remove
+	 * thin-provisioning. Otherwise only decouple parent and keep clone thin. */
+	bool allocate_all;
+
+	struct {
+		spdk_blob_id id;
+		struct spdk_blob *blob;
+		bool md_ro;
+	} original;
+	struct {
+		spdk_blob_id id;
+		struct spdk_blob *blob;
+	} new;
+
+	/* xattrs specified for snapshot/clones only. They have no impact on
+	 * the original blobs xattrs. */
+	const struct spdk_blob_xattr_opts *xattrs;
+
+	/* Sub-cluster size of a clone, 0 to inherit the one of its snapshot */
+	uint32_t sub_cluster_sz;
+};
+
+static void
+bs_clone_snapshot_cleanup_finish(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = cb_arg;
+	struct spdk_bs_cpl *cpl = &ctx->cpl;
+
+	if (bserrno != 0) {
+		if (ctx->bserrno != 0) {
+			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
+		} else {
+			ctx->bserrno = bserrno;
+		}
+	}
+
+	switch (cpl->type) {
+	case SPDK_BS_CPL_TYPE_BLOBID:
+		cpl->u.blobid.cb_fn(cpl->u.blobid.cb_arg, cpl->u.blobid.blobid, ctx->bserrno);
+		break;
+	case SPDK_BS_CPL_TYPE_BLOB_BASIC:
+		cpl->u.blob_basic.cb_fn(cpl->u.blob_basic.cb_arg, ctx->bserrno);
+		break;
+	default:
+		SPDK_UNREACHABLE();
+		break;
+	}
+
+	free(ctx);
+}
+
+static void
+bs_snapshot_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *origblob = ctx->original.blob;
+
+	if (bserrno != 0) {
+		if (ctx->bserrno != 0) {
+			SPDK_ERRLOG("Unfreeze error %d\n", bserrno);
+		} else {
+			ctx->bserrno = bserrno;
+		}
+	}
+
+	ctx->original.id = origblob->id;
+	origblob->locked_operation_in_progress = false;
+
+	/* Revert md_ro to original state */
+	origblob->md_ro = ctx->original.md_ro;
+
+	spdk_blob_close(origblob, bs_clone_snapshot_cleanup_finish, ctx);
+}
+
+static void
+bs_clone_snapshot_origblob_cleanup(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *origblob = ctx->original.blob;
+
+	if (bserrno != 0) {
+		if (ctx->bserrno != 0) {
+			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
+		} else {
+			ctx->bserrno = bserrno;
+		}
+	}
+
+	if (ctx->frozen) {
+		/* Unfreeze any outstanding I/O */
+		blob_unfreeze_io(origblob, bs_snapshot_unfreeze_cpl, ctx);
+	} else {
+		bs_snapshot_unfreeze_cpl(ctx, 0);
+	}
+
+}
+
+static void
+bs_clone_snapshot_newblob_cleanup(struct spdk_clone_snapshot_ctx *ctx, int bserrno)
+{
+	struct spdk_blob *newblob = ctx->new.blob;
+
+	if (bserrno != 0) {
+		if (ctx->bserrno != 0) {
+			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
+		} else {
+			ctx->bserrno = bserrno;
+		}
+	}
+
+	ctx->new.id = newblob->id;
+	spdk_blob_close(newblob, bs_clone_snapshot_origblob_cleanup, ctx);
+}
+
+/* END blob_cleanup */
+
+/* START spdk_bs_create_snapshot */
+
+static void
+bs_snapshot_swap_cluster_maps(struct spdk_blob *blob1, struct spdk_blob *blob2)
+{
+	uint64_t *cluster_temp;
+	uint64_t num_allocated_clusters_temp;
+	uint32_t *extent_page_temp;
+	uint64_t *masks_temp;
+	uint64_t num_masks_temp;
+
+	cluster_temp = blob1->active.clusters;
+	blob1->active.clusters = blob2->active.clusters;
+	blob2->active.clusters = cluster_temp;
+
+	num_allocated_clusters_temp = blob1->active.num_allocated_clusters;
+	blob1->active.num_allocated_clusters = blob2->active.num_allocated_clusters;
+	blob2->active.num_allocated_clusters = num_allocated_clusters_temp;
+
+	extent_page_temp = blob1->active.extent_pages;
+	blob1->active.extent_pages = blob2->active.extent_pages;
+	blob2->active.extent_pages = extent_page_temp;
+
+	/* Both blobs have the same sub-cluster size, the snapshot inherits it */
+	assert(blob1->io_units_per_sub_cluster == blob2->io_units_per_sub_cluster);
+	masks_temp = blob1->sub_cluster_masks;
+	blob1->sub_cluster_masks = blob2->sub_cluster_masks;
+	blob2->sub_cluster_masks = masks_temp;
+
+	num_masks_temp = blob1->num_sub_cluster_masks;
+	blob1->num_sub_cluster_masks = blob2->num_sub_cluster_masks;
+	blob2->num_sub_cluster_masks = num_masks_temp;
+}
+
+/* Copies an internal xattr */
+static int
+bs_snapshot_copy_xattr(struct spdk_blob *toblob, struct spdk_blob *fromblob, const char *name)
+{
+	const void	*val = NULL;
+	size_t		len;
+	int		bserrno;
+
+	bserrno = blob_get_xattr_value(fromblob, name, &val, &len, true);
+	if (bserrno != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 " missing %s XATTR\n", fromblob->id, name);
+		return bserrno;
+	}
+
+	bserrno = blob_set_xattr(toblob, name, val, len, true);
+	if (bserrno != 0) {
+		SPDK_ERRLOG("could not set %s XATTR on blob 0x%" PRIx64 "\n",
+			    name, toblob->id);
+		return bserrno;
+	}
+	return 0;
+}
+
+static void
+bs_snapshot_origblob_sync_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *origblob = ctx->original.blob;
+	struct spdk_blob *newblob = ctx->new.blob;
+
+	if (bserrno != 0) {
+		bs_snapshot_swap_cluster_maps(newblob, origblob);
+		if (blob_is_esnap_clone(newblob)) {
+			bs_snapshot_copy_xattr(origblob, newblob, BLOB_EXTERNAL_SNAPSHOT_ID);
+			origblob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		}
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
 
-	rc = blob_resize(blob, opts_local.num_clusters);
-	if (rc < 0) {
-		goto error;
+	/* Remove metadata descriptor SNAPSHOT_IN_PROGRESS */
+	bserrno = blob_remove_xattr(newblob, SNAPSHOT_IN_PROGRESS, true);
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
-	cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
-	cpl.u.blobid.cb_fn = cb_fn;
-	cpl.u.blobid.cb_arg = cb_arg;
-	cpl.u.blobid.blobid = blob->id;
 
-	seq = bs_sequence_start_bs(bs->md_channel, &cpl);
-	if (!seq) {
-		rc = -ENOMEM;
-		goto error;
-	}
+	bs_blob_list_add(ctx->original.blob);
 
-	blob_persist(seq, blob, bs_create_blob_cpl, blob);
-	return;
+	spdk_blob_set_read_only(newblob);
 
-error:
-	SPDK_ERRLOG("Failed to create blob: %s, size in clusters/size: %lu (clusters)\n",
-		    spdk_strerror(rc), opts_local.num_clusters);
-	if (blob != NULL) {
-		blob_free(blob);
-	}
-	spdk_spin_lock(&bs->used_lock);
-	spdk_bit_array_clear(bs->used_blobids, page_idx);
-	bs_release_md_page(bs, page_idx);
-	spdk_spin_unlock(&bs->used_lock);
-	cb_fn(cb_arg, 0, rc);
+	/* sync snapshot metadata */
+	spdk_blob_sync_md(newblob, bs_clone_snapshot_origblob_cleanup, ctx);
 }
 
-void
-spdk_bs_create_blob(struct spdk_blob_store *bs,
-		    spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+static void
+bs_snapshot_newblob_sync_cpl(void *cb_arg, int bserrno)
 {
-	bs_create_blob(bs, NULL, NULL, cb_fn, cb_arg);
-}
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *origblob = ctx->original.blob;
+	struct spdk_blob *newblob = ctx->new.blob;
 
-void
-spdk_bs_create_blob_ext(struct spdk_blob_store *bs, const struct spdk_blob_opts *opts,
-			spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
-{
-	bs_create_blob(bs, opts, NULL, cb_fn, cb_arg);
-}
+	if (bserrno != 0) {
+		/* return cluster map back to original */
+		bs_snapshot_swap_cluster_maps(newblob, origblob);
 
-/* END spdk_bs_create_blob */
+		/* Newblob md sync failed. Valid clusters are only present in origblob.
+		 * Since I/O is frozen on origblob, not changes to zeroed out cluster map should have occurred.
+		 * Newblob needs to be reverted to thin_provisioned state at creation to properly close. */
+		blob_set_thin_provision(newblob);
+		assert(spdk_mem_all_zero(newblob->active.clusters,
+					 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
+		assert(spdk_mem_all_zero(newblob->active.extent_pages,
+					 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
 
-/* START blob_cleanup */
+		bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+		return;
+	}
 
-struct spdk_clone_snapshot_ctx {
-	struct spdk_bs_cpl      cpl;
-	int bserrno;
-	bool frozen;
+	/* Set internal xattr for snapshot id */
+	bserrno = blob_set_xattr(origblob, BLOB_SNAPSHOT, &newblob->id, sizeof(spdk_blob_id), true);
+	if (bserrno != 0) {
+		/* return cluster map back to original */
+		bs_snapshot_swap_cluster_maps(newblob, origblob);
+		blob_set_thin_provision(newblob);
+		bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+		return;
+	}
 
-	struct spdk_io_channel *channel;
+	/* Create new back_bs_dev for snapshot */
+	origblob->back_bs_dev = bs_create_blob_bs_dev(newblob);
+	if (origblob->back_bs_dev == NULL) {
+		/* return cluster map back to original */
+		bs_snapshot_swap_cluster_maps(newblob, origblob);
+		blob_set_thin_provision(newblob);
+		bs_clone_snapshot_newblob_cleanup(ctx, -EINVAL);
+		return;
+	}
 
-	/* Current cluster for inflate operation */
-	uint64_t cluster;
+	/* Remove the xattr that references an external snapshot */
+	if (blob_is_esnap_clone(origblob)) {
+		origblob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		bserrno = blob_remove_xattr(origblob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
+		if (bserrno != 0) {
+			if (bserrno == -ENOENT) {
+				SPDK_ERRLOG("blob 0x%" PRIx64 " has no " BLOB_EXTERNAL_SNAPSHOT_ID
+					    " xattr to remove\n", origblob->id);
+				assert(false);
+			} else {
+				/* return cluster map back to original */
+				bs_snapshot_swap_cluster_maps(newblob, origblob);
+				blob_set_thin_provision(newblob);
+				bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+				return;
+			}
+		}
+	}
 
-	/* For inflation force allocation of all unallocated clusters and remove
-	 * thin-provisioning. Otherwise only decouple parent and keep clone thin. */
-	bool allocate_all;
+	bs_blob_list_remove(origblob);
+	origblob->parent_id = newblob->id;
+	/* set clone blob as thin provisioned */
+	blob_set_thin_provision(origblob);
 
-	struct {
-		spdk_blob_id id;
-		struct spdk_blob *blob;
-		bool md_ro;
-	} original;
-	struct {
-		spdk_blob_id id;
-		struct spdk_blob *blob;
-	} new;
+	bs_blob_list_add(newblob);
 
-	/* xattrs specified for snapshot/clones only. They have no impact on
-	 * the original blobs xattrs. */
-	const struct spdk_blob_xattr_opts *xattrs;
-};
+	/* sync clone metadata */
+	spdk_blob_sync_md(origblob, bs_snapshot_origblob_sync_cpl, ctx);
+}
 
 static void
-bs_clone_snapshot_cleanup_finish(void *cb_arg, int bserrno)
+bs_snapshot_freeze_cpl(void *cb_arg, int rc)
 {
-	struct spdk_clone_snapshot_ctx *ctx = cb_arg;
-	struct spdk_bs_cpl *cpl = &ctx->cpl;
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *origblob = ctx->original.blob;
+	struct spdk_blob *newblob = ctx->new.blob;
+	int bserrno;
 
-	if (bserrno != 0) {
-		if (ctx->bserrno != 0) {
-			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
-		} else {
-			ctx->bserrno = bserrno;
-		}
+	if (rc != 0) {
+		bs_clone_snapshot_newblob_cleanup(ctx, rc);
+		return;
 	}
 
-	switch (cpl->type) {
-	case SPDK_BS_CPL_TYPE_BLOBID:
-		cpl->u.blobid.cb_fn(cpl->u.blobid.cb_arg, cpl->u.blobid.blobid, ctx->bserrno);
+	ctx->frozen = true;
+
+	if (blob_is_esnap_clone(origblob)) {
+		/* Clean up any channels associated with the original blob id because future IO will
+		 * perform IO using the snapshot blob_id.
+		 */
+		blob_esnap_destroy_bs_dev_channels(origblob, false, NULL, NULL);
+	}
+	if (newblob->back_bs_dev) {
+		blob_back_bs_destroy(newblob);
+	}
+	/* set new back_bs_dev for snapshot */
+	newblob->back_bs_dev = origblob->back_bs_dev;
+	/* Set invalid flags from origblob */
+	newblob->invalid_flags = origblob->invalid_flags;
+
+	/* inherit parent from original blob if set */
+	newblob->parent_id = origblob->parent_id;
+	switch (origblob->parent_id) {
+	case SPDK_BLOBID_EXTERNAL_SNAPSHOT:
+		bserrno = bs_snapshot_copy_xattr(newblob, origblob, BLOB_EXTERNAL_SNAPSHOT_ID);
+		if (bserrno != 0) {
+			bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+			return;
+		}
 		break;
-	case SPDK_BS_CPL_TYPE_BLOB_BASIC:
-		cpl->u.blob_basic.cb_fn(cpl->u.blob_basic.cb_arg, ctx->bserrno);
+	case SPDK_BLOBID_INVALID:
 		break;
 	default:
-		SPDK_UNREACHABLE();
-		break;
+		/* Set internal xattr for snapshot id */
+		bserrno = blob_set_xattr(newblob, BLOB_SNAPSHOT,
+					 &origblob->parent_id, sizeof(spdk_blob_id), true);
+		if (bserrno != 0) {
+			bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+			return;
+		}
 	}
 
-	free(ctx);
+	/* swap cluster maps */
+	bs_snapshot_swap_cluster_maps(newblob, origblob);
+
+	/* Set the clear method on the new blob to match the original. */
+	blob_set_clear_method(newblob, origblob->clear_method);
+
+	/* sync snapshot metadata */
+	spdk_blob_sync_md(newblob, bs_snapshot_newblob_sync_cpl, ctx);
 }
 
 static void
-bs_snapshot_unfreeze_cpl(void *cb_arg, int bserrno)
+bs_snapshot_newblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
 	struct spdk_blob *origblob = ctx->original.blob;
+	struct spdk_blob *newblob = _blob;
 
 	if (bserrno != 0) {
-		if (ctx->bserrno != 0) {
-			SPDK_ERRLOG("Unfreeze error %d\n", bserrno);
-		} else {
-			ctx->bserrno = bserrno;
-		}
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
 
-	ctx->original.id = origblob->id;
-	origblob->locked_operation_in_progress = false;
-
-	/* Revert md_ro to original state */
-	origblob->md_ro = ctx->original.md_ro;
+	ctx->new.blob = newblob;
+	assert(spdk_blob_is_thin_provisioned(newblob));
+	assert(spdk_mem_all_zero(newblob->active.clusters,
+				 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
+	assert(spdk_mem_all_zero(newblob->active.extent_pages,
+				 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
 
-	spdk_blob_close(origblob, bs_clone_snapshot_cleanup_finish, ctx);
+	blob_freeze_io(origblob, bs_snapshot_freeze_cpl, ctx);
 }
 
 static void
-bs_clone_snapshot_origblob_cleanup(void *cb_arg, int bserrno)
+bs_snapshot_newblob_create_cpl(void *cb_arg, spdk_blob_id blobid, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
 	struct spdk_blob *origblob = ctx->original.blob;
 
 	if (bserrno != 0) {
-		if (ctx->bserrno != 0) {
-			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
-		} else {
-			ctx->bserrno = bserrno;
-		}
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
 
-	if (ctx->frozen) {
-		/* Unfreeze any outstanding I/O */
-		blob_unfreeze_io(origblob, bs_snapshot_unfreeze_cpl, ctx);
-	} else {
-		bs_snapshot_unfreeze_cpl(ctx, 0);
-	}
+	ctx->new.id = blobid;
+	ctx->cpl.u.blobid.blobid = blobid;
+
+	bs_open_blob_resident(origblob->bs, ctx->new.id, bs_snapshot_newblob_open_cpl, ctx);
+}
+
+
+static void
+bs_xattr_snapshot(void *arg, const char *name,
+		  const void **value, size_t *value_len)
+{
+	assert(strncmp(name, SNAPSHOT_IN_PROGRESS, sizeof(SNAPSHOT_IN_PROGRESS)) == 0);
 
+	struct spdk_blob *blob = (struct spdk_blob *)arg;
+	*value = &blob->id;
+	*value_len = sizeof(blob->id);
 }
 
 static void
-bs_clone_snapshot_newblob_cleanup(struct spdk_clone_snapshot_ctx *ctx, int bserrno)
+bs_snapshot_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
-	struct spdk_blob *newblob = ctx->new.blob;
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob_opts opts;
+	struct spdk_blob_xattr_opts internal_xattrs;
+	char *xattrs_names[] = { SNAPSHOT_IN_PROGRESS };
 
 	if (bserrno != 0) {
-		if (ctx->bserrno != 0) {
-			SPDK_ERRLOG("Cleanup error %d\n", bserrno);
-		} else {
-			ctx->bserrno = bserrno;
-		}
+		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
+		return;
 	}
 
-	ctx->new.id = newblob->id;
-	spdk_blob_close(newblob, bs_clone_snapshot_origblob_cleanup, ctx);
-}
+	ctx->original.blob = _blob;
 
-/* END blob_cleanup */
+	if (_blob->data_ro || _blob->md_ro) {
+		SPDK_DEBUGLOG(blob, "Cannot create snapshot from read only blob with id 0x%"
+			      PRIx64 "\n", _blob->id);
+		ctx->bserrno = -EINVAL;
+		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
+		return;
+	}
 
-/* START spdk_bs_create_snapshot */
+	if (_blob->locked_operation_in_progress) {
+		SPDK_DEBUGLOG(blob, "Cannot create snapshot - another operation in progress\n");
+		ctx->bserrno = -EBUSY;
+		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
+		return;
+	}
 
-static void
-bs_snapshot_swap_cluster_maps(struct spdk_blob *blob1, struct spdk_blob *blob2)
-{
-	uint64_t *cluster_temp;
-	uint64_t num_allocated_clusters_temp;
-	uint32_t *extent_page_temp;
+	_blob->locked_operation_in_progress = true;
 
-	cluster_temp = blob1->active.clusters;
-	blob1->active.clusters = blob2->active.clusters;
-	blob2->active.clusters = cluster_temp;
+	spdk_blob_opts_init(&opts, sizeof(opts));
+	blob_xattrs_init(&internal_xattrs);
 
-	num_allocated_clusters_temp = blob1->active.num_allocated_clusters;
-	blob1->active.num_allocated_clusters = blob2->active.num_allocated_clusters;
-	blob2->active.num_allocated_clusters = num_allocated_clusters_temp;
+	/* Change the size of new blob to the same as in original blob,
+	 * but do not allocate clusters */
+	opts.thin_provision = true;
+	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
+	opts.use_extent_table = _blob->use_extent_table;
+	opts.sub_cluster_sz = _blob->io_units_per_sub_cluster * _blob->bs->io_unit_size;
 
-	extent_page_temp = blob1->active.extent_pages;
-	blob1->active.extent_pages = blob2->active.extent_pages;
-	blob2->active.extent_pages = extent_page_temp;
+	/* If there are any xattrs specified for snapshot, set them now */
+	if (ctx->xattrs) {
+		memcpy(&opts.xattrs, ctx->xattrs, sizeof(*ctx->xattrs));
+	}
+	/* Set internal xattr SNAPSHOT_IN_PROGRESS */
+	internal_xattrs.count = 1;
+	internal_xattrs.ctx = _blob;
+	internal_xattrs.names = xattrs_names;
+	internal_xattrs.get_value = bs_xattr_snapshot;
+
+	bs_create_blob(_blob->bs, &opts, &internal_xattrs,
+		       bs_snapshot_newblob_create_cpl, ctx);
 }
 
-/* Copies an internal xattr */
-static int
-bs_snapshot_copy_xattr(struct spdk_blob *toblob, struct spdk_blob *fromblob, const char *name)
+void
+spdk_bs_create_snapshot(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			const struct spdk_blob_xattr_opts *snapshot_xattrs,
+			spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
 {
-	const void	*val = NULL;
-	size_t		len;
-	int		bserrno;
+	struct spdk_clone_snapshot_ctx *ctx = calloc(1, sizeof(*ctx));
 
-	bserrno = blob_get_xattr_value(fromblob, name, &val, &len, true);
-	if (bserrno != 0) {
-		SPDK_ERRLOG("blob 0x%" PRIx64 " missing %s XATTR\n", fromblob->id, name);
-		return bserrno;
+	if (!ctx) {
+		cb_fn(cb_arg, SPDK_BLOBID_INVALID, -ENOMEM);
+		return;
 	}
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
+	ctx->cpl.u.blobid.cb_fn = cb_fn;
+	ctx->cpl.u.blobid.cb_arg = cb_arg;
+	ctx->cpl.u.blobid.blobid = SPDK_BLOBID_INVALID;
+	ctx->bserrno = 0;
+	ctx->frozen = false;
+	ctx->original.id = blobid;
+	ctx->xattrs = snapshot_xattrs;
 
-	bserrno = blob_set_xattr(toblob, name, val, len, true);
-	if (bserrno != 0) {
-		SPDK_ERRLOG("could not set %s XATTR on blob 0x%" PRIx64 "\n",
-			    name, toblob->id);
-		return bserrno;
-	}
-	return 0;
+	bs_open_blob_resident(bs, ctx->original.id, bs_snapshot_origblob_open_cpl, ctx);
 }
+/* END spdk_bs_create_snapshot */
+
+/* START spdk_bs_create_clone */
 
 static void
-bs_snapshot_origblob_sync_cpl(void *cb_arg, int bserrno)
+bs_xattr_clone(void *arg, const char *name,
+	       const void **value, size_t *value_len)
+{
+	assert(strncmp(name, BLOB_SNAPSHOT, sizeof(BLOB_SNAPSHOT)) == 0);
+
+	struct spdk_blob *blob = (struct spdk_blob *)arg;
+	*value = &blob->id;
+	*value_len = sizeof(blob->id);
+}
+
+static void
+bs_clone_newblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *origblob = ctx->original.blob;
-	struct spdk_blob *newblob = ctx->new.blob;
+	struct spdk_blob *clone = _blob;
 
 	if (bserrno != 0) {
-		bs_snapshot_swap_cluster_maps(newblob, origblob);
-		if (blob_is_esnap_clone(newblob)) {
-			bs_snapshot_copy_xattr(origblob, newblob, BLOB_EXTERNAL_SNAPSHOT_ID);
-			origblob->invalid_flags |= SPDK_BLOB_EXTERNAL_SNAPSHOT;
-		}
 		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
 		return;
 	}
 
-	/* Remove metadata descriptor SNAPSHOT_IN_PROGRESS */
-	bserrno = blob_remove_xattr(newblob, SNAPSHOT_IN_PROGRESS, true);
+	ctx->new.blob = clone;
+	bs_blob_list_add(clone);
+
+	spdk_blob_close(clone, bs_clone_snapshot_origblob_cleanup, ctx);
+}
+
+static void
+bs_clone_newblob_create_cpl(void *cb_arg, spdk_blob_id blobid, int bserrno)
+{
+	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+
 	if (bserrno != 0) {
 		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
 		return;
 	}
 
-	bs_blob_list_add(ctx->original.blob);
-
-	spdk_blob_set_read_only(newblob);
-
-	/* sync snapshot metadata */
-	spdk_blob_sync_md(newblob, bs_clone_snapshot_origblob_cleanup, ctx);
+	ctx->cpl.u.blobid.blobid = blobid;
+	spdk_bs_open_blob(ctx->original.blob->bs, blobid, bs_clone_newblob_open_cpl, ctx);
 }
 
 static void
-bs_snapshot_newblob_sync_cpl(void *cb_arg, int bserrno)
+bs_clone_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *origblob = ctx->original.blob;
-	struct spdk_blob *newblob = ctx->new.blob;
+	struct spdk_clone_snapshot_ctx	*ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob_opts		opts;
+	struct spdk_blob_xattr_opts internal_xattrs;
+	char *xattr_names[] = { BLOB_SNAPSHOT };
 
 	if (bserrno != 0) {
-		/* return cluster map back to original */
-		bs_snapshot_swap_cluster_maps(newblob, origblob);
-
-		/* Newblob md sync failed. Valid clusters are only present in origblob.
-		 * Since I/O is frozen on origblob, not changes to zeroed out cluster map should have occurred.
-		 * Newblob needs to be reverted to thin_provisioned state at creation to properly close. */
-		blob_set_thin_provision(newblob);
-		assert(spdk_mem_all_zero(newblob->active.clusters,
-					 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
-		assert(spdk_mem_all_zero(newblob->active.extent_pages,
-					 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
-
-		bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
 		return;
 	}
 
-	/* Set internal xattr for snapshot id */
-	bserrno = blob_set_xattr(origblob, BLOB_SNAPSHOT, &newblob->id, sizeof(spdk_blob_id), true);
-	if (bserrno != 0) {
-		/* return cluster map back to original */
-		bs_snapshot_swap_cluster_maps(newblob, origblob);
-		blob_set_thin_provision(newblob);
-		bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+	ctx->original.blob = _blob;
+	ctx->original.md_ro = _blob->md_ro;
+
+	if (!_blob->data_ro || !_blob->md_ro) {
+		SPDK_DEBUGLOG(blob, "Clone not from read-only blob\n");
+		ctx->bserrno = -EINVAL;
+		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
 		return;
 	}
 
-	/* Create new back_bs_dev for snapshot */
-	origblob->back_bs_dev = bs_create_blob_bs_dev(newblob);
-	if (origblob->back_bs_dev == NULL) {
-		/* return cluster map back to original */
-		bs_snapshot_swap_cluster_maps(newblob, origblob);
-		blob_set_thin_provision(newblob);
-		bs_clone_snapshot_newblob_cleanup(ctx, -EINVAL);
+	if (_blob->locked_operation_in_progress) {
+		SPDK_DEBUGLOG(blob, "Cannot create clone - another operation in progress\n");
+		ctx->bserrno = -EBUSY;
+		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
 		return;
 	}
 
-	/* Remove the xattr that references an external snapshot */
-	if (blob_is_esnap_clone(origblob)) {
-		origblob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
-		bserrno = blob_remove_xattr(origblob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
-		if (bserrno != 0) {
-			if (bserrno == -ENOENT) {
-				SPDK_ERRLOG("blob 0x%" PRIx64 " has no " BLOB_EXTERNAL_SNAPSHOT_ID
-					    " xattr to remove\n", origblob->id);
-				assert(false);
-			} else {
-				/* return cluster map back to original */
-				bs_snapshot_swap_cluster_maps(newblob, origblob);
-				blob_set_thin_provision(newblob);
-				bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
-				return;
-			}
-		}
+	_blob->locked_operation_in_progress = true;
+
+	spdk_blob_opts_init(&opts, sizeof(opts));
+	blob_xattrs_init(&internal_xattrs);
+
+	opts.thin_provision = true;
+	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
+	opts.use_extent_table = _blob->use_extent_table;
+	if (ctx->sub_cluster_sz != 0) {
+		opts.sub_cluster_sz = ctx->sub_cluster_sz;
+	} else {
+		opts.sub_cluster_sz = _blob->io_units_per_sub_cluster * _blob->bs->io_unit_size;
+	}
+	if (ctx->xattrs) {
+		memcpy(&opts.xattrs, ctx->xattrs, sizeof(*ctx->xattrs));
 	}
 
-	bs_blob_list_remove(origblob);
-	origblob->parent_id = newblob->id;
-	/* set clone blob as thin provisioned */
-	blob_set_thin_provision(origblob);
+	/* Set internal xattr BLOB_SNAPSHOT */
+	internal_xattrs.count = 1;
+	internal_xattrs.ctx = _blob;
+	internal_xattrs.names = xattr_names;
+	internal_xattrs.get_value = bs_xattr_clone;
+
+	bs_create_blob(_blob->bs, &opts, &internal_xattrs,
+		       bs_clone_newblob_create_cpl, ctx);
+}
+
+void
+spdk_bs_create_clone(struct spdk_blob_store *bs, spdk_blob_id blobid,
+		     const struct spdk_blob_xattr_opts *clone_xattrs,
+		     spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	spdk_bs_create_clone_ext(bs, blobid, clone_xattrs, 0, cb_fn, cb_arg);
+}
+
+void
+spdk_bs_create_clone_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			 const struct spdk_blob_xattr_opts *clone_xattrs, uint32_t sub_cluster_sz,
+			 spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	struct spdk_clone_snapshot_ctx	*ctx = calloc(1, sizeof(*ctx));
+
+	if (!ctx) {
+		cb_fn(cb_arg, SPDK_BLOBID_INVALID, -ENOMEM);
+		return;
+	}
 
-	bs_blob_list_add(newblob);
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
+	ctx->cpl.u.blobid.cb_fn = cb_fn;
+	ctx->cpl.u.blobid.cb_arg = cb_arg;
+	ctx->cpl.u.blobid.blobid = SPDK_BLOBID_INVALID;
+	ctx->bserrno = 0;
+	ctx->xattrs = clone_xattrs;
+	ctx->sub_cluster_sz = sub_cluster_sz;
+	ctx->original.id = blobid;
 
-	/* sync clone metadata */
-	spdk_blob_sync_md(origblob, bs_snapshot_origblob_sync_cpl, ctx);
+	spdk_bs_open_blob(bs, ctx->original.id, bs_clone_origblob_open_cpl, ctx);
 }
 
+/* END spdk_bs_create_clone */
+
+/* START spdk_bs_inflate_blob */
+
 static void
-bs_snapshot_freeze_cpl(void *cb_arg, int rc)
+bs_inflate_blob_set_parent_cpl(void *cb_arg, struct spdk_blob *_parent, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *origblob = ctx->original.blob;
-	struct spdk_blob *newblob = ctx->new.blob;
-	int bserrno;
+	struct spdk_blob *_blob = ctx->original.blob;
 
-	if (rc != 0) {
-		bs_clone_snapshot_newblob_cleanup(ctx, rc);
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
 		return;
 	}
 
-	ctx->frozen = true;
+	/* Temporarily override md_ro flag for MD modification */
+	_blob->md_ro = false;
 
-	if (blob_is_esnap_clone(origblob)) {
-		/* Clean up any channels associated with the original blob id because future IO will
-		 * perform IO using the snapshot blob_id.
-		 */
-		blob_esnap_destroy_bs_dev_channels(origblob, false, NULL, NULL);
-	}
-	if (newblob->back_bs_dev) {
-		blob_back_bs_destroy(newblob);
+	bserrno = blob_set_xattr(_blob, BLOB_SNAPSHOT, &_parent->id, sizeof(spdk_blob_id), true);
+	if (bserrno != 0) {
+		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+		return;
 	}
-	/* set new back_bs_dev for snapshot */
-	newblob->back_bs_dev = origblob->back_bs_dev;
-	/* Set invalid flags from origblob */
-	newblob->invalid_flags = origblob->invalid_flags;
 
-	/* inherit parent from original blob if set */
-	newblob->parent_id = origblob->parent_id;
-	switch (origblob->parent_id) {
-	case SPDK_BLOBID_EXTERNAL_SNAPSHOT:
-		bserrno = bs_snapshot_copy_xattr(newblob, origblob, BLOB_EXTERNAL_SNAPSHOT_ID);
-		if (bserrno != 0) {
-			bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
-			return;
+	assert(_parent != NULL);
+
+	bs_blob_list_remove(_blob);
+	_blob->parent_id = _parent->id;
+
+	blob_back_bs_destroy(_blob);
+	_blob->back_bs_dev = bs_create_blob_bs_dev(_parent);
+	bs_blob_list_add(_blob);
+
+	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
+}
+
+static void
+bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx)
+{
+	struct spdk_blob *_blob = ctx->original.blob;
+	struct spdk_blob *_parent;
+
+	if (ctx->allocate_all) {
+		/* remove thin provisioning */
+		bs_blob_list_remove(_blob);
+		if (_blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+			blob_remove_xattr(_blob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
+			_blob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
+		} else {
+			blob_remove_xattr(_blob, BLOB_SNAPSHOT, true);
 		}
-		break;
-	case SPDK_BLOBID_INVALID:
-		break;
-	default:
-		/* Set internal xattr for snapshot id */
-		bserrno = blob_set_xattr(newblob, BLOB_SNAPSHOT,
-					 &origblob->parent_id, sizeof(spdk_blob_id), true);
-		if (bserrno != 0) {
-			bs_clone_snapshot_newblob_cleanup(ctx, bserrno);
+		_blob->invalid_flags = _blob->invalid_flags & ~SPDK_BLOB_THIN_PROV;
+		blob_back_bs_destroy(_blob);
+		_blob->parent_id = SPDK_BLOBID_INVALID;
+	} else {
+		/* For now, esnap clones always have allocate_all set. */
+		assert(!blob_is_esnap_clone(_blob));
+
+		_parent = ((struct spdk_blob_bs_dev *)(_blob->back_bs_dev))->blob;
+		if (_parent->parent_id != SPDK_BLOBID_INVALID) {
+			/* We must change the parent of the inflated blob */
+			spdk_bs_open_blob(_blob->bs, _parent->parent_id,
+					  bs_inflate_blob_set_parent_cpl, ctx);
 			return;
 		}
-	}
 
-	/* swap cluster maps */
-	bs_snapshot_swap_cluster_maps(newblob, origblob);
+		bs_blob_list_remove(_blob);
+		_blob->parent_id = SPDK_BLOBID_INVALID;
+		blob_back_bs_destroy(_blob);
+		_blob->back_bs_dev = bs_create_zeroes_dev();
+	}
 
-	/* Set the clear method on the new blob to match the original. */
-	blob_set_clear_method(newblob, origblob->clear_method);
+	/* Temporarily override md_ro flag for MD modification */
+	_blob->md_ro = false;
+	blob_remove_xattr(_blob, BLOB_SNAPSHOT, true);
+	_blob->state = SPDK_BLOB_STATE_DIRTY;
 
-	/* sync snapshot metadata */
-	spdk_blob_sync_md(newblob, bs_snapshot_newblob_sync_cpl, ctx);
+	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
 }
 
-static void
-bs_snapshot_newblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+/* Check if cluster needs allocation */
+static inline bool
+bs_cluster_needs_allocation(struct spdk_blob *blob, uint64_t cluster, bool allocate_all)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *origblob = ctx->original.blob;
-	struct spdk_blob *newblob = _blob;
+	struct spdk_blob_bs_dev *b;
 
-	if (bserrno != 0) {
-		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
-		return;
+	assert(blob != NULL);
+
+	if (bs_cluster_is_allocated(blob, cluster)) {
+		/* Cluster is already allocated, but some of its sub-clusters may not be copied yet */
+		return bs_cluster_invalid_sub_clusters(blob, cluster) != 0;
 	}
 
-	ctx->new.blob = newblob;
-	assert(spdk_blob_is_thin_provisioned(newblob));
-	assert(spdk_mem_all_zero(newblob->active.clusters,
-				 newblob->active.num_clusters * sizeof(*newblob->active.clusters)));
-	assert(spdk_mem_all_zero(newblob->active.extent_pages,
-				 newblob->active.num_extent_pages * sizeof(*newblob->active.extent_pages)));
+	if (blob->parent_id == SPDK_BLOBID_INVALID) {
+		/* Blob have no parent blob */
+		return allocate_all;
+	}
 
-	blob_freeze_io(origblob, bs_snapshot_freeze_cpl, ctx);
+	if (blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
+		return true;
+	}
+
+	b = (struct spdk_blob_bs_dev *)blob->back_bs_dev;
+	return (allocate_all || bs_cluster_is_allocated(b->blob, cluster));
 }
 
 static void
-bs_snapshot_newblob_create_cpl(void *cb_arg, spdk_blob_id blobid, int bserrno)
+bs_inflate_blob_touch_next(void *cb_arg, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *origblob = ctx->original.blob;
+	struct spdk_blob *_blob = ctx->original.blob;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_user_op_t *op;
+	uint64_t offset;
 
 	if (bserrno != 0) {
 		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
 		return;
 	}
 
-	ctx->new.id = blobid;
-	ctx->cpl.u.blobid.blobid = blobid;
+	for (; ctx->cluster < _blob->active.num_clusters; ctx->cluster++) {
+		if (bs_cluster_needs_allocation(_blob, ctx->cluster, ctx->allocate_all)) {
+			break;
+		}
+	}
 
-	spdk_bs_open_blob(origblob->bs, ctx->new.id, bs_snapshot_newblob_open_cpl, ctx);
-}
+	if (ctx->cluster < _blob->active.num_clusters) {
+		offset = bs_cluster_to_lba(_blob->bs, ctx->cluster);
 
+		/* We may safely increment a cluster before copying */
+		ctx->cluster++;
 
-static void
-bs_xattr_snapshot(void *arg, const char *name,
-		  const void **value, size_t *value_len)
-{
-	assert(strncmp(name, SNAPSHOT_IN_PROGRESS, sizeof(SNAPSHOT_IN_PROGRESS)) == 0);
+		/* Use a dummy 0B read as a context for cluster copy */
+		cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+		cpl.u.blob_basic.cb_fn = bs_inflate_blob_touch_next;
+		cpl.u.blob_basic.cb_arg = ctx;
 
-	struct spdk_blob *blob = (struct spdk_blob *)arg;
-	*value = &blob->id;
-	*value_len = sizeof(blob->id);
+		op = bs_user_op_alloc(ctx->channel, &cpl, SPDK_BLOB_READ, _blob,
+				      NULL, 0, offset, 0);
+		if (!op) {
+			bs_clone_snapshot_origblob_cleanup(ctx, -ENOMEM);
+			return;
+		}
+
+		bs_allocate_and_copy_cluster(_blob, ctx->channel, offset, op, NULL);
+	} else {
+		bs_inflate_blob_done(ctx);
+	}
 }
 
 static void
-bs_snapshot_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
 	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob_opts opts;
-	struct spdk_blob_xattr_opts internal_xattrs;
-	char *xattrs_names[] = { SNAPSHOT_IN_PROGRESS };
+	uint64_t clusters_needed;
+	uint64_t i;
 
 	if (bserrno != 0) {
 		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
@@ -6779,17 +9070,10 @@ bs_snapshot_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno
 	}
 
 	ctx->original.blob = _blob;
-
-	if (_blob->data_ro || _blob->md_ro) {
-		SPDK_DEBUGLOG(blob, "Cannot create snapshot from read only blob with id 0x%"
-			      PRIx64 "\n", _blob->id);
-		ctx->bserrno = -EINVAL;
-		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
-		return;
-	}
+	ctx->original.md_ro = _blob->md_ro;
 
 	if (_blob->locked_operation_in_progress) {
-		SPDK_DEBUGLOG(blob, "Cannot create snapshot - another operation in progress\n");
+		SPDK_DEBUGLOG(blob, "Cannot inflate blob - another operation in progress\n");
 		ctx->bserrno = -EBUSY;
 		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
 		return;
@@ -6797,419 +9081,467 @@ bs_snapshot_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno
 
 	_blob->locked_operation_in_progress = true;
 
-	spdk_blob_opts_init(&opts, sizeof(opts));
-	blob_xattrs_init(&internal_xattrs);
+	switch (_blob->parent_id) {
+	case SPDK_BLOBID_INVALID:
+		if (!ctx->allocate_all) {
+			/* This blob has no parent, so we cannot decouple it. */
+			SPDK_ERRLOG("Cannot decouple parent of blob with no parent.\n");
+			bs_clone_snapshot_origblob_cleanup(ctx, -EINVAL);
+			return;
+		}
+		break;
+	case SPDK_BLOBID_EXTERNAL_SNAPSHOT:
+		/*
+		 * It would be better to rely on back_bs_dev->is_zeroes(), to determine which
+		 * clusters require allocation. Until there is a blobstore consumer that
+		 * uses esnaps with an spdk_bs_dev that implements a useful is_zeroes() it is not
+		 * worth the effort.
+		 */
+		ctx->allocate_all = true;
+		break;
+	default:
+		break;
+	}
 
-	/* Change the size of new blob to the same as in original blob,
-	 * but do not allocate clusters */
-	opts.thin_provision = true;
-	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
-	opts.use_extent_table = _blob->use_extent_table;
+	if (spdk_blob_is_thin_provisioned(_blob) == false) {
+		/* This is not thin provisioned blob. No need to inflate. */
+		bs_clone_snapshot_origblob_cleanup(ctx, 0);
+		return;
+	}
 
-	/* If there are any xattrs specified for snapshot, set them now */
-	if (ctx->xattrs) {
-		memcpy(&opts.xattrs, ctx->xattrs, sizeof(*ctx->xattrs));
+	/* Do two passes - one to verify that we can obtain enough clusters
+	 * and another to actually claim them.
+	 */
+	clusters_needed = 0;
+	for (i = 0; i < _blob->active.num_clusters; i++) {
+		if (_blob->active.clusters[i] == 0 &&
+		    bs_cluster_needs_allocation(_blob, i, ctx->allocate_all)) {
+			clusters_needed++;
+		}
+	}
+
+	if (clusters_needed > _blob->bs->num_free_clusters) {
+		/* Not enough free clusters. Cannot satisfy the request. */
+		bs_clone_snapshot_origblob_cleanup(ctx, -ENOSPC);
+		return;
 	}
-	/* Set internal xattr SNAPSHOT_IN_PROGRESS */
-	internal_xattrs.count = 1;
-	internal_xattrs.ctx = _blob;
-	internal_xattrs.names = xattrs_names;
-	internal_xattrs.get_value = bs_xattr_snapshot;
 
-	bs_create_blob(_blob->bs, &opts, &internal_xattrs,
-		       bs_snapshot_newblob_create_cpl, ctx);
+	ctx->cluster = 0;
+	bs_inflate_blob_touch_next(ctx, 0);
 }
 
-void
-spdk_bs_create_snapshot(struct spdk_blob_store *bs, spdk_blob_id blobid,
-			const struct spdk_blob_xattr_opts *snapshot_xattrs,
-			spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+static void
+bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		spdk_blob_id blobid, bool allocate_all, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_clone_snapshot_ctx *ctx = calloc(1, sizeof(*ctx));
 
 	if (!ctx) {
-		cb_fn(cb_arg, SPDK_BLOBID_INVALID, -ENOMEM);
+		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
-	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
-	ctx->cpl.u.blobid.cb_fn = cb_fn;
-	ctx->cpl.u.blobid.cb_arg = cb_arg;
-	ctx->cpl.u.blobid.blobid = SPDK_BLOBID_INVALID;
+	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	ctx->cpl.u.bs_basic.cb_fn = cb_fn;
+	ctx->cpl.u.bs_basic.cb_arg = cb_arg;
 	ctx->bserrno = 0;
-	ctx->frozen = false;
 	ctx->original.id = blobid;
-	ctx->xattrs = snapshot_xattrs;
+	ctx->channel = channel;
+	ctx->allocate_all = allocate_all;
 
-	spdk_bs_open_blob(bs, ctx->original.id, bs_snapshot_origblob_open_cpl, ctx);
+	bs_open_blob_resident(bs, ctx->original.id, bs_inflate_blob_open_cpl, ctx);
 }
-/* END spdk_bs_create_snapshot */
 
-/* START spdk_bs_create_clone */
-
-static void
-bs_xattr_clone(void *arg, const char *name,
-	       const void **value, size_t *value_len)
+void
+spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	assert(strncmp(name, BLOB_SNAPSHOT, sizeof(BLOB_SNAPSHOT)) == 0);
+	bs_inflate_blob(bs, channel, blobid, true, cb_fn, cb_arg);
+}
 
-	struct spdk_blob *blob = (struct spdk_blob *)arg;
-	*value = &blob->id;
-	*value_len = sizeof(blob->id);
+void
+spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+			     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	bs_inflate_blob(bs, channel, blobid, false, cb_fn, cb_arg);
 }
+/* END spdk_bs_inflate_blob */
+
+/* START spdk_bs_blob_dedup */
+
+struct bs_dedup_ctx {
+	struct spdk_bs_cpl cpl;
+	int bserrno;
+
+	struct spdk_blob_store *bs;
+	spdk_blob_id blobid;
+	struct spdk_blob *blob;
+	bool md_ro;
+	struct spdk_io_channel *channel;
+
+	/* Current cluster and its LBA when it was read */
+	uint64_t cluster;
+	uint64_t cluster_lba;
+
+	/* Data of the cluster and data the blob reads from its backing device in its place */
+	uint8_t *buf;
+	uint8_t *back_buf;
+
+	uint64_t freeze_tsc;
+};
+
+static void bs_dedup_cluster_find_next(struct bs_dedup_ctx *ctx);
 
 static void
-bs_clone_newblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+bs_dedup_cleanup_finish(void *cb_arg, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *clone = _blob;
+	struct bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_bs_cpl *cpl = &ctx->cpl;
 
-	ctx->new.blob = clone;
-	bs_blob_list_add(clone);
+	if (bserrno != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 " dedup, cleanup error %d\n", ctx->blobid, bserrno);
+		if (ctx->bserrno == 0) {
+			ctx->bserrno = bserrno;
+		}
+	}
 
-	spdk_blob_close(clone, bs_clone_snapshot_origblob_cleanup, ctx);
+	spdk_free(ctx->buf);
+	spdk_free(ctx->back_buf);
+
+	cpl->u.blob_basic.cb_fn(cpl->u.blob_basic.cb_arg, ctx->bserrno);
+
+	free(ctx);
 }
 
 static void
-bs_clone_newblob_create_cpl(void *cb_arg, spdk_blob_id blobid, int bserrno)
+bs_dedup_finish(struct bs_dedup_ctx *ctx, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
+	struct spdk_blob *_blob = ctx->blob;
 
-	ctx->cpl.u.blobid.blobid = blobid;
-	spdk_bs_open_blob(ctx->original.blob->bs, blobid, bs_clone_newblob_open_cpl, ctx);
+	if (bserrno != 0 && ctx->bserrno == 0) {
+		ctx->bserrno = bserrno;
+	}
+
+	_blob->locked_operation_in_progress = false;
+	spdk_blob_close(_blob, bs_dedup_cleanup_finish, ctx);
 }
 
 static void
-bs_clone_origblob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+bs_dedup_unfreeze_cpl(void *cb_arg, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx	*ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob_opts		opts;
-	struct spdk_blob_xattr_opts internal_xattrs;
-	char *xattr_names[] = { BLOB_SNAPSHOT };
+	struct bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob_store *bs = ctx->bs;
+	uint64_t ticks;
 
-	if (bserrno != 0) {
-		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
+	ticks = spdk_get_ticks() - ctx->freeze_tsc;
+	bs->dedup_freeze_count++;
+	bs->dedup_freeze_ticks += ticks;
+	bs->dedup_freeze_max_ticks = spdk_max(bs->dedup_freeze_max_ticks, ticks);
+
+	if (bserrno != 0 || ctx->bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
 		return;
 	}
 
-	ctx->original.blob = _blob;
-	ctx->original.md_ro = _blob->md_ro;
+	ctx->cluster++;
+	bs_dedup_cluster_find_next(ctx);
+}
 
-	if (!_blob->data_ro || !_blob->md_ro) {
-		SPDK_DEBUGLOG(blob, "Clone not from read-only blob\n");
-		ctx->bserrno = -EINVAL;
-		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
-		return;
+static void
+bs_dedup_unfreeze(struct bs_dedup_ctx *ctx, int bserrno)
+{
+	if (bserrno != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 " dedup of cluster %" PRIu64 " failed: %d\n",
+			    ctx->blobid, ctx->cluster, bserrno);
+		ctx->bserrno = bserrno;
 	}
 
-	if (_blob->locked_operation_in_progress) {
-		SPDK_DEBUGLOG(blob, "Cannot create clone - another operation in progress\n");
-		ctx->bserrno = -EBUSY;
-		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
-		return;
+	blob_unfreeze_io(ctx->blob, bs_dedup_unfreeze_cpl, ctx);
+}
+
+static void
+bs_dedup_free_cluster_cpl(void *cb_arg, int bserrno)
+{
+	struct bs_dedup_ctx *ctx = cb_arg;
+
+	/* Revert md_ro to original state */
+	ctx->blob->md_ro = ctx->md_ro;
+
+	if (bserrno == 0) {
+		ctx->bs->dedup_clusters_released++;
 	}
 
-	_blob->locked_operation_in_progress = true;
+	bs_dedup_unfreeze(ctx, bserrno);
+}
 
-	spdk_blob_opts_init(&opts, sizeof(opts));
-	blob_xattrs_init(&internal_xattrs);
+static void
+bs_dedup_release_cluster(struct bs_dedup_ctx *ctx)
+{
+	struct spdk_blob *_blob = ctx->blob;
+	uint32_t extent_page = 0;
 
-	opts.thin_provision = true;
-	opts.num_clusters = spdk_blob_get_num_clusters(_blob);
-	opts.use_extent_table = _blob->use_extent_table;
-	if (ctx->xattrs) {
-		memcpy(&opts.xattrs, ctx->xattrs, sizeof(*ctx->xattrs));
+	if (_blob->use_extent_table) {
+		extent_page = *bs_cluster_to_extent_page(_blob, ctx->cluster);
 	}
 
-	/* Set internal xattr BLOB_SNAPSHOT */
-	internal_xattrs.count = 1;
-	internal_xattrs.ctx = _blob;
-	internal_xattrs.names = xattr_names;
-	internal_xattrs.get_value = bs_xattr_clone;
+	/* Temporarily override md_ro flag for MD modification */
+	_blob->md_ro = false;
 
-	bs_create_blob(_blob->bs, &opts, &internal_xattrs,
-		       bs_clone_newblob_create_cpl, ctx);
+	blob_free_cluster_on_md_thread(_blob, ctx->cluster, extent_page,
+				       bs_dedup_free_cluster_cpl, ctx);
 }
 
-void
-spdk_bs_create_clone(struct spdk_blob_store *bs, spdk_blob_id blobid,
-		     const struct spdk_blob_xattr_opts *clone_xattrs,
-		     spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+static void
+bs_dedup_reread_cpl(void *cb_arg, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx	*ctx = calloc(1, sizeof(*ctx));
+	struct bs_dedup_ctx *ctx = cb_arg;
 
-	if (!ctx) {
-		cb_fn(cb_arg, SPDK_BLOBID_INVALID, -ENOMEM);
+	if (bserrno != 0) {
+		bs_dedup_unfreeze(ctx, bserrno);
 		return;
 	}
 
-	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
-	ctx->cpl.u.blobid.cb_fn = cb_fn;
-	ctx->cpl.u.blobid.cb_arg = cb_arg;
-	ctx->cpl.u.blobid.blobid = SPDK_BLOBID_INVALID;
-	ctx->bserrno = 0;
-	ctx->xattrs = clone_xattrs;
-	ctx->original.id = blobid;
+	if (memcmp(ctx->buf, ctx->back_buf, ctx->bs->cluster_sz) != 0) {
+		/* Written after the first comparison */
+		bs_dedup_unfreeze(ctx, 0);
+		return;
+	}
 
-	spdk_bs_open_blob(bs, ctx->original.id, bs_clone_origblob_open_cpl, ctx);
+	/* Unlike a cluster unmapped by the user, the data is not unmapped. Until the release is
+	 * persisted the metadata on disk still maps the cluster, and once it is the cluster may be
+	 * allocated to another blob right away. */
+	bs_dedup_release_cluster(ctx);
 }
 
-/* END spdk_bs_create_clone */
-
-/* START spdk_bs_inflate_blob */
+static void bs_dedup_drain(struct bs_dedup_ctx *ctx);
 
 static void
-bs_inflate_blob_set_parent_cpl(void *cb_arg, struct spdk_blob *_parent, int bserrno)
+bs_dedup_drain_cpl(struct spdk_io_channel_iter *i, int status)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *_blob = ctx->original.blob;
+	struct bs_dedup_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob *_blob = ctx->blob;
+	struct spdk_blob_store *bs = ctx->bs;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_batch_t *batch;
 
-	if (bserrno != 0) {
-		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+	if (status == -EBUSY) {
+		/* I/O submitted before the freeze has not completed yet */
+		bs_dedup_drain(ctx);
 		return;
 	}
 
-	/* Temporarily override md_ro flag for MD modification */
-	_blob->md_ro = false;
-
-	bserrno = blob_set_xattr(_blob, BLOB_SNAPSHOT, &_parent->id, sizeof(spdk_blob_id), true);
-	if (bserrno != 0) {
-		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
+	if (_blob->active.clusters[ctx->cluster] != ctx->cluster_lba ||
+	    bs_cluster_invalid_sub_clusters(_blob, ctx->cluster) != 0) {
+		/* Cluster was unmapped after it was read */
+		bs_dedup_unfreeze(ctx, 0);
 		return;
 	}
 
-	assert(_parent != NULL);
-
-	bs_blob_list_remove(_blob);
-	_blob->parent_id = _parent->id;
+	/* No writes can reach the cluster anymore, compare its current data */
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_dedup_reread_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
 
-	blob_back_bs_destroy(_blob);
-	_blob->back_bs_dev = bs_create_blob_bs_dev(_parent);
-	bs_blob_list_add(_blob);
+	batch = bs_batch_open(ctx->channel, &cpl, _blob);
+	if (!batch) {
+		bs_dedup_unfreeze(ctx, -ENOMEM);
+		return;
+	}
 
-	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
+	bs_batch_read_dev(batch, ctx->buf, ctx->cluster_lba,
+			  bs_dev_byte_to_lba(bs->dev, bs->cluster_sz));
+	bs_batch_close(batch);
 }
 
 static void
-bs_inflate_blob_done(struct spdk_clone_snapshot_ctx *ctx)
+bs_dedup_drain_channel(struct spdk_io_channel_iter *i)
 {
-	struct spdk_blob *_blob = ctx->original.blob;
-	struct spdk_blob *_parent;
-
-	if (ctx->allocate_all) {
-		/* remove thin provisioning */
-		bs_blob_list_remove(_blob);
-		if (_blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
-			blob_remove_xattr(_blob, BLOB_EXTERNAL_SNAPSHOT_ID, true);
-			_blob->invalid_flags &= ~SPDK_BLOB_EXTERNAL_SNAPSHOT;
-		} else {
-			blob_remove_xattr(_blob, BLOB_SNAPSHOT, true);
-		}
-		_blob->invalid_flags = _blob->invalid_flags & ~SPDK_BLOB_THIN_PROV;
-		blob_back_bs_destroy(_blob);
-		_blob->parent_id = SPDK_BLOBID_INVALID;
-	} else {
-		/* For now, esnap clones always have allocate_all set. */
-		assert(!blob_is_esnap_clone(_blob));
+	struct bs_dedup_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	uint32_t j;
 
-		_parent = ((struct spdk_blob_bs_dev *)(_blob->back_bs_dev))->blob;
-		if (_parent->parent_id != SPDK_BLOBID_INVALID) {
-			/* We must change the parent of the inflated blob */
-			spdk_bs_open_blob(_blob->bs, _parent->parent_id,
-					  bs_inflate_blob_set_parent_cpl, ctx);
+	for (j = 0; j < ctx->bs->max_channel_ops; j++) {
+		if (ch->req_mem[j].blob == ctx->blob) {
+			spdk_for_each_channel_continue(i, -EBUSY);
 			return;
 		}
-
-		bs_blob_list_remove(_blob);
-		_blob->parent_id = SPDK_BLOBID_INVALID;
-		blob_back_bs_destroy(_blob);
-		_blob->back_bs_dev = bs_create_zeroes_dev();
 	}
 
-	/* Temporarily override md_ro flag for MD modification */
-	_blob->md_ro = false;
-	blob_remove_xattr(_blob, BLOB_SNAPSHOT, true);
-	_blob->state = SPDK_BLOB_STATE_DIRTY;
-
-	spdk_blob_sync_md(_blob, bs_clone_snapshot_origblob_cleanup, ctx);
+	spdk_for_each_channel_continue(i, 0);
 }
 
-/* Check if cluster needs allocation */
-static inline bool
-bs_cluster_needs_allocation(struct spdk_blob *blob, uint64_t cluster, bool allocate_all)
+/* Wait until no I/O to the frozen blob is in progress on any channel */
+static void
+bs_dedup_drain(struct bs_dedup_ctx *ctx)
 {
-	struct spdk_blob_bs_dev *b;
+	spdk_for_each_channel(ctx->bs, bs_dedup_drain_channel, ctx, bs_dedup_drain_cpl);
+}
 
-	assert(blob != NULL);
+static void
+bs_dedup_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct bs_dedup_ctx *ctx = cb_arg;
 
-	if (blob->active.clusters[cluster] != 0) {
-		/* Cluster is already allocated */
-		return false;
+	if (bserrno != 0) {
+		bs_dedup_finish(ctx, bserrno);
+		return;
 	}
 
-	if (blob->parent_id == SPDK_BLOBID_INVALID) {
-		/* Blob have no parent blob */
-		return allocate_all;
+	bs_dedup_drain(ctx);
+}
+
+static void
+bs_dedup_read_cpl(void *cb_arg, int bserrno)
+{
+	struct bs_dedup_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 " dedup, read error %d\n", ctx->blobid, bserrno);
+		bs_dedup_finish(ctx, bserrno);
+		return;
 	}
 
-	if (blob->parent_id == SPDK_BLOBID_EXTERNAL_SNAPSHOT) {
-		return true;
+	if (memcmp(ctx->buf, ctx->back_buf, ctx->bs->cluster_sz) != 0) {
+		ctx->cluster++;
+		bs_dedup_cluster_find_next(ctx);
+		return;
 	}
 
-	b = (struct spdk_blob_bs_dev *)blob->back_bs_dev;
-	return (allocate_all || b->blob->active.clusters[cluster] != 0);
+	/* Data may still change while I/O is not frozen, check it again once it is */
+	ctx->freeze_tsc = spdk_get_ticks();
+	blob_freeze_io(ctx->blob, bs_dedup_freeze_cpl, ctx);
 }
 
 static void
-bs_inflate_blob_touch_next(void *cb_arg, int bserrno)
+bs_dedup_cluster_find_next(struct bs_dedup_ctx *ctx)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	struct spdk_blob *_blob = ctx->original.blob;
+	struct spdk_blob *_blob = ctx->blob;
+	struct spdk_blob_store *bs = ctx->bs;
+	struct spdk_bs_dev *back_bs_dev = _blob->back_bs_dev;
 	struct spdk_bs_cpl cpl;
-	spdk_bs_user_op_t *op;
-	uint64_t offset;
-
-	if (bserrno != 0) {
-		bs_clone_snapshot_origblob_cleanup(ctx, bserrno);
-		return;
-	}
+	spdk_bs_batch_t *batch;
+	uint64_t io_unit;
 
 	for (; ctx->cluster < _blob->active.num_clusters; ctx->cluster++) {
-		if (bs_cluster_needs_allocation(_blob, ctx->cluster, ctx->allocate_all)) {
+		if (_blob->active.clusters[ctx->cluster] == 0 ||
+		    bs_cluster_invalid_sub_clusters(_blob, ctx->cluster) != 0) {
+			continue;
+		}
+
+		/* Clusters past the end of the parent have nothing to be shared with */
+		io_unit = bs_cluster_to_io_unit(bs, ctx->cluster);
+		if (back_bs_dev->is_range_valid(back_bs_dev,
+						bs_dev_io_unit_to_lba(_blob, back_bs_dev, io_unit),
+						bs_dev_byte_to_lba(back_bs_dev, bs->cluster_sz))) {
 			break;
 		}
 	}
 
-	if (ctx->cluster < _blob->active.num_clusters) {
-		offset = bs_cluster_to_lba(_blob->bs, ctx->cluster);
-
-		/* We may safely increment a cluster before copying */
-		ctx->cluster++;
+	if (ctx->cluster >= _blob->active.num_clusters) {
+		bs_dedup_finish(ctx, 0);
+		return;
+	}
 
-		/* Use a dummy 0B read as a context for cluster copy */
-		cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-		cpl.u.blob_basic.cb_fn = bs_inflate_blob_touch_next;
-		cpl.u.blob_basic.cb_arg = ctx;
+	ctx->cluster_lba = _blob->active.clusters[ctx->cluster];
+	bs->dedup_clusters_scanned++;
 
-		op = bs_user_op_alloc(ctx->channel, &cpl, SPDK_BLOB_READ, _blob,
-				      NULL, 0, offset, 0);
-		if (!op) {
-			bs_clone_snapshot_origblob_cleanup(ctx, -ENOMEM);
-			return;
-		}
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = bs_dedup_read_cpl;
+	cpl.u.blob_basic.cb_arg = ctx;
 
-		bs_allocate_and_copy_cluster(_blob, ctx->channel, offset, op);
-	} else {
-		bs_inflate_blob_done(ctx);
+	batch = bs_batch_open(ctx->channel, &cpl, _blob);
+	if (!batch) {
+		bs_dedup_finish(ctx, -ENOMEM);
+		return;
 	}
+
+	bs_batch_read_dev(batch, ctx->buf, ctx->cluster_lba,
+			  bs_dev_byte_to_lba(bs->dev, bs->cluster_sz));
+	bs_batch_read_bs_dev(batch, back_bs_dev, ctx->back_buf,
+			     bs_dev_io_unit_to_lba(_blob, back_bs_dev, io_unit),
+			     bs_dev_byte_to_lba(back_bs_dev, bs->cluster_sz));
+	bs_batch_close(batch);
 }
 
 static void
-bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
+bs_dedup_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 {
-	struct spdk_clone_snapshot_ctx *ctx = (struct spdk_clone_snapshot_ctx *)cb_arg;
-	uint64_t clusters_needed;
-	uint64_t i;
+	struct bs_dedup_ctx *ctx = cb_arg;
+	struct spdk_blob_list *snapshot_entry;
 
 	if (bserrno != 0) {
-		bs_clone_snapshot_cleanup_finish(ctx, bserrno);
+		ctx->bserrno = bserrno;
+		bs_dedup_cleanup_finish(ctx, 0);
 		return;
 	}
 
-	ctx->original.blob = _blob;
-	ctx->original.md_ro = _blob->md_ro;
-
 	if (_blob->locked_operation_in_progress) {
-		SPDK_DEBUGLOG(blob, "Cannot inflate blob - another operation in progress\n");
+		SPDK_DEBUGLOG(blob, "Cannot dedup blob - another operation in progress\n");
 		ctx->bserrno = -EBUSY;
-		spdk_blob_close(_blob, bs_clone_snapshot_cleanup_finish, ctx);
+		spdk_blob_close(_blob, bs_dedup_cleanup_finish, ctx);
 		return;
 	}
 
-	_blob->locked_operation_in_progress = true;
-
-	switch (_blob->parent_id) {
-	case SPDK_BLOBID_INVALID:
-		if (!ctx->allocate_all) {
-			/* This blob has no parent, so we cannot decouple it. */
-			SPDK_ERRLOG("Cannot decouple parent of blob with no parent.\n");
-			bs_clone_snapshot_origblob_cleanup(ctx, -EINVAL);
-			return;
-		}
-		break;
-	case SPDK_BLOBID_EXTERNAL_SNAPSHOT:
-		/*
-		 * It would be better to rely on back_bs_dev->is_zeroes(), to determine which
-		 * clusters require allocation. Until there is a blobstore consumer that
-		 * uses esnaps with an spdk_bs_dev that implements a useful is_zeroes() it is not
-		 * worth the effort.
-		 */
-		ctx->allocate_all = true;
-		break;
-	default:
-		break;
-	}
-
-	if (spdk_blob_is_thin_provisioned(_blob) == false) {
-		/* This is not thin provisioned blob. No need to inflate. */
-		bs_clone_snapshot_origblob_cleanup(ctx, 0);
+	/* Copy-on-write of a clone reads the clusters of its parent without freezing the parent,
+	 * so they cannot be released under it. New clones are not created while the operation
+	 * is in progress. */
+	snapshot_entry = bs_get_snapshot_entry(ctx->bs, _blob->id);
+	if (snapshot_entry != NULL && snapshot_entry->clone_count > 0) {
+		SPDK_DEBUGLOG(blob, "Cannot dedup blob 0x%" PRIx64 " - it has clones\n", _blob->id);
+		ctx->bserrno = -EBUSY;
+		spdk_blob_close(_blob, bs_dedup_cleanup_finish, ctx);
 		return;
 	}
 
-	/* Do two passes - one to verify that we can obtain enough clusters
-	 * and another to actually claim them.
-	 */
-	clusters_needed = 0;
-	for (i = 0; i < _blob->active.num_clusters; i++) {
-		if (bs_cluster_needs_allocation(_blob, i, ctx->allocate_all)) {
-			clusters_needed++;
-		}
-	}
+	ctx->blob = _blob;
+	ctx->md_ro = _blob->md_ro;
 
-	if (clusters_needed > _blob->bs->num_free_clusters) {
-		/* Not enough free clusters. Cannot satisfy the request. */
-		bs_clone_snapshot_origblob_cleanup(ctx, -ENOSPC);
+	if (!spdk_blob_is_thin_provisioned(_blob)) {
+		/* Clusters of a thick provisioned blob cannot be released */
+		spdk_blob_close(_blob, bs_dedup_cleanup_finish, ctx);
 		return;
 	}
 
+	_blob->locked_operation_in_progress = true;
+
 	ctx->cluster = 0;
-	bs_inflate_blob_touch_next(ctx, 0);
+	bs_dedup_cluster_find_next(ctx);
 }
 
-static void
-bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
-		spdk_blob_id blobid, bool allocate_all, spdk_blob_op_complete cb_fn, void *cb_arg)
+void
+spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		   spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
-	struct spdk_clone_snapshot_ctx *ctx = calloc(1, sizeof(*ctx));
+	struct bs_dedup_ctx *ctx;
 
+	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
 		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
+
 	ctx->cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
-	ctx->cpl.u.bs_basic.cb_fn = cb_fn;
-	ctx->cpl.u.bs_basic.cb_arg = cb_arg;
-	ctx->bserrno = 0;
-	ctx->original.id = blobid;
+	ctx->cpl.u.blob_basic.cb_fn = cb_fn;
+	ctx->cpl.u.blob_basic.cb_arg = cb_arg;
+	ctx->bs = bs;
+	ctx->blobid = blobid;
 	ctx->channel = channel;
-	ctx->allocate_all = allocate_all;
 
-	spdk_bs_open_blob(bs, ctx->original.id, bs_inflate_blob_open_cpl, ctx);
-}
-
-void
-spdk_bs_inflate_blob(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
-		     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
-{
-	bs_inflate_blob(bs, channel, blobid, true, cb_fn, cb_arg);
-}
+	ctx->buf = spdk_malloc(bs->cluster_sz, bs->dev->blocklen, NULL,
+			       SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	ctx->back_buf = spdk_malloc(bs->cluster_sz, bs->dev->blocklen, NULL,
+				    SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (!ctx->buf || !ctx->back_buf) {
+		spdk_free(ctx->buf);
+		spdk_free(ctx->back_buf);
+		free(ctx);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
 
-void
-spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
-			     spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
-{
-	bs_inflate_blob(bs, channel, blobid, false, cb_fn, cb_arg);
+	bs_open_blob_resident(bs, blobid, bs_dedup_open_cpl, ctx);
 }
-/* END spdk_bs_inflate_blob */
+/* END spdk_bs_blob_dedup */
 
 /* START spdk_bs_blob_shallow_copy */
 
@@ -7328,10 +9660,11 @@ bs_shallow_copy_cluster_find_next(void *cb_arg)
 	}
 
 	if (ctx->cluster < _blob->active.num_clusters) {
-		blob_request_submit_op_single(ctx->blob_channel, _blob, ctx->read_buff,
-					      bs_cluster_to_lba(_blob->bs, ctx->cluster),
-					      bs_dev_byte_to_lba(_blob->bs->dev, _blob->bs->cluster_sz),
-					      bs_shallow_copy_blob_read_cpl, ctx, SPDK_BLOB_READ);
+		/* Partially copied clusters are split at sub-cluster boundaries */
+		blob_request_submit_op(_blob, ctx->blob_channel, ctx->read_buff,
+				       bs_cluster_to_lba(_blob->bs, ctx->cluster),
+				       bs_dev_byte_to_lba(_blob->bs->dev, _blob->bs->cluster_sz),
+				       bs_shallow_copy_blob_read_cpl, ctx, SPDK_BLOB_READ);
 	} else {
 		_blob->locked_operation_in_progress = false;
 		spdk_blob_close(_blob, bs_shallow_copy_cleanup_finish, ctx);
@@ -7433,7 +9766,7 @@ spdk_bs_blob_shallow_copy(struct spdk_blob_store *bs, struct spdk_io_channel *ch
 	ctx->ext_dev = ext_dev;
 	ctx->ext_channel = ext_channel;
 
-	spdk_bs_open_blob(ctx->bs, ctx->blobid, bs_shallow_copy_blob_open_cpl, ctx);
+	bs_open_blob_resident(ctx->bs, ctx->blobid, bs_shallow_copy_blob_open_cpl, ctx);
 
 	return 0;
 }
@@ -7878,6 +10211,16 @@ bs_resize_unfreeze_cpl(void *cb_arg, int rc)
 	free(ctx);
 }
 
+static void
+bs_resize_reclaim_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_resize_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->rc = blob_resize(ctx->blob, ctx->sz);
+
+	blob_unfreeze_io(ctx->blob, bs_resize_unfreeze_cpl, ctx);
+}
+
 static void
 bs_resize_freeze_cpl(void *cb_arg, int rc)
 {
@@ -7891,10 +10234,31 @@ bs_resize_freeze_cpl(void *cb_arg, int rc)
 	}
 
 	ctx->rc = blob_resize(ctx->blob, ctx->sz);
+	if (ctx->rc == -ENOSPC && bs_has_reserved_clusters(ctx->blob->bs)) {
+		/* The free clusters may be reserved by I/O channels. Return them and retry. */
+		spdk_for_each_channel(ctx->blob->bs, bs_channel_release_clusters_iter, ctx,
+				      bs_resize_reclaim_clusters_done);
+		return;
+	}
 
 	blob_unfreeze_io(ctx->blob, bs_resize_unfreeze_cpl, ctx);
 }
 
+static void
+bs_resize_extent_pages_cpl(void *cb_arg, int rc)
+{
+	struct spdk_bs_resize_ctx *ctx = (struct spdk_bs_resize_ctx *)cb_arg;
+
+	if (rc != 0) {
+		ctx->blob->locked_operation_in_progress = false;
+		ctx->cb_fn(ctx->cb_arg, rc);
+		free(ctx);
+		return;
+	}
+
+	blob_freeze_io(ctx->blob, bs_resize_freeze_cpl, ctx);
+}
+
 void
 spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
@@ -7930,7 +10294,7 @@ spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_f
 	ctx->cb_arg = cb_arg;
 	ctx->blob = blob;
 	ctx->sz = sz;
-	blob_freeze_io(blob, bs_resize_freeze_cpl, ctx);
+	blob_load_extent_pages(blob, bs_resize_extent_pages_cpl, ctx);
 }
 
 /* END spdk_blob_resize */
@@ -7983,6 +10347,9 @@ struct delete_snapshot_ctx {
 	void *cb_arg;
 	int bserrno;
 	uint32_t next_extent_page;
+	/* Used to copy the sub-clusters the clone still reads from the snapshot */
+	struct spdk_io_channel *channel;
+	uint64_t next_cluster;
 };
 
 static void
@@ -8140,6 +10507,9 @@ delete_snapshot_sync_clone_cpl(void *cb_arg, int bserrno)
 				ctx->snapshot->active.num_allocated_clusters--;
 			}
 			ctx->snapshot->active.clusters[i] = 0;
+			if (i < ctx->snapshot->num_sub_cluster_masks) {
+				ctx->snapshot->sub_cluster_masks[i] = 0;
+			}
 		}
 	}
 	for (i = 0; i < ctx->snapshot->active.num_extent_pages &&
@@ -8239,48 +10609,171 @@ delete_snapshot_update_extent_pages(void *cb_arg, int bserrno)
 	delete_snapshot_update_extent_pages_cpl(ctx);
 }
 
+static void
+delete_snapshot_sync_clone_sub_clusters_cpl(void *cb_arg, int bserrno)
+{
+	struct delete_snapshot_ctx *ctx = cb_arg;
+
+	if (bserrno) {
+		delete_snapshot_sync_clone_cpl(ctx, bserrno);
+		return;
+	}
+
+	delete_snapshot_update_extent_pages(ctx, 0);
+}
+
 static void
 delete_snapshot_sync_snapshot_xattr_cpl(void *cb_arg, int bserrno)
 {
 	struct delete_snapshot_ctx *ctx = cb_arg;
+	bool sub_clusters_moved = false;
 	uint64_t i;
 
 	/* Temporarily override md_ro flag for clone for MD modification */
 	ctx->clone_md_ro = ctx->clone->md_ro;
 	ctx->clone->md_ro = false;
 
-	if (bserrno) {
-		SPDK_ERRLOG("Failed to sync MD with xattr on blob\n");
+	if (bserrno) {
+		SPDK_ERRLOG("Failed to sync MD with xattr on blob\n");
+		ctx->bserrno = bserrno;
+		delete_snapshot_cleanup_clone(ctx, 0);
+		return;
+	}
+
+	/* Copy snapshot map to clone map (only unallocated clusters in clone) */
+	for (i = 0; i < ctx->snapshot->active.num_clusters && i < ctx->clone->active.num_clusters; i++) {
+		if (ctx->clone->active.clusters[i] == 0) {
+			ctx->clone->active.clusters[i] = ctx->snapshot->active.clusters[i];
+			if (ctx->clone->active.clusters[i] != 0) {
+				ctx->clone->active.num_allocated_clusters++;
+			}
+			if (bs_cluster_invalid_sub_clusters(ctx->snapshot, i) != 0) {
+				/* The sub-clusters left in the parent of the snapshot are read from
+				 * the same device by the clone. */
+				assert(i < ctx->clone->num_sub_cluster_masks);
+				ctx->clone->sub_cluster_masks[i] = ctx->snapshot->sub_cluster_masks[i];
+				sub_clusters_moved = true;
+			}
+		}
+	}
+	ctx->next_extent_page = 0;
+
+	if (sub_clusters_moved && ctx->clone->use_extent_table) {
+		/* Persist the sub-cluster masks before the extent pages point at the clusters */
+		ctx->clone->state = SPDK_BLOB_STATE_DIRTY;
+		blob_sync_md(ctx->clone, delete_snapshot_sync_clone_sub_clusters_cpl, ctx);
+		return;
+	}
+
+	delete_snapshot_update_extent_pages(ctx, 0);
+}
+
+static void
+delete_snapshot_esnap_channels_destroyed_cb(void *cb_arg, struct spdk_blob *blob, int bserrno)
+{
+	struct delete_snapshot_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("blob 0x%" PRIx64 ": failed to destroy esnap channels: %d\n",
+			    blob->id, bserrno);
+		/* That error should not stop us from syncing metadata. */
+	}
+
+	spdk_blob_sync_md(ctx->snapshot, delete_snapshot_sync_snapshot_xattr_cpl, ctx);
+}
+
+static void
+delete_snapshot_mark_pending_removal(struct delete_snapshot_ctx *ctx)
+{
+	/* Temporarily override md_ro flag for snapshot for MD modification */
+	ctx->snapshot_md_ro = ctx->snapshot->md_ro;
+	ctx->snapshot->md_ro = false;
+
+	/* Mark blob as pending for removal for power failure safety, use clone id for recovery */
+	ctx->bserrno = blob_set_xattr(ctx->snapshot, SNAPSHOT_PENDING_REMOVAL, &ctx->clone->id,
+				      sizeof(spdk_blob_id), true);
+	if (ctx->bserrno != 0) {
+		delete_snapshot_cleanup_clone(ctx, 0);
+		return;
+	}
+
+	if (blob_is_esnap_clone(ctx->snapshot)) {
+		blob_esnap_destroy_bs_dev_channels(ctx->snapshot, false,
+						   delete_snapshot_esnap_channels_destroyed_cb,
+						   ctx);
+		return;
+	}
+
+	spdk_blob_sync_md(ctx->snapshot, delete_snapshot_sync_snapshot_xattr_cpl, ctx);
+}
+
+static bool
+blob_has_partial_clusters(struct spdk_blob *blob)
+{
+	uint64_t i;
+
+	for (i = 0; i < blob->num_sub_cluster_masks; i++) {
+		if (blob->sub_cluster_masks[i] != 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Copy the sub-clusters of partially copied clusters of the clone that are still read from
+ * clusters of the snapshot, before those clusters are released along with the snapshot.
+ */
+static void
+delete_snapshot_fill_clone_next(void *cb_arg, int bserrno)
+{
+	struct delete_snapshot_ctx *ctx = cb_arg;
+	struct spdk_blob *clone = ctx->clone;
+	struct spdk_bs_cpl cpl;
+	spdk_bs_user_op_t *op;
+	uint64_t offset;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to copy sub-clusters to clone\n");
+		spdk_bs_free_io_channel(ctx->channel);
+		ctx->channel = NULL;
 		ctx->bserrno = bserrno;
 		delete_snapshot_cleanup_clone(ctx, 0);
 		return;
 	}
 
-	/* Copy snapshot map to clone map (only unallocated clusters in clone) */
-	for (i = 0; i < ctx->snapshot->active.num_clusters && i < ctx->clone->active.num_clusters; i++) {
-		if (ctx->clone->active.clusters[i] == 0) {
-			ctx->clone->active.clusters[i] = ctx->snapshot->active.clusters[i];
-			if (ctx->clone->active.clusters[i] != 0) {
-				ctx->clone->active.num_allocated_clusters++;
-			}
+	for (; ctx->next_cluster < clone->active.num_clusters &&
+	     ctx->next_cluster < ctx->snapshot->active.num_clusters; ctx->next_cluster++) {
+		if (bs_cluster_invalid_sub_clusters(clone, ctx->next_cluster) != 0 &&
+		    ctx->snapshot->active.clusters[ctx->next_cluster] != 0) {
+			break;
 		}
 	}
-	ctx->next_extent_page = 0;
-	delete_snapshot_update_extent_pages(ctx, 0);
-}
 
-static void
-delete_snapshot_esnap_channels_destroyed_cb(void *cb_arg, struct spdk_blob *blob, int bserrno)
-{
-	struct delete_snapshot_ctx *ctx = cb_arg;
+	if (ctx->next_cluster < clone->active.num_clusters &&
+	    ctx->next_cluster < ctx->snapshot->active.num_clusters) {
+		offset = bs_cluster_to_lba(clone->bs, ctx->next_cluster);
+		ctx->next_cluster++;
 
-	if (bserrno != 0) {
-		SPDK_ERRLOG("blob 0x%" PRIx64 ": failed to destroy esnap channels: %d\n",
-			    blob->id, bserrno);
-		/* That error should not stop us from syncing metadata. */
+		/* Use a dummy 0B read as a context for sub-cluster copy */
+		cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+		cpl.u.blob_basic.cb_fn = delete_snapshot_fill_clone_next;
+		cpl.u.blob_basic.cb_arg = ctx;
+
+		op = bs_user_op_alloc(ctx->channel, &cpl, SPDK_BLOB_READ, clone, NULL, 0, offset, 0);
+		if (!op) {
+			delete_snapshot_fill_clone_next(ctx, -ENOMEM);
+			return;
+		}
+
+		bs_allocate_and_copy_cluster(clone, ctx->channel, offset, op, NULL);
+		return;
 	}
 
-	spdk_blob_sync_md(ctx->snapshot, delete_snapshot_sync_snapshot_xattr_cpl, ctx);
+	spdk_bs_free_io_channel(ctx->channel);
+	ctx->channel = NULL;
+	delete_snapshot_mark_pending_removal(ctx);
 }
 
 static void
@@ -8295,26 +10788,20 @@ delete_snapshot_freeze_io_cb(void *cb_arg, int bserrno)
 		return;
 	}
 
-	/* Temporarily override md_ro flag for snapshot for MD modification */
-	ctx->snapshot_md_ro = ctx->snapshot->md_ro;
-	ctx->snapshot->md_ro = false;
-
-	/* Mark blob as pending for removal for power failure safety, use clone id for recovery */
-	ctx->bserrno = blob_set_xattr(ctx->snapshot, SNAPSHOT_PENDING_REMOVAL, &ctx->clone->id,
-				      sizeof(spdk_blob_id), true);
-	if (ctx->bserrno != 0) {
-		delete_snapshot_cleanup_clone(ctx, 0);
+	if (!blob_has_partial_clusters(ctx->clone)) {
+		delete_snapshot_mark_pending_removal(ctx);
 		return;
 	}
 
-	if (blob_is_esnap_clone(ctx->snapshot)) {
-		blob_esnap_destroy_bs_dev_channels(ctx->snapshot, false,
-						   delete_snapshot_esnap_channels_destroyed_cb,
-						   ctx);
+	ctx->channel = spdk_bs_alloc_io_channel(ctx->clone->bs);
+	if (ctx->channel == NULL) {
+		ctx->bserrno = -ENOMEM;
+		delete_snapshot_cleanup_clone(ctx, 0);
 		return;
 	}
 
-	spdk_blob_sync_md(ctx->snapshot, delete_snapshot_sync_snapshot_xattr_cpl, ctx);
+	ctx->next_cluster = 0;
+	delete_snapshot_fill_clone_next(ctx, 0);
 }
 
 static void
@@ -8338,6 +10825,14 @@ delete_snapshot_open_clone_cb(void *cb_arg, struct spdk_blob *clone, int bserrno
 		return;
 	}
 
+	if (clone->io_units_per_sub_cluster != ctx->snapshot->io_units_per_sub_cluster &&
+	    blob_has_partial_clusters(ctx->snapshot)) {
+		SPDK_ERRLOG("Cannot remove blob - its clone uses a different sub-cluster size\n");
+		ctx->bserrno = -ENOTSUP;
+		spdk_blob_close(ctx->clone, delete_snapshot_cleanup_snapshot, ctx);
+		return;
+	}
+
 	clone->locked_operation_in_progress = true;
 
 	blob_freeze_io(clone, delete_snapshot_freeze_io_cb, ctx);
@@ -8365,7 +10860,7 @@ update_clone_on_snapshot_deletion(struct spdk_blob *snapshot, struct delete_snap
 	blob_get_snapshot_and_clone_entries(snapshot, &ctx->parent_snapshot_entry,
 					    &snapshot_clone_entry);
 
-	spdk_bs_open_blob(snapshot->bs, clone_entry->id, delete_snapshot_open_clone_cb, ctx);
+	bs_open_blob_resident(snapshot->bs, clone_entry->id, delete_snapshot_open_clone_cb, ctx);
 }
 
 static void
@@ -8539,7 +11034,7 @@ spdk_bs_delete_blob(struct spdk_blob_store *bs, spdk_blob_id blobid,
 		return;
 	}
 
-	spdk_bs_open_blob(bs, blobid, bs_delete_open_cpl, seq);
+	bs_open_blob_resident(bs, blobid, bs_delete_open_cpl, seq);
 }
 
 /* END spdk_bs_delete_blob */
@@ -8745,11 +11240,18 @@ struct spdk_blob_cluster_op_ctx {
 	struct spdk_blob	*blob;
 	uint32_t		cluster_num;	/* cluster index in blob */
 	uint32_t		cluster;	/* cluster on disk */
+	uint64_t		sub_cluster_mask; /* sub-clusters not copied to the cluster */
 	uint32_t		extent_page;	/* extent page on disk */
-	struct spdk_blob_md_page *page; /* preallocated extent page */
 	int			rc;
+	spdk_blob_op_complete	mapped_fn;
 	spdk_blob_op_complete	cb_fn;
 	void			*cb_arg;
+	/* Called on ep_thread once the extent page write that includes this update completes */
+	spdk_blob_op_complete	ep_cb_fn;
+	struct spdk_thread	*ep_thread;
+	/* Channel the extent page is written on when this update issues the write */
+	struct spdk_io_channel	*channel;
+	TAILQ_ENTRY(spdk_blob_cluster_op_ctx) link;
 };
 
 static void
@@ -8776,8 +11278,10 @@ blob_insert_new_ep_cb(void *arg, int bserrno)
 	struct spdk_blob_cluster_op_ctx *ctx = arg;
 	uint32_t *extent_page;
 
+	spdk_spin_lock(&ctx->blob->md_lock);
 	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
 	*extent_page = ctx->extent_page;
+	spdk_spin_unlock(&ctx->blob->md_lock);
 	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
 	blob_sync_md(ctx->blob, blob_op_cluster_msg_cb, ctx);
 }
@@ -8789,14 +11293,47 @@ struct spdk_blob_write_extent_page_ctx {
 	struct spdk_blob_md_page	*page;
 };
 
+/*
+ * Map a cluster back to the blob after its release could not be persisted, as the metadata on
+ * disk may still map it. Returns false if the cluster was allocated again in the meantime.
+ */
+static bool
+blob_free_cluster_revert(struct spdk_blob_cluster_op_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t extent_table_id = bs_cluster_to_extent_table_id(ctx->cluster_num);
+
+	spdk_spin_lock(&blob->md_lock);
+	if (*bs_blob_cluster_lba(blob, ctx->cluster_num) != 0) {
+		spdk_spin_unlock(&blob->md_lock);
+		return false;
+	}
+
+	blob_set_cluster_lba(blob, ctx->cluster_num, bs_cluster_to_lba(blob->bs, ctx->cluster));
+	blob->active.num_allocated_clusters++;
+	if (blob->use_extent_table && blob->active.extent_pages[extent_table_id] == 0) {
+		blob->active.extent_pages[extent_table_id] = ctx->extent_page;
+	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	/* Write the mapping again with the next metadata sync */
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+	return true;
+}
+
 static void
 blob_free_cluster_msg_cb(void *arg, int bserrno)
 {
 	struct spdk_blob_cluster_op_ctx *ctx = arg;
 
-	spdk_spin_lock(&ctx->blob->bs->used_lock);
-	bs_release_cluster(ctx->blob->bs, ctx->cluster);
-	spdk_spin_unlock(&ctx->blob->bs->used_lock);
+	if (bserrno != 0 && blob_free_cluster_revert(ctx)) {
+		SPDK_ERRLOG("Failed to persist the release of cluster %" PRIu32 " of blob 0x%" PRIx64
+			    ": %d\n", ctx->cluster_num, ctx->blob->id, bserrno);
+	} else {
+		spdk_spin_lock(&ctx->blob->bs->used_lock);
+		bs_release_cluster(ctx->blob->bs, ctx->cluster);
+		spdk_spin_unlock(&ctx->blob->bs->used_lock);
+	}
 
 	ctx->rc = bserrno;
 	spdk_thread_send_msg(ctx->thread, blob_op_cluster_msg_cpl, ctx);
@@ -8816,17 +11353,34 @@ blob_free_cluster_update_ep_cb(void *arg, int bserrno)
 	blob_sync_md(ctx->blob, blob_free_cluster_msg_cb, ctx);
 }
 
+static void
+blob_free_cluster_free_ep_sync_cb(void *arg, int bserrno)
+{
+	struct spdk_blob_cluster_op_ctx *ctx = arg;
+
+	if (bserrno == 0) {
+		/* The extent table on disk does not reference the extent page anymore */
+		spdk_spin_lock(&ctx->blob->bs->used_lock);
+		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
+		bs_release_md_page(ctx->blob->bs, ctx->extent_page);
+		spdk_spin_unlock(&ctx->blob->bs->used_lock);
+	}
+
+	blob_free_cluster_msg_cb(ctx, bserrno);
+}
+
 static void
 blob_free_cluster_free_ep_cb(void *arg, int bserrno)
 {
 	struct spdk_blob_cluster_op_ctx *ctx = arg;
 
-	spdk_spin_lock(&ctx->blob->bs->used_lock);
-	assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-	bs_release_md_page(ctx->blob->bs, ctx->extent_page);
-	spdk_spin_unlock(&ctx->blob->bs->used_lock);
+	if (bserrno != 0) {
+		blob_free_cluster_msg_cb(ctx, bserrno);
+		return;
+	}
+
 	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob_sync_md(ctx->blob, blob_free_cluster_msg_cb, ctx);
+	blob_sync_md(ctx->blob, blob_free_cluster_free_ep_sync_cb, ctx);
 }
 
 static void
@@ -8853,8 +11407,22 @@ blob_write_extent_page_ready(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 }
 
 static void
-blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
-		       struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg)
+blob_fill_extent_page(struct spdk_blob *blob, uint64_t cluster_num, struct spdk_blob_md_page *page)
+{
+	assert(page);
+	page->next = SPDK_INVALID_MD_PAGE;
+	page->id = blob->id;
+	page->sequence_num = 0;
+
+	blob_serialize_extent_page(blob, cluster_num, page);
+
+	page->crc = blob_md_page_calc_crc(page);
+}
+
+static void
+blob_write_extent_page_on_channel(struct spdk_blob *blob, struct spdk_io_channel *channel,
+				  uint32_t extent, struct spdk_blob_md_page *page,
+				  spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_blob_write_extent_page_ctx	*ctx;
 	spdk_bs_sequence_t			*seq;
@@ -8873,25 +11441,217 @@ blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster
 	cpl.u.blob_basic.cb_fn = cb_fn;
 	cpl.u.blob_basic.cb_arg = cb_arg;
 
-	seq = bs_sequence_start_bs(blob->bs->md_channel, &cpl);
+	seq = bs_sequence_start_bs(channel, &cpl);
 	if (!seq) {
 		free(ctx);
 		cb_fn(cb_arg, -ENOMEM);
 		return;
 	}
 
-	assert(page);
-	page->next = SPDK_INVALID_MD_PAGE;
-	page->id = blob->id;
-	page->sequence_num = 0;
-
-	blob_serialize_extent_page(blob, cluster_num, page);
+	bs_mark_dirty(seq, blob->bs, blob_write_extent_page_ready, ctx);
+}
 
-	page->crc = blob_md_page_calc_crc(page);
+static void
+blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster_num,
+		       struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	blob_fill_extent_page(blob, cluster_num, page);
 
 	assert(spdk_bit_array_get(blob->bs->used_md_pages, extent) == true);
 
-	bs_mark_dirty(seq, blob->bs, blob_write_extent_page_ready, ctx);
+	blob_write_extent_page_on_channel(blob, blob->bs->md_channel, extent, page, cb_fn, cb_arg);
+}
+
+static void blob_ep_flush_write(struct spdk_blob_ep_flush *flush);
+
+static void
+blob_ep_flush_write_msg(void *arg)
+{
+	blob_ep_flush_write(arg);
+}
+
+static void
+blob_ep_flush_done_msg(void *arg)
+{
+	struct spdk_blob_cluster_op_ctx *ctx = arg;
+
+	ctx->ep_cb_fn(ctx, ctx->rc);
+}
+
+static void
+blob_ep_flush_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_ep_flush *flush = cb_arg;
+	struct spdk_blob *blob = flush->blob;
+	TAILQ_HEAD(, spdk_blob_cluster_op_ctx) done;
+	TAILQ_HEAD(, freeze_io_ctx) waiters;
+	struct spdk_blob_cluster_op_ctx *ctx, *next = NULL;
+	struct freeze_io_ctx *freeze_ctx;
+
+	TAILQ_INIT(&done);
+	TAILQ_INIT(&waiters);
+
+	spdk_spin_lock(&blob->md_lock);
+	TAILQ_SWAP(&flush->writing, &done, spdk_blob_cluster_op_ctx, link);
+
+	if (!TAILQ_EMPTY(&flush->queued)) {
+		/* All updates that arrived during the previous write go out with a single write. */
+		TAILQ_SWAP(&flush->writing, &flush->queued, spdk_blob_cluster_op_ctx, link);
+		next = TAILQ_FIRST(&flush->writing);
+		flush->channel = next->channel;
+	} else {
+		TAILQ_REMOVE(&blob->ep_flushes, flush, link);
+		TAILQ_INSERT_HEAD(&blob->free_ep_flushes, flush, link);
+		if (TAILQ_EMPTY(&blob->ep_flushes)) {
+			TAILQ_SWAP(&blob->ep_flush_waiters, &waiters, freeze_io_ctx, link);
+		}
+	}
+	spdk_spin_unlock(&blob->md_lock);
+
+	if (next != NULL) {
+		if (next->ep_thread == spdk_get_thread()) {
+			blob_ep_flush_write(flush);
+		} else {
+			spdk_thread_send_msg(next->ep_thread, blob_ep_flush_write_msg, flush);
+		}
+	}
+
+	while (!TAILQ_EMPTY(&done)) {
+		ctx = TAILQ_FIRST(&done);
+		TAILQ_REMOVE(&done, ctx, link);
+		if (ctx->ep_thread == spdk_get_thread()) {
+			ctx->ep_cb_fn(ctx, bserrno);
+		} else {
+			ctx->rc = bserrno;
+			spdk_thread_send_msg(ctx->ep_thread, blob_ep_flush_done_msg, ctx);
+		}
+	}
+
+	while (!TAILQ_EMPTY(&waiters)) {
+		freeze_ctx = TAILQ_FIRST(&waiters);
+		TAILQ_REMOVE(&waiters, freeze_ctx, link);
+		spdk_thread_send_msg(blob->bs->md_thread, blob_io_done, freeze_ctx);
+	}
+}
+
+static void
+blob_ep_flush_write(struct spdk_blob_ep_flush *flush)
+{
+	struct spdk_blob *blob = flush->blob;
+
+	memset(flush->page, 0, blob->bs->md_page_size);
+
+	spdk_spin_lock(&blob->md_lock);
+	blob_fill_extent_page(blob, flush->cluster_num, flush->page);
+	spdk_spin_unlock(&blob->md_lock);
+
+	blob_write_extent_page_on_channel(blob, flush->channel, flush->extent, flush->page,
+					  blob_ep_flush_cpl, flush);
+}
+
+/*
+ * Queue ctx for a write of the extent page. Returns the flush to write if ctx starts a new
+ * write, or NULL if ctx waits for the next write of a page that is already being written.
+ * Called with md_lock held.
+ */
+static struct spdk_blob_ep_flush *
+blob_ep_flush_queue(struct spdk_blob_cluster_op_ctx *ctx, uint32_t extent, int *rc)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_ep_flush *flush;
+
+	assert(spdk_spin_held(&blob->md_lock));
+
+	*rc = 0;
+	TAILQ_FOREACH(flush, &blob->ep_flushes, link) {
+		if (flush->extent == extent) {
+			TAILQ_INSERT_TAIL(&flush->queued, ctx, link);
+			return NULL;
+		}
+	}
+
+	flush = TAILQ_FIRST(&blob->free_ep_flushes);
+	if (flush != NULL) {
+		TAILQ_REMOVE(&blob->free_ep_flushes, flush, link);
+	} else {
+		flush = calloc(1, sizeof(*flush));
+		if (flush == NULL) {
+			*rc = -ENOMEM;
+			return NULL;
+		}
+
+		flush->page = spdk_zmalloc(blob->bs->md_page_size, 0, NULL, SPDK_ENV_NUMA_ID_ANY,
+					   SPDK_MALLOC_DMA);
+		if (flush->page == NULL) {
+			free(flush);
+			*rc = -ENOMEM;
+			return NULL;
+		}
+	}
+
+	flush->blob = blob;
+	flush->extent = extent;
+	flush->cluster_num = ctx->cluster_num;
+	flush->channel = ctx->channel;
+	TAILQ_INIT(&flush->writing);
+	TAILQ_INIT(&flush->queued);
+	TAILQ_INSERT_TAIL(&flush->writing, ctx, link);
+	TAILQ_INSERT_TAIL(&blob->ep_flushes, flush, link);
+
+	return flush;
+}
+
+/*
+ * Persist the extent page of ctx->cluster_num after a cluster was inserted or freed. The page
+ * is serialized from the in-memory cluster map when the write is issued, so a single write
+ * persists all the updates that are made to the page before it. If a write of the page is
+ * already in progress, the update waits for the next write instead of issuing a concurrent
+ * write to the same page, which also keeps the writes of a page in order.
+ */
+static void
+blob_flush_extent_page(struct spdk_blob_cluster_op_ctx *ctx, uint32_t extent,
+		       spdk_blob_op_complete cb_fn)
+{
+	struct spdk_blob_ep_flush *flush;
+	int rc;
+
+	ctx->ep_cb_fn = cb_fn;
+	ctx->ep_thread = spdk_get_thread();
+	if (ctx->ep_thread == ctx->blob->bs->md_thread) {
+		ctx->channel = ctx->blob->bs->md_channel;
+	}
+
+	spdk_spin_lock(&ctx->blob->md_lock);
+	flush = blob_ep_flush_queue(ctx, extent, &rc);
+	spdk_spin_unlock(&ctx->blob->md_lock);
+
+	if (rc != 0) {
+		cb_fn(ctx, rc);
+	} else if (flush != NULL) {
+		blob_ep_flush_write(flush);
+	}
+}
+
+static void
+blob_insert_cluster_mapped_msg(void *arg)
+{
+	struct spdk_blob_cluster_op_ctx *ctx = arg;
+
+	ctx->mapped_fn(ctx->cb_arg, 0);
+}
+
+static void
+blob_insert_sub_cluster_mask_cb(void *arg, int bserrno)
+{
+	struct spdk_blob_cluster_op_ctx *ctx = arg;
+
+	if (bserrno != 0) {
+		blob_op_cluster_msg_cb(ctx, bserrno);
+		return;
+	}
+
+	blob_flush_extent_page(ctx, *bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num),
+			       blob_op_cluster_msg_cb);
 }
 
 static void
@@ -8900,12 +11660,21 @@ blob_insert_cluster_msg(void *arg)
 	struct spdk_blob_cluster_op_ctx *ctx = arg;
 	uint32_t *extent_page;
 
-	ctx->rc = blob_insert_cluster(ctx->blob, ctx->cluster_num, ctx->cluster);
+	spdk_spin_lock(&ctx->blob->md_lock);
+	ctx->rc = blob_insert_cluster(ctx->blob, ctx->cluster_num, ctx->cluster,
+				      ctx->sub_cluster_mask);
+	spdk_spin_unlock(&ctx->blob->md_lock);
 	if (ctx->rc != 0) {
 		spdk_thread_send_msg(ctx->thread, blob_op_cluster_msg_cpl, ctx);
 		return;
 	}
 
+	if (ctx->mapped_fn != NULL) {
+		/* Messages to a thread are executed in order, so this one runs before the
+		 * completion of the metadata update below. */
+		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_mapped_msg, ctx);
+	}
+
 	if (ctx->blob->use_extent_table == false) {
 		/* Extent table is not used, proceed with sync of md that will only use extents_rle. */
 		ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
@@ -8919,8 +11688,7 @@ blob_insert_cluster_msg(void *arg)
 		 * It was already claimed in the used_md_pages map and placed in ctx. */
 		assert(ctx->extent_page != 0);
 		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-		blob_write_extent_page(ctx->blob, ctx->extent_page, ctx->cluster_num, ctx->page,
-				       blob_insert_new_ep_cb, ctx);
+		blob_flush_extent_page(ctx, ctx->extent_page, blob_insert_new_ep_cb);
 	} else {
 		/* It is possible for original thread to allocate extent page for
 		 * different cluster in the same extent page. In such case proceed with
@@ -8932,17 +11700,75 @@ blob_insert_cluster_msg(void *arg)
 			spdk_spin_unlock(&ctx->blob->bs->used_lock);
 			ctx->extent_page = 0;
 		}
+		if (ctx->sub_cluster_mask != 0) {
+			/* The sub-clusters left in the backing device are kept in the blob md.
+			 * Persist them before the extent page starts to point at the cluster. */
+			ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
+			blob_sync_md(ctx->blob, blob_insert_sub_cluster_mask_cb, ctx);
+			return;
+		}
 		/* Extent page already allocated.
 		 * Every cluster allocation, requires just an update of single extent page. */
-		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num, ctx->page,
-				       blob_op_cluster_msg_cb, ctx);
+		blob_flush_extent_page(ctx, *extent_page, blob_op_cluster_msg_cb);
+	}
+}
+
+/*
+ * Insert the cluster and persist it on the calling thread, if that only requires a write of
+ * an extent page that is already allocated. Everything else that changes the blob md, and
+ * any update made while the blob is frozen, is left to the md thread.
+ */
+static bool
+blob_insert_cluster_in_place(struct spdk_blob_cluster_op_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_ep_flush *flush;
+	uint32_t extent_page;
+	int rc;
+
+	if (!blob->use_extent_table || ctx->extent_page != 0 || ctx->sub_cluster_mask != 0 ||
+	    blob->bs->clean != 0 || ctx->thread == blob->bs->md_thread) {
+		return false;
 	}
+
+	ctx->ep_cb_fn = blob_op_cluster_msg_cb;
+	ctx->ep_thread = ctx->thread;
+
+	spdk_spin_lock(&blob->md_lock);
+	extent_page = *bs_cluster_to_extent_page(blob, ctx->cluster_num);
+	if (blob->frozen_refcnt != 0 || extent_page == 0) {
+		spdk_spin_unlock(&blob->md_lock);
+		return false;
+	}
+
+	ctx->rc = blob_insert_cluster(blob, ctx->cluster_num, ctx->cluster, 0);
+	if (ctx->rc != 0) {
+		spdk_spin_unlock(&blob->md_lock);
+		spdk_thread_send_msg(ctx->thread, blob_op_cluster_msg_cpl, ctx);
+		return true;
+	}
+	/* Queue the write before releasing the lock, so that a freeze waits for it */
+	flush = blob_ep_flush_queue(ctx, extent_page, &rc);
+	spdk_spin_unlock(&blob->md_lock);
+
+	if (ctx->mapped_fn != NULL) {
+		spdk_thread_send_msg(ctx->thread, blob_insert_cluster_mapped_msg, ctx);
+	}
+
+	if (rc != 0) {
+		blob_op_cluster_msg_cb(ctx, rc);
+	} else if (flush != NULL) {
+		blob_ep_flush_write(flush);
+	}
+
+	return true;
 }
 
 static void
-blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
-				 uint64_t cluster, uint32_t extent_page, struct spdk_blob_md_page *page,
-				 spdk_blob_op_complete cb_fn, void *cb_arg)
+blob_insert_cluster_persist(struct spdk_blob *blob, struct spdk_io_channel *channel,
+			    uint32_t cluster_num, uint64_t cluster, uint64_t sub_cluster_mask,
+			    uint32_t extent_page, spdk_blob_op_complete mapped_fn,
+			    spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_blob_cluster_op_ctx *ctx;
 
@@ -8956,10 +11782,16 @@ blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
 	ctx->blob = blob;
 	ctx->cluster_num = cluster_num;
 	ctx->cluster = cluster;
+	ctx->sub_cluster_mask = sub_cluster_mask;
 	ctx->extent_page = extent_page;
-	ctx->page = page;
+	ctx->mapped_fn = mapped_fn;
 	ctx->cb_fn = cb_fn;
 	ctx->cb_arg = cb_arg;
+	ctx->channel = channel;
+
+	if (blob_insert_cluster_in_place(ctx)) {
+		return;
+	}
 
 	spdk_thread_send_msg(blob->bs->md_thread, blob_insert_cluster_msg, ctx);
 }
@@ -8973,26 +11805,29 @@ blob_free_cluster_msg(void *arg)
 	bool free_extent_page = true;
 	size_t i;
 
-	ctx->cluster = bs_lba_to_cluster(ctx->blob->bs, ctx->blob->active.clusters[ctx->cluster_num]);
+	spdk_spin_lock(&ctx->blob->md_lock);
+	ctx->cluster = bs_lba_to_cluster(ctx->blob->bs,
+					 *bs_blob_cluster_lba(ctx->blob, ctx->cluster_num));
 
 	/* There were concurrent unmaps to the same cluster, only release the cluster on the first one */
 	if (ctx->cluster == 0) {
+		spdk_spin_unlock(&ctx->blob->md_lock);
 		blob_op_cluster_msg_cb(ctx, 0);
 		return;
 	}
+	assert(bs_cluster_invalid_sub_clusters(ctx->blob, ctx->cluster_num) == 0);
 
-	ctx->blob->active.clusters[ctx->cluster_num] = 0;
+	blob_set_cluster_lba(ctx->blob, ctx->cluster_num, 0);
 	if (ctx->cluster != 0) {
 		ctx->blob->active.num_allocated_clusters--;
 	}
 
 	if (ctx->blob->use_extent_table == false) {
-		/* Extent table is not used, proceed with sync of md that will only use extents_rle. */
-		spdk_spin_lock(&ctx->blob->bs->used_lock);
-		bs_release_cluster(ctx->blob->bs, ctx->cluster);
-		spdk_spin_unlock(&ctx->blob->bs->used_lock);
+		spdk_spin_unlock(&ctx->blob->md_lock);
+		/* Extent table is not used, proceed with sync of md that will only use extents_rle.
+		 * The cluster is released once the sync completes. */
 		ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-		blob_sync_md(ctx->blob, blob_op_cluster_msg_cb, ctx);
+		blob_sync_md(ctx->blob, blob_free_cluster_msg_cb, ctx);
 		return;
 	}
 
@@ -9003,7 +11838,8 @@ blob_free_cluster_msg(void *arg)
 
 	start_cluster_idx = (ctx->cluster_num / SPDK_EXTENTS_PER_EP) * SPDK_EXTENTS_PER_EP;
 	for (i = 0; i < SPDK_EXTENTS_PER_EP; ++i) {
-		if (ctx->blob->active.clusters[start_cluster_idx + i] != 0) {
+		if (start_cluster_idx + i < ctx->blob->active.num_clusters &&
+		    *bs_blob_cluster_lba(ctx->blob, start_cluster_idx + i) != 0) {
 			free_extent_page = false;
 			break;
 		}
@@ -9011,20 +11847,22 @@ blob_free_cluster_msg(void *arg)
 
 	if (free_extent_page) {
 		assert(ctx->extent_page != 0);
-		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
 		ctx->blob->active.extent_pages[bs_cluster_to_extent_table_id(ctx->cluster_num)] = 0;
-		blob_write_extent_page(ctx->blob, ctx->extent_page, ctx->cluster_num, ctx->page,
-				       blob_free_cluster_free_ep_cb, ctx);
+	}
+	spdk_spin_unlock(&ctx->blob->md_lock);
+
+	if (free_extent_page) {
+		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
+		blob_flush_extent_page(ctx, ctx->extent_page, blob_free_cluster_free_ep_cb);
 	} else {
-		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num, ctx->page,
-				       blob_free_cluster_update_ep_cb, ctx);
+		blob_flush_extent_page(ctx, *extent_page, blob_free_cluster_update_ep_cb);
 	}
 }
 
 
 static void
 blob_free_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num, uint32_t extent_page,
-			       struct spdk_blob_md_page *page, spdk_blob_op_complete cb_fn, void *cb_arg)
+			       spdk_blob_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_blob_cluster_op_ctx *ctx;
 
@@ -9038,7 +11876,6 @@ blob_free_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num, uin
 	ctx->blob = blob;
 	ctx->cluster_num = cluster_num;
 	ctx->extent_page = extent_page;
-	ctx->page = page;
 	ctx->cb_fn = cb_fn;
 	ctx->cb_arg = cb_arg;
 
@@ -8,7 +8,9 @@
 #define SPDK_BLOBSTORE_H
 
 #include "spdk/assert.h"
+#include "spdk/bit_array.h"
 #include "spdk/blob.h"
+#include "spdk/likely.h"
 #include "spdk/queue.h"
 #include "spdk/util.h"
 #include "spdk/tree.h"
@@ -27,6 +29,9 @@
 #define SPDK_BLOB_OPTS_DEFAULT_CHANNEL_OPS 512
 #define SPDK_BLOB_BLOBID_HIGH_BIT (1ULL << 32)
 
+/* Maximum number of free clusters an I/O channel reserves at once for thin provisioning. */
+#define SPDK_BS_CHANNEL_CLUSTER_BATCH 16
+
 struct spdk_xattr {
 	uint32_t	index;
 	uint16_t	value_len;
@@ -151,6 +156,43 @@ struct spdk_blob {
 	/* Number of data clusters retrieved from extent table,
 	 * that many have to be read from extent pages. */
 	uint64_t	remaining_clusters_in_et;
+
+	/* Number of io units copied from the backing device at a time on the
+	 * first write to a cluster, 0 if whole clusters are copied. */
+	uint64_t	io_units_per_sub_cluster;
+	/* Per cluster mask of the sub-clusters that are still read from the
+	 * backing device. Zero for unallocated and fully copied clusters. */
+	uint64_t	*sub_cluster_masks;
+	uint64_t	num_sub_cluster_masks;
+
+	/* Copies of sub-clusters in progress, and the ones waiting for them
+	 * to complete. Only accessed on md_thread. */
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) sub_cluster_fills;
+	TAILQ_HEAD(, spdk_blob_copy_cluster_ctx) sub_cluster_fill_waiters;
+
+	/* Clusters inserted into already allocated extent pages are persisted on the thread
+	 * that allocated them. md_lock protects the cluster map and extent page array against
+	 * such updates, and the lists below. */
+	struct spdk_spinlock			md_lock;
+
+	/* Extent page writes in progress and unused ones. Concurrent updates of the same
+	 * extent page are coalesced into a single write. */
+	TAILQ_HEAD(, spdk_blob_ep_flush)	ep_flushes;
+	TAILQ_HEAD(, spdk_blob_ep_flush)	free_ep_flushes;
+
+	/* Freezes of the blob waiting for the extent page writes in progress */
+	TAILQ_HEAD(, freeze_io_ctx)		ep_flush_waiters;
+
+	/* Set while the extent pages of the blob are loaded on demand. The cluster map is then
+	 * kept in ep_segments instead of active.clusters, until a metadata operation needs all of
+	 * it. Cleared with md_lock and bs->ep_cache_lock held. */
+	bool					ep_on_demand;
+	/* Extent pages in memory, indexed by extent table id. Protected by bs->ep_cache_lock */
+	struct spdk_blob_ep_segment		**ep_segments;
+	uint64_t				num_ep_segments;
+	/* The allocated clusters of a blob whose extent pages are loaded on demand, so that
+	 * looking them up does not need the extent pages. Updated with md_lock held. */
+	struct spdk_bit_array			*allocated_clusters;
 };
 
 struct spdk_blob_store {
@@ -176,6 +218,10 @@ struct spdk_blob_store {
 	uint64_t			total_clusters;
 	uint64_t			total_data_clusters;
 	uint64_t			num_free_clusters;	/* Protected by used_lock */
+	/* Clusters claimed from used_clusters but still cached by I/O channels. Updated atomically */
+	uint64_t			num_reserved_clusters;
+	/* Incremented whenever a channel reserves clusters. Protected by used_lock */
+	uint64_t			cluster_reserve_gen;
 	uint64_t			pages_per_cluster;
 	uint64_t			io_units_per_cluster;
 	uint8_t				pages_per_cluster_shift;
@@ -191,6 +237,23 @@ struct spdk_blob_store {
 	RB_HEAD(spdk_blob_tree, spdk_blob) open_blobs;
 	TAILQ_HEAD(, spdk_blob_list)	snapshots;
 
+	/* Statistics of spdk_bs_blob_dedup(), only updated on md_thread */
+	uint64_t			dedup_clusters_scanned;
+	uint64_t			dedup_clusters_released;
+	uint64_t			dedup_freeze_count;
+	uint64_t			dedup_freeze_ticks;
+	uint64_t			dedup_freeze_max_ticks;
+
+	/* Extent pages of the blobs that load them on demand. ep_lru holds the ones in memory
+	 * that are not pinned, least recently used first. Protected by ep_cache_lock */
+	struct spdk_spinlock		ep_cache_lock;
+	TAILQ_HEAD(, spdk_blob_ep_segment) ep_lru;
+	uint32_t			ep_cache_size;
+	uint32_t			ep_cache_num_pages;
+	uint64_t			ep_cache_hits;
+	uint64_t			ep_cache_misses;
+	uint64_t			ep_cache_evictions;
+
 	bool				clean;
 
 	spdk_bs_esnap_dev_create	esnap_bs_dev_create;
@@ -214,13 +277,24 @@ struct spdk_bs_channel {
 	struct spdk_bs_dev		*dev;
 	struct spdk_io_channel		*dev_channel;
 
-	/* This page is only used during insert of a new cluster. */
-	struct spdk_blob_md_page	*new_cluster_page;
-
 	TAILQ_HEAD(, spdk_bs_request_set) need_cluster_alloc;
 	TAILQ_HEAD(, spdk_bs_request_set) queued_io;
 
 	RB_HEAD(blob_esnap_channel_tree, blob_esnap_channel) esnap_channels;
+
+	/* Clusters reserved by this channel for first writes to thin provisioned blobs,
+	 * so that cluster allocation takes used_lock once per batch instead of once per
+	 * cluster. Entries from cluster_cache_idx up to num_cached_clusters are unused.
+	 */
+	uint32_t			cluster_cache[SPDK_BS_CHANNEL_CLUSTER_BATCH];
+	uint32_t			cluster_cache_idx;
+	uint32_t			num_cached_clusters;
+
+	/* Value of cluster_reserve_gen when clusters were last reclaimed from all channels. */
+	uint64_t			cluster_reclaim_gen;
+
+	/* Set while an op which waited for its extent page to be read is issued again. */
+	bool				ep_op_resumed;
 };
 
 /** operation type */
@@ -288,6 +362,12 @@ struct spdk_bs_md_mask {
  * with 0's being unallocated clusters. It is NOT part of
  * serialized metadata chain for a blob. */
 #define SPDK_MD_DESCRIPTOR_TYPE_EXTENT_PAGE 6
+/* SUB_CLUSTERS descriptor holds the sub-cluster size of a blob and,
+ * for each of its partially copied clusters, the mask of sub-clusters
+ * that were not copied from the backing device yet. Clusters without
+ * an entry are fully copied. It is part of serialized metadata chain
+ * for a blob. */
+#define SPDK_MD_DESCRIPTOR_TYPE_SUB_CLUSTERS 7
 
 struct spdk_blob_md_descriptor_xattr {
 	uint8_t		type;
@@ -333,12 +413,36 @@ struct spdk_blob_md_descriptor_extent_page {
 	uint32_t	cluster_idx[0];
 };
 
+struct spdk_blob_md_descriptor_sub_clusters {
+	uint8_t		type;
+	uint32_t	length;
+
+	/* Size of a sub-cluster, in bytes */
+	uint32_t	sub_cluster_sz;
+
+	struct {
+		uint32_t	cluster_idx;
+		uint64_t	invalid_mask; /* Bit N is set if sub-cluster N is not copied */
+	} clusters[0];
+};
+
+/* Length of the SUB_CLUSTERS descriptor fields preceding its entries */
+#define SPDK_MD_SUB_CLUSTERS_HDR_LENGTH \
+	(offsetof(struct spdk_blob_md_descriptor_sub_clusters, clusters) - \
+	 offsetof(struct spdk_blob_md_descriptor_sub_clusters, sub_cluster_sz))
+SPDK_STATIC_ASSERT(offsetof(struct spdk_blob_md_descriptor_sub_clusters, clusters) == 9,
+		   "Incorrect SUB_CLUSTERS descriptor layout");
+SPDK_STATIC_ASSERT(sizeof(((struct spdk_blob_md_descriptor_sub_clusters *)0)->clusters[0]) == 12,
+		   "Incorrect SUB_CLUSTERS descriptor entry size");
+
 #define SPDK_BLOB_THIN_PROV		(1ULL << 0)
 #define SPDK_BLOB_INTERNAL_XATTR	(1ULL << 1)
 #define SPDK_BLOB_EXTENT_TABLE		(1ULL << 2)
 #define SPDK_BLOB_EXTERNAL_SNAPSHOT	(1ULL << 3)
+#define SPDK_BLOB_SUB_CLUSTERS		(1ULL << 4)
 #define SPDK_BLOB_INVALID_FLAGS_MASK	(SPDK_BLOB_THIN_PROV | SPDK_BLOB_INTERNAL_XATTR | \
-					 SPDK_BLOB_EXTENT_TABLE | SPDK_BLOB_EXTERNAL_SNAPSHOT)
+					 SPDK_BLOB_EXTENT_TABLE | SPDK_BLOB_EXTERNAL_SNAPSHOT | \
+					 SPDK_BLOB_SUB_CLUSTERS)
 
 #define SPDK_BLOB_READ_ONLY (1ULL << 0)
 #define SPDK_BLOB_DATA_RO_FLAGS_MASK	SPDK_BLOB_READ_ONLY
@@ -436,6 +540,31 @@ SPDK_STATIC_ASSERT(sizeof(struct spdk_bs_super_block) == 0x1000, "Invalid super
 
 #pragma pack(pop)
 
+/* The clusters of one extent page of a blob whose extent pages are loaded on demand */
+struct spdk_blob_ep_segment {
+	struct spdk_blob			*blob;
+	/* Extent table id of the extent page */
+	uint64_t				index;
+	/* Requests that look clusters up in the segment. It is not evicted while pinned,
+	 * and the clusters of an unpinned segment match the extent page on disk. */
+	uint32_t				pin_cnt;
+	/* Set once the extent page is read */
+	bool					loaded;
+	/* Set once the cluster map of the blob is in memory as a whole. The segment is
+	 * freed when the last request that pinned it completes. */
+	bool					detached;
+	/* Extent page being read */
+	struct spdk_blob_md_page		*page;
+	/* Requests waiting for the extent page to be read */
+	TAILQ_HEAD(, spdk_blob_ep_waiter)	waiters;
+	TAILQ_ENTRY(spdk_blob_ep_segment)	lru_link;
+	/* LBAs of the SPDK_EXTENTS_PER_EP clusters, 0 for the unallocated ones */
+	uint64_t				clusters[];
+};
+
+void bs_ep_segment_unpin(struct spdk_blob_ep_segment *segment);
+bool bs_blob_io_unit_to_lba_resident(struct spdk_blob *blob, uint64_t io_unit, uint64_t *lba);
+
 struct spdk_bs_dev *bs_create_zeroes_dev(void);
 struct spdk_bs_dev *bs_create_blob_bs_dev(struct spdk_blob *blob);
 struct spdk_io_channel *blob_esnap_get_io_channel(struct spdk_io_channel *ch,
@@ -574,6 +703,38 @@ bs_page_to_blobid(uint64_t page_idx)
 	return SPDK_BLOB_BLOBID_HIGH_BIT | page_idx;
 }
 
+/* Given a cluster index into a blob, look up where the LBA of the cluster is kept.
+ * If the extent pages of the blob are loaded on demand, the caller must hold a pin
+ * on the extent page of the cluster.
+ */
+static inline uint64_t *
+bs_blob_cluster_lba(const struct spdk_blob *blob, uint64_t cluster_num)
+{
+	struct spdk_blob_ep_segment *segment;
+
+	if (spdk_likely(!blob->ep_on_demand)) {
+		assert(cluster_num < blob->active.cluster_array_size);
+		return &blob->active.clusters[cluster_num];
+	}
+
+	assert(cluster_num < blob->active.num_clusters);
+	segment = blob->ep_segments[bs_cluster_to_extent_table_id(cluster_num)];
+	assert(segment != NULL && segment->loaded);
+
+	return &segment->clusters[cluster_num % SPDK_EXTENTS_PER_EP];
+}
+
+/* Given a cluster index into a blob, look up if it is allocated. */
+static inline bool
+bs_cluster_is_allocated(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	if (spdk_unlikely(blob->ep_on_demand)) {
+		return spdk_bit_array_get(blob->allocated_clusters, cluster_num);
+	}
+
+	return blob->active.clusters[cluster_num] != 0;
+}
+
 /* Given an io unit offset into a blob, look up the LBA for the
  * start of that io unit.
  */
@@ -587,9 +748,9 @@ bs_blob_io_unit_to_lba(struct spdk_blob *blob, uint64_t io_unit)
 	shift = blob->bs->io_units_per_cluster_shift;
 	assert(io_unit < blob->active.num_clusters * io_units_per_cluster);
 	if (shift != 0) {
-		lba = blob->active.clusters[io_unit >> shift];
+		lba = *bs_blob_cluster_lba(blob, io_unit >> shift);
 	} else {
-		lba = blob->active.clusters[io_unit / io_units_per_cluster];
+		lba = *bs_blob_cluster_lba(blob, io_unit / io_units_per_cluster);
 	}
 	if (lba == 0) {
 		return 0;
@@ -598,8 +759,40 @@ bs_blob_io_unit_to_lba(struct spdk_blob *blob, uint64_t io_unit)
 	}
 }
 
+/* Given a cluster index into a blob, look up the mask of its sub-clusters that
+ * are still read from the backing device.
+ */
+static inline uint64_t
+bs_cluster_invalid_sub_clusters(struct spdk_blob *blob, uint64_t cluster_num)
+{
+	if (cluster_num >= blob->num_sub_cluster_masks) {
+		return 0;
+	}
+
+	return blob->sub_cluster_masks[cluster_num];
+}
+
+/* Given an io_unit range within a cluster of a blob, look up the mask of the
+ * sub-clusters of that cluster which the range touches.
+ */
+static inline uint64_t
+bs_io_units_to_sub_cluster_mask(struct spdk_blob *blob, uint64_t io_unit, uint64_t length)
+{
+	uint64_t	offset = io_unit % blob->bs->io_units_per_cluster;
+	uint64_t	first, last;
+
+	assert(blob->io_units_per_sub_cluster != 0);
+	assert(length > 0 && offset + length <= blob->bs->io_units_per_cluster);
+
+	first = offset / blob->io_units_per_sub_cluster;
+	last = (offset + length - 1) / blob->io_units_per_sub_cluster;
+
+	return (UINT64_MAX >> (63 - last)) & (UINT64_MAX << first);
+}
+
 /* Given an io_unit offset into a blob, look up the number of io_units until the
- * next cluster boundary.
+ * next cluster boundary. Partially copied clusters are split at sub-cluster
+ * boundaries instead, so that an I/O never spans both copied and not copied data.
  */
 static inline uint32_t
 bs_num_io_units_to_cluster_boundary(struct spdk_blob *blob, uint64_t io_unit)
@@ -608,6 +801,10 @@ bs_num_io_units_to_cluster_boundary(struct spdk_blob *blob, uint64_t io_unit)
 
 	io_units_per_cluster = bs_io_units_per_cluster(blob);
 
+	if (bs_cluster_invalid_sub_clusters(blob, io_unit / io_units_per_cluster) != 0) {
+		return blob->io_units_per_sub_cluster - (io_unit % blob->io_units_per_sub_cluster);
+	}
+
 	return io_units_per_cluster - (io_unit % io_units_per_cluster);
 }
 
@@ -634,18 +831,26 @@ bs_io_unit_to_cluster_number(struct spdk_blob *blob, uint64_t io_unit)
 	}
 }
 
-/* Given an io unit offset into a blob, look up if it is from allocated cluster. */
+/* Given an io unit offset into a blob, look up if it is from allocated cluster,
+ * and from a sub-cluster that was copied from the backing device.
+ */
 static inline bool
 bs_io_unit_is_allocated(struct spdk_blob *blob, uint64_t io_unit)
 {
-	uint64_t lba = bs_blob_io_unit_to_lba(blob, io_unit);
+	uint32_t cluster_num = bs_io_unit_to_cluster_number(blob, io_unit);
+	uint64_t invalid_mask;
 
-	if (lba == 0) {
+	if (!bs_cluster_is_allocated(blob, cluster_num)) {
 		assert(spdk_blob_is_thin_provisioned(blob));
 		return false;
-	} else {
-		return true;
 	}
+
+	invalid_mask = bs_cluster_invalid_sub_clusters(blob, cluster_num);
+	if (invalid_mask != 0) {
+		return (invalid_mask & bs_io_units_to_sub_cluster_mask(blob, io_unit, 1)) == 0;
+	}
+
+	return true;
 }
 
 #endif
@@ -63,6 +63,11 @@ bs_request_set_complete(struct spdk_bs_request_set *set)
 	spdk_trace_record(TRACE_BLOB_REQ_SET_COMPLETE, 0, 0, (uintptr_t)&set->cb_args,
 			  (uintptr_t)set->cpl.u.blob_basic.cb_arg);
 
+	set->blob = NULL;
+	if (set->ep_segment != NULL) {
+		bs_ep_segment_unpin(set->ep_segment);
+		set->ep_segment = NULL;
+	}
 	TAILQ_INSERT_TAIL(&set->channel->reqs, set, link);
 
 	bs_call_cpl(&cpl, bserrno);
@@ -79,7 +84,7 @@ bs_sequence_completion(struct spdk_io_channel *channel, void *cb_arg, int bserrn
 
 static inline spdk_bs_sequence_t *
 bs_sequence_start(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl,
-		  struct spdk_io_channel *back_channel)
+		  struct spdk_io_channel *back_channel, struct spdk_blob *blob)
 {
 	struct spdk_bs_channel		*channel;
 	struct spdk_bs_request_set	*set;
@@ -99,6 +104,8 @@ bs_sequence_start(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl,
 	set->bserrno = 0;
 	set->channel = channel;
 	set->back_channel = back_channel;
+	set->blob = blob;
+	set->ep_segment = NULL;
 
 	set->cb_args.cb_fn = bs_sequence_completion;
 	set->cb_args.cb_arg = set;
@@ -112,7 +119,7 @@ bs_sequence_start(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl,
 spdk_bs_sequence_t *
 bs_sequence_start_bs(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl)
 {
-	return bs_sequence_start(_channel, cpl, _channel);
+	return bs_sequence_start(_channel, cpl, _channel, NULL);
 }
 
 /* Use when performing IO on a blob. */
@@ -137,7 +144,7 @@ bs_sequence_start_blob(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl
 			return NULL;
 		}
 	}
-	return bs_sequence_start(_channel, cpl, esnap_ch);
+	return bs_sequence_start(_channel, cpl, esnap_ch, blob);
 }
 
 void
@@ -361,6 +368,8 @@ bs_batch_open(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl, struct
 	set->bserrno = 0;
 	set->channel = channel;
 	set->back_channel = back_channel;
+	set->blob = blob;
+	set->ep_segment = NULL;
 
 	set->u.batch.cb_fn = NULL;
 	set->u.batch.cb_arg = NULL;
@@ -500,6 +509,8 @@ bs_user_op_alloc(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl,
 	set->cpl = *cpl;
 	set->channel = channel;
 	set->back_channel = NULL;
+	set->blob = NULL;
+	set->ep_segment = NULL;
 	set->ext_io_opts = NULL;
 
 	args = &set->u.user_op;
@@ -95,6 +95,16 @@ struct spdk_bs_request_set {
 	 * is an esnap clone, back_channel == spdk_io_channel_get_ctx(set->channel).
 	 */
 	struct spdk_io_channel		*back_channel;
+	/*
+	 * The blob this request performs IO on, NULL for IO on the blobstore itself and
+	 * for user ops. Cleared when the request is completed.
+	 */
+	struct spdk_blob		*blob;
+	/*
+	 * The extent page of the blob this request looks clusters up in, when the extent pages
+	 * of the blob are loaded on demand. It is pinned in memory until the request completes.
+	 */
+	struct spdk_blob_ep_segment	*ep_segment;
 
 	struct spdk_bs_dev_cb_args	cb_args;
 
@@ -1180,6 +1180,14 @@ int
 spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 		 bool thin_provision, enum lvol_clear_method clear_method, spdk_lvol_op_with_handle_complete cb_fn,
 		 void *cb_arg)
+{
+	return spdk_lvol_create_ext(lvs, name, sz, thin_provision, clear_method, 0, cb_fn, cb_arg);
+}
+
+int
+spdk_lvol_create_ext(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
+		     bool thin_provision, enum lvol_clear_method clear_method, uint32_t sub_cluster_sz,
+		     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol_with_handle_req *req;
 	struct spdk_blob_store *bs;
@@ -1220,6 +1228,7 @@ spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 	opts.thin_provision = thin_provision;
 	opts.num_clusters = spdk_divide_round_up(sz, spdk_bs_get_cluster_size(bs));
 	opts.clear_method = lvol->clear_method;
+	opts.sub_cluster_sz = sub_cluster_sz;
 	opts.xattrs.count = SPDK_COUNTOF(xattr_names);
 	opts.xattrs.names = xattr_names;
 	opts.xattrs.ctx = lvol;
@@ -1359,6 +1368,13 @@ spdk_lvol_create_snapshot(struct spdk_lvol *origlvol, const char *snapshot_name,
 void
 spdk_lvol_create_clone(struct spdk_lvol *origlvol, const char *clone_name,
 		       spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	spdk_lvol_create_clone_ext(origlvol, clone_name, 0, cb_fn, cb_arg);
+}
+
+void
+spdk_lvol_create_clone_ext(struct spdk_lvol *origlvol, const char *clone_name,
+			   uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol *newlvol;
 	struct spdk_lvol_with_handle_req *req;
@@ -1411,9 +1427,8 @@ spdk_lvol_create_clone(struct spdk_lvol *origlvol, const char *clone_name,
 	req->cb_fn = cb_fn;
 	req->cb_arg = cb_arg;
 
-	spdk_bs_create_clone(lvs->blobstore, spdk_blob_get_id(origblob), &clone_xattrs,
-			     lvol_create_cb,
-			     req);
+	spdk_bs_create_clone_ext(lvs->blobstore, spdk_blob_get_id(origblob), &clone_xattrs,
+				 sub_cluster_sz, lvol_create_cb, req);
 }
 
 static void
@@ -1736,6 +1751,56 @@ spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, v
 				     lvol_inflate_cb, req);
 }
 
+static void
+lvol_dedup_cb(void *cb_arg, int lvolerrno)
+{
+	struct spdk_lvol_req *req = cb_arg;
+
+	spdk_bs_free_io_channel(req->channel);
+
+	if (lvolerrno < 0) {
+		SPDK_ERRLOG("Could not deduplicate lvol\n");
+	}
+
+	req->cb_fn(req->cb_arg, lvolerrno);
+	free(req);
+}
+
+void
+spdk_lvol_dedup(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_lvol_req *req;
+	spdk_blob_id blob_id;
+
+	assert(cb_fn != NULL);
+
+	if (lvol == NULL) {
+		SPDK_ERRLOG("Lvol does not exist\n");
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	req = calloc(1, sizeof(*req));
+	if (!req) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol request pointer\n");
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->channel = spdk_bs_alloc_io_channel(lvol->lvol_store->blobstore);
+	if (req->channel == NULL) {
+		SPDK_ERRLOG("Cannot alloc io channel for lvol dedup request\n");
+		free(req);
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	blob_id = spdk_blob_get_id(lvol->blob);
+	spdk_bs_blob_dedup(lvol->lvol_store->blobstore, req->channel, blob_id, lvol_dedup_cb, req);
+}
+
 static void
 lvs_grow_live_cb(void *cb_arg, int lvolerrno)
 {
@@ -541,6 +541,8 @@ struct spdk_nvme_poll_group {
 	bool						enable_interrupts_is_valid;
 	int						disconnect_qpair_fd;
 	struct spdk_fd_group				*fgrp;
+	/* Completions shared by all qpairs per process_completions call, 0 if unlimited */
+	uint32_t					completion_budget;
 };
 
 struct spdk_nvme_transport_poll_group {
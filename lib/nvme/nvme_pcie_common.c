@@ -1792,6 +1792,110 @@ nvme_pcie_poll_group_remove(struct spdk_nvme_transport_poll_group *tgroup,
 	return 0;
 }
 
+/*
+ * Check whether polling the qpair would do nothing besides finding its completion queue empty.
+ * Anything that spdk_nvme_qpair_process_completions() has to take care of even when there
+ * are no completions (state transitions, failures, timeouts, delayed doorbells, queued aborts
+ * or injected errors) makes the qpair non-idle.
+ */
+static inline bool
+nvme_pcie_qpair_is_idle(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+
+	if (pqpair->cpl[pqpair->cq_head].status.p == pqpair->flags.phase) {
+		return false;
+	}
+
+	if (spdk_unlikely(nvme_qpair_get_state(qpair) != NVME_QPAIR_ENABLED ||
+			  pqpair->pcie_state == NVME_PCIE_QPAIR_FAILED ||
+			  qpair->transport_failure_reason != SPDK_NVME_QPAIR_FAILURE_NONE ||
+			  qpair->ctrlr->is_failed || qpair->ctrlr->timeout_enabled ||
+			  pqpair->flags.has_pending_vtophys_failures ||
+			  (pqpair->flags.delay_cmd_submit && pqpair->last_sq_tail != pqpair->sq_tail) ||
+			  !STAILQ_EMPTY(&qpair->err_req_head) ||
+			  !STAILQ_EMPTY(&qpair->aborting_queued_req))) {
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Move the qpairs polled during the last call to the tail of the list, so that the next call
+ * starts with the qpair at which the budget ran out.
+ */
+static void
+nvme_pcie_poll_group_rotate(struct spdk_nvme_transport_poll_group *tgroup,
+			    struct spdk_nvme_qpair *next)
+{
+	struct spdk_nvme_qpair *qpair;
+	uint32_t i;
+
+	for (i = 0; i < tgroup->num_connected_qpairs; i++) {
+		qpair = STAILQ_FIRST(&tgroup->connected_qpairs);
+		if (qpair == NULL || qpair == next) {
+			break;
+		}
+
+		STAILQ_REMOVE_HEAD(&tgroup->connected_qpairs, poll_group_stailq);
+		STAILQ_INSERT_TAIL(&tgroup->connected_qpairs, qpair, poll_group_stailq);
+	}
+}
+
+static int64_t
+nvme_pcie_poll_group_process_completions_budget(struct spdk_nvme_transport_poll_group *tgroup,
+		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
+{
+	struct spdk_nvme_qpair *qpair, *tmp_qpair, *next_qpair = NULL;
+	struct nvme_pcie_qpair *pqpair;
+	uint32_t budget = tgroup->group->completion_budget;
+	uint32_t max_completions;
+	int32_t local_completions;
+	int64_t total_completions = 0;
+
+	STAILQ_FOREACH_SAFE(qpair, &tgroup->connected_qpairs, poll_group_stailq, tmp_qpair) {
+		if (budget == 0) {
+			next_qpair = qpair;
+			break;
+		}
+
+		if (tmp_qpair != NULL) {
+			pqpair = nvme_pcie_qpair(tmp_qpair);
+			__builtin_prefetch(&pqpair->cpl[pqpair->cq_head]);
+		}
+
+		if (nvme_pcie_qpair_is_idle(qpair)) {
+			pqpair = nvme_pcie_qpair(qpair);
+			pqpair->stat->polls++;
+			pqpair->stat->idle_polls++;
+			continue;
+		}
+
+		max_completions = budget;
+		if (completions_per_qpair != 0) {
+			max_completions = spdk_min(completions_per_qpair, budget);
+		}
+
+		local_completions = spdk_nvme_qpair_process_completions(qpair, max_completions);
+		if (spdk_unlikely(local_completions < 0)) {
+			disconnected_qpair_cb(qpair, tgroup->group->ctx);
+			total_completions = -ENXIO;
+		} else {
+			budget -= spdk_min((uint32_t)local_completions, budget);
+			if (spdk_likely(total_completions >= 0)) {
+				total_completions += local_completions;
+			}
+		}
+	}
+
+	if (next_qpair != NULL) {
+		nvme_pcie_poll_group_rotate(tgroup, next_qpair);
+	}
+
+	return total_completions;
+}
+
 int64_t
 nvme_pcie_poll_group_process_completions(struct spdk_nvme_transport_poll_group *tgroup,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
@@ -1804,6 +1908,11 @@ nvme_pcie_poll_group_process_completions(struct spdk_nvme_transport_poll_group *
 		disconnected_qpair_cb(qpair, tgroup->group->ctx);
 	}
 
+	if (tgroup->group->completion_budget != 0) {
+		return nvme_pcie_poll_group_process_completions_budget(tgroup, completions_per_qpair,
+				disconnected_qpair_cb);
+	}
+
 	STAILQ_FOREACH_SAFE(qpair, &tgroup->connected_qpairs, poll_group_stailq, tmp_qpair) {
 		local_completions = spdk_nvme_qpair_process_completions(qpair, completions_per_qpair);
 		if (spdk_unlikely(local_completions < 0)) {
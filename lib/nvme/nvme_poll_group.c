@@ -398,6 +398,12 @@ spdk_nvme_poll_group_get_ctx(struct spdk_nvme_poll_group *group)
 	return group->ctx;
 }
 
+void
+spdk_nvme_poll_group_set_completion_budget(struct spdk_nvme_poll_group *group, uint32_t budget)
+{
+	group->completion_budget = budget;
+}
+
 int
 spdk_nvme_poll_group_destroy(struct spdk_nvme_poll_group *group)
 {
@@ -4566,6 +4566,12 @@ nvmf_ctrlr_process_io_cmd(struct spdk_nvmf_request *req)
 	desc = ns->desc;
 	ch = ns_info->channel;
 
+	if (group->in_poll && !ns_info->plugged) {
+		spdk_bdev_channel_plug(ch);
+		ns_info->plugged = true;
+		TAILQ_INSERT_TAIL(&group->plugged_ns, ns_info, plug_link);
+	}
+
 	if (spdk_unlikely(cmd->fuse & SPDK_NVME_CMD_FUSE_MASK)) {
 		return nvmf_ctrlr_process_io_fused_cmd(req, bdev, desc, ch);
 	} else if (spdk_unlikely(qpair->first_fused_req != NULL)) {
@@ -4700,6 +4706,7 @@ _nvmf_request_complete(void *ctx)
 		is_aer = req->cmd->nvme_cmd.opc == SPDK_NVME_OPC_ASYNC_EVENT_REQUEST;
 		if (spdk_likely(qpair->qid != 0)) {
 			qpair->group->stat.completed_nvme_io++;
+			qpair->period_nvme_io++;
 		}
 
 		/*
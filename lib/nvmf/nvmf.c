@@ -8,6 +8,7 @@
 
 #include "spdk/bdev.h"
 #include "spdk/bit_array.h"
+#include "spdk/env.h"
 #include "spdk/thread.h"
 #include "spdk/nvmf.h"
 #include "spdk/endian.h"
@@ -22,6 +23,14 @@ SPDK_LOG_REGISTER_COMPONENT(nvmf)
 
 #define SPDK_NVMF_DEFAULT_MAX_SUBSYSTEMS 1024
 
+#define SPDK_NVMF_DEFAULT_BALANCE_PERIOD_MS 1000
+#define SPDK_NVMF_DEFAULT_IMBALANCE_THRESHOLD 20
+#define SPDK_NVMF_DEFAULT_IMBALANCE_PERIODS 3
+
+/* Busy percentages of poll groups are compared in steps of this size, smaller differences
+ * are noise and placement falls back to outstanding I/O and qpair counts. */
+#define NVMF_POLL_GROUP_BUSY_PCT_STEP 5
+
 static TAILQ_HEAD(, spdk_nvmf_tgt) g_nvmf_tgts = TAILQ_HEAD_INITIALIZER(g_nvmf_tgts);
 
 typedef void (*nvmf_qpair_disconnect_cpl)(void *ctx, int status);
@@ -145,23 +154,136 @@ nvmf_qpair_set_state(struct spdk_nvmf_qpair *qpair,
 	qpair->state = state;
 }
 
+static void
+nvmf_poll_group_unplug_ns(struct spdk_nvmf_poll_group *group)
+{
+	struct spdk_nvmf_subsystem_pg_ns_info *ns_info;
+
+	while ((ns_info = TAILQ_FIRST(&group->plugged_ns)) != NULL) {
+		TAILQ_REMOVE(&group->plugged_ns, ns_info, plug_link);
+		ns_info->plugged = false;
+		spdk_bdev_channel_unplug(ns_info->channel);
+	}
+}
+
+struct nvmf_new_qpair_ctx {
+	struct spdk_nvmf_qpair *qpair;
+	struct spdk_nvmf_poll_group *group;
+};
+
+static void
+_nvmf_poll_group_migrate_in(void *_ctx)
+{
+	struct nvmf_new_qpair_ctx *ctx = _ctx;
+	struct spdk_nvmf_qpair *qpair = ctx->qpair;
+	struct spdk_nvmf_poll_group *group = ctx->group;
+	struct spdk_nvmf_ctrlr *ctrlr = qpair->ctrlr;
+	struct spdk_nvmf_transport_poll_group *tgroup;
+	int rc = -ENODEV;
+
+	free(ctx);
+
+	assert(qpair->group == group);
+	tgroup = nvmf_get_transport_poll_group(group, qpair->transport);
+	if (tgroup != NULL) {
+		rc = nvmf_transport_poll_group_migrate_in(tgroup, qpair);
+	}
+
+	SPDK_DEBUGLOG(nvmf, "qpair %p qid %u migrated to poll group %p: %d\n", qpair, qpair->qid,
+		      group, rc);
+	TAILQ_INSERT_TAIL(&group->qpairs, qpair, link);
+	group->stat.current_io_qpairs++;
+	group->stat.migrated_in_qpairs++;
+
+	/* The controller may have started disconnecting its qpairs while this one wasn't
+	 * on the list of any poll group. */
+	if (rc != 0 || ctrlr->in_destruct || ctrlr->disconnect_in_progress) {
+		spdk_nvmf_qpair_disconnect(qpair);
+	}
+}
+
+static void
+nvmf_poll_group_try_migrate(struct spdk_nvmf_poll_group *group)
+{
+	struct spdk_nvmf_qpair *qpair = group->migrate_qpair;
+	struct spdk_nvmf_transport_poll_group *tgroup;
+	struct nvmf_new_qpair_ctx *ctx;
+	int rc;
+
+	if (qpair->state != SPDK_NVMF_QPAIR_ENABLED) {
+		group->migrate_qpair = NULL;
+		return;
+	}
+
+	if (!TAILQ_EMPTY(&qpair->outstanding)) {
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return;
+	}
+
+	tgroup = nvmf_get_transport_poll_group(group, qpair->transport);
+	assert(tgroup != NULL);
+	rc = nvmf_transport_poll_group_migrate_out(tgroup, qpair);
+	if (rc == -EBUSY) {
+		free(ctx);
+		return;
+	}
+
+	group->migrate_qpair = NULL;
+	if (rc != 0) {
+		SPDK_DEBUGLOG(nvmf, "Unable to migrate qpair %p: %d\n", qpair, rc);
+		free(ctx);
+		return;
+	}
+
+	TAILQ_REMOVE(&group->qpairs, qpair, link);
+	assert(group->stat.current_io_qpairs > 0);
+	group->stat.current_io_qpairs--;
+	group->stat.migrated_out_qpairs++;
+
+	/* Disconnects requested from other threads from now on are sent to the new poll group,
+	 * and arrive after the qpair. */
+	qpair->group = group->migrate_dst;
+	ctx->qpair = qpair;
+	ctx->group = group->migrate_dst;
+	spdk_thread_send_msg(ctx->group->thread, _nvmf_poll_group_migrate_in, ctx);
+}
+
 static int
 nvmf_poll_group_poll(void *ctx)
 {
 	struct spdk_nvmf_poll_group *group = ctx;
-	int rc;
+	int rc = 0;
 	int count = 0;
 	struct spdk_nvmf_transport_poll_group *tgroup;
+	uint64_t tsc = spdk_get_ticks();
 
+	/* I/O submitted to the namespaces while polling is handed to the bdev modules
+	 * in batches once all transports have been polled. */
+	group->in_poll = true;
 	TAILQ_FOREACH(tgroup, &group->tgroups, link) {
 		rc = nvmf_transport_poll_group_poll(tgroup);
 		if (rc < 0) {
-			return SPDK_POLLER_BUSY;
+			break;
 		}
 		count += rc;
 	}
+	group->in_poll = false;
+	nvmf_poll_group_unplug_ns(group);
 
-	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+	if (spdk_unlikely(group->migrate_qpair != NULL)) {
+		nvmf_poll_group_try_migrate(group);
+	}
+
+	if (rc < 0 || count > 0) {
+		group->stat.busy_tsc += spdk_get_ticks() - tsc;
+		return SPDK_POLLER_BUSY;
+	}
+
+	return SPDK_POLLER_IDLE;
 }
 
 /*
@@ -263,7 +385,9 @@ nvmf_tgt_create_poll_group(void *io_device, void *ctx_buf)
 	group->tgt = tgt;
 	TAILQ_INIT(&group->tgroups);
 	TAILQ_INIT(&group->qpairs);
+	TAILQ_INIT(&group->plugged_ns);
 	group->thread = thread;
+	group->load.last_tsc = spdk_get_ticks();
 	pthread_mutex_init(&group->mutex, NULL);
 
 	group->poller = SPDK_POLLER_REGISTER(nvmf_poll_group_poll, group, 0);
@@ -394,6 +518,7 @@ spdk_nvmf_tgt_create(struct spdk_nvmf_target_opts *_opts)
 	tgt->discovery_genctr = 0;
 	tgt->dhchap_digests = opts.dhchap_digests;
 	tgt->dhchap_dhgroups = opts.dhchap_dhgroups;
+	spdk_nvmf_poll_group_policy_opts_init(&tgt->pg_policy, sizeof(tgt->pg_policy));
 	TAILQ_INIT(&tgt->transports);
 	TAILQ_INIT(&tgt->poll_groups);
 	TAILQ_INIT(&tgt->referrals);
@@ -497,6 +622,7 @@ spdk_nvmf_tgt_destroy(struct spdk_nvmf_tgt *tgt,
 
 	TAILQ_REMOVE(&g_nvmf_tgts, tgt, link);
 
+	spdk_poller_unregister(&tgt->balance_poller);
 	spdk_io_device_unregister(tgt, nvmf_tgt_destroy_cb);
 }
 
@@ -506,6 +632,251 @@ spdk_nvmf_tgt_get_name(struct spdk_nvmf_tgt *tgt)
 	return tgt->name;
 }
 
+int
+nvmf_poll_group_cmp_load(struct spdk_nvmf_poll_group *pg1, struct spdk_nvmf_poll_group *pg2)
+{
+	uint32_t val1, val2;
+
+	val1 = pg1->load.busy_pct / NVMF_POLL_GROUP_BUSY_PCT_STEP;
+	val2 = pg2->load.busy_pct / NVMF_POLL_GROUP_BUSY_PCT_STEP;
+	if (val1 == val2) {
+		val1 = pg1->load.outstanding;
+		val2 = pg2->load.outstanding;
+	}
+
+	if (val1 == val2) {
+		/* The load is only sampled periodically, but qpairs are counted as soon as they
+		 * are placed, which spreads the qpairs connecting within a period. */
+		pthread_mutex_lock(&pg1->mutex);
+		val1 = pg1->stat.current_io_qpairs + pg1->current_unassociated_qpairs;
+		pthread_mutex_unlock(&pg1->mutex);
+		pthread_mutex_lock(&pg2->mutex);
+		val2 = pg2->stat.current_io_qpairs + pg2->current_unassociated_qpairs;
+		pthread_mutex_unlock(&pg2->mutex);
+	}
+
+	return val1 == val2 ? 0 : (val1 < val2 ? -1 : 1);
+}
+
+struct nvmf_migrate_select_ctx {
+	struct spdk_nvmf_poll_group *group;
+	struct spdk_nvmf_poll_group *dst;
+	uint64_t max_nvme_io;
+};
+
+static void
+_nvmf_poll_group_select_migration(void *_ctx)
+{
+	struct nvmf_migrate_select_ctx *ctx = _ctx;
+	struct spdk_nvmf_poll_group *group = ctx->group;
+	struct spdk_nvmf_qpair *qpair, *selected = NULL;
+
+	TAILQ_FOREACH(qpair, &group->qpairs, link) {
+		if (qpair->qid == 0 || qpair->ctrlr == NULL || qpair->state != SPDK_NVMF_QPAIR_ENABLED ||
+		    qpair->transport->ops->poll_group_migrate_out == NULL) {
+			continue;
+		}
+
+		/* Moving a qpair that carries more than half of the difference in I/O would just
+		 * make the destination the busiest poll group. */
+		if (qpair->last_period_nvme_io == 0 || qpair->last_period_nvme_io > ctx->max_nvme_io) {
+			continue;
+		}
+
+		if (selected == NULL || qpair->last_period_nvme_io > selected->last_period_nvme_io) {
+			selected = qpair;
+		}
+	}
+
+	if (selected != NULL) {
+		SPDK_DEBUGLOG(nvmf, "Migrating qpair %p qid %u from poll group %p to %p\n",
+			      selected, selected->qid, group, ctx->dst);
+		group->migrate_qpair = selected;
+		group->migrate_dst = ctx->dst;
+	}
+
+	free(ctx);
+}
+
+static void
+nvmf_poll_group_sample_load(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_nvmf_poll_group *group = spdk_io_channel_get_ctx(ch);
+	struct spdk_nvmf_qpair *qpair;
+	uint64_t now = spdk_get_ticks();
+	uint64_t period, nvme_io = 0;
+	uint32_t outstanding = 0;
+
+	period = now - group->load.last_tsc;
+	if (period > 0) {
+		group->load.busy_pct = (group->stat.busy_tsc - group->load.last_busy_tsc) * 100 / period;
+	}
+	group->load.last_tsc = now;
+	group->load.last_busy_tsc = group->stat.busy_tsc;
+
+	TAILQ_FOREACH(qpair, &group->qpairs, link) {
+		outstanding += qpair->queue_depth;
+		nvme_io += qpair->period_nvme_io;
+		qpair->last_period_nvme_io = qpair->period_nvme_io;
+		qpair->period_nvme_io = 0;
+	}
+	group->load.outstanding = outstanding;
+	group->load.nvme_io = nvme_io;
+
+	/* A qpair that didn't become idle within a period is left where it is */
+	group->migrate_qpair = NULL;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+nvmf_tgt_sample_load_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_nvmf_tgt *tgt = spdk_io_channel_iter_get_io_device(i);
+	struct spdk_nvmf_poll_group *group, *busiest = NULL, *idlest = NULL;
+	struct nvmf_migrate_select_ctx *ctx;
+
+	tgt->balance_in_progress = false;
+	/* The policy changed or the target is being destroyed */
+	if (tgt->balance_poller == NULL || tgt->pg_policy.imbalance_periods == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&tgt->mutex);
+	TAILQ_FOREACH(group, &tgt->poll_groups, link) {
+		if (busiest == NULL || nvmf_poll_group_cmp_load(group, busiest) > 0) {
+			busiest = group;
+		}
+		if (idlest == NULL || nvmf_poll_group_cmp_load(group, idlest) < 0) {
+			idlest = group;
+		}
+	}
+	pthread_mutex_unlock(&tgt->mutex);
+
+	if (busiest == idlest ||
+	    busiest->load.busy_pct < idlest->load.busy_pct + tgt->pg_policy.imbalance_threshold) {
+		tgt->imbalanced_periods = 0;
+		return;
+	}
+
+	if (++tgt->imbalanced_periods < tgt->pg_policy.imbalance_periods) {
+		return;
+	}
+	tgt->imbalanced_periods = 0;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return;
+	}
+
+	ctx->group = busiest;
+	ctx->dst = idlest;
+	if (busiest->load.nvme_io > idlest->load.nvme_io) {
+		ctx->max_nvme_io = (busiest->load.nvme_io - idlest->load.nvme_io) / 2;
+	}
+	spdk_thread_send_msg(busiest->thread, _nvmf_poll_group_select_migration, ctx);
+}
+
+static int
+nvmf_tgt_balance_poller(void *arg)
+{
+	struct spdk_nvmf_tgt *tgt = arg;
+
+	if (tgt->balance_in_progress) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	tgt->balance_in_progress = true;
+	spdk_for_each_channel(tgt, nvmf_poll_group_sample_load, NULL, nvmf_tgt_sample_load_done);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+nvmf_poll_group_policy_opts_copy(struct spdk_nvmf_poll_group_policy_opts *opts,
+				 const struct spdk_nvmf_poll_group_policy_opts *opts_src, size_t opts_size)
+{
+	assert(opts);
+	assert(opts_src);
+
+	opts->opts_size = opts_size;
+
+#define SET_FIELD(field) \
+    if (offsetof(struct spdk_nvmf_poll_group_policy_opts, field) + sizeof(opts->field) <= opts_size) { \
+                 opts->field = opts_src->field; \
+    } \
+
+	SET_FIELD(policy);
+	SET_FIELD(balance_period_ms);
+	SET_FIELD(imbalance_threshold);
+	SET_FIELD(imbalance_periods);
+#undef SET_FIELD
+
+	/* Do not remove this statement, you should always update this statement when you adding a new field,
+	 * and do not forget to add the SET_FIELD statement for your added field. */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_poll_group_policy_opts) == 24, "Incorrect size");
+}
+
+void
+spdk_nvmf_poll_group_policy_opts_init(struct spdk_nvmf_poll_group_policy_opts *opts,
+				      size_t opts_size)
+{
+	struct spdk_nvmf_poll_group_policy_opts opts_local = {};
+
+	opts_local.policy = SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT;
+	opts_local.balance_period_ms = SPDK_NVMF_DEFAULT_BALANCE_PERIOD_MS;
+	opts_local.imbalance_threshold = SPDK_NVMF_DEFAULT_IMBALANCE_THRESHOLD;
+	opts_local.imbalance_periods = SPDK_NVMF_DEFAULT_IMBALANCE_PERIODS;
+	nvmf_poll_group_policy_opts_copy(opts, &opts_local, opts_size);
+}
+
+int
+spdk_nvmf_tgt_set_poll_group_policy(struct spdk_nvmf_tgt *tgt,
+				    const struct spdk_nvmf_poll_group_policy_opts *opts)
+{
+	struct spdk_nvmf_poll_group_policy_opts opts_local;
+
+	if (!opts || !opts->opts_size) {
+		SPDK_ERRLOG("opts should not be NULL and opts_size should not be zero\n");
+		return -EINVAL;
+	}
+
+	spdk_nvmf_poll_group_policy_opts_init(&opts_local, sizeof(opts_local));
+	nvmf_poll_group_policy_opts_copy(&opts_local, opts, opts->opts_size);
+	opts_local.opts_size = sizeof(opts_local);
+
+	if (opts_local.policy != SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT &&
+	    opts_local.policy != SPDK_NVMF_POLL_GROUP_POLICY_LOAD) {
+		SPDK_ERRLOG("Invalid poll group policy %d\n", opts_local.policy);
+		return -EINVAL;
+	}
+
+	if (opts_local.policy == SPDK_NVMF_POLL_GROUP_POLICY_LOAD &&
+	    (opts_local.balance_period_ms == 0 || opts_local.imbalance_threshold > 100)) {
+		SPDK_ERRLOG("balance_period_ms must be positive and imbalance_threshold at most 100\n");
+		return -EINVAL;
+	}
+
+	spdk_poller_unregister(&tgt->balance_poller);
+	tgt->imbalanced_periods = 0;
+	tgt->pg_policy = opts_local;
+
+	if (opts_local.policy == SPDK_NVMF_POLL_GROUP_POLICY_LOAD) {
+		tgt->balance_poller = SPDK_POLLER_REGISTER(nvmf_tgt_balance_poller, tgt,
+				      opts_local.balance_period_ms * 1000ULL);
+	}
+
+	return 0;
+}
+
+void
+spdk_nvmf_tgt_get_poll_group_policy(struct spdk_nvmf_tgt *tgt,
+				    struct spdk_nvmf_poll_group_policy_opts *opts, size_t opts_size)
+{
+	nvmf_poll_group_policy_opts_copy(opts, &tgt->pg_policy, opts_size);
+}
+
 struct spdk_nvmf_tgt *
 spdk_nvmf_get_tgt(const char *name)
 {
@@ -659,6 +1030,12 @@ nvmf_write_nvme_subsystem_config(struct spdk_json_write_ctx *w,
 
 		spdk_json_write_named_bool(w, "no_auto_visible", !ns->always_visible);
 
+		if (ns_opts.qos_weight != 0) {
+			spdk_json_write_named_uint32(w, "qos_weight", ns_opts.qos_weight);
+			spdk_json_write_named_uint64(w, "qos_min_ios_per_sec", ns_opts.qos_min_ios_per_sec);
+			spdk_json_write_named_uint64(w, "qos_max_ios_per_sec", ns_opts.qos_max_ios_per_sec);
+		}
+
 		/*     "namespace" */
 		spdk_json_write_object_end(w);
 
@@ -752,6 +1129,18 @@ spdk_nvmf_tgt_write_config_json(struct spdk_json_write_ctx *w, struct spdk_nvmf_
 	spdk_json_write_object_end(w);
 	spdk_json_write_object_end(w);
 
+	if (nvmf_tgt_placement_is_load_aware(tgt)) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "nvmf_set_poll_group_policy");
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "policy", "load");
+		spdk_json_write_named_uint32(w, "balance_period_ms", tgt->pg_policy.balance_period_ms);
+		spdk_json_write_named_uint32(w, "imbalance_threshold", tgt->pg_policy.imbalance_threshold);
+		spdk_json_write_named_uint32(w, "imbalance_periods", tgt->pg_policy.imbalance_periods);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
 	/* write transports */
 	TAILQ_FOREACH(transport, &tgt->transports, link) {
 		spdk_json_write_object_begin(w);
@@ -1130,11 +1519,6 @@ spdk_nvmf_tgt_get_transport(struct spdk_nvmf_tgt *tgt, const char *transport_nam
 	return NULL;
 }
 
-struct nvmf_new_qpair_ctx {
-	struct spdk_nvmf_qpair *qpair;
-	struct spdk_nvmf_poll_group *group;
-};
-
 static void
 _nvmf_poll_group_add(void *_ctx)
 {
@@ -1318,6 +1702,9 @@ spdk_nvmf_poll_group_remove(struct spdk_nvmf_qpair *qpair)
 		}
 	}
 
+	if (qpair->group->migrate_qpair == qpair) {
+		qpair->group->migrate_qpair = NULL;
+	}
 	TAILQ_REMOVE(&qpair->group->qpairs, qpair, link);
 	qpair->group = NULL;
 }
@@ -1911,6 +2298,9 @@ spdk_nvmf_poll_group_dump_stat(struct spdk_nvmf_poll_group *group, struct spdk_j
 	spdk_json_write_named_uint32(w, "current_io_qpairs", group->stat.current_io_qpairs);
 	spdk_json_write_named_uint64(w, "pending_bdev_io", group->stat.pending_bdev_io);
 	spdk_json_write_named_uint64(w, "completed_nvme_io", group->stat.completed_nvme_io);
+	spdk_json_write_named_uint64(w, "busy_tsc", group->stat.busy_tsc);
+	spdk_json_write_named_uint32(w, "migrated_in_qpairs", group->stat.migrated_in_qpairs);
+	spdk_json_write_named_uint32(w, "migrated_out_qpairs", group->stat.migrated_out_qpairs);
 
 	spdk_json_write_named_array_begin(w, "transports");
 
@@ -72,6 +72,12 @@ struct spdk_nvmf_tgt {
 	/* Used for round-robin assignment of connections to poll groups */
 	struct spdk_nvmf_poll_group		*next_poll_group;
 
+	/* Placement of qpairs on poll groups, the balancer samples the load of the poll groups */
+	struct spdk_nvmf_poll_group_policy_opts	pg_policy;
+	struct spdk_poller			*balance_poller;
+	uint32_t				imbalanced_periods;
+	bool					balance_in_progress;
+
 	spdk_nvmf_tgt_destroy_done_fn		*destroy_cb_fn;
 	void					*destroy_cb_arg;
 
@@ -130,6 +136,10 @@ struct spdk_nvmf_subsystem_pg_ns_info {
 	/* I/O outstanding to this namespace */
 	uint64_t			io_outstanding;
 	enum spdk_nvmf_subsystem_state	state;
+
+	/* The bdev channel is plugged for the duration of the current poll group poll */
+	bool				plugged;
+	TAILQ_ENTRY(spdk_nvmf_subsystem_pg_ns_info) plug_link;
 };
 
 typedef void(*spdk_nvmf_poll_group_mod_done)(void *cb_arg, int status);
@@ -376,6 +386,18 @@ void nvmf_poll_group_pause_subsystem(struct spdk_nvmf_poll_group *group,
 void nvmf_poll_group_resume_subsystem(struct spdk_nvmf_poll_group *group,
 				      struct spdk_nvmf_subsystem *subsystem, spdk_nvmf_poll_group_mod_done cb_fn, void *cb_arg);
 
+/*
+ * Compare the load of two poll groups, for placement by SPDK_NVMF_POLL_GROUP_POLICY_LOAD.
+ * Returns a negative value if pg1 is less loaded than pg2, a positive one if it's more loaded.
+ */
+int nvmf_poll_group_cmp_load(struct spdk_nvmf_poll_group *pg1, struct spdk_nvmf_poll_group *pg2);
+
+static inline bool
+nvmf_tgt_placement_is_load_aware(const struct spdk_nvmf_tgt *tgt)
+{
+	return tgt->pg_policy.policy == SPDK_NVMF_POLL_GROUP_POLICY_LOAD;
+}
+
 void nvmf_get_discovery_log_page(struct spdk_nvmf_tgt *tgt, const char *hostnqn, struct iovec *iov,
 				 uint32_t iovcnt, uint64_t offset, uint32_t length,
 				 struct spdk_nvme_transport_id *cmd_source_trid);
@@ -1378,6 +1378,9 @@ struct nvmf_rpc_ns_params {
 	uint32_t anagrpid;
 	bool no_auto_visible;
 	bool hide_metadata;
+	uint32_t qos_weight;
+	uint64_t qos_min_ios_per_sec;
+	uint64_t qos_max_ios_per_sec;
 };
 
 static const struct spdk_json_object_decoder rpc_ns_params_decoders[] = {
@@ -1390,6 +1393,9 @@ static const struct spdk_json_object_decoder rpc_ns_params_decoders[] = {
 	{"anagrpid", offsetof(struct nvmf_rpc_ns_params, anagrpid), spdk_json_decode_uint32, true},
 	{"no_auto_visible", offsetof(struct nvmf_rpc_ns_params, no_auto_visible), spdk_json_decode_bool, true},
 	{"hide_metadata", offsetof(struct nvmf_rpc_ns_params, hide_metadata), spdk_json_decode_bool, true},
+	{"qos_weight", offsetof(struct nvmf_rpc_ns_params, qos_weight), spdk_json_decode_uint32, true},
+	{"qos_min_ios_per_sec", offsetof(struct nvmf_rpc_ns_params, qos_min_ios_per_sec), spdk_json_decode_uint64, true},
+	{"qos_max_ios_per_sec", offsetof(struct nvmf_rpc_ns_params, qos_max_ios_per_sec), spdk_json_decode_uint64, true},
 };
 
 static int
@@ -1512,6 +1518,9 @@ nvmf_rpc_ns_paused(struct spdk_nvmf_subsystem *subsystem,
 	ns_opts.anagrpid = ctx->ns_params.anagrpid;
 	ns_opts.no_auto_visible = ctx->ns_params.no_auto_visible;
 	ns_opts.hide_metadata = ctx->ns_params.hide_metadata;
+	ns_opts.qos_weight = ctx->ns_params.qos_weight;
+	ns_opts.qos_min_ios_per_sec = ctx->ns_params.qos_min_ios_per_sec;
+	ns_opts.qos_max_ios_per_sec = ctx->ns_params.qos_max_ios_per_sec;
 
 	ctx->ns_params.nsid = spdk_nvmf_subsystem_add_ns_ext(subsystem, ctx->ns_params.bdev_name,
 			      &ns_opts, sizeof(ns_opts),
@@ -2730,6 +2739,87 @@ rpc_nvmf_get_transports(struct spdk_jsonrpc_request *request,
 }
 SPDK_RPC_REGISTER("nvmf_get_transports", rpc_nvmf_get_transports, SPDK_RPC_RUNTIME)
 
+static const char *
+nvmf_poll_group_policy_str(enum spdk_nvmf_poll_group_policy policy)
+{
+	switch (policy) {
+	case SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT:
+		return "transport";
+	case SPDK_NVMF_POLL_GROUP_POLICY_LOAD:
+		return "load";
+	default:
+		return "unknown";
+	}
+}
+
+static int
+decode_poll_group_policy(const struct spdk_json_val *val, void *out)
+{
+	enum spdk_nvmf_poll_group_policy *policy = out;
+
+	if (spdk_json_strequal(val, "transport")) {
+		*policy = SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT;
+	} else if (spdk_json_strequal(val, "load")) {
+		*policy = SPDK_NVMF_POLL_GROUP_POLICY_LOAD;
+	} else {
+		SPDK_ERRLOG("Invalid poll group policy\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+struct rpc_set_poll_group_policy {
+	char *tgt_name;
+	struct spdk_nvmf_poll_group_policy_opts opts;
+};
+
+static const struct spdk_json_object_decoder rpc_set_poll_group_policy_decoders[] = {
+	{"tgt_name", offsetof(struct rpc_set_poll_group_policy, tgt_name), spdk_json_decode_string, true},
+	{"policy", offsetof(struct rpc_set_poll_group_policy, opts.policy), decode_poll_group_policy},
+	{"balance_period_ms", offsetof(struct rpc_set_poll_group_policy, opts.balance_period_ms), spdk_json_decode_uint32, true},
+	{"imbalance_threshold", offsetof(struct rpc_set_poll_group_policy, opts.imbalance_threshold), spdk_json_decode_uint32, true},
+	{"imbalance_periods", offsetof(struct rpc_set_poll_group_policy, opts.imbalance_periods), spdk_json_decode_uint32, true},
+};
+
+static void
+rpc_nvmf_set_poll_group_policy(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_set_poll_group_policy req = {};
+	struct spdk_nvmf_tgt *tgt;
+	int rc;
+
+	spdk_nvmf_poll_group_policy_opts_init(&req.opts, sizeof(req.opts));
+
+	if (spdk_json_decode_object(params, rpc_set_poll_group_policy_decoders,
+				    SPDK_COUNTOF(rpc_set_poll_group_policy_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS, "Invalid parameters");
+		goto out;
+	}
+
+	tgt = spdk_nvmf_get_tgt(req.tgt_name);
+	if (!tgt) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "Unable to find a target.");
+		goto out;
+	}
+
+	rc = spdk_nvmf_tgt_set_poll_group_policy(tgt, &req.opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 spdk_strerror(-rc));
+		goto out;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+out:
+	free(req.tgt_name);
+}
+SPDK_RPC_REGISTER("nvmf_set_poll_group_policy", rpc_nvmf_set_poll_group_policy, SPDK_RPC_RUNTIME)
+
 struct rpc_nvmf_get_stats_ctx {
 	char *tgt_name;
 	struct spdk_nvmf_tgt *tgt;
@@ -2781,6 +2871,7 @@ rpc_nvmf_get_stats(struct spdk_jsonrpc_request *request,
 		   const struct spdk_json_val *params)
 {
 	struct rpc_nvmf_get_stats_ctx *ctx;
+	struct spdk_nvmf_poll_group_policy_opts policy;
 
 	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
@@ -2809,9 +2900,13 @@ rpc_nvmf_get_stats(struct spdk_jsonrpc_request *request,
 		return;
 	}
 
+	spdk_nvmf_tgt_get_poll_group_policy(ctx->tgt, &policy, sizeof(policy));
+
 	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
 	spdk_json_write_object_begin(ctx->w);
 	spdk_json_write_named_uint64(ctx->w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_string(ctx->w, "poll_group_policy",
+				     nvmf_poll_group_policy_str(policy.policy));
 	spdk_json_write_named_array_begin(ctx->w, "poll_groups");
 
 	spdk_for_each_channel(ctx->tgt,
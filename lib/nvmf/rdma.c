@@ -4202,6 +4202,23 @@ nvmf_rdma_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 
 	if (qpair->qid == 0) {
 		pg = &rtransport->conn_sched.next_admin_pg;
+	} else if (nvmf_tgt_placement_is_load_aware(qpair->transport->tgt)) {
+		struct spdk_nvmf_rdma_poll_group *pg_min, *pg_current;
+
+		pg = &rtransport->conn_sched.next_io_pg;
+		pg_min = *pg;
+		pg_current = *pg;
+		do {
+			if (nvmf_poll_group_cmp_load(pg_current->group.group, pg_min->group.group) < 0) {
+				pg_min = pg_current;
+			}
+
+			pg_current = TAILQ_NEXT(pg_current, link);
+			if (pg_current == NULL) {
+				pg_current = TAILQ_FIRST(&rtransport->poll_groups);
+			}
+		} while (pg_current != *pg);
+		*pg = pg_min;
 	} else {
 		struct spdk_nvmf_rdma_poll_group *pg_min, *pg_start, *pg_current;
 		uint32_t min_value;
@@ -1997,6 +1997,9 @@ spdk_nvmf_ns_opts_get_defaults(struct spdk_nvmf_ns_opts *opts, size_t opts_size)
 	SET_FIELD(anagrpid, 0);
 	SET_FIELD(transport_specific, NULL);
 	SET_FIELD(hide_metadata, false);
+	SET_FIELD(qos_weight, 0);
+	SET_FIELD(qos_min_ios_per_sec, 0);
+	SET_FIELD(qos_max_ios_per_sec, 0);
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -2029,13 +2032,16 @@ nvmf_ns_opts_copy(struct spdk_nvmf_ns_opts *opts,
 	SET_FIELD(no_auto_visible);
 	SET_FIELD(transport_specific);
 	SET_FIELD(hide_metadata);
+	SET_FIELD(qos_weight);
+	SET_FIELD(qos_min_ios_per_sec);
+	SET_FIELD(qos_max_ios_per_sec);
 
 	opts->opts_size = user_opts->opts_size;
 
 	/* We should not remove this statement, but need to update the assert statement
 	 * if we add a new field, and also add a corresponding SET_FIELD statement.
 	 */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ns_opts) == 73, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_nvmf_ns_opts) == 93, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -2192,6 +2198,22 @@ spdk_nvmf_subsystem_add_ns_ext(struct spdk_nvmf_subsystem *subsystem, const char
 		goto err;
 	}
 
+	if (opts.qos_weight != 0) {
+		struct spdk_bdev_desc_qos_opts qos_opts = {
+			.size = sizeof(qos_opts),
+			.weight = opts.qos_weight,
+			.min_ios_per_sec = opts.qos_min_ios_per_sec,
+			.max_ios_per_sec = opts.qos_max_ios_per_sec,
+		};
+
+		rc = spdk_bdev_desc_set_qos(ns->desc, &qos_opts);
+		if (rc != 0) {
+			SPDK_ERRLOG("Subsystem %s: failed to set fair-share QoS of bdev %s, error=%d\n",
+				    subsystem->subnqn, bdev_name, rc);
+			goto err;
+		}
+	}
+
 	/* Cache the zcopy capability of the bdev device */
 	ns->zcopy = spdk_bdev_io_type_supported(ns->bdev, SPDK_BDEV_IO_TYPE_ZCOPY);
 
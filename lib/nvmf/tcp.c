@@ -47,6 +47,16 @@
 #define SPDK_NVMF_TCP_DEFAULT_BUFFER_CACHE_SIZE UINT32_MAX
 #define SPDK_NVMF_TCP_DEFAULT_DIF_INSERT_OR_STRIP false
 #define SPDK_NVMF_TCP_DEFAULT_ABORT_TIMEOUT_SEC 1
+#define SPDK_NVMF_TCP_DEFAULT_RECV_ZCOPY false
+/* Let recv_buf_count be derived from num_shared_buffers */
+#define SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT UINT32_MAX
+/* Upper limit of the derived number of receive buffers of a poll group */
+#define NVMF_TCP_MAX_RECV_BUF_COUNT 32
+/* Payloads smaller than this fraction of a receive buffer are copied out of it, so that they
+ * don't keep the whole buffer away from the stream until their request completes.
+ */
+#define NVMF_TCP_RECV_ZCOPY_MIN_FRACTION 4
+#define SPDK_NVMF_TCP_DEFAULT_SEND_BATCH_SIZE 0
 
 const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp;
 static bool g_tls_log = false;
@@ -257,6 +267,9 @@ struct spdk_nvmf_tcp_req  {
 	 */
 	uint32_t				h2c_offset;
 
+	/* Receive buffer the request data points to, instead of its own buffers */
+	struct nvmf_tcp_recv_buf		*recv_buf;
+
 	STAILQ_ENTRY(spdk_nvmf_tcp_req)		link;
 	TAILQ_ENTRY(spdk_nvmf_tcp_req)		state_link;
 	STAILQ_ENTRY(spdk_nvmf_tcp_req)		control_msg_link;
@@ -290,6 +303,13 @@ struct spdk_nvmf_tcp_qpair {
 	bool					host_hdgst_enable;
 	bool					host_ddgst_enable;
 
+	/* Receive the stream with spdk_sock_recv_next() into buffers provided by the poll group */
+	bool					recv_zcopy;
+	/* Part of the last buffer returned by spdk_sock_recv_next() that hasn't been consumed */
+	struct nvmf_tcp_recv_buf		*rx_buf;
+	uint8_t					*rx_data;
+	uint32_t				rx_len;
+
 	/* This is a spare PDU used for sending special management
 	 * operations. Primarily, this is used for the initial
 	 * connection response and c2h termination request. */
@@ -326,6 +346,14 @@ struct spdk_nvmf_tcp_qpair {
 
 	TAILQ_ENTRY(spdk_nvmf_tcp_qpair)	link;
 	bool					pending_flush;
+
+	/* PDUs are flushed by the poll group's send aggregator */
+	bool					send_batch;
+	/* The qpair is on the poll group's send_qpairs list */
+	bool					send_queued;
+	/* Bytes queued since the socket was last flushed by the send aggregator */
+	uint32_t				send_queued_bytes;
+	TAILQ_ENTRY(spdk_nvmf_tcp_qpair)	send_link;
 };
 
 struct spdk_nvmf_tcp_control_msg {
@@ -338,6 +366,15 @@ struct spdk_nvmf_tcp_control_msg_list {
 	STAILQ_HEAD(, spdk_nvmf_tcp_req) waiting_for_msg_reqs;
 };
 
+/* Buffer provided to the sock group of a poll group for spdk_sock_recv_next() */
+struct nvmf_tcp_recv_buf {
+	struct spdk_nvmf_tcp_poll_group		*tgroup;
+	void					*buf;
+	/* Number of qpairs and requests referencing data in this buffer */
+	uint32_t				refs;
+	STAILQ_ENTRY(nvmf_tcp_recv_buf)		link;
+};
+
 struct spdk_nvmf_tcp_poll_group {
 	struct spdk_nvmf_transport_poll_group	group;
 	struct spdk_sock_group			*sock_group;
@@ -348,6 +385,30 @@ struct spdk_nvmf_tcp_poll_group {
 	struct spdk_io_channel			*accel_channel;
 	struct spdk_nvmf_tcp_control_msg_list	*control_msg_list;
 
+	/* Qpairs with PDUs queued on their sockets, flushed at the end of the poll */
+	TAILQ_HEAD(, spdk_nvmf_tcp_qpair)	send_qpairs;
+	/* Bytes a socket may queue before it's flushed, 0 if send aggregation is disabled */
+	uint32_t				send_batch_size;
+
+	/* Receive buffers, only allocated if recv_zcopy is enabled */
+	struct nvmf_tcp_recv_buf		*recv_bufs;
+	uint32_t				num_recv_bufs;
+	/* Receive buffers that don't hold an iobuf buffer */
+	STAILQ_HEAD(, nvmf_tcp_recv_buf)	free_recv_bufs;
+
+	struct {
+		/* Number of requests whose data was received from the host */
+		uint64_t			recv_data_ios;
+		/* Request data copied out of receive buffers */
+		uint64_t			recv_copy_bytes;
+		/* Request data pointing to receive buffers without a copy */
+		uint64_t			recv_zcopy_bytes;
+		/* PDUs queued by the send aggregator */
+		uint64_t			send_pdus;
+		/* Socket flushes done by the send aggregator */
+		uint64_t			send_flushes;
+	} stat;
+
 	TAILQ_ENTRY(spdk_nvmf_tcp_poll_group)	link;
 };
 
@@ -362,6 +423,9 @@ struct tcp_transport_opts {
 	bool		c2h_success;
 	uint16_t	control_msg_num;
 	uint32_t	sock_priority;
+	bool		recv_zcopy;
+	uint32_t	recv_buf_count;
+	uint32_t	send_batch_size;
 };
 
 struct tcp_psk_entry {
@@ -404,6 +468,18 @@ static const struct spdk_json_object_decoder tcp_transport_opts_decoder[] = {
 		"sock_priority", offsetof(struct tcp_transport_opts, sock_priority),
 		spdk_json_decode_uint32, true
 	},
+	{
+		"recv_zcopy", offsetof(struct tcp_transport_opts, recv_zcopy),
+		spdk_json_decode_bool, true
+	},
+	{
+		"recv_buf_count", offsetof(struct tcp_transport_opts, recv_buf_count),
+		spdk_json_decode_uint32, true
+	},
+	{
+		"send_batch_size", offsetof(struct tcp_transport_opts, send_batch_size),
+		spdk_json_decode_uint32, true
+	},
 };
 
 static bool nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
@@ -475,6 +551,51 @@ nvmf_tcp_req_put(struct spdk_nvmf_tcp_qpair *tqpair, struct spdk_nvmf_tcp_req *t
 	nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_FREE);
 }
 
+static void
+nvmf_tcp_recv_buf_provide(struct nvmf_tcp_recv_buf *rbuf)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = rbuf->tgroup;
+	uint32_t len = tgroup->group.transport->opts.io_unit_size;
+
+	if (spdk_unlikely(spdk_sock_group_provide_buf(tgroup->sock_group, rbuf->buf, len, rbuf) != 0)) {
+		spdk_iobuf_put(tgroup->group.buf_cache, rbuf->buf, len);
+		rbuf->buf = NULL;
+		STAILQ_INSERT_HEAD(&tgroup->free_recv_bufs, rbuf, link);
+	}
+}
+
+static void
+nvmf_tcp_recv_buf_put(struct nvmf_tcp_recv_buf *rbuf)
+{
+	assert(rbuf->refs > 0);
+	if (--rbuf->refs > 0) {
+		return;
+	}
+
+	/* Nobody references the data anymore, so the buffer can receive more of the stream */
+	nvmf_tcp_recv_buf_provide(rbuf);
+}
+
+/* Provide buffers to the sock group for all trackers that don't have one, e.g. because the
+ * iobuf pool was empty the last time they were tried.
+ */
+static void
+nvmf_tcp_recv_bufs_fill(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	struct nvmf_tcp_recv_buf *rbuf;
+
+	while ((rbuf = STAILQ_FIRST(&tgroup->free_recv_bufs)) != NULL) {
+		rbuf->buf = spdk_iobuf_get(tgroup->group.buf_cache,
+					   tgroup->group.transport->opts.io_unit_size, NULL, NULL);
+		if (rbuf->buf == NULL) {
+			break;
+		}
+
+		STAILQ_REMOVE_HEAD(&tgroup->free_recv_bufs, link);
+		nvmf_tcp_recv_buf_provide(rbuf);
+	}
+}
+
 static void
 nvmf_tcp_req_get_buffers_done(struct spdk_nvmf_request *req)
 {
@@ -608,10 +729,16 @@ _nvmf_tcp_qpair_destroy(void *_tqpair)
 
 	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
 
+	assert(!tqpair->send_queued);
 	err = spdk_sock_close(&tqpair->sock);
 	assert(err == 0);
 	nvmf_tcp_cleanup_all_states(tqpair);
 
+	if (tqpair->rx_buf != NULL) {
+		nvmf_tcp_recv_buf_put(tqpair->rx_buf);
+		tqpair->rx_buf = NULL;
+	}
+
 	if (tqpair->state_cntr[TCP_REQUEST_STATE_FREE] != tqpair->resource_count) {
 		SPDK_ERRLOG("tqpair(%p) free tcp request num is %u but should be %u\n", tqpair,
 			    tqpair->state_cntr[TCP_REQUEST_STATE_FREE],
@@ -659,6 +786,9 @@ nvmf_tcp_dump_opts(struct spdk_nvmf_transport *transport, struct spdk_json_write
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
 	spdk_json_write_named_bool(w, "c2h_success", ttransport->tcp_opts.c2h_success);
 	spdk_json_write_named_uint32(w, "sock_priority", ttransport->tcp_opts.sock_priority);
+	spdk_json_write_named_bool(w, "recv_zcopy", ttransport->tcp_opts.recv_zcopy);
+	spdk_json_write_named_uint32(w, "recv_buf_count", ttransport->tcp_opts.recv_buf_count);
+	spdk_json_write_named_uint32(w, "send_batch_size", ttransport->tcp_opts.send_batch_size);
 }
 
 static void
@@ -726,6 +856,9 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 	ttransport->tcp_opts.c2h_success = SPDK_NVMF_TCP_DEFAULT_SUCCESS_OPTIMIZATION;
 	ttransport->tcp_opts.sock_priority = SPDK_NVMF_TCP_DEFAULT_SOCK_PRIORITY;
 	ttransport->tcp_opts.control_msg_num = SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM;
+	ttransport->tcp_opts.recv_zcopy = SPDK_NVMF_TCP_DEFAULT_RECV_ZCOPY;
+	ttransport->tcp_opts.recv_buf_count = SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT;
+	ttransport->tcp_opts.send_batch_size = SPDK_NVMF_TCP_DEFAULT_SEND_BATCH_SIZE;
 	if (opts->transport_specific != NULL &&
 	    spdk_json_decode_object_relaxed(opts->transport_specific, tcp_transport_opts_decoder,
 					    SPDK_COUNTOF(tcp_transport_opts_decoder),
@@ -744,7 +877,8 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     "  num_shared_buffers=%d, c2h_success=%d,\n"
 		     "  dif_insert_or_strip=%d, sock_priority=%d\n"
 		     "  abort_timeout_sec=%d, control_msg_num=%hu\n"
-		     "  ack_timeout=%d\n",
+		     "  ack_timeout=%d, recv_zcopy=%d, recv_buf_count=%u\n"
+		     "  send_batch_size=%u\n",
 		     opts->max_queue_depth,
 		     opts->max_io_size,
 		     opts->max_qpairs_per_ctrlr - 1,
@@ -757,7 +891,10 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		     ttransport->tcp_opts.sock_priority,
 		     opts->abort_timeout_sec,
 		     ttransport->tcp_opts.control_msg_num,
-		     opts->ack_timeout);
+		     opts->ack_timeout,
+		     ttransport->tcp_opts.recv_zcopy,
+		     ttransport->tcp_opts.recv_buf_count,
+		     ttransport->tcp_opts.send_batch_size);
 
 	if (ttransport->tcp_opts.sock_priority > SPDK_NVMF_TCP_DEFAULT_MAX_SOCK_PRIORITY) {
 		SPDK_ERRLOG("Unsupported socket_priority=%d, the current range is: 0 to %d\n"
@@ -774,6 +911,12 @@ nvmf_tcp_create(struct spdk_nvmf_transport_opts *opts)
 		ttransport->tcp_opts.control_msg_num = SPDK_NVMF_TCP_DEFAULT_CONTROL_MSG_NUM;
 	}
 
+	if (ttransport->tcp_opts.recv_zcopy && ttransport->tcp_opts.recv_buf_count == 0) {
+		SPDK_WARNLOG("TCP param recv_buf_count can't be 0 if recv_zcopy is enabled. "
+			     "Deriving it from num_shared_buffers\n");
+		ttransport->tcp_opts.recv_buf_count = SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT;
+	}
+
 	/* I/O unit size cannot be larger than max I/O size */
 	if (opts->io_unit_size > opts->max_io_size) {
 		SPDK_WARNLOG("TCP param io_unit_size %u can't be larger than max_io_size %u. Using max_io_size as io_unit_size\n",
@@ -1197,6 +1340,66 @@ tcp_sock_flush_cb(void *arg)
 	}
 }
 
+static void
+nvmf_tcp_qpair_send_flush(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	int rc;
+
+	tqpair->send_queued_bytes = 0;
+	tqpair->group->stat.send_flushes++;
+
+	/* A single flush sends a limited number of iovecs, so keep going until everything's
+	 * been written or the socket can't take more data.
+	 */
+	do {
+		rc = spdk_sock_flush(tqpair->sock);
+	} while (rc > 0);
+
+	if (rc < 0 && errno != EAGAIN) {
+		SPDK_DEBUGLOG(nvmf_tcp, "Could not write to socket of tqpair=%p: errno=%d\n",
+			      tqpair, errno);
+	}
+}
+
+/* Flush the sockets of all qpairs that queued PDUs since the last flush, once per socket */
+static void
+nvmf_tcp_send_flush(struct spdk_nvmf_tcp_poll_group *tgroup)
+{
+	TAILQ_HEAD(, spdk_nvmf_tcp_qpair) send_qpairs = TAILQ_HEAD_INITIALIZER(send_qpairs);
+	struct spdk_nvmf_tcp_qpair *tqpair;
+
+	/* Write completions may queue more PDUs, those are flushed by the next poll */
+	TAILQ_SWAP(&send_qpairs, &tgroup->send_qpairs, spdk_nvmf_tcp_qpair, send_link);
+	while ((tqpair = TAILQ_FIRST(&send_qpairs)) != NULL) {
+		TAILQ_REMOVE(&send_qpairs, tqpair, send_link);
+		tqpair->send_queued = false;
+		nvmf_tcp_qpair_send_flush(tqpair);
+	}
+}
+
+static void
+nvmf_tcp_send_queue(struct spdk_nvmf_tcp_qpair *tqpair, uint32_t len)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup = tqpair->group;
+
+	tgroup->stat.send_pdus++;
+	tqpair->send_queued_bytes += len;
+	if (tqpair->send_queued_bytes >= tgroup->send_batch_size) {
+		/* Don't hold back large transfers until the end of the poll */
+		if (tqpair->send_queued) {
+			TAILQ_REMOVE(&tgroup->send_qpairs, tqpair, send_link);
+			tqpair->send_queued = false;
+		}
+		nvmf_tcp_qpair_send_flush(tqpair);
+		return;
+	}
+
+	if (!tqpair->send_queued) {
+		TAILQ_INSERT_TAIL(&tgroup->send_qpairs, tqpair, send_link);
+		tqpair->send_queued = true;
+	}
+}
+
 static void
 _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 {
@@ -1220,6 +1423,8 @@ _tcp_write_pdu(struct nvme_tcp_pdu *pdu)
 				    "IC_RESP" : "TERM_REQ", rc, errno);
 			_pdu_write_done(pdu, rc >= 0 ? -EAGAIN : -errno);
 		}
+	} else if (tqpair->send_batch) {
+		nvmf_tcp_send_queue(tqpair, mapped_length);
 	} else if (spdk_interrupt_mode_is_enabled()) {
 		/* Async writes must be flushed */
 		if (!tqpair->pending_flush) {
@@ -1250,7 +1455,7 @@ static void
 pdu_data_crc32_compute(struct nvme_tcp_pdu *pdu)
 {
 	struct spdk_nvmf_tcp_qpair *tqpair = pdu->qpair;
-	int rc = 0;
+	int rc;
 
 	/* Data Digest */
 	if (pdu->data_len > 0 && g_nvme_tcp_ddgst[pdu->hdr.common.pdu_type] && tqpair->host_ddgst_enable) {
@@ -1262,10 +1467,9 @@ pdu_data_crc32_compute(struct nvme_tcp_pdu *pdu)
 			if (spdk_likely(rc == 0)) {
 				return;
 			}
-		} else {
-			pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
 		}
-		data_crc32_accel_done(pdu, rc);
+		pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
+		data_crc32_accel_done(pdu, 0);
 	} else {
 		_tcp_write_pdu(pdu);
 	}
@@ -1630,12 +1834,36 @@ nvmf_tcp_poll_group_intr(void *ctx)
 	return ret != 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
+/* recv_buf_count of UINT32_MAX gives each poll group a quarter of its share of the shared
+ * buffers, the rest of that share being left to the requests' data buffers.
+ */
+static uint32_t
+nvmf_tcp_recv_buf_count(struct spdk_nvmf_tcp_transport *ttransport,
+			struct spdk_nvmf_poll_group *group)
+{
+	uint32_t count, num_poll_groups = 0;
+
+	if (ttransport->tcp_opts.recv_buf_count != SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT) {
+		return ttransport->tcp_opts.recv_buf_count;
+	}
+
+	if (group != NULL) {
+		num_poll_groups = group->tgt->num_poll_groups;
+	}
+	num_poll_groups = num_poll_groups ? : spdk_env_get_core_count();
+
+	count = ttransport->transport.opts.num_shared_buffers / num_poll_groups / 4;
+
+	return spdk_max(spdk_min(count, NVMF_TCP_MAX_RECV_BUF_COUNT), 1u);
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 			   struct spdk_nvmf_poll_group *group)
 {
 	struct spdk_nvmf_tcp_transport	*ttransport;
 	struct spdk_nvmf_tcp_poll_group *tgroup;
+	uint32_t i;
 	int rc;
 
 	tgroup = calloc(1, sizeof(*tgroup));
@@ -1650,8 +1878,24 @@ nvmf_tcp_poll_group_create(struct spdk_nvmf_transport *transport,
 
 	TAILQ_INIT(&tgroup->qpairs);
 	TAILQ_INIT(&tgroup->await_req);
+	STAILQ_INIT(&tgroup->free_recv_bufs);
+	TAILQ_INIT(&tgroup->send_qpairs);
 
 	ttransport = SPDK_CONTAINEROF(transport, struct spdk_nvmf_tcp_transport, transport);
+	tgroup->send_batch_size = ttransport->tcp_opts.send_batch_size;
+
+	if (ttransport->tcp_opts.recv_zcopy) {
+		tgroup->num_recv_bufs = nvmf_tcp_recv_buf_count(ttransport, group);
+		tgroup->recv_bufs = calloc(tgroup->num_recv_bufs, sizeof(*tgroup->recv_bufs));
+		if (!tgroup->recv_bufs) {
+			goto cleanup;
+		}
+
+		for (i = 0; i < tgroup->num_recv_bufs; i++) {
+			tgroup->recv_bufs[i].tgroup = tgroup;
+			STAILQ_INSERT_TAIL(&tgroup->free_recv_bufs, &tgroup->recv_bufs[i], link);
+		}
+	}
 
 	if (transport->opts.in_capsule_data_size < SPDK_NVME_TCP_IN_CAPSULE_DATA_MAX_SIZE) {
 		SPDK_DEBUGLOG(nvmf_tcp, "ICD %u is less than min required for admin/fabric commands (%u). "
@@ -1690,6 +1934,32 @@ cleanup:
 	return NULL;
 }
 
+static struct spdk_nvmf_transport_poll_group *
+nvmf_tcp_get_least_loaded_poll_group(struct spdk_nvmf_tcp_transport *ttransport)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup, *start, *min;
+
+	/* Start at the next poll group in round-robin order, so that ties are spread out */
+	start = min = tgroup = ttransport->next_pg;
+	do {
+		if (nvmf_poll_group_cmp_load(tgroup->group.group, min->group.group) < 0) {
+			min = tgroup;
+		}
+
+		tgroup = TAILQ_NEXT(tgroup, link);
+		if (tgroup == NULL) {
+			tgroup = TAILQ_FIRST(&ttransport->poll_groups);
+		}
+	} while (tgroup != start);
+
+	ttransport->next_pg = TAILQ_NEXT(min, link);
+	if (ttransport->next_pg == NULL) {
+		ttransport->next_pg = TAILQ_FIRST(&ttransport->poll_groups);
+	}
+
+	return &min->group;
+}
+
 static struct spdk_nvmf_transport_poll_group *
 nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 {
@@ -1707,6 +1977,11 @@ nvmf_tcp_get_optimal_poll_group(struct spdk_nvmf_qpair *qpair)
 
 	pg = &ttransport->next_pg;
 	assert(*pg != NULL);
+
+	if (nvmf_tgt_placement_is_load_aware(qpair->transport->tgt)) {
+		return nvmf_tcp_get_least_loaded_poll_group(ttransport);
+	}
+
 	hint = (*pg)->sock_group;
 
 	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
@@ -1732,14 +2007,29 @@ nvmf_tcp_poll_group_destroy(struct spdk_nvmf_transport_poll_group *group)
 {
 	struct spdk_nvmf_tcp_poll_group *tgroup, *next_tgroup;
 	struct spdk_nvmf_tcp_transport *ttransport;
+	uint32_t i;
 
 	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
 	spdk_sock_group_unregister_interrupt(tgroup->sock_group);
 	spdk_sock_group_close(&tgroup->sock_group);
+
+	assert(TAILQ_EMPTY(&tgroup->send_qpairs));
 	if (tgroup->control_msg_list) {
 		nvmf_tcp_control_msg_list_free(tgroup->control_msg_list);
 	}
 
+	if (tgroup->recv_bufs) {
+		/* The buffers are owned by the trackers again, now that the sock group is closed */
+		for (i = 0; i < tgroup->num_recv_bufs; i++) {
+			assert(tgroup->recv_bufs[i].refs == 0);
+			if (tgroup->recv_bufs[i].buf != NULL) {
+				spdk_iobuf_put(tgroup->group.buf_cache, tgroup->recv_bufs[i].buf,
+					       tgroup->group.transport->opts.io_unit_size);
+			}
+		}
+		free(tgroup->recv_bufs);
+	}
+
 	if (tgroup->accel_channel) {
 		spdk_put_io_channel(tgroup->accel_channel);
 	}
@@ -1921,6 +2211,7 @@ nvmf_tcp_capsule_cmd_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
 		goto err;
 	}
 
+	tqpair->group->stat.recv_data_ios++;
 	rsp = &tcp_req->req.rsp->nvme_cpl;
 	if (spdk_unlikely(rsp->status.sc == SPDK_NVME_SC_COMMAND_TRANSIENT_TRANSPORT_ERROR)) {
 		nvmf_tcp_req_set_state(tcp_req, TCP_REQUEST_STATE_READY_TO_COMPLETE);
@@ -2118,6 +2409,9 @@ nvmf_tcp_h2c_data_payload_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	SPDK_DEBUGLOG(nvmf_tcp, "enter\n");
 
 	tcp_req->h2c_offset += pdu->data_len;
+	if (tcp_req->h2c_offset == tcp_req->req.length) {
+		tqpair->group->stat.recv_data_ios++;
+	}
 
 	/* Wait for all of the data to arrive AND for the initial R2T PDU send to be
 	 * acknowledged before moving on. */
@@ -2241,7 +2535,7 @@ data_crc32_calc_done(void *cb_arg, int status)
 static void
 nvmf_tcp_pdu_payload_handle(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu)
 {
-	int rc = 0;
+	int rc;
 	assert(tqpair->recv_state == NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD);
 	tqpair->pdu_in_progress = NULL;
 	nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY);
@@ -2255,10 +2549,9 @@ nvmf_tcp_pdu_payload_handle(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_
 			if (spdk_likely(rc == 0)) {
 				return;
 			}
-		} else {
-			pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
 		}
-		data_crc32_calc_done(pdu, rc);
+		pdu->data_digest_crc32 = nvme_tcp_pdu_calc_data_digest(pdu);
+		data_crc32_calc_done(pdu, 0);
 	} else {
 		_nvmf_tcp_pdu_payload_handle(tqpair, pdu);
 	}
@@ -2313,8 +2606,19 @@ nvmf_tcp_icreq_handle(struct spdk_nvmf_tcp_transport *ttransport,
 	}
 
 	tqpair->recv_buf_size = spdk_max(tqpair->recv_buf_size, MIN_SOCK_PIPE_SIZE);
+	if (tqpair->group != NULL && tqpair->group->recv_bufs != NULL) {
+		/* spdk_sock_recv_next() requires the receive pipe to be disabled */
+		if (spdk_sock_set_recvbuf(tqpair->sock, 0) == 0) {
+			tqpair->recv_zcopy = true;
+		} else {
+			SPDK_WARNLOG("Unable to disable the receive pipe on tqpair=%p, not using "
+				     "receive zero-copy\n", tqpair);
+		}
+	}
+
 	/* Now that we know whether digests are enabled, properly size the receive buffer */
-	if (spdk_sock_set_recvbuf(tqpair->sock, tqpair->recv_buf_size) < 0) {
+	if (!tqpair->recv_zcopy &&
+	    spdk_sock_set_recvbuf(tqpair->sock, tqpair->recv_buf_size) < 0) {
 		SPDK_WARNLOG("Unable to allocate enough memory for receive buffer on tqpair=%p with size=%d\n",
 			     tqpair,
 			     tqpair->recv_buf_size);
@@ -2491,6 +2795,196 @@ err:
 	nvmf_tcp_send_c2h_term_req(tqpair, pdu, fes, error_offset);
 }
 
+static void
+nvmf_tcp_rx_consume(struct spdk_nvmf_tcp_qpair *tqpair, uint32_t len)
+{
+	assert(len <= tqpair->rx_len);
+	tqpair->rx_data += len;
+	tqpair->rx_len -= len;
+	if (tqpair->rx_len == 0) {
+		nvmf_tcp_recv_buf_put(tqpair->rx_buf);
+		tqpair->rx_buf = NULL;
+	}
+}
+
+/* Make sure there's received data in tqpair->rx_buf.
+ *
+ * \return 1 if there is, 0 if no data is available yet, -ENOBUFS if the sock group ran out of
+ * receive buffers and NVME_TCP_CONNECTION_FATAL if the connection is broken.
+ */
+static int
+nvmf_tcp_rx_next(struct spdk_nvmf_tcp_qpair *tqpair)
+{
+	struct nvmf_tcp_recv_buf *rbuf;
+	void *buf;
+	int rc;
+
+	if (tqpair->rx_buf != NULL) {
+		return 1;
+	}
+
+	rc = spdk_sock_recv_next(tqpair->sock, &buf, (void **)&rbuf);
+	if (rc > 0) {
+		assert(rbuf->tgroup == tqpair->group);
+		rbuf->refs++;
+		tqpair->rx_buf = rbuf;
+		tqpair->rx_data = buf;
+		tqpair->rx_len = rc;
+		return 1;
+	}
+
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		if (errno == ENOBUFS) {
+			return -ENOBUFS;
+		}
+
+		if (errno != ECONNRESET) {
+			SPDK_ERRLOG("spdk_sock_recv_next() failed, errno %d: %s\n",
+				    errno, spdk_strerror(errno));
+		}
+	}
+
+	return NVME_TCP_CONNECTION_FATAL;
+}
+
+/* Read from the socket. In receive zero-copy mode, this copies the data out of the receive
+ * buffers and only reads from the socket directly when the poll group ran out of them.
+ */
+static int
+nvmf_tcp_readv_data(struct spdk_nvmf_tcp_qpair *tqpair, struct iovec *iov, int iovcnt,
+		    bool payload)
+{
+	struct spdk_iov_xfer ix;
+	size_t len, total = 0, size = 0;
+	int rc, i;
+
+	if (!tqpair->recv_zcopy) {
+		return nvme_tcp_readv_data(tqpair->sock, iov, iovcnt);
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		size += iov[i].iov_len;
+	}
+
+	spdk_iov_xfer_init(&ix, iov, iovcnt);
+	while (total < size) {
+		rc = nvmf_tcp_rx_next(tqpair);
+		if (rc <= 0) {
+			/* Return what has been read so far, the caller will come back for the rest */
+			if (total > 0) {
+				break;
+			}
+			if (rc == -ENOBUFS) {
+				return nvme_tcp_readv_data(tqpair->sock, iov, iovcnt);
+			}
+			return rc;
+		}
+
+		len = spdk_iov_xfer_from_buf(&ix, tqpair->rx_data, tqpair->rx_len);
+		nvmf_tcp_rx_consume(tqpair, len);
+		if (payload) {
+			tqpair->group->stat.recv_copy_bytes += len;
+		}
+		total += len;
+	}
+
+	return total;
+}
+
+static int
+nvmf_tcp_read_data(struct spdk_nvmf_tcp_qpair *tqpair, int bytes, void *buf)
+{
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = bytes,
+	};
+
+	return nvmf_tcp_readv_data(tqpair, &iov, 1, false);
+}
+
+/* Point the request to the PDU payload in the current receive buffer instead of copying the
+ * payload. This is possible if the whole payload has been received into that buffer and the
+ * PDU carries all of the request's data.
+ */
+static bool
+nvmf_tcp_pdu_payload_zcopy(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu)
+{
+	struct spdk_nvmf_tcp_req *tcp_req = pdu->req;
+	struct spdk_nvmf_request *req;
+	uint32_t len;
+
+	if (tcp_req == NULL || pdu->dif_ctx != NULL) {
+		return false;
+	}
+
+	req = &tcp_req->req;
+	len = pdu->data_len + (pdu->ddgst_enable ? SPDK_NVME_TCP_DIGEST_LEN : 0);
+	if (pdu->rw_offset != 0 || len > tqpair->rx_len || pdu->data_len != req->length ||
+	    req->dif_enabled || tcp_req->recv_buf != NULL) {
+		return false;
+	}
+
+	if (pdu->data_len < tqpair->qpair.transport->opts.io_unit_size /
+	    NVMF_TCP_RECV_ZCOPY_MIN_FRACTION) {
+		return false;
+	}
+
+	switch (pdu->hdr.common.pdu_type) {
+	case SPDK_NVME_TCP_PDU_TYPE_H2C_DATA:
+		/* Data of zero-copy bdev requests must land in the bdev's buffers */
+		if (!req->data_from_pool) {
+			return false;
+		}
+		spdk_nvmf_request_free_buffers(req, &tqpair->group->group, tqpair->qpair.transport);
+		break;
+	case SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD:
+		/* Control messages are returned to their list based on the iovec */
+		if (req->iovcnt != 1 || req->iov[0].iov_base != tcp_req->buf) {
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	req->iov[0].iov_base = tqpair->rx_data;
+	req->iov[0].iov_len = pdu->data_len;
+	req->iovcnt = 1;
+	_nvme_tcp_pdu_set_data(pdu, tqpair->rx_data, pdu->data_len);
+	if (pdu->ddgst_enable) {
+		memcpy(pdu->data_digest, tqpair->rx_data + pdu->data_len, SPDK_NVME_TCP_DIGEST_LEN);
+	}
+
+	tqpair->rx_buf->refs++;
+	tcp_req->recv_buf = tqpair->rx_buf;
+	tqpair->group->stat.recv_zcopy_bytes += pdu->data_len;
+	nvmf_tcp_rx_consume(tqpair, len);
+
+	return true;
+}
+
+static int
+nvmf_tcp_read_payload_data(struct spdk_nvmf_tcp_qpair *tqpair, struct nvme_tcp_pdu *pdu)
+{
+	struct iovec iov[NVME_TCP_MAX_SGL_DESCRIPTORS + 1];
+	int iovcnt;
+
+	if (tqpair->recv_zcopy && nvmf_tcp_rx_next(tqpair) == 1 &&
+	    nvmf_tcp_pdu_payload_zcopy(tqpair, pdu)) {
+		return pdu->data_len + (pdu->ddgst_enable ? SPDK_NVME_TCP_DIGEST_LEN : 0);
+	}
+
+	iovcnt = nvme_tcp_build_payload_iovs(iov, NVME_TCP_MAX_SGL_DESCRIPTORS + 1, pdu,
+					     pdu->ddgst_enable, NULL);
+	assert(iovcnt >= 0);
+
+	return nvmf_tcp_readv_data(tqpair, iov, iovcnt, true);
+}
+
 static int
 nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 {
@@ -2532,7 +3026,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				return rc;
 			}
 
-			rc = nvme_tcp_read_data(tqpair->sock,
+			rc = nvmf_tcp_read_data(tqpair,
 						sizeof(struct spdk_nvme_tcp_common_pdu_hdr) - pdu->ch_valid_bytes,
 						(void *)&pdu->hdr.common + pdu->ch_valid_bytes);
 			if (rc < 0) {
@@ -2553,7 +3047,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 			break;
 		/* Wait for the pdu specific header  */
 		case NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PSH:
-			rc = nvme_tcp_read_data(tqpair->sock,
+			rc = nvmf_tcp_read_data(tqpair,
 						pdu->psh_len - pdu->psh_valid_bytes,
 						(void *)&pdu->hdr.raw + sizeof(struct spdk_nvme_tcp_common_pdu_hdr) + pdu->psh_valid_bytes);
 			if (rc < 0) {
@@ -2592,7 +3086,7 @@ nvmf_tcp_sock_process(struct spdk_nvmf_tcp_qpair *tqpair)
 				pdu->ddgst_enable = true;
 			}
 
-			rc = nvme_tcp_read_payload_data(tqpair->sock, pdu);
+			rc = nvmf_tcp_read_payload_data(tqpair, pdu);
 			if (rc < 0) {
 				nvmf_tcp_qpair_set_recv_state(tqpair, NVME_TCP_PDU_RECV_STATE_QUIESCING);
 				break;
@@ -3338,6 +3832,11 @@ nvmf_tcp_req_process(struct spdk_nvmf_tcp_transport *ttransport,
 				break;
 			}
 
+			if (tcp_req->recv_buf != NULL) {
+				nvmf_tcp_recv_buf_put(tcp_req->recv_buf);
+				tcp_req->recv_buf = NULL;
+			}
+
 			if (tcp_req->req.data_from_pool) {
 				spdk_nvmf_request_free_buffers(&tcp_req->req, group, transport);
 			} else if (spdk_unlikely(tcp_req->has_in_capsule_data &&
@@ -3450,6 +3949,8 @@ nvmf_tcp_poll_group_add(struct spdk_nvmf_transport_poll_group *group,
 	}
 
 	tqpair->group = tgroup;
+	/* In interrupt mode, writes are flushed by a message to the thread instead */
+	tqpair->send_batch = tgroup->send_batch_size > 0 && !spdk_interrupt_mode_is_enabled();
 	nvmf_tcp_qpair_set_state(tqpair, NVMF_TCP_QPAIR_STATE_INVALID);
 	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
 
@@ -3477,6 +3978,12 @@ nvmf_tcp_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 	}
 	TAILQ_REMOVE(&tgroup->qpairs, tqpair, link);
 
+	if (tqpair->send_queued) {
+		TAILQ_REMOVE(&tgroup->send_qpairs, tqpair, send_link);
+		tqpair->send_queued = false;
+	}
+	tqpair->send_batch = false;
+
 	/* Try to force out any pending writes */
 	spdk_sock_flush(tqpair->sock);
 
@@ -3489,6 +3996,85 @@ nvmf_tcp_poll_group_remove(struct spdk_nvmf_transport_poll_group *group,
 	return rc;
 }
 
+static int
+nvmf_tcp_poll_group_migrate_out(struct spdk_nvmf_transport_poll_group *group,
+				struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvmf_tcp_poll_group	*tgroup;
+	struct spdk_nvmf_tcp_qpair	*tqpair;
+	int				rc;
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
+
+	assert(tqpair->group == tgroup);
+
+	/* Data received into the buffers of the sock group can't follow the socket */
+	if (tqpair->recv_zcopy) {
+		return -ENOTSUP;
+	}
+
+	/* Requests and PDUs in progress use the buffers, digest batches and messages of the
+	 * poll group. Once all requests are free, all of their PDUs have been written too.
+	 */
+	if (tqpair->state != NVMF_TCP_QPAIR_STATE_RUNNING ||
+	    (tqpair->recv_state != NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY &&
+	     tqpair->recv_state != NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH) ||
+	    tqpair->state_cntr[TCP_REQUEST_STATE_FREE] != tqpair->resource_count ||
+	    tqpair->fused_first != NULL || tqpair->pending_flush) {
+		return -EBUSY;
+	}
+
+	if (tqpair->send_queued) {
+		TAILQ_REMOVE(&tgroup->send_qpairs, tqpair, send_link);
+		tqpair->send_queued = false;
+		nvmf_tcp_qpair_send_flush(tqpair);
+	}
+
+	rc = spdk_sock_group_remove_sock(tgroup->sock_group, tqpair->sock);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not remove sock from sock_group: %s (%d)\n",
+			    spdk_strerror(errno), errno);
+		return -errno;
+	}
+
+	SPDK_DEBUGLOG(nvmf_tcp, "migrate tqpair=%p out of the tgroup=%p\n", tqpair, tgroup);
+	TAILQ_REMOVE(&tgroup->qpairs, tqpair, link);
+	tqpair->group = NULL;
+
+	return 0;
+}
+
+static int
+nvmf_tcp_poll_group_migrate_in(struct spdk_nvmf_transport_poll_group *group,
+			       struct spdk_nvmf_qpair *qpair)
+{
+	struct spdk_nvmf_tcp_poll_group	*tgroup;
+	struct spdk_nvmf_tcp_qpair	*tqpair;
+	int				rc;
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	tqpair = SPDK_CONTAINEROF(qpair, struct spdk_nvmf_tcp_qpair, qpair);
+
+	assert(tqpair->group == NULL);
+
+	/* The qpair joins the poll group even if the socket can't, so that it can be disconnected */
+	tqpair->group = tgroup;
+	tqpair->send_batch = tgroup->send_batch_size > 0 && !spdk_interrupt_mode_is_enabled();
+	TAILQ_INSERT_TAIL(&tgroup->qpairs, tqpair, link);
+
+	rc = spdk_sock_group_add_sock(tgroup->sock_group, tqpair->sock, nvmf_tcp_sock_cb, tqpair);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not add sock to sock_group: %s (%d)\n",
+			    spdk_strerror(errno), errno);
+		return -1;
+	}
+
+	SPDK_DEBUGLOG(nvmf_tcp, "migrate tqpair=%p into the tgroup=%p\n", tqpair, tgroup);
+
+	return 0;
+}
+
 static int
 nvmf_tcp_req_complete(struct spdk_nvmf_request *req)
 {
@@ -3563,6 +4149,10 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		return 0;
 	}
 
+	if (tgroup->recv_bufs != NULL && tgroup->group.buf_cache != NULL) {
+		nvmf_tcp_recv_bufs_fill(tgroup);
+	}
+
 	num_events = spdk_sock_group_poll(tgroup->sock_group);
 	if (spdk_unlikely(num_events < 0)) {
 		SPDK_ERRLOG("Failed to poll sock_group=%p\n", tgroup->sock_group);
@@ -3580,6 +4170,9 @@ nvmf_tcp_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 		}
 	}
 
+	/* Write out everything queued during this poll with one flush per socket */
+	nvmf_tcp_send_flush(tgroup);
+
 	return rc == 0 ? num_events : rc;
 }
 
@@ -3928,6 +4521,27 @@ nvmf_tcp_subsystem_dump_host(struct spdk_nvmf_transport *transport,
 	}
 }
 
+static void
+nvmf_tcp_poll_group_dump_stat(struct spdk_nvmf_transport_poll_group *group,
+			      struct spdk_json_write_ctx *w)
+{
+	struct spdk_nvmf_tcp_poll_group *tgroup;
+	struct spdk_sock_group_stats sock_stats;
+
+	tgroup = SPDK_CONTAINEROF(group, struct spdk_nvmf_tcp_poll_group, group);
+	spdk_sock_group_get_stats(tgroup->sock_group, &sock_stats);
+
+	spdk_json_write_named_uint64(w, "recv_data_ios", tgroup->stat.recv_data_ios);
+	spdk_json_write_named_uint64(w, "recv_copy_bytes", tgroup->stat.recv_copy_bytes);
+	spdk_json_write_named_uint64(w, "recv_zcopy_bytes", tgroup->stat.recv_zcopy_bytes);
+	spdk_json_write_named_uint64(w, "send_pdus", tgroup->stat.send_pdus);
+	spdk_json_write_named_uint64(w, "send_flushes", tgroup->stat.send_flushes);
+	spdk_json_write_named_uint64(w, "send_zcopy_bytes", sock_stats.send_zcopy_bytes);
+	spdk_json_write_named_uint64(w, "send_copy_bytes", sock_stats.send_copy_bytes);
+	spdk_json_write_named_uint64(w, "send_zcopy_notifications",
+				     sock_stats.send_zcopy_notifications);
+}
+
 static void
 nvmf_tcp_opts_init(struct spdk_nvmf_transport_opts *opts)
 {
@@ -3963,6 +4577,8 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.poll_group_add = nvmf_tcp_poll_group_add,
 	.poll_group_remove = nvmf_tcp_poll_group_remove,
 	.poll_group_poll = nvmf_tcp_poll_group_poll,
+	.poll_group_migrate_out = nvmf_tcp_poll_group_migrate_out,
+	.poll_group_migrate_in = nvmf_tcp_poll_group_migrate_in,
 
 	.req_free = nvmf_tcp_req_free,
 	.req_complete = nvmf_tcp_req_complete,
@@ -3976,6 +4592,8 @@ const struct spdk_nvmf_transport_ops spdk_nvmf_transport_tcp = {
 	.subsystem_add_host = nvmf_tcp_subsystem_add_host,
 	.subsystem_remove_host = nvmf_tcp_subsystem_remove_host,
 	.subsystem_dump_host = nvmf_tcp_subsystem_dump_host,
+
+	.poll_group_dump_stat = nvmf_tcp_poll_group_dump_stat,
 };
 
 SPDK_NVMF_TRANSPORT_REGISTER(tcp, &spdk_nvmf_transport_tcp);
@@ -735,6 +735,30 @@ nvmf_transport_poll_group_poll(struct spdk_nvmf_transport_poll_group *group)
 	return group->transport->ops->poll_group_poll(group);
 }
 
+int
+nvmf_transport_poll_group_migrate_out(struct spdk_nvmf_transport_poll_group *group,
+				      struct spdk_nvmf_qpair *qpair)
+{
+	assert(qpair->transport == group->transport);
+	if (group->transport->ops->poll_group_migrate_out == NULL) {
+		return -ENOTSUP;
+	}
+
+	return group->transport->ops->poll_group_migrate_out(group, qpair);
+}
+
+int
+nvmf_transport_poll_group_migrate_in(struct spdk_nvmf_transport_poll_group *group,
+				     struct spdk_nvmf_qpair *qpair)
+{
+	assert(qpair->transport == group->transport);
+	if (group->transport->ops->poll_group_migrate_in == NULL) {
+		return -ENOTSUP;
+	}
+
+	return group->transport->ops->poll_group_migrate_in(group, qpair);
+}
+
 int
 nvmf_transport_req_free(struct spdk_nvmf_request *req)
 {
@@ -994,6 +994,21 @@ spdk_sock_get_default_impl(void)
 	return NULL;
 }
 
+void
+spdk_sock_group_get_stats(struct spdk_sock_group *group, struct spdk_sock_group_stats *stats)
+{
+	struct spdk_sock_group_impl *group_impl = NULL;
+
+	assert(group != NULL);
+	memset(stats, 0, sizeof(*stats));
+
+	STAILQ_FOREACH_FROM(group_impl, &group->group_impls, link) {
+		if (group_impl->net_impl->group_impl_get_stats != NULL) {
+			group_impl->net_impl->group_impl_get_stats(group_impl, stats);
+		}
+	}
+}
+
 int
 spdk_sock_group_register_interrupt(struct spdk_sock_group *group, uint32_t events,
 				   spdk_interrupt_fn fn,
@@ -896,3 +896,33 @@ spdk_iobuf_get_stats(spdk_iobuf_get_stats_cb cb_fn, void *cb_arg)
 			      iobuf_get_channel_stats_done);
 	return 0;
 }
+
+uint32_t
+spdk_iobuf_get_regions(struct iovec *regions, uint32_t count)
+{
+	struct iobuf_node *node;
+	uint32_t num_regions = 0;
+	int32_t i;
+
+	if (!g_iobuf_is_initialized) {
+		return 0;
+	}
+
+	IOBUF_FOREACH_NUMA_ID(i) {
+		node = &g_iobuf.node[i];
+		if (num_regions < count) {
+			regions[num_regions].iov_base = node->small_pool_base;
+			regions[num_regions].iov_len = g_iobuf.opts.small_bufsize *
+						       g_iobuf.opts.small_pool_count;
+		}
+		num_regions++;
+		if (num_regions < count) {
+			regions[num_regions].iov_base = node->large_pool_base;
+			regions[num_regions].iov_len = g_iobuf.opts.large_bufsize *
+						       g_iobuf.opts.large_pool_count;
+		}
+		num_regions++;
+	}
+
+	return num_regions;
+}
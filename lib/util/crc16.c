@@ -6,6 +6,8 @@
 #include "spdk/crc16.h"
 #include "spdk/config.h"
 
+#include "crc_internal.h"
+
 /*
  * Use Intelligent Storage Acceleration Library for line speed CRC
  */
@@ -13,15 +15,14 @@
 #ifdef SPDK_CONFIG_ISAL
 #include "isa-l/include/crc.h"
 
-uint16_t
-spdk_crc16_t10dif(uint16_t init_crc, const void *buf, size_t len)
+static inline uint16_t
+crc16_t10dif_base(uint16_t init_crc, const void *buf, size_t len)
 {
 	return (crc16_t10dif(init_crc, buf, len));
 }
 
-uint16_t
-spdk_crc16_t10dif_copy(uint16_t init_crc, uint8_t *dst, uint8_t *src,
-		       size_t len)
+static inline uint16_t
+crc16_t10dif_copy_base(uint16_t init_crc, uint8_t *dst, uint8_t *src, size_t len)
 {
 	return (crc16_t10dif_copy(init_crc, dst, src, len));
 }
@@ -624,17 +625,76 @@ crc16_table_t10dif(uint16_t init_crc, const void *buf, size_t len)
 	return crc;
 }
 
-uint16_t
-spdk_crc16_t10dif(uint16_t init_crc, const void *buf, size_t len)
+static inline uint16_t
+crc16_t10dif_base(uint16_t init_crc, const void *buf, size_t len)
 {
 	return (crc16_table_t10dif(init_crc, buf, len));
 }
 
-uint16_t
-spdk_crc16_t10dif_copy(uint16_t init_crc, uint8_t *dst, uint8_t *src, size_t len)
+static inline uint16_t
+crc16_t10dif_copy_base(uint16_t init_crc, uint8_t *dst, uint8_t *src, size_t len)
 {
 	memcpy(dst, src, len);
 	return (crc16_table_t10dif(init_crc, src, len));
 }
 
 #endif
+
+#ifdef SPDK_HAVE_CRC_CLMUL
+
+static struct crc_clmul_params g_crc16_t10dif_clmul;
+
+__attribute__((constructor)) static void
+crc16_t10dif_clmul_init(void)
+{
+	crc_clmul_params_init(&g_crc16_t10dif_clmul, 0x8BB7, 16, false);
+}
+
+static inline size_t
+crc16_t10dif_fold(uint16_t *crc, const void *buf, size_t len)
+{
+	uint8_t folded[16];
+	size_t done;
+
+	done = crc_clmul_fold(&g_crc16_t10dif_clmul, buf, len, *crc, folded);
+	if (done != 0) {
+		*crc = crc16_t10dif_base(0, folded, sizeof(folded));
+	}
+
+	return done;
+}
+
+#else
+
+static inline size_t
+crc16_t10dif_fold(uint16_t *crc, const void *buf, size_t len)
+{
+	return 0;
+}
+
+#endif
+
+uint16_t
+spdk_crc16_t10dif(uint16_t init_crc, const void *buf, size_t len)
+{
+	size_t done;
+
+	done = crc16_t10dif_fold(&init_crc, buf, len);
+
+	return crc16_t10dif_base(init_crc, (const uint8_t *)buf + done, len - done);
+}
+
+uint16_t
+spdk_crc16_t10dif_copy(uint16_t init_crc, uint8_t *dst, uint8_t *src, size_t len)
+{
+	size_t done;
+
+	done = crc16_t10dif_fold(&init_crc, src, len);
+	if (done == 0) {
+		return crc16_t10dif_copy_base(init_crc, dst, src, len);
+	}
+
+	memcpy(dst, src, done);
+
+	return crc16_t10dif_copy_base(init_crc, dst + done, src + done, len - done);
+}
@@ -9,16 +9,16 @@
 
 #ifdef SPDK_HAVE_ISAL
 
-uint32_t
-spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+static inline uint32_t
+crc32c_update_base(const void *buf, size_t len, uint32_t crc)
 {
 	return crc32_iscsi((unsigned char *)buf, len, crc);
 }
 
 #elif defined(SPDK_HAVE_SSE4_2)
 
-uint32_t
-spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+static inline uint32_t
+crc32c_update_base(const void *buf, size_t len, uint32_t crc)
 {
 	size_t count_pre, count_post, count_mid;
 	const uint64_t *dword_buf;
@@ -28,7 +28,13 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	 * passed to _mm_crc32_u64 is 8 byte aligned. This can avoid unaligned loads.
 	 */
 	count_pre = ((uint64_t)buf & 7) == 0 ? 0 : 8 - ((uint64_t)buf & 7);
-	count_post = (uint64_t)((uintptr_t)buf + len) & 7;
+	if (count_pre >= len) {
+		/* The buffer ends before the first 8 byte boundary */
+		count_pre = len;
+		count_post = 0;
+	} else {
+		count_post = (uint64_t)((uintptr_t)buf + len) & 7;
+	}
 	count_mid = (len - count_pre - count_post) / 8;
 
 	while (count_pre--) {
@@ -57,8 +63,8 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 
 #elif defined(SPDK_HAVE_ARM_CRC)
 
-uint32_t
-spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+static inline uint32_t
+crc32c_update_base(const void *buf, size_t len, uint32_t crc)
 {
 	size_t count_pre, count_post, count_mid;
 	const uint64_t *dword_buf;
@@ -67,7 +73,13 @@ spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 	 * passed to crc32_cd is 8 byte aligned. This can avoid unaligned loads.
 	 */
 	count_pre = ((uint64_t)buf & 7) == 0 ? 0 : 8 - ((uint64_t)buf & 7);
-	count_post = (uint64_t)(buf + len) & 7;
+	if (count_pre >= len) {
+		/* The buffer ends before the first 8 byte boundary */
+		count_pre = len;
+		count_post = 0;
+	} else {
+		count_post = (uint64_t)(buf + len) & 7;
+	}
 	count_mid = (len - count_pre - count_post) / 8;
 
 	while (count_pre--) {
@@ -100,10 +112,49 @@ crc32c_init(void)
 	crc32_table_init(&g_crc32c_table, SPDK_CRC32C_POLYNOMIAL_REFLECT);
 }
 
+static inline uint32_t
+crc32c_update_base(const void *buf, size_t len, uint32_t crc)
+{
+	return crc32_update(&g_crc32c_table, buf, len, crc);
+}
+
+#endif
+
+#ifdef SPDK_HAVE_CRC_CLMUL
+
+static struct crc_clmul_params g_crc32c_clmul;
+
+__attribute__((constructor)) static void
+crc32c_clmul_init(void)
+{
+	crc_clmul_params_init(&g_crc32c_clmul, SPDK_CRC32C_POLYNOMIAL, 32, true);
+}
+
 uint32_t
 spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
 {
-	return crc32_update(&g_crc32c_table, buf, len, crc);
+	uint8_t folded[16];
+	size_t done;
+
+	done = crc_clmul_fold(&g_crc32c_clmul, buf, len, crc, folded);
+	if (done != 0) {
+		crc = crc32c_update_base(folded, sizeof(folded), 0);
+		if (done == len) {
+			return crc;
+		}
+		buf = (const uint8_t *)buf + done;
+		len -= done;
+	}
+
+	return crc32c_update_base(buf, len, crc);
+}
+
+#else
+
+uint32_t
+spdk_crc32c_update(const void *buf, size_t len, uint32_t crc)
+{
+	return crc32c_update_base(buf, len, crc);
 }
 
 #endif
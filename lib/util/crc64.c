@@ -9,8 +9,8 @@
 #ifdef SPDK_CONFIG_ISAL
 #include "isa-l/include/crc64.h"
 
-uint64_t
-spdk_crc64_nvme(const void *buf, size_t len, uint64_t crc)
+static inline uint64_t
+crc64_nvme_base(const void *buf, size_t len, uint64_t crc)
 {
 	return crc64_rocksoft_refl(crc, (const uint8_t *)buf, len);
 }
@@ -161,9 +161,46 @@ crc64_rocksoft_refl_base(uint64_t seed, const uint8_t *buf, uint64_t len)
 	return ~crc;
 }
 
+static inline uint64_t
+crc64_nvme_base(const void *buf, size_t len, uint64_t crc)
+{
+	return crc64_rocksoft_refl_base(crc, (const uint8_t *)buf, len);
+}
+#endif
+
+#ifdef SPDK_HAVE_CRC_CLMUL
+
+static struct crc_clmul_params g_crc64_nvme_clmul;
+
+__attribute__((constructor)) static void
+crc64_nvme_clmul_init(void)
+{
+	crc_clmul_params_init(&g_crc64_nvme_clmul, 0xad93d23594c93659ULL, 64, true);
+}
+
 uint64_t
 spdk_crc64_nvme(const void *buf, size_t len, uint64_t crc)
 {
-	return crc64_rocksoft_refl_base(crc, (const uint8_t *)buf, len);
+	uint8_t folded[16];
+	size_t done;
+
+	/* The base implementation inverts the CRC on input and output, folding does not */
+	done = crc_clmul_fold(&g_crc64_nvme_clmul, buf, len, ~crc, folded);
+	if (done != 0) {
+		crc = crc64_nvme_base(folded, sizeof(folded), ~0ULL);
+		buf = (const uint8_t *)buf + done;
+		len -= done;
+	}
+
+	return crc64_nvme_base(buf, len, crc);
 }
+
+#else
+
+uint64_t
+spdk_crc64_nvme(const void *buf, size_t len, uint64_t crc)
+{
+	return crc64_nvme_base(buf, len, crc);
+}
+
 #endif
@@ -0,0 +1,378 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/crc_impl.h"
+#include "spdk/log.h"
+
+#include "crc_internal.h"
+
+static enum spdk_crc_impl g_crc_impl = SPDK_CRC_IMPL_BASE;
+
+#ifdef SPDK_HAVE_CRC_CLMUL
+
+#include <x86intrin.h>
+
+/*
+ * CRCs are computed by folding: 128-bit chunks of the buffer are multiplied by
+ * x^distance mod P, which moves them forward by distance bits, and XORed into the chunk
+ * found there.  Four independent accumulators are kept to hide the multiplication
+ * latency.  Once the buffer is folded into a single chunk, the remaining CRC of 16 bytes
+ * is left to the base implementation, which avoids a Barrett reduction specific to each
+ * polynomial.
+ *
+ * Chunks are loaded so that bit i of the register holds the coefficient of x^i
+ * (normal CRCs, byte swapped) or of x^(127 - i) (reflected CRCs, as is).  A 64-bit half
+ * H multiplied by a constant K gives H * K exactly for normal CRCs, and H * K * x for
+ * reflected ones, which the reflected constants compensate for.
+ */
+
+static uint64_t
+crc_xpow_mod(uint32_t power, uint64_t poly, uint32_t width)
+{
+	uint64_t top = 1ULL << (width - 1);
+	uint64_t mask = width == 64 ? UINT64_MAX : (1ULL << width) - 1;
+	uint64_t val = 1;
+	uint32_t i;
+
+	for (i = 0; i < power; i++) {
+		val = (val & top) ? ((val << 1) ^ poly) & mask : (val << 1) & mask;
+	}
+
+	return val;
+}
+
+static uint64_t
+crc_bit_reverse64(uint64_t val)
+{
+	uint64_t rev = 0;
+	int i;
+
+	for (i = 0; i < 64; i++) {
+		rev |= ((val >> i) & 1) << (63 - i);
+	}
+
+	return rev;
+}
+
+static void
+crc_clmul_fold_consts(const struct crc_clmul_params *params, uint64_t poly, uint32_t distance,
+		      uint64_t consts[2])
+{
+	/* consts[0] multiplies the low 64 bits of a chunk, consts[1] the high 64 bits */
+	if (params->reflected) {
+		consts[0] = crc_bit_reverse64(crc_xpow_mod(64 + distance - 1, poly, params->width));
+		consts[1] = crc_bit_reverse64(crc_xpow_mod(distance - 1, poly, params->width));
+	} else {
+		consts[0] = crc_xpow_mod(distance, poly, params->width);
+		consts[1] = crc_xpow_mod(64 + distance, poly, params->width);
+	}
+}
+
+void
+crc_clmul_params_init(struct crc_clmul_params *params, uint64_t poly, uint32_t width,
+		      bool reflected)
+{
+	assert(width > 0 && width <= 64);
+
+	params->reflected = reflected;
+	params->width = width;
+	crc_clmul_fold_consts(params, poly, 128, params->fold_128);
+	crc_clmul_fold_consts(params, poly, 256, params->fold_256);
+	crc_clmul_fold_consts(params, poly, 384, params->fold_384);
+	crc_clmul_fold_consts(params, poly, 512, params->fold_512);
+	crc_clmul_fold_consts(params, poly, 1024, params->fold_1024);
+	crc_clmul_fold_consts(params, poly, 1536, params->fold_1536);
+	crc_clmul_fold_consts(params, poly, 2048, params->fold_2048);
+}
+
+#define CRC_CLMUL_TARGET	__attribute__((target("pclmul,ssse3")))
+#define CRC_VPCLMUL_TARGET	__attribute__((target("avx512f,avx512bw,vpclmulqdq,pclmul,ssse3")))
+
+static CRC_CLMUL_TARGET inline __m128i
+crc_clmul_consts(const uint64_t consts[2])
+{
+	return _mm_loadu_si128((const __m128i *)consts);
+}
+
+static CRC_CLMUL_TARGET inline __m128i
+crc_clmul_fold128(__m128i chunk, __m128i consts)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(chunk, consts, 0x00),
+			     _mm_clmulepi64_si128(chunk, consts, 0x11));
+}
+
+static CRC_CLMUL_TARGET inline __m128i
+crc_clmul_load128(const struct crc_clmul_params *params, const uint8_t *buf)
+{
+	__m128i chunk = _mm_loadu_si128((const __m128i *)buf);
+
+	if (!params->reflected) {
+		chunk = _mm_shuffle_epi8(chunk, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					 8, 9, 10, 11, 12, 13, 14, 15));
+	}
+
+	return chunk;
+}
+
+static CRC_CLMUL_TARGET inline __m128i
+crc_clmul_seed(const struct crc_clmul_params *params, uint64_t crc)
+{
+	/* The CRC seed is XORed into the first width bits of the buffer */
+	if (params->reflected) {
+		return _mm_set_epi64x(0, crc);
+	}
+
+	return _mm_set_epi64x(crc << (64 - params->width), 0);
+}
+
+static CRC_CLMUL_TARGET inline void
+crc_clmul_store128(const struct crc_clmul_params *params, __m128i chunk, uint8_t folded[16])
+{
+	if (!params->reflected) {
+		chunk = _mm_shuffle_epi8(chunk, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					 8, 9, 10, 11, 12, 13, 14, 15));
+	}
+
+	_mm_storeu_si128((__m128i *)folded, chunk);
+}
+
+/* Fold the 16-byte chunks remaining after the four accumulators were combined into x */
+static CRC_CLMUL_TARGET inline size_t
+crc_clmul_fold_tail(const struct crc_clmul_params *params, __m128i x, const uint8_t *buf,
+		    size_t len, uint8_t folded[16])
+{
+	__m128i fold_128 = crc_clmul_consts(params->fold_128);
+	size_t off = 0;
+
+	while (len - off >= 16) {
+		x = _mm_xor_si128(crc_clmul_fold128(x, fold_128), crc_clmul_load128(params, buf + off));
+		off += 16;
+	}
+
+	crc_clmul_store128(params, x, folded);
+
+	return off;
+}
+
+static CRC_CLMUL_TARGET size_t
+crc_clmul_fold_128(const struct crc_clmul_params *params, const uint8_t *buf, size_t len,
+		   uint64_t crc, uint8_t folded[16])
+{
+	__m128i fold_512 = crc_clmul_consts(params->fold_512);
+	__m128i x0, x1, x2, x3;
+	size_t off;
+
+	x0 = _mm_xor_si128(crc_clmul_load128(params, buf), crc_clmul_seed(params, crc));
+	x1 = crc_clmul_load128(params, buf + 16);
+	x2 = crc_clmul_load128(params, buf + 32);
+	x3 = crc_clmul_load128(params, buf + 48);
+
+	for (off = 64; len - off >= 64; off += 64) {
+		x0 = _mm_xor_si128(crc_clmul_fold128(x0, fold_512), crc_clmul_load128(params, buf + off));
+		x1 = _mm_xor_si128(crc_clmul_fold128(x1, fold_512), crc_clmul_load128(params, buf + off + 16));
+		x2 = _mm_xor_si128(crc_clmul_fold128(x2, fold_512), crc_clmul_load128(params, buf + off + 32));
+		x3 = _mm_xor_si128(crc_clmul_fold128(x3, fold_512), crc_clmul_load128(params, buf + off + 48));
+	}
+
+	x0 = _mm_xor_si128(crc_clmul_fold128(x0, crc_clmul_consts(params->fold_384)),
+			   crc_clmul_fold128(x1, crc_clmul_consts(params->fold_256)));
+	x0 = _mm_xor_si128(x0, crc_clmul_fold128(x2, crc_clmul_consts(params->fold_128)));
+	x0 = _mm_xor_si128(x0, x3);
+
+	return off + crc_clmul_fold_tail(params, x0, buf + off, len - off, folded);
+}
+
+static CRC_VPCLMUL_TARGET inline __m512i
+crc_vpclmul_consts(const uint64_t consts[2])
+{
+	return _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)consts));
+}
+
+static CRC_VPCLMUL_TARGET inline __m512i
+crc_vpclmul_fold512(__m512i chunks, __m512i consts)
+{
+	return _mm512_xor_si512(_mm512_clmulepi64_epi128(chunks, consts, 0x00),
+				_mm512_clmulepi64_epi128(chunks, consts, 0x11));
+}
+
+static CRC_VPCLMUL_TARGET inline __m512i
+crc_vpclmul_load512(const struct crc_clmul_params *params, const uint8_t *buf)
+{
+	__m512i chunks = _mm512_loadu_si512(buf);
+
+	if (!params->reflected) {
+		chunks = _mm512_shuffle_epi8(chunks, _mm512_broadcast_i32x4(
+						     _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+								     8, 9, 10, 11, 12, 13, 14, 15)));
+	}
+
+	return chunks;
+}
+
+static CRC_VPCLMUL_TARGET size_t
+crc_vpclmul_fold_512(const struct crc_clmul_params *params, const uint8_t *buf, size_t len,
+		     uint64_t crc, uint8_t folded[16])
+{
+	__m512i fold_2048 = crc_vpclmul_consts(params->fold_2048);
+	__m512i fold_512 = crc_vpclmul_consts(params->fold_512);
+	__m512i z0, z1, z2, z3;
+	__m128i x;
+	size_t off;
+
+	z0 = _mm512_xor_si512(crc_vpclmul_load512(params, buf),
+			      _mm512_zextsi128_si512(crc_clmul_seed(params, crc)));
+	z1 = crc_vpclmul_load512(params, buf + 64);
+	z2 = crc_vpclmul_load512(params, buf + 128);
+	z3 = crc_vpclmul_load512(params, buf + 192);
+
+	for (off = 256; len - off >= 256; off += 256) {
+		z0 = _mm512_xor_si512(crc_vpclmul_fold512(z0, fold_2048), crc_vpclmul_load512(params, buf + off));
+		z1 = _mm512_xor_si512(crc_vpclmul_fold512(z1, fold_2048),
+				      crc_vpclmul_load512(params, buf + off + 64));
+		z2 = _mm512_xor_si512(crc_vpclmul_fold512(z2, fold_2048),
+				      crc_vpclmul_load512(params, buf + off + 128));
+		z3 = _mm512_xor_si512(crc_vpclmul_fold512(z3, fold_2048),
+				      crc_vpclmul_load512(params, buf + off + 192));
+	}
+
+	z0 = _mm512_xor_si512(crc_vpclmul_fold512(z0, crc_vpclmul_consts(params->fold_1536)),
+			      crc_vpclmul_fold512(z1, crc_vpclmul_consts(params->fold_1024)));
+	z0 = _mm512_xor_si512(z0, crc_vpclmul_fold512(z2, fold_512));
+	z0 = _mm512_xor_si512(z0, z3);
+
+	for (; len - off >= 64; off += 64) {
+		z0 = _mm512_xor_si512(crc_vpclmul_fold512(z0, fold_512), crc_vpclmul_load512(params, buf + off));
+	}
+
+	/* Combine the four 128-bit lanes */
+	x = _mm_xor_si128(crc_clmul_fold128(_mm512_extracti32x4_epi32(z0, 0),
+					    crc_clmul_consts(params->fold_384)),
+			  crc_clmul_fold128(_mm512_extracti32x4_epi32(z0, 1),
+					    crc_clmul_consts(params->fold_256)));
+	x = _mm_xor_si128(x, crc_clmul_fold128(_mm512_extracti32x4_epi32(z0, 2),
+					       crc_clmul_consts(params->fold_128)));
+	x = _mm_xor_si128(x, _mm512_extracti32x4_epi32(z0, 3));
+
+	return off + crc_clmul_fold_tail(params, x, buf + off, len - off, folded);
+}
+
+size_t
+crc_clmul_fold(const struct crc_clmul_params *params, const void *buf, size_t len, uint64_t crc,
+	       uint8_t folded[16])
+{
+	switch (g_crc_impl) {
+	case SPDK_CRC_IMPL_VPCLMUL:
+		if (len >= 256) {
+			return crc_vpclmul_fold_512(params, buf, len, crc, folded);
+		}
+	/* fallthrough */
+	case SPDK_CRC_IMPL_CLMUL:
+		if (len >= 64) {
+			return crc_clmul_fold_128(params, buf, len, crc, folded);
+		}
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+static bool
+crc_impl_supported(enum spdk_crc_impl impl)
+{
+	__builtin_cpu_init();
+
+	switch (impl) {
+	case SPDK_CRC_IMPL_BASE:
+		return true;
+	case SPDK_CRC_IMPL_CLMUL:
+		return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+	case SPDK_CRC_IMPL_VPCLMUL:
+		return crc_impl_supported(SPDK_CRC_IMPL_CLMUL) &&
+		       __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		       __builtin_cpu_supports("vpclmulqdq");
+	default:
+		return false;
+	}
+}
+
+static enum spdk_crc_impl
+crc_impl_best(void)
+{
+#ifdef SPDK_CONFIG_ISAL
+	/* ISA-L already selects folding kernels for the CPU at runtime */
+	return SPDK_CRC_IMPL_BASE;
+#else
+	if (crc_impl_supported(SPDK_CRC_IMPL_VPCLMUL)) {
+		return SPDK_CRC_IMPL_VPCLMUL;
+	} else if (crc_impl_supported(SPDK_CRC_IMPL_CLMUL)) {
+		return SPDK_CRC_IMPL_CLMUL;
+	}
+
+	return SPDK_CRC_IMPL_BASE;
+#endif
+}
+
+#else
+
+static bool
+crc_impl_supported(enum spdk_crc_impl impl)
+{
+	return impl == SPDK_CRC_IMPL_BASE;
+}
+
+static enum spdk_crc_impl
+crc_impl_best(void)
+{
+	return SPDK_CRC_IMPL_BASE;
+}
+
+#endif /* SPDK_HAVE_CRC_CLMUL */
+
+__attribute__((constructor)) static void
+crc_impl_init(void)
+{
+	g_crc_impl = crc_impl_best();
+}
+
+int
+spdk_crc_set_impl(enum spdk_crc_impl impl)
+{
+	if (impl == SPDK_CRC_IMPL_AUTO) {
+		impl = crc_impl_best();
+	}
+
+	if (!crc_impl_supported(impl)) {
+		SPDK_ERRLOG("CRC implementation %s is not supported\n", spdk_crc_impl_get_name(impl));
+		return -ENOTSUP;
+	}
+
+	g_crc_impl = impl;
+
+	return 0;
+}
+
+enum spdk_crc_impl
+spdk_crc_get_impl(void)
+{
+	return g_crc_impl;
+}
+
+const char *
+spdk_crc_impl_get_name(enum spdk_crc_impl impl)
+{
+	switch (impl) {
+	case SPDK_CRC_IMPL_AUTO:
+		return "auto";
+	case SPDK_CRC_IMPL_BASE:
+		return "base";
+	case SPDK_CRC_IMPL_CLMUL:
+		return "clmul";
+	case SPDK_CRC_IMPL_VPCLMUL:
+		return "vpclmul";
+	default:
+		return "unknown";
+	}
+}
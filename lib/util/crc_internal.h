@@ -6,6 +6,7 @@
 #ifndef SPDK_CRC_INTERNAL_H
 #define SPDK_CRC_INTERNAL_H
 
+#include "spdk/stdinc.h"
 #include "spdk/config.h"
 
 #ifdef SPDK_CONFIG_ISAL
@@ -19,4 +20,38 @@
 #include <x86intrin.h>
 #endif
 
+#ifdef __x86_64__
+#define SPDK_HAVE_CRC_CLMUL
+
+/*
+ * Parameters of a CRC of at most 64 bits for the carry-less multiplication folding
+ * kernels in crc_clmul.c.  Each pair of fold constants moves a 128-bit chunk forward
+ * by the number of bits in its name.
+ */
+struct crc_clmul_params {
+	bool		reflected;
+	uint32_t	width;
+	uint64_t	fold_128[2];
+	uint64_t	fold_256[2];
+	uint64_t	fold_384[2];
+	uint64_t	fold_512[2];
+	uint64_t	fold_1024[2];
+	uint64_t	fold_1536[2];
+	uint64_t	fold_2048[2];
+};
+
+/* poly is the CRC polynomial in normal (MSB-first) form, without the x^width term */
+void crc_clmul_params_init(struct crc_clmul_params *params, uint64_t poly, uint32_t width,
+			   bool reflected);
+
+/*
+ * Fold the leading part of buf into 16 bytes written to folded, starting from the CRC
+ * value crc without any final inversion.  The CRC of the whole buffer is then the CRC
+ * of folded, starting from 0, continued over the remaining bytes.  Returns the number of
+ * bytes consumed, 0 if the selected implementation does not fold or len is too short.
+ */
+size_t crc_clmul_fold(const struct crc_clmul_params *params, const void *buf, size_t len,
+		      uint64_t crc, uint8_t folded[16]);
+#endif
+
 #endif /* SPDK_CRC_INTERNAL_H */
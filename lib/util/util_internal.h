@@ -19,6 +19,11 @@
  */
 #define SPDK_CRC32C_POLYNOMIAL_REFLECT 0x82f63b78UL
 
+/**
+ * CRC-32C (Castagnoli) polynomial
+ */
+#define SPDK_CRC32C_POLYNOMIAL 0x1edc6f41UL
+
 struct spdk_crc32_table {
 	uint32_t table[256];
 };
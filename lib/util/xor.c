@@ -84,6 +84,93 @@ xor_gen_basic(void *dest, void **sources, uint32_t n, uint32_t len)
 	}
 }
 
+/* Multiply each byte of a word by 2 in GF(2^8) with the 0x11d polynomial */
+static inline uint64_t
+gf_mul2_u64(uint64_t v)
+{
+	uint64_t hi = v & 0x8080808080808080ULL;
+
+	hi = (hi << 1) - (hi >> 7);
+
+	return ((v << 1) & 0xfefefefefefefefeULL) ^ (hi & 0x1d1d1d1d1d1d1d1dULL);
+}
+
+static inline uint8_t
+gf_mul2_u8(uint8_t v)
+{
+	return (uint8_t)(v << 1) ^ ((v & 0x80) ? 0x1d : 0);
+}
+
+static bool
+pq_buffers_aligned(void *p, void *q, void **sources, uint32_t n, size_t alignment)
+{
+	return buffers_aligned(p, sources, n, alignment) && is_aligned(q, alignment);
+}
+
+static void
+pq_gen_unaligned(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint32_t i;
+	int j;
+
+	for (i = 0; i < len; i++) {
+		uint8_t wp, wq;
+
+		wp = wq = ((uint8_t *)sources[n - 1])[i];
+		for (j = n - 2; j >= 0; j--) {
+			uint8_t d = ((uint8_t *)sources[j])[i];
+
+			wp ^= d;
+			wq = gf_mul2_u8(wq) ^ d;
+		}
+		((uint8_t *)p)[i] = wp;
+		((uint8_t *)q)[i] = wq;
+	}
+}
+
+static void
+pq_gen_basic(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint32_t shift;
+	uint32_t len_div, len_rem;
+	uint32_t i;
+	int j;
+
+	if (!pq_buffers_aligned(p, q, sources, n, sizeof(uint64_t))) {
+		pq_gen_unaligned(p, q, sources, n, len);
+		return;
+	}
+
+	shift = spdk_u32log2(sizeof(uint64_t));
+	len_div = len >> shift;
+	len_rem = len_div << shift;
+
+	/* Q is evaluated with Horner's scheme, starting from the highest source index */
+	for (i = 0; i < len_div; i++) {
+		uint64_t wp, wq;
+
+		wp = wq = ((uint64_t *)sources[n - 1])[i];
+		for (j = n - 2; j >= 0; j--) {
+			uint64_t d = ((uint64_t *)sources[j])[i];
+
+			wp ^= d;
+			wq = gf_mul2_u64(wq) ^ d;
+		}
+		((uint64_t *)p)[i] = wp;
+		((uint64_t *)q)[i] = wq;
+	}
+
+	if (len_rem < len) {
+		void *sources2[SPDK_XOR_MAX_SRC];
+
+		for (i = 0; i < n; i++) {
+			sources2[i] = (uint8_t *)sources[i] + len_rem;
+		}
+
+		pq_gen_unaligned((uint8_t *)p + len_rem, (uint8_t *)q + len_rem, sources2, n, len - len_rem);
+	}
+}
+
 #ifdef SPDK_CONFIG_ISAL
 #include "isa-l/include/raid.h"
 
@@ -112,6 +199,27 @@ do_xor_gen(void *dest, void **sources, uint32_t n, uint32_t len)
 	return 0;
 }
 
+static int
+do_pq_gen(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	if (pq_buffers_aligned(p, q, sources, n, SPDK_XOR_BUF_ALIGN) &&
+	    len % SPDK_XOR_BUF_ALIGN == 0) {
+		void *buffers[SPDK_XOR_MAX_SRC + 2];
+
+		memcpy(buffers, sources, n * sizeof(buffers[0]));
+		buffers[n] = p;
+		buffers[n + 1] = q;
+
+		if (pq_gen(n + 2, len, buffers)) {
+			return -EINVAL;
+		}
+	} else {
+		pq_gen_basic(p, q, sources, n, len);
+	}
+
+	return 0;
+}
+
 #else
 
 #define SPDK_XOR_BUF_ALIGN sizeof(uint64_t)
@@ -123,6 +231,13 @@ do_xor_gen(void *dest, void **sources, uint32_t n, uint32_t len)
 	return 0;
 }
 
+static inline int
+do_pq_gen(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	pq_gen_basic(p, q, sources, n, len);
+	return 0;
+}
+
 #endif
 
 int
@@ -135,6 +250,16 @@ spdk_xor_gen(void *dest, void **sources, uint32_t n, uint32_t len)
 	return do_xor_gen(dest, sources, n, len);
 }
 
+int
+spdk_xor_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	if (n < 2 || n > SPDK_XOR_MAX_SRC) {
+		return -EINVAL;
+	}
+
+	return do_pq_gen(p, q, sources, n, len);
+}
+
 size_t
 spdk_xor_get_optimal_alignment(void)
 {
@@ -127,6 +127,7 @@ DEPDIRS-env_dpdk_rpc := $(JSON_LIBS)
 # module/sock
 DEPDIRS-sock_posix := log sock util thread trace
 DEPDIRS-sock_uring := log sock util thread trace
+DEPDIRS-sock_shm := log sock util
 
 # module/scheduler
 DEPDIRS-scheduler_dynamic := event log thread util json
@@ -159,6 +160,8 @@ DEPDIRS-bdev_passthru := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_raid := $(BDEV_DEPS_THREAD) trace
 ifeq ($(CONFIG_RAID5F),y)
 DEPDIRS-bdev_raid += accel
+else ifeq ($(CONFIG_RAID6),y)
+DEPDIRS-bdev_raid += accel
 endif
 DEPDIRS-bdev_rbd := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_uring := $(BDEV_DEPS_THREAD)
@@ -27,12 +27,18 @@
 #include <libaio.h>
 #endif
 
+#define SPDK_AIO_BATCH_SIZE 32
+
 struct bdev_aio_io_channel {
 	uint64_t				io_inflight;
 #ifdef __FreeBSD__
 	int					kqfd;
 #else
 	io_context_t				io_ctx;
+	/* iocbs collected during submit_request_batch, submitted with a single io_submit */
+	bool					batching;
+	int					batch_count;
+	struct iocb				*batch_iocbs[SPDK_AIO_BATCH_SIZE];
 #endif
 	struct bdev_aio_group_channel		*group_ch;
 	TAILQ_ENTRY(bdev_aio_io_channel)	link;
@@ -194,6 +200,38 @@ bdev_aio_submit_io(enum spdk_bdev_io_type type, struct file_disk *fdisk,
 	return aio_writev(aiocb);
 }
 #else
+static void
+bdev_aio_submit_batch(struct bdev_aio_io_channel *aio_ch)
+{
+	struct bdev_aio_task *aio_task;
+	int submitted = 0, rc = 0;
+
+	while (submitted < aio_ch->batch_count) {
+		rc = io_submit(aio_ch->io_ctx, aio_ch->batch_count - submitted,
+			       &aio_ch->batch_iocbs[submitted]);
+		if (rc <= 0) {
+			break;
+		}
+		submitted += rc;
+	}
+
+	/* Complete whatever the kernel did not accept, as bdev_aio_rw() does for a single iocb. */
+	while (submitted < aio_ch->batch_count) {
+		aio_task = aio_ch->batch_iocbs[submitted++]->data;
+		aio_ch->io_inflight--;
+		if (rc == -EAGAIN) {
+			spdk_bdev_io_complete(spdk_bdev_io_from_ctx(aio_task), SPDK_BDEV_IO_STATUS_NOMEM);
+		} else {
+			spdk_bdev_io_complete_aio_status(spdk_bdev_io_from_ctx(aio_task), rc < 0 ? rc : -EIO);
+		}
+	}
+	if (rc < 0 && rc != -EAGAIN) {
+		SPDK_ERRLOG("%s: io_submit returned %d\n", __func__, rc);
+	}
+
+	aio_ch->batch_count = 0;
+}
+
 static int
 bdev_aio_submit_io(enum spdk_bdev_io_type type, struct file_disk *fdisk,
 		   struct spdk_io_channel *ch, struct bdev_aio_task *aio_task,
@@ -220,6 +258,15 @@ bdev_aio_submit_io(enum spdk_bdev_io_type type, struct file_disk *fdisk,
 	aio_task->len = nbytes;
 	aio_task->ch = aio_ch;
 
+	if (aio_ch->batching) {
+		if (aio_ch->batch_count == SPDK_AIO_BATCH_SIZE) {
+			bdev_aio_submit_batch(aio_ch);
+		}
+		/* The iocb is accounted as in flight; bdev_aio_submit_batch() completes it on error. */
+		aio_ch->batch_iocbs[aio_ch->batch_count++] = iocb;
+		return 0;
+	}
+
 	return io_submit(aio_ch->io_ctx, 1, &iocb);
 }
 #endif
@@ -667,6 +714,27 @@ bdev_aio_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io
 	}
 }
 
+#ifndef __FreeBSD__
+static void
+bdev_aio_submit_request_batch(struct spdk_io_channel *ch, struct spdk_bdev_io **bdev_ios,
+			      uint32_t num_ios)
+{
+	struct bdev_aio_io_channel *aio_ch = spdk_io_channel_get_ctx(ch);
+	uint32_t i;
+
+	assert(!aio_ch->batching);
+	aio_ch->batching = true;
+	for (i = 0; i < num_ios; i++) {
+		bdev_aio_submit_request(ch, bdev_ios[i]);
+	}
+	aio_ch->batching = false;
+
+	if (aio_ch->batch_count > 0) {
+		bdev_aio_submit_batch(aio_ch);
+	}
+}
+#endif
+
 static bool
 bdev_aio_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
@@ -818,6 +886,9 @@ static const struct spdk_bdev_fn_table aio_fn_table = {
 	.get_io_channel		= bdev_aio_get_io_channel,
 	.dump_info_json		= bdev_aio_dump_info_json,
 	.write_config_json	= bdev_aio_write_json_config,
+#ifndef __FreeBSD__
+	.submit_request_batch	= bdev_aio_submit_request_batch,
+#endif
 };
 
 static void
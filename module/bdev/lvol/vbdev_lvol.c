@@ -1231,6 +1231,14 @@ int
 vbdev_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 		  bool thin_provision, enum lvol_clear_method clear_method, spdk_lvol_op_with_handle_complete cb_fn,
 		  void *cb_arg)
+{
+	return vbdev_lvol_create_ext(lvs, name, sz, thin_provision, clear_method, 0, cb_fn, cb_arg);
+}
+
+int
+vbdev_lvol_create_ext(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
+		      bool thin_provision, enum lvol_clear_method clear_method, uint32_t sub_cluster_sz,
+		      spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol_with_handle_req *req;
 	int rc;
@@ -1242,8 +1250,8 @@ vbdev_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
 	req->cb_fn = cb_fn;
 	req->cb_arg = cb_arg;
 
-	rc = spdk_lvol_create(lvs, name, sz, thin_provision, clear_method,
-			      _vbdev_lvol_create_cb, req);
+	rc = spdk_lvol_create_ext(lvs, name, sz, thin_provision, clear_method, sub_cluster_sz,
+				  _vbdev_lvol_create_cb, req);
 	if (rc != 0) {
 		free(req);
 	}
@@ -1272,6 +1280,13 @@ vbdev_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_name,
 void
 vbdev_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 			spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
+{
+	vbdev_lvol_create_clone_ext(lvol, clone_name, 0, cb_fn, cb_arg);
+}
+
+void
+vbdev_lvol_create_clone_ext(struct spdk_lvol *lvol, const char *clone_name,
+			    uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol_with_handle_req *req;
 
@@ -1284,7 +1299,7 @@ vbdev_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 	req->cb_fn = cb_fn;
 	req->cb_arg = cb_arg;
 
-	spdk_lvol_create_clone(lvol, clone_name, _vbdev_lvol_create_cb, req);
+	spdk_lvol_create_clone_ext(lvol, clone_name, sub_cluster_sz, _vbdev_lvol_create_cb, req);
 }
 
 static void
@@ -41,12 +41,19 @@ int vbdev_lvol_create(struct spdk_lvol_store *lvs, const char *name, uint64_t sz
 		      bool thin_provisioned, enum lvol_clear_method clear_method,
 		      spdk_lvol_op_with_handle_complete cb_fn,
 		      void *cb_arg);
+int vbdev_lvol_create_ext(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
+			  bool thin_provisioned, enum lvol_clear_method clear_method,
+			  uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn,
+			  void *cb_arg);
 
 void vbdev_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_name,
 				spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
 
 void vbdev_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
 			     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
+void vbdev_lvol_create_clone_ext(struct spdk_lvol *lvol, const char *clone_name,
+				 uint32_t sub_cluster_sz, spdk_lvol_op_with_handle_complete cb_fn,
+				 void *cb_arg);
 void vbdev_lvol_create_bdev_clone(const char *esnap_uuid,
 				  struct spdk_lvol_store *lvs, const char *clone_name,
 				  spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg);
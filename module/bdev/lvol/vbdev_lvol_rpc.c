@@ -288,6 +288,7 @@ struct rpc_bdev_lvol_create {
 	uint64_t size_in_mib;
 	bool thin_provision;
 	char *clear_method;
+	uint32_t sub_cluster_sz;
 };
 
 static void
@@ -306,6 +307,7 @@ static const struct spdk_json_object_decoder rpc_bdev_lvol_create_decoders[] = {
 	{"size_in_mib", offsetof(struct rpc_bdev_lvol_create, size_in_mib), spdk_json_decode_uint64},
 	{"thin_provision", offsetof(struct rpc_bdev_lvol_create, thin_provision), spdk_json_decode_bool, true},
 	{"clear_method", offsetof(struct rpc_bdev_lvol_create, clear_method), spdk_json_decode_string, true},
+	{"sub_cluster_sz", offsetof(struct rpc_bdev_lvol_create, sub_cluster_sz), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -369,8 +371,9 @@ rpc_bdev_lvol_create(struct spdk_jsonrpc_request *request,
 		clear_method = LVOL_CLEAR_WITH_DEFAULT;
 	}
 
-	rc = vbdev_lvol_create(lvs, req.lvol_name, req.size_in_mib * 1024 * 1024,
-			       req.thin_provision, clear_method, rpc_bdev_lvol_create_cb, request);
+	rc = vbdev_lvol_create_ext(lvs, req.lvol_name, req.size_in_mib * 1024 * 1024,
+				   req.thin_provision, clear_method, req.sub_cluster_sz,
+				   rpc_bdev_lvol_create_cb, request);
 	if (rc < 0) {
 		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
 		goto cleanup;
@@ -463,6 +466,7 @@ SPDK_RPC_REGISTER("bdev_lvol_snapshot", rpc_bdev_lvol_snapshot, SPDK_RPC_RUNTIME
 struct rpc_bdev_lvol_clone {
 	char *snapshot_name;
 	char *clone_name;
+	uint32_t sub_cluster_sz;
 };
 
 static void
@@ -475,6 +479,7 @@ free_rpc_bdev_lvol_clone(struct rpc_bdev_lvol_clone *req)
 static const struct spdk_json_object_decoder rpc_bdev_lvol_clone_decoders[] = {
 	{"snapshot_name", offsetof(struct rpc_bdev_lvol_clone, snapshot_name), spdk_json_decode_string},
 	{"clone_name", offsetof(struct rpc_bdev_lvol_clone, clone_name), spdk_json_decode_string, true},
+	{"sub_cluster_sz", offsetof(struct rpc_bdev_lvol_clone, sub_cluster_sz), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -530,7 +535,8 @@ rpc_bdev_lvol_clone(struct spdk_jsonrpc_request *request,
 		goto cleanup;
 	}
 
-	vbdev_lvol_create_clone(lvol, req.clone_name, rpc_bdev_lvol_clone_cb, request);
+	vbdev_lvol_create_clone_ext(lvol, req.clone_name, req.sub_cluster_sz, rpc_bdev_lvol_clone_cb,
+				    request);
 
 cleanup:
 	free_rpc_bdev_lvol_clone(&req);
@@ -809,6 +815,47 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_lvol_decouple_parent", rpc_bdev_lvol_decouple_parent, SPDK_RPC_RUNTIME)
 
+static void
+rpc_bdev_lvol_dedup(struct spdk_jsonrpc_request *request,
+		    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_inflate req = {};
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+
+	SPDK_INFOLOG(lvol_rpc, "Deduplicating lvol\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_inflate_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_inflate_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_lvol_dedup(lvol, rpc_bdev_lvol_inflate_cb, request);
+
+cleanup:
+	free_rpc_bdev_lvol_inflate(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_dedup", rpc_bdev_lvol_dedup, SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_resize {
 	char *name;
 	uint64_t size_in_mib;
@@ -1073,10 +1120,12 @@ static void
 rpc_dump_lvol_store_info(struct spdk_json_write_ctx *w, struct lvol_store_bdev *lvs_bdev)
 {
 	struct spdk_blob_store *bs;
+	struct spdk_bs_dedup_stats dedup_stats;
 	uint64_t cluster_size;
 
 	bs = lvs_bdev->lvs->blobstore;
 	cluster_size = spdk_bs_get_cluster_size(bs);
+	spdk_bs_get_dedup_stats(bs, &dedup_stats);
 
 	spdk_json_write_object_begin(w);
 
@@ -1088,6 +1137,16 @@ rpc_dump_lvol_store_info(struct spdk_json_write_ctx *w, struct lvol_store_bdev *
 	spdk_json_write_named_uint64(w, "block_size", spdk_bs_get_io_unit_size(bs));
 	spdk_json_write_named_uint64(w, "cluster_size", cluster_size);
 
+	spdk_json_write_named_object_begin(w, "dedup");
+	spdk_json_write_named_uint64(w, "clusters_scanned", dedup_stats.clusters_scanned);
+	spdk_json_write_named_uint64(w, "clusters_released", dedup_stats.clusters_released);
+	spdk_json_write_named_uint64(w, "released_bytes",
+				     dedup_stats.clusters_released * cluster_size);
+	spdk_json_write_named_uint64(w, "io_freeze_count", dedup_stats.io_freeze_count);
+	spdk_json_write_named_uint64(w, "io_freeze_total_us", dedup_stats.io_freeze_total_us);
+	spdk_json_write_named_uint64(w, "io_freeze_max_us", dedup_stats.io_freeze_max_us);
+	spdk_json_write_object_end(w);
+
 	spdk_json_write_object_end(w);
 }
 
@@ -13,6 +13,7 @@
 #include "spdk/config.h"
 #include "spdk/endian.h"
 #include "spdk/bdev.h"
+#include "spdk/histogram_data.h"
 #include "spdk/json.h"
 #include "spdk/keyring.h"
 #include "spdk/likely.h"
@@ -78,6 +79,11 @@
 
 #define SPDK_CONTROLLER_NAME_MAX 512
 
+/* Number of read latencies the hedging threshold is computed from. */
+#define BDEV_NVME_HEDGE_NUM_SAMPLES	1024
+/* 16 buckets per power of two, i.e. a resolution of about 6% for the threshold. */
+#define BDEV_NVME_HEDGE_BUCKET_SHIFT	4
+
 static int bdev_nvme_config_json(struct spdk_json_write_ctx *w);
 
 struct nvme_bdev_io {
@@ -139,6 +145,33 @@ struct nvme_bdev_io {
 
 	/* Used to put nvme_bdev_io into the list */
 	TAILQ_ENTRY(nvme_bdev_io) retry_link;
+
+	/* Hedging state of a read, see enum nvme_bdev_hedge_state. */
+	uint8_t hedge_state;
+
+	/* Duplicate of this read issued on another I/O path. */
+	struct nvme_bdev_hedge *hedge;
+
+	/* Used to put nvme_bdev_io into the list of reads which may be hedged */
+	TAILQ_ENTRY(nvme_bdev_io) hedge_link;
+};
+
+enum nvme_bdev_hedge_state {
+	NVME_BDEV_HEDGE_NONE = 0,
+	/* The read is in hedge_io_list of its channel. */
+	NVME_BDEV_HEDGE_TRACKED,
+	/* A duplicate of the read is outstanding. */
+	NVME_BDEV_HEDGE_ISSUED,
+	/* The duplicate completed first, the original read is being aborted. */
+	NVME_BDEV_HEDGE_WON,
+};
+
+struct nvme_bdev_hedge {
+	/* Read this is a duplicate of, NULL once the read completed. */
+	struct nvme_bdev_io		*bio;
+	struct nvme_io_path		*io_path;
+	void				*buf;
+	size_t				len;
 };
 
 struct nvme_probe_skip_entry {
@@ -931,22 +964,79 @@ _bdev_nvme_delete_io_paths(struct nvme_bdev_channel *nbdev_ch)
 	}
 }
 
+static int bdev_nvme_hedge_poll(void *arg);
+
+static void
+bdev_nvme_disable_hedging(struct nvme_bdev_channel *nbdev_ch)
+{
+	struct nvme_bdev_io *bio;
+
+	/* Reads whose duplicate is outstanding are not tracked anymore and complete as usual. */
+	while ((bio = TAILQ_FIRST(&nbdev_ch->hedge_io_list)) != NULL) {
+		TAILQ_REMOVE(&nbdev_ch->hedge_io_list, bio, hedge_link);
+		bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+	}
+
+	spdk_poller_unregister(&nbdev_ch->hedge_poller);
+	spdk_histogram_data_free(nbdev_ch->hedge_histogram);
+	nbdev_ch->hedge_histogram = NULL;
+	nbdev_ch->hedge_percentile = 0;
+}
+
+static int
+bdev_nvme_enable_hedging(struct nvme_bdev_channel *nbdev_ch, uint32_t percentile,
+			 uint64_t min_delay_us)
+{
+	bdev_nvme_disable_hedging(nbdev_ch);
+
+	if (percentile == 0) {
+		return 0;
+	}
+
+	nbdev_ch->hedge_histogram = spdk_histogram_data_alloc_sized(BDEV_NVME_HEDGE_BUCKET_SHIFT);
+	if (nbdev_ch->hedge_histogram == NULL) {
+		return -ENOMEM;
+	}
+
+	/* Check for slow reads twice per minimum delay. */
+	nbdev_ch->hedge_poller = SPDK_POLLER_REGISTER(bdev_nvme_hedge_poll, nbdev_ch,
+				 min_delay_us / 2);
+	if (nbdev_ch->hedge_poller == NULL) {
+		spdk_histogram_data_free(nbdev_ch->hedge_histogram);
+		nbdev_ch->hedge_histogram = NULL;
+		return -ENOMEM;
+	}
+
+	nbdev_ch->hedge_percentile = percentile;
+	nbdev_ch->hedge_min_delay_ticks = min_delay_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	/* Do not hedge until the first threshold is computed. */
+	nbdev_ch->hedge_threshold_ticks = UINT64_MAX;
+	nbdev_ch->hedge_num_samples = 0;
+
+	return 0;
+}
+
 static int
 bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 {
 	struct nvme_bdev_channel *nbdev_ch = ctx_buf;
 	struct nvme_bdev *nbdev = io_device;
 	struct nvme_ns *nvme_ns;
+	uint32_t hedge_percentile;
+	uint64_t hedge_min_delay_us;
 	int rc;
 
 	STAILQ_INIT(&nbdev_ch->io_path_list);
 	TAILQ_INIT(&nbdev_ch->retry_io_list);
+	TAILQ_INIT(&nbdev_ch->hedge_io_list);
 
 	pthread_mutex_lock(&nbdev->mutex);
 
 	nbdev_ch->mp_policy = nbdev->mp_policy;
 	nbdev_ch->mp_selector = nbdev->mp_selector;
 	nbdev_ch->rr_min_io = nbdev->rr_min_io;
+	hedge_percentile = nbdev->hedge_percentile;
+	hedge_min_delay_us = nbdev->hedge_min_delay_us;
 
 	TAILQ_FOREACH(nvme_ns, &nbdev->nvme_ns_list, tailq) {
 		rc = _bdev_nvme_add_io_path(nbdev_ch, nvme_ns);
@@ -959,6 +1049,12 @@ bdev_nvme_create_bdev_channel_cb(void *io_device, void *ctx_buf)
 	}
 	pthread_mutex_unlock(&nbdev->mutex);
 
+	rc = bdev_nvme_enable_hedging(nbdev_ch, hedge_percentile, hedge_min_delay_us);
+	if (rc != 0) {
+		_bdev_nvme_delete_io_paths(nbdev_ch);
+		return rc;
+	}
+
 	return 0;
 }
 
@@ -986,6 +1082,7 @@ bdev_nvme_destroy_bdev_channel_cb(void *io_device, void *ctx_buf)
 	struct nvme_bdev_channel *nbdev_ch = ctx_buf;
 
 	bdev_nvme_abort_retry_ios(nbdev_ch);
+	bdev_nvme_disable_hedging(nbdev_ch);
 	_bdev_nvme_delete_io_paths(nbdev_ch);
 }
 
@@ -1657,6 +1754,236 @@ bdev_nvme_admin_complete(struct nvme_bdev_io *bio, int rc)
 	__bdev_nvme_io_complete(bdev_io, io_status, NULL);
 }
 
+struct bdev_nvme_hedge_threshold_ctx {
+	uint32_t	percentile;
+	uint64_t	threshold;
+};
+
+static void
+bdev_nvme_hedge_threshold_cb(void *_ctx, uint64_t start, uint64_t end, uint64_t count,
+			     uint64_t total, uint64_t so_far)
+{
+	struct bdev_nvme_hedge_threshold_ctx *ctx = _ctx;
+
+	if (count != 0 && ctx->threshold == UINT64_MAX && so_far * 100 >= total * ctx->percentile) {
+		ctx->threshold = end;
+	}
+}
+
+static void
+bdev_nvme_hedge_add_sample(struct nvme_bdev_channel *nbdev_ch, uint64_t tsc_diff)
+{
+	struct bdev_nvme_hedge_threshold_ctx ctx = {
+		.percentile = nbdev_ch->hedge_percentile,
+		.threshold = UINT64_MAX,
+	};
+
+	spdk_histogram_data_tally(nbdev_ch->hedge_histogram, tsc_diff);
+	if (++nbdev_ch->hedge_num_samples < BDEV_NVME_HEDGE_NUM_SAMPLES) {
+		return;
+	}
+
+	spdk_histogram_data_iterate(nbdev_ch->hedge_histogram, bdev_nvme_hedge_threshold_cb, &ctx);
+	nbdev_ch->hedge_threshold_ticks = spdk_max(ctx.threshold, nbdev_ch->hedge_min_delay_ticks);
+
+	spdk_histogram_data_reset(nbdev_ch->hedge_histogram);
+	nbdev_ch->hedge_num_samples = 0;
+}
+
+static void
+bdev_nvme_hedge_abort_done(void *ref, const struct spdk_nvme_cpl *cpl)
+{
+	/* The aborted command completes on its own, nothing to do here. */
+}
+
+static void
+bdev_nvme_hedge_abort(struct nvme_io_path *io_path, void *cmd_cb_arg)
+{
+	if (io_path->qpair->qpair == NULL) {
+		return;
+	}
+
+	/* The abort is best effort, the command may have completed already. */
+	spdk_nvme_ctrlr_cmd_abort_ext(io_path->qpair->ctrlr->ctrlr, io_path->qpair->qpair,
+				      cmd_cb_arg, bdev_nvme_hedge_abort_done, NULL);
+}
+
+static inline void
+bdev_nvme_hedge_track(struct nvme_bdev_io *bio)
+{
+	struct nvme_bdev_channel *nbdev_ch = bio->io_path->nbdev_ch;
+
+	if (spdk_likely(nbdev_ch->hedge_percentile == 0)) {
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&nbdev_ch->hedge_io_list, bio, hedge_link);
+	bio->hedge_state = NVME_BDEV_HEDGE_TRACKED;
+}
+
+/* Called when the original read completes. Return true if the completion was consumed. */
+static bool
+bdev_nvme_hedge_read_done(struct nvme_bdev_io *bio, const struct spdk_nvme_cpl *cpl)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	struct nvme_bdev_channel *nbdev_ch;
+	struct nvme_bdev_hedge *hedge;
+
+	switch (bio->hedge_state) {
+	case NVME_BDEV_HEDGE_TRACKED:
+		nbdev_ch = spdk_io_channel_get_ctx(spdk_bdev_io_get_io_channel(bdev_io));
+		TAILQ_REMOVE(&nbdev_ch->hedge_io_list, bio, hedge_link);
+		bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+
+		if (spdk_nvme_cpl_is_success(cpl)) {
+			bdev_nvme_hedge_add_sample(nbdev_ch, spdk_get_ticks() - bio->submit_tsc);
+		}
+		return false;
+	case NVME_BDEV_HEDGE_ISSUED:
+		/* The original read won, its duplicate writes only to its own buffer. */
+		hedge = bio->hedge;
+		hedge->bio = NULL;
+		bio->hedge = NULL;
+		bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+
+		bdev_nvme_hedge_abort(hedge->io_path, hedge);
+		return false;
+	case NVME_BDEV_HEDGE_WON:
+		/* The buffers of the read are not written anymore, complete it with the status
+		 * of its duplicate.
+		 */
+		bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+
+		bdev_nvme_io_complete_nvme_status(bio, &bio->cpl);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void
+bdev_nvme_hedge_done(void *ref, const struct spdk_nvme_cpl *cpl)
+{
+	struct nvme_bdev_hedge *hedge = ref;
+	struct nvme_bdev_io *bio = hedge->bio;
+
+	if (bio != NULL) {
+		assert(bio->hedge_state == NVME_BDEV_HEDGE_ISSUED);
+		bio->hedge = NULL;
+
+		if (spdk_nvme_cpl_is_success(cpl)) {
+			spdk_copy_buf_to_iovs(bio->iovs, bio->iovcnt, hedge->buf, hedge->len);
+			bio->cpl = *cpl;
+			bio->hedge_state = NVME_BDEV_HEDGE_WON;
+			hedge->io_path->hedge_won++;
+
+			bdev_nvme_hedge_abort(bio->io_path, bio);
+		} else {
+			/* Keep waiting for the original read. */
+			bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+		}
+	}
+
+	spdk_free(hedge->buf);
+	free(hedge);
+}
+
+static struct nvme_io_path *
+bdev_nvme_find_hedge_io_path(struct nvme_bdev_channel *nbdev_ch, struct nvme_io_path *slow_path)
+{
+	struct nvme_io_path *io_path, *hedge_path = NULL;
+	uint32_t num_outstanding_reqs, min_qd = UINT32_MAX;
+
+	STAILQ_FOREACH(io_path, &nbdev_ch->io_path_list, stailq) {
+		if (io_path == slow_path || !nvme_io_path_is_available(io_path) ||
+		    io_path->nvme_ns->ana_state != SPDK_NVME_ANA_OPTIMIZED_STATE) {
+			continue;
+		}
+
+		num_outstanding_reqs = spdk_nvme_qpair_get_num_outstanding_reqs(io_path->qpair->qpair);
+		if (num_outstanding_reqs < min_qd) {
+			min_qd = num_outstanding_reqs;
+			hedge_path = io_path;
+		}
+	}
+
+	return hedge_path;
+}
+
+static int
+bdev_nvme_hedge_read(struct nvme_bdev_channel *nbdev_ch, struct nvme_bdev_io *bio)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	struct nvme_io_path *io_path;
+	struct nvme_bdev_hedge *hedge;
+	int rc;
+
+	io_path = bdev_nvme_find_hedge_io_path(nbdev_ch, bio->io_path);
+	if (io_path == NULL) {
+		return -ENODEV;
+	}
+
+	hedge = calloc(1, sizeof(*hedge));
+	if (hedge == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The duplicate reads into its own buffer, so that a late completion of the loser
+	 * never touches the buffers of a completed bdev_io.
+	 */
+	hedge->len = bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen;
+	hedge->buf = spdk_malloc(hedge->len, 0x1000, NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (hedge->buf == NULL) {
+		free(hedge);
+		return -ENOMEM;
+	}
+
+	hedge->bio = bio;
+	hedge->io_path = io_path;
+
+	rc = spdk_nvme_ns_cmd_read_with_md(io_path->nvme_ns->ns, io_path->qpair->qpair, hedge->buf,
+					   NULL, bdev_io->u.bdev.offset_blocks,
+					   bdev_io->u.bdev.num_blocks, bdev_nvme_hedge_done, hedge,
+					   bdev_io->u.bdev.dif_check_flags, 0, 0);
+	if (rc != 0) {
+		spdk_free(hedge->buf);
+		free(hedge);
+		return rc;
+	}
+
+	bio->hedge = hedge;
+	bio->hedge_state = NVME_BDEV_HEDGE_ISSUED;
+	bio->io_path->hedge_triggered++;
+	io_path->hedge_issued++;
+
+	return 0;
+}
+
+static int
+bdev_nvme_hedge_poll(void *arg)
+{
+	struct nvme_bdev_channel *nbdev_ch = arg;
+	struct nvme_bdev_io *bio;
+	uint64_t now = spdk_get_ticks();
+	int num_hedged = 0;
+
+	while ((bio = TAILQ_FIRST(&nbdev_ch->hedge_io_list)) != NULL) {
+		if (now - bio->submit_tsc < nbdev_ch->hedge_threshold_ticks) {
+			break;
+		}
+
+		/* A read is hedged at most once. */
+		TAILQ_REMOVE(&nbdev_ch->hedge_io_list, bio, hedge_link);
+		bio->hedge_state = NVME_BDEV_HEDGE_NONE;
+
+		if (bdev_nvme_hedge_read(nbdev_ch, bio) == 0) {
+			num_hedged++;
+		}
+	}
+
+	return num_hedged > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 bdev_nvme_clear_io_path_caches_done(struct nvme_ctrlr *nvme_ctrlr,
 				    void *ctx, int status)
@@ -4141,6 +4468,10 @@ bdev_nvme_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 			spdk_json_write_named_uint32(w, "rr_min_io", nvme_bdev->rr_min_io);
 		}
 	}
+	if (nvme_bdev->hedge_percentile != 0) {
+		spdk_json_write_named_uint32(w, "hedge_percentile", nvme_bdev->hedge_percentile);
+		spdk_json_write_named_uint64(w, "hedge_min_delay_us", nvme_bdev->hedge_min_delay_us);
+	}
 	pthread_mutex_unlock(&nvme_bdev->mutex);
 
 	return 0;
@@ -5558,6 +5889,101 @@ exit:
 	cb_fn(cb_arg, rc);
 }
 
+struct bdev_nvme_set_hedged_reads_ctx {
+	struct spdk_bdev_desc *desc;
+	uint32_t percentile;
+	uint64_t min_delay_us;
+	bdev_nvme_set_hedged_reads_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+bdev_nvme_set_hedged_reads_done(struct nvme_bdev *nbdev, void *_ctx, int status)
+{
+	struct bdev_nvme_set_hedged_reads_ctx *ctx = _ctx;
+
+	spdk_bdev_close(ctx->desc);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+
+	free(ctx);
+}
+
+static void
+_bdev_nvme_set_hedged_reads(struct nvme_bdev_channel_iter *i,
+			    struct nvme_bdev *nbdev,
+			    struct nvme_bdev_channel *nbdev_ch, void *_ctx)
+{
+	struct bdev_nvme_set_hedged_reads_ctx *ctx = _ctx;
+	int rc;
+
+	rc = bdev_nvme_enable_hedging(nbdev_ch, ctx->percentile, ctx->min_delay_us);
+
+	nvme_bdev_for_each_channel_continue(i, rc);
+}
+
+void
+bdev_nvme_set_hedged_reads(const char *name, uint32_t percentile, uint64_t min_delay_us,
+			   bdev_nvme_set_hedged_reads_cb cb_fn, void *cb_arg)
+{
+	struct bdev_nvme_set_hedged_reads_ctx *ctx;
+	struct spdk_bdev *bdev;
+	struct nvme_bdev *nbdev;
+	int rc;
+
+	assert(cb_fn != NULL);
+
+	if (percentile > 99) {
+		rc = -EINVAL;
+		goto exit;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("Failed to alloc context.\n");
+		rc = -ENOMEM;
+		goto exit;
+	}
+
+	ctx->percentile = percentile;
+	ctx->min_delay_us = min_delay_us;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	rc = spdk_bdev_open_ext(name, false, dummy_bdev_event_cb, NULL, &ctx->desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev %s.\n", name);
+		rc = -ENODEV;
+		goto err_open;
+	}
+
+	bdev = spdk_bdev_desc_get_bdev(ctx->desc);
+	if (bdev->module != &nvme_if) {
+		SPDK_ERRLOG("bdev %s is not registered in this module.\n", name);
+		rc = -ENODEV;
+		goto err_module;
+	}
+	nbdev = SPDK_CONTAINEROF(bdev, struct nvme_bdev, disk);
+
+	pthread_mutex_lock(&nbdev->mutex);
+	nbdev->hedge_percentile = percentile;
+	nbdev->hedge_min_delay_us = min_delay_us;
+	pthread_mutex_unlock(&nbdev->mutex);
+
+	nvme_bdev_for_each_channel(nbdev,
+				   _bdev_nvme_set_hedged_reads,
+				   ctx,
+				   bdev_nvme_set_hedged_reads_done);
+	return;
+
+err_module:
+	spdk_bdev_close(ctx->desc);
+err_open:
+	free(ctx);
+exit:
+	cb_fn(cb_arg, rc);
+}
+
 static void
 aer_cb(void *arg, const struct spdk_nvme_cpl *cpl)
 {
@@ -7862,6 +8288,12 @@ bdev_nvme_readv_done(void *ref, const struct spdk_nvme_cpl *cpl)
 	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
 	int ret;
 
+	if (spdk_unlikely(bio->hedge_state != NVME_BDEV_HEDGE_NONE)) {
+		if (bdev_nvme_hedge_read_done(bio, cpl)) {
+			return;
+		}
+	}
+
 	if (spdk_unlikely(spdk_nvme_cpl_is_pi_error(cpl))) {
 		SPDK_ERRLOG("readv completed with PI error (sct=%d, sc=%d)\n",
 			    cpl->status.sct, cpl->status.sc);
@@ -8314,7 +8746,12 @@ bdev_nvme_readv(struct nvme_bdev_io *bio, struct iovec *iov, int iovcnt,
 						    bdev_nvme_queued_next_sge, md, 0, 0);
 	}
 
-	if (spdk_unlikely(rc != 0 && rc != -ENOMEM)) {
+	if (spdk_likely(rc == 0)) {
+		/* Duplicates are plain reads into a bounce buffer. */
+		if (domain == NULL && seq == NULL && md == NULL) {
+			bdev_nvme_hedge_track(bio);
+		}
+	} else if (rc != -ENOMEM) {
 		SPDK_ERRLOG("readv failed: rc = %d\n", rc);
 	}
 	return rc;
@@ -9363,6 +9800,12 @@ nvme_io_path_info_json(struct spdk_json_write_ctx *w, struct nvme_io_path *io_pa
 	}
 	spdk_json_write_object_end(w);
 
+	spdk_json_write_named_object_begin(w, "hedged_reads");
+	spdk_json_write_named_uint64(w, "triggered", io_path->hedge_triggered);
+	spdk_json_write_named_uint64(w, "issued", io_path->hedge_issued);
+	spdk_json_write_named_uint64(w, "won", io_path->hedge_won);
+	spdk_json_write_object_end(w);
+
 	spdk_json_write_object_end(w);
 }
 
@@ -167,6 +167,8 @@ struct nvme_bdev {
 	enum spdk_bdev_nvme_multipath_policy	mp_policy;
 	enum spdk_bdev_nvme_multipath_selector	mp_selector;
 	uint32_t				rr_min_io;
+	uint32_t				hedge_percentile;
+	uint64_t				hedge_min_delay_us;
 	TAILQ_HEAD(, nvme_ns)			nvme_ns_list;
 	bool					opal;
 	TAILQ_ENTRY(nvme_bdev)			tailq;
@@ -203,6 +205,13 @@ struct nvme_io_path {
 
 	/* allocation of stat is decided by option io_path_stat of RPC bdev_nvme_set_options */
 	struct spdk_bdev_io_stat	*stat;
+
+	/* Hedged reads: reads on this path that were duplicated because they were slow,
+	 * duplicates issued on this path, and duplicates that completed before the original.
+	 */
+	uint64_t			hedge_triggered;
+	uint64_t			hedge_issued;
+	uint64_t			hedge_won;
 };
 
 struct nvme_bdev_channel {
@@ -215,6 +224,16 @@ struct nvme_bdev_channel {
 	TAILQ_HEAD(retry_io_head, nvme_bdev_io)	retry_io_list;
 	struct spdk_poller			*retry_io_poller;
 	bool					resetting;
+
+	/* Hedged reads are enabled if hedge_percentile is not 0. */
+	uint32_t				hedge_percentile;
+	uint32_t				hedge_num_samples;
+	uint64_t				hedge_min_delay_ticks;
+	uint64_t				hedge_threshold_ticks;
+	struct spdk_histogram_data		*hedge_histogram;
+	/* Reads which may be hedged, oldest first. */
+	TAILQ_HEAD(, nvme_bdev_io)		hedge_io_list;
+	struct spdk_poller			*hedge_poller;
 };
 
 struct nvme_poll_group {
@@ -375,4 +394,24 @@ typedef void (*bdev_nvme_set_preferred_path_cb)(void *cb_arg, int rc);
 void bdev_nvme_set_preferred_path(const char *name, uint16_t cntlid,
 				  bdev_nvme_set_preferred_path_cb cb_fn, void *cb_arg);
 
+typedef void (*bdev_nvme_set_hedged_reads_cb)(void *cb_arg, int rc);
+
+/**
+ * Enable or disable hedged reads for an NVMe bdev in multipath mode.
+ *
+ * A read which has not completed within the given percentile of the recent read latencies
+ * of its channel, and not earlier than min_delay_us, is duplicated on another optimized I/O
+ * path. Whichever completes first completes the read and the other one is aborted. If the
+ * duplicate wins, its data is copied into the buffers of the read, which is completed only
+ * after the original command has been aborted or has completed.
+ *
+ * \param name NVMe bdev name
+ * \param percentile Latency percentile (1-99) above which reads are hedged, 0 to disable.
+ * \param min_delay_us Minimum time a read is outstanding before it is hedged.
+ * \param cb_fn Function to be called back after completion.
+ * \param cb_arg Argument for callback function.
+ */
+void bdev_nvme_set_hedged_reads(const char *name, uint32_t percentile, uint64_t min_delay_us,
+				bdev_nvme_set_hedged_reads_cb cb_fn, void *cb_arg);
+
 #endif /* SPDK_BDEV_NVME_H */
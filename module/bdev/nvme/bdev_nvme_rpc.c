@@ -2408,6 +2408,80 @@ cleanup:
 SPDK_RPC_REGISTER("bdev_nvme_set_multipath_policy", rpc_bdev_nvme_set_multipath_policy,
 		  SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_nvme_set_hedged_reads {
+	char *name;
+	uint32_t percentile;
+	uint64_t min_delay_us;
+};
+
+static void
+free_rpc_bdev_nvme_set_hedged_reads(struct rpc_bdev_nvme_set_hedged_reads *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_nvme_set_hedged_reads_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_nvme_set_hedged_reads, name), spdk_json_decode_string},
+	{"percentile", offsetof(struct rpc_bdev_nvme_set_hedged_reads, percentile), spdk_json_decode_uint32},
+	{"min_delay_us", offsetof(struct rpc_bdev_nvme_set_hedged_reads, min_delay_us), spdk_json_decode_uint64, true},
+};
+
+struct rpc_bdev_nvme_set_hedged_reads_ctx {
+	struct rpc_bdev_nvme_set_hedged_reads req;
+	struct spdk_jsonrpc_request *request;
+};
+
+static void
+rpc_bdev_nvme_set_hedged_reads_done(void *cb_arg, int rc)
+{
+	struct rpc_bdev_nvme_set_hedged_reads_ctx *ctx = cb_arg;
+
+	if (rc == 0) {
+		spdk_jsonrpc_send_bool_response(ctx->request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(ctx->request, rc, spdk_strerror(-rc));
+	}
+
+	free_rpc_bdev_nvme_set_hedged_reads(&ctx->req);
+	free(ctx);
+}
+
+static void
+rpc_bdev_nvme_set_hedged_reads(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_nvme_set_hedged_reads_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	ctx->req.min_delay_us = 100;
+
+	if (spdk_json_decode_object(params, rpc_bdev_nvme_set_hedged_reads_decoders,
+				    SPDK_COUNTOF(rpc_bdev_nvme_set_hedged_reads_decoders),
+				    &ctx->req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	ctx->request = request;
+
+	bdev_nvme_set_hedged_reads(ctx->req.name, ctx->req.percentile, ctx->req.min_delay_us,
+				   rpc_bdev_nvme_set_hedged_reads_done, ctx);
+	return;
+
+cleanup:
+	free_rpc_bdev_nvme_set_hedged_reads(&ctx->req);
+	free(ctx);
+}
+SPDK_RPC_REGISTER("bdev_nvme_set_hedged_reads", rpc_bdev_nvme_set_hedged_reads,
+		  SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_nvme_start_mdns_discovery {
 	char *name;
 	char *svcname;
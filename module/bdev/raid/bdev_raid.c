@@ -21,6 +21,10 @@
 #define RAID_BDEV_PROCESS_WINDOW_SIZE_KB_DEFAULT	1024
 #define RAID_BDEV_PROCESS_MAX_BANDWIDTH_MB_SEC_DEFAULT	0
 
+#define RAID_BDEV_BITMAP_CLEAR_PERIOD_US	(5 * SPDK_SEC_TO_USEC)
+#define RAID_BDEV_BITMAP_WRITE_RETRIES	3
+#define RAID_BDEV_BITMAP_RETRY_DELAY_US	1000
+
 static bool g_shutdown_started = false;
 
 /* List of all raid bdevs */
@@ -75,7 +79,10 @@ struct raid_bdev_process {
 	uint64_t			window_remaining;
 	int				window_status;
 	uint64_t			window_offset;
+	uint64_t			window_lock_size;
+	uint64_t			window_skipped;
 	bool				window_range_locked;
+	bool				bitmap_resync;
 	struct raid_base_bdev_info	*target;
 	int				status;
 	TAILQ_HEAD(, raid_process_finish_action) finish_actions;
@@ -393,6 +400,7 @@ raid_bdev_cleanup(struct raid_bdev *raid_bdev)
 static void
 raid_bdev_free(struct raid_bdev *raid_bdev)
 {
+	raid_bdev_free_bitmap(raid_bdev);
 	raid_bdev_free_superblock(raid_bdev);
 	free(raid_bdev->base_bdev_info);
 	free(raid_bdev->bdev.name);
@@ -440,6 +448,8 @@ raid_bdev_free_base_bdev_resource(struct raid_base_bdev_info *base_info)
 		spdk_uuid_set_null(&base_info->uuid);
 	}
 	base_info->is_failed = false;
+	base_info->bitmap_resync = false;
+	base_info->bitmap_write_failed = false;
 
 	/* clear `data_offset` to allow it to be recalculated during configuration */
 	base_info->data_offset = 0;
@@ -507,6 +517,11 @@ _raid_bdev_destruct(void *ctxt)
 		raid_bdev->state = RAID_BDEV_STATE_OFFLINE;
 	}
 
+	if (raid_bdev->bitmap != NULL) {
+		spdk_poller_unregister(&raid_bdev->bitmap->clear_poller);
+		spdk_poller_unregister(&raid_bdev->bitmap->retry_poller);
+	}
+
 	if (raid_bdev->module->stop != NULL) {
 		if (raid_bdev->module->stop(raid_bdev) == false) {
 			return;
@@ -602,6 +617,8 @@ raid_bdev_verify_dix_reftag(struct iovec *iovs, int iovcnt, void *md_buf,
 	return rc;
 }
 
+static void raid_bdev_bitmap_end_write(struct raid_bdev_io *raid_io);
+
 void
 raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
 {
@@ -649,6 +666,10 @@ raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status sta
 		}
 	}
 
+	if (raid_io->bitmap_marked) {
+		raid_bdev_bitmap_end_write(raid_io);
+	}
+
 	if (spdk_unlikely(raid_io->completion_cb != NULL)) {
 		raid_io->completion_cb(raid_io, status);
 	} else {
@@ -869,6 +890,393 @@ raid_bdev_submit_rw_request(struct raid_bdev_io *raid_io)
 	raid_io->raid_bdev->module->submit_rw_request(raid_io);
 }
 
+static inline bool
+raid_bdev_bitmap_test(const uint8_t *bits, uint64_t region)
+{
+	return __atomic_load_n(&bits[region / 8], __ATOMIC_SEQ_CST) & (1u << (region % 8));
+}
+
+static inline void
+raid_bdev_bitmap_set_persisted(struct raid_bdev_bitmap *bitmap, uint64_t region, bool set)
+{
+	uint8_t mask = 1u << (region % 8);
+
+	if (set) {
+		__atomic_fetch_or(&bitmap->persisted_bits[region / 8], mask, __ATOMIC_SEQ_CST);
+	} else {
+		__atomic_fetch_and(&bitmap->persisted_bits[region / 8], (uint8_t)~mask, __ATOMIC_SEQ_CST);
+	}
+}
+
+static inline bool
+raid_bdev_bitmap_get_regions(struct raid_bdev_bitmap *bitmap, uint64_t offset_blocks,
+			     uint64_t num_blocks, uint64_t *first, uint64_t *last)
+{
+	*first = offset_blocks >> bitmap->region_shift;
+	if (*first >= bitmap->num_regions) {
+		/* Not tracked, the raid bdev has grown since the bitmap was created */
+		*last = 0;
+		return false;
+	}
+	*last = spdk_min((offset_blocks + num_blocks - 1) >> bitmap->region_shift,
+			 bitmap->num_regions - 1);
+
+	return true;
+}
+
+static void
+raid_bdev_bitmap_update(struct raid_bdev_bitmap *bitmap, uint64_t region, bool set)
+{
+	uint64_t block = region / 8 / bitmap->block_size;
+	uint8_t mask = 1u << (region % 8);
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (set) {
+		__atomic_fetch_or(&bitmap->bits[region / 8], mask, __ATOMIC_SEQ_CST);
+	} else {
+		__atomic_fetch_and(&bitmap->bits[region / 8], (uint8_t)~mask, __ATOMIC_SEQ_CST);
+	}
+
+	bitmap->dirty_start = spdk_min(bitmap->dirty_start, block);
+	bitmap->dirty_end = spdk_max(bitmap->dirty_end, block + 1);
+}
+
+/*
+ * Returns the number of blocks, starting at offset_blocks, which belong to regions not
+ * marked in the bitmap. Blocks not tracked by the bitmap are always treated as marked.
+ */
+static uint64_t
+raid_bdev_bitmap_clean_blocks(struct raid_bdev_bitmap *bitmap, uint64_t offset_blocks,
+			      uint64_t num_blocks)
+{
+	uint64_t region = offset_blocks >> bitmap->region_shift;
+	uint64_t end;
+
+	while (region < bitmap->num_regions && !raid_bdev_bitmap_test(bitmap->bits, region)) {
+		region++;
+	}
+
+	end = region << bitmap->region_shift;
+	if (end <= offset_blocks) {
+		return 0;
+	}
+
+	return spdk_min(end - offset_blocks, num_blocks);
+}
+
+static void
+raid_bdev_bitmap_resume_write(void *ctx)
+{
+	struct raid_bdev_io *raid_io = ctx;
+
+	raid_bdev_submit_rw_request(raid_io);
+}
+
+static void
+raid_bdev_bitmap_fail_write(void *ctx)
+{
+	struct raid_bdev_io *raid_io = ctx;
+
+	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid_bdev_bitmap_fail_ios(struct raid_bdev_bitmap *bitmap)
+{
+	struct raid_bdev_io *raid_io;
+
+	TAILQ_CONCAT(&bitmap->writing_ios, &bitmap->waiting_ios, bitmap_link);
+
+	while ((raid_io = TAILQ_FIRST(&bitmap->writing_ios)) != NULL) {
+		TAILQ_REMOVE(&bitmap->writing_ios, raid_io, bitmap_link);
+		spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(raid_io->raid_ch)),
+				     raid_bdev_bitmap_fail_write, raid_io);
+	}
+}
+
+static void raid_bdev_bitmap_write(struct raid_bdev *raid_bdev);
+
+static int
+raid_bdev_bitmap_retry_write(void *arg)
+{
+	struct raid_bdev *raid_bdev = arg;
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+
+	spdk_poller_unregister(&bitmap->retry_poller);
+	bitmap->write_in_progress = false;
+	raid_bdev_bitmap_write(raid_bdev);
+
+	return SPDK_POLLER_BUSY;
+}
+
+/*
+ * Handle a failed write of the bitmap. Returns true if the bits are persisted on all the base
+ * bdevs left in the array, after the base bdevs the write failed on have been failed.
+ */
+static bool
+raid_bdev_bitmap_write_failed(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_base_bdev_info *base_info;
+	uint8_t num_written = 0, num_failed = 0;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->bitmap_write_failed) {
+			num_failed++;
+		} else if (base_info->is_configured && !base_info->remove_scheduled &&
+			   !base_info->is_failed) {
+			num_written++;
+		}
+	}
+
+	if (num_failed > 0 && num_written > 0 &&
+	    num_written >= raid_bdev->min_base_bdevs_operational) {
+		/* Keep the array running on the base bdevs that have the bits */
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->bitmap_write_failed) {
+				base_info->bitmap_write_failed = false;
+				raid_bdev_fail_base_bdev(base_info);
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * The bits may not be on the base bdevs, so the writes waiting for them can't be
+	 * submitted. Write the whole bitmap again.
+	 */
+	bitmap->dirty_start = 0;
+	bitmap->dirty_end = bitmap->num_blocks;
+
+	if (num_failed > 0) {
+		/* Too few base bdevs have the bits for the array to keep working */
+		bitmap->failed = true;
+		raid_bdev_bitmap_fail_ios(bitmap);
+		raid_bdev_deconfigure(raid_bdev, NULL, NULL);
+		return false;
+	}
+
+	/* Not caused by a base bdev, e.g. out of memory. Retry later, with an increasing delay. */
+	if (++bitmap->write_errors <= RAID_BDEV_BITMAP_WRITE_RETRIES) {
+		bitmap->write_in_progress = true;
+		bitmap->retry_poller = SPDK_POLLER_REGISTER(raid_bdev_bitmap_retry_write, raid_bdev,
+				       RAID_BDEV_BITMAP_RETRY_DELAY_US << (bitmap->write_errors - 1));
+		return false;
+	}
+
+	/* Fail the waiting writes, the next writes try again */
+	bitmap->write_errors = 0;
+	raid_bdev_bitmap_fail_ios(bitmap);
+	return false;
+}
+
+static void
+raid_bdev_bitmap_write_done(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_bdev_io *raid_io;
+
+	bitmap->write_in_progress = false;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write raid bdev %s write-intent bitmap: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+
+		if (!raid_bdev_bitmap_write_failed(raid_bdev)) {
+			return;
+		}
+	}
+
+	bitmap->write_errors = 0;
+
+	while ((raid_io = TAILQ_FIRST(&bitmap->writing_ios)) != NULL) {
+		uint64_t region, first, last;
+
+		if (raid_bdev_bitmap_get_regions(bitmap, raid_io->offset_blocks, raid_io->num_blocks,
+						 &first, &last)) {
+			for (region = first; region <= last; region++) {
+				raid_bdev_bitmap_set_persisted(bitmap, region, true);
+			}
+		}
+
+		TAILQ_REMOVE(&bitmap->writing_ios, raid_io, bitmap_link);
+		spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(raid_io->raid_ch)),
+				     raid_bdev_bitmap_resume_write, raid_io);
+	}
+
+	if (!TAILQ_EMPTY(&bitmap->waiting_ios)) {
+		raid_bdev_bitmap_write(raid_bdev);
+	}
+}
+
+static void
+raid_bdev_bitmap_write(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+
+	assert(bitmap->write_in_progress == false);
+
+	TAILQ_CONCAT(&bitmap->writing_ios, &bitmap->waiting_ios, bitmap_link);
+
+	if (bitmap->dirty_start >= bitmap->dirty_end) {
+		/* The bits are already persisted */
+		raid_bdev_bitmap_write_done(0, raid_bdev, NULL);
+		return;
+	}
+
+	bitmap->write_in_progress = true;
+	raid_bdev_write_bitmap(raid_bdev, raid_bdev_bitmap_write_done, NULL);
+}
+
+static void
+raid_bdev_bitmap_mark_regions(void *ctx)
+{
+	struct raid_bdev_io *raid_io = ctx;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	uint64_t region, first, last;
+
+	if (bitmap->failed) {
+		spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(raid_io->raid_ch)),
+				     raid_bdev_bitmap_fail_write, raid_io);
+		return;
+	}
+
+	if (raid_bdev_bitmap_get_regions(bitmap, raid_io->offset_blocks, raid_io->num_blocks,
+					 &first, &last)) {
+		for (region = first; region <= last; region++) {
+			if (!raid_bdev_bitmap_test(bitmap->bits, region)) {
+				raid_bdev_bitmap_update(bitmap, region, true);
+			}
+		}
+	}
+
+	/*
+	 * Always wait for a new bitmap write, a write in progress may have been started
+	 * before some of the bits were set.
+	 */
+	TAILQ_INSERT_TAIL(&bitmap->waiting_ios, raid_io, bitmap_link);
+
+	if (!bitmap->write_in_progress) {
+		raid_bdev_bitmap_write(raid_bdev);
+	}
+}
+
+/*
+ * Account a write in the bitmap. Returns false if the write has been deferred until
+ * its regions are marked in the on-disk bitmap or completed.
+ */
+static bool
+raid_bdev_bitmap_start_write(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev_bitmap *bitmap = raid_io->raid_bdev->bitmap;
+	uint64_t region, first, last;
+	int rc;
+
+	if (!raid_bdev_bitmap_get_regions(bitmap, raid_io->offset_blocks, raid_io->num_blocks,
+					  &first, &last)) {
+		return true;
+	}
+
+	/*
+	 * Increment the in-flight write counters before checking the bits. The clear poller
+	 * does the opposite, so either it sees the counter or this sees the cleared bit.
+	 */
+	for (region = first; region <= last; region++) {
+		__atomic_fetch_add(&bitmap->writes[region], 1, __ATOMIC_SEQ_CST);
+	}
+	raid_io->bitmap_marked = true;
+
+	for (region = first; region <= last; region++) {
+		if (!raid_bdev_bitmap_test(bitmap->persisted_bits, region)) {
+			break;
+		}
+	}
+
+	if (region > last) {
+		return true;
+	}
+
+	rc = spdk_thread_send_msg(spdk_thread_get_app_thread(), raid_bdev_bitmap_mark_regions, raid_io);
+	if (rc != 0) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_NOMEM);
+	}
+
+	return false;
+}
+
+static void
+raid_bdev_bitmap_end_write(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev_bitmap *bitmap = raid_io->raid_bdev->bitmap;
+	uint64_t region, first, last;
+
+	if (raid_bdev_bitmap_get_regions(bitmap, bdev_io->u.bdev.offset_blocks,
+					 bdev_io->u.bdev.num_blocks, &first, &last)) {
+		for (region = first; region <= last; region++) {
+			assert(bitmap->writes[region] > 0);
+			__atomic_fetch_sub(&bitmap->writes[region], 1, __ATOMIC_SEQ_CST);
+		}
+	}
+	raid_io->bitmap_marked = false;
+}
+
+static int
+raid_bdev_bitmap_clear_poll(void *arg)
+{
+	struct raid_bdev *raid_bdev = arg;
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_base_bdev_info *base_info;
+	uint64_t region;
+	bool cleared = false;
+
+	if (bitmap->write_in_progress || raid_bdev->process != NULL ||
+	    raid_bdev->state != RAID_BDEV_STATE_ONLINE) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	/* Keep the bits while any base bdev may be missing some of the writes */
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (!base_info->is_configured || base_info->remove_scheduled || base_info->is_failed ||
+		    base_info->bitmap_resync) {
+			return SPDK_POLLER_IDLE;
+		}
+	}
+
+	for (region = 0; region < bitmap->num_regions; region++) {
+		if (region % 8 == 0 && bitmap->bits[region / 8] == 0) {
+			region += 7;
+			continue;
+		}
+
+		if (!raid_bdev_bitmap_test(bitmap->bits, region) ||
+		    __atomic_load_n(&bitmap->writes[region], __ATOMIC_SEQ_CST) != 0) {
+			continue;
+		}
+
+		raid_bdev_bitmap_set_persisted(bitmap, region, false);
+
+		if (__atomic_load_n(&bitmap->writes[region], __ATOMIC_SEQ_CST) != 0) {
+			/* A new write may have seen the bit still set */
+			raid_bdev_bitmap_set_persisted(bitmap, region, true);
+			continue;
+		}
+
+		raid_bdev_bitmap_update(bitmap, region, false);
+		cleared = true;
+	}
+
+	if (!cleared) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	raid_bdev_bitmap_write(raid_bdev);
+
+	return SPDK_POLLER_BUSY;
+}
+
 /*
  * brief:
  * Callback function to spdk_bdev_io_get_buf.
@@ -921,6 +1329,7 @@ raid_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev_io_channel *rai
 	raid_io->base_bdev_io_submitted = 0;
 	raid_io->completion_cb = NULL;
 	raid_io->split.offset = RAID_OFFSET_BLOCKS_INVALID;
+	raid_io->bitmap_marked = false;
 
 	raid_bdev_io_set_default_status(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
 }
@@ -954,6 +1363,9 @@ raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (raid_io->raid_bdev->bitmap != NULL && !raid_bdev_bitmap_start_write(raid_io)) {
+			break;
+		}
 		raid_bdev_submit_rw_request(raid_io);
 		break;
 
@@ -1096,6 +1508,10 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 		spdk_json_write_object_end(w);
 		spdk_json_write_object_end(w);
 	}
+	if (raid_bdev->module->read_policy_supported) {
+		spdk_json_write_named_string(w, "read_policy",
+					     raid_bdev_read_policy_to_str(raid_bdev->read_policy));
+	}
 	spdk_json_write_name(w, "base_bdevs_list");
 	spdk_json_write_array_begin(w);
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
@@ -1110,6 +1526,9 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 		spdk_json_write_named_bool(w, "is_configured", base_info->is_configured);
 		spdk_json_write_named_uint64(w, "data_offset", base_info->data_offset);
 		spdk_json_write_named_uint64(w, "data_size", base_info->data_size);
+		if (raid_bdev->module->read_policy_supported) {
+			spdk_json_write_named_bool(w, "write_mostly", base_info->write_mostly);
+		}
 		spdk_json_write_object_end(w);
 	}
 	spdk_json_write_array_end(w);
@@ -1140,6 +1559,40 @@ raid_bdev_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	return 0;
 }
 
+static void
+raid_bdev_write_read_policy_config_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w)
+{
+	struct raid_base_bdev_info *base_info;
+	bool write_mostly = false;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		write_mostly |= base_info->write_mostly;
+	}
+
+	if (raid_bdev->read_policy == RAID_READ_POLICY_LEAST_OUTSTANDING && !write_mostly) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "method", "bdev_raid_set_read_policy");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", raid_bdev->bdev.name);
+	spdk_json_write_named_string(w, "read_policy",
+				     raid_bdev_read_policy_to_str(raid_bdev->read_policy));
+	spdk_json_write_named_array_begin(w, "write_mostly");
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->write_mostly && base_info->name != NULL) {
+			spdk_json_write_string(w, base_info->name);
+		}
+	}
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 /*
  * brief:
  * raid_bdev_write_config_json is the function table pointer for raid bdev
@@ -1189,6 +1642,10 @@ raid_bdev_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
+
+	if (raid_bdev->module->read_policy_supported) {
+		raid_bdev_write_read_policy_config_json(raid_bdev, w);
+	}
 }
 
 static int
@@ -1280,6 +1737,10 @@ static struct {
 	{ "0", RAID0 },
 	{ "raid1", RAID1 },
 	{ "1", RAID1 },
+	{ "raid10", RAID10 },
+	{ "10", RAID10 },
+	{ "raid6", RAID6 },
+	{ "6", RAID6 },
 	{ "raid5f", RAID5F },
 	{ "5f", RAID5F },
 	{ "concat", CONCAT },
@@ -1299,9 +1760,16 @@ static const char *g_raid_process_type_names[] = {
 	[RAID_PROCESS_MAX]	= NULL
 };
 
+static const char *g_raid_read_policy_names[] = {
+	[RAID_READ_POLICY_LEAST_OUTSTANDING]	= "least_outstanding",
+	[RAID_READ_POLICY_LATENCY]		= "latency",
+	[RAID_READ_POLICY_MAX]			= NULL
+};
+
 /* We have to use the typedef in the function declaration to appease astyle. */
 typedef enum raid_level raid_level_t;
 typedef enum raid_bdev_state raid_bdev_state_t;
+typedef enum raid_read_policy raid_read_policy_t;
 
 raid_level_t
 raid_bdev_str_to_level(const char *str)
@@ -1369,6 +1837,161 @@ raid_bdev_process_to_str(enum raid_process_type value)
 	return g_raid_process_type_names[value];
 }
 
+raid_read_policy_t
+raid_bdev_str_to_read_policy(const char *str)
+{
+	unsigned int i;
+
+	assert(str != NULL);
+
+	for (i = 0; i < RAID_READ_POLICY_MAX; i++) {
+		if (strcasecmp(g_raid_read_policy_names[i], str) == 0) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+const char *
+raid_bdev_read_policy_to_str(enum raid_read_policy value)
+{
+	if (value >= RAID_READ_POLICY_MAX) {
+		return "";
+	}
+
+	return g_raid_read_policy_names[value];
+}
+
+struct raid_bdev_set_read_policy_ctx {
+	raid_base_bdev_cb	cb_fn;
+	void			*cb_ctx;
+};
+
+static void
+raid_bdev_set_read_policy_write_sb_cb(int status, struct raid_bdev *raid_bdev, void *_ctx)
+{
+	struct raid_bdev_set_read_policy_ctx *ctx = _ctx;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write raid bdev '%s' superblock: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	if (ctx->cb_fn != NULL) {
+		ctx->cb_fn(ctx->cb_ctx, status);
+	}
+	free(ctx);
+}
+
+static void
+raid_bdev_sb_update_read_policy(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	struct raid_bdev_sb_base_bdev *sb_base_bdev;
+	uint8_t i;
+
+	sb->read_policy = raid_bdev->read_policy;
+
+	for (i = 0; i < sb->base_bdevs_size; i++) {
+		sb_base_bdev = &sb->base_bdevs[i];
+
+		if (raid_bdev->base_bdev_info[sb_base_bdev->slot].write_mostly) {
+			sb_base_bdev->flags |= RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
+		} else {
+			sb_base_bdev->flags &= ~RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
+		}
+	}
+}
+
+/*
+ * brief:
+ * raid_bdev_set_read_policy sets the read policy of a raid bdev and the set of its
+ * base bdevs which should be avoided for reads. If the raid bdev has a superblock,
+ * the settings are stored in it.
+ * params:
+ * raid_bdev - pointer to raid bdev
+ * read_policy - the new read policy
+ * write_mostly - names of the base bdevs to mark as write-mostly, all others are unmarked
+ * num_write_mostly - number of entries in write_mostly
+ * cb_fn - callback function called when the settings are persisted
+ * cb_ctx - argument to callback function
+ * returns:
+ * 0 - success, cb_fn will be called
+ * non zero - failure, cb_fn will not be called
+ */
+int
+raid_bdev_set_read_policy(struct raid_bdev *raid_bdev, enum raid_read_policy read_policy,
+			  char **write_mostly, size_t num_write_mostly,
+			  raid_base_bdev_cb cb_fn, void *cb_ctx)
+{
+	struct raid_bdev_set_read_policy_ctx *ctx;
+	struct raid_base_bdev_info *base_info;
+	size_t i;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (!raid_bdev->module->read_policy_supported) {
+		SPDK_ERRLOG("Read policy is not supported for raid level '%s'\n",
+			    raid_bdev_level_to_str(raid_bdev->level));
+		return -ENOTSUP;
+	}
+
+	if (read_policy >= RAID_READ_POLICY_MAX) {
+		return -EINVAL;
+	}
+
+	for (i = 0; i < num_write_mostly; i++) {
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->name != NULL && strcmp(base_info->name, write_mostly[i]) == 0) {
+				break;
+			}
+		}
+
+		if (base_info == raid_bdev->base_bdev_info + raid_bdev->num_base_bdevs) {
+			SPDK_ERRLOG("Base bdev '%s' is not a member of raid bdev '%s'\n",
+				    write_mostly[i], raid_bdev->bdev.name);
+			return -ENODEV;
+		}
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+	ctx->cb_fn = cb_fn;
+	ctx->cb_ctx = cb_ctx;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->write_mostly = false;
+		for (i = 0; i < num_write_mostly; i++) {
+			if (base_info->name != NULL && strcmp(base_info->name, write_mostly[i]) == 0) {
+				base_info->write_mostly = true;
+				break;
+			}
+		}
+	}
+
+	raid_bdev->read_policy = read_policy;
+
+	SPDK_DEBUGLOG(bdev_raid, "raid bdev %s read policy set to %s\n", raid_bdev->bdev.name,
+		      raid_bdev_read_policy_to_str(read_policy));
+
+	if (raid_bdev->sb != NULL) {
+		raid_bdev_sb_update_read_policy(raid_bdev);
+
+		/* Otherwise the superblock is written when the raid bdev is configured */
+		if (raid_bdev->state == RAID_BDEV_STATE_ONLINE) {
+			raid_bdev_write_superblock(raid_bdev, raid_bdev_set_read_policy_write_sb_cb, ctx);
+			return 0;
+		}
+	}
+
+	raid_bdev_set_read_policy_write_sb_cb(0, raid_bdev, ctx);
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_fini_start is called when bdev layer is starting the
@@ -1724,12 +2347,55 @@ raid_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void
 	}
 }
 
+/*
+ * Regions marked in the write-intent bitmap of an array assembled with all of its members
+ * may differ between the members if the array was not stopped cleanly. Keep the first
+ * member as the source and mark the others to be resynced in these regions. Like rebuild
+ * targets, they are treated as missing until their resync completes.
+ */
+static void
+raid_bdev_bitmap_resync_prepare(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_base_bdev_info *base_info;
+	uint64_t region;
+
+	if (bitmap == NULL || raid_bdev->num_base_bdevs_discovered < raid_bdev->num_base_bdevs) {
+		return;
+	}
+
+	for (region = 0; region < bitmap->num_regions; region++) {
+		if (raid_bdev_bitmap_test(bitmap->bits, region)) {
+			break;
+		}
+	}
+	if (region == bitmap->num_regions) {
+		return;
+	}
+
+	SPDK_NOTICELOG("Raid bdev %s was not stopped cleanly, resyncing regions marked in write-intent bitmap\n",
+		       raid_bdev->bdev.name);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info == raid_bdev->base_bdev_info) {
+			continue;
+		}
+		base_info->is_process_target = true;
+		base_info->bitmap_resync = true;
+	}
+}
+
+static void raid_bdev_bitmap_resync_next(struct raid_bdev *raid_bdev);
+
 static void
 raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 {
 	struct spdk_bdev *raid_bdev_gen = &raid_bdev->bdev;
+	struct raid_base_bdev_info *base_info;
 	int rc;
 
+	raid_bdev_bitmap_resync_prepare(raid_bdev);
+
 	raid_bdev->state = RAID_BDEV_STATE_ONLINE;
 	SPDK_DEBUGLOG(bdev_raid, "io device register %p\n", raid_bdev);
 	SPDK_DEBUGLOG(bdev_raid, "blockcnt %" PRIu64 ", blocklen %u\n",
@@ -1761,6 +2427,12 @@ raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 		goto out;
 	}
 
+	if (raid_bdev->bitmap != NULL) {
+		raid_bdev->bitmap->clear_poller = SPDK_POLLER_REGISTER(raid_bdev_bitmap_clear_poll, raid_bdev,
+						  RAID_BDEV_BITMAP_CLEAR_PERIOD_US);
+		raid_bdev_bitmap_resync_next(raid_bdev);
+	}
+
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev generic %p\n", raid_bdev_gen);
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev is created with name %s, raid_bdev %p\n",
 		      raid_bdev_gen->name, raid_bdev);
@@ -1771,6 +2443,10 @@ out:
 		}
 		spdk_io_device_unregister(raid_bdev, NULL);
 		raid_bdev->state = RAID_BDEV_STATE_CONFIGURING;
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			base_info->is_process_target = false;
+			base_info->bitmap_resync = false;
+		}
 	}
 
 	if (raid_bdev->configure_cb != NULL) {
@@ -1797,6 +2473,78 @@ raid_bdev_configure_write_sb_cb(int status, struct raid_bdev *raid_bdev, void *c
 	}
 }
 
+static void
+raid_bdev_configure_bitmap_done(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	if (status == 0) {
+		memcpy(raid_bdev->bitmap->persisted_bits, raid_bdev->bitmap->bits,
+		       raid_bdev->bitmap->num_blocks * raid_bdev->bitmap->block_size);
+		raid_bdev->sb->flags |= RAID_BDEV_SB_FLAG_BITMAP;
+	} else {
+		SPDK_WARNLOG("Failed to set up raid bdev '%s' write-intent bitmap: %s\n",
+			     raid_bdev->bdev.name, spdk_strerror(-status));
+		raid_bdev_free_bitmap(raid_bdev);
+		raid_bdev->sb->flags &= ~RAID_BDEV_SB_FLAG_BITMAP;
+	}
+
+	raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+}
+
+static void
+raid_bdev_configure_bitmap_loaded(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+
+	if (status == 0) {
+		raid_bdev_configure_bitmap_done(0, raid_bdev, NULL);
+		return;
+	}
+
+	/* Not knowing which regions were written, treat all of them as such */
+	SPDK_WARNLOG("Failed to load raid bdev '%s' write-intent bitmap: %s\n",
+		     raid_bdev->bdev.name, spdk_strerror(-status));
+	memset(bitmap->bits, 0xff, bitmap->num_blocks * bitmap->block_size);
+	bitmap->dirty_start = 0;
+	bitmap->dirty_end = bitmap->num_blocks;
+
+	raid_bdev_write_bitmap(raid_bdev, raid_bdev_configure_bitmap_done, NULL);
+}
+
+static void
+raid_bdev_configure_bitmap(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_bitmap *bitmap;
+	bool load;
+	int rc;
+
+	raid_bdev_free_bitmap(raid_bdev);
+
+	rc = raid_bdev_alloc_bitmap(raid_bdev);
+	if (rc != 0) {
+		raid_bdev_configure_bitmap_done(rc, raid_bdev, NULL);
+		return;
+	}
+	bitmap = raid_bdev->bitmap;
+
+	load = raid_bdev->sb->flags & RAID_BDEV_SB_FLAG_BITMAP;
+	if (load) {
+		raid_bdev_load_bitmap(raid_bdev, raid_bdev_configure_bitmap_loaded, NULL);
+		return;
+	}
+
+	/*
+	 * A new bitmap knows nothing about what the missing base bdevs of a degraded array
+	 * have missed, so mark all regions in that case.
+	 */
+	if (raid_bdev->num_base_bdevs_discovered < raid_bdev->num_base_bdevs) {
+		memset(bitmap->bits, 0xff, bitmap->num_blocks * bitmap->block_size);
+	}
+	bitmap->dirty_start = 0;
+	bitmap->dirty_end = bitmap->num_blocks;
+
+	raid_bdev_write_bitmap(raid_bdev, raid_bdev_configure_bitmap_done, NULL);
+}
+
 /*
  * brief:
  * If raid bdev config is complete, then only register the raid bdev to
@@ -1864,7 +2612,12 @@ raid_bdev_configure(struct raid_bdev *raid_bdev, raid_bdev_configure_cb cb, void
 			return rc;
 		}
 
-		raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		if (raid_bdev->module->bitmap_supported &&
+		    !spdk_bdev_is_md_interleaved(&raid_bdev->bdev)) {
+			raid_bdev_configure_bitmap(raid_bdev);
+		} else {
+			raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		}
 	} else {
 		raid_bdev_configure_cont(raid_bdev);
 	}
@@ -2201,8 +2954,10 @@ _raid_bdev_remove_base_bdev(struct raid_base_bdev_info *base_info,
 		if (cb_fn != NULL) {
 			cb_fn(cb_ctx, 0);
 		}
-	} else if (raid_bdev->min_base_bdevs_operational == raid_bdev->num_base_bdevs) {
-		/* This raid bdev does not tolerate removing a base bdev. */
+	} else if (raid_bdev->min_base_bdevs_operational == raid_bdev->num_base_bdevs ||
+		   (raid_bdev->module->base_bdev_removable != NULL &&
+		    !raid_bdev->module->base_bdev_removable(base_info))) {
+		/* This raid bdev does not tolerate removing this base bdev. */
 		raid_bdev->num_base_bdevs_operational--;
 		raid_bdev_deconfigure(raid_bdev, cb_fn, cb_ctx);
 	} else {
@@ -2516,6 +3271,7 @@ static void
 raid_bdev_process_finish_unquiesced(void *ctx, int status)
 {
 	struct raid_bdev_process *process = ctx;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
 
 	if (status != 0) {
 		SPDK_ERRLOG("Failed to unquiesce bdev: %s\n", spdk_strerror(-status));
@@ -2531,6 +3287,8 @@ raid_bdev_process_finish_unquiesced(void *ctx, int status)
 	}
 
 	spdk_thread_send_msg(process->thread, _raid_bdev_process_finish_done, process);
+
+	raid_bdev_bitmap_resync_next(raid_bdev);
 }
 
 static void
@@ -2693,7 +3451,7 @@ raid_bdev_process_unlock_window_range(struct raid_bdev_process *process)
 	assert(process->window_range_locked == true);
 
 	rc = spdk_bdev_unquiesce_range(&process->raid_bdev->bdev, &g_raid_if,
-				       process->window_offset, process->max_window_size,
+				       process->window_offset, process->window_lock_size,
 				       raid_bdev_process_window_range_unlocked, process);
 	if (rc != 0) {
 		raid_bdev_process_window_range_unlocked(process, rc);
@@ -2787,11 +3545,30 @@ _raid_bdev_process_thread_run(struct raid_bdev_process *process)
 {
 	struct raid_bdev *raid_bdev = process->raid_bdev;
 	uint64_t offset = process->window_offset;
-	const uint64_t offset_end = spdk_min(offset + process->max_window_size, raid_bdev->bdev.blockcnt);
+	const uint64_t offset_end = spdk_min(offset + process->window_lock_size, raid_bdev->bdev.blockcnt);
+	uint64_t num_blocks, clean_blocks;
 	int ret;
 
+	process->window_skipped = 0;
+
 	while (offset < offset_end) {
-		ret = raid_bdev_submit_process_request(process, offset, offset_end - offset);
+		num_blocks = spdk_min(offset_end - offset, process->max_window_size);
+
+		if (process->bitmap_resync) {
+			struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+
+			clean_blocks = raid_bdev_bitmap_clean_blocks(bitmap, offset, offset_end - offset);
+			if (clean_blocks > 0) {
+				process->window_skipped += clean_blocks;
+				offset += clean_blocks;
+				continue;
+			}
+
+			/* Don't go past the end of the marked region */
+			num_blocks = spdk_min(num_blocks, bitmap->region_size - (offset & (bitmap->region_size - 1)));
+		}
+
+		ret = raid_bdev_submit_process_request(process, offset, num_blocks);
 		if (ret <= 0) {
 			break;
 		}
@@ -2801,7 +3578,12 @@ _raid_bdev_process_thread_run(struct raid_bdev_process *process)
 	}
 
 	if (process->window_remaining > 0) {
-		process->window_size = process->window_remaining;
+		process->window_size = offset - process->window_offset;
+	} else if (offset > process->window_offset && process->window_status == 0) {
+		/* The whole window was skipped, just move on */
+		process->window_size = offset - process->window_offset;
+		spdk_for_each_channel(process->raid_bdev, raid_bdev_process_channel_update, process,
+				      raid_bdev_process_channels_update_done);
 	} else {
 		raid_bdev_process_finish(process, process->window_status);
 	}
@@ -2839,7 +3621,8 @@ raid_bdev_process_consume_token(struct raid_bdev_process *process)
 						(now - process->qos.last_tsc) * process->qos.bytes_per_tsc);
 	process->qos.last_tsc = now;
 	if (process->qos.bytes_available > 0.0) {
-		process->qos.bytes_available -= process->window_size * raid_bdev->bdev.blocklen;
+		process->qos.bytes_available -= (process->window_size - process->window_skipped) *
+						raid_bdev->bdev.blocklen;
 		return true;
 	}
 	return false;
@@ -2863,7 +3646,7 @@ raid_bdev_process_lock_window_range(struct raid_bdev_process *process)
 	}
 
 	rc = spdk_bdev_quiesce_range(&raid_bdev->bdev, &g_raid_if,
-				     process->window_offset, process->max_window_size,
+				     process->window_offset, process->window_lock_size,
 				     raid_bdev_process_window_range_locked, process);
 	if (rc != 0) {
 		raid_bdev_process_window_range_locked(process, rc);
@@ -2904,6 +3687,18 @@ raid_bdev_process_thread_run(struct raid_bdev_process *process)
 
 	process->max_window_size = spdk_min(raid_bdev->bdev.blockcnt - process->window_offset,
 					    process->max_window_size);
+	process->window_lock_size = process->max_window_size;
+
+	if (process->bitmap_resync) {
+		/*
+		 * Regions not marked in the bitmap have not been written while the target was
+		 * missing. Lock the whole range of such regions at once to skip it quickly.
+		 */
+		process->window_lock_size = spdk_max(process->window_lock_size,
+						     raid_bdev_bitmap_clean_blocks(raid_bdev->bitmap, process->window_offset,
+								     raid_bdev->bdev.blockcnt - process->window_offset));
+	}
+
 	raid_bdev_process_lock_window_range(process);
 }
 
@@ -3094,7 +3889,8 @@ raid_bdev_process_alloc(struct raid_bdev *raid_bdev, enum raid_process_type type
 	process->target = target;
 	process->max_window_size = spdk_max(spdk_divide_round_up(g_opts.process_window_size_kb * 1024UL,
 					    spdk_bdev_get_data_block_size(&raid_bdev->bdev)),
-					    raid_bdev->bdev.write_unit_size);
+					    spdk_max(raid_bdev->bdev.write_unit_size,
+						     raid_bdev->bdev.optimal_io_boundary));
 	TAILQ_INIT(&process->requests);
 	TAILQ_INIT(&process->finish_actions);
 
@@ -3132,11 +3928,45 @@ raid_bdev_start_rebuild(struct raid_base_bdev_info *target)
 		return -ENOMEM;
 	}
 
+	if (target->bitmap_resync && target->raid_bdev->bitmap != NULL) {
+		SPDK_NOTICELOG("Rebuilding only regions marked in write-intent bitmap on bdev %s\n",
+			       target->name);
+		process->bitmap_resync = true;
+	}
+	target->bitmap_resync = false;
+
 	raid_bdev_process_start(process);
 
 	return 0;
 }
 
+/* Start the resync of the next member marked by raid_bdev_bitmap_resync_prepare(), if any */
+static void
+raid_bdev_bitmap_resync_next(struct raid_bdev *raid_bdev)
+{
+	struct raid_base_bdev_info *base_info;
+	int rc;
+
+	if (raid_bdev->state != RAID_BDEV_STATE_ONLINE || raid_bdev->process != NULL) {
+		return;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (!base_info->bitmap_resync || !base_info->is_process_target ||
+		    !base_info->is_configured || base_info->remove_scheduled) {
+			continue;
+		}
+
+		rc = raid_bdev_start_rebuild(base_info);
+		if (rc == 0) {
+			return;
+		}
+
+		SPDK_ERRLOG("Failed to start resync of bdev %s: %s\n", base_info->name, spdk_strerror(-rc));
+		_raid_bdev_remove_base_bdev(base_info, NULL, NULL);
+	}
+}
+
 static void raid_bdev_configure_base_bdev_cont(struct raid_base_bdev_info *base_info);
 
 static void
@@ -3539,6 +4369,15 @@ raid_bdev_create_from_sb(const struct raid_bdev_superblock *sb, struct raid_bdev
 
 		base_info->data_offset = sb_base_bdev->data_offset;
 		base_info->data_size = sb_base_bdev->data_size;
+
+		if (raid_bdev->module->read_policy_supported) {
+			base_info->write_mostly = sb_base_bdev->flags &
+						  RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
+		}
+	}
+
+	if (raid_bdev->module->read_policy_supported && sb->read_policy < RAID_READ_POLICY_MAX) {
+		raid_bdev->read_policy = sb->read_policy;
 	}
 
 	*raid_bdev_out = raid_bdev;
@@ -3755,6 +4594,7 @@ raid_bdev_examine_sb(const struct raid_bdev_superblock *sb, struct spdk_bdev *bd
 		       sb_base_bdev->state == RAID_SB_BASE_BDEV_FAILED);
 		assert(spdk_uuid_is_null(&base_info->uuid));
 		spdk_uuid_copy(&base_info->uuid, &sb_base_bdev->uuid);
+		base_info->bitmap_resync = true;
 		SPDK_NOTICELOG("Re-adding bdev %s to raid bdev %s.\n", bdev->name, raid_bdev->bdev.name);
 		rc = raid_bdev_configure_base_bdev(base_info, true, cb_fn, cb_ctx);
 		if (rc != 0) {
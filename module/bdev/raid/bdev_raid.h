@@ -15,6 +15,8 @@ enum raid_level {
 	INVALID_RAID_LEVEL	= -1,
 	RAID0			= 0,
 	RAID1			= 1,
+	RAID6			= 6,
+	RAID10			= 10,
 	RAID5F			= 95, /* 0x5f */
 	CONCAT			= 99,
 };
@@ -49,6 +51,17 @@ enum raid_process_type {
 	RAID_PROCESS_MAX
 };
 
+/* Policy for choosing the base bdev to read from, for modules that store mirrored data */
+enum raid_read_policy {
+	/* Read from the base bdev with the fewest outstanding read blocks */
+	RAID_READ_POLICY_LEAST_OUTSTANDING,
+
+	/* Read from the base bdev with the lowest expected latency, based on past reads */
+	RAID_READ_POLICY_LATENCY,
+
+	RAID_READ_POLICY_MAX
+};
+
 typedef void (*raid_base_bdev_cb)(void *ctx, int status);
 
 /*
@@ -106,6 +119,22 @@ struct raid_base_bdev_info {
 	/* Set to true to indicate that the base bdev is being removed because of a failure */
 	bool			is_failed;
 
+	/*
+	 * Set to true when a former member of the array is re-added or the array was not
+	 * stopped cleanly. Such base bdev only needs the regions marked in the write-intent
+	 * bitmap to be rebuilt.
+	 */
+	bool			bitmap_resync;
+
+	/* Set to true if the last write of the write-intent bitmap to this base bdev failed */
+	bool			bitmap_write_failed;
+
+	/*
+	 * Set to true if reads should avoid this base bdev as long as any other base bdev
+	 * can serve them, e.g. because it is a much slower remote device.
+	 */
+	bool			write_mostly;
+
 	/* callback for base bdev configuration */
 	raid_base_bdev_cb	configure_cb;
 
@@ -153,6 +182,12 @@ struct raid_bdev_io {
 	/* Custom completion callback. Overrides bdev_io completion if set. */
 	raid_bdev_io_completion_cb	completion_cb;
 
+	/* Set if the I/O is accounted in the write-intent bitmap's in-flight write counters */
+	bool				bitmap_marked;
+
+	/* Link in the write-intent bitmap's lists of I/Os waiting for the bitmap to be persisted */
+	TAILQ_ENTRY(raid_bdev_io)	bitmap_link;
+
 	struct {
 		uint64_t		offset;
 		struct iovec		*iov;
@@ -177,6 +212,68 @@ struct raid_bdev_process_request {
 
 typedef void (*raid_bdev_configure_cb)(void *cb_ctx, int rc);
 
+/*
+ * Write-intent bitmap. Each bit covers a region of the raid bdev. A bit is set and
+ * persisted on all base bdevs before the first write to its region is submitted and
+ * it is cleared lazily, when the array is not degraded and the region has no writes
+ * in flight. When a former member of the array is re-added, only the regions with
+ * bits set need to be rebuilt.
+ */
+struct raid_bdev_bitmap {
+	/* offset in blocks of the bitmap on each base bdev */
+	uint64_t			offset_blocks;
+
+	/* size in blocks of the bitmap on each base bdev */
+	uint64_t			num_blocks;
+
+	/* block size of the base bdevs */
+	uint32_t			block_size;
+
+	/* size in blocks of the raid bdev region tracked by a single bit, a power of 2 */
+	uint64_t			region_size;
+	uint32_t			region_shift;
+
+	/* number of tracked regions */
+	uint64_t			num_regions;
+
+	/* the bitmap buffer, num_blocks long, also used for I/O */
+	uint8_t				*bits;
+
+	/*
+	 * Copy of the bitmap with only the bits that are already written to the base bdevs,
+	 * checked in the I/O path
+	 */
+	uint8_t				*persisted_bits;
+
+	/* per-region number of writes in flight */
+	uint32_t			*writes;
+
+	/* range of bitmap blocks modified since the last write of the bitmap */
+	uint64_t			dirty_start;
+	uint64_t			dirty_end;
+
+	/* true while the bitmap is being written */
+	bool				write_in_progress;
+
+	/* number of consecutive failed writes of the bitmap not caused by a base bdev */
+	uint32_t			write_errors;
+
+	/* poller retrying a failed write of the bitmap after a delay */
+	struct spdk_poller		*retry_poller;
+
+	/* true if the bitmap could not be written, writes to the raid bdev are failed */
+	bool				failed;
+
+	/* I/Os waiting for the bitmap write in progress */
+	TAILQ_HEAD(, raid_bdev_io)	writing_ios;
+
+	/* I/Os waiting for the next bitmap write */
+	TAILQ_HEAD(, raid_bdev_io)	waiting_ios;
+
+	/* poller clearing the bits of idle regions */
+	struct spdk_poller		*clear_poller;
+};
+
 /*
  * raid_bdev is the single entity structure which contains SPDK block device
  * and the information related to any raid bdev either configured or
@@ -242,6 +339,12 @@ struct raid_bdev {
 	void				*sb_io_buf;
 	uint32_t			sb_io_buf_size;
 
+	/* Write-intent bitmap, NULL if not used */
+	struct raid_bdev_bitmap		*bitmap;
+
+	/* Read policy, used only by modules which support it */
+	enum raid_read_policy		read_policy;
+
 	/* Raid bdev background process, e.g. rebuild */
 	struct raid_bdev_process	*process;
 
@@ -274,6 +377,11 @@ const char *raid_bdev_level_to_str(enum raid_level level);
 enum raid_bdev_state raid_bdev_str_to_state(const char *str);
 const char *raid_bdev_state_to_str(enum raid_bdev_state state);
 const char *raid_bdev_process_to_str(enum raid_process_type value);
+enum raid_read_policy raid_bdev_str_to_read_policy(const char *str);
+const char *raid_bdev_read_policy_to_str(enum raid_read_policy value);
+int raid_bdev_set_read_policy(struct raid_bdev *raid_bdev, enum raid_read_policy read_policy,
+			      char **write_mostly, size_t num_write_mostly,
+			      raid_base_bdev_cb cb_fn, void *cb_ctx);
 void raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ctx *w);
 int raid_bdev_remove_base_bdev(struct spdk_bdev *base_bdev, raid_base_bdev_cb cb_fn, void *cb_ctx);
 
@@ -306,6 +414,24 @@ struct raid_bdev_module {
 	/* Set to true if this module supports DIF/DIX */
 	bool dif_supported;
 
+	/*
+	 * Set to true if this module can use the write-intent bitmap to limit rebuilding
+	 * of a re-added base bdev to the regions written while it was missing. Only modules
+	 * which keep no state spanning multiple regions (i.e. mirroring) should set this.
+	 */
+	bool bitmap_supported;
+
+	/* Set to true if this module honors the raid bdev's read policy and write-mostly flags */
+	bool read_policy_supported;
+
+	/*
+	 * Called when a base bdev of an online raid bdev is removed or failed, for modules
+	 * where the redundancy depends on which base bdevs are lost and not only on how many,
+	 * so base_bdevs_constraint can't describe it. Returns false if the raid bdev can't
+	 * remain operational without the base bdev. Optional.
+	 */
+	bool (*base_bdev_removable)(struct raid_base_bdev_info *base_info);
+
 	/*
 	 * Called when the raid is starting, right before changing the state to
 	 * online and registering the bdev. Parameters of the bdev like blockcnt
@@ -468,7 +594,7 @@ raid_bdev_flush_blocks(struct raid_base_bdev_info *base_info, struct spdk_io_cha
  */
 
 #define RAID_BDEV_SB_VERSION_MAJOR	1
-#define RAID_BDEV_SB_VERSION_MINOR	0
+#define RAID_BDEV_SB_VERSION_MINOR	2
 
 #define RAID_BDEV_SB_NAME_SIZE		64
 
@@ -490,6 +616,7 @@ struct raid_bdev_sb_base_bdev {
 	uint32_t		state;
 	/* feature/status flags */
 	uint32_t		flags;
+#define RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY	(1u << 0)
 	/* slot number of this base bdev in the raid */
 	uint8_t			slot;
 
@@ -512,6 +639,7 @@ struct raid_bdev_superblock {
 	uint32_t		crc;
 	/* feature/status flags */
 	uint32_t		flags;
+#define RAID_BDEV_SB_FLAG_BITMAP	(1u << 0)
 	/* unique id of the raid bdev */
 	struct spdk_uuid	uuid;
 	/* name of the raid bdev */
@@ -530,8 +658,22 @@ struct raid_bdev_superblock {
 	uint64_t		seq_number;
 	/* number of raid base devices */
 	uint8_t			num_base_bdevs;
+	/* read policy, used only by modules which support it */
+	uint8_t			read_policy;
+
+	uint8_t			reserved[6];
+
+	/* write-intent bitmap geometry, valid if RAID_BDEV_SB_FLAG_BITMAP is set */
+	struct {
+		/* offset in blocks of the bitmap on each base bdev */
+		uint64_t	offset;
+		/* size in blocks of the raid bdev region tracked by a single bit */
+		uint64_t	region_size;
+		/* number of tracked regions */
+		uint64_t	num_regions;
+	} bitmap;
 
-	uint8_t			reserved[118];
+	uint8_t			reserved2[87];
 
 	/* size of the base bdevs array */
 	uint8_t			base_bdevs_size;
@@ -545,6 +687,16 @@ SPDK_STATIC_ASSERT(sizeof(struct raid_bdev_superblock) == 256, "incorrect size")
 SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH < RAID_BDEV_MIN_DATA_OFFSET_SIZE,
 		   "Incorrect min data offset");
 
+/* The write-intent bitmap is stored on each base bdev between the superblock and the data */
+#define RAID_BDEV_BITMAP_OFFSET			(64 * 1024)
+#define RAID_BDEV_BITMAP_MAX_SIZE		(32 * 1024)
+#define RAID_BDEV_BITMAP_MIN_REGION_SIZE	(1024 * 1024)
+
+SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH <= RAID_BDEV_BITMAP_OFFSET,
+		   "Incorrect bitmap offset");
+SPDK_STATIC_ASSERT(RAID_BDEV_BITMAP_OFFSET + RAID_BDEV_BITMAP_MAX_SIZE <= RAID_BDEV_MIN_DATA_OFFSET_SIZE,
+		   "Incorrect min data offset");
+
 typedef void (*raid_bdev_write_sb_cb)(int status, struct raid_bdev *raid_bdev, void *ctx);
 typedef void (*raid_bdev_load_sb_cb)(const struct raid_bdev_superblock *sb, int status, void *ctx);
 
@@ -556,6 +708,13 @@ void raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_
 int raid_bdev_load_base_bdev_superblock(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 					raid_bdev_load_sb_cb cb, void *cb_ctx);
 
+typedef void (*raid_bdev_bitmap_cb)(int status, struct raid_bdev *raid_bdev, void *ctx);
+
+int raid_bdev_alloc_bitmap(struct raid_bdev *raid_bdev);
+void raid_bdev_free_bitmap(struct raid_bdev *raid_bdev);
+void raid_bdev_write_bitmap(struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb, void *cb_ctx);
+void raid_bdev_load_bitmap(struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb, void *cb_ctx);
+
 struct spdk_raid_bdev_opts {
 	/* Size of the background process window in KiB */
 	uint32_t process_window_size_kb;
@@ -636,3 +636,124 @@ rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request, const struct spd
 }
 SPDK_RPC_REGISTER("bdev_raid_set_options", rpc_bdev_raid_set_options,
 		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
+/*
+ * Input structure for RPC bdev_raid_set_read_policy
+ */
+struct rpc_bdev_raid_set_read_policy {
+	/* Raid bdev name */
+	char				*name;
+
+	/* Read policy */
+	enum raid_read_policy		read_policy;
+
+	/* Names of the base bdevs that should be avoided for reads */
+	struct rpc_bdev_raid_create_base_bdevs write_mostly;
+};
+
+static void
+free_rpc_bdev_raid_set_read_policy(struct rpc_bdev_raid_set_read_policy *req)
+{
+	size_t i;
+
+	free(req->name);
+	for (i = 0; i < req->write_mostly.num_base_bdevs; i++) {
+		free(req->write_mostly.base_bdevs[i]);
+	}
+}
+
+/*
+ * Decoder function for RPC bdev_raid_set_read_policy to decode the read policy
+ */
+static int
+decode_raid_read_policy(const struct spdk_json_val *val, void *out)
+{
+	int ret;
+	char *str = NULL;
+	enum raid_read_policy read_policy;
+
+	ret = spdk_json_decode_string(val, &str);
+	if (ret == 0 && str != NULL) {
+		read_policy = raid_bdev_str_to_read_policy(str);
+		if (read_policy == RAID_READ_POLICY_MAX) {
+			ret = -EINVAL;
+		} else {
+			*(enum raid_read_policy *)out = read_policy;
+		}
+	}
+
+	free(str);
+	return ret;
+}
+
+/*
+ * Decoder object for RPC bdev_raid_set_read_policy
+ */
+static const struct spdk_json_object_decoder rpc_bdev_raid_set_read_policy_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_raid_set_read_policy, name), spdk_json_decode_string},
+	{"read_policy", offsetof(struct rpc_bdev_raid_set_read_policy, read_policy), decode_raid_read_policy},
+	{"write_mostly", offsetof(struct rpc_bdev_raid_set_read_policy, write_mostly), decode_base_bdevs, true},
+};
+
+static void
+rpc_bdev_raid_set_read_policy_done(void *ctx, int status)
+{
+	struct spdk_jsonrpc_request *request = ctx;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, status,
+						     "Failed to store read policy in raid bdev superblock: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+/*
+ * brief:
+ * bdev_raid_set_read_policy function is the RPC for setting the read policy of a raid bdev
+ * and the list of its base bdevs which should only be read if no other base bdev can be.
+ * params:
+ * request - pointer to json rpc request
+ * params - pointer to request parameters
+ * returns:
+ * none
+ */
+static void
+rpc_bdev_raid_set_read_policy(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_raid_set_read_policy req = {};
+	struct raid_bdev *raid_bdev;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_raid_set_read_policy_decoders,
+				    SPDK_COUNTOF(rpc_bdev_raid_set_read_policy_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_PARSE_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	raid_bdev = raid_bdev_find_by_name(req.name);
+	if (raid_bdev == NULL) {
+		spdk_jsonrpc_send_error_response_fmt(request, -ENODEV,
+						     "raid bdev %s not found", req.name);
+		goto cleanup;
+	}
+
+	rc = raid_bdev_set_read_policy(raid_bdev, req.read_policy, req.write_mostly.base_bdevs,
+				       req.write_mostly.num_base_bdevs,
+				       rpc_bdev_raid_set_read_policy_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, rc,
+						     "Failed to set read policy of raid bdev %s: %s",
+						     req.name, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+cleanup:
+	free_rpc_bdev_raid_set_read_policy(&req);
+}
+SPDK_RPC_REGISTER("bdev_raid_set_read_policy", rpc_bdev_raid_set_read_policy, SPDK_RPC_RUNTIME)
@@ -31,6 +31,19 @@ struct raid_bdev_read_sb_ctx {
 	uint32_t buf_size;
 };
 
+struct raid_bdev_bitmap_io_ctx {
+	struct raid_bdev *raid_bdev;
+	int status;
+	uint8_t submitted;
+	uint8_t remaining;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
+	void *buf;
+	raid_bdev_bitmap_cb cb;
+	void *cb_ctx;
+	struct spdk_bdev_io_wait_entry wait_entry;
+};
+
 int
 raid_bdev_alloc_superblock(struct raid_bdev *raid_bdev, uint32_t block_size)
 {
@@ -79,6 +92,7 @@ raid_bdev_init_superblock(struct raid_bdev *raid_bdev)
 	sb->strip_size = raid_bdev->strip_size;
 	/* TODO: sb->state */
 	sb->num_base_bdevs = sb->base_bdevs_size = raid_bdev->num_base_bdevs;
+	sb->read_policy = raid_bdev->read_policy;
 	sb->length = sizeof(*sb) + sizeof(*sb_base_bdev) * sb->base_bdevs_size;
 
 	sb_base_bdev = &sb->base_bdevs[0];
@@ -88,6 +102,9 @@ raid_bdev_init_superblock(struct raid_bdev *raid_bdev)
 		sb_base_bdev->data_size = base_info->data_size;
 		sb_base_bdev->state = RAID_SB_BASE_BDEV_CONFIGURED;
 		sb_base_bdev->slot = raid_bdev_base_bdev_slot(base_info);
+		if (base_info->write_mostly) {
+			sb_base_bdev->flags |= RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY;
+		}
 		sb_base_bdev++;
 	}
 }
@@ -427,4 +444,335 @@ err:
 	cb(rc, raid_bdev, cb_ctx);
 }
 
+static bool
+raid_bdev_sb_bitmap_is_valid(const struct raid_bdev_superblock *sb)
+{
+	const uint64_t region_size = sb->bitmap.region_size;
+
+	return region_size != 0 && spdk_u64_is_pow2(region_size) &&
+	       sb->bitmap.num_regions == spdk_divide_round_up(sb->raid_size, region_size) &&
+	       spdk_divide_round_up(sb->bitmap.num_regions, 8) <= RAID_BDEV_BITMAP_MAX_SIZE;
+}
+
+int
+raid_bdev_alloc_bitmap(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_superblock *sb = raid_bdev->sb;
+	struct raid_base_bdev_info *base_info;
+	struct raid_bdev_bitmap *bitmap;
+	uint64_t region_size, offset_blocks, num_blocks, num_regions;
+
+	assert(sb != NULL);
+	assert(raid_bdev->bitmap == NULL);
+
+	if ((sb->flags & RAID_BDEV_SB_FLAG_BITMAP) && !raid_bdev_sb_bitmap_is_valid(sb)) {
+		SPDK_WARNLOG("Ignoring invalid write-intent bitmap of raid bdev %s\n", raid_bdev->bdev.name);
+		sb->flags &= ~RAID_BDEV_SB_FLAG_BITMAP;
+	}
+
+	if (sb->flags & RAID_BDEV_SB_FLAG_BITMAP) {
+		offset_blocks = sb->bitmap.offset;
+		region_size = sb->bitmap.region_size;
+	} else {
+		offset_blocks = spdk_divide_round_up(RAID_BDEV_BITMAP_OFFSET, sb->block_size);
+		region_size = spdk_max(RAID_BDEV_BITMAP_MIN_REGION_SIZE / sb->block_size,
+				       spdk_divide_round_up(sb->raid_size, RAID_BDEV_BITMAP_MAX_SIZE * 8));
+		if (region_size > 1) {
+			region_size = spdk_align64pow2(region_size);
+		}
+	}
+
+	num_regions = spdk_divide_round_up(sb->raid_size, region_size);
+	num_blocks = spdk_divide_round_up(spdk_divide_round_up(num_regions, 8), sb->block_size);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->is_configured && offset_blocks + num_blocks > base_info->data_offset) {
+			SPDK_NOTICELOG("No space for the write-intent bitmap of raid bdev %s on bdev %s\n",
+				       raid_bdev->bdev.name, base_info->name);
+			return -ENOSPC;
+		}
+	}
+
+	bitmap = calloc(1, sizeof(*bitmap));
+	if (bitmap == NULL) {
+		return -ENOMEM;
+	}
+
+	bitmap->offset_blocks = offset_blocks;
+	bitmap->num_blocks = num_blocks;
+	bitmap->block_size = sb->block_size;
+	bitmap->region_size = region_size;
+	bitmap->region_shift = spdk_u64log2(region_size);
+	bitmap->num_regions = num_regions;
+	bitmap->dirty_start = num_blocks;
+	bitmap->dirty_end = 0;
+	TAILQ_INIT(&bitmap->writing_ios);
+	TAILQ_INIT(&bitmap->waiting_ios);
+
+	bitmap->bits = spdk_dma_zmalloc(num_blocks * sb->block_size, 0x1000, NULL);
+	bitmap->persisted_bits = calloc(num_blocks, sb->block_size);
+	bitmap->writes = calloc(num_regions, sizeof(*bitmap->writes));
+	if (bitmap->bits == NULL || bitmap->persisted_bits == NULL || bitmap->writes == NULL) {
+		SPDK_ERRLOG("Failed to allocate raid bdev write-intent bitmap\n");
+		spdk_dma_free(bitmap->bits);
+		free(bitmap->persisted_bits);
+		free(bitmap->writes);
+		free(bitmap);
+		return -ENOMEM;
+	}
+
+	sb->bitmap.offset = offset_blocks;
+	sb->bitmap.region_size = region_size;
+	sb->bitmap.num_regions = num_regions;
+
+	raid_bdev->bitmap = bitmap;
+
+	return 0;
+}
+
+void
+raid_bdev_free_bitmap(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+
+	if (bitmap == NULL) {
+		return;
+	}
+
+	assert(bitmap->write_in_progress == false);
+	assert(bitmap->clear_poller == NULL);
+	assert(bitmap->retry_poller == NULL);
+	assert(TAILQ_EMPTY(&bitmap->writing_ios));
+	assert(TAILQ_EMPTY(&bitmap->waiting_ios));
+
+	spdk_dma_free(bitmap->bits);
+	free(bitmap->persisted_bits);
+	free(bitmap->writes);
+	free(bitmap);
+	raid_bdev->bitmap = NULL;
+}
+
+static void
+raid_bdev_bitmap_io_done(int status, struct raid_bdev_bitmap_io_ctx *ctx)
+{
+	if (status != 0) {
+		ctx->status = status;
+	}
+
+	if (--ctx->remaining == 0) {
+		ctx->cb(ctx->status, ctx->raid_bdev, ctx->cb_ctx);
+		spdk_dma_free(ctx->buf);
+		free(ctx);
+	}
+}
+
+static void
+raid_bdev_write_bitmap_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_bitmap_io_ctx *ctx = cb_arg;
+	struct raid_base_bdev_info *base_info;
+	int status = 0;
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to save write-intent bitmap on bdev %s\n", bdev_io->bdev->name);
+		status = -EIO;
+
+		RAID_FOR_EACH_BASE_BDEV(ctx->raid_bdev, base_info) {
+			if (base_info->desc != NULL &&
+			    spdk_bdev_desc_get_bdev(base_info->desc) == bdev_io->bdev) {
+				base_info->bitmap_write_failed = true;
+				break;
+			}
+		}
+	}
+
+	spdk_bdev_free_io(bdev_io);
+
+	raid_bdev_bitmap_io_done(status, ctx);
+}
+
+static void
+_raid_bdev_write_bitmap(void *_ctx)
+{
+	struct raid_bdev_bitmap_io_ctx *ctx = _ctx;
+	struct raid_bdev *raid_bdev = ctx->raid_bdev;
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_base_bdev_info *base_info;
+	uint8_t i;
+	int rc;
+
+	for (i = ctx->submitted; i < raid_bdev->num_base_bdevs; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+
+		if (!base_info->is_configured || base_info->remove_scheduled) {
+			assert(ctx->remaining > 1);
+			raid_bdev_bitmap_io_done(0, ctx);
+			ctx->submitted++;
+			continue;
+		}
+
+		rc = spdk_bdev_write_blocks(base_info->desc, base_info->app_thread_ch,
+					    bitmap->bits + ctx->offset_blocks * bitmap->block_size,
+					    bitmap->offset_blocks + ctx->offset_blocks, ctx->num_blocks,
+					    raid_bdev_write_bitmap_cb, ctx);
+		if (rc != 0) {
+			struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+
+			if (rc == -ENOMEM) {
+				ctx->wait_entry.bdev = bdev;
+				ctx->wait_entry.cb_fn = _raid_bdev_write_bitmap;
+				ctx->wait_entry.cb_arg = ctx;
+				spdk_bdev_queue_io_wait(bdev, base_info->app_thread_ch, &ctx->wait_entry);
+				return;
+			}
+
+			assert(ctx->remaining > 1);
+			base_info->bitmap_write_failed = true;
+			raid_bdev_bitmap_io_done(rc, ctx);
+		}
+
+		ctx->submitted++;
+	}
+
+	raid_bdev_bitmap_io_done(0, ctx);
+}
+
+/*
+ * Write the bitmap blocks modified since the previous write to all configured base bdevs.
+ * The base bdevs the write failed on are marked with bitmap_write_failed.
+ */
+void
+raid_bdev_write_bitmap(struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_bdev_bitmap_io_ctx *ctx;
+	struct raid_base_bdev_info *base_info;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(bitmap != NULL);
+	assert(bitmap->dirty_start < bitmap->dirty_end);
+	assert(cb != NULL);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->bitmap_write_failed = false;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->remaining = raid_bdev->num_base_bdevs + 1;
+	ctx->offset_blocks = bitmap->dirty_start;
+	ctx->num_blocks = bitmap->dirty_end - bitmap->dirty_start;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+
+	bitmap->dirty_start = bitmap->num_blocks;
+	bitmap->dirty_end = 0;
+
+	_raid_bdev_write_bitmap(ctx);
+}
+
+static void _raid_bdev_load_bitmap(struct raid_bdev_bitmap_io_ctx *ctx);
+
+static void
+raid_bdev_load_bitmap_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_bitmap_io_ctx *ctx = cb_arg;
+	struct raid_bdev_bitmap *bitmap = ctx->raid_bdev->bitmap;
+	uint64_t i;
+
+	if (success) {
+		/* Merge the bitmaps, in case the last update did not reach all base bdevs */
+		for (i = 0; i < bitmap->num_blocks * bitmap->block_size; i++) {
+			bitmap->bits[i] |= ((uint8_t *)ctx->buf)[i];
+		}
+	} else {
+		SPDK_ERRLOG("Failed to load write-intent bitmap from bdev %s\n", bdev_io->bdev->name);
+		ctx->status = -EIO;
+	}
+
+	spdk_bdev_free_io(bdev_io);
+
+	ctx->submitted++;
+	_raid_bdev_load_bitmap(ctx);
+}
+
+static void
+_raid_bdev_load_bitmap_wait_cb(void *ctx)
+{
+	_raid_bdev_load_bitmap(ctx);
+}
+
+static void
+_raid_bdev_load_bitmap(struct raid_bdev_bitmap_io_ctx *ctx)
+{
+	struct raid_bdev *raid_bdev = ctx->raid_bdev;
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_base_bdev_info *base_info;
+	int rc;
+
+	for (; ctx->submitted < raid_bdev->num_base_bdevs && ctx->status == 0; ctx->submitted++) {
+		base_info = &raid_bdev->base_bdev_info[ctx->submitted];
+
+		if (!base_info->is_configured || base_info->remove_scheduled) {
+			continue;
+		}
+
+		rc = spdk_bdev_read_blocks(base_info->desc, base_info->app_thread_ch, ctx->buf,
+					   bitmap->offset_blocks, bitmap->num_blocks,
+					   raid_bdev_load_bitmap_cb, ctx);
+		if (rc == -ENOMEM) {
+			ctx->wait_entry.bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+			ctx->wait_entry.cb_fn = _raid_bdev_load_bitmap_wait_cb;
+			ctx->wait_entry.cb_arg = ctx;
+			spdk_bdev_queue_io_wait(ctx->wait_entry.bdev, base_info->app_thread_ch, &ctx->wait_entry);
+			return;
+		} else if (rc != 0) {
+			ctx->status = rc;
+			break;
+		}
+
+		return;
+	}
+
+	raid_bdev_bitmap_io_done(0, ctx);
+}
+
+/*
+ * Read the bitmap from all configured base bdevs and merge it into the in-memory bitmap.
+ */
+void
+raid_bdev_load_bitmap(struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_bitmap *bitmap = raid_bdev->bitmap;
+	struct raid_bdev_bitmap_io_ctx *ctx;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(bitmap != NULL);
+	assert(cb != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->remaining = 1;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+	ctx->buf = spdk_dma_malloc(bitmap->num_blocks * bitmap->block_size, 0x1000, NULL);
+	if (!ctx->buf) {
+		free(ctx);
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	_raid_bdev_load_bitmap(ctx);
+}
+
 SPDK_LOG_REGISTER_COMPONENT(bdev_raid_sb)
@@ -3,29 +3,39 @@
  *   All rights reserved.
  */
 
-#include "bdev_raid.h"
+#include "raid1.h"
 
 #include "spdk/likely.h"
 #include "spdk/log.h"
 
-struct raid1_info {
-	/* The parent raid bdev */
-	struct raid_bdev *raid_bdev;
-};
+/* Weight of a new sample in the moving average of read latency, as a power of 2 */
+#define RAID1_READ_LATENCY_EWMA_SHIFT		3
 
-struct raid1_io_channel {
-	/* Array of per-base_bdev counters of outstanding read blocks on this channel */
-	uint64_t read_blocks_outstanding[0];
-};
+/*
+ * Number of reads submitted on a channel after which a base bdev that has not completed any
+ * read is probed again, so that its latency estimate can recover after a slow period.
+ */
+#define RAID1_READ_LATENCY_PROBE_INTERVAL	1024
+
+static inline void
+raid1_io_get_mirror(struct raid_bdev_io *raid_io, struct raid1_mirror *mirror)
+{
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+
+	r1info->get_mirror(raid_io, mirror);
+}
 
 static void
 raid1_channel_inc_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
 				uint64_t num_blocks)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_io_channel_base *base = &raid1_ch->base[idx];
 
-	assert(raid1_ch->read_blocks_outstanding[idx] <= UINT64_MAX - num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] += num_blocks;
+	assert(base->read_blocks_outstanding <= UINT64_MAX - num_blocks);
+	base->read_blocks_outstanding += num_blocks;
+	base->reads_outstanding++;
+	raid1_ch->read_seq++;
 }
 
 static void
@@ -33,9 +43,32 @@ raid1_channel_dec_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t id
 				uint64_t num_blocks)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_io_channel_base *base = &raid1_ch->base[idx];
 
-	assert(raid1_ch->read_blocks_outstanding[idx] >= num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] -= num_blocks;
+	assert(base->read_blocks_outstanding >= num_blocks);
+	assert(base->reads_outstanding > 0);
+	base->read_blocks_outstanding -= num_blocks;
+	base->reads_outstanding--;
+}
+
+static void
+raid1_channel_update_read_latency(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
+				  struct spdk_bdev_io *bdev_io)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_io_channel_base *base = &raid1_ch->base[idx];
+	uint64_t latency;
+
+	latency = spdk_max(spdk_get_ticks() - spdk_bdev_io_get_submit_tsc(bdev_io), 1);
+
+	if (base->read_latency == 0) {
+		base->read_latency = latency;
+	} else {
+		base->read_latency -= base->read_latency >> RAID1_READ_LATENCY_EWMA_SHIFT;
+		base->read_latency += latency >> RAID1_READ_LATENCY_EWMA_SHIFT;
+		base->read_latency = spdk_max(base->read_latency, 1);
+	}
+	base->read_seq_sampled = raid1_ch->read_seq;
 }
 
 static void
@@ -102,9 +135,12 @@ raid1_correct_read_error(void *_raid_io)
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
+	struct raid1_mirror mirror;
 	uint8_t i;
 	int ret;
 
+	raid1_io_get_mirror(raid_io, &mirror);
+
 	i = raid_io->base_bdev_io_submitted;
 	base_info = &raid_bdev->base_bdev_info[i];
 	base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, i);
@@ -112,7 +148,7 @@ raid1_correct_read_error(void *_raid_io)
 
 	raid1_init_ext_io_opts(&io_opts, raid_io);
 	ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
-					  raid_io->offset_blocks, raid_io->num_blocks,
+					  mirror.pd_lba, raid_io->num_blocks,
 					  raid1_correct_read_error_completion, raid_io, &io_opts);
 	if (spdk_unlikely(ret != 0)) {
 		if (ret == -ENOMEM) {
@@ -153,11 +189,14 @@ raid1_read_other_base_bdev(void *_raid_io)
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
+	struct raid1_mirror mirror;
 	uint8_t i;
 	int ret;
 
-	for (i = raid_bdev->num_base_bdevs - raid_io->base_bdev_io_remaining; i < raid_bdev->num_base_bdevs;
-	     i++) {
+	raid1_io_get_mirror(raid_io, &mirror);
+
+	for (i = mirror.first + mirror.num - raid_io->base_bdev_io_remaining;
+	     i < mirror.first + mirror.num; i++) {
 		base_info = &raid_bdev->base_bdev_info[i];
 		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, i);
 
@@ -168,7 +207,7 @@ raid1_read_other_base_bdev(void *_raid_io)
 
 		raid1_init_ext_io_opts(&io_opts, raid_io);
 		ret = raid_bdev_readv_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
-						 raid_io->offset_blocks, raid_io->num_blocks,
+						 mirror.pd_lba, raid_io->num_blocks,
 						 raid1_read_other_completion, raid_io, &io_opts);
 		if (spdk_unlikely(ret != 0)) {
 			if (ret == -ENOMEM) {
@@ -191,14 +230,21 @@ static void
 raid1_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
 	struct raid_bdev_io *raid_io = cb_arg;
-
-	spdk_bdev_free_io(bdev_io);
+	struct raid1_mirror mirror;
 
 	raid1_channel_dec_read_counters(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
 					raid_io->num_blocks);
 
+	if (success && raid_io->raid_bdev->read_policy == RAID_READ_POLICY_LATENCY) {
+		raid1_channel_update_read_latency(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
+						  bdev_io);
+	}
+
+	spdk_bdev_free_io(bdev_io);
+
 	if (!success) {
-		raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+		raid1_io_get_mirror(raid_io, &mirror);
+		raid_io->base_bdev_io_remaining = mirror.num;
 		raid1_read_other_base_bdev(raid_io);
 		return;
 	}
@@ -206,8 +252,6 @@ raid1_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *
 	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
 }
 
-static void raid1_submit_rw_request(struct raid_bdev_io *raid_io);
-
 static void
 _raid1_submit_rw_request(void *_raid_io)
 {
@@ -216,18 +260,56 @@ _raid1_submit_rw_request(void *_raid_io)
 	raid1_submit_rw_request(raid_io);
 }
 
+static bool
+raid1_channel_read_latency_less(struct raid1_io_channel *raid1_ch, uint8_t a, uint8_t b)
+{
+	struct raid1_io_channel_base *base_a = &raid1_ch->base[a];
+	struct raid1_io_channel_base *base_b = &raid1_ch->base[b];
+	uint64_t cost_a, cost_b;
+
+	/* Estimate the time to complete a new read: the latency times the queued reads */
+	cost_a = base_a->read_latency * (base_a->reads_outstanding + 1);
+	cost_b = base_b->read_latency * (base_b->reads_outstanding + 1);
+
+	if (cost_a != cost_b) {
+		return cost_a < cost_b;
+	}
+
+	return base_a->read_blocks_outstanding < base_b->read_blocks_outstanding;
+}
+
 static uint8_t
-raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+raid1_channel_select_read_base_bdev(struct raid_bdev *raid_bdev,
+				    struct raid_bdev_io_channel *raid_ch,
+				    const struct raid1_mirror *mirror, bool use_write_mostly)
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_io_channel_base *base;
 	uint64_t read_blocks_min = UINT64_MAX;
 	uint8_t idx = UINT8_MAX;
 	uint8_t i;
 
-	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		if (raid_bdev_channel_get_base_channel(raid_ch, i) != NULL &&
-		    raid1_ch->read_blocks_outstanding[i] < read_blocks_min) {
-			read_blocks_min = raid1_ch->read_blocks_outstanding[i];
+	for (i = mirror->first; i < mirror->first + mirror->num; i++) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL ||
+		    raid_bdev->base_bdev_info[i].write_mostly != use_write_mostly) {
+			continue;
+		}
+
+		base = &raid1_ch->base[i];
+
+		if (raid_bdev->read_policy == RAID_READ_POLICY_LATENCY) {
+			/* Periodically send a read to an idle base bdev to refresh its latency */
+			if (base->reads_outstanding == 0 && raid1_ch->read_seq - base->read_seq_sampled >
+			    RAID1_READ_LATENCY_PROBE_INTERVAL) {
+				base->read_seq_sampled = raid1_ch->read_seq;
+				return i;
+			}
+
+			if (idx == UINT8_MAX || raid1_channel_read_latency_less(raid1_ch, i, idx)) {
+				idx = i;
+			}
+		} else if (base->read_blocks_outstanding < read_blocks_min) {
+			read_blocks_min = base->read_blocks_outstanding;
 			idx = i;
 		}
 	}
@@ -235,7 +317,22 @@ raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_
 	return idx;
 }
 
-static int
+static uint8_t
+raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				  const struct raid1_mirror *mirror)
+{
+	uint8_t idx;
+
+	idx = raid1_channel_select_read_base_bdev(raid_bdev, raid_ch, mirror, false);
+	if (idx == UINT8_MAX) {
+		/* Read from write-mostly base bdevs only if there is no other choice */
+		idx = raid1_channel_select_read_base_bdev(raid_bdev, raid_ch, mirror, true);
+	}
+
+	return idx;
+}
+
+int
 raid1_submit_read_request(struct raid_bdev_io *raid_io)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
@@ -243,10 +340,13 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
+	struct raid1_mirror mirror;
 	uint8_t idx;
 	int ret;
 
-	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch);
+	raid1_io_get_mirror(raid_io, &mirror);
+
+	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch, &mirror);
 	if (spdk_unlikely(idx == UINT8_MAX)) {
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 		return 0;
@@ -257,7 +357,7 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 
 	raid1_init_ext_io_opts(&io_opts, raid_io);
 	ret = raid_bdev_readv_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
-					 raid_io->offset_blocks, raid_io->num_blocks,
+					 mirror.pd_lba, raid_io->num_blocks,
 					 raid1_read_bdev_io_completion, raid_io, &io_opts);
 
 	if (spdk_likely(ret == 0)) {
@@ -279,17 +379,21 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
-	uint8_t idx;
+	struct raid1_mirror mirror;
+	uint8_t i, idx;
 	uint64_t base_bdev_io_not_submitted;
 	int ret = 0;
 
+	raid1_io_get_mirror(raid_io, &mirror);
+
 	if (raid_io->base_bdev_io_submitted == 0) {
-		raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+		raid_io->base_bdev_io_remaining = mirror.num;
 		raid_bdev_io_set_default_status(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 	}
 
 	raid1_init_ext_io_opts(&io_opts, raid_io);
-	for (idx = raid_io->base_bdev_io_submitted; idx < raid_bdev->num_base_bdevs; idx++) {
+	for (i = raid_io->base_bdev_io_submitted; i < mirror.num; i++) {
+		idx = mirror.first + i;
 		base_info = &raid_bdev->base_bdev_info[idx];
 		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, idx);
 
@@ -301,7 +405,7 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 		}
 
 		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, raid_io->iovs, raid_io->iovcnt,
-						  raid_io->offset_blocks, raid_io->num_blocks,
+						  mirror.pd_lba, raid_io->num_blocks,
 						  raid1_write_bdev_io_completion, raid_io, &io_opts);
 		if (spdk_unlikely(ret != 0)) {
 			if (spdk_unlikely(ret == -ENOMEM)) {
@@ -310,8 +414,7 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 				return 0;
 			}
 
-			base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
-						     raid_io->base_bdev_io_submitted;
+			base_bdev_io_not_submitted = mirror.num - raid_io->base_bdev_io_submitted;
 			raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
 						   SPDK_BDEV_IO_STATUS_FAILED);
 			return 0;
@@ -327,7 +430,7 @@ raid1_submit_write_request(struct raid_bdev_io *raid_io)
 	return ret;
 }
 
-static void
+void
 raid1_submit_rw_request(struct raid_bdev_io *raid_io)
 {
 	int ret;
@@ -370,6 +473,14 @@ raid1_io_device_unregister_done(void *io_device)
 	free(r1info);
 }
 
+static void
+raid1_get_mirror(struct raid_bdev_io *raid_io, struct raid1_mirror *mirror)
+{
+	mirror->first = 0;
+	mirror->num = raid_io->raid_bdev->num_base_bdevs;
+	mirror->pd_lba = raid_io->offset_blocks;
+}
+
 static int
 raid1_start(struct raid_bdev *raid_bdev)
 {
@@ -384,6 +495,7 @@ raid1_start(struct raid_bdev *raid_bdev)
 		return -ENOMEM;
 	}
 	r1info->raid_bdev = raid_bdev;
+	r1info->get_mirror = raid1_get_mirror;
 
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
@@ -398,7 +510,8 @@ raid1_start(struct raid_bdev *raid_bdev)
 
 	snprintf(name, sizeof(name), "raid1_%s", raid_bdev->bdev.name);
 	spdk_io_device_register(r1info, raid1_ioch_create, raid1_ioch_destroy,
-				sizeof(struct raid1_io_channel) + raid_bdev->num_base_bdevs * sizeof(uint64_t),
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(struct raid1_io_channel_base),
 				name);
 
 	return 0;
@@ -447,12 +560,15 @@ raid1_process_submit_write(struct raid_bdev_process_request *process_req)
 {
 	struct raid_bdev_io *raid_io = &process_req->raid_io;
 	struct spdk_bdev_ext_io_opts io_opts;
+	struct raid1_mirror mirror;
 	int ret;
 
+	raid1_io_get_mirror(raid_io, &mirror);
+
 	raid1_init_ext_io_opts(&io_opts, raid_io);
 	ret = raid_bdev_writev_blocks_ext(process_req->target, process_req->target_ch,
 					  raid_io->iovs, raid_io->iovcnt,
-					  raid_io->offset_blocks, raid_io->num_blocks,
+					  mirror.pd_lba, raid_io->num_blocks,
 					  raid1_process_write_completed, process_req, &io_opts);
 	if (spdk_unlikely(ret != 0)) {
 		if (ret == -ENOMEM) {
@@ -464,7 +580,7 @@ raid1_process_submit_write(struct raid_bdev_process_request *process_req)
 	}
 }
 
-static void
+void
 raid1_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
 {
 	struct raid_bdev_process_request *process_req = SPDK_CONTAINEROF(raid_io,
@@ -538,6 +654,8 @@ static struct raid_bdev_module g_raid1_module = {
 	.base_bdevs_min = 2,
 	.base_bdevs_constraint = {CONSTRAINT_MIN_BASE_BDEVS_OPERATIONAL, 1},
 	.memory_domains_supported = true,
+	.bitmap_supported = true,
+	.read_policy_supported = true,
 	.start = raid1_start,
 	.stop = raid1_stop,
 	.submit_rw_request = raid1_submit_rw_request,
@@ -0,0 +1,55 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_RAID1_INTERNAL_H
+#define SPDK_RAID1_INTERNAL_H
+
+#include "bdev_raid.h"
+
+/*
+ * The mirroring I/O path of raid1 is also used by raid10. The data of a raid_io is
+ * mirrored on the num base bdevs starting at slot first, at offset pd_lba.
+ */
+struct raid1_mirror {
+	uint8_t		first;
+	uint8_t		num;
+	uint64_t	pd_lba;
+};
+
+struct raid1_info {
+	/* The parent raid bdev */
+	struct raid_bdev *raid_bdev;
+
+	/* Returns the mirror holding the data of a raid_io */
+	void (*get_mirror)(struct raid_bdev_io *raid_io, struct raid1_mirror *mirror);
+};
+
+struct raid1_io_channel_base {
+	/* Number of outstanding read blocks */
+	uint64_t read_blocks_outstanding;
+
+	/* Number of outstanding read requests */
+	uint64_t reads_outstanding;
+
+	/* Moving average of read completion latency in ticks, 0 if not sampled yet */
+	uint64_t read_latency;
+
+	/* Value of the channel's read sequence number when the last read completed */
+	uint64_t read_seq_sampled;
+};
+
+struct raid1_io_channel {
+	/* Number of reads submitted on this channel */
+	uint64_t read_seq;
+
+	/* Array of per-base_bdev read statistics on this channel */
+	struct raid1_io_channel_base base[0];
+};
+
+int raid1_submit_read_request(struct raid_bdev_io *raid_io);
+void raid1_submit_rw_request(struct raid_bdev_io *raid_io);
+void raid1_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status);
+
+#endif /* SPDK_RAID1_INTERNAL_H */
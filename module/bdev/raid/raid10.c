@@ -0,0 +1,296 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#include "raid1.h"
+
+#include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/thread.h"
+
+/*
+ * RAID10 stripes data across mirror pairs. Base bdevs 2 * i and 2 * i + 1 form
+ * mirror pair i and the strips are distributed over the pairs the same way as
+ * raid0 distributes them over the base bdevs.
+ */
+#define RAID10_NUM_MIRRORS 2
+
+struct raid10_info {
+	/* Must be first, the raid1 I/O path gets it from the raid bdev's module_private */
+	struct raid1_info r1info;
+};
+
+static inline uint8_t
+raid10_num_pairs(struct raid_bdev *raid_bdev)
+{
+	return raid_bdev->num_base_bdevs / RAID10_NUM_MIRRORS;
+}
+
+static inline uint8_t
+raid10_mirror_idx(uint8_t idx)
+{
+	return idx ^ 1;
+}
+
+/*
+ * Maps a raid bdev offset to the mirror pair holding it and to the offset on
+ * the base bdevs of that pair.
+ */
+static void
+raid10_map_offset(struct raid_bdev *raid_bdev, uint64_t offset_blocks, uint8_t *pair_idx,
+		  uint64_t *pd_lba)
+{
+	uint64_t strip = offset_blocks >> raid_bdev->strip_size_shift;
+	uint64_t pd_strip = strip / raid10_num_pairs(raid_bdev);
+
+	*pair_idx = strip % raid10_num_pairs(raid_bdev);
+	*pd_lba = (pd_strip << raid_bdev->strip_size_shift) +
+		  (offset_blocks & (raid_bdev->strip_size - 1));
+}
+
+static void
+raid10_get_mirror(struct raid_bdev_io *raid_io, struct raid1_mirror *mirror)
+{
+	uint8_t pair_idx;
+
+	raid10_map_offset(raid_io->raid_bdev, raid_io->offset_blocks, &pair_idx, &mirror->pd_lba);
+	mirror->first = pair_idx * RAID10_NUM_MIRRORS;
+	mirror->num = RAID10_NUM_MIRRORS;
+}
+
+static void
+raid10_ioch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
+static int
+raid10_ioch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+raid10_io_device_unregister_done(void *io_device)
+{
+	struct raid10_info *r10info = io_device;
+
+	raid_bdev_module_stop_done(r10info->r1info.raid_bdev);
+
+	free(r10info);
+}
+
+static uint64_t
+raid10_calculate_base_bdev_data_size(struct raid_bdev *raid_bdev, uint64_t min_blockcnt)
+{
+	return (min_blockcnt >> raid_bdev->strip_size_shift) << raid_bdev->strip_size_shift;
+}
+
+static int
+raid10_start(struct raid_bdev *raid_bdev)
+{
+	uint64_t min_blockcnt = UINT64_MAX;
+	uint64_t base_bdev_data_size;
+	struct raid_base_bdev_info *base_info;
+	struct raid10_info *r10info;
+	char name[256];
+	uint8_t i;
+
+	if (raid_bdev->num_base_bdevs % RAID10_NUM_MIRRORS != 0) {
+		SPDK_ERRLOG("RAID10 requires an even number of base bdevs\n");
+		return -EINVAL;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i += RAID10_NUM_MIRRORS) {
+		if (raid_bdev->base_bdev_info[i].desc == NULL &&
+		    raid_bdev->base_bdev_info[raid10_mirror_idx(i)].desc == NULL) {
+			SPDK_ERRLOG("Both base bdevs of RAID10 mirror pair %u are missing\n",
+				    i / RAID10_NUM_MIRRORS);
+			return -EINVAL;
+		}
+	}
+
+	r10info = calloc(1, sizeof(*r10info));
+	if (!r10info) {
+		SPDK_ERRLOG("Failed to allocate RAID10 info device structure\n");
+		return -ENOMEM;
+	}
+	r10info->r1info.raid_bdev = raid_bdev;
+	r10info->r1info.get_mirror = raid10_get_mirror;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
+	}
+
+	base_bdev_data_size = raid10_calculate_base_bdev_data_size(raid_bdev, min_blockcnt);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->data_size = base_bdev_data_size;
+	}
+
+	raid_bdev->bdev.blockcnt = base_bdev_data_size * raid10_num_pairs(raid_bdev);
+	raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
+	raid_bdev->bdev.split_on_optimal_io_boundary = true;
+	raid_bdev->module_private = r10info;
+
+	snprintf(name, sizeof(name), "raid10_%s", raid_bdev->bdev.name);
+	spdk_io_device_register(r10info, raid10_ioch_create, raid10_ioch_destroy,
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(struct raid1_io_channel_base),
+				name);
+
+	return 0;
+}
+
+static bool
+raid10_stop(struct raid_bdev *raid_bdev)
+{
+	struct raid10_info *r10info = raid_bdev->module_private;
+
+	spdk_io_device_unregister(r10info, raid10_io_device_unregister_done);
+
+	return false;
+}
+
+static struct spdk_io_channel *
+raid10_get_io_channel(struct raid_bdev *raid_bdev)
+{
+	struct raid10_info *r10info = raid_bdev->module_private;
+
+	return spdk_get_io_channel(r10info);
+}
+
+static void
+raid10_process_skip_done(void *ctx)
+{
+	struct raid_bdev_process_request *process_req = ctx;
+
+	raid_bdev_process_request_complete(process_req, 0);
+}
+
+/*
+ * Only the strips of the mirror pair containing the process target need to be
+ * copied. The strips of other pairs preceding the target pair's next strip are
+ * accounted as processed without doing any I/O.
+ */
+static int
+raid10_submit_process_request(struct raid_bdev_process_request *process_req,
+			      struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev *raid_bdev = process_req->target->raid_bdev;
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	uint8_t num_pairs = raid10_num_pairs(raid_bdev);
+	uint8_t target_pair_idx = raid_bdev_base_bdev_slot(process_req->target) / RAID10_NUM_MIRRORS;
+	uint64_t offset_blocks = process_req->offset_blocks;
+	uint64_t offset_in_strip = offset_blocks & (raid_bdev->strip_size - 1);
+	uint64_t skip_blocks = 0;
+	uint64_t num_blocks;
+	uint8_t pair_idx;
+	uint64_t pd_lba;
+	int ret;
+
+	raid10_map_offset(raid_bdev, offset_blocks, &pair_idx, &pd_lba);
+
+	if (pair_idx != target_pair_idx) {
+		skip_blocks = raid_bdev->strip_size - offset_in_strip +
+			      (uint64_t)((target_pair_idx + num_pairs - pair_idx) % num_pairs - 1) *
+			      raid_bdev->strip_size;
+		offset_in_strip = 0;
+	}
+
+	if (skip_blocks >= process_req->num_blocks) {
+		ret = spdk_thread_send_msg(spdk_get_thread(), raid10_process_skip_done, process_req);
+		if (spdk_unlikely(ret != 0)) {
+			return ret;
+		}
+		return process_req->num_blocks;
+	}
+
+	num_blocks = spdk_min(raid_bdev->strip_size - offset_in_strip,
+			      process_req->num_blocks - skip_blocks);
+	process_req->iov.iov_len = num_blocks * raid_bdev->bdev.blocklen;
+
+	raid_bdev_io_init(raid_io, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+			  offset_blocks + skip_blocks, num_blocks,
+			  &process_req->iov, 1, process_req->md_buf, NULL, NULL);
+	raid_io->completion_cb = raid1_process_read_completed;
+
+	ret = raid1_submit_read_request(raid_io);
+	if (spdk_likely(ret == 0)) {
+		return skip_blocks + num_blocks;
+	} else if (ret < 0) {
+		return ret;
+	} else {
+		return -EINVAL;
+	}
+}
+
+static bool
+raid10_resize(struct raid_bdev *raid_bdev)
+{
+	uint64_t blockcnt;
+	int rc;
+	uint64_t min_blockcnt = UINT64_MAX;
+	uint64_t base_bdev_data_size;
+	struct raid_base_bdev_info *base_info;
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		struct spdk_bdev *base_bdev;
+
+		if (base_info->desc == NULL) {
+			continue;
+		}
+		base_bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+		min_blockcnt = spdk_min(min_blockcnt, base_bdev->blockcnt - base_info->data_offset);
+	}
+
+	base_bdev_data_size = raid10_calculate_base_bdev_data_size(raid_bdev, min_blockcnt);
+	blockcnt = base_bdev_data_size * raid10_num_pairs(raid_bdev);
+
+	if (blockcnt == raid_bdev->bdev.blockcnt) {
+		return false;
+	}
+
+	rc = spdk_bdev_notify_blockcnt_change(&raid_bdev->bdev, blockcnt);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to notify blockcount change\n");
+		return false;
+	}
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->data_size = base_bdev_data_size;
+	}
+
+	return true;
+}
+
+static bool
+raid10_base_bdev_removable(struct raid_base_bdev_info *base_info)
+{
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	uint8_t mirror_idx = raid10_mirror_idx(raid_bdev_base_bdev_slot(base_info));
+	struct raid_base_bdev_info *mirror_info = &raid_bdev->base_bdev_info[mirror_idx];
+
+	/* The pair loses its data unless the mirror is present and not being rebuilt */
+	return mirror_info->is_configured && !mirror_info->remove_scheduled &&
+	       !mirror_info->is_process_target;
+}
+
+static struct raid_bdev_module g_raid10_module = {
+	.level = RAID10,
+	.base_bdevs_min = 4,
+	/*
+	 * One base bdev of each mirror pair may be lost, which base_bdev_removable checks.
+	 * The constraint only ensures a base bdev remains for each of the minimum 2 pairs.
+	 */
+	.base_bdevs_constraint = {CONSTRAINT_MIN_BASE_BDEVS_OPERATIONAL, 2},
+	.memory_domains_supported = true,
+	.base_bdev_removable = raid10_base_bdev_removable,
+	.start = raid10_start,
+	.stop = raid10_stop,
+	.submit_rw_request = raid1_submit_rw_request,
+	.get_io_channel = raid10_get_io_channel,
+	.submit_process_request = raid10_submit_process_request,
+	.resize = raid10_resize,
+};
+RAID_MODULE_REGISTER(&g_raid10_module)
@@ -16,6 +16,12 @@
 /* Maximum concurrent full stripe writes per io channel */
 #define RAID5F_MAX_STRIPES 32
 
+/* Maximum number of xor sources supported by the accel framework */
+#define RAID5F_MAX_XOR_SRCS 256
+
+/* Number of hash buckets for tracking locked stripes */
+#define RAID5F_STRIPE_LOCK_BUCKETS 256
+
 struct chunk {
 	/* Corresponds to base_bdev index */
 	uint8_t index;
@@ -31,15 +37,44 @@ struct chunk {
 
 	/* Pointer to buffer with I/O metadata */
 	void *md_buf;
+
+	/* Range of the chunk accessed by a partial stripe request, in blocks from the chunk start */
+	uint64_t req_offset;
+	uint64_t req_blocks;
+
+	/* Range of the chunk read before calculating parity or reconstructing data */
+	uint64_t preread_offset;
+	uint64_t preread_blocks;
+
+	/* Iovecs for the pre-read */
+	struct iovec *preread_iovs;
+	int preread_iovcnt;
 };
 
 struct stripe_request;
 typedef void (*stripe_req_xor_cb)(struct stripe_request *stripe_req, int status);
+typedef void (*stripe_req_lock_cb)(struct stripe_request *stripe_req);
+
+enum partial_request_mode {
+	/* Read spanning multiple chunks */
+	PARTIAL_READ,
+	/* Read spanning multiple chunks, one of which has to be reconstructed from parity */
+	PARTIAL_READ_RECONSTRUCT,
+	/* Write that updates the data chunks only because the parity chunk is missing */
+	PARTIAL_WRITE_DATA_ONLY,
+	/* Read-modify-write: parity is updated with the difference between old and new data */
+	PARTIAL_WRITE_RMW,
+	/* Reconstruct-write: parity is calculated from new data and the untouched old data */
+	PARTIAL_WRITE_RCW,
+	/* Reconstruct-write with the old data of the missing chunk reconstructed first */
+	PARTIAL_WRITE_RCW_RECONSTRUCT,
+};
 
 struct stripe_request {
 	enum stripe_request_type {
 		STRIPE_REQ_WRITE,
 		STRIPE_REQ_RECONSTRUCT,
+		STRIPE_REQ_PARTIAL,
 	} type;
 
 	struct raid5f_io_channel *r5ch;
@@ -75,6 +110,34 @@ struct stripe_request {
 			/* Offset from chunk start */
 			uint64_t chunk_offset;
 		} reconstruct;
+
+		struct {
+			/* Buffer for stripe parity */
+			void *parity_buf;
+
+			/* Array of buffers for pre-reading chunks, indexed by chunk */
+			void **chunk_buffers;
+
+			/* Iovecs for building the chunk views used for pre-reads and parity calculation */
+			struct iovec *iovs;
+			int iovcnt;
+			int iovcnt_max;
+
+			/* Range covered by all chunks accessed by the request, in blocks from the chunk start */
+			uint64_t range_offset;
+			uint64_t range_blocks;
+
+			/* Chunk whose base bdev is missing or NULL */
+			struct chunk *missing_chunk;
+
+			enum partial_request_mode mode;
+
+			/* Set while the pre-reads are in progress */
+			bool preread;
+
+			/* Status of the base bdev I/Os of the current phase */
+			enum spdk_bdev_io_status status;
+		} partial;
 	};
 
 	/* Array of iovec iterators for each chunk */
@@ -91,9 +154,23 @@ struct stripe_request {
 		size_t remaining;
 		size_t remaining_md;
 		int status;
+		uint32_t n_src;
 		stripe_req_xor_cb cb;
 	} xor;
 
+	struct {
+		/* Set if the request holds the lock of its stripe */
+		bool locked;
+
+		/* Called when the stripe lock is acquired */
+		stripe_req_lock_cb cb;
+
+		/* Requests waiting for this request to release the stripe lock */
+		TAILQ_HEAD(, stripe_request) waiters;
+
+		TAILQ_ENTRY(stripe_request) link;
+	} lock;
+
 	TAILQ_ENTRY(stripe_request) link;
 
 	/* Array of chunks corresponding to base_bdevs */
@@ -115,6 +192,18 @@ struct raid5f_info {
 
 	/* block length bit shift for optimized calculation, only valid when no interleaved md */
 	uint32_t blocklen_shift;
+
+	/* Set if writes smaller than a full stripe are handled by the module */
+	bool partial_stripe_writes;
+
+	/* Zero-filled buffer of strip size, used for padding parity calculation sources */
+	void *zero_buf;
+
+	/* Protects locked_stripes */
+	struct spdk_spinlock stripe_lock;
+
+	/* Stripe requests holding stripe locks, hashed by the stripe index */
+	TAILQ_HEAD(, stripe_request) locked_stripes[RAID5F_STRIPE_LOCK_BUCKETS];
 };
 
 struct raid5f_io_channel {
@@ -122,6 +211,7 @@ struct raid5f_io_channel {
 	struct {
 		TAILQ_HEAD(, stripe_request) write;
 		TAILQ_HEAD(, stripe_request) reconstruct;
+		TAILQ_HEAD(, stripe_request) partial;
 	} free_stripe_requests;
 
 	/* accel_fw channel */
@@ -131,7 +221,6 @@ struct raid5f_io_channel {
 	TAILQ_HEAD(, stripe_request) xor_retry_queue;
 
 	/* For iterating over chunk iovecs during xor calculation */
-	void **chunk_xor_buffers;
 	struct iovec **chunk_xor_iovs;
 	size_t *chunk_xor_iovcnt;
 };
@@ -176,13 +265,101 @@ raid5f_stripe_parity_chunk_index(const struct raid_bdev *raid_bdev, uint64_t str
 	return raid5f_stripe_data_chunks_num(raid_bdev) - stripe_index % raid_bdev->num_base_bdevs;
 }
 
+static void
+_raid5f_stripe_request_lock_granted(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+
+	stripe_req->lock.cb(stripe_req);
+}
+
+/*
+ * Serialize requests that depend on the consistency of data and parity of a stripe. The callback
+ * is executed when the lock is acquired, immediately if the stripe is not locked.
+ */
+static void
+raid5f_stripe_request_lock(struct stripe_request *stripe_req, stripe_req_lock_cb cb)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	struct stripe_request *holder;
+
+	if (!r5f_info->partial_stripe_writes) {
+		/* With full stripe writes only, each request accesses the whole stripe consistently */
+		cb(stripe_req);
+		return;
+	}
+
+	stripe_req->lock.cb = cb;
+
+	spdk_spin_lock(&r5f_info->stripe_lock);
+	TAILQ_FOREACH(holder, &r5f_info->locked_stripes[stripe_req->stripe_index %
+			RAID5F_STRIPE_LOCK_BUCKETS], lock.link) {
+		if (holder->stripe_index == stripe_req->stripe_index) {
+			break;
+		}
+	}
+
+	if (holder != NULL) {
+		TAILQ_INSERT_TAIL(&holder->lock.waiters, stripe_req, lock.link);
+	} else {
+		TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[stripe_req->stripe_index %
+				  RAID5F_STRIPE_LOCK_BUCKETS], stripe_req, lock.link);
+		stripe_req->lock.locked = true;
+	}
+	spdk_spin_unlock(&r5f_info->stripe_lock);
+
+	if (holder == NULL) {
+		cb(stripe_req);
+	}
+}
+
+static void
+raid5f_stripe_request_unlock(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+	struct stripe_request *next;
+	int rc;
+
+	assert(stripe_req->lock.locked);
+
+	spdk_spin_lock(&r5f_info->stripe_lock);
+	TAILQ_REMOVE(&r5f_info->locked_stripes[stripe_req->stripe_index % RAID5F_STRIPE_LOCK_BUCKETS],
+		     stripe_req, lock.link);
+
+	next = TAILQ_FIRST(&stripe_req->lock.waiters);
+	if (next != NULL) {
+		/* Pass the lock to the first waiter, the rest will wait for it */
+		TAILQ_REMOVE(&stripe_req->lock.waiters, next, lock.link);
+		TAILQ_CONCAT(&next->lock.waiters, &stripe_req->lock.waiters, lock.link);
+		TAILQ_INSERT_TAIL(&r5f_info->locked_stripes[next->stripe_index % RAID5F_STRIPE_LOCK_BUCKETS],
+				  next, lock.link);
+		next->lock.locked = true;
+	}
+	spdk_spin_unlock(&r5f_info->stripe_lock);
+
+	stripe_req->lock.locked = false;
+
+	if (next != NULL) {
+		rc = spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(next->r5ch)),
+					  _raid5f_stripe_request_lock_granted, next);
+		assert(rc == 0);
+		(void)rc;
+	}
+}
+
 static inline void
 raid5f_stripe_request_release(struct stripe_request *stripe_req)
 {
+	if (stripe_req->lock.locked) {
+		raid5f_stripe_request_unlock(stripe_req);
+	}
+
 	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
 		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.write, stripe_req, link);
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL) {
+		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.partial, stripe_req, link);
 	} else {
 		assert(false);
 	}
@@ -231,7 +408,7 @@ raid5f_xor_stripe_cb(void *_stripe_req, int status)
 
 	if (stripe_req->xor.remaining > 0) {
 		stripe_req->xor.len = spdk_ioviter_nextv(stripe_req->chunk_iov_iters,
-				      stripe_req->r5ch->chunk_xor_buffers);
+				      stripe_req->chunk_xor_buffers);
 		raid5f_xor_stripe_continue(stripe_req);
 	}
 
@@ -252,19 +429,12 @@ static void
 raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
-	uint8_t i;
+	uint32_t n_src = stripe_req->xor.n_src;
 	int ret;
 
 	assert(stripe_req->xor.len > 0);
 
-	for (i = 0; i < n_src; i++) {
-		stripe_req->chunk_xor_buffers[i] = r5ch->chunk_xor_buffers[i];
-	}
-
-	ret = spdk_accel_submit_xor(r5ch->accel_ch, r5ch->chunk_xor_buffers[n_src],
+	ret = spdk_accel_submit_xor(r5ch->accel_ch, stripe_req->chunk_xor_buffers[n_src],
 				    stripe_req->chunk_xor_buffers, n_src, stripe_req->xor.len,
 				    raid5f_xor_stripe_cb, stripe_req);
 	if (spdk_unlikely(ret)) {
@@ -277,12 +447,35 @@ raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 	}
 }
 
+/*
+ * Prepare xor of the iovec arrays set in r5ch->chunk_xor_iovs. The first n_src arrays are the
+ * sources and the last one is the destination.
+ */
+static void
+raid5f_xor_stripe_init(struct stripe_request *stripe_req, uint32_t n_src, uint64_t num_blocks,
+		       stripe_req_xor_cb cb)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct raid_bdev *raid_bdev = stripe_req->raid_io->raid_bdev;
+
+	stripe_req->xor.n_src = n_src;
+	stripe_req->xor.len = spdk_ioviter_firstv(stripe_req->chunk_iov_iters, n_src + 1,
+			      r5ch->chunk_xor_iovs,
+			      r5ch->chunk_xor_iovcnt,
+			      stripe_req->chunk_xor_buffers);
+	stripe_req->xor.remaining = num_blocks * raid_bdev->bdev.blocklen;
+	stripe_req->xor.remaining_md = 0;
+	stripe_req->xor.status = 0;
+	stripe_req->xor.cb = cb;
+}
+
 static void
 raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
 	struct chunk *chunk;
 	struct chunk *dest_chunk = NULL;
 	uint64_t num_blocks = 0;
@@ -312,17 +505,9 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 	r5ch->chunk_xor_iovs[c] = dest_chunk->iovs;
 	r5ch->chunk_xor_iovcnt[c] = dest_chunk->iovcnt;
 
-	stripe_req->xor.len = spdk_ioviter_firstv(stripe_req->chunk_iov_iters,
-			      raid_bdev->num_base_bdevs,
-			      r5ch->chunk_xor_iovs,
-			      r5ch->chunk_xor_iovcnt,
-			      r5ch->chunk_xor_buffers);
-	stripe_req->xor.remaining = num_blocks * raid_bdev->bdev.blocklen;
-	stripe_req->xor.status = 0;
-	stripe_req->xor.cb = cb;
+	raid5f_xor_stripe_init(stripe_req, n_src, num_blocks, cb);
 
 	if (raid_io->md_buf != NULL) {
-		uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
 		uint64_t len = num_blocks * raid_bdev->bdev.md_len;
 		int ret;
 
@@ -381,6 +566,30 @@ raid5f_stripe_request_chunk_read_complete(struct stripe_request *stripe_req,
 	raid_bdev_io_complete_part(raid_io, 1, status);
 }
 
+static void raid5f_partial_request_phase_done(struct stripe_request *stripe_req);
+
+/*
+ * Partial stripe requests go through several phases of base bdev I/O, so the completions are
+ * counted here instead of raid_bdev_io_complete_part(), which would complete the raid_io.
+ */
+static void
+raid5f_stripe_request_chunk_partial_complete(struct stripe_request *stripe_req, uint64_t completed,
+		enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		stripe_req->partial.status = status;
+	}
+
+	assert(raid_io->base_bdev_io_remaining >= completed);
+	raid_io->base_bdev_io_remaining -= completed;
+
+	if (raid_io->base_bdev_io_remaining == 0) {
+		raid5f_partial_request_phase_done(stripe_req);
+	}
+}
+
 static void
 raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -395,6 +604,8 @@ raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *
 		raid5f_stripe_request_chunk_write_complete(stripe_req, status);
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		raid5f_stripe_request_chunk_read_complete(stripe_req, status);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL) {
+		raid5f_stripe_request_chunk_partial_complete(stripe_req, 1, status);
 	} else {
 		assert(false);
 	}
@@ -421,6 +632,45 @@ raid5f_init_ext_io_opts(struct spdk_bdev_ext_io_opts *opts, struct raid_bdev_io
 	opts->metadata = raid_io->md_buf;
 }
 
+static int
+raid5f_chunk_submit_partial(struct chunk *chunk, struct raid_base_bdev_info *base_info,
+			    struct spdk_io_channel *base_ch, uint64_t base_offset_blocks,
+			    struct spdk_bdev_ext_io_opts *io_opts)
+{
+	struct stripe_request *stripe_req = raid5f_chunk_stripe_req(chunk);
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	if (stripe_req->partial.preread) {
+		if (chunk->preread_blocks == 0) {
+			raid5f_stripe_request_chunk_partial_complete(stripe_req, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+			return 0;
+		}
+
+		assert(base_ch != NULL);
+
+		return raid_bdev_readv_blocks_ext(base_info, base_ch, chunk->preread_iovs,
+						  chunk->preread_iovcnt,
+						  base_offset_blocks + chunk->preread_offset,
+						  chunk->preread_blocks, raid5f_chunk_complete_bdev_io,
+						  chunk, io_opts);
+	}
+
+	if (chunk->req_blocks == 0 || base_ch == NULL) {
+		raid5f_stripe_request_chunk_partial_complete(stripe_req, 1, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return 0;
+	}
+
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		return raid_bdev_readv_blocks_ext(base_info, base_ch, chunk->iovs, chunk->iovcnt,
+						  base_offset_blocks + chunk->req_offset, chunk->req_blocks,
+						  raid5f_chunk_complete_bdev_io, chunk, io_opts);
+	} else {
+		return raid_bdev_writev_blocks_ext(base_info, base_ch, chunk->iovs, chunk->iovcnt,
+						   base_offset_blocks + chunk->req_offset, chunk->req_blocks,
+						   raid5f_chunk_complete_bdev_io, chunk, io_opts);
+	}
+}
+
 static int
 raid5f_chunk_submit(struct chunk *chunk)
 {
@@ -462,6 +712,9 @@ raid5f_chunk_submit(struct chunk *chunk)
 						 base_offset_blocks, raid_io->num_blocks,
 						 raid5f_chunk_complete_bdev_io, chunk, &io_opts);
 		break;
+	case STRIPE_REQ_PARTIAL:
+		ret = raid5f_chunk_submit_partial(chunk, base_info, base_ch, base_offset_blocks, &io_opts);
+		break;
 	default:
 		assert(false);
 		ret = -EINVAL;
@@ -477,20 +730,18 @@ raid5f_chunk_submit(struct chunk *chunk)
 			/*
 			 * Implicitly complete any I/Os not yet submitted as FAILED. If completing
 			 * these means there are no more to complete for the stripe request, we can
-			 * release the stripe request as well.
+			 * release the stripe request as well. Reconstruct and partial stripe requests
+			 * are released by their completion callbacks.
 			 */
-			uint64_t base_bdev_io_not_submitted;
-
-			if (stripe_req->type == STRIPE_REQ_WRITE) {
-				base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
-							     raid_io->base_bdev_io_submitted;
-			} else {
-				base_bdev_io_not_submitted = raid5f_stripe_data_chunks_num(raid_bdev) -
-							     raid_io->base_bdev_io_submitted;
-			}
-
-			if (raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
-						       SPDK_BDEV_IO_STATUS_FAILED)) {
+			uint64_t base_bdev_io_not_submitted = raid_bdev->num_base_bdevs -
+							      raid_io->base_bdev_io_submitted;
+
+			if (stripe_req->type == STRIPE_REQ_PARTIAL) {
+				raid5f_stripe_request_chunk_partial_complete(stripe_req, base_bdev_io_not_submitted,
+						SPDK_BDEV_IO_STATUS_FAILED);
+			} else if (raid_bdev_io_complete_part(raid_io, base_bdev_io_not_submitted,
+							      SPDK_BDEV_IO_STATUS_FAILED) &&
+				   stripe_req->type == STRIPE_REQ_WRITE) {
 				raid5f_stripe_request_release(stripe_req);
 			}
 		}
@@ -517,6 +768,10 @@ raid5f_chunk_set_iovcnt(struct chunk *chunk, int iovcnt)
 	return 0;
 }
 
+/*
+ * Map the raid_io iovecs to the data chunks according to their req_blocks. The raid_io data is
+ * contiguous across the data chunks of the stripe.
+ */
 static int
 raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 {
@@ -531,10 +786,15 @@ raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 
 	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
 		int chunk_iovcnt = 0;
-		uint64_t len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+		uint64_t len = chunk->req_blocks * raid_bdev->bdev.blocklen;
 		size_t off = raid_io_iov_offset;
 		int ret;
 
+		if (len == 0) {
+			chunk->iovcnt = 0;
+			continue;
+		}
+
 		for (i = raid_io_iov_idx; i < raid_io->iovcnt; i++) {
 			chunk_iovcnt++;
 			off += raid_io->iovs[i].iov_len;
@@ -576,11 +836,6 @@ raid5f_stripe_request_map_iovecs(struct stripe_request *stripe_req)
 		}
 	}
 
-	stripe_req->parity_chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
-	stripe_req->parity_chunk->iovs[0].iov_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
-	stripe_req->parity_chunk->iovcnt = 1;
-	stripe_req->parity_chunk->md_buf = stripe_req->write.parity_md_buf;
-
 	return 0;
 }
 
@@ -621,12 +876,25 @@ raid5f_stripe_write_request_xor_done(struct stripe_request *stripe_req, int stat
 	}
 }
 
+static void
+raid5f_stripe_write_request_locked(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, stripe_req->parity_chunk->index) != NULL) {
+		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+	} else {
+		raid5f_stripe_write_request_xor_done(stripe_req, 0);
+	}
+}
+
 static int
 raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
 	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
 	struct stripe_request *stripe_req;
+	struct chunk *chunk;
 	int ret;
 
 	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write);
@@ -636,20 +904,512 @@ raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 
 	raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
 
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		chunk->req_offset = 0;
+		chunk->req_blocks = raid_bdev->strip_size;
+	}
+
 	ret = raid5f_stripe_request_map_iovecs(stripe_req);
 	if (spdk_unlikely(ret)) {
 		return ret;
 	}
 
+	stripe_req->parity_chunk->iovs[0].iov_base = stripe_req->write.parity_buf;
+	stripe_req->parity_chunk->iovs[0].iov_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	stripe_req->parity_chunk->iovcnt = 1;
+	stripe_req->parity_chunk->md_buf = stripe_req->write.parity_md_buf;
+
 	TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
 
 	raid_io->module_private = stripe_req;
 	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
 
-	if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, stripe_req->parity_chunk->index) != NULL) {
-		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
+	raid5f_stripe_request_lock(stripe_req, raid5f_stripe_write_request_locked);
+
+	return 0;
+}
+
+static inline void *
+raid5f_partial_chunk_buf(struct stripe_request *stripe_req, struct chunk *chunk)
+{
+	return stripe_req->partial.chunk_buffers[chunk->index];
+}
+
+static struct iovec *
+raid5f_partial_get_iovs(struct stripe_request *stripe_req, int iovcnt)
+{
+	struct iovec *iovs = &stripe_req->partial.iovs[stripe_req->partial.iovcnt];
+
+	stripe_req->partial.iovcnt += iovcnt;
+	assert(stripe_req->partial.iovcnt <= stripe_req->partial.iovcnt_max);
+
+	return iovs;
+}
+
+/*
+ * Build iovecs covering the whole range of a partial stripe request for a chunk. The chunk's
+ * accessed range is described by the given iovecs and the rest is padded from pad_buf, at the
+ * same offsets within the range.
+ */
+static struct iovec *
+raid5f_partial_chunk_view(struct stripe_request *stripe_req, struct chunk *chunk, void *pad_buf,
+			  struct iovec *iovs, int iovcnt, size_t *view_iovcnt)
+{
+	uint32_t blocklen = stripe_req->raid_io->raid_bdev->bdev.blocklen;
+	uint64_t range_offset = stripe_req->partial.range_offset;
+	uint64_t range_end = range_offset + stripe_req->partial.range_blocks;
+	uint64_t req_end = chunk->req_offset + chunk->req_blocks;
+	struct iovec *view;
+	int i = 0;
+
+	if (chunk->req_blocks == 0) {
+		view = raid5f_partial_get_iovs(stripe_req, 1);
+		view[0].iov_base = pad_buf;
+		view[0].iov_len = stripe_req->partial.range_blocks * blocklen;
+		*view_iovcnt = 1;
+		return view;
+	}
+
+	assert(chunk->req_offset >= range_offset && req_end <= range_end);
+
+	view = raid5f_partial_get_iovs(stripe_req, iovcnt + 2);
+
+	if (chunk->req_offset > range_offset) {
+		view[i].iov_base = pad_buf;
+		view[i].iov_len = (chunk->req_offset - range_offset) * blocklen;
+		i++;
+	}
+
+	memcpy(&view[i], iovs, iovcnt * sizeof(*iovs));
+	i += iovcnt;
+
+	if (req_end < range_end) {
+		view[i].iov_base = pad_buf + (req_end - range_offset) * blocklen;
+		view[i].iov_len = (range_end - req_end) * blocklen;
+		i++;
+	}
+
+	*view_iovcnt = i;
+
+	return view;
+}
+
+static void
+raid5f_partial_chunk_set_preread(struct stripe_request *stripe_req, struct chunk *chunk,
+				 uint64_t offset, uint64_t num_blocks)
+{
+	uint32_t blocklen = stripe_req->raid_io->raid_bdev->bdev.blocklen;
+
+	chunk->preread_offset = offset;
+	chunk->preread_blocks = num_blocks;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	assert(offset >= stripe_req->partial.range_offset);
+
+	chunk->preread_iovs = raid5f_partial_get_iovs(stripe_req, 1);
+	chunk->preread_iovs[0].iov_base = raid5f_partial_chunk_buf(stripe_req, chunk) +
+					  (offset - stripe_req->partial.range_offset) * blocklen;
+	chunk->preread_iovs[0].iov_len = num_blocks * blocklen;
+	chunk->preread_iovcnt = 1;
+}
+
+static void
+raid5f_partial_request_setup_preread(struct stripe_request *stripe_req)
+{
+	uint64_t range_offset = stripe_req->partial.range_offset;
+	uint64_t range_blocks = stripe_req->partial.range_blocks;
+	uint64_t range_end = range_offset + range_blocks;
+	struct chunk *chunk;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		uint64_t req_end = chunk->req_offset + chunk->req_blocks;
+
+		chunk->preread_blocks = 0;
+
+		if (chunk == stripe_req->partial.missing_chunk) {
+			continue;
+		}
+
+		switch (stripe_req->partial.mode) {
+		case PARTIAL_WRITE_RMW:
+			/* Old data of the updated blocks and the old parity */
+			raid5f_partial_chunk_set_preread(stripe_req, chunk, chunk->req_offset, chunk->req_blocks);
+			break;
+		case PARTIAL_WRITE_RCW:
+			/* Old data of the blocks that are not updated */
+			if (chunk == stripe_req->parity_chunk) {
+				break;
+			} else if (chunk->req_blocks == 0) {
+				raid5f_partial_chunk_set_preread(stripe_req, chunk, range_offset, range_blocks);
+			} else if (chunk->req_offset > range_offset) {
+				assert(req_end == range_end);
+				raid5f_partial_chunk_set_preread(stripe_req, chunk, range_offset,
+								 chunk->req_offset - range_offset);
+			} else {
+				raid5f_partial_chunk_set_preread(stripe_req, chunk, req_end, range_end - req_end);
+			}
+			break;
+		case PARTIAL_WRITE_RCW_RECONSTRUCT:
+			raid5f_partial_chunk_set_preread(stripe_req, chunk, range_offset, range_blocks);
+			break;
+		case PARTIAL_READ_RECONSTRUCT:
+			if (chunk != stripe_req->parity_chunk && chunk->req_blocks > 0) {
+				size_t iovcnt;
+
+				/* Read the requested blocks directly to the raid_io buffers */
+				chunk->preread_offset = range_offset;
+				chunk->preread_blocks = range_blocks;
+				chunk->preread_iovs = raid5f_partial_chunk_view(stripe_req, chunk,
+						      raid5f_partial_chunk_buf(stripe_req, chunk),
+						      chunk->iovs, chunk->iovcnt, &iovcnt);
+				chunk->preread_iovcnt = iovcnt;
+			} else {
+				raid5f_partial_chunk_set_preread(stripe_req, chunk, range_offset, range_blocks);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void
+raid5f_partial_request_complete(struct stripe_request *stripe_req, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	raid5f_stripe_request_release(stripe_req);
+
+	raid_bdev_io_complete(raid_io, status);
+}
+
+static void
+raid5f_partial_request_submit_phase(struct stripe_request *stripe_req, bool preread)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	stripe_req->partial.preread = preread;
+	stripe_req->partial.status = SPDK_BDEV_IO_STATUS_SUCCESS;
+
+	raid_io->base_bdev_io_remaining = raid_io->raid_bdev->num_base_bdevs;
+	raid_io->base_bdev_io_submitted = 0;
+
+	raid5f_stripe_request_submit_chunks(stripe_req);
+}
+
+static void
+raid5f_partial_request_parity_xor_done(struct stripe_request *stripe_req, int status)
+{
+	if (status != 0) {
+		raid5f_partial_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
 	} else {
-		raid5f_stripe_write_request_xor_done(stripe_req, 0);
+		raid5f_partial_request_submit_phase(stripe_req, false);
+	}
+}
+
+static void
+raid5f_partial_request_xor_parity(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	void *zero_buf = raid5f_ch_to_r5f_info(r5ch)->zero_buf;
+	struct chunk *parity_chunk = stripe_req->parity_chunk;
+	struct chunk *chunk;
+	uint32_t c = 0;
+
+	if (stripe_req->partial.mode == PARTIAL_WRITE_RMW) {
+		/* new parity = old parity ^ old data ^ new data */
+		r5ch->chunk_xor_iovs[c] = parity_chunk->preread_iovs;
+		r5ch->chunk_xor_iovcnt[c] = parity_chunk->preread_iovcnt;
+		c++;
+
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			if (chunk->req_blocks == 0) {
+				continue;
+			}
+			r5ch->chunk_xor_iovs[c] = raid5f_partial_chunk_view(stripe_req, chunk, zero_buf,
+						  chunk->preread_iovs, chunk->preread_iovcnt,
+						  &r5ch->chunk_xor_iovcnt[c]);
+			c++;
+			r5ch->chunk_xor_iovs[c] = raid5f_partial_chunk_view(stripe_req, chunk, zero_buf,
+						  chunk->iovs, chunk->iovcnt,
+						  &r5ch->chunk_xor_iovcnt[c]);
+			c++;
+		}
+	} else {
+		/* new parity = new data ^ old data of the blocks that are not updated */
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			r5ch->chunk_xor_iovs[c] = raid5f_partial_chunk_view(stripe_req, chunk,
+						  raid5f_partial_chunk_buf(stripe_req, chunk),
+						  chunk->iovs, chunk->iovcnt,
+						  &r5ch->chunk_xor_iovcnt[c]);
+			c++;
+		}
+	}
+
+	r5ch->chunk_xor_iovs[c] = parity_chunk->iovs;
+	r5ch->chunk_xor_iovcnt[c] = parity_chunk->iovcnt;
+
+	raid5f_xor_stripe_init(stripe_req, c, stripe_req->partial.range_blocks,
+			       raid5f_partial_request_parity_xor_done);
+	raid5f_xor_stripe_continue(stripe_req);
+}
+
+static void
+raid5f_partial_request_reconstruct_xor_done(struct stripe_request *stripe_req, int status)
+{
+	if (status != 0) {
+		raid5f_partial_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+	} else if (stripe_req->partial.mode == PARTIAL_READ_RECONSTRUCT) {
+		raid5f_partial_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_SUCCESS);
+	} else {
+		raid5f_partial_request_xor_parity(stripe_req);
+	}
+}
+
+static void
+raid5f_partial_request_xor_reconstruct(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct chunk *missing_chunk = stripe_req->partial.missing_chunk;
+	struct chunk *chunk;
+	uint32_t c = 0;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		if (chunk == missing_chunk) {
+			continue;
+		}
+		r5ch->chunk_xor_iovs[c] = chunk->preread_iovs;
+		r5ch->chunk_xor_iovcnt[c] = chunk->preread_iovcnt;
+		c++;
+	}
+
+	if (stripe_req->partial.mode == PARTIAL_READ_RECONSTRUCT) {
+		/* Reconstruct the requested blocks directly to the raid_io buffers */
+		r5ch->chunk_xor_iovs[c] = raid5f_partial_chunk_view(stripe_req, missing_chunk,
+					  raid5f_partial_chunk_buf(stripe_req, missing_chunk),
+					  missing_chunk->iovs, missing_chunk->iovcnt,
+					  &r5ch->chunk_xor_iovcnt[c]);
+	} else {
+		struct iovec *iov = raid5f_partial_get_iovs(stripe_req, 1);
+
+		/* The old data is needed only to calculate the new parity */
+		iov->iov_base = raid5f_partial_chunk_buf(stripe_req, missing_chunk);
+		iov->iov_len = stripe_req->partial.range_blocks * stripe_req->raid_io->raid_bdev->bdev.blocklen;
+		r5ch->chunk_xor_iovs[c] = iov;
+		r5ch->chunk_xor_iovcnt[c] = 1;
+	}
+
+	raid5f_xor_stripe_init(stripe_req, c, stripe_req->partial.range_blocks,
+			       raid5f_partial_request_reconstruct_xor_done);
+	raid5f_xor_stripe_continue(stripe_req);
+}
+
+static void
+raid5f_partial_request_phase_done(struct stripe_request *stripe_req)
+{
+	if (stripe_req->partial.status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid5f_partial_request_complete(stripe_req, stripe_req->partial.status);
+		return;
+	}
+
+	if (!stripe_req->partial.preread) {
+		raid5f_partial_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	switch (stripe_req->partial.mode) {
+	case PARTIAL_READ_RECONSTRUCT:
+	case PARTIAL_WRITE_RCW_RECONSTRUCT:
+		raid5f_partial_request_xor_reconstruct(stripe_req);
+		break;
+	case PARTIAL_WRITE_RMW:
+	case PARTIAL_WRITE_RCW:
+		raid5f_partial_request_xor_parity(stripe_req);
+		break;
+	default:
+		assert(false);
+		raid5f_partial_request_complete(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+static void
+raid5f_partial_request_locked(struct stripe_request *stripe_req)
+{
+	if (stripe_req->partial.mode == PARTIAL_WRITE_DATA_ONLY) {
+		raid5f_partial_request_submit_phase(stripe_req, false);
+	} else {
+		raid5f_partial_request_setup_preread(stripe_req);
+		raid5f_partial_request_submit_phase(stripe_req, true);
+	}
+}
+
+static enum partial_request_mode
+raid5f_partial_request_select_mode(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	struct chunk *missing_chunk = stripe_req->partial.missing_chunk;
+	uint64_t range_blocks = stripe_req->partial.range_blocks;
+	uint64_t rmw_blocks = range_blocks;
+	uint64_t rcw_blocks = 0;
+	uint32_t rmw_n_src = 1;
+	struct chunk *chunk;
+
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		if (missing_chunk == NULL || missing_chunk->req_blocks == 0 ||
+		    missing_chunk == stripe_req->parity_chunk) {
+			return PARTIAL_READ;
+		}
+		return PARTIAL_READ_RECONSTRUCT;
+	}
+
+	if (missing_chunk == stripe_req->parity_chunk) {
+		return PARTIAL_WRITE_DATA_ONLY;
+	}
+
+	if (missing_chunk != NULL && missing_chunk->req_blocks > 0) {
+		/*
+		 * The old data of the missing chunk is not available for read-modify-write. It is
+		 * not needed for reconstruct-write only if the chunk is overwritten in the whole range.
+		 */
+		if (missing_chunk->req_blocks == range_blocks) {
+			return PARTIAL_WRITE_RCW;
+		}
+		return PARTIAL_WRITE_RCW_RECONSTRUCT;
+	}
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		if (chunk->req_blocks > 0) {
+			rmw_blocks += chunk->req_blocks;
+			rmw_n_src += 2;
+		}
+		rcw_blocks += range_blocks - chunk->req_blocks;
+	}
+
+	if (rmw_n_src <= RAID5F_MAX_XOR_SRCS && (missing_chunk != NULL || rmw_blocks < rcw_blocks)) {
+		return PARTIAL_WRITE_RMW;
+	}
+
+	if (missing_chunk != NULL) {
+		/* Too many sources for read-modify-write, reconstruct the missing old data instead */
+		return PARTIAL_WRITE_RCW_RECONSTRUCT;
+	}
+
+	return PARTIAL_WRITE_RCW;
+}
+
+static int
+raid5f_partial_request_set_iovcnt(struct stripe_request *stripe_req, int iovcnt)
+{
+	if (iovcnt > stripe_req->partial.iovcnt_max) {
+		struct iovec *iovs = stripe_req->partial.iovs;
+
+		iovs = realloc(iovs, iovcnt * sizeof(*iovs));
+		if (!iovs) {
+			return -ENOMEM;
+		}
+		stripe_req->partial.iovs = iovs;
+		stripe_req->partial.iovcnt_max = iovcnt;
+	}
+	stripe_req->partial.iovcnt = 0;
+
+	return 0;
+}
+
+/*
+ * Handle a read spanning multiple chunks or a write smaller than a full stripe. Only the
+ * accessed range of the chunks, common for all of them, is read and written. Depending on
+ * which base bdev is missing and the size of the write, the parity is updated either from
+ * the old parity and old data (read-modify-write) or from the new data and the old data not
+ * being overwritten (reconstruct-write).
+ */
+static int
+raid5f_submit_partial_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			      uint64_t stripe_offset)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	uint64_t stripe_end = stripe_offset + raid_io->num_blocks;
+	uint64_t range_end = 0;
+	uint64_t chunk_start = 0;
+	struct stripe_request *stripe_req;
+	struct chunk *chunk;
+	int ret;
+
+	assert(raid_io->md_buf == NULL);
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial);
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
+
+	stripe_req->partial.range_offset = raid_bdev->strip_size;
+	stripe_req->partial.missing_chunk = NULL;
+
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		chunk->req_offset = 0;
+		chunk->req_blocks = 0;
+
+		if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, chunk->index) == NULL) {
+			stripe_req->partial.missing_chunk = chunk;
+		}
+	}
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		uint64_t chunk_end = chunk_start + raid_bdev->strip_size;
+		uint64_t start = spdk_max(stripe_offset, chunk_start);
+		uint64_t end = spdk_min(stripe_end, chunk_end);
+
+		if (start < end) {
+			chunk->req_offset = start - chunk_start;
+			chunk->req_blocks = end - start;
+			stripe_req->partial.range_offset = spdk_min(stripe_req->partial.range_offset,
+							   chunk->req_offset);
+			range_end = spdk_max(range_end, chunk->req_offset + chunk->req_blocks);
+		}
+
+		chunk_start = chunk_end;
+	}
+
+	assert(range_end > stripe_req->partial.range_offset);
+	stripe_req->partial.range_blocks = range_end - stripe_req->partial.range_offset;
+
+	ret = raid5f_stripe_request_map_iovecs(stripe_req);
+	if (spdk_unlikely(ret)) {
+		return ret;
+	}
+
+	ret = raid5f_partial_request_set_iovcnt(stripe_req,
+						2 * raid_io->iovcnt + 8 * raid_bdev->num_base_bdevs);
+	if (spdk_unlikely(ret)) {
+		return ret;
+	}
+
+	stripe_req->partial.mode = raid5f_partial_request_select_mode(stripe_req);
+
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
+	    stripe_req->partial.mode != PARTIAL_WRITE_DATA_ONLY) {
+		chunk = stripe_req->parity_chunk;
+		chunk->req_offset = stripe_req->partial.range_offset;
+		chunk->req_blocks = stripe_req->partial.range_blocks;
+		chunk->iovs[0].iov_base = stripe_req->partial.parity_buf;
+		chunk->iovs[0].iov_len = chunk->req_blocks * raid_bdev->bdev.blocklen;
+		chunk->iovcnt = 1;
+	}
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.partial, stripe_req, link);
+
+	raid_io->module_private = stripe_req;
+
+	if (stripe_req->partial.mode == PARTIAL_READ) {
+		raid5f_partial_request_submit_phase(stripe_req, false);
+	} else {
+		raid5f_stripe_request_lock(stripe_req, raid5f_partial_request_locked);
 	}
 
 	return 0;
@@ -763,7 +1523,7 @@ raid5f_submit_reconstruct_read(struct raid_bdev_io *raid_io, uint64_t stripe_ind
 
 	TAILQ_REMOVE(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
 
-	raid5f_stripe_request_submit_chunks(stripe_req);
+	raid5f_stripe_request_lock(stripe_req, raid5f_stripe_request_submit_chunks);
 
 	return 0;
 }
@@ -808,17 +1568,26 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 	struct raid5f_info *r5f_info = raid_bdev->module_private;
 	uint64_t stripe_index = raid_io->offset_blocks / r5f_info->stripe_blocks;
 	uint64_t stripe_offset = raid_io->offset_blocks % r5f_info->stripe_blocks;
+	uint64_t chunk_offset = stripe_offset & (raid_bdev->strip_size - 1);
 	int ret;
 
+	assert(stripe_offset + raid_io->num_blocks <= r5f_info->stripe_blocks);
+
 	switch (raid_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
-		assert(raid_io->num_blocks <= raid_bdev->strip_size);
-		ret = raid5f_submit_read_request(raid_io, stripe_index, stripe_offset);
+		if (chunk_offset + raid_io->num_blocks <= raid_bdev->strip_size) {
+			ret = raid5f_submit_read_request(raid_io, stripe_index, stripe_offset);
+		} else {
+			ret = raid5f_submit_partial_request(raid_io, stripe_index, stripe_offset);
+		}
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		assert(stripe_offset == 0);
-		assert(raid_io->num_blocks == r5f_info->stripe_blocks);
-		ret = raid5f_submit_write_request(raid_io, stripe_index);
+		if (stripe_offset == 0 && raid_io->num_blocks == r5f_info->stripe_blocks) {
+			ret = raid5f_submit_write_request(raid_io, stripe_index);
+		} else {
+			assert(r5f_info->partial_stripe_writes);
+			ret = raid5f_submit_partial_request(raid_io, stripe_index, stripe_offset);
+		}
 		break;
 	default:
 		ret = -EINVAL;
@@ -861,6 +1630,21 @@ raid5f_stripe_request_free(struct stripe_request *stripe_req)
 			}
 			free(stripe_req->reconstruct.chunk_md_buffers);
 		}
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL) {
+		struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+		uint8_t i;
+
+		spdk_dma_free(stripe_req->partial.parity_buf);
+
+		if (stripe_req->partial.chunk_buffers) {
+			for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+				spdk_dma_free(stripe_req->partial.chunk_buffers[i]);
+			}
+			free(stripe_req->partial.chunk_buffers);
+		}
+
+		free(stripe_req->partial.iovs);
 	} else {
 		assert(false);
 	}
@@ -881,6 +1665,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 	struct stripe_request *stripe_req;
 	struct chunk *chunk;
 	size_t chunk_len;
+	uint32_t n_xor;
 
 	stripe_req = calloc(1, sizeof(*stripe_req) + sizeof(*chunk) * raid_bdev->num_base_bdevs);
 	if (!stripe_req) {
@@ -889,6 +1674,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 
 	stripe_req->r5ch = r5ch;
 	stripe_req->type = type;
+	TAILQ_INIT(&stripe_req->lock.waiters);
 
 	FOR_EACH_CHUNK(stripe_req, chunk) {
 		chunk->index = chunk - stripe_req->chunks;
@@ -946,18 +1732,44 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 				stripe_req->reconstruct.chunk_md_buffers[i] = buf;
 			}
 		}
+	} else if (type == STRIPE_REQ_PARTIAL) {
+		void *buf;
+		uint8_t i;
+
+		stripe_req->partial.parity_buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment, NULL);
+		if (!stripe_req->partial.parity_buf) {
+			goto err;
+		}
+
+		stripe_req->partial.chunk_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+		if (!stripe_req->partial.chunk_buffers) {
+			goto err;
+		}
+
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment, NULL);
+			if (!buf) {
+				goto err;
+			}
+			stripe_req->partial.chunk_buffers[i] = buf;
+		}
 	} else {
 		assert(false);
 		return NULL;
 	}
 
-	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid_bdev->num_base_bdevs));
+	/*
+	 * Read-modify-write of a partial stripe xors the old and new data of each chunk with the
+	 * parity, other requests xor one buffer per chunk. The destination buffer is included.
+	 */
+	n_xor = type == STRIPE_REQ_PARTIAL ? 2 * raid_bdev->num_base_bdevs : raid_bdev->num_base_bdevs;
+
+	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(n_xor));
 	if (!stripe_req->chunk_iov_iters) {
 		goto err;
 	}
 
-	stripe_req->chunk_xor_buffers = calloc(raid5f_stripe_data_chunks_num(raid_bdev),
-					       sizeof(stripe_req->chunk_xor_buffers[0]));
+	stripe_req->chunk_xor_buffers = calloc(n_xor, sizeof(stripe_req->chunk_xor_buffers[0]));
 	if (!stripe_req->chunk_xor_buffers) {
 		goto err;
 	}
@@ -992,11 +1804,15 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 		raid5f_stripe_request_free(stripe_req);
 	}
 
+	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial))) {
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.partial, stripe_req, link);
+		raid5f_stripe_request_free(stripe_req);
+	}
+
 	if (r5ch->accel_ch) {
 		spdk_put_io_channel(r5ch->accel_ch);
 	}
 
-	free(r5ch->chunk_xor_buffers);
 	free(r5ch->chunk_xor_iovs);
 	free(r5ch->chunk_xor_iovcnt);
 }
@@ -1012,6 +1828,7 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 
 	TAILQ_INIT(&r5ch->free_stripe_requests.write);
 	TAILQ_INIT(&r5ch->free_stripe_requests.reconstruct);
+	TAILQ_INIT(&r5ch->free_stripe_requests.partial);
 	TAILQ_INIT(&r5ch->xor_retry_queue);
 
 	for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
@@ -1032,23 +1849,27 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
 	}
 
+	for (i = 0; r5f_info->partial_stripe_writes && i < RAID5F_MAX_STRIPES; i++) {
+		stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_PARTIAL);
+		if (!stripe_req) {
+			goto err;
+		}
+
+		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.partial, stripe_req, link);
+	}
+
 	r5ch->accel_ch = spdk_accel_get_io_channel();
 	if (!r5ch->accel_ch) {
 		SPDK_ERRLOG("Failed to get accel framework's IO channel\n");
 		goto err;
 	}
 
-	r5ch->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_buffers));
-	if (!r5ch->chunk_xor_buffers) {
-		goto err;
-	}
-
-	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovs));
+	r5ch->chunk_xor_iovs = calloc(2 * raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovs));
 	if (!r5ch->chunk_xor_iovs) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovcnt));
+	r5ch->chunk_xor_iovcnt = calloc(2 * raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovcnt));
 	if (!r5ch->chunk_xor_iovcnt) {
 		goto err;
 	}
@@ -1069,6 +1890,7 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	struct spdk_bdev *base_bdev;
 	struct raid5f_info *r5f_info;
 	size_t alignment = 0;
+	int i;
 
 	r5f_info = calloc(1, sizeof(*r5f_info));
 	if (!r5f_info) {
@@ -1099,10 +1921,35 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	}
 
 	raid_bdev->bdev.blockcnt = r5f_info->stripe_blocks * r5f_info->total_stripes;
-	raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
-	raid_bdev->bdev.split_on_optimal_io_boundary = true;
-	raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
-	raid_bdev->bdev.split_on_write_unit = true;
+
+	/*
+	 * Partial stripe writes calculate parity over the data buffers, so separate metadata
+	 * requires full stripe writes.
+	 */
+	r5f_info->partial_stripe_writes = raid_bdev->bdev.md_len == 0 || raid_bdev->bdev.md_interleave;
+
+	if (r5f_info->partial_stripe_writes) {
+		r5f_info->zero_buf = spdk_dma_zmalloc(raid_bdev->strip_size * raid_bdev->bdev.blocklen,
+						      alignment, NULL);
+		if (!r5f_info->zero_buf) {
+			SPDK_ERRLOG("Failed to allocate zero buffer\n");
+			free(r5f_info);
+			return -ENOMEM;
+		}
+
+		spdk_spin_init(&r5f_info->stripe_lock);
+		for (i = 0; i < RAID5F_STRIPE_LOCK_BUCKETS; i++) {
+			TAILQ_INIT(&r5f_info->locked_stripes[i]);
+		}
+
+		raid_bdev->bdev.optimal_io_boundary = r5f_info->stripe_blocks;
+		raid_bdev->bdev.split_on_optimal_io_boundary = true;
+	} else {
+		raid_bdev->bdev.optimal_io_boundary = raid_bdev->strip_size;
+		raid_bdev->bdev.split_on_optimal_io_boundary = true;
+		raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
+		raid_bdev->bdev.split_on_write_unit = true;
+	}
 
 	raid_bdev->module_private = r5f_info;
 
@@ -1119,6 +1966,11 @@ raid5f_io_device_unregister_done(void *io_device)
 
 	raid_bdev_module_stop_done(r5f_info->raid_bdev);
 
+	if (r5f_info->partial_stripe_writes) {
+		spdk_spin_destroy(&r5f_info->stripe_lock);
+		spdk_dma_free(r5f_info->zero_buf);
+	}
+
 	free(r5f_info);
 }
 
@@ -19,8 +19,17 @@
 #include "spdk/file.h"
 
 #include "spdk/log.h"
+#include "spdk/nvme_spec.h"
 #include "spdk_internal/uring.h"
 
+#include <linux/falloc.h>
+#include <linux/nvme_ioctl.h>
+#include <sys/sysmacros.h>
+
+#if defined(IORING_SETUP_SQE128) && defined(NVME_URING_CMD_IO)
+#define SPDK_URING_NVME_PASSTHRU
+#endif
+
 #ifdef SPDK_CONFIG_URING_ZNS
 #include <linux/blkzoned.h>
 #define SECTOR_SHIFT 9
@@ -32,20 +41,52 @@ struct bdev_uring_zoned_dev {
 	uint32_t		lba_shift;
 };
 
-struct bdev_uring_io_channel {
-	struct bdev_uring_group_channel		*group_ch;
-};
+#define SPDK_URING_QUEUE_DEPTH 512
+#define MAX_EVENTS_PER_POLL 32
+#define SPDK_URING_MAX_FIXED_FILES 64
+#define SPDK_URING_MAX_FIXED_BUFFERS 16
 
-struct bdev_uring_group_channel {
+/* Bdevs are only put on a ring set up with the same flags */
+#define BDEV_URING_RING_SQPOLL		(1 << 0)
+#define BDEV_URING_RING_IOPOLL		(1 << 1)
+/* 128 byte SQEs and 32 byte CQEs, for NVMe commands */
+#define BDEV_URING_RING_NVME		(1 << 2)
+#define BDEV_URING_RING_COUNT		(1 << 3)
+
+#define BDEV_URING_NVME_SQE_SIZE	128
+#define BDEV_URING_NVME_MAX_NLB		65536
+
+struct bdev_uring_ring {
+	struct io_uring				uring;
+	bool					initialized;
+	bool					fixed_files;
 	uint64_t				io_inflight;
 	uint64_t				io_pending;
+	/* Table of registered files, -1 for free slots */
+	int					files[SPDK_URING_MAX_FIXED_FILES];
+	/* Registered buffers, covering the iobuf pools */
+	struct iovec				buffers[SPDK_URING_MAX_FIXED_BUFFERS];
+	uint32_t				num_buffers;
+};
+
+struct bdev_uring_group_channel {
 	struct spdk_poller			*poller;
-	struct io_uring				uring;
+	struct bdev_uring_ring			rings[BDEV_URING_RING_COUNT];
+};
+
+struct bdev_uring_io_channel {
+	struct bdev_uring_group_channel		*group_ch;
+	struct bdev_uring_ring			*ring;
+	/* Index of the file in the ring's registered files, -1 if not registered */
+	int					fixed_file;
 };
 
 struct bdev_uring_task {
 	uint64_t			len;
 	struct bdev_uring_io_channel	*ch;
+	/* Submitted as an NVMe command, completed with the NVMe status */
+	bool				nvme;
+	struct spdk_nvme_dsm_range	dsm_range;
 	TAILQ_ENTRY(bdev_uring_task)	link;
 };
 
@@ -54,17 +95,28 @@ struct bdev_uring {
 	struct bdev_uring_zoned_dev	zd;
 	char			*filename;
 	int			fd;
+	bool			direct;
+	bool			blockdev;
+	bool			sqpoll;
+	bool			iopoll;
+	bool			flush_supported;
+	bool			unmap_supported;
+	bool			write_zeroes_supported;
+	/* NVMe generic character device, all I/O is submitted as NVMe commands */
+	bool			nvme_passthru;
+	uint32_t		nsid;
+	/* NVMe controller character device for admin commands, -1 if not available */
+	int			ctrlr_fd;
 	TAILQ_ENTRY(bdev_uring)  link;
 };
 
 static int bdev_uring_init(void);
 static void bdev_uring_fini(void);
 static void uring_free_bdev(struct bdev_uring *uring);
+static int bdev_uring_nvme_get_ns_size(struct bdev_uring *uring, uint32_t *block_size,
+		uint64_t *blockcnt);
 static TAILQ_HEAD(, bdev_uring) g_uring_bdev_head = TAILQ_HEAD_INITIALIZER(g_uring_bdev_head);
 
-#define SPDK_URING_QUEUE_DEPTH 512
-#define MAX_EVENTS_PER_POLL 32
-
 static int
 bdev_uring_get_ctx_size(void)
 {
@@ -85,9 +137,11 @@ bdev_uring_open(struct bdev_uring *bdev)
 {
 	int fd;
 
+	bdev->direct = true;
 	fd = open(bdev->filename, O_RDWR | O_DIRECT | O_NOATIME);
 	if (fd < 0) {
 		/* Try without O_DIRECT for non-disk files */
+		bdev->direct = false;
 		fd = open(bdev->filename, O_RDWR | O_NOATIME);
 		if (fd < 0) {
 			SPDK_ERRLOG("open() failed (file:%s), errno %d: %s\n",
@@ -114,6 +168,7 @@ bdev_uring_rescan(const char *name)
 	struct spdk_bdev *bdev;
 	struct bdev_uring *uring;
 	uint64_t uring_size, blockcnt;
+	uint32_t block_size;
 	int rc;
 
 	rc = spdk_bdev_open_ext(name, false, dummy_bdev_event_cb, NULL, &desc);
@@ -128,8 +183,15 @@ bdev_uring_rescan(const char *name)
 	}
 
 	uring = SPDK_CONTAINEROF(bdev, struct bdev_uring, bdev);
-	uring_size = spdk_fd_get_size(uring->fd);
-	blockcnt = uring_size / bdev->blocklen;
+	if (uring->nvme_passthru) {
+		rc = bdev_uring_nvme_get_ns_size(uring, &block_size, &blockcnt);
+		if (rc != 0) {
+			goto exit;
+		}
+	} else {
+		uring_size = spdk_fd_get_size(uring->fd);
+		blockcnt = uring_size / bdev->blocklen;
+	}
 
 	if (bdev->blockcnt != blockcnt) {
 		SPDK_NOTICELOG("URING device is resized: bdev name %s, old block count %" PRIu64
@@ -156,6 +218,11 @@ bdev_uring_close(struct bdev_uring *bdev)
 {
 	int rc;
 
+	if (bdev->ctrlr_fd >= 0) {
+		close(bdev->ctrlr_fd);
+		bdev->ctrlr_fd = -1;
+	}
+
 	if (bdev->fd == -1) {
 		return 0;
 	}
@@ -172,30 +239,72 @@ bdev_uring_close(struct bdev_uring *bdev)
 	return 0;
 }
 
+static int
+bdev_uring_find_fixed_buffer(struct bdev_uring_ring *ring, const struct iovec *iov)
+{
+	uintptr_t start, base = (uintptr_t)iov->iov_base;
+	uint32_t i;
+
+	for (i = 0; i < ring->num_buffers; i++) {
+		start = (uintptr_t)ring->buffers[i].iov_base;
+		if (base >= start && base + iov->iov_len <= start + ring->buffers[i].iov_len) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int
+bdev_uring_get_fd(struct bdev_uring *uring, struct bdev_uring_io_channel *uring_ch)
+{
+	return uring_ch->fixed_file >= 0 ? uring_ch->fixed_file : uring->fd;
+}
+
+static void
+bdev_uring_sqe_set_file_flags(struct io_uring_sqe *sqe, struct bdev_uring_io_channel *uring_ch)
+{
+	if (uring_ch->fixed_file >= 0) {
+		io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+	}
+}
+
 static int64_t
 bdev_uring_readv(struct bdev_uring *uring, struct spdk_io_channel *ch,
 		 struct bdev_uring_task *uring_task,
 		 struct iovec *iov, int iovcnt, uint64_t nbytes, uint64_t offset)
 {
 	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
-	struct bdev_uring_group_channel *group_ch = uring_ch->group_ch;
+	struct bdev_uring_ring *ring = uring_ch->ring;
 	struct io_uring_sqe *sqe;
+	int fd, buf_index = -1;
 
-	sqe = io_uring_get_sqe(&group_ch->uring);
+	sqe = io_uring_get_sqe(&ring->uring);
 	if (!sqe) {
 		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
 		return -ENOMEM;
 	}
 
-	io_uring_prep_readv(sqe, uring->fd, iov, iovcnt, offset);
+	fd = bdev_uring_get_fd(uring, uring_ch);
+	if (iovcnt == 1) {
+		buf_index = bdev_uring_find_fixed_buffer(ring, &iov[0]);
+	}
+
+	if (buf_index >= 0) {
+		io_uring_prep_read_fixed(sqe, fd, iov[0].iov_base, iov[0].iov_len, offset, buf_index);
+	} else {
+		io_uring_prep_readv(sqe, fd, iov, iovcnt, offset);
+	}
+	bdev_uring_sqe_set_file_flags(sqe, uring_ch);
 	io_uring_sqe_set_data(sqe, uring_task);
 	uring_task->len = nbytes;
+	uring_task->nvme = false;
 	uring_task->ch = uring_ch;
 
 	SPDK_DEBUGLOG(uring, "read %d iovs size %lu to off: %#lx\n",
 		      iovcnt, nbytes, offset);
 
-	group_ch->io_pending++;
+	ring->io_pending++;
 	return nbytes;
 }
 
@@ -205,27 +314,414 @@ bdev_uring_writev(struct bdev_uring *uring, struct spdk_io_channel *ch,
 		  struct iovec *iov, int iovcnt, size_t nbytes, uint64_t offset)
 {
 	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
-	struct bdev_uring_group_channel *group_ch = uring_ch->group_ch;
+	struct bdev_uring_ring *ring = uring_ch->ring;
 	struct io_uring_sqe *sqe;
+	int fd, buf_index = -1;
 
-	sqe = io_uring_get_sqe(&group_ch->uring);
+	sqe = io_uring_get_sqe(&ring->uring);
 	if (!sqe) {
 		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
 		return -ENOMEM;
 	}
 
-	io_uring_prep_writev(sqe, uring->fd, iov, iovcnt, offset);
+	fd = bdev_uring_get_fd(uring, uring_ch);
+	if (iovcnt == 1) {
+		buf_index = bdev_uring_find_fixed_buffer(ring, &iov[0]);
+	}
+
+	if (buf_index >= 0) {
+		io_uring_prep_write_fixed(sqe, fd, iov[0].iov_base, iov[0].iov_len, offset, buf_index);
+	} else {
+		io_uring_prep_writev(sqe, fd, iov, iovcnt, offset);
+	}
+	bdev_uring_sqe_set_file_flags(sqe, uring_ch);
 	io_uring_sqe_set_data(sqe, uring_task);
 	uring_task->len = nbytes;
+	uring_task->nvme = false;
 	uring_task->ch = uring_ch;
 
 	SPDK_DEBUGLOG(uring, "write %d iovs size %lu from off: %#lx\n",
 		      iovcnt, nbytes, offset);
 
-	group_ch->io_pending++;
+	ring->io_pending++;
 	return nbytes;
 }
 
+static int64_t
+bdev_uring_submit_file_cmd(struct bdev_uring *uring, struct spdk_io_channel *ch,
+			   struct bdev_uring_task *uring_task, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
+	struct bdev_uring_ring *ring = uring_ch->ring;
+	uint64_t offset = bdev_io->u.bdev.offset_blocks * uring->bdev.blocklen;
+	uint64_t len = bdev_io->u.bdev.num_blocks * uring->bdev.blocklen;
+	struct io_uring_sqe *sqe;
+	int fd, mode;
+
+	sqe = io_uring_get_sqe(&ring->uring);
+	if (!sqe) {
+		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
+		return -ENOMEM;
+	}
+
+	fd = bdev_uring_get_fd(uring, uring_ch);
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		io_uring_prep_fsync(sqe, fd, IORING_FSYNC_DATASYNC);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		/* Punching a hole in a block device discards the range if the device can
+		 * guarantee zeroes, zeroing a range of a block device writes the zeroes if
+		 * needed.  Holes in regular files always read back as zeroes. */
+		if (uring->blockdev && bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE_ZEROES) {
+			mode = FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE;
+		} else {
+			mode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+		}
+		io_uring_prep_fallocate(sqe, fd, mode, offset, len);
+		break;
+	default:
+		assert(false);
+		return -EINVAL;
+	}
+	bdev_uring_sqe_set_file_flags(sqe, uring_ch);
+	io_uring_sqe_set_data(sqe, uring_task);
+	uring_task->len = 0;
+	uring_task->nvme = false;
+	uring_task->ch = uring_ch;
+
+	SPDK_DEBUGLOG(uring, "io type %d size %lu at off: %#lx\n", bdev_io->type, len, offset);
+
+	ring->io_pending++;
+	return 0;
+}
+
+#ifdef SPDK_URING_NVME_PASSTHRU
+static void
+bdev_uring_nvme_cmd_set_lba(struct nvme_uring_cmd *cmd, uint64_t lba, uint32_t num_blocks)
+{
+	cmd->cdw10 = (uint32_t)lba;
+	cmd->cdw11 = (uint32_t)(lba >> 32);
+	cmd->cdw12 = num_blocks - 1;
+}
+
+static void
+bdev_uring_nvme_cmd_copy(struct nvme_uring_cmd *cmd, const struct spdk_nvme_cmd *nvme_cmd)
+{
+	cmd->opcode = nvme_cmd->opc;
+	cmd->nsid = nvme_cmd->nsid;
+	cmd->cdw2 = nvme_cmd->rsvd2;
+	cmd->cdw3 = nvme_cmd->rsvd3;
+	cmd->cdw10 = nvme_cmd->cdw10;
+	cmd->cdw11 = nvme_cmd->cdw11;
+	cmd->cdw12 = nvme_cmd->cdw12;
+	cmd->cdw13 = nvme_cmd->cdw13;
+	cmd->cdw14 = nvme_cmd->cdw14;
+	cmd->cdw15 = nvme_cmd->cdw15;
+}
+
+static int64_t
+bdev_uring_submit_nvme_cmd(struct bdev_uring *uring, struct spdk_io_channel *ch,
+			   struct bdev_uring_task *uring_task, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
+	struct bdev_uring_ring *ring = uring_ch->ring;
+	uint64_t lba = bdev_io->u.bdev.offset_blocks;
+	uint32_t num_blocks = bdev_io->u.bdev.num_blocks;
+	struct iovec *iovs = NULL;
+	int iovcnt = 0;
+	bool admin = false;
+	struct nvme_uring_cmd *cmd;
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&ring->uring);
+	if (!sqe) {
+		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
+		return -ENOMEM;
+	}
+
+	memset(sqe, 0, BDEV_URING_NVME_SQE_SIZE);
+	cmd = (struct nvme_uring_cmd *)sqe->cmd;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		cmd->opcode = bdev_io->type == SPDK_BDEV_IO_TYPE_READ ?
+			      SPDK_NVME_OPC_READ : SPDK_NVME_OPC_WRITE;
+		bdev_uring_nvme_cmd_set_lba(cmd, lba, num_blocks);
+		iovs = bdev_io->u.bdev.iovs;
+		iovcnt = bdev_io->u.bdev.iovcnt;
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		cmd->opcode = SPDK_NVME_OPC_FLUSH;
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		cmd->opcode = SPDK_NVME_OPC_WRITE_ZEROES;
+		bdev_uring_nvme_cmd_set_lba(cmd, lba, num_blocks);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		uring_task->dsm_range.attributes.raw = 0;
+		uring_task->dsm_range.length = num_blocks;
+		uring_task->dsm_range.starting_lba = lba;
+		cmd->opcode = SPDK_NVME_OPC_DATASET_MANAGEMENT;
+		cmd->cdw11 = SPDK_NVME_DSM_ATTR_DEALLOCATE;
+		cmd->addr = (uintptr_t)&uring_task->dsm_range;
+		cmd->data_len = sizeof(uring_task->dsm_range);
+		break;
+	case SPDK_BDEV_IO_TYPE_NVME_ADMIN:
+		admin = true;
+	/* fallthrough */
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+		bdev_uring_nvme_cmd_copy(cmd, &bdev_io->u.nvme_passthru.cmd);
+		if (bdev_io->u.nvme_passthru.iovcnt > 0) {
+			iovs = bdev_io->u.nvme_passthru.iovs;
+			iovcnt = bdev_io->u.nvme_passthru.iovcnt;
+		} else {
+			cmd->addr = (uintptr_t)bdev_io->u.nvme_passthru.buf;
+			cmd->data_len = bdev_io->u.nvme_passthru.nbytes;
+		}
+		cmd->metadata = (uintptr_t)bdev_io->u.nvme_passthru.md_buf;
+		cmd->metadata_len = bdev_io->u.nvme_passthru.md_len;
+		break;
+	default:
+		assert(false);
+		return -EINVAL;
+	}
+
+	if (iovcnt == 1) {
+		cmd->addr = (uintptr_t)iovs[0].iov_base;
+		cmd->data_len = iovs[0].iov_len;
+		iovcnt = 0;
+	} else if (iovcnt > 1) {
+		cmd->addr = (uintptr_t)iovs;
+		cmd->data_len = iovcnt;
+	}
+
+	sqe->opcode = IORING_OP_URING_CMD;
+	if (admin) {
+		/* Admin commands are only accepted by the controller's device */
+		sqe->fd = uring->ctrlr_fd;
+		sqe->cmd_op = iovcnt > 1 ? NVME_URING_CMD_ADMIN_VEC : NVME_URING_CMD_ADMIN;
+	} else {
+		/* Each bdev is a single namespace, so fill in its NSID */
+		cmd->nsid = uring->nsid;
+		sqe->fd = bdev_uring_get_fd(uring, uring_ch);
+		sqe->cmd_op = iovcnt > 1 ? NVME_URING_CMD_IO_VEC : NVME_URING_CMD_IO;
+		bdev_uring_sqe_set_file_flags(sqe, uring_ch);
+	}
+	io_uring_sqe_set_data(sqe, uring_task);
+	uring_task->len = 0;
+	uring_task->nvme = true;
+	uring_task->ch = uring_ch;
+
+	SPDK_DEBUGLOG(uring, "nvme opc %#x %d iovs\n", cmd->opcode, iovcnt);
+
+	ring->io_pending++;
+	return 0;
+}
+
+static int
+bdev_uring_nvme_identify(int fd, uint32_t nsid, uint8_t cns, void *buf)
+{
+	struct nvme_admin_cmd cmd = {
+		.opcode = SPDK_NVME_OPC_IDENTIFY,
+		.nsid = nsid,
+		.addr = (uintptr_t)buf,
+		.data_len = 4096,
+		.cdw10 = cns,
+	};
+	int rc;
+
+	rc = ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd);
+	if (rc < 0) {
+		return -errno;
+	}
+
+	/* A positive value is the NVMe status of the command */
+	return rc == 0 ? 0 : -EIO;
+}
+
+static int
+bdev_uring_nvme_get_ns_size(struct bdev_uring *uring, uint32_t *block_size, uint64_t *blockcnt)
+{
+	struct spdk_nvme_ns_data *nsdata;
+	uint32_t format;
+	int rc;
+
+	nsdata = calloc(1, sizeof(*nsdata));
+	if (nsdata == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = bdev_uring_nvme_identify(uring->fd, uring->nsid, SPDK_NVME_IDENTIFY_NS, nsdata);
+	if (rc != 0) {
+		SPDK_ERRLOG("Identify namespace failed (file:%s): %s\n", uring->filename,
+			    spdk_strerror(-rc));
+		goto out;
+	}
+
+	format = nsdata->flbas.format;
+	if (nsdata->nlbaf > 16) {
+		format |= nsdata->flbas.msb_format << 4;
+	}
+
+	if (nsdata->lbaf[format].ms != 0) {
+		SPDK_ERRLOG("Namespace formats with metadata are not supported (file:%s)\n",
+			    uring->filename);
+		rc = -ENOTSUP;
+		goto out;
+	}
+
+	*block_size = 1u << nsdata->lbaf[format].lbads;
+	*blockcnt = nsdata->nsze;
+out:
+	free(nsdata);
+	return rc;
+}
+
+static int
+bdev_uring_nvme_open_ctrlr(struct bdev_uring *uring)
+{
+	char resolved_path[PATH_MAX], *filename_dup, *base;
+	char *sysfs_path, *ctrlr_path;
+	int rc = -ENODEV;
+
+	filename_dup = strdup(uring->filename);
+	if (filename_dup == NULL) {
+		return -ENOMEM;
+	}
+
+	/* The parent of a namespace's generic device is its controller, or the subsystem
+	 * for multipath namespaces, for which admin commands are not supported. */
+	base = basename(filename_dup);
+	sysfs_path = spdk_sprintf_alloc("/sys/class/nvme-generic/%s/device", base);
+	free(filename_dup);
+	if (sysfs_path == NULL) {
+		return -ENOMEM;
+	}
+
+	if (realpath(sysfs_path, resolved_path) != NULL) {
+		base = basename(resolved_path);
+		if (strncmp(base, "nvme", 4) == 0 && isdigit(base[4])) {
+			ctrlr_path = spdk_sprintf_alloc("/dev/%s", base);
+			if (ctrlr_path != NULL) {
+				uring->ctrlr_fd = open(ctrlr_path, O_RDWR);
+				rc = uring->ctrlr_fd >= 0 ? 0 : -errno;
+				free(ctrlr_path);
+			}
+		}
+	}
+	free(sysfs_path);
+
+	return rc;
+}
+
+static int
+bdev_uring_nvme_init(struct bdev_uring *uring, uint32_t *block_size, uint64_t *bdev_size)
+{
+	struct spdk_nvme_ctrlr_data *cdata;
+	uint64_t blockcnt, max_bytes;
+	int rc;
+
+	rc = ioctl(uring->fd, NVME_IOCTL_ID);
+	if (rc <= 0) {
+		SPDK_ERRLOG("%s is not an NVMe namespace\n", uring->filename);
+		return -ENODEV;
+	}
+	uring->nsid = rc;
+
+	rc = bdev_uring_nvme_get_ns_size(uring, block_size, &blockcnt);
+	if (rc != 0) {
+		return rc;
+	}
+	*bdev_size = blockcnt * *block_size;
+
+	cdata = calloc(1, sizeof(*cdata));
+	if (cdata == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = bdev_uring_nvme_identify(uring->fd, 0, SPDK_NVME_IDENTIFY_CTRLR, cdata);
+	if (rc != 0) {
+		SPDK_ERRLOG("Identify controller failed (file:%s): %s\n", uring->filename,
+			    spdk_strerror(-rc));
+		free(cdata);
+		return rc;
+	}
+
+	uring->flush_supported = true;
+	uring->unmap_supported = cdata->oncs.dsm;
+	uring->write_zeroes_supported = cdata->oncs.write_zeroes;
+
+	/* Passthrough commands are not split by the kernel.  MDTS is in units of the minimum
+	 * memory page size, assume it's 4KiB. */
+	uring->bdev.max_rw_size = BDEV_URING_NVME_MAX_NLB;
+	if (cdata->mdts != 0 && cdata->mdts < 32) {
+		max_bytes = 4096ULL << cdata->mdts;
+		uring->bdev.max_rw_size = spdk_min(max_bytes / *block_size, BDEV_URING_NVME_MAX_NLB);
+	}
+	uring->bdev.max_write_zeroes = BDEV_URING_NVME_MAX_NLB;
+	uring->bdev.max_unmap = UINT32_MAX;
+	uring->bdev.max_unmap_segments = 1;
+	free(cdata);
+
+	if (bdev_uring_nvme_open_ctrlr(uring) != 0) {
+		SPDK_NOTICELOG("NVMe admin commands are not supported (file:%s)\n", uring->filename);
+	}
+
+	return 0;
+}
+#else
+static int64_t
+bdev_uring_submit_nvme_cmd(struct bdev_uring *uring, struct spdk_io_channel *ch,
+			   struct bdev_uring_task *uring_task, struct spdk_bdev_io *bdev_io)
+{
+	return -ENOTSUP;
+}
+
+static int
+bdev_uring_nvme_get_ns_size(struct bdev_uring *uring, uint32_t *block_size, uint64_t *blockcnt)
+{
+	return -ENOTSUP;
+}
+
+static int
+bdev_uring_nvme_init(struct bdev_uring *uring, uint32_t *block_size, uint64_t *bdev_size)
+{
+	SPDK_ERRLOG("NVMe passthrough is not supported by this build (file:%s)\n", uring->filename);
+	return -ENOTSUP;
+}
+#endif
+
+static bool
+bdev_uring_blockdev_write_zeroes_supported(int fd)
+{
+	struct stat st;
+	char *str = NULL;
+	bool supported = false;
+	int rc;
+
+	if (fstat(fd, &st) != 0) {
+		return false;
+	}
+
+	/* Partitions have no queue directory of their own */
+	rc = spdk_read_sysfs_attribute(&str, "/sys/dev/block/%u:%u/queue/write_zeroes_max_bytes",
+				       major(st.st_rdev), minor(st.st_rdev));
+	if (rc != 0) {
+		rc = spdk_read_sysfs_attribute(&str, "/sys/dev/block/%u:%u/../queue/write_zeroes_max_bytes",
+					       major(st.st_rdev), minor(st.st_rdev));
+	}
+
+	if (rc == 0) {
+		supported = strtoull(str, NULL, 10) > 0;
+		free(str);
+	}
+
+	return supported;
+}
+
 static int
 bdev_uring_destruct(void *ctx)
 {
@@ -243,7 +739,7 @@ bdev_uring_destruct(void *ctx)
 }
 
 static int
-bdev_uring_reap(struct io_uring *ring, int max)
+bdev_uring_reap(struct bdev_uring_ring *ring, int max)
 {
 	int i, count, ret;
 	struct io_uring_cqe *cqe;
@@ -252,7 +748,7 @@ bdev_uring_reap(struct io_uring *ring, int max)
 
 	count = 0;
 	for (i = 0; i < max; i++) {
-		ret = io_uring_peek_cqe(ring, &cqe);
+		ret = io_uring_peek_cqe(&ring->uring, &cqe);
 		if (ret != 0) {
 			return ret;
 		}
@@ -262,59 +758,86 @@ bdev_uring_reap(struct io_uring *ring, int max)
 		}
 
 		uring_task = (struct bdev_uring_task *)cqe->user_data;
+		ring->io_inflight--;
+		count++;
+
+#ifdef SPDK_URING_NVME_PASSTHRU
+		if (uring_task->nvme && cqe->res >= 0) {
+			/* res holds the NVMe status field and the extra CQE space the result */
+			uint32_t cdw0 = (uint32_t)cqe->big_cqe[0];
+			int res = cqe->res;
+
+			io_uring_cqe_seen(&ring->uring, cqe);
+			spdk_bdev_io_complete_nvme_status(spdk_bdev_io_from_ctx(uring_task), cdw0,
+							  (res >> 8) & 0x7, res & 0xff);
+			continue;
+		}
+#endif
+
 		if (cqe->res != (signed)uring_task->len) {
 			status = SPDK_BDEV_IO_STATUS_FAILED;
 		} else {
 			status = SPDK_BDEV_IO_STATUS_SUCCESS;
 		}
 
-		uring_task->ch->group_ch->io_inflight--;
-		io_uring_cqe_seen(ring, cqe);
+		io_uring_cqe_seen(&ring->uring, cqe);
 		spdk_bdev_io_complete(spdk_bdev_io_from_ctx(uring_task), status);
-		count++;
 	}
 
 	return count;
 }
 
 static int
-bdev_uring_group_poll(void *arg)
+bdev_uring_ring_poll(struct bdev_uring_ring *ring)
 {
-	struct bdev_uring_group_channel *group_ch = arg;
 	int to_complete, to_submit;
 	int count, ret;
 
-	to_submit = group_ch->io_pending;
+	to_submit = ring->io_pending;
 
 	if (to_submit > 0) {
 		/* If there are I/O to submit, use io_uring_submit here.
-		 * It will automatically call spdk_io_uring_enter appropriately. */
-		ret = io_uring_submit(&group_ch->uring);
+		 * It will automatically call spdk_io_uring_enter appropriately.
+		 * With SQPOLL, it only enters the kernel to wake up the SQ thread. */
+		ret = io_uring_submit(&ring->uring);
 		if (ret < 0) {
-			return SPDK_POLLER_BUSY;
+			return 1;
 		}
 
-		group_ch->io_pending = 0;
-		group_ch->io_inflight += to_submit;
+		ring->io_pending = 0;
+		ring->io_inflight += to_submit;
 	}
 
-	to_complete = group_ch->io_inflight;
+	to_complete = ring->io_inflight;
 	count = 0;
 	if (to_complete > 0) {
-		count = bdev_uring_reap(&group_ch->uring, to_complete);
+		/* With IOPOLL, peeking for completions also polls the device */
+		count = spdk_max(bdev_uring_reap(ring, to_complete), 0);
 	}
 
-	if (count + to_submit > 0) {
-		return SPDK_POLLER_BUSY;
-	} else {
-		return SPDK_POLLER_IDLE;
+	return count + to_submit;
+}
+
+static int
+bdev_uring_group_poll(void *arg)
+{
+	struct bdev_uring_group_channel *group_ch = arg;
+	int i, count = 0;
+
+	for (i = 0; i < BDEV_URING_RING_COUNT; i++) {
+		if (group_ch->rings[i].initialized) {
+			count += bdev_uring_ring_poll(&group_ch->rings[i]);
+		}
 	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
 static void
 bdev_uring_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		      bool success)
 {
+	struct bdev_uring *uring = bdev_io->bdev->ctxt;
 	int64_t ret = 0;
 
 	if (!success) {
@@ -322,6 +845,15 @@ bdev_uring_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 		return;
 	}
 
+	if (uring->nvme_passthru) {
+		ret = bdev_uring_submit_nvme_cmd(uring, ch, (struct bdev_uring_task *)bdev_io->driver_ctx,
+						 bdev_io);
+		if (ret == -ENOMEM) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		}
+		return;
+	}
+
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 		ret = bdev_uring_readv((struct bdev_uring *)bdev_io->bdev->ctxt,
@@ -613,6 +1145,9 @@ bdev_uring_check_zoned_support(struct bdev_uring *uring, const char *name, const
 static int
 _bdev_uring_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
 {
+	struct bdev_uring *uring = bdev_io->bdev->ctxt;
+	struct bdev_uring_task *uring_task = (struct bdev_uring_task *)bdev_io->driver_ctx;
+	int64_t rc;
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_GET_ZONE_INFO:
@@ -627,6 +1162,21 @@ _bdev_uring_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev
 		spdk_bdev_io_get_buf(bdev_io, bdev_uring_get_buf_cb,
 				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
 		return 0;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+	case SPDK_BDEV_IO_TYPE_NVME_ADMIN:
+		if (uring->nvme_passthru) {
+			rc = bdev_uring_submit_nvme_cmd(uring, ch, uring_task, bdev_io);
+		} else {
+			rc = bdev_uring_submit_file_cmd(uring, ch, uring_task, bdev_io);
+		}
+		if (rc == -ENOMEM) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+			return 0;
+		}
+		return rc;
 	default:
 		return -1;
 	}
@@ -643,6 +1193,8 @@ bdev_uring_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_
 static bool
 bdev_uring_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
+	struct bdev_uring *uring = ctx;
+
 	switch (io_type) {
 #ifdef SPDK_CONFIG_URING_ZNS
 	case SPDK_BDEV_IO_TYPE_GET_ZONE_INFO:
@@ -651,18 +1203,160 @@ bdev_uring_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
 		return true;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return uring->flush_supported;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		return uring->unmap_supported;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return uring->write_zeroes_supported;
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+		return uring->nvme_passthru;
+	case SPDK_BDEV_IO_TYPE_NVME_ADMIN:
+		return uring->nvme_passthru && uring->ctrlr_fd >= 0;
 	default:
 		return false;
 	}
 }
 
+static int
+bdev_uring_ring_init(struct bdev_uring_ring *ring, uint32_t type)
+{
+	struct io_uring_params params = {};
+	uint32_t num_buffers;
+	int i, rc;
+
+	if (type & BDEV_URING_RING_SQPOLL) {
+		params.flags |= IORING_SETUP_SQPOLL;
+	}
+	if (type & BDEV_URING_RING_IOPOLL) {
+		params.flags |= IORING_SETUP_IOPOLL;
+	}
+#ifdef SPDK_URING_NVME_PASSTHRU
+	if (type & BDEV_URING_RING_NVME) {
+		params.flags |= IORING_SETUP_SQE128 | IORING_SETUP_CQE32;
+	}
+#endif
+
+	rc = io_uring_queue_init_params(SPDK_URING_QUEUE_DEPTH, &ring->uring, &params);
+	if (rc < 0) {
+		SPDK_ERRLOG("uring I/O context setup failure (flags %#x): %s\n", params.flags,
+			    spdk_strerror(-rc));
+		return rc;
+	}
+
+	/* Register a sparse file table, the bdevs' files are added as channels are created */
+	for (i = 0; i < SPDK_URING_MAX_FIXED_FILES; i++) {
+		ring->files[i] = -1;
+	}
+	rc = io_uring_register_files(&ring->uring, ring->files, SPDK_URING_MAX_FIXED_FILES);
+	if (rc < 0) {
+		SPDK_DEBUGLOG(uring, "Unable to register files: %s\n", spdk_strerror(-rc));
+	}
+	ring->fixed_files = rc == 0;
+
+	/* Register the iobuf pools, so that I/O using their buffers skips the page pinning */
+	num_buffers = spdk_iobuf_get_regions(ring->buffers, SPDK_URING_MAX_FIXED_BUFFERS);
+	if (num_buffers > 0 && num_buffers <= SPDK_URING_MAX_FIXED_BUFFERS) {
+		rc = io_uring_register_buffers(&ring->uring, ring->buffers, num_buffers);
+		if (rc < 0) {
+			SPDK_DEBUGLOG(uring, "Unable to register buffers: %s\n", spdk_strerror(-rc));
+		} else {
+			ring->num_buffers = num_buffers;
+		}
+	}
+
+	ring->initialized = true;
+
+	return 0;
+}
+
+static void
+bdev_uring_ring_fini(struct bdev_uring_ring *ring)
+{
+	if (!ring->initialized) {
+		return;
+	}
+
+	io_uring_queue_exit(&ring->uring);
+	ring->initialized = false;
+	ring->fixed_files = false;
+	ring->num_buffers = 0;
+}
+
+static int
+bdev_uring_register_file(struct bdev_uring_ring *ring, int fd)
+{
+	int i, rc;
+
+	if (!ring->fixed_files) {
+		return -1;
+	}
+
+	for (i = 0; i < SPDK_URING_MAX_FIXED_FILES; i++) {
+		if (ring->files[i] == -1) {
+			break;
+		}
+	}
+
+	if (i == SPDK_URING_MAX_FIXED_FILES) {
+		return -1;
+	}
+
+	rc = io_uring_register_files_update(&ring->uring, i, &fd, 1);
+	if (rc != 1) {
+		SPDK_DEBUGLOG(uring, "Unable to update registered files: %d\n", rc);
+		return -1;
+	}
+
+	ring->files[i] = fd;
+
+	return i;
+}
+
+static void
+bdev_uring_unregister_file(struct bdev_uring_ring *ring, int index)
+{
+	int fd = -1;
+
+	if (index < 0) {
+		return;
+	}
+
+	ring->files[index] = -1;
+	io_uring_register_files_update(&ring->uring, index, &fd, 1);
+}
+
 static int
 bdev_uring_create_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_io_channel *ch = ctx_buf;
+	struct bdev_uring *uring = io_device;
+	uint32_t type = 0;
+	int rc;
 
 	ch->group_ch = spdk_io_channel_get_ctx(spdk_get_io_channel(&uring_if));
 
+	if (uring->sqpoll) {
+		type |= BDEV_URING_RING_SQPOLL;
+	}
+	if (uring->iopoll) {
+		type |= BDEV_URING_RING_IOPOLL;
+	}
+	if (uring->nvme_passthru) {
+		type |= BDEV_URING_RING_NVME;
+	}
+
+	ch->ring = &ch->group_ch->rings[type];
+	if (!ch->ring->initialized) {
+		rc = bdev_uring_ring_init(ch->ring, type);
+		if (rc != 0) {
+			spdk_put_io_channel(spdk_io_channel_from_ctx(ch->group_ch));
+			return rc;
+		}
+	}
+
+	ch->fixed_file = bdev_uring_register_file(ch->ring, uring->fd);
+
 	return 0;
 }
 
@@ -671,6 +1365,7 @@ bdev_uring_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_io_channel *ch = ctx_buf;
 
+	bdev_uring_unregister_file(ch->ring, ch->fixed_file);
 	spdk_put_io_channel(spdk_io_channel_from_ctx(ch->group_ch));
 }
 
@@ -690,6 +1385,9 @@ bdev_uring_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	spdk_json_write_named_object_begin(w, "uring");
 
 	spdk_json_write_named_string(w, "filename", uring->filename);
+	spdk_json_write_named_bool(w, "sqpoll", uring->sqpoll);
+	spdk_json_write_named_bool(w, "iopoll", uring->iopoll);
+	spdk_json_write_named_bool(w, "nvme_passthru", uring->nvme_passthru);
 
 	spdk_json_write_object_end(w);
 
@@ -712,6 +1410,8 @@ bdev_uring_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx
 	spdk_json_write_named_string(w, "filename", uring->filename);
 	spdk_uuid_fmt_lower(uuid_str, sizeof(uuid_str), &bdev->uuid);
 	spdk_json_write_named_string(w, "uuid", uuid_str);
+	spdk_json_write_named_bool(w, "sqpoll", uring->sqpoll);
+	spdk_json_write_named_bool(w, "iopoll", uring->iopoll);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -742,13 +1442,8 @@ bdev_uring_group_create_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_group_channel *ch = ctx_buf;
 
-	/* Do not use IORING_SETUP_IOPOLL until the Linux kernel can support not only
-	 * local devices but also devices attached from remote target */
-	if (io_uring_queue_init(SPDK_URING_QUEUE_DEPTH, &ch->uring, 0) < 0) {
-		SPDK_ERRLOG("uring I/O context setup failure\n");
-		return -1;
-	}
-
+	/* The rings are set up once the first bdev needing them gets a channel.  IOPOLL is
+	 * opt-in per bdev, as it is only supported for local devices with polled queues. */
 	ch->poller = SPDK_POLLER_REGISTER(bdev_uring_group_poll, ch, 0);
 	return 0;
 }
@@ -757,8 +1452,11 @@ static void
 bdev_uring_group_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_group_channel *ch = ctx_buf;
+	int i;
 
-	io_uring_queue_exit(&ch->uring);
+	for (i = 0; i < BDEV_URING_RING_COUNT; i++) {
+		bdev_uring_ring_fini(&ch->rings[i]);
+	}
 
 	spdk_poller_unregister(&ch->poller);
 }
@@ -769,6 +1467,7 @@ create_uring_bdev(const struct bdev_uring_opts *opts)
 	struct bdev_uring *uring;
 	uint32_t detected_block_size;
 	uint64_t bdev_size;
+	struct stat st;
 	int rc;
 	uint32_t block_size = opts->block_size;
 
@@ -777,6 +1476,8 @@ create_uring_bdev(const struct bdev_uring_opts *opts)
 		SPDK_ERRLOG("Unable to allocate enough memory for uring backend\n");
 		return NULL;
 	}
+	uring->fd = -1;
+	uring->ctrlr_fd = -1;
 
 	uring->filename = strdup(opts->filename);
 	if (!uring->filename) {
@@ -788,7 +1489,39 @@ create_uring_bdev(const struct bdev_uring_opts *opts)
 		goto error_return;
 	}
 
-	bdev_size = spdk_fd_get_size(uring->fd);
+	if (fstat(uring->fd, &st) == 0) {
+		uring->blockdev = S_ISBLK(st.st_mode);
+		/* NVMe generic character devices, /dev/ngXnY */
+		uring->nvme_passthru = S_ISCHR(st.st_mode);
+	}
+
+	if (opts->iopoll && !uring->direct && !uring->nvme_passthru) {
+		SPDK_ERRLOG("IOPOLL requires %s to be opened with O_DIRECT\n", opts->filename);
+		goto error_return;
+	}
+	uring->sqpoll = opts->sqpoll;
+	uring->iopoll = opts->iopoll;
+
+	if (uring->nvme_passthru) {
+		if (bdev_uring_nvme_init(uring, &detected_block_size, &bdev_size)) {
+			goto error_return;
+		}
+		if (block_size != 0 && block_size != detected_block_size) {
+			SPDK_ERRLOG("Specified block size %" PRIu32 " does not match the namespace's "
+				    "block size %" PRIu32 "\n", block_size, detected_block_size);
+			goto error_return;
+		}
+	} else {
+		bdev_size = spdk_fd_get_size(uring->fd);
+		detected_block_size = spdk_fd_get_blocklen(uring->fd);
+		/* IOPOLL rings only support reads and writes */
+		if (!uring->iopoll) {
+			uring->flush_supported = true;
+			uring->write_zeroes_supported = true;
+			uring->unmap_supported = !uring->blockdev ||
+						 bdev_uring_blockdev_write_zeroes_supported(uring->fd);
+		}
+	}
 
 	uring->bdev.name = strdup(opts->name);
 	if (!uring->bdev.name) {
@@ -799,7 +1532,6 @@ create_uring_bdev(const struct bdev_uring_opts *opts)
 
 	uring->bdev.write_cache = 0;
 
-	detected_block_size = spdk_fd_get_blocklen(uring->fd);
 	if (block_size == 0) {
 		/* User did not specify block size - use autodetected block size. */
 		if (detected_block_size == 0) {
@@ -833,9 +1565,11 @@ create_uring_bdev(const struct bdev_uring_opts *opts)
 	uring->bdev.blocklen = block_size;
 	uring->bdev.required_alignment = spdk_u32log2(block_size);
 
-	rc = bdev_uring_check_zoned_support(uring, opts->name, opts->filename);
-	if (rc) {
-		goto error_return;
+	if (!uring->nvme_passthru) {
+		rc = bdev_uring_check_zoned_support(uring, opts->name, opts->filename);
+		if (rc) {
+			goto error_return;
+		}
 	}
 
 	if (bdev_size % uring->bdev.blocklen != 0) {
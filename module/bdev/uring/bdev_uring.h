@@ -20,6 +20,10 @@ struct bdev_uring_opts {
 	const char *filename;
 	uint32_t block_size;
 	struct spdk_uuid uuid;
+	/* Submit through a kernel SQ polling thread */
+	bool sqpoll;
+	/* Poll the device for completions instead of using interrupts */
+	bool iopoll;
 };
 
 struct spdk_bdev *create_uring_bdev(const struct bdev_uring_opts *opts);
@@ -15,6 +15,8 @@ struct rpc_create_uring {
 	char *filename;
 	uint32_t block_size;
 	struct spdk_uuid uuid;
+	bool sqpoll;
+	bool iopoll;
 };
 
 /* Free the allocated memory resource after the RPC handling. */
@@ -31,6 +33,8 @@ static const struct spdk_json_object_decoder rpc_create_uring_decoders[] = {
 	{"filename", offsetof(struct rpc_create_uring, filename), spdk_json_decode_string},
 	{"block_size", offsetof(struct rpc_create_uring, block_size), spdk_json_decode_uint32, true},
 	{"uuid", offsetof(struct rpc_create_uring, uuid), spdk_json_decode_uuid, true},
+	{"sqpoll", offsetof(struct rpc_create_uring, sqpoll), spdk_json_decode_bool, true},
+	{"iopoll", offsetof(struct rpc_create_uring, iopoll), spdk_json_decode_bool, true},
 };
 
 /* Decode the parameters for this RPC method and properly create the uring
@@ -58,6 +62,8 @@ rpc_bdev_uring_create(struct spdk_jsonrpc_request *request,
 	opts.filename = req.filename;
 	opts.name = req.name;
 	opts.uuid = req.uuid;
+	opts.sqpoll = req.sqpoll;
+	opts.iopoll = req.iopoll;
 
 	bdev = create_uring_bdev(&opts);
 	if (!bdev) {
@@ -1342,6 +1342,34 @@ _sock_check_zcopy(struct spdk_sock *sock)
 }
 #endif
 
+#ifdef MSG_MORE
+/* Check if there are more iovecs queued than fit into a single sendmsg() */
+static bool
+_sock_has_more_data(struct spdk_sock *sock)
+{
+	struct spdk_sock_request *req;
+	unsigned int offset;
+	int i, iovcnt = 0;
+
+	TAILQ_FOREACH(req, &sock->queued_reqs, internal.link) {
+		offset = req->internal.offset;
+		for (i = 0; i < req->iovcnt; i++) {
+			if (offset >= SPDK_SOCK_REQUEST_IOV(req, i)->iov_len) {
+				offset -= SPDK_SOCK_REQUEST_IOV(req, i)->iov_len;
+				continue;
+			}
+
+			offset = 0;
+			if (++iovcnt > IOV_BATCH_SIZE) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+#endif
+
 static int
 _sock_flush(struct spdk_sock *sock)
 {
@@ -1382,6 +1410,15 @@ _sock_flush(struct spdk_sock *sock)
 	is_zcopy = flags & MSG_ZEROCOPY;
 #endif
 
+#ifdef MSG_MORE
+	/* Let the kernel coalesce this batch with the rest of the queued data instead of
+	 * pushing out a partially filled segment.
+	 */
+	if (iovcnt == IOV_BATCH_SIZE && _sock_has_more_data(sock)) {
+		flags |= MSG_MORE;
+	}
+#endif
+
 	/* Perform the vectored write */
 	msg.msg_iov = iovs;
 	msg.msg_iovlen = iovcnt;
@@ -0,0 +1,1408 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+/*
+ * Socket implementation for peers running on the same host. A listening socket
+ * accepts both TCP connections, handled by the posix implementation, and
+ * connections from local processes over an abstract UNIX domain socket named
+ * after the listen address. A local connection carries its data through two
+ * single producer, single consumer rings in memory shared by both processes,
+ * bypassing the kernel network stack. The UNIX domain socket is only used to
+ * pass the shared memory and to detect a peer that went away.
+ *
+ * The peer can write anything to the shared memory, so each side keeps its own
+ * ring positions in private memory and checks the positions of the peer.
+ */
+
+#include "spdk/stdinc.h"
+
+#include <sys/mman.h>
+#include <sys/un.h>
+
+#include "spdk/env.h"
+#include "spdk/log.h"
+#include "spdk/sock.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#include "spdk_internal/sock.h"
+
+#define SHM_SOCK_MAGIC			0x53504b53
+#define SHM_SOCK_VERSION		1
+#define SHM_SOCK_MIN_RING_SIZE		(64 * 1024)
+#define SHM_SOCK_MAX_RING_SIZE		(64 * 1024 * 1024)
+#define SHM_SOCK_LISTEN_BACKLOG		512
+#define SHM_SOCK_HELLO_TIMEOUT_MS	1000
+/* How often to check if a peer that did not mark its end closed is still there */
+#define SHM_SOCK_PEER_CHECK_US		(100 * 1000)
+
+enum shm_sock_side {
+	SHM_SOCK_CLIENT = 0,
+	SHM_SOCK_SERVER,
+};
+
+/* Single producer, single consumer byte ring. Positions are free running and
+ * published here for the peer, each side keeps the authoritative copy of its own. */
+struct shm_sock_ring {
+	/* Read position, only written by the consumer */
+	uint64_t		head __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
+	/* Write position, only written by the producer */
+	uint64_t		tail __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
+};
+
+/* Header of the shared memory, followed by the data of the two rings */
+struct shm_sock_region {
+	uint32_t		magic;
+	uint32_t		version;
+	uint32_t		ring_size;
+	uint16_t		cport;
+	/* Set by each side when it closes its end of the connection */
+	uint8_t			closed[2];
+	/* rings[side] carries the data sent by side */
+	struct shm_sock_ring	rings[2];
+};
+
+#define SHM_SOCK_DATA_OFFSET	SPDK_ALIGN_CEIL(sizeof(struct shm_sock_region), 4096)
+
+/* Sent by the client with the shared memory file descriptor */
+struct shm_sock_hello {
+	uint32_t		magic;
+	uint32_t		version;
+	uint64_t		region_size;
+};
+
+struct spdk_shm_sock {
+	struct spdk_sock		base;
+
+	/* posix socket used when the peer is remote, NULL for a local peer */
+	struct spdk_sock		*posix_sock;
+
+	/* UNIX domain socket connected to a local peer or listening for local peers */
+	int				fd;
+
+	struct shm_sock_region		*region;
+	size_t				region_size;
+	enum shm_sock_side		side;
+	uint32_t			ring_size;
+	struct shm_sock_ring		*tx;
+	uint8_t				*tx_data;
+	/* Write position of the tx ring */
+	uint64_t			tx_tail;
+	struct shm_sock_ring		*rx;
+	uint8_t				*rx_data;
+	/* Read position of the rx ring */
+	uint64_t			rx_head;
+
+	int				recvlowat;
+	bool				peer_closed;
+	uint64_t			next_peer_check;
+	/* Negative errno once the connection failed */
+	int				connection_status;
+
+	/* Local connections of a listening socket waiting for the hello of the client */
+	TAILQ_HEAD(, spdk_shm_sock)	pending_accepts;
+	/* Ticks after which a pending connection is dropped */
+	uint64_t			hello_deadline;
+
+	char				addr[INET6_ADDRSTRLEN];
+	uint16_t			port;
+	uint16_t			cport;
+
+	TAILQ_ENTRY(spdk_shm_sock)	link;
+};
+
+struct spdk_shm_sock_group_impl {
+	struct spdk_sock_group_impl	base;
+
+	/* Sockets with a local peer. They are polled in order and the list is
+	 * rotated so that every socket gets a chance to be reported. */
+	TAILQ_HEAD(, spdk_shm_sock)	socks;
+
+	/* Group polling the posix sockets of remote peers, created on demand */
+	struct spdk_sock_group		*posix_group;
+
+	/* Where the posix sockets with events are reported while polling */
+	struct spdk_sock		**poll_socks;
+	int				poll_num_events;
+	int				poll_max_events;
+};
+
+static struct spdk_sock_impl_opts g_shm_impl_opts = {
+	.recv_buf_size = DEFAULT_SO_RCVBUF_SIZE,
+	.send_buf_size = DEFAULT_SO_SNDBUF_SIZE,
+	.enable_recv_pipe = true,
+	.enable_quickack = false,
+	.enable_placement_id = PLACEMENT_NONE,
+	.enable_zerocopy_send_server = false,
+	.enable_zerocopy_send_client = false,
+	.zerocopy_threshold = 0,
+	.tls_version = 0,
+	.enable_ktls = false,
+	.psk_key = NULL,
+	.psk_identity = NULL
+};
+
+static uint16_t g_shm_next_cport;
+
+#define __shm_sock(sock) (struct spdk_shm_sock *)sock
+#define __shm_group_impl(group) (struct spdk_shm_sock_group_impl *)group
+
+static void
+shm_sock_copy_impl_opts(struct spdk_sock_impl_opts *dest, const struct spdk_sock_impl_opts *src,
+			size_t len)
+{
+#define FIELD_OK(field) \
+	offsetof(struct spdk_sock_impl_opts, field) + sizeof(src->field) <= len
+
+#define SET_FIELD(field) \
+	if (FIELD_OK(field)) { \
+		dest->field = src->field; \
+	}
+
+	SET_FIELD(recv_buf_size);
+	SET_FIELD(send_buf_size);
+	SET_FIELD(enable_recv_pipe);
+	SET_FIELD(enable_quickack);
+	SET_FIELD(enable_placement_id);
+	SET_FIELD(enable_zerocopy_send_server);
+	SET_FIELD(enable_zerocopy_send_client);
+	SET_FIELD(zerocopy_threshold);
+	SET_FIELD(tls_version);
+	SET_FIELD(enable_ktls);
+	SET_FIELD(psk_key);
+	SET_FIELD(psk_identity);
+
+#undef SET_FIELD
+#undef FIELD_OK
+}
+
+static int
+shm_sock_impl_get_opts(struct spdk_sock_impl_opts *opts, size_t *len)
+{
+	if (!opts || !len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	assert(sizeof(*opts) >= *len);
+	memset(opts, 0, *len);
+
+	shm_sock_copy_impl_opts(opts, &g_shm_impl_opts, *len);
+	*len = spdk_min(*len, sizeof(g_shm_impl_opts));
+
+	return 0;
+}
+
+static int
+shm_sock_impl_set_opts(const struct spdk_sock_impl_opts *opts, size_t len)
+{
+	if (!opts) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	assert(sizeof(*opts) >= len);
+	shm_sock_copy_impl_opts(&g_shm_impl_opts, opts, len);
+
+	return 0;
+}
+
+static void
+shm_opts_get_impl_opts(const struct spdk_sock_opts *opts, struct spdk_sock_impl_opts *dest)
+{
+	/* Copy the default impl_opts first to cover cases when user's impl_opts is smaller */
+	memcpy(dest, &g_shm_impl_opts, sizeof(*dest));
+
+	if (opts->impl_opts != NULL) {
+		assert(sizeof(*dest) >= opts->impl_opts_size);
+		shm_sock_copy_impl_opts(dest, opts->impl_opts, opts->impl_opts_size);
+	}
+}
+
+static void
+shm_sock_fail(struct spdk_shm_sock *sock, int status)
+{
+	assert(status < 0);
+	if (sock->connection_status == 0) {
+		SPDK_ERRLOG("Shared memory connection to %s:%d failed: %s\n", sock->addr, sock->port,
+			    spdk_strerror(-status));
+		sock->connection_status = status;
+	}
+}
+
+/* Returns the number of bytes in the rx ring, or -EIO if the peer corrupted its position */
+static ssize_t
+shm_ring_bytes_available(struct spdk_shm_sock *sock)
+{
+	uint64_t tail;
+
+	tail = __atomic_load_n(&sock->rx->tail, __ATOMIC_ACQUIRE);
+	if (spdk_unlikely(tail - sock->rx_head > sock->ring_size)) {
+		shm_sock_fail(sock, -EIO);
+		return -EIO;
+	}
+
+	return tail - sock->rx_head;
+}
+
+static ssize_t
+shm_ring_read(struct spdk_shm_sock *sock, struct iovec *iov, int iovcnt)
+{
+	struct iovec siov[2];
+	uint64_t head;
+	ssize_t rc;
+	size_t len, offset, bytes;
+
+	rc = shm_ring_bytes_available(sock);
+	if (rc <= 0) {
+		return rc;
+	}
+
+	len = rc;
+	head = sock->rx_head;
+
+	offset = head & (sock->ring_size - 1);
+	siov[0].iov_base = sock->rx_data + offset;
+	siov[0].iov_len = spdk_min(len, sock->ring_size - offset);
+	siov[1].iov_base = sock->rx_data;
+	siov[1].iov_len = len - siov[0].iov_len;
+
+	bytes = spdk_iovcpy(siov, siov[1].iov_len ? 2 : 1, iov, iovcnt);
+	sock->rx_head = head + bytes;
+	__atomic_store_n(&sock->rx->head, sock->rx_head, __ATOMIC_RELEASE);
+
+	return bytes;
+}
+
+static ssize_t
+shm_ring_write(struct spdk_shm_sock *sock, struct iovec *iov, int iovcnt)
+{
+	struct iovec diov[2];
+	uint64_t head, tail;
+	size_t space, offset, bytes;
+
+	head = __atomic_load_n(&sock->tx->head, __ATOMIC_ACQUIRE);
+	tail = sock->tx_tail;
+	if (spdk_unlikely(tail - head > sock->ring_size)) {
+		shm_sock_fail(sock, -EIO);
+		return -EIO;
+	}
+
+	space = sock->ring_size - (tail - head);
+	if (space == 0) {
+		return 0;
+	}
+
+	offset = tail & (sock->ring_size - 1);
+	diov[0].iov_base = sock->tx_data + offset;
+	diov[0].iov_len = spdk_min(space, sock->ring_size - offset);
+	diov[1].iov_base = sock->tx_data;
+	diov[1].iov_len = space - diov[0].iov_len;
+
+	bytes = spdk_iovcpy(iov, iovcnt, diov, diov[1].iov_len ? 2 : 1);
+	sock->tx_tail = tail + bytes;
+	__atomic_store_n(&sock->tx->tail, sock->tx_tail, __ATOMIC_RELEASE);
+
+	return bytes;
+}
+
+/* Returns true once the peer closed its end or went away */
+static bool
+shm_sock_peer_closed(struct spdk_shm_sock *sock)
+{
+	uint64_t now;
+	ssize_t rc;
+	char c;
+
+	if (sock->peer_closed) {
+		return true;
+	}
+
+	if (__atomic_load_n(&sock->region->closed[!sock->side], __ATOMIC_ACQUIRE)) {
+		sock->peer_closed = true;
+		return true;
+	}
+
+	/* A peer that crashed did not mark its end closed, but the kernel
+	 * closed its end of the UNIX domain socket. */
+	now = spdk_get_ticks();
+	if (now < sock->next_peer_check) {
+		return false;
+	}
+
+	sock->next_peer_check = now + spdk_get_ticks_hz() * SHM_SOCK_PEER_CHECK_US /
+				SPDK_SEC_TO_USEC;
+	rc = recv(sock->fd, &c, sizeof(c), MSG_PEEK | MSG_DONTWAIT);
+	if (rc == 0 || (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+		sock->peer_closed = true;
+	}
+
+	return sock->peer_closed;
+}
+
+static void
+shm_sock_get_unix_addr(struct sockaddr_un *addr, socklen_t *len, const char *ip, int port)
+{
+	int rc;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	/* Abstract address, sun_path[0] stays zero */
+	rc = snprintf(&addr->sun_path[1], sizeof(addr->sun_path) - 1, "spdk_sock_shm/%s/%d",
+		      ip, port);
+	assert(rc > 0 && (size_t)rc < sizeof(addr->sun_path) - 1);
+	*len = offsetof(struct sockaddr_un, sun_path) + 1 + rc;
+}
+
+/* Check whether ip is one of the addresses of this host */
+static bool
+shm_sock_is_local_addr(const char *ip)
+{
+	struct addrinfo hints = {}, *res;
+	bool local;
+	int fd;
+
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+	if (getaddrinfo(ip, "0", &hints, &res) != 0) {
+		return false;
+	}
+
+	fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC, res->ai_protocol);
+	local = fd >= 0 && bind(fd, res->ai_addr, res->ai_addrlen) == 0;
+	if (fd >= 0) {
+		close(fd);
+	}
+	freeaddrinfo(res);
+
+	return local;
+}
+
+static struct spdk_shm_sock *
+shm_sock_alloc(int fd)
+{
+	struct spdk_shm_sock *sock;
+
+	sock = calloc(1, sizeof(*sock));
+	if (sock == NULL) {
+		SPDK_ERRLOG("sock allocation failed\n");
+		return NULL;
+	}
+
+	sock->fd = fd;
+	sock->recvlowat = 1;
+	TAILQ_INIT(&sock->pending_accepts);
+
+	return sock;
+}
+
+static struct spdk_shm_sock *
+shm_sock_alloc_posix(struct spdk_sock *posix_sock)
+{
+	struct spdk_shm_sock *sock;
+
+	sock = shm_sock_alloc(-1);
+	if (sock == NULL) {
+		spdk_sock_close(&posix_sock);
+		return NULL;
+	}
+
+	sock->posix_sock = posix_sock;
+
+	return sock;
+}
+
+static int
+shm_sock_map_region(struct spdk_shm_sock *sock, int memfd, size_t region_size,
+		    enum shm_sock_side side)
+{
+	struct shm_sock_region *region;
+
+	region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	if (region == MAP_FAILED) {
+		SPDK_ERRLOG("Failed to map shared memory: %s\n", spdk_strerror(errno));
+		return -errno;
+	}
+
+	sock->region = region;
+	sock->region_size = region_size;
+	sock->side = side;
+
+	return 0;
+}
+
+static int
+shm_sock_setup_rings(struct spdk_shm_sock *sock)
+{
+	struct shm_sock_region *region = sock->region;
+	uint8_t *data = (uint8_t *)region + SHM_SOCK_DATA_OFFSET;
+
+	if (region->magic != SHM_SOCK_MAGIC || region->version != SHM_SOCK_VERSION ||
+	    region->ring_size < SHM_SOCK_MIN_RING_SIZE ||
+	    region->ring_size > SHM_SOCK_MAX_RING_SIZE ||
+	    !spdk_u32_is_pow2(region->ring_size) ||
+	    SHM_SOCK_DATA_OFFSET + 2 * (size_t)region->ring_size != sock->region_size) {
+		SPDK_ERRLOG("Invalid shared memory header\n");
+		return -EINVAL;
+	}
+
+	sock->ring_size = region->ring_size;
+	sock->tx = &region->rings[sock->side];
+	sock->tx_data = data + sock->side * sock->ring_size;
+	sock->rx = &region->rings[!sock->side];
+	sock->rx_data = data + !sock->side * sock->ring_size;
+
+	return 0;
+}
+
+static void
+shm_sock_free(struct spdk_shm_sock *sock)
+{
+	struct spdk_shm_sock *pending;
+
+	while ((pending = TAILQ_FIRST(&sock->pending_accepts)) != NULL) {
+		TAILQ_REMOVE(&sock->pending_accepts, pending, link);
+		shm_sock_free(pending);
+	}
+
+	if (sock->posix_sock != NULL) {
+		spdk_sock_close(&sock->posix_sock);
+	}
+
+	if (sock->region != NULL) {
+		__atomic_store_n(&sock->region->closed[sock->side], 1, __ATOMIC_RELEASE);
+		munmap(sock->region, sock->region_size);
+	}
+
+	if (sock->fd >= 0) {
+		close(sock->fd);
+	}
+
+	free(sock);
+}
+
+static int
+shm_sock_send_hello(int fd, int memfd, size_t region_size)
+{
+	struct shm_sock_hello hello = {};
+	struct iovec iov = {};
+	struct msghdr msg = {};
+	struct cmsghdr *cmsg;
+	char control[CMSG_SPACE(sizeof(int))] = {};
+	ssize_t rc;
+
+	hello.magic = SHM_SOCK_MAGIC;
+	hello.version = SHM_SOCK_VERSION;
+	hello.region_size = region_size;
+
+	iov.iov_base = &hello;
+	iov.iov_len = sizeof(hello);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+
+	do {
+		rc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc != (ssize_t)sizeof(hello)) {
+		return rc < 0 ? -errno : -EIO;
+	}
+
+	return 0;
+}
+
+/* Receive the shared memory file descriptor sent by a client that connected.
+ * Returns -EAGAIN if the hello did not arrive yet. */
+static int
+shm_sock_recv_hello(int fd, int *memfd, size_t *region_size)
+{
+	struct shm_sock_hello hello = {};
+	struct iovec iov = {};
+	struct msghdr msg = {};
+	struct cmsghdr *cmsg;
+	char control[CMSG_SPACE(sizeof(int))] = {};
+	struct stat st;
+	ssize_t rc;
+	int seals;
+
+	iov.iov_base = &hello;
+	iov.iov_len = sizeof(hello);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	do {
+		rc = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0) {
+		return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+	} else if (rc == 0) {
+		return -ECONNRESET;
+	}
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+		return -EPROTO;
+	}
+
+	memcpy(memfd, CMSG_DATA(cmsg), sizeof(int));
+
+	if (rc != (ssize_t)sizeof(hello) || hello.magic != SHM_SOCK_MAGIC ||
+	    hello.version != SHM_SOCK_VERSION) {
+		close(*memfd);
+		return -EPROTO;
+	}
+
+	/* Only map memory laid out as two rings of a valid size, which the client can
+	 * no longer shrink. The ring size itself is checked once the header is mapped. */
+	seals = fcntl(*memfd, F_GET_SEALS);
+	if (hello.region_size < SHM_SOCK_DATA_OFFSET + 2 * (uint64_t)SHM_SOCK_MIN_RING_SIZE ||
+	    hello.region_size > SHM_SOCK_DATA_OFFSET + 2 * (uint64_t)SHM_SOCK_MAX_RING_SIZE ||
+	    fstat(*memfd, &st) != 0 || (uint64_t)st.st_size != hello.region_size ||
+	    seals < 0 || !(seals & F_SEAL_SHRINK)) {
+		close(*memfd);
+		return -EPROTO;
+	}
+
+	*region_size = hello.region_size;
+
+	return 0;
+}
+
+static struct spdk_sock *
+shm_sock_listen(const char *ip, int port, struct spdk_sock_opts *opts)
+{
+	struct spdk_shm_sock *sock;
+	struct spdk_sock *posix_sock;
+	struct sockaddr_un addr;
+	socklen_t addrlen;
+	uint16_t sport;
+	int fd, rc;
+
+	/* Remote peers connect over TCP */
+	posix_sock = spdk_sock_listen_ext(ip, port, "posix", opts);
+	if (posix_sock == NULL) {
+		return NULL;
+	}
+
+	/* Find out the actual port if the caller asked for any */
+	rc = spdk_sock_getaddr(posix_sock, NULL, 0, &sport, NULL, 0, NULL);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to get the listen address\n");
+		spdk_sock_close(&posix_sock);
+		return NULL;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		SPDK_ERRLOG("socket() failed, errno = %d\n", errno);
+		spdk_sock_close(&posix_sock);
+		return NULL;
+	}
+
+	shm_sock_get_unix_addr(&addr, &addrlen, ip, sport);
+	if (bind(fd, (struct sockaddr *)&addr, addrlen) != 0 ||
+	    listen(fd, SHM_SOCK_LISTEN_BACKLOG) != 0) {
+		SPDK_ERRLOG("Failed to listen for local connections on %s:%d, errno = %d\n",
+			    ip, sport, errno);
+		close(fd);
+		spdk_sock_close(&posix_sock);
+		return NULL;
+	}
+
+	sock = shm_sock_alloc(fd);
+	if (sock == NULL) {
+		close(fd);
+		spdk_sock_close(&posix_sock);
+		return NULL;
+	}
+
+	sock->posix_sock = posix_sock;
+	snprintf(sock->addr, sizeof(sock->addr), "%s", ip);
+	sock->port = sport;
+
+	return &sock->base;
+}
+
+static int
+shm_sock_connect_unix(const char *ip, int port)
+{
+	const char *wildcard = strchr(ip, ':') != NULL ? "::" : "0.0.0.0";
+	const char *names[] = { ip, wildcard };
+	struct sockaddr_un addr;
+	socklen_t addrlen;
+	int fd, rc;
+	size_t i;
+
+	/* Only a listener on this host can use shared memory. Listeners on the
+	 * wildcard address also accept connections to any local address. */
+	if (!shm_sock_is_local_addr(ip)) {
+		return -1;
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(names); i++) {
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		shm_sock_get_unix_addr(&addr, &addrlen, names[i], port);
+		do {
+			rc = connect(fd, (struct sockaddr *)&addr, addrlen);
+		} while (rc != 0 && errno == EINTR);
+
+		if (rc == 0) {
+			return fd;
+		}
+
+		close(fd);
+	}
+
+	return -1;
+}
+
+static struct spdk_sock *
+shm_sock_connect(const char *ip, int port, struct spdk_sock_opts *opts)
+{
+	struct spdk_sock_impl_opts impl_opts;
+	struct spdk_shm_sock *sock;
+	struct spdk_sock *posix_sock;
+	struct shm_sock_region *region;
+	uint32_t ring_size;
+	size_t region_size;
+	int fd, memfd, rc;
+
+	fd = shm_sock_connect_unix(ip, port);
+	if (fd < 0) {
+		/* No local listener, the peer is remote */
+		posix_sock = spdk_sock_connect_ext(ip, port, "posix", opts);
+		if (posix_sock == NULL) {
+			return NULL;
+		}
+
+		sock = shm_sock_alloc_posix(posix_sock);
+		return sock != NULL ? &sock->base : NULL;
+	}
+
+	shm_opts_get_impl_opts(opts, &impl_opts);
+	ring_size = spdk_align32pow2(spdk_max(impl_opts.send_buf_size, SHM_SOCK_MIN_RING_SIZE));
+	ring_size = spdk_min(ring_size, SHM_SOCK_MAX_RING_SIZE);
+	region_size = SHM_SOCK_DATA_OFFSET + 2 * (size_t)ring_size;
+
+	sock = shm_sock_alloc(fd);
+	if (sock == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	memfd = memfd_create("spdk_sock_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (memfd < 0) {
+		SPDK_ERRLOG("memfd_create() failed, errno = %d\n", errno);
+		shm_sock_free(sock);
+		return NULL;
+	}
+
+	rc = ftruncate(memfd, region_size);
+	if (rc == 0) {
+		/* The server refuses memory that could shrink under its mapping */
+		rc = fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+	}
+	if (rc == 0) {
+		rc = shm_sock_map_region(sock, memfd, region_size, SHM_SOCK_CLIENT);
+	}
+	if (rc != 0) {
+		close(memfd);
+		shm_sock_free(sock);
+		return NULL;
+	}
+
+	region = sock->region;
+	region->magic = SHM_SOCK_MAGIC;
+	region->version = SHM_SOCK_VERSION;
+	region->ring_size = ring_size;
+	region->cport = ++g_shm_next_cport;
+
+	rc = shm_sock_setup_rings(sock);
+	assert(rc == 0);
+
+	rc = shm_sock_send_hello(fd, memfd, region_size);
+	close(memfd);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to pass shared memory to %s:%d: %s\n", ip, port,
+			    spdk_strerror(-rc));
+		shm_sock_free(sock);
+		return NULL;
+	}
+
+	rc = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	if (rc != 0) {
+		shm_sock_free(sock);
+		return NULL;
+	}
+
+	snprintf(sock->addr, sizeof(sock->addr), "%s", ip);
+	sock->port = port;
+	sock->cport = region->cport;
+
+	SPDK_DEBUGLOG(sock_shm, "Connected to %s:%d over shared memory\n", ip, port);
+
+	return &sock->base;
+}
+
+/* Finish accepting a local connection once its hello arrived.
+ * Returns -EAGAIN while waiting for the hello. */
+static int
+shm_sock_accept_local(struct spdk_shm_sock *listen_sock, struct spdk_shm_sock *sock)
+{
+	size_t region_size = 0;
+	int memfd = -1, rc;
+
+	rc = shm_sock_recv_hello(sock->fd, &memfd, &region_size);
+	if (rc == -EAGAIN) {
+		if (spdk_get_ticks() < sock->hello_deadline) {
+			return -EAGAIN;
+		}
+		rc = -ETIMEDOUT;
+	}
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to receive shared memory from a local client: %s\n",
+			    spdk_strerror(-rc));
+		return rc;
+	}
+
+	rc = shm_sock_map_region(sock, memfd, region_size, SHM_SOCK_SERVER);
+	close(memfd);
+	if (rc == 0) {
+		rc = shm_sock_setup_rings(sock);
+	}
+	if (rc != 0) {
+		return rc;
+	}
+
+	memcpy(sock->addr, listen_sock->addr, sizeof(sock->addr));
+	sock->port = listen_sock->port;
+	sock->cport = sock->region->cport;
+
+	return 0;
+}
+
+static struct spdk_sock *
+shm_sock_accept(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *listen_sock = __shm_sock(_sock);
+	struct spdk_shm_sock *sock, *tmp;
+	struct spdk_sock *posix_sock;
+	int fd, rc;
+
+	/* The acceptor must not block waiting for the hello of a client, so new local
+	 * connections are kept pending and checked again on the next calls. */
+	fd = accept4(listen_sock->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd >= 0) {
+		sock = shm_sock_alloc(fd);
+		if (sock == NULL) {
+			close(fd);
+		} else {
+			sock->hello_deadline = spdk_get_ticks() + spdk_get_ticks_hz() *
+					       SHM_SOCK_HELLO_TIMEOUT_MS / SPDK_SEC_TO_MSEC;
+			TAILQ_INSERT_TAIL(&listen_sock->pending_accepts, sock, link);
+		}
+	}
+
+	TAILQ_FOREACH_SAFE(sock, &listen_sock->pending_accepts, link, tmp) {
+		rc = shm_sock_accept_local(listen_sock, sock);
+		if (rc == -EAGAIN) {
+			continue;
+		}
+
+		TAILQ_REMOVE(&listen_sock->pending_accepts, sock, link);
+		if (rc != 0) {
+			shm_sock_free(sock);
+			continue;
+		}
+
+		return &sock->base;
+	}
+
+	posix_sock = spdk_sock_accept(listen_sock->posix_sock);
+	if (posix_sock == NULL) {
+		return NULL;
+	}
+
+	sock = shm_sock_alloc_posix(posix_sock);
+
+	return sock != NULL ? &sock->base : NULL;
+}
+
+static int
+shm_sock_close(struct spdk_sock *_sock)
+{
+	shm_sock_free(__shm_sock(_sock));
+
+	return 0;
+}
+
+static int
+shm_sock_getaddr(struct spdk_sock *_sock, char *saddr, int slen, uint16_t *sport,
+		 char *caddr, int clen, uint16_t *cport)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_getaddr(sock->posix_sock, saddr, slen, sport, caddr, clen, cport);
+	}
+
+	/* Both ends are on this host, so they share the address the client connected to */
+	if (saddr) {
+		snprintf(saddr, slen, "%s", sock->addr);
+	}
+	if (sport) {
+		*sport = sock->port;
+	}
+	if (caddr) {
+		snprintf(caddr, clen, "%s", sock->addr);
+	}
+	if (cport) {
+		*cport = sock->cport;
+	}
+
+	return 0;
+}
+
+static const char *
+shm_sock_get_interface_name(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_get_interface_name(sock->posix_sock);
+	}
+
+	return NULL;
+}
+
+static int32_t
+shm_sock_get_numa_id(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_get_numa_id(sock->posix_sock);
+	}
+
+	return SPDK_ENV_NUMA_ID_ANY;
+}
+
+static ssize_t
+shm_sock_readv(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+	ssize_t rc;
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_readv(sock->posix_sock, iov, iovcnt);
+	}
+
+	if (sock->connection_status < 0) {
+		errno = -sock->connection_status;
+		return -1;
+	}
+
+	rc = shm_ring_read(sock, iov, iovcnt);
+	if (rc == 0) {
+		if (!shm_sock_peer_closed(sock)) {
+			errno = EAGAIN;
+			return -1;
+		}
+
+		/* The peer may have sent more data right before closing */
+		rc = shm_ring_read(sock, iov, iovcnt);
+	}
+
+	if (rc < 0) {
+		errno = -rc;
+		return -1;
+	}
+
+	return rc;
+}
+
+static ssize_t
+shm_sock_recv(struct spdk_sock *sock, void *buf, size_t len)
+{
+	struct iovec iov[1];
+
+	iov[0].iov_base = buf;
+	iov[0].iov_len = len;
+
+	return shm_sock_readv(sock, iov, 1);
+}
+
+static ssize_t
+shm_sock_writev(struct spdk_sock *_sock, struct iovec *iov, int iovcnt)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+	ssize_t rc;
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_writev(sock->posix_sock, iov, iovcnt);
+	}
+
+	if (sock->connection_status < 0) {
+		errno = -sock->connection_status;
+		return -1;
+	}
+
+	if (shm_sock_peer_closed(sock)) {
+		errno = EPIPE;
+		return -1;
+	}
+
+	rc = shm_ring_write(sock, iov, iovcnt);
+	if (rc <= 0) {
+		errno = rc < 0 ? -rc : EAGAIN;
+		return -1;
+	}
+
+	return rc;
+}
+
+static int
+shm_sock_recv_next(struct spdk_sock *_sock, void **buf, void **ctx)
+{
+	struct iovec iov;
+	ssize_t rc;
+
+	iov.iov_len = spdk_sock_group_get_buf(_sock->group_impl->group, &iov.iov_base, ctx);
+	if (iov.iov_len == 0) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	rc = shm_sock_readv(_sock, &iov, 1);
+	if (rc <= 0) {
+		spdk_sock_group_provide_buf(_sock->group_impl->group, iov.iov_base, iov.iov_len,
+					    *ctx);
+		return rc;
+	}
+
+	*buf = iov.iov_base;
+
+	return rc;
+}
+
+/* Copy the queued requests into the ring. Requests are complete once copied. */
+static int
+_sock_flush(struct spdk_sock *sock)
+{
+	struct iovec iovs[IOV_BATCH_SIZE];
+	struct spdk_sock_request *req;
+	unsigned int offset;
+	ssize_t rc, sent;
+	size_t len;
+	int iovcnt, retval, i;
+
+	/* Can't flush from within a callback or we end up with recursive calls */
+	if (sock->cb_cnt > 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	iovcnt = spdk_sock_prep_reqs(sock, iovs, 0, NULL, NULL);
+	if (iovcnt == 0) {
+		return 0;
+	}
+
+	rc = shm_sock_writev(sock, iovs, iovcnt);
+	if (rc < 0) {
+		return -1;
+	}
+
+	sent = rc;
+
+	/* Consume the requests that were actually written */
+	req = TAILQ_FIRST(&sock->queued_reqs);
+	while (req) {
+		offset = req->internal.offset;
+
+		for (i = 0; i < req->iovcnt; i++) {
+			/* Advance by the offset first */
+			if (offset >= SPDK_SOCK_REQUEST_IOV(req, i)->iov_len) {
+				offset -= SPDK_SOCK_REQUEST_IOV(req, i)->iov_len;
+				continue;
+			}
+
+			/* Calculate the remaining length of this element */
+			len = SPDK_SOCK_REQUEST_IOV(req, i)->iov_len - offset;
+
+			if (len > (size_t)rc) {
+				/* This element was partially sent. */
+				req->internal.offset += rc;
+				return sent;
+			}
+
+			offset = 0;
+			req->internal.offset += len;
+			rc -= len;
+		}
+
+		/* Handled a full request. */
+		spdk_sock_request_pend(sock, req);
+		retval = spdk_sock_request_put(sock, req, 0);
+		if (retval) {
+			break;
+		}
+
+		if (rc == 0) {
+			break;
+		}
+
+		req = TAILQ_FIRST(&sock->queued_reqs);
+	}
+
+	return sent;
+}
+
+static int
+shm_sock_flush(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_flush(sock->posix_sock);
+	}
+
+	return _sock_flush(_sock);
+}
+
+static void
+shm_sock_writev_async(struct spdk_sock *_sock, struct spdk_sock_request *req)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+	int rc;
+
+	if (sock->posix_sock != NULL) {
+		spdk_sock_writev_async(sock->posix_sock, req);
+		return;
+	}
+
+	if (spdk_unlikely(sock->connection_status < 0)) {
+		req->cb_fn(req->cb_arg, sock->connection_status);
+		return;
+	}
+
+	spdk_sock_request_queue(_sock, req);
+
+	/* If there are a sufficient number queued, just flush them out immediately. */
+	if (_sock->queued_iovcnt >= IOV_BATCH_SIZE) {
+		rc = _sock_flush(_sock);
+		if (rc < 0 && errno != EAGAIN) {
+			spdk_sock_abort_requests(_sock);
+		}
+	}
+}
+
+static int
+shm_sock_set_recvlowat(struct spdk_sock *_sock, int nbytes)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_set_recvlowat(sock->posix_sock, nbytes);
+	}
+
+	sock->recvlowat = spdk_max(nbytes, 1);
+
+	return 0;
+}
+
+static int
+shm_sock_set_recvbuf(struct spdk_sock *_sock, int sz)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_set_recvbuf(sock->posix_sock, sz);
+	}
+
+	/* The ring size is fixed when connecting */
+	return 0;
+}
+
+static int
+shm_sock_set_sendbuf(struct spdk_sock *_sock, int sz)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_set_sendbuf(sock->posix_sock, sz);
+	}
+
+	return 0;
+}
+
+static bool
+shm_sock_is_ipv6(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_is_ipv6(sock->posix_sock);
+	}
+
+	return strchr(sock->addr, ':') != NULL;
+}
+
+static bool
+shm_sock_is_ipv4(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_is_ipv4(sock->posix_sock);
+	}
+
+	return strchr(sock->addr, ':') == NULL;
+}
+
+static bool
+shm_sock_is_connected(struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock != NULL) {
+		return spdk_sock_is_connected(sock->posix_sock);
+	}
+
+	return sock->connection_status == 0 && !shm_sock_peer_closed(sock);
+}
+
+static struct spdk_sock_group_impl *
+shm_sock_group_impl_get_optimal(struct spdk_sock *_sock, struct spdk_sock_group_impl *hint)
+{
+	return NULL;
+}
+
+static struct spdk_sock_group_impl *
+shm_sock_group_impl_create(void)
+{
+	struct spdk_shm_sock_group_impl *group_impl;
+
+	group_impl = calloc(1, sizeof(*group_impl));
+	if (group_impl == NULL) {
+		SPDK_ERRLOG("group_impl allocation failed\n");
+		return NULL;
+	}
+
+	TAILQ_INIT(&group_impl->socks);
+
+	return &group_impl->base;
+}
+
+static void
+shm_sock_posix_event_cb(void *arg, struct spdk_sock_group *posix_group,
+			struct spdk_sock *posix_sock)
+{
+	struct spdk_shm_sock *sock = arg;
+	struct spdk_shm_sock_group_impl *group = __shm_group_impl(sock->base.group_impl);
+
+	assert(group->poll_socks != NULL);
+	assert(group->poll_num_events < group->poll_max_events);
+	group->poll_socks[group->poll_num_events++] = &sock->base;
+}
+
+static int
+shm_sock_group_impl_add_sock(struct spdk_sock_group_impl *_group, struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock_group_impl *group = __shm_group_impl(_group);
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock == NULL) {
+		TAILQ_INSERT_TAIL(&group->socks, sock, link);
+		return 0;
+	}
+
+	if (group->posix_group == NULL) {
+		group->posix_group = spdk_sock_group_create(NULL);
+		if (group->posix_group == NULL) {
+			return -1;
+		}
+	}
+
+	return spdk_sock_group_add_sock(group->posix_group, sock->posix_sock,
+					shm_sock_posix_event_cb, sock);
+}
+
+static int
+shm_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group, struct spdk_sock *_sock)
+{
+	struct spdk_shm_sock_group_impl *group = __shm_group_impl(_group);
+	struct spdk_shm_sock *sock = __shm_sock(_sock);
+
+	if (sock->posix_sock == NULL) {
+		TAILQ_REMOVE(&group->socks, sock, link);
+		return 0;
+	}
+
+	return spdk_sock_group_remove_sock(group->posix_group, sock->posix_sock);
+}
+
+static bool
+shm_sock_has_event(struct spdk_shm_sock *sock)
+{
+	ssize_t bytes;
+
+	/* A failed connection is reported, the user gets the error when reading */
+	if (sock->connection_status < 0) {
+		return true;
+	}
+
+	bytes = shm_ring_bytes_available(sock);
+	if (bytes < 0 || bytes >= sock->recvlowat) {
+		return true;
+	}
+
+	/* Report the end of the connection, the user reads what is left and then 0 */
+	return shm_sock_peer_closed(sock);
+}
+
+static int
+shm_sock_group_impl_poll(struct spdk_sock_group_impl *_group, int max_events,
+			 struct spdk_sock **socks)
+{
+	struct spdk_shm_sock_group_impl *group = __shm_group_impl(_group);
+	struct spdk_shm_sock *sock, *tmp, *last = NULL;
+	int num_events = 0, rc;
+
+	/* This must be a TAILQ_FOREACH_SAFE because while flushing,
+	 * a completion callback could remove the sock from the
+	 * group. */
+	TAILQ_FOREACH_SAFE(sock, &group->socks, link, tmp) {
+		rc = _sock_flush(&sock->base);
+		if (rc < 0 && errno != EAGAIN) {
+			spdk_sock_abort_requests(&sock->base);
+		}
+	}
+
+	assert(max_events > 0);
+
+	TAILQ_FOREACH(sock, &group->socks, link) {
+		if (num_events == max_events) {
+			break;
+		}
+
+		if (shm_sock_has_event(sock)) {
+			socks[num_events++] = &sock->base;
+			last = sock;
+		}
+	}
+
+	/* If there were more events than we could report, the sockets after the
+	 * last one reported go first next time. */
+	if (num_events == max_events) {
+		while ((sock = TAILQ_FIRST(&group->socks)) != last) {
+			TAILQ_REMOVE(&group->socks, sock, link);
+			TAILQ_INSERT_TAIL(&group->socks, sock, link);
+		}
+		TAILQ_REMOVE(&group->socks, last, link);
+		TAILQ_INSERT_TAIL(&group->socks, last, link);
+	}
+
+	if (group->posix_group != NULL && num_events < max_events) {
+		group->poll_socks = socks;
+		group->poll_num_events = num_events;
+		group->poll_max_events = max_events;
+
+		rc = spdk_sock_group_poll_count(group->posix_group, max_events - num_events);
+
+		num_events = group->poll_num_events;
+		group->poll_socks = NULL;
+		if (rc < 0) {
+			return -1;
+		}
+	}
+
+	return num_events;
+}
+
+static int
+shm_sock_group_impl_register_interrupt(struct spdk_sock_group_impl *_group, uint32_t events,
+				       spdk_interrupt_fn fn, void *arg, const char *name)
+{
+	SPDK_ERRLOG("Interrupt mode is not supported in the shm sock implementation.");
+
+	return -ENOTSUP;
+}
+
+static void
+shm_sock_group_impl_unregister_interrupt(struct spdk_sock_group_impl *_group)
+{
+}
+
+static int
+shm_sock_group_impl_close(struct spdk_sock_group_impl *_group)
+{
+	struct spdk_shm_sock_group_impl *group = __shm_group_impl(_group);
+	int rc = 0;
+
+	assert(TAILQ_EMPTY(&group->socks));
+
+	if (group->posix_group != NULL) {
+		rc = spdk_sock_group_close(&group->posix_group);
+	}
+
+	free(group);
+
+	return rc;
+}
+
+static struct spdk_net_impl g_shm_net_impl = {
+	.name		= "shm",
+	.getaddr	= shm_sock_getaddr,
+	.get_interface_name = shm_sock_get_interface_name,
+	.get_numa_id	= shm_sock_get_numa_id,
+	.connect	= shm_sock_connect,
+	.listen		= shm_sock_listen,
+	.accept		= shm_sock_accept,
+	.close		= shm_sock_close,
+	.recv		= shm_sock_recv,
+	.readv		= shm_sock_readv,
+	.writev		= shm_sock_writev,
+	.recv_next	= shm_sock_recv_next,
+	.writev_async	= shm_sock_writev_async,
+	.flush		= shm_sock_flush,
+	.set_recvlowat	= shm_sock_set_recvlowat,
+	.set_recvbuf	= shm_sock_set_recvbuf,
+	.set_sendbuf	= shm_sock_set_sendbuf,
+	.is_ipv6	= shm_sock_is_ipv6,
+	.is_ipv4	= shm_sock_is_ipv4,
+	.is_connected	= shm_sock_is_connected,
+	.group_impl_get_optimal	= shm_sock_group_impl_get_optimal,
+	.group_impl_create	= shm_sock_group_impl_create,
+	.group_impl_add_sock	= shm_sock_group_impl_add_sock,
+	.group_impl_remove_sock	= shm_sock_group_impl_remove_sock,
+	.group_impl_poll	= shm_sock_group_impl_poll,
+	.group_impl_register_interrupt	= shm_sock_group_impl_register_interrupt,
+	.group_impl_unregister_interrupt	= shm_sock_group_impl_unregister_interrupt,
+	.group_impl_close	= shm_sock_group_impl_close,
+	.get_opts	= shm_sock_impl_get_opts,
+	.set_opts	= shm_sock_impl_set_opts,
+};
+
+SPDK_NET_IMPL_REGISTER(shm, &g_shm_net_impl);
+
+SPDK_LOG_REGISTER_COMPONENT(sock_shm)
@@ -39,6 +39,18 @@ enum uring_task_type {
 #define SPDK_ZEROCOPY
 #endif
 
+#if defined(SPDK_ZEROCOPY) && defined(IORING_CQE_F_NOTIF)
+#define SPDK_URING_SEND_ZC
+#endif
+
+/* Maximum number of zero-copy sends per socket whose notification is still
+ * pending. When all of them are in use, data is copied. */
+#define URING_ZC_NOTIF_COUNT 16
+
+/* Set in the user_data of zero-copy sends, which point to a struct spdk_uring_zc_notif
+ * rather than to a struct spdk_uring_task. */
+#define URING_ZC_NOTIF_TAG 1ULL
+
 /* We don't know how big the buffers that the user posts will be, but this
  * is the maximum we'll ever allow it to receive in a single command.
  * If the user buffers are smaller, it will just receive less. */
@@ -65,9 +77,27 @@ struct spdk_uring_task {
 	int					iov_cnt;
 	struct spdk_sock_request		*last_req;
 	bool					is_zcopy;
+	struct spdk_uring_zc_notif		*zc_notif;
 	STAILQ_ENTRY(spdk_uring_task)		link;
 };
 
+/* Tracks a send issued with IORING_OP_SENDMSG_ZC. The kernel posts the result of
+ * the send first and a notification once it no longer references the buffers.
+ * Trackers belong to the group, so that they can outlive the removal of their socket. */
+struct spdk_uring_zc_notif {
+	struct spdk_uring_sock_group_impl	*group;
+	/* NULL once the socket was removed from the group */
+	struct spdk_uring_sock			*sock;
+	/* sendmsg_idx of the requests sent, valid once the send completed */
+	uint32_t				idx;
+	bool					has_reqs;
+	bool					in_use;
+	bool					send_done;
+	bool					notif_done;
+	TAILQ_ENTRY(spdk_uring_zc_notif)	link;
+	STAILQ_ENTRY(spdk_uring_zc_notif)	free_link;
+};
+
 struct spdk_uring_sock {
 	struct spdk_sock			base;
 	int					fd;
@@ -83,6 +113,7 @@ struct spdk_uring_sock {
 	void					*recv_buf;
 	int					recv_buf_sz;
 	bool					zcopy;
+	bool					send_zc;
 	bool					pending_recv;
 	bool					pending_group_remove;
 	int					zcopy_send_flags;
@@ -92,6 +123,8 @@ struct spdk_uring_sock {
 	uint8_t					buf[SPDK_SOCK_CMG_INFO_SIZE];
 	TAILQ_ENTRY(spdk_uring_sock)		link;
 	char					interface_name[IFNAMSIZ];
+	uint32_t				zc_notifs_inflight;
+	TAILQ_HEAD(, spdk_uring_zc_notif)	zc_notifs;
 };
 /* 'struct cmsghdr' is mapped to the buffer 'buf', and while first element
  * of this control message header has a size of 8 bytes, 'buf'
@@ -123,6 +156,11 @@ struct spdk_uring_sock_group_impl {
 	uint32_t				buf_ring_count;
 	struct spdk_uring_buf_tracker		*trackers;
 	STAILQ_HEAD(, spdk_uring_buf_tracker)	free_trackers;
+
+	/* Whether the kernel supports IORING_OP_SENDMSG_ZC */
+	bool					send_zc;
+	STAILQ_HEAD(, spdk_uring_zc_notif)	free_zc_notifs;
+	struct spdk_sock_group_stats		stats;
 };
 
 static struct spdk_sock_impl_opts g_spdk_uring_sock_impl_opts = {
@@ -435,6 +473,7 @@ uring_sock_alloc(int fd, struct spdk_sock_impl_opts *impl_opts, bool enable_zero
 	memcpy(&sock->base.impl_opts, impl_opts, sizeof(*impl_opts));
 
 	STAILQ_INIT(&sock->recv_stream);
+	TAILQ_INIT(&sock->zc_notifs);
 
 #if defined(__linux__)
 	flag = 1;
@@ -1138,41 +1177,16 @@ sock_complete_write_reqs(struct spdk_sock *_sock, ssize_t rc, bool is_zcopy)
 }
 
 #ifdef SPDK_ZEROCOPY
+/* Complete the requests sent with sendmsg indexes from first_idx to last_idx,
+ * which the kernel no longer references. */
 static int
-_sock_check_zcopy(struct spdk_sock *_sock, int status)
+_sock_complete_zcopy_reqs(struct spdk_sock *_sock, uint32_t first_idx, uint32_t last_idx)
 {
-	struct spdk_uring_sock *sock = __uring_sock(_sock);
 	ssize_t rc;
-	struct sock_extended_err *serr;
-	struct cmsghdr *cm;
 	uint32_t idx;
 	struct spdk_sock_request *req, *treq;
 	bool found;
 
-	assert(sock->zcopy == true);
-	if (spdk_unlikely(status) < 0) {
-		if (!TAILQ_EMPTY(&_sock->pending_reqs)) {
-			SPDK_ERRLOG("Attempting to receive from ERRQUEUE yielded error, but pending list still has orphaned entries, status =%d\n",
-				    status);
-		} else {
-			SPDK_WARNLOG("Recvmsg yielded an error!\n");
-		}
-		return 0;
-	}
-
-	cm = CMSG_FIRSTHDR(&sock->errqueue_task.msg);
-	if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
-	      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
-		SPDK_WARNLOG("Unexpected cmsg level or type!\n");
-		return 0;
-	}
-
-	serr = (struct sock_extended_err *)CMSG_DATA(cm);
-	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
-		SPDK_WARNLOG("Unexpected extended error origin\n");
-		return 0;
-	}
-
 	/* Most of the time, the pending_reqs array is in the exact
 	 * order we need such that all of the requests to complete are
 	 * in order, in the front. It is guaranteed that all requests
@@ -1180,7 +1194,7 @@ _sock_check_zcopy(struct spdk_sock *_sock, int status)
 	 * we encounter one match we can stop looping as soon as a
 	 * non-match is found.
 	 */
-	for (idx = serr->ee_info; idx <= serr->ee_data; idx++) {
+	for (idx = first_idx; idx <= last_idx; idx++) {
 		found = false;
 		TAILQ_FOREACH_SAFE(req, &_sock->pending_reqs, internal.link, treq) {
 			if (!req->internal.is_zcopy) {
@@ -1204,6 +1218,44 @@ _sock_check_zcopy(struct spdk_sock *_sock, int status)
 	return 0;
 }
 
+static int
+_sock_check_zcopy(struct spdk_sock *_sock, int status)
+{
+	struct spdk_uring_sock *sock = __uring_sock(_sock);
+	struct sock_extended_err *serr;
+	struct cmsghdr *cm;
+
+	assert(sock->zcopy == true);
+	if (spdk_unlikely(status) < 0) {
+		if (!TAILQ_EMPTY(&_sock->pending_reqs)) {
+			SPDK_ERRLOG("Attempting to receive from ERRQUEUE yielded error, but pending list still has orphaned entries, status =%d\n",
+				    status);
+		} else {
+			SPDK_WARNLOG("Recvmsg yielded an error!\n");
+		}
+		return 0;
+	}
+
+	cm = CMSG_FIRSTHDR(&sock->errqueue_task.msg);
+	if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+	      (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+		SPDK_WARNLOG("Unexpected cmsg level or type!\n");
+		return 0;
+	}
+
+	serr = (struct sock_extended_err *)CMSG_DATA(cm);
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+		SPDK_WARNLOG("Unexpected extended error origin\n");
+		return 0;
+	}
+
+	if (sock->group != NULL) {
+		sock->group->stats.send_zcopy_notifications += serr->ee_data - serr->ee_info + 1;
+	}
+
+	return _sock_complete_zcopy_reqs(_sock, serr->ee_info, serr->ee_data);
+}
+
 static void
 _sock_prep_errqueue(struct spdk_sock *_sock)
 {
@@ -1230,6 +1282,83 @@ _sock_prep_errqueue(struct spdk_sock *_sock)
 
 #endif
 
+#ifdef SPDK_URING_SEND_ZC
+static struct spdk_uring_zc_notif *
+_sock_get_zc_notif(struct spdk_uring_sock *sock)
+{
+	struct spdk_uring_sock_group_impl *group = sock->group;
+	struct spdk_uring_zc_notif *notif;
+
+	if (sock->zc_notifs_inflight >= URING_ZC_NOTIF_COUNT) {
+		return NULL;
+	}
+
+	notif = STAILQ_FIRST(&group->free_zc_notifs);
+	if (notif != NULL) {
+		STAILQ_REMOVE_HEAD(&group->free_zc_notifs, free_link);
+	} else {
+		notif = calloc(1, sizeof(*notif));
+		if (notif == NULL) {
+			return NULL;
+		}
+	}
+
+	assert(!notif->in_use);
+	notif->group = group;
+	notif->sock = sock;
+	notif->in_use = true;
+	notif->send_done = false;
+	notif->notif_done = false;
+	notif->has_reqs = false;
+	TAILQ_INSERT_TAIL(&sock->zc_notifs, notif, link);
+	sock->zc_notifs_inflight++;
+
+	return notif;
+}
+
+static void
+_sock_put_zc_notif(struct spdk_uring_zc_notif *notif)
+{
+	struct spdk_uring_sock *sock = notif->sock;
+
+	assert(notif->in_use);
+	if (sock != NULL) {
+		assert(sock->zc_notifs_inflight > 0);
+		TAILQ_REMOVE(&sock->zc_notifs, notif, link);
+		sock->zc_notifs_inflight--;
+	}
+	notif->in_use = false;
+	notif->sock = NULL;
+	STAILQ_INSERT_HEAD(&notif->group->free_zc_notifs, notif, free_link);
+}
+
+/* Called when the socket leaves the group. The notifications of zero-copy sends cannot be
+ * cancelled and may take a long time to arrive, so instead of waiting for them, complete
+ * the requests now and hand the trackers over to the group, which releases them once the
+ * notifications arrive. The requests are completed while the kernel may still read their
+ * buffers, but nothing is sent on the socket after its removal. */
+static void
+_sock_orphan_zc_notifs(struct spdk_uring_sock *sock)
+{
+	struct spdk_uring_zc_notif *notif;
+
+	/* Trackers are queued in the order of their sends */
+	while ((notif = TAILQ_FIRST(&sock->zc_notifs)) != NULL) {
+		/* The write task has already completed, only the notification is left */
+		assert(notif->send_done);
+		assert(!notif->notif_done);
+		TAILQ_REMOVE(&sock->zc_notifs, notif, link);
+		sock->zc_notifs_inflight--;
+		notif->sock = NULL;
+
+		if (notif->has_reqs) {
+			_sock_complete_zcopy_reqs(&sock->base, notif->idx, notif->idx);
+		}
+	}
+	assert(sock->zc_notifs_inflight == 0);
+}
+#endif
+
 static void
 _sock_flush(struct spdk_sock *_sock)
 {
@@ -1267,6 +1396,24 @@ _sock_flush(struct spdk_sock *_sock)
 	sock->group->io_queued++;
 
 	sqe = io_uring_get_sqe(&sock->group->uring);
+#ifdef SPDK_URING_SEND_ZC
+	if (sock->send_zc && task->is_zcopy) {
+		task->zc_notif = _sock_get_zc_notif(sock);
+		if (task->zc_notif != NULL) {
+			io_uring_prep_sendmsg_zc(sqe, sock->fd, &sock->write_task.msg,
+						 flags & ~MSG_ZEROCOPY);
+			io_uring_sqe_set_data(sqe, (void *)((uintptr_t)task->zc_notif |
+							    URING_ZC_NOTIF_TAG));
+			task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+			return;
+		}
+
+		/* Too many sends still referenced by the kernel, copy the data instead.
+		 * MSG_ZEROCOPY must not be used, the error queue is not polled. */
+		task->is_zcopy = false;
+		flags &= ~MSG_ZEROCOPY;
+	}
+#endif
 	io_uring_prep_sendmsg(sqe, sock->fd, &sock->write_task.msg, flags);
 	io_uring_sqe_set_data(sqe, task);
 	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
@@ -1336,6 +1483,70 @@ uring_sock_fail(struct spdk_uring_sock *sock, int status)
 	}
 }
 
+#ifdef SPDK_URING_SEND_ZC
+/* Handle one of the two completions of a zero-copy send: the result of the send,
+ * flagged with IORING_CQE_F_MORE when a notification follows, and the notification
+ * that the kernel is done with the buffers. Requests are only completed after both. */
+static int
+_sock_zc_complete(struct spdk_uring_zc_notif *notif, int status, uint32_t flags)
+{
+	struct spdk_uring_sock *sock = notif->sock;
+	struct spdk_uring_task *task;
+	uint32_t idx;
+
+	if (spdk_unlikely(sock == NULL)) {
+		/* The socket left the group, its requests have already been completed */
+		assert(flags & IORING_CQE_F_NOTIF);
+		notif->group->stats.send_zcopy_notifications++;
+		_sock_put_zc_notif(notif);
+		return 0;
+	}
+
+	assert(sock->group != NULL);
+	task = &sock->write_task;
+
+	if (flags & IORING_CQE_F_NOTIF) {
+		sock->group->stats.send_zcopy_notifications++;
+		notif->notif_done = true;
+		if (!notif->send_done) {
+			return 0;
+		}
+	} else {
+		assert(task->zc_notif == notif);
+		task->zc_notif = NULL;
+		task->status = SPDK_URING_SOCK_TASK_NOT_IN_USE;
+		notif->send_done = true;
+
+		if (status == -EAGAIN || status == -EWOULDBLOCK || status == -ENOBUFS ||
+		    status == -ECANCELED) {
+			/* Nothing was sent, the requests stay queued */
+		} else if (spdk_unlikely(status < 0)) {
+			uring_sock_fail(sock, status);
+		} else {
+			task->last_req = NULL;
+			task->iov_cnt = 0;
+			task->is_zcopy = false;
+			sock->group->stats.send_zcopy_bytes += status;
+			sock_complete_write_reqs(&sock->base, status, true);
+			notif->idx = sock->sendmsg_idx - 1;
+			notif->has_reqs = true;
+		}
+
+		if ((flags & IORING_CQE_F_MORE) && !notif->notif_done) {
+			return 0;
+		}
+	}
+
+	_sock_put_zc_notif(notif);
+	if (!notif->has_reqs) {
+		return 0;
+	}
+
+	idx = notif->idx;
+	return _sock_complete_zcopy_reqs(&sock->base, idx, idx);
+}
+#endif
+
 static int
 sock_uring_group_reap(struct spdk_uring_sock_group_impl *group, int max, int max_read_events,
 		      struct spdk_sock **socks)
@@ -1357,6 +1568,28 @@ sock_uring_group_reap(struct spdk_uring_sock_group_impl *group, int max, int max
 			break;
 		}
 
+#ifdef SPDK_URING_SEND_ZC
+		if (cqe->user_data & URING_ZC_NOTIF_TAG) {
+			struct spdk_uring_zc_notif *notif;
+
+			notif = (struct spdk_uring_zc_notif *)(uintptr_t)(cqe->user_data &
+					~URING_ZC_NOTIF_TAG);
+			assert(notif->group == group);
+			status = cqe->res;
+			flags = cqe->flags;
+			io_uring_cqe_seen(&group->uring, cqe);
+
+			/* The send stays in flight until its last completion */
+			if (!(flags & IORING_CQE_F_MORE)) {
+				group->io_inflight--;
+				group->io_avail++;
+			}
+
+			_sock_zc_complete(notif, status, flags);
+			continue;
+		}
+#endif
+
 		task = (struct spdk_uring_task *)cqe->user_data;
 		assert(task != NULL);
 		sock = task->sock;
@@ -1429,6 +1662,11 @@ sock_uring_group_reap(struct spdk_uring_sock_group_impl *group, int max, int max
 				task->iov_cnt = 0;
 				is_zcopy = task->is_zcopy;
 				task->is_zcopy = false;
+				if (is_zcopy) {
+					group->stats.send_zcopy_bytes += status;
+				} else {
+					group->stats.send_copy_bytes += status;
+				}
 				sock_complete_write_reqs(&sock->base, status, is_zcopy);
 			}
 
@@ -1713,6 +1951,9 @@ static struct spdk_sock_group_impl *
 uring_sock_group_impl_create(void)
 {
 	struct spdk_uring_sock_group_impl *group_impl;
+#ifdef SPDK_URING_SEND_ZC
+	struct io_uring_probe *probe;
+#endif
 
 	group_impl = calloc(1, sizeof(*group_impl));
 	if (group_impl == NULL) {
@@ -1729,6 +1970,15 @@ uring_sock_group_impl_create(void)
 	}
 
 	TAILQ_INIT(&group_impl->pending_recv);
+	STAILQ_INIT(&group_impl->free_zc_notifs);
+
+#ifdef SPDK_URING_SEND_ZC
+	probe = io_uring_get_probe_ring(&group_impl->uring);
+	if (probe != NULL) {
+		group_impl->send_zc = io_uring_opcode_supported(probe, IORING_OP_SENDMSG_ZC);
+		io_uring_free_probe(probe);
+	}
+#endif
 
 	if (uring_sock_group_impl_buf_pool_alloc(group_impl) < 0) {
 		SPDK_ERRLOG("Failed to create buffer ring."
@@ -1786,8 +2036,12 @@ uring_sock_group_impl_add_sock(struct spdk_sock_group_impl *_group,
 
 	/* We get an async read going immediately */
 	_sock_prep_read(&sock->base);
+#ifdef SPDK_URING_SEND_ZC
+	/* Zero-copy sends are completed by io_uring notifications instead of the error queue */
+	sock->send_zc = sock->zcopy && group->send_zc;
+#endif
 #ifdef SPDK_ZEROCOPY
-	if (sock->zcopy) {
+	if (sock->zcopy && !sock->send_zc) {
 		_sock_prep_errqueue(_sock);
 	}
 #endif
@@ -1888,7 +2142,12 @@ uring_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group,
 	sock->pending_group_remove = true;
 
 	if (sock->write_task.status != SPDK_URING_SOCK_TASK_NOT_IN_USE) {
-		_sock_prep_cancel_task(_sock, &sock->write_task);
+		if (sock->write_task.zc_notif != NULL) {
+			_sock_prep_cancel_task(_sock, (void *)((uintptr_t)sock->write_task.zc_notif |
+							       URING_ZC_NOTIF_TAG));
+		} else {
+			_sock_prep_cancel_task(_sock, &sock->write_task);
+		}
 		/* Since spdk_sock_group_remove_sock is not asynchronous interface, so
 		 * currently can use a while loop here. */
 		while ((sock->write_task.status != SPDK_URING_SOCK_TASK_NOT_IN_USE) ||
@@ -1897,6 +2156,10 @@ uring_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group,
 		}
 	}
 
+#ifdef SPDK_URING_SEND_ZC
+	_sock_orphan_zc_notifs(sock);
+#endif
+
 	if (sock->read_task.status != SPDK_URING_SOCK_TASK_NOT_IN_USE) {
 		_sock_prep_cancel_task(_sock, &sock->read_task);
 		/* Since spdk_sock_group_remove_sock is not asynchronous interface, so
@@ -1938,6 +2201,7 @@ uring_sock_group_impl_remove_sock(struct spdk_sock_group_impl *_group,
 	}
 
 	sock->pending_group_remove = false;
+	sock->send_zc = false;
 	sock->group = NULL;
 	return 0;
 }
@@ -1946,6 +2210,7 @@ static int
 uring_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 {
 	struct spdk_uring_sock_group_impl *group = __uring_group_impl(_group);
+	struct spdk_uring_zc_notif *notif;
 
 	/* try to reap all the active I/O */
 	while (group->io_inflight) {
@@ -1954,6 +2219,12 @@ uring_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 	assert(group->io_inflight == 0);
 	assert(group->io_avail == SPDK_SOCK_GROUP_QUEUE_DEPTH);
 
+	/* All the notifications have arrived, so every tracker is back on the free list */
+	while ((notif = STAILQ_FIRST(&group->free_zc_notifs)) != NULL) {
+		STAILQ_REMOVE_HEAD(&group->free_zc_notifs, free_link);
+		free(notif);
+	}
+
 	uring_sock_group_impl_buf_pool_free(group);
 
 	io_uring_queue_exit(&group->uring);
@@ -1966,6 +2237,17 @@ uring_sock_group_impl_close(struct spdk_sock_group_impl *_group)
 	return 0;
 }
 
+static void
+uring_sock_group_impl_get_stats(struct spdk_sock_group_impl *_group,
+				struct spdk_sock_group_stats *stats)
+{
+	struct spdk_uring_sock_group_impl *group = __uring_group_impl(_group);
+
+	stats->send_zcopy_bytes += group->stats.send_zcopy_bytes;
+	stats->send_copy_bytes += group->stats.send_copy_bytes;
+	stats->send_zcopy_notifications += group->stats.send_zcopy_notifications;
+}
+
 static int
 uring_sock_flush(struct spdk_sock *_sock)
 {
@@ -1991,6 +2273,11 @@ uring_sock_flush(struct spdk_sock *_sock)
 		return -1;
 	}
 
+	/* The error queue is not polled when zero-copy sends are completed by io_uring */
+	if (sock->send_zc) {
+		flags = 0;
+	}
+
 	/* Gather an iov */
 	iovcnt = spdk_sock_prep_reqs(_sock, iovs, 0, NULL, &flags);
 	if (iovcnt == 0) {
@@ -2012,6 +2299,13 @@ uring_sock_flush(struct spdk_sock *_sock)
 #ifdef SPDK_ZEROCOPY
 	is_zcopy = flags & MSG_ZEROCOPY;
 #endif
+	if (sock->group != NULL) {
+		if (is_zcopy) {
+			sock->group->stats.send_zcopy_bytes += rc;
+		} else {
+			sock->group->stats.send_copy_bytes += rc;
+		}
+	}
 	retval = sock_complete_write_reqs(_sock, rc, is_zcopy);
 	if (retval < 0) {
 		/* if the socket is closed, return to avoid heap-use-after-free error */
@@ -2021,7 +2315,7 @@ uring_sock_flush(struct spdk_sock *_sock)
 
 #ifdef SPDK_ZEROCOPY
 	/* At least do once to check zero copy case */
-	if (sock->zcopy && !TAILQ_EMPTY(&_sock->pending_reqs)) {
+	if (sock->zcopy && !sock->send_zc && !TAILQ_EMPTY(&_sock->pending_reqs)) {
 		retval = recvmsg(sock->fd, &task->msg, MSG_ERRQUEUE);
 		if (retval < 0) {
 			if (errno == EWOULDBLOCK || errno == EAGAIN) {
@@ -2078,6 +2372,7 @@ static struct spdk_net_impl g_uring_net_impl = {
 	.group_impl_register_interrupt    = uring_sock_group_impl_register_interrupt,
 	.group_impl_unregister_interrupt  = uring_sock_group_impl_unregister_interrupt,
 	.group_impl_close	= uring_sock_group_impl_close,
+	.group_impl_get_stats	= uring_sock_group_impl_get_stats,
 	.get_opts		= uring_sock_impl_get_opts,
 	.set_opts		= uring_sock_impl_set_opts,
 };
@@ -455,6 +455,23 @@ def bdev_raid_remove_base_bdev(client, name):
     return client.call('bdev_raid_remove_base_bdev', params)
 
 
+def bdev_raid_set_read_policy(client, name, read_policy, write_mostly=None):
+    """Set read policy of a raid bdev
+    Args:
+        name: raid bdev name
+        read_policy: least_outstanding or latency
+        write_mostly: list of base bdev names that should only be read if no other base bdev is available (optional)
+    Returns:
+        None
+    """
+    params = dict()
+    params['name'] = name
+    params['read_policy'] = read_policy
+    if write_mostly is not None:
+        params['write_mostly'] = write_mostly
+    return client.call('bdev_raid_set_read_policy', params)
+
+
 def bdev_aio_create(client, filename, name, block_size=None, readonly=None, fallocate=None, uuid=None):
     """Construct a Linux AIO block device.
     Args:
@@ -501,13 +518,16 @@ def bdev_aio_delete(client, name):
     return client.call('bdev_aio_delete', params)
 
 
-def bdev_uring_create(client, filename, name, block_size=None, uuid=None):
+def bdev_uring_create(client, filename, name, block_size=None, uuid=None, sqpoll=None,
+                      iopoll=None):
     """Create a bdev with Linux io_uring backend.
     Args:
         filename: path to device or file (ex: /dev/nvme0n1)
         name: name of bdev
         block_size: block size of device (optional; autodetected if omitted)
         uuid: UUID of block device (optional)
+        sqpoll: submit I/O through a kernel submission queue polling thread (optional)
+        iopoll: poll the device for completions, requires polled queues (optional)
     Returns:
         Name of created bdev.
     """
@@ -518,6 +538,10 @@ def bdev_uring_create(client, filename, name, block_size=None, uuid=None):
         params['block_size'] = block_size
     if uuid is not None:
         params['uuid'] = uuid
+    if sqpoll is not None:
+        params['sqpoll'] = sqpoll
+    if iopoll is not None:
+        params['iopoll'] = iopoll
     return client.call('bdev_uring_create', params)
 
 
@@ -991,6 +1015,21 @@ def bdev_nvme_set_multipath_policy(client, name, policy, selector=None, rr_min_i
     return client.call('bdev_nvme_set_multipath_policy', params)
 
 
+def bdev_nvme_set_hedged_reads(client, name, percentile, min_delay_us=None):
+    """Set hedged reads policy of the NVMe bdev
+    Args:
+        name: NVMe bdev name
+        percentile: Read latency percentile after which a read is duplicated (0 disables)
+        min_delay_us: Minimum delay in microseconds before a read is duplicated (optional)
+    """
+    params = dict()
+    params['name'] = name
+    params['percentile'] = percentile
+    if min_delay_us is not None:
+        params['min_delay_us'] = min_delay_us
+    return client.call('bdev_nvme_set_hedged_reads', params)
+
+
 def bdev_nvme_get_path_iostat(client, name):
     """Get I/O statistics for IO paths of the block device.
     Args:
@@ -1668,6 +1707,33 @@ def bdev_set_qos_limit(
     return client.call('bdev_set_qos_limit', params)
 
 
+def bdev_set_coalesce(client, name, max_ios, max_delay_us=None):
+    """Set I/O coalescing on a block device.
+    Args:
+        name: name of block device
+        max_ios: maximum number of contiguous I/Os merged into one (<=32). 0 or 1 disables coalescing.
+        max_delay_us: maximum time in microseconds an I/O is held back (optional, default 100)
+    """
+    params = dict()
+    params['name'] = name
+    params['max_ios'] = max_ios
+    if max_delay_us is not None:
+        params['max_delay_us'] = max_delay_us
+    return client.call('bdev_set_coalesce', params)
+
+
+def bdev_set_fair_share(client, name, ios_per_sec):
+    """Set the I/O capacity shared between weighted descriptors of a block device.
+    Args:
+        name: name of block device
+        ios_per_sec: I/Os per second shared by weight (multiple of 1000). 0 enforces only per-descriptor limits.
+    """
+    params = dict()
+    params['name'] = name
+    params['ios_per_sec'] = ios_per_sec
+    return client.call('bdev_set_fair_share', params)
+
+
 def bdev_nvme_apply_firmware(client, bdev_name, filename):
     """Download and commit firmware to NVMe device.
     Args:
@@ -63,7 +63,8 @@ def bdev_lvol_grow_lvstore(client, uuid=None, lvs_name=None):
     return client.call('bdev_lvol_grow_lvstore', params)
 
 
-def bdev_lvol_create(client, lvol_name, size_in_mib, thin_provision=False, uuid=None, lvs_name=None, clear_method=None):
+def bdev_lvol_create(client, lvol_name, size_in_mib, thin_provision=False, uuid=None, lvs_name=None, clear_method=None,
+                     sub_cluster_sz=None):
     """Create a logical volume on a logical volume store.
 
     Args:
@@ -72,6 +73,7 @@ def bdev_lvol_create(client, lvol_name, size_in_mib, thin_provision=False, uuid=
         thin_provision: True to enable thin provisioning
         uuid: UUID of logical volume store to create logical volume on (optional)
         lvs_name: name of logical volume store to create logical volume on (optional)
+        sub_cluster_sz: granularity in bytes of the copy on first write to a cluster of a clone (optional)
 
     Either uuid or lvs_name must be specified, but not both.
 
@@ -90,6 +92,8 @@ def bdev_lvol_create(client, lvol_name, size_in_mib, thin_provision=False, uuid=
         params['lvs_name'] = lvs_name
     if clear_method:
         params['clear_method'] = clear_method
+    if sub_cluster_sz:
+        params['sub_cluster_sz'] = sub_cluster_sz
     return client.call('bdev_lvol_create', params)
 
 
@@ -110,12 +114,13 @@ def bdev_lvol_snapshot(client, lvol_name, snapshot_name):
     return client.call('bdev_lvol_snapshot', params)
 
 
-def bdev_lvol_clone(client, snapshot_name, clone_name):
+def bdev_lvol_clone(client, snapshot_name, clone_name, sub_cluster_sz=None):
     """Create a logical volume based on a snapshot.
 
     Args:
         snapshot_name: snapshot to clone
         clone_name: name of logical volume to create
+        sub_cluster_sz: granularity in bytes of the copy on first write to a cluster (optional)
 
     Returns:
         Name of created logical volume clone.
@@ -124,6 +129,8 @@ def bdev_lvol_clone(client, snapshot_name, clone_name):
         'snapshot_name': snapshot_name,
         'clone_name': clone_name
     }
+    if sub_cluster_sz:
+        params['sub_cluster_sz'] = sub_cluster_sz
     return client.call('bdev_lvol_clone', params)
 
 
@@ -227,6 +234,18 @@ def bdev_lvol_decouple_parent(client, name):
     return client.call('bdev_lvol_decouple_parent', params)
 
 
+def bdev_lvol_dedup(client, name):
+    """Release clusters of a logical volume that hold the same data as its parent.
+
+    Args:
+        name: name of logical volume to deduplicate
+    """
+    params = {
+        'name': name,
+    }
+    return client.call('bdev_lvol_dedup', params)
+
+
 def bdev_lvol_start_shallow_copy(client, src_lvol_name, dst_bdev_name):
     """Start a shallow copy of an lvol over a given bdev. The status of the operation
     can be obtained with bdev_lvol_check_shallow_copy
@@ -132,6 +132,9 @@ def nvmf_create_transport(client, **params):
         ack_timeout: ACK timeout in milliseconds (optional)
         data_wr_pool_size: RDMA data WR pool size. RDMA specific (optional)
         disable_command_passthru: Disallow command passthru.
+        recv_zcopy: Receive data into buffers provided to the socket group - TCP specific (optional)
+        recv_buf_count: Number of receive buffers per poll group - TCP specific (optional)
+        send_batch_size: Bytes a connection may queue before its socket is flushed - TCP specific (optional)
     Returns:
         True or False
     """
@@ -475,6 +478,9 @@ def nvmf_subsystem_add_ns(client, **params):
         anagrpid: ANA group ID (optional).
         no_auto_visible: Do not automatically make namespace visible to controllers (optional)
         hide_metadata: Enable hide_metadata option to the bdev (optional)
+        qos_weight: Weight of the namespace in the fair-share QoS of the bdev (optional)
+        qos_min_ios_per_sec: I/Os per second reserved for the namespace (optional)
+        qos_max_ios_per_sec: Upper limit of I/Os per second of the namespace (optional)
 
     Returns:
         The namespace ID
@@ -484,7 +490,8 @@ def nvmf_subsystem_add_ns(client, **params):
     apply_defaults(params, tgt_name=None)
     group_as(params, 'namespace', ['bdev_name', 'ptpl_file', 'nsid',
                                    'nguid', 'eui64', 'uuid', 'anagrpid', 'no_auto_visible',
-                                   'hide_metadata'])
+                                   'hide_metadata', 'qos_weight', 'qos_min_ios_per_sec',
+                                   'qos_max_ios_per_sec'])
     remove_null(params)
 
     return client.call('nvmf_subsystem_add_ns', params)
@@ -743,6 +750,33 @@ def nvmf_get_stats(client, tgt_name=None):
     return client.call('nvmf_get_stats', params)
 
 
+def nvmf_set_poll_group_policy(client, policy, tgt_name=None, balance_period_ms=None,
+                               imbalance_threshold=None, imbalance_periods=None):
+    """Set the policy used to place qpairs on poll groups.
+
+    Args:
+        policy: "transport" to let the transport place qpairs, or "load" to place them by measured load
+        tgt_name: name of the parent NVMe-oF target (optional)
+        balance_period_ms: interval at which the load of the poll groups is sampled (optional)
+        imbalance_threshold: busy percentage difference between poll groups considered imbalanced (optional)
+        imbalance_periods: consecutive imbalanced periods before a qpair is migrated, 0 disables migration (optional)
+
+    Returns:
+        True or False
+    """
+    params = {'policy': policy}
+    if tgt_name:
+        params['tgt_name'] = tgt_name
+    if balance_period_ms is not None:
+        params['balance_period_ms'] = balance_period_ms
+    if imbalance_threshold is not None:
+        params['imbalance_threshold'] = imbalance_threshold
+    if imbalance_periods is not None:
+        params['imbalance_periods'] = imbalance_periods
+
+    return client.call('nvmf_set_poll_group_policy', params)
+
+
 def nvmf_set_crdt(client, crdt1=None, crdt2=None, crdt3=None):
     """Set the 3 crdt (Command Retry Delay Time) values
 
@@ -549,13 +549,19 @@ if __name__ == "__main__":
                                               filename=args.filename,
                                               name=args.name,
                                               block_size=args.block_size,
-                                              uuid=args.uuid))
+                                              uuid=args.uuid,
+                                              sqpoll=args.sqpoll,
+                                              iopoll=args.iopoll))
 
     p = subparsers.add_parser('bdev_uring_create', help='Create a bdev with io_uring backend')
     p.add_argument('filename', help='Path to device or file (ex: /dev/nvme0n1)')
     p.add_argument('name', help='bdev name')
     p.add_argument('block_size', help='Block size for this bdev', type=int, nargs='?')
     p.add_argument('-u', '--uuid', help="UUID of the bdev")
+    p.add_argument('--sqpoll', help='Submit I/O through a kernel SQ polling thread',
+                   action='store_true', default=None)
+    p.add_argument('--iopoll', help='Poll the device for completions (requires polled queues)',
+                   action='store_true', default=None)
     p.set_defaults(func=bdev_uring_create)
 
     def bdev_uring_rescan(args):
@@ -989,6 +995,23 @@ if __name__ == "__main__":
                    type=int)
     p.set_defaults(func=bdev_nvme_set_multipath_policy)
 
+    def bdev_nvme_set_hedged_reads(args):
+        rpc.bdev.bdev_nvme_set_hedged_reads(args.client,
+                                            name=args.name,
+                                            percentile=args.percentile,
+                                            min_delay_us=args.min_delay_us)
+
+    p = subparsers.add_parser('bdev_nvme_set_hedged_reads',
+                              help="""Set hedged reads policy of the NVMe bdev""")
+    p.add_argument('-b', '--name', help='Name of the NVMe bdev', required=True)
+    p.add_argument('-p', '--percentile',
+                   help='Read latency percentile after which a read is duplicated (1-99, 0 disables)',
+                   type=int, required=True)
+    p.add_argument('-d', '--min-delay-us',
+                   help='Minimum delay in microseconds before a read is duplicated. Default: 100',
+                   type=int)
+    p.set_defaults(func=bdev_nvme_set_hedged_reads)
+
     def bdev_nvme_get_path_iostat(args):
         print_dict(rpc.bdev.bdev_nvme_get_path_iostat(args.client,
                                                       name=args.name))
@@ -1353,6 +1376,33 @@ if __name__ == "__main__":
                    type=int)
     p.set_defaults(func=bdev_set_qos_limit)
 
+    def bdev_set_coalesce(args):
+        rpc.bdev.bdev_set_coalesce(args.client,
+                                   name=args.name,
+                                   max_ios=args.max_ios,
+                                   max_delay_us=args.max_delay_us)
+
+    p = subparsers.add_parser('bdev_set_coalesce',
+                              help='Set I/O coalescing of contiguous reads and writes on a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('max_ios', help='Maximum number of I/Os merged into one (<=32). 0 or 1 disables coalescing.',
+                   type=int)
+    p.add_argument('-d', '--max-delay-us', help='Maximum time in microseconds an I/O is held back (default 100)',
+                   type=int)
+    p.set_defaults(func=bdev_set_coalesce)
+
+    def bdev_set_fair_share(args):
+        rpc.bdev.bdev_set_fair_share(args.client,
+                                     name=args.name,
+                                     ios_per_sec=args.ios_per_sec)
+
+    p = subparsers.add_parser('bdev_set_fair_share',
+                              help='Set the I/O capacity shared by weight between the descriptors of a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Malloc0')
+    p.add_argument('ios_per_sec', help='I/Os per second shared by weight (multiple of 1000). 0 enforces only per-descriptor limits.',
+                   type=int)
+    p.set_defaults(func=bdev_set_fair_share)
+
     def bdev_error_inject_error(args):
         rpc.bdev.bdev_error_inject_error(args.client,
                                          name=args.name,
@@ -2094,7 +2144,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                              thin_provision=args.thin_provision,
                                              clear_method=args.clear_method,
                                              uuid=args.uuid,
-                                             lvs_name=args.lvs_name))
+                                             lvs_name=args.lvs_name,
+                                             sub_cluster_sz=args.sub_cluster_sz))
 
     p = subparsers.add_parser('bdev_lvol_create', help='Add a bdev with an logical volume backend')
     p.add_argument('-u', '--uuid', help='lvol store UUID')
@@ -2102,6 +2153,9 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-t', '--thin-provision', action='store_true', help='create lvol bdev as thin provisioned')
     p.add_argument('-c', '--clear-method', help="""Change default data clusters clear method.
         Available: none, unmap, write_zeroes""")
+    p.add_argument('-s', '--sub-cluster-sz', help="""Granularity in bytes of the copy from the parent
+        on the first write to a cluster of a thin provisioned lvol, inherited by its snapshots and clones.
+        Must divide the cluster size into at most 64 sub-clusters""", type=int)
     p.add_argument('lvol_name', help='name for this lvol')
     p.add_argument('size_in_mib', help='size in MiB for this bdev', type=int)
     p.set_defaults(func=bdev_lvol_create)
@@ -2119,9 +2173,12 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     def bdev_lvol_clone(args):
         print_json(rpc.lvol.bdev_lvol_clone(args.client,
                                             snapshot_name=args.snapshot_name,
-                                            clone_name=args.clone_name))
+                                            clone_name=args.clone_name,
+                                            sub_cluster_sz=args.sub_cluster_sz))
 
     p = subparsers.add_parser('bdev_lvol_clone', help='Create a clone of an lvol snapshot')
+    p.add_argument('-s', '--sub-cluster-sz', help="""Granularity in bytes of the copy from the snapshot
+        on the first write to a cluster of the clone. Default: the one of the snapshot""", type=int)
     p.add_argument('snapshot_name', help='lvol snapshot name')
     p.add_argument('clone_name', help='lvol clone name')
     p.set_defaults(func=bdev_lvol_clone)
@@ -2165,6 +2222,14 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='lvol bdev name')
     p.set_defaults(func=bdev_lvol_decouple_parent)
 
+    def bdev_lvol_dedup(args):
+        rpc.lvol.bdev_lvol_dedup(args.client,
+                                 name=args.name)
+
+    p = subparsers.add_parser('bdev_lvol_dedup', help='Release clusters of lvol that hold the same data as its parent')
+    p.add_argument('name', help='lvol bdev name')
+    p.set_defaults(func=bdev_lvol_dedup)
+
     def bdev_lvol_resize(args):
         rpc.lvol.bdev_lvol_resize(args.client,
                                   name=args.name,
@@ -2303,7 +2368,7 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p = subparsers.add_parser('bdev_raid_create', help='Create new raid bdev')
     p.add_argument('-n', '--name', help='raid bdev name', required=True)
     p.add_argument('-z', '--strip-size-kb', help='strip size in KB', type=int)
-    p.add_argument('-r', '--raid-level', help='raid level, raid0, raid1 and a special level concat are supported', required=True)
+    p.add_argument('-r', '--raid-level', help='raid level, raid0, raid1, raid10 and a special level concat are supported', required=True)
     p.add_argument('-b', '--base-bdevs', help='base bdevs name, whitespace separated list in quotes', required=True)
     p.add_argument('--uuid', help='UUID for this raid bdev')
     p.add_argument('-s', '--superblock', help='information about raid bdev will be stored in superblock on each base bdev, '
@@ -2333,6 +2398,23 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='base bdev name')
     p.set_defaults(func=bdev_raid_remove_base_bdev)
 
+    def bdev_raid_set_read_policy(args):
+        write_mostly = None
+        if args.write_mostly is not None:
+            write_mostly = args.write_mostly.strip().split()
+
+        rpc.bdev.bdev_raid_set_read_policy(args.client,
+                                           name=args.name,
+                                           read_policy=args.read_policy,
+                                           write_mostly=write_mostly)
+    p = subparsers.add_parser('bdev_raid_set_read_policy', help='Set read policy of a raid1 bdev')
+    p.add_argument('name', help='raid bdev name')
+    p.add_argument('-p', '--read-policy', help='least_outstanding or latency', required=True,
+                   choices=['least_outstanding', 'latency'])
+    p.add_argument('-w', '--write-mostly', help="""names of base bdevs which should only be read if no other base
+    bdev is available, whitespace separated list in quotes""")
+    p.set_defaults(func=bdev_raid_set_read_policy)
+
     # split
     def bdev_split_create(args):
         print_array(rpc.bdev.bdev_split_create(args.client,
@@ -2645,6 +2727,12 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--ack-timeout', help='ACK timeout in milliseconds', type=int)
     p.add_argument('--data-wr-pool-size', help='RDMA data WR pool size. Relevant only for RDMA transport', type=int)
     p.add_argument('--disable-command-passthru', help='Disallow command passthru', action='store_true')
+    p.add_argument('--recv-zcopy', action='store_true', help='''Receive data into buffers provided to
+    the socket group and pass them to requests without a copy. Relevant only for TCP transport''')
+    p.add_argument('--recv-buf-count', help='''Number of receive buffers each poll group provides to
+    its socket group. Derived from num_shared_buffers by default. Relevant only for TCP transport''', type=int)
+    p.add_argument('--send-batch-size', help='''Bytes a connection may queue before its socket is
+    flushed. PDUs are flushed once per poll, 0 disables it. Relevant only for TCP transport''', type=int)
     p.set_defaults(func=nvmf_create_transport)
 
     def nvmf_get_transports(args):
@@ -2823,6 +2911,11 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                    help='Do not auto make namespace visible to controllers (optional)')
     p.add_argument('-N', '--hide-metadata', action='store_true',
                    help='Enable hide_metadata option to the bdev (optional)')
+    p.add_argument('-w', '--qos-weight', help='Weight of the namespace in the fair-share QoS of the bdev (optional)',
+                   type=int)
+    p.add_argument('--qos-min-ios-per-sec', help='I/Os per second reserved for the namespace (optional)', type=int)
+    p.add_argument('--qos-max-ios-per-sec', help='Upper limit of I/Os per second of the namespace (optional)',
+                   type=int)
     p.set_defaults(func=nvmf_subsystem_add_ns)
 
     def nvmf_subsystem_set_ns_ana_group(args):
@@ -2981,6 +3074,25 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
     p.set_defaults(func=nvmf_get_stats)
 
+    def nvmf_set_poll_group_policy(args):
+        print_dict(rpc.nvmf.nvmf_set_poll_group_policy(args.client,
+                                                       policy=args.policy,
+                                                       tgt_name=args.tgt_name,
+                                                       balance_period_ms=args.balance_period_ms,
+                                                       imbalance_threshold=args.imbalance_threshold,
+                                                       imbalance_periods=args.imbalance_periods))
+
+    p = subparsers.add_parser('nvmf_set_poll_group_policy',
+                              help='Set the policy used to place qpairs on poll groups')
+    p.add_argument('policy', help='Placement policy', choices=['transport', 'load'])
+    p.add_argument('-t', '--tgt-name', help='The name of the parent NVMe-oF target (optional)', type=str)
+    p.add_argument('-p', '--balance-period-ms', help='Interval at which the poll group load is sampled', type=int)
+    p.add_argument('-i', '--imbalance-threshold',
+                   help='Difference in busy percentage between poll groups considered imbalanced', type=int)
+    p.add_argument('-n', '--imbalance-periods',
+                   help='Consecutive imbalanced periods before a qpair is migrated, 0 disables migration', type=int)
+    p.set_defaults(func=nvmf_set_poll_group_policy)
+
     def nvmf_set_crdt(args):
         print_dict(rpc.nvmf.nvmf_set_crdt(args.client, args.crdt1, args.crdt2, args.crdt3))
 
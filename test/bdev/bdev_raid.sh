@@ -196,7 +196,7 @@ function verify_raid_bdev_properties() {
 
 function has_redundancy() {
 	case $1 in
-		"raid1" | "raid5f") return 0 ;;
+		"raid1" | "raid10" | "raid5f" | "raid6") return 0 ;;
 		*) return 1 ;;
 	esac
 }
@@ -629,6 +629,9 @@ function raid_rebuild_test() {
 		if [ $raid_level = "raid5f" ]; then
 			write_unit_size=$((strip_size * 2 * (num_base_bdevs - 1)))
 			echo $((base_blocklen * write_unit_size / 1024)) > /sys/block/nbd0/queue/max_sectors_kb
+		elif [ $raid_level = "raid6" ]; then
+			write_unit_size=$((strip_size * 2 * (num_base_bdevs - 2)))
+			echo $((base_blocklen * write_unit_size / 1024)) > /sys/block/nbd0/queue/max_sectors_kb
 		else
 			write_unit_size=1
 		fi
@@ -982,6 +985,16 @@ if [ "$has_nbd" = true ]; then
 	done
 fi
 
+for n in 4 6; do
+	run_test "raid10_state_function_test" raid_state_function_test raid10 $n false
+	run_test "raid10_state_function_test_sb" raid_state_function_test raid10 $n true
+	run_test "raid10_superblock_test" raid_superblock_test raid10 $n
+	if [ "$has_nbd" = true ]; then
+		run_test "raid10_rebuild_test" raid_rebuild_test raid10 $n false false true
+		run_test "raid10_rebuild_test_sb" raid_rebuild_test raid10 $n true false true
+	fi
+done
+
 for n in {3..4}; do
 	run_test "raid5f_state_function_test" raid_state_function_test raid5f $n false
 	run_test "raid5f_state_function_test_sb" raid_state_function_test raid5f $n true
@@ -992,6 +1005,18 @@ for n in {3..4}; do
 	fi
 done
 
+if [[ $CONFIG_RAID6 == y ]]; then
+	for n in {4..5}; do
+		run_test "raid6_state_function_test" raid_state_function_test raid6 $n false
+		run_test "raid6_state_function_test_sb" raid_state_function_test raid6 $n true
+		run_test "raid6_superblock_test" raid_superblock_test raid6 $n
+		if [ "$has_nbd" = true ]; then
+			run_test "raid6_rebuild_test" raid_rebuild_test raid6 $n false false true
+			run_test "raid6_rebuild_test_sb" raid_rebuild_test raid6 $n true false true
+		fi
+	done
+fi
+
 base_blocklen=4096
 
 run_test "raid_state_function_test_sb_4k" raid_state_function_test raid1 2 true
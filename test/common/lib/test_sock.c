@@ -42,6 +42,8 @@ DEFINE_STUB(spdk_sock_group_poll_count, int, (struct spdk_sock_group *group, int
 DEFINE_STUB(spdk_sock_group_close, int, (struct spdk_sock_group **group), 0);
 DEFINE_STUB(spdk_sock_group_provide_buf, int, (struct spdk_sock_group *group, void *buf, size_t len,
 		void *ctx), 0);
+DEFINE_STUB_V(spdk_sock_group_get_stats, (struct spdk_sock_group *group,
+		struct spdk_sock_group_stats *stats));
 
 static uint8_t g_buf[0x1000] = {};
 
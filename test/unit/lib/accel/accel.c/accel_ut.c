@@ -575,6 +575,48 @@ test_spdk_accel_submit_xor(void)
 	CU_ASSERT(expected_accel_task == &task);
 }
 
+static void
+test_spdk_accel_submit_pq_gen(void)
+{
+	const uint64_t nbytes = TEST_SUBMIT_SIZE;
+	uint8_t p[TEST_SUBMIT_SIZE] = {0};
+	uint8_t q[TEST_SUBMIT_SIZE] = {0};
+	uint8_t src1[TEST_SUBMIT_SIZE] = {0};
+	uint8_t src2[TEST_SUBMIT_SIZE] = {0};
+	void *sources[] = { src1, src2 };
+	uint32_t nsrcs = SPDK_COUNTOF(sources);
+	int rc;
+	struct spdk_accel_task task;
+	struct spdk_accel_task_aux_data task_aux;
+	struct spdk_accel_task *expected_accel_task = NULL;
+
+	STAILQ_INIT(&g_accel_ch->task_pool);
+	SLIST_INIT(&g_accel_ch->task_aux_data_pool);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, nsrcs, nbytes, NULL, NULL);
+	CU_ASSERT(rc == -ENOMEM);
+
+	STAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	SLIST_INSERT_HEAD(&g_accel_ch->task_aux_data_pool, &task_aux, link);
+
+	/* submission OK. */
+	rc = spdk_accel_submit_pq_gen(g_ch, p, q, sources, nsrcs, nbytes, NULL, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.nsrcs.srcs == sources);
+	CU_ASSERT(task.nsrcs.cnt == nsrcs);
+	CU_ASSERT(task.d.iovcnt == 1);
+	CU_ASSERT(task.d.iovs[0].iov_base == p);
+	CU_ASSERT(task.d.iovs[0].iov_len == nbytes);
+	CU_ASSERT(task.d2.iovcnt == 1);
+	CU_ASSERT(task.d2.iovs[0].iov_base == q);
+	CU_ASSERT(task.d2.iovs[0].iov_len == nbytes);
+	CU_ASSERT(task.op_code == SPDK_ACCEL_OPC_PQ_GEN);
+	expected_accel_task = STAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	STAILQ_REMOVE_HEAD(&g_sw_ch->tasks_to_complete, link);
+	CU_ASSERT(expected_accel_task == &task);
+}
+
 static void
 test_spdk_accel_module_find_by_name(void)
 {
@@ -4440,6 +4482,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32cv);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_copy_crc32c);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_xor);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_pq_gen);
 	CU_ADD_TEST(suite, test_spdk_accel_module_find_by_name);
 	CU_ADD_TEST(suite, test_spdk_accel_module_register);
 
@@ -415,6 +415,23 @@ stub_io_type_supported(void *_bdev, enum spdk_bdev_io_type io_type)
 	return g_io_types_supported[io_type];
 }
 
+static uint32_t g_batch_submit_count;
+static uint32_t g_batch_submit_num_ios;
+
+static void
+stub_submit_request_batch(struct spdk_io_channel *_ch, struct spdk_bdev_io **bdev_ios,
+			  uint32_t num_ios)
+{
+	uint32_t i;
+
+	g_batch_submit_count++;
+	g_batch_submit_num_ios = num_ios;
+
+	for (i = 0; i < num_ios; i++) {
+		stub_submit_request(_ch, bdev_ios[i]);
+	}
+}
+
 static struct spdk_bdev_fn_table fn_table = {
 	.destruct = stub_destruct,
 	.submit_request = stub_submit_request,
@@ -1291,6 +1308,293 @@ bdev_io_wait_test(void)
 	ut_fini_bdev();
 }
 
+static void
+bdev_channel_plug_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	int i, rc;
+
+	ut_init_bdev(NULL);
+	fn_table.submit_request_batch = stub_submit_request_batch;
+	g_batch_submit_count = 0;
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	/* I/O on an unplugged channel is submitted one at a time */
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	CU_ASSERT(g_batch_submit_count == 0);
+	stub_complete_io(1);
+
+	/* I/O on a plugged channel is held back until the outermost unplug */
+	spdk_bdev_channel_plug(io_ch);
+	spdk_bdev_channel_plug(io_ch);
+	for (i = 0; i < 3; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	spdk_bdev_channel_unplug(io_ch);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	CU_ASSERT(g_batch_submit_count == 0);
+	spdk_bdev_channel_unplug(io_ch);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 3);
+	CU_ASSERT(g_batch_submit_count == 1);
+	CU_ASSERT(g_batch_submit_num_ios == 3);
+	stub_complete_io(3);
+
+	/* A full batch is flushed without waiting for the unplug */
+	spdk_bdev_channel_plug(io_ch);
+	for (i = 0; i < BDEV_CH_PLUG_MAX_IO + 1; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == BDEV_CH_PLUG_MAX_IO);
+	CU_ASSERT(g_batch_submit_count == 2);
+	CU_ASSERT(g_batch_submit_num_ios == BDEV_CH_PLUG_MAX_IO);
+	spdk_bdev_channel_unplug(io_ch);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == BDEV_CH_PLUG_MAX_IO + 1);
+	CU_ASSERT(g_batch_submit_count == 3);
+	CU_ASSERT(g_batch_submit_num_ios == 1);
+	stub_complete_io(BDEV_CH_PLUG_MAX_IO + 1);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	fn_table.submit_request_batch = NULL;
+	ut_fini_bdev();
+}
+
+static void
+coalesce_status_cb(void *cb_arg, int status)
+{
+	g_status = status;
+}
+
+static void
+coalesce_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	int *num_done = cb_arg;
+
+	CU_ASSERT(success == true);
+	(*num_done)++;
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+bdev_io_coalesce_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct ut_expected_io *expected_io;
+	char buf[8][512];
+	uint32_t max_ios;
+	uint64_t max_delay_us;
+	int i, rc, num_done = 0;
+
+	ut_init_bdev(NULL);
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+	bdev_ch = __io_ch_to_bdev_ch(io_ch);
+
+	/* Invalid settings are rejected */
+	g_status = 0;
+	spdk_bdev_set_coalesce(bdev, SPDK_BDEV_IO_NUM_CHILD_IOV + 1, 100, coalesce_status_cb, NULL);
+	CU_ASSERT(g_status == -EINVAL);
+	g_status = 0;
+	spdk_bdev_set_coalesce(bdev, 4, 0, coalesce_status_cb, NULL);
+	CU_ASSERT(g_status == -EINVAL);
+	CU_ASSERT(bdev_ch->coalesce == NULL);
+
+	g_status = -1;
+	spdk_bdev_set_coalesce(bdev, 4, 100, coalesce_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	SPDK_CU_ASSERT_FATAL(bdev_ch->coalesce != NULL);
+	spdk_bdev_get_coalesce(bdev, &max_ios, &max_delay_us);
+	CU_ASSERT(max_ios == 4);
+	CU_ASSERT(max_delay_us == 100);
+
+	/* With nothing outstanding, I/O goes straight to the module */
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[0], 0, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+
+	/* Contiguous writes are held back and merged once max_ios is reached */
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 1, 4, 4);
+	for (i = 0; i < 4; i++) {
+		ut_expected_io_set_iov(expected_io, i, buf[i + 1], 512);
+	}
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+	for (i = 0; i < 3; i++) {
+		rc = spdk_bdev_write_blocks(desc, io_ch, buf[i + 1], i + 1, 1, coalesce_io_done, &num_done);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[4], 4, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_ut_channel->expected_io));
+	CU_ASSERT(bdev_ch->stat->num_coalesced_ops == 4);
+	CU_ASSERT(bdev_ch->stat->num_coalesce_merges == 1);
+
+	/* The merged completion completes each original I/O */
+	stub_complete_io(2);
+	CU_ASSERT(num_done == 5);
+	CU_ASSERT(bdev_ch->stat->num_write_ops == 5);
+	CU_ASSERT(bdev_ch->stat->bytes_written == 5 * 512);
+
+	/* A non-contiguous I/O flushes the held group; an I/O held alone is submitted as is */
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[0], 0, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[1], 10, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[2], 11, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	rc = spdk_bdev_read_blocks(desc, io_ch, buf[3], 20, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	CU_ASSERT(bdev_ch->stat->num_coalesce_merges == 2);
+
+	/* The held read is submitted once the latency cap is reached */
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	spdk_delay_us(50);
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 3);
+	CU_ASSERT(bdev_ch->stat->num_coalesced_ops == 6);
+	CU_ASSERT(bdev_ch->stat->max_coalesce_latency_ticks >= 50 * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC);
+	stub_complete_io(3);
+	CU_ASSERT(num_done == 9);
+
+	/* Disabling coalescing submits I/O right away */
+	g_status = -1;
+	spdk_bdev_set_coalesce(bdev, 0, 0, coalesce_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev_ch->coalesce == NULL);
+	for (i = 0; i < 2; i++) {
+		rc = spdk_bdev_write_blocks(desc, io_ch, buf[i], i, 1, coalesce_io_done, &num_done);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	CU_ASSERT(num_done == 11);
+
+	/* I/O still held when the channel goes away is aborted rather than submitted */
+	g_status = -1;
+	spdk_bdev_set_coalesce(bdev, 4, 100, coalesce_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[0], 0, 1, coalesce_io_done, &num_done);
+	CU_ASSERT(rc == 0);
+	g_io_done = false;
+	g_io_status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	rc = spdk_bdev_write_blocks(desc, io_ch, buf[1], 1, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	stub_complete_io(1);
+	CU_ASSERT(num_done == 12);
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_ABORTED);
+	CU_ASSERT(bdev->internal.stat->num_coalesce_merges == 2);
+	CU_ASSERT(bdev->internal.stat->num_write_ops == 11);
+
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
+static void
+bdev_io_cache_batch_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_mgmt_channel *mgmt_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	size_t pool_count;
+	int i, rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 64;
+	bdev_opts.bdev_io_cache_size = 8;
+	ut_init_bdev(&bdev_opts);
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	mgmt_ch = __io_ch_to_bdev_ch(io_ch)->shared_resource->mgmt_ch;
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 8);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_batch_size == 4);
+	pool_count = spdk_mempool_count(g_bdev_mgr.bdev_io_pool);
+
+	/* Drain the cache, then take a batch from the pool for the next I/O */
+	for (i = 0; i < 9; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.hits == 8);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.misses == 1);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.refills == 1);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 3);
+	CU_ASSERT(spdk_mempool_count(g_bdev_mgr.bdev_io_pool) == pool_count - 4);
+
+	/* The next two allocations are served from the refilled cache */
+	for (i = 0; i < 2; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.hits == 10);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 1);
+
+	/* Completing I/O refills the cache and returns a batch once it's full */
+	stub_complete_io(7);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 8);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.returns == 0);
+	stub_complete_io(1);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 5);
+	CU_ASSERT(mgmt_ch->bdev_io_cache_stat.returns == 1);
+	CU_ASSERT(spdk_mempool_count(g_bdev_mgr.bdev_io_pool) == pool_count);
+	stub_complete_io(3);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 8);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 bdev_io_spans_split_test(void)
 {
@@ -5630,6 +5934,143 @@ bdev_io_abort(void)
 	ut_fini_bdev();
 }
 
+static void
+fair_share_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	int *num_done = cb_arg;
+
+	(*num_done)++;
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+bdev_desc_fair_share_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc1 = NULL, *desc2 = NULL;
+	struct spdk_io_channel *io_ch1, *io_ch2;
+	struct spdk_bdev_desc_qos_opts opts = {}, get_opts = {};
+	struct spdk_bdev_opts bdev_opts = {};
+	int i, rc, num_done1 = 0, num_done2 = 0, num_aborted = 0;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 64;
+	bdev_opts.bdev_io_cache_size = 8;
+	ut_init_bdev(&bdev_opts);
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc1);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc2);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc1 != NULL && desc2 != NULL);
+	io_ch1 = spdk_bdev_get_io_channel(desc1);
+	io_ch2 = spdk_bdev_get_io_channel(desc2);
+	SPDK_CU_ASSERT_FATAL(io_ch1 != NULL && io_ch2 != NULL);
+
+	/* Limits must be multiples of 1000 and the minimum must not exceed the maximum */
+	opts.size = sizeof(opts);
+	opts.weight = 1;
+	opts.min_ios_per_sec = 1500;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc1, &opts) == -EINVAL);
+	opts.min_ios_per_sec = 2000;
+	opts.max_ios_per_sec = 1000;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc1, &opts) == -EINVAL);
+	CU_ASSERT(spdk_bdev_set_fair_share_ios_per_sec(bdev, 1500) == -EINVAL);
+
+	/* 8 I/Os per timeslice are split 3:1 between the descriptors */
+	CU_ASSERT(spdk_bdev_set_fair_share_ios_per_sec(bdev, 8000) == 0);
+	CU_ASSERT(spdk_bdev_get_fair_share_ios_per_sec(bdev) == 8000);
+	opts.weight = 3;
+	opts.min_ios_per_sec = 0;
+	opts.max_ios_per_sec = 0;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc1, &opts) == 0);
+	opts.weight = 1;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc2, &opts) == 0);
+	get_opts.size = sizeof(get_opts);
+	spdk_bdev_desc_get_qos(desc1, &get_opts);
+	CU_ASSERT(get_opts.weight == 3);
+	CU_ASSERT(get_opts.size == sizeof(get_opts));
+
+	for (i = 0; i < 10; i++) {
+		rc = spdk_bdev_read_blocks(desc1, io_ch1, NULL, i, 1, fair_share_io_done, &num_done1);
+		CU_ASSERT(rc == 0);
+	}
+	for (i = 0; i < 4; i++) {
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, i, 1, fair_share_io_done, &num_done2);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 8);
+	stub_complete_io(8);
+	CU_ASSERT(num_done1 == 6);
+	CU_ASSERT(num_done2 == 2);
+
+	/* Queued I/O is submitted once the tokens are refilled */
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	spdk_delay_us(1000);
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 6);
+	stub_complete_io(6);
+	CU_ASSERT(num_done1 == 10);
+	CU_ASSERT(num_done2 == 4);
+
+	/* An idle descriptor does not hold back capacity from the active one */
+	spdk_delay_us(1000);
+	for (i = 0; i < 8; i++) {
+		rc = spdk_bdev_read_blocks(desc1, io_ch1, NULL, i, 1, fair_share_io_done, &num_done1);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 6);
+	spdk_delay_us(1000);
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 8);
+	stub_complete_io(8);
+	CU_ASSERT(num_done1 == 18);
+
+	/* Without a capacity, only the maximum is enforced */
+	CU_ASSERT(spdk_bdev_set_fair_share_ios_per_sec(bdev, 0) == 0);
+	opts.max_ios_per_sec = 1000;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc2, &opts) == 0);
+	for (i = 0; i < 3; i++) {
+		rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, i, 1, fair_share_io_done, &num_done2);
+		CU_ASSERT(rc == 0);
+	}
+	rc = spdk_bdev_read_blocks(desc2, io_ch2, NULL, 3, 1, fair_share_io_done, &num_aborted);
+	CU_ASSERT(rc == 0);
+	for (i = 0; i < 16; i++) {
+		rc = spdk_bdev_read_blocks(desc1, io_ch1, NULL, i, 1, fair_share_io_done, &num_done1);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 17);
+
+	/* I/O queued for lack of tokens can be aborted */
+	g_abort_done = false;
+	rc = spdk_bdev_abort(desc2, io_ch2, &num_aborted, abort_done, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_abort_done == true);
+	CU_ASSERT(g_abort_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(num_aborted == 1);
+
+	/* Disabling fair-share QoS releases the queued I/O */
+	opts.weight = 0;
+	CU_ASSERT(spdk_bdev_desc_set_qos(desc2, &opts) == 0);
+	spdk_delay_us(1000);
+	poll_threads();
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 19);
+	stub_complete_io(19);
+	CU_ASSERT(num_done1 == 34);
+	CU_ASSERT(num_done2 == 7);
+
+	spdk_put_io_channel(io_ch1);
+	spdk_put_io_channel(io_ch2);
+	spdk_bdev_close(desc1);
+	spdk_bdev_close(desc2);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 bdev_unmap(void)
 {
@@ -7775,6 +8216,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, get_device_stat_test);
 	CU_ADD_TEST(suite, bdev_io_types_test);
 	CU_ADD_TEST(suite, bdev_io_wait_test);
+	CU_ADD_TEST(suite, bdev_io_cache_batch_test);
+	CU_ADD_TEST(suite, bdev_channel_plug_test);
+	CU_ADD_TEST(suite, bdev_io_coalesce_test);
 	CU_ADD_TEST(suite, bdev_io_spans_split_test);
 	CU_ADD_TEST(suite, bdev_io_boundary_split_test);
 	CU_ADD_TEST(suite, bdev_io_max_size_and_segment_split_test);
@@ -7802,6 +8246,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, lock_lba_range_overlapped);
 	CU_ADD_TEST(suite, bdev_quiesce);
 	CU_ADD_TEST(suite, bdev_io_abort);
+	CU_ADD_TEST(suite, bdev_desc_fair_share_test);
 	CU_ADD_TEST(suite, bdev_unmap);
 	CU_ADD_TEST(suite, bdev_write_zeroes_split_test);
 	CU_ADD_TEST(suite, bdev_set_options_test);
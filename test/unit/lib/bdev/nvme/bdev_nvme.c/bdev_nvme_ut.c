@@ -6744,6 +6744,257 @@ test_set_multipath_policy(void)
 	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
 }
 
+static void
+test_hedged_reads(void)
+{
+	struct nvme_path_id path1 = {}, path2 = {};
+	struct spdk_bdev_nvme_ctrlr_opts opts = {};
+	struct spdk_nvme_ctrlr *ctrlr1, *ctrlr2;
+	struct spdk_nvme_ctrlr_opts dopts = {.hostnqn = UT_HOSTNQN};
+	struct nvme_bdev_ctrlr *nbdev_ctrlr;
+	struct nvme_ctrlr *nvme_ctrlr1, *nvme_ctrlr2;
+	const int STRING_SIZE = 32;
+	const char *attached_names[STRING_SIZE];
+	struct nvme_bdev *bdev;
+	struct spdk_bdev_io *bdev_io;
+	struct nvme_bdev_io *bio;
+	struct spdk_io_channel *ch;
+	struct nvme_bdev_channel *nbdev_ch;
+	struct nvme_io_path *io_path1, *io_path2;
+	struct spdk_nvme_qpair *qpair1, *qpair2;
+	struct spdk_uuid uuid1 = { .u.raw = { 0x1 } };
+	uint8_t buf[512];
+	uint64_t i;
+	int done;
+	int rc;
+
+	memset(attached_names, 0, sizeof(char *) * STRING_SIZE);
+	ut_init_trid(&path1.trid);
+	ut_init_trid2(&path2.trid);
+	g_ut_attach_ctrlr_status = 0;
+	g_ut_attach_bdev_count = 1;
+
+	opts.multipath = true;
+
+	set_thread(0);
+
+	ctrlr1 = ut_attach_ctrlr(&path1.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr1 != NULL);
+
+	ctrlr1->ns[0].uuid = &uuid1;
+
+	rc = spdk_bdev_nvme_create(&path1.trid, "nvme0", attached_names, STRING_SIZE,
+				   attach_ctrlr_done, NULL, &dopts, &opts);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	ctrlr2 = ut_attach_ctrlr(&path2.trid, 1, true, true);
+	SPDK_CU_ASSERT_FATAL(ctrlr2 != NULL);
+
+	ctrlr2->ns[0].uuid = &uuid1;
+
+	rc = spdk_bdev_nvme_create(&path2.trid, "nvme0", attached_names, STRING_SIZE,
+				   attach_ctrlr_done, NULL, &dopts, &opts);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(1000);
+	poll_threads();
+	spdk_delay_us(g_opts.nvme_adminq_poll_period_us);
+	poll_threads();
+
+	nbdev_ctrlr = nvme_bdev_ctrlr_get_by_name("nvme0");
+	SPDK_CU_ASSERT_FATAL(nbdev_ctrlr != NULL);
+
+	nvme_ctrlr1 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path1.trid, dopts.hostnqn);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr1 != NULL);
+
+	nvme_ctrlr2 = nvme_bdev_ctrlr_get_ctrlr(nbdev_ctrlr, &path2.trid, dopts.hostnqn);
+	SPDK_CU_ASSERT_FATAL(nvme_ctrlr2 != NULL);
+
+	bdev = nvme_bdev_ctrlr_get_bdev(nbdev_ctrlr, 1);
+	SPDK_CU_ASSERT_FATAL(bdev != NULL);
+
+	/* Percentile must be less than 100. */
+	done = -1;
+	bdev_nvme_set_hedged_reads(bdev->disk.name, 100, 10, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == -EINVAL);
+	CU_ASSERT(bdev->hedge_percentile == 0);
+
+	ch = spdk_get_io_channel(bdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	nbdev_ch = spdk_io_channel_get_ctx(ch);
+
+	CU_ASSERT(nbdev_ch->hedge_percentile == 0);
+	CU_ASSERT(nbdev_ch->hedge_poller == NULL);
+
+	/* The update should be applied to the active I/O channel. */
+	done = -1;
+	bdev_nvme_set_hedged_reads(bdev->disk.name, 90, 10, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == 0);
+
+	CU_ASSERT(bdev->hedge_percentile == 90);
+	CU_ASSERT(bdev->hedge_min_delay_us == 10);
+	CU_ASSERT(nbdev_ch->hedge_percentile == 90);
+	CU_ASSERT(nbdev_ch->hedge_poller != NULL);
+	CU_ASSERT(nbdev_ch->hedge_threshold_ticks == UINT64_MAX);
+
+	/* The threshold is the percentile of the sampled read latencies, but not less than
+	 * the minimum delay.
+	 */
+	for (i = 1; i <= BDEV_NVME_HEDGE_NUM_SAMPLES; i++) {
+		bdev_nvme_hedge_add_sample(nbdev_ch, i);
+	}
+	CU_ASSERT(nbdev_ch->hedge_threshold_ticks >= BDEV_NVME_HEDGE_NUM_SAMPLES * 90 / 100);
+	CU_ASSERT(nbdev_ch->hedge_threshold_ticks <= BDEV_NVME_HEDGE_NUM_SAMPLES);
+	CU_ASSERT(nbdev_ch->hedge_num_samples == 0);
+
+	for (i = 1; i <= BDEV_NVME_HEDGE_NUM_SAMPLES; i++) {
+		bdev_nvme_hedge_add_sample(nbdev_ch, 1);
+	}
+	CU_ASSERT(nbdev_ch->hedge_threshold_ticks == nbdev_ch->hedge_min_delay_ticks);
+
+	io_path1 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr1);
+	SPDK_CU_ASSERT_FATAL(io_path1 != NULL);
+	qpair1 = io_path1->qpair->qpair;
+	SPDK_CU_ASSERT_FATAL(qpair1 != NULL);
+
+	io_path2 = ut_get_io_path_by_ctrlr(nbdev_ch, nvme_ctrlr2);
+	SPDK_CU_ASSERT_FATAL(io_path2 != NULL);
+	qpair2 = io_path2->qpair->qpair;
+	SPDK_CU_ASSERT_FATAL(qpair2 != NULL);
+
+	bdev_io = ut_alloc_bdev_io(SPDK_BDEV_IO_TYPE_READ, bdev, ch);
+	bdev_io->u.bdev.iovs = &bdev_io->iov;
+	bdev_io->u.bdev.iovcnt = 1;
+	bdev_io->u.bdev.num_blocks = 1;
+	bdev_io->iov.iov_base = buf;
+	bdev_io->iov.iov_len = sizeof(buf);
+	bdev->disk.blocklen = sizeof(buf);
+	bio = (struct nvme_bdev_io *)bdev_io->driver_ctx;
+
+	/* A read which completes in time is not hedged. */
+	bdev_io->internal.f.in_submit_request = true;
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_nvme_submit_request(ch, bdev_io);
+
+	CU_ASSERT(qpair1->num_outstanding_reqs == 1);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_TRACKED);
+	CU_ASSERT(bdev_nvme_hedge_poll(nbdev_ch) == SPDK_POLLER_IDLE);
+
+	spdk_nvme_qpair_process_completions(qpair1, 0);
+
+	CU_ASSERT(bdev_io->internal.f.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_NONE);
+	CU_ASSERT(TAILQ_EMPTY(&nbdev_ch->hedge_io_list));
+	CU_ASSERT(io_path1->hedge_triggered == 0);
+
+	/* A slow read is duplicated on the other path. The duplicate completes first, so its
+	 * data is copied and the original read is aborted. The read completes successfully
+	 * only after the aborted original completes.
+	 */
+	memset(buf, 0xFF, sizeof(buf));
+	bdev_io->internal.f.in_submit_request = true;
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_nvme_submit_request(ch, bdev_io);
+
+	spdk_delay_us(10);
+	CU_ASSERT(bdev_nvme_hedge_poll(nbdev_ch) == SPDK_POLLER_BUSY);
+
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_ISSUED);
+	CU_ASSERT(qpair1->num_outstanding_reqs == 1);
+	CU_ASSERT(qpair2->num_outstanding_reqs == 1);
+	CU_ASSERT(io_path1->hedge_triggered == 1);
+	CU_ASSERT(io_path2->hedge_issued == 1);
+
+	/* A read is hedged only once. */
+	spdk_delay_us(10);
+	CU_ASSERT(bdev_nvme_hedge_poll(nbdev_ch) == SPDK_POLLER_IDLE);
+	CU_ASSERT(qpair2->num_outstanding_reqs == 1);
+
+	spdk_nvme_qpair_process_completions(qpair2, 0);
+
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_WON);
+	CU_ASSERT(io_path2->hedge_won == 1);
+	CU_ASSERT(buf[0] == 0 && buf[sizeof(buf) - 1] == 0);
+	CU_ASSERT(bdev_io->internal.f.in_submit_request == true);
+	CU_ASSERT(ut_get_outstanding_nvme_request(qpair1, bio)->cpl.status.sc ==
+		  SPDK_NVME_SC_ABORTED_BY_REQUEST);
+
+	spdk_nvme_ctrlr_process_admin_completions(ctrlr1);
+	spdk_nvme_qpair_process_completions(qpair1, 0);
+
+	CU_ASSERT(bdev_io->internal.f.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_NONE);
+
+	/* The original read completes first, so the duplicate is aborted and its
+	 * completion does not touch the read anymore.
+	 */
+	bdev_io->internal.f.in_submit_request = true;
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_nvme_submit_request(ch, bdev_io);
+
+	spdk_delay_us(10);
+	CU_ASSERT(bdev_nvme_hedge_poll(nbdev_ch) == SPDK_POLLER_BUSY);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_ISSUED);
+
+	spdk_nvme_qpair_process_completions(qpair1, 0);
+
+	CU_ASSERT(bdev_io->internal.f.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_NONE);
+	CU_ASSERT(bio->hedge == NULL);
+	CU_ASSERT(qpair2->num_outstanding_reqs == 1);
+
+	spdk_nvme_ctrlr_process_admin_completions(ctrlr2);
+	spdk_nvme_qpair_process_completions(qpair2, 0);
+
+	CU_ASSERT(qpair2->num_outstanding_reqs == 0);
+	CU_ASSERT(io_path1->hedge_triggered == 2);
+	CU_ASSERT(io_path2->hedge_issued == 2);
+	CU_ASSERT(io_path2->hedge_won == 1);
+
+	/* Disabling hedged reads stops tracking reads. */
+	done = -1;
+	bdev_nvme_set_hedged_reads(bdev->disk.name, 0, 0, ut_set_multipath_policy_done, &done);
+	poll_threads();
+	CU_ASSERT(done == 0);
+	CU_ASSERT(nbdev_ch->hedge_percentile == 0);
+	CU_ASSERT(nbdev_ch->hedge_poller == NULL);
+
+	bdev_io->internal.f.in_submit_request = true;
+	MOCK_SET(spdk_bdev_io_get_submit_tsc, spdk_get_ticks());
+	bdev_nvme_submit_request(ch, bdev_io);
+	CU_ASSERT(bio->hedge_state == NVME_BDEV_HEDGE_NONE);
+
+	poll_threads();
+	CU_ASSERT(bdev_io->internal.f.in_submit_request == false);
+	CU_ASSERT(bdev_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	free(bdev_io);
+	MOCK_CLEAR(spdk_bdev_io_get_submit_tsc);
+
+	spdk_put_io_channel(ch);
+
+	poll_threads();
+
+	rc = bdev_nvme_delete("nvme0", &g_any_path, NULL, NULL);
+	CU_ASSERT(rc == 0);
+
+	poll_threads();
+	spdk_delay_us(1000);
+	poll_threads();
+
+	CU_ASSERT(nvme_ctrlr_get_by_name("nvme0") == NULL);
+}
+
 static void
 test_uuid_generation(void)
 {
@@ -8207,6 +8458,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_find_io_path_min_qd);
 	CU_ADD_TEST(suite, test_disable_auto_failback);
 	CU_ADD_TEST(suite, test_set_multipath_policy);
+	CU_ADD_TEST(suite, test_hedged_reads);
 	CU_ADD_TEST(suite, test_uuid_generation);
 	CU_ADD_TEST(suite, test_retry_io_to_same_path);
 	CU_ADD_TEST(suite, test_race_between_reset_and_disconnected);
@@ -187,6 +187,10 @@ DEFINE_STUB(spdk_json_write_named_uuid, int, (struct spdk_json_write_ctx *w, con
 DEFINE_STUB_V(raid_bdev_init_superblock, (struct raid_bdev *raid_bdev));
 DEFINE_STUB(raid_bdev_alloc_superblock, int, (struct raid_bdev *raid_bdev, uint32_t block_size), 0);
 DEFINE_STUB_V(raid_bdev_free_superblock, (struct raid_bdev *raid_bdev));
+DEFINE_STUB(raid_bdev_alloc_bitmap, int, (struct raid_bdev *raid_bdev), -ENOTSUP);
+DEFINE_STUB_V(raid_bdev_free_bitmap, (struct raid_bdev *raid_bdev));
+DEFINE_STUB_V(raid_bdev_load_bitmap, (struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb,
+				      void *cb_ctx));
 DEFINE_STUB(spdk_bdev_readv_blocks_ext, int, (struct spdk_bdev_desc *desc,
 		struct spdk_io_channel *ch, struct iovec *iov, int iovcnt, uint64_t offset_blocks,
 		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
@@ -217,6 +221,27 @@ raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	cb(0, raid_bdev, cb_ctx);
 }
 
+raid_bdev_bitmap_cb g_bitmap_write_cb;
+
+void
+raid_bdev_write_bitmap(struct raid_bdev *raid_bdev, raid_bdev_bitmap_cb cb, void *cb_ctx)
+{
+	CU_ASSERT(g_bitmap_write_cb == NULL);
+	raid_bdev->bitmap->dirty_start = raid_bdev->bitmap->num_blocks;
+	raid_bdev->bitmap->dirty_end = 0;
+	g_bitmap_write_cb = cb;
+}
+
+static void
+complete_bitmap_write(struct raid_bdev *raid_bdev, int status)
+{
+	raid_bdev_bitmap_cb cb = g_bitmap_write_cb;
+
+	SPDK_CU_ASSERT_FATAL(cb != NULL);
+	g_bitmap_write_cb = NULL;
+	cb(status, raid_bdev, NULL);
+}
+
 const struct spdk_uuid *
 spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
 {
@@ -371,8 +396,9 @@ void
 spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
 {
 	CU_ASSERT(bdeverrno == 0);
-	SPDK_CU_ASSERT_FATAL(bdev->internal.unregister_cb != NULL);
-	bdev->internal.unregister_cb(bdev->internal.unregister_ctx, bdeverrno);
+	if (bdev->internal.unregister_cb != NULL) {
+		bdev->internal.unregister_cb(bdev->internal.unregister_ctx, bdeverrno);
+	}
 }
 
 int
@@ -1355,6 +1381,109 @@ test_create_raid_superblock(void)
 	reset_globals();
 }
 
+static void
+ut_set_read_policy_cb(void *ctx, int status)
+{
+	*(int *)ctx = status;
+}
+
+static void
+test_raid_read_policy(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete delete_req;
+	struct raid_bdev *raid_bdev;
+	char *write_mostly[2];
+	char bad_name[] = "Nvme_none";
+	struct raid_bdev_superblock *sb;
+	int status;
+	uint8_t i;
+
+	CU_ASSERT(raid_bdev_str_to_read_policy("latency") == RAID_READ_POLICY_LATENCY);
+	CU_ASSERT(raid_bdev_str_to_read_policy("LEAST_OUTSTANDING") ==
+		  RAID_READ_POLICY_LEAST_OUTSTANDING);
+	CU_ASSERT(raid_bdev_str_to_read_policy("abcd123") == RAID_READ_POLICY_MAX);
+	CU_ASSERT(strcmp(raid_bdev_read_policy_to_str(RAID_READ_POLICY_LATENCY), "latency") == 0);
+	CU_ASSERT(strlen(raid_bdev_read_policy_to_str(RAID_READ_POLICY_MAX)) == 0);
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	raid_bdev = raid_bdev_find_by_name("raid1");
+	SPDK_CU_ASSERT_FATAL(raid_bdev != NULL);
+	CU_ASSERT(raid_bdev->read_policy == RAID_READ_POLICY_LEAST_OUTSTANDING);
+
+	/* not supported by the module */
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_LATENCY, NULL, 0,
+					    NULL, NULL) == -ENOTSUP);
+	CU_ASSERT(raid_bdev->read_policy == RAID_READ_POLICY_LEAST_OUTSTANDING);
+
+	g_ut_raid_module.read_policy_supported = true;
+
+	write_mostly[0] = req.base_bdevs.base_bdevs[1];
+	write_mostly[1] = req.base_bdevs.base_bdevs[2];
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_LATENCY, write_mostly, 2,
+					    NULL, NULL) == 0);
+	CU_ASSERT(raid_bdev->read_policy == RAID_READ_POLICY_LATENCY);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid_bdev->base_bdev_info[i].write_mostly == (i == 1 || i == 2));
+	}
+
+	/* an unknown base bdev leaves the settings unchanged */
+	write_mostly[1] = bad_name;
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_LEAST_OUTSTANDING,
+					    write_mostly, 2, NULL, NULL) == -ENODEV);
+	CU_ASSERT(raid_bdev->read_policy == RAID_READ_POLICY_LATENCY);
+	CU_ASSERT(raid_bdev->base_bdev_info[2].write_mostly == true);
+
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_MAX, NULL, 0,
+					    NULL, NULL) == -EINVAL);
+
+	/* base bdevs not listed are no longer write-mostly */
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_LEAST_OUTSTANDING,
+					    write_mostly, 1, NULL, NULL) == 0);
+	CU_ASSERT(raid_bdev->read_policy == RAID_READ_POLICY_LEAST_OUTSTANDING);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid_bdev->base_bdev_info[i].write_mostly == (i == 1));
+	}
+
+	/* the settings are stored in the superblock */
+	sb = calloc(1, RAID_BDEV_SB_MAX_LENGTH);
+	SPDK_CU_ASSERT_FATAL(sb != NULL);
+	sb->base_bdevs_size = raid_bdev->num_base_bdevs;
+	for (i = 0; i < sb->base_bdevs_size; i++) {
+		sb->base_bdevs[i].slot = sb->base_bdevs_size - i - 1;
+	}
+	raid_bdev->sb = sb;
+
+	write_mostly[0] = req.base_bdevs.base_bdevs[0];
+	status = 1;
+	CU_ASSERT(raid_bdev_set_read_policy(raid_bdev, RAID_READ_POLICY_LATENCY, write_mostly, 1,
+					    ut_set_read_policy_cb, &status) == 0);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(sb->read_policy == RAID_READ_POLICY_LATENCY);
+	for (i = 0; i < sb->base_bdevs_size; i++) {
+		CU_ASSERT(!!(sb->base_bdevs[i].flags & RAID_BDEV_SB_BASE_BDEV_FLAG_WRITE_MOSTLY) ==
+			  (sb->base_bdevs[i].slot == 0));
+	}
+
+	raid_bdev->sb = NULL;
+	free(sb);
+
+	g_ut_raid_module.read_policy_supported = false;
+	free_test_req(&req);
+
+	create_raid_bdev_delete_req(&delete_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
 static void
 test_raid_process(void)
 {
@@ -1416,6 +1545,466 @@ test_raid_process(void)
 	reset_globals();
 }
 
+static void
+test_raid_bitmap_write(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete destroy_req;
+	struct raid_bdev *pbdev;
+	struct spdk_io_channel *ch;
+	struct spdk_bdev_io *bdev_io[3];
+	struct spdk_bdev_io *child_io;
+	struct raid_bdev_bitmap bitmap = {};
+	uint8_t bits[1] = {}, persisted_bits[1] = {};
+	uint32_t writes[8] = {};
+	int num_deferred, i;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	verify_raid_bdev_present("raid1", false);
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+	TAILQ_FOREACH(pbdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(pbdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	CU_ASSERT(pbdev != NULL);
+
+	/* 8 regions of 16 blocks */
+	bitmap.region_size = 16;
+	bitmap.region_shift = 4;
+	bitmap.num_regions = 8;
+	bitmap.num_blocks = 1;
+	bitmap.block_size = 1;
+	bitmap.bits = bits;
+	bitmap.persisted_bits = persisted_bits;
+	bitmap.writes = writes;
+	bitmap.dirty_start = bitmap.num_blocks;
+	TAILQ_INIT(&bitmap.writing_ios);
+	TAILQ_INIT(&bitmap.waiting_ios);
+	pbdev->bitmap = &bitmap;
+
+	ch = spdk_get_io_channel(pbdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	g_bdev_io_defer_completion = true;
+
+	for (i = 0; i < 3; i++) {
+		bdev_io[i] = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+		SPDK_CU_ASSERT_FATAL(bdev_io[i] != NULL);
+	}
+
+	/* The first write to a region waits for the bitmap to be written */
+	bdev_io_initialize(bdev_io[0], ch, &pbdev->bdev, 0, 20, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io[0]);
+	CU_ASSERT(writes[0] == 1);
+	CU_ASSERT(writes[1] == 1);
+	poll_app_thread();
+	CU_ASSERT(bits[0] == 0x3);
+	CU_ASSERT(persisted_bits[0] == 0);
+	CU_ASSERT(g_bitmap_write_cb != NULL);
+	CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+
+	/* So does a write to a region which is set but not written yet */
+	bdev_io_initialize(bdev_io[1], ch, &pbdev->bdev, 16, 4, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io[1]);
+	poll_app_thread();
+	CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+
+	complete_bitmap_write(pbdev, 0);
+	poll_app_thread();
+	CU_ASSERT(persisted_bits[0] == 0x3);
+	CU_ASSERT(g_bitmap_write_cb == NULL);
+	num_deferred = 0;
+	TAILQ_FOREACH(child_io, &g_deferred_ios, internal.link) {
+		num_deferred++;
+	}
+	CU_ASSERT(num_deferred == 2);
+
+	/* A write to a persisted region is submitted right away */
+	bdev_io_initialize(bdev_io[2], ch, &pbdev->bdev, 0, 1, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io[2]);
+	num_deferred = 0;
+	TAILQ_FOREACH(child_io, &g_deferred_ios, internal.link) {
+		num_deferred++;
+	}
+	CU_ASSERT(num_deferred == 3);
+	CU_ASSERT(writes[0] == 2);
+	CU_ASSERT(writes[1] == 2);
+
+	/* Regions with writes in flight are not cleared */
+	CU_ASSERT(raid_bdev_bitmap_clear_poll(pbdev) == SPDK_POLLER_IDLE);
+	CU_ASSERT(bits[0] == 0x3);
+
+	complete_deferred_ios();
+	CU_ASSERT(writes[0] == 0);
+	CU_ASSERT(writes[1] == 0);
+
+	/* Idle regions are cleared and the bitmap is written */
+	CU_ASSERT(raid_bdev_bitmap_clear_poll(pbdev) == SPDK_POLLER_BUSY);
+	CU_ASSERT(bits[0] == 0);
+	CU_ASSERT(persisted_bits[0] == 0);
+	complete_bitmap_write(pbdev, 0);
+
+	for (i = 0; i < 3; i++) {
+		bdev_io_cleanup(bdev_io[i]);
+	}
+
+	g_bdev_io_defer_completion = false;
+	pbdev->bitmap = NULL;
+
+	free_test_req(&req);
+	spdk_put_io_channel(ch);
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
+static void
+test_raid_bitmap_write_error(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete destroy_req;
+	struct raid_bdev *pbdev;
+	struct spdk_io_channel *ch;
+	struct spdk_bdev_io *bdev_io;
+	struct raid_base_bdev_info *base_info;
+	struct raid_bdev_bitmap bitmap = {};
+	uint8_t bits[1] = {}, persisted_bits[1] = {};
+	uint32_t writes[8] = {};
+	int i;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	verify_raid_bdev_present("raid1", false);
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+	TAILQ_FOREACH(pbdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(pbdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	CU_ASSERT(pbdev != NULL);
+
+	/* 8 regions of 16 blocks */
+	bitmap.region_size = 16;
+	bitmap.region_shift = 4;
+	bitmap.num_regions = 8;
+	bitmap.num_blocks = 1;
+	bitmap.block_size = 1;
+	bitmap.bits = bits;
+	bitmap.persisted_bits = persisted_bits;
+	bitmap.writes = writes;
+	bitmap.dirty_start = bitmap.num_blocks;
+	TAILQ_INIT(&bitmap.writing_ios);
+	TAILQ_INIT(&bitmap.waiting_ios);
+	pbdev->bitmap = &bitmap;
+
+	ch = spdk_get_io_channel(pbdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	g_bdev_io_defer_completion = true;
+
+	bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+
+	bdev_io_initialize(bdev_io, ch, &pbdev->bdev, 0, 20, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io);
+	poll_app_thread();
+	CU_ASSERT(bits[0] == 0x3);
+
+	/* A failed write not caused by a base bdev keeps the bits dirty and is retried later */
+	complete_bitmap_write(pbdev, -EIO);
+	poll_app_thread();
+	for (i = 0; i < RAID_BDEV_BITMAP_WRITE_RETRIES; i++) {
+		CU_ASSERT(g_bitmap_write_cb == NULL);
+		CU_ASSERT(persisted_bits[0] == 0);
+		CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+		CU_ASSERT(!TAILQ_EMPTY(&bitmap.writing_ios));
+
+		spdk_delay_us(RAID_BDEV_BITMAP_RETRY_DELAY_US << i);
+		poll_app_thread();
+		CU_ASSERT(g_bitmap_write_cb != NULL);
+		complete_bitmap_write(pbdev, -EIO);
+		poll_app_thread();
+	}
+
+	/* Once the retries are exhausted, the waiting write is failed but the array is not */
+	CU_ASSERT(g_bitmap_write_cb == NULL);
+	CU_ASSERT(bitmap.retry_poller == NULL);
+	CU_ASSERT(bitmap.failed == false);
+	CU_ASSERT(persisted_bits[0] == 0);
+	CU_ASSERT(TAILQ_EMPTY(&bitmap.writing_ios));
+	CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+	CU_ASSERT(g_io_comp_status == false);
+	CU_ASSERT(writes[0] == 0);
+	CU_ASSERT(writes[1] == 0);
+	CU_ASSERT(pbdev->state == RAID_BDEV_STATE_ONLINE);
+
+	/* A base bdev the bitmap can't be written to is failed, the others keep serving I/O */
+	pbdev->min_base_bdevs_operational = 1;
+	bdev_io_initialize(bdev_io, ch, &pbdev->bdev, 0, 20, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io);
+	poll_app_thread();
+	CU_ASSERT(g_bitmap_write_cb != NULL);
+
+	pbdev->base_bdev_info[0].bitmap_write_failed = true;
+	complete_bitmap_write(pbdev, -EIO);
+	poll_app_thread();
+	CU_ASSERT(pbdev->base_bdev_info[0].is_configured == false);
+	CU_ASSERT(pbdev->base_bdev_info[1].is_configured == true);
+	CU_ASSERT(pbdev->num_base_bdevs_operational == pbdev->num_base_bdevs - 1);
+	CU_ASSERT(pbdev->state == RAID_BDEV_STATE_ONLINE);
+	CU_ASSERT(bitmap.failed == false);
+	CU_ASSERT(persisted_bits[0] == 0x3);
+	CU_ASSERT(TAILQ_EMPTY(&bitmap.writing_ios));
+	CU_ASSERT(!TAILQ_EMPTY(&g_deferred_ios));
+
+	g_io_comp_status = false;
+	complete_deferred_ios();
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(writes[0] == 0);
+	CU_ASSERT(writes[1] == 0);
+
+	/* If no base bdev has the bits, the waiting write is failed and so is the array */
+	RAID_FOR_EACH_BASE_BDEV(pbdev, base_info) {
+		if (base_info->is_configured) {
+			base_info->bitmap_write_failed = true;
+		}
+	}
+	bdev_io_initialize(bdev_io, ch, &pbdev->bdev, 32, 4, SPDK_BDEV_IO_TYPE_WRITE);
+	raid_bdev_submit_request(ch, bdev_io);
+	poll_app_thread();
+	CU_ASSERT(bits[0] == 0x7);
+
+	g_io_comp_status = true;
+	complete_bitmap_write(pbdev, -EIO);
+	poll_app_thread();
+	CU_ASSERT(g_bitmap_write_cb == NULL);
+	CU_ASSERT(bitmap.failed == true);
+	CU_ASSERT(persisted_bits[0] == 0x3);
+	CU_ASSERT(TAILQ_EMPTY(&bitmap.writing_ios));
+	CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+	CU_ASSERT(g_io_comp_status == false);
+	CU_ASSERT(writes[2] == 0);
+	CU_ASSERT(pbdev->state == RAID_BDEV_STATE_OFFLINE);
+
+	bdev_io_cleanup(bdev_io);
+
+	g_bdev_io_defer_completion = false;
+	pbdev->bitmap = NULL;
+
+	free_test_req(&req);
+	spdk_put_io_channel(ch);
+	poll_app_thread();
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
+static void
+test_raid_process_bitmap_resync(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete destroy_req;
+	struct raid_bdev *pbdev;
+	struct spdk_bdev *base_bdev;
+	struct spdk_thread *process_thread;
+	struct raid_bdev_bitmap bitmap = {};
+	uint8_t bits[1] = {};
+	uint32_t writes[8] = {};
+	uint64_t num_blocks_processed = 0;
+	struct spdk_raid_bdev_opts opts = {
+		.process_window_size_kb = 1024,
+		.process_max_bandwidth_mb_sec = 0,
+	};
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	verify_raid_bdev_present("raid1", false);
+	TAILQ_FOREACH(base_bdev, &g_bdev_list, internal.link) {
+		base_bdev->blockcnt = 128;
+	}
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+	free_test_req(&req);
+
+	TAILQ_FOREACH(pbdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(pbdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	CU_ASSERT(pbdev != NULL);
+
+	pbdev->module_private = &num_blocks_processed;
+	pbdev->min_base_bdevs_operational = 0;
+
+	/* 8 regions of 16 blocks, regions 2 and 5 were written while the target was missing */
+	bitmap.region_size = 16;
+	bitmap.region_shift = 4;
+	bitmap.num_regions = pbdev->bdev.blockcnt / bitmap.region_size;
+	bitmap.bits = bits;
+	bitmap.writes = writes;
+	bits[0] = (1 << 2) | (1 << 5);
+	pbdev->bitmap = &bitmap;
+	pbdev->base_bdev_info[0].bitmap_resync = true;
+
+	CU_ASSERT(raid_bdev_start_rebuild(&pbdev->base_bdev_info[0]) == 0);
+	CU_ASSERT(pbdev->base_bdev_info[0].bitmap_resync == false);
+	poll_app_thread();
+
+	SPDK_CU_ASSERT_FATAL(pbdev->process != NULL);
+	CU_ASSERT(pbdev->process->bitmap_resync == true);
+
+	process_thread = g_latest_thread;
+	while (spdk_thread_poll(process_thread, 0, 0) > 0) {
+		poll_app_thread();
+	}
+
+	CU_ASSERT(pbdev->process == NULL);
+	CU_ASSERT(num_blocks_processed == 2 * bitmap.region_size);
+
+	poll_app_thread();
+
+	pbdev->bitmap = NULL;
+
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
+static void
+test_raid_bitmap_resync_unclean(void)
+{
+	struct rpc_bdev_raid_create req;
+	struct rpc_bdev_raid_delete destroy_req;
+	struct raid_bdev *pbdev;
+	struct spdk_bdev *base_bdev;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_thread *process_thread;
+	struct raid_bdev_bitmap bitmap = {};
+	uint8_t bits[1] = {};
+	uint32_t writes[8] = {};
+	uint64_t num_blocks_processed = 0;
+	struct spdk_raid_bdev_opts opts = {
+		.process_window_size_kb = 1024,
+		.process_max_bandwidth_mb_sec = 0,
+	};
+	uint8_t i;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, false);
+	verify_raid_bdev_present("raid1", false);
+	TAILQ_FOREACH(base_bdev, &g_bdev_list, internal.link) {
+		base_bdev->blockcnt = 128;
+	}
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev(&req, true, RAID_BDEV_STATE_ONLINE);
+	free_test_req(&req);
+
+	TAILQ_FOREACH(pbdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(pbdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(pbdev != NULL);
+	SPDK_CU_ASSERT_FATAL(pbdev->num_base_bdevs > 1);
+
+	pbdev->module_private = &num_blocks_processed;
+	pbdev->min_base_bdevs_operational = 0;
+
+	/* 8 regions of 16 blocks */
+	bitmap.region_size = 16;
+	bitmap.region_shift = 4;
+	bitmap.num_regions = pbdev->bdev.blockcnt / bitmap.region_size;
+	bitmap.bits = bits;
+	bitmap.writes = writes;
+	pbdev->bitmap = &bitmap;
+
+	/* A clean bitmap doesn't need any resync */
+	raid_bdev_bitmap_resync_prepare(pbdev);
+	RAID_FOR_EACH_BASE_BDEV(pbdev, base_info) {
+		CU_ASSERT(base_info->bitmap_resync == false);
+		CU_ASSERT(base_info->is_process_target == false);
+	}
+
+	/* Regions 1 and 6 were being written when the array was stopped */
+	bits[0] = (1 << 1) | (1 << 6);
+	raid_bdev_bitmap_resync_prepare(pbdev);
+	CU_ASSERT(pbdev->base_bdev_info[0].bitmap_resync == false);
+	CU_ASSERT(pbdev->base_bdev_info[0].is_process_target == false);
+	for (i = 1; i < pbdev->num_base_bdevs; i++) {
+		CU_ASSERT(pbdev->base_bdev_info[i].bitmap_resync == true);
+		CU_ASSERT(pbdev->base_bdev_info[i].is_process_target == true);
+	}
+
+	/* The bits are kept until all members are resynced */
+	CU_ASSERT(raid_bdev_bitmap_clear_poll(pbdev) == SPDK_POLLER_IDLE);
+
+	/* The members are resynced one by one, only in the marked regions */
+	raid_bdev_bitmap_resync_next(pbdev);
+	for (i = 1; i < pbdev->num_base_bdevs; i++) {
+		poll_app_thread();
+		SPDK_CU_ASSERT_FATAL(pbdev->process != NULL);
+		CU_ASSERT(pbdev->process->target == &pbdev->base_bdev_info[i]);
+		CU_ASSERT(pbdev->process->bitmap_resync == true);
+
+		process_thread = g_latest_thread;
+		while (spdk_thread_poll(process_thread, 0, 0) > 0) {
+			poll_app_thread();
+		}
+		CU_ASSERT(num_blocks_processed == i * 2 * bitmap.region_size);
+	}
+
+	poll_app_thread();
+	CU_ASSERT(pbdev->process == NULL);
+	RAID_FOR_EACH_BASE_BDEV(pbdev, base_info) {
+		CU_ASSERT(base_info->bitmap_resync == false);
+		CU_ASSERT(base_info->is_process_target == false);
+	}
+
+	pbdev->bitmap = NULL;
+
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
 static void
 test_raid_process_with_qos(void)
 {
@@ -1793,9 +2382,14 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid_json_dump_info);
 	CU_ADD_TEST(suite, test_context_size);
 	CU_ADD_TEST(suite, test_raid_level_conversions);
+	CU_ADD_TEST(suite, test_raid_read_policy);
 	CU_ADD_TEST(suite, test_raid_io_split);
 	CU_ADD_TEST(suite, test_raid_process);
 	CU_ADD_TEST(suite, test_raid_process_with_qos);
+	CU_ADD_TEST(suite, test_raid_process_bitmap_resync);
+	CU_ADD_TEST(suite, test_raid_bitmap_resync_unclean);
+	CU_ADD_TEST(suite, test_raid_bitmap_write);
+	CU_ADD_TEST(suite, test_raid_bitmap_write_error);
 
 	spdk_thread_lib_init(test_new_thread_fn, 0);
 	g_app_thread = spdk_thread_create("app_thread", NULL);
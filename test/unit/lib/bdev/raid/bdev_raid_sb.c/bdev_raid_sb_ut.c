@@ -19,6 +19,7 @@ DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "t
 DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), TEST_BUF_ALIGN);
 
 void *g_buf;
+void *g_bitmap_buf;
 TAILQ_HEAD(, spdk_bdev_io) g_bdev_io_queue = TAILQ_HEAD_INITIALIZER(g_bdev_io_queue);
 int g_read_counter;
 int g_write_counter;
@@ -39,6 +40,12 @@ _test_setup(uint32_t blocklen, uint32_t md_len)
 		return -ENOMEM;
 	}
 
+	g_bitmap_buf = spdk_dma_zmalloc(RAID_BDEV_BITMAP_MAX_SIZE, TEST_BUF_ALIGN, NULL);
+	if (!g_bitmap_buf) {
+		spdk_dma_free(g_buf);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -64,6 +71,7 @@ static int
 test_cleanup(void)
 {
 	spdk_dma_free(g_buf);
+	spdk_dma_free(g_bitmap_buf);
 
 	return 0;
 }
@@ -159,6 +167,56 @@ spdk_bdev_write(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 	return 0;
 }
 
+static void *
+bitmap_buf_at(struct spdk_bdev *bdev, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t bitmap_offset = RAID_BDEV_BITMAP_OFFSET / bdev->blocklen;
+
+	SPDK_CU_ASSERT_FATAL(offset_blocks >= bitmap_offset);
+	SPDK_CU_ASSERT_FATAL((offset_blocks - bitmap_offset + num_blocks) * bdev->blocklen <=
+			     RAID_BDEV_BITMAP_MAX_SIZE);
+
+	return g_bitmap_buf + (offset_blocks - bitmap_offset) * bdev->blocklen;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+
+	g_read_counter++;
+
+	memcpy(buf, bitmap_buf_at(bdev, offset_blocks, num_blocks), num_blocks * bdev->blocklen);
+
+	cb(&g_bdev_io, true, cb_arg);
+	return 0;
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+	struct spdk_bdev_io *bdev_io;
+
+	g_write_counter++;
+
+	memcpy(bitmap_buf_at(bdev, offset_blocks, num_blocks), buf, num_blocks * bdev->blocklen);
+
+	bdev_io = calloc(1, sizeof(*bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->internal.cb = cb;
+	bdev_io->internal.caller_ctx = cb_arg;
+	bdev_io->bdev = bdev;
+
+	TAILQ_INSERT_TAIL(&g_bdev_io_queue, bdev_io, internal.link);
+
+	return 0;
+}
+
 static void
 process_io_completions(void)
 {
@@ -377,6 +435,120 @@ test_raid_bdev_parse_superblock(void)
 	CU_ASSERT(raid_bdev_parse_superblock(&ctx) == -EINVAL);
 }
 
+static void
+test_raid_bdev_bitmap(void)
+{
+	struct raid_base_bdev_info base_info[3] = {{0}};
+	struct raid_bdev raid_bdev = {
+		.num_base_bdevs = SPDK_COUNTOF(base_info),
+		.base_bdev_info = base_info,
+		.bdev = g_bdev,
+	};
+	struct raid_bdev_superblock *sb;
+	struct raid_bdev_bitmap *bitmap;
+	uint32_t block_size = spdk_bdev_get_data_block_size(&raid_bdev.bdev);
+	int status;
+	uint8_t i;
+
+	if (spdk_bdev_is_md_interleaved(&raid_bdev.bdev)) {
+		/* not supported */
+		return;
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(base_info); i++) {
+		base_info[i].raid_bdev = &raid_bdev;
+		base_info[i].data_offset = RAID_BDEV_MIN_DATA_OFFSET_SIZE / block_size;
+		if (i > 0) {
+			base_info[i].is_configured = true;
+		}
+	}
+
+	status = raid_bdev_alloc_superblock(&raid_bdev, block_size);
+	CU_ASSERT(status == 0);
+	sb = raid_bdev.sb;
+
+	/* minimum region size */
+	raid_bdev.bdev.blockcnt = 512 * RAID_BDEV_BITMAP_MIN_REGION_SIZE / block_size;
+	raid_bdev_init_superblock(&raid_bdev);
+
+	CU_ASSERT(raid_bdev_alloc_bitmap(&raid_bdev) == 0);
+	bitmap = raid_bdev.bitmap;
+	SPDK_CU_ASSERT_FATAL(bitmap != NULL);
+	CU_ASSERT(bitmap->offset_blocks == RAID_BDEV_BITMAP_OFFSET / block_size);
+	CU_ASSERT(bitmap->region_size == RAID_BDEV_BITMAP_MIN_REGION_SIZE / block_size);
+	CU_ASSERT(bitmap->num_regions == 512);
+	CU_ASSERT(bitmap->num_blocks == 1);
+	CU_ASSERT(sb->bitmap.offset == bitmap->offset_blocks);
+	CU_ASSERT(sb->bitmap.region_size == bitmap->region_size);
+	CU_ASSERT(sb->bitmap.num_regions == bitmap->num_regions);
+
+	/* write the modified blocks to all configured base bdevs */
+	bitmap->bits[0] = 0x5;
+	bitmap->bits[bitmap->num_regions / 8 - 1] = 0x80;
+	bitmap->dirty_start = 0;
+	bitmap->dirty_end = 1;
+
+	status = INT_MAX;
+	g_write_counter = 0;
+	raid_bdev_write_bitmap(&raid_bdev, write_sb_cb, &status);
+	CU_ASSERT(g_write_counter == raid_bdev.num_base_bdevs - 1);
+	CU_ASSERT(bitmap->dirty_start >= bitmap->dirty_end);
+	process_io_completions();
+	CU_ASSERT(status == 0);
+	CU_ASSERT(memcmp(g_bitmap_buf, bitmap->bits, bitmap->num_blocks * block_size) == 0);
+
+	/* load merges the bitmap read from the base bdevs with the current one */
+	memset(bitmap->bits, 0, bitmap->num_blocks * block_size);
+	bitmap->bits[1] = 0x1;
+
+	status = INT_MAX;
+	g_read_counter = 0;
+	raid_bdev_load_bitmap(&raid_bdev, write_sb_cb, &status);
+	CU_ASSERT(g_read_counter == raid_bdev.num_base_bdevs - 1);
+	CU_ASSERT(status == 0);
+	CU_ASSERT(bitmap->bits[0] == 0x5);
+	CU_ASSERT(bitmap->bits[1] == 0x1);
+	CU_ASSERT(bitmap->bits[bitmap->num_regions / 8 - 1] == 0x80);
+
+	raid_bdev_free_bitmap(&raid_bdev);
+	CU_ASSERT(raid_bdev.bitmap == NULL);
+
+	/* existing valid geometry is used */
+	sb->flags |= RAID_BDEV_SB_FLAG_BITMAP;
+	sb->bitmap.region_size *= 2;
+	sb->bitmap.num_regions /= 2;
+	CU_ASSERT(raid_bdev_alloc_bitmap(&raid_bdev) == 0);
+	SPDK_CU_ASSERT_FATAL(raid_bdev.bitmap != NULL);
+	CU_ASSERT(raid_bdev.bitmap->region_size == 2 * RAID_BDEV_BITMAP_MIN_REGION_SIZE / block_size);
+	CU_ASSERT(raid_bdev.bitmap->num_regions == 256);
+	CU_ASSERT(sb->flags & RAID_BDEV_SB_FLAG_BITMAP);
+	raid_bdev_free_bitmap(&raid_bdev);
+
+	/* invalid geometry is ignored */
+	sb->bitmap.num_regions = 1;
+	CU_ASSERT(raid_bdev_alloc_bitmap(&raid_bdev) == 0);
+	SPDK_CU_ASSERT_FATAL(raid_bdev.bitmap != NULL);
+	CU_ASSERT(raid_bdev.bitmap->num_regions == 512);
+	CU_ASSERT(!(sb->flags & RAID_BDEV_SB_FLAG_BITMAP));
+	raid_bdev_free_bitmap(&raid_bdev);
+
+	/* region size grows to fit the bitmap in its maximum size */
+	sb->raid_size = 1ULL << 40;
+	CU_ASSERT(raid_bdev_alloc_bitmap(&raid_bdev) == 0);
+	SPDK_CU_ASSERT_FATAL(raid_bdev.bitmap != NULL);
+	CU_ASSERT(raid_bdev.bitmap->num_regions == RAID_BDEV_BITMAP_MAX_SIZE * 8);
+	CU_ASSERT(raid_bdev.bitmap->region_size == (1ULL << 40) / (RAID_BDEV_BITMAP_MAX_SIZE * 8));
+	CU_ASSERT(raid_bdev.bitmap->num_blocks == RAID_BDEV_BITMAP_MAX_SIZE / block_size);
+	raid_bdev_free_bitmap(&raid_bdev);
+
+	/* no space before the data region */
+	base_info[1].data_offset = RAID_BDEV_BITMAP_OFFSET / block_size;
+	CU_ASSERT(raid_bdev_alloc_bitmap(&raid_bdev) == -ENOSPC);
+	CU_ASSERT(raid_bdev.bitmap == NULL);
+
+	raid_bdev_free_superblock(&raid_bdev);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -385,6 +557,7 @@ main(int argc, char **argv)
 		{ "test_raid_bdev_write_superblock", test_raid_bdev_write_superblock },
 		{ "test_raid_bdev_load_base_bdev_superblock", test_raid_bdev_load_base_bdev_superblock },
 		{ "test_raid_bdev_parse_superblock", test_raid_bdev_parse_superblock },
+		{ "test_raid_bdev_bitmap", test_raid_bdev_bitmap },
 		CU_TEST_INFO_NULL,
 	};
 	CU_SuiteInfo suites[] = {
@@ -56,6 +56,12 @@ spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc,
 	return 0;
 }
 
+uint64_t
+spdk_bdev_io_get_submit_tsc(struct spdk_bdev_io *bdev_io)
+{
+	return bdev_io->internal.submit_tsc;
+}
+
 void
 raid_bdev_fail_base_bdev(struct raid_base_bdev_info *base_info)
 {
@@ -217,8 +223,8 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == n * small_io_blocks);
-		raid1_ch->read_blocks_outstanding[i] = 0;
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == n * small_io_blocks);
+		raid1_ch->base[i].read_blocks_outstanding = 0;
 	}
 
 	/*
@@ -240,7 +246,7 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == big_io_blocks);
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == big_io_blocks);
 	}
 
 	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, small_io_blocks);
@@ -255,6 +261,127 @@ test_raid1_read_balancing(void)
 	run_for_each_raid1_config(_test_raid1_read_balancing);
 }
 
+static void
+_test_raid1_read_policy(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid_bdev_io *raid_io;
+	struct spdk_bdev_io bdev_io = {};
+	struct spdk_io_channel *base_ch;
+	uint64_t latency;
+	uint8_t idx, i;
+	int n;
+
+	raid_bdev->read_policy = RAID_READ_POLICY_LATENCY;
+
+	/* base bdevs without a latency sample are tried first */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+		raid1_submit_read_request(raid_io);
+		idx = raid_io->base_bdev_io_submitted;
+		CU_ASSERT(idx == i);
+		CU_ASSERT(raid1_ch->base[idx].reads_outstanding == 1);
+
+		/* the last base bdev is 10x slower than the others */
+		latency = (idx == raid_bdev->num_base_bdevs - 1) ? 1000 : 100;
+		bdev_io.internal.submit_tsc = spdk_get_ticks();
+		spdk_delay_us(latency);
+		g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+		raid1_read_bdev_io_completion(&bdev_io, true, raid_io);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(raid1_ch->base[idx].reads_outstanding == 0);
+		CU_ASSERT(raid1_ch->base[idx].read_latency == latency);
+	}
+
+	/* the moving average converges to the new latency */
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 0);
+	bdev_io.internal.submit_tsc = spdk_get_ticks();
+	spdk_delay_us(900);
+	raid1_read_bdev_io_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(raid1_ch->base[0].read_latency == 100 - (100 >> RAID1_READ_LATENCY_EWMA_SHIFT) +
+		  (900 >> RAID1_READ_LATENCY_EWMA_SHIFT));
+	raid1_ch->base[0].read_latency = 100;
+
+	/* the slow base bdev gets a read only when the others have ~10x more queued */
+	for (n = 0; n < 9 * (raid_bdev->num_base_bdevs - 1); n++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted != raid_bdev->num_base_bdevs - 1);
+		put_raid_io(raid_io);
+	}
+	for (i = 0; i < raid_bdev->num_base_bdevs - 1; i++) {
+		CU_ASSERT(raid1_ch->base[i].reads_outstanding == 9);
+	}
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == raid_bdev->num_base_bdevs - 1);
+	put_raid_io(raid_io);
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 0);
+	put_raid_io(raid_io);
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].reads_outstanding = 0;
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+		raid1_ch->base[i].read_seq_sampled = raid1_ch->read_seq;
+	}
+
+	/* an idle base bdev is probed after not being read for a while */
+	raid1_ch->read_seq += RAID1_READ_LATENCY_PROBE_INTERVAL + 1;
+	raid1_ch->base[0].read_seq_sampled = raid1_ch->read_seq;
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 1);
+	CU_ASSERT(raid1_ch->base[1].read_seq_sampled == raid1_ch->read_seq - 1);
+	put_raid_io(raid_io);
+	raid1_ch->base[1].reads_outstanding = 0;
+	raid1_ch->base[1].read_blocks_outstanding = 0;
+
+	/* write-mostly base bdevs are read only if no other base bdev is available */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_seq_sampled = raid1_ch->read_seq;
+		raid_bdev->base_bdev_info[i].write_mostly = (i != 0);
+	}
+	raid1_ch->base[0].read_latency = 1000000;
+	for (n = 0; n < 4; n++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == 0);
+		put_raid_io(raid_io);
+	}
+	base_ch = raid_ch->_base_channels[0];
+	raid_ch->_base_channels[0] = NULL;
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 1);
+	put_raid_io(raid_io);
+	raid_ch->_base_channels[0] = base_ch;
+
+	/* write-mostly is also honored by the default policy */
+	raid_bdev->read_policy = RAID_READ_POLICY_LEAST_OUTSTANDING;
+	raid_bdev->base_bdev_info[0].write_mostly = true;
+	raid_bdev->base_bdev_info[1].write_mostly = false;
+	raid1_ch->base[1].read_blocks_outstanding = 1000;
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 8);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 1);
+	put_raid_io(raid_io);
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid_bdev->base_bdev_info[i].write_mostly = false;
+	}
+}
+
+static void
+test_raid1_read_policy(void)
+{
+	run_for_each_raid1_config(_test_raid1_read_policy);
+}
+
 static void
 _test_raid1_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
 {
@@ -440,7 +567,7 @@ _test_raid1_read_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel
 	/* read from base bdev #1 fails, read from #0 succeeds */
 	base_info->is_failed = false;
 	base_info = &raid_bdev->base_bdev_info[1];
-	raid1_ch->read_blocks_outstanding[0] = 123;
+	raid1_ch->base[0].read_blocks_outstanding = 123;
 	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
 	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 64);
 	raid1_submit_read_request(raid_io);
@@ -513,6 +640,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("raid1", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_raid1_start);
 	CU_ADD_TEST(suite, test_raid1_read_balancing);
+	CU_ADD_TEST(suite, test_raid1_read_policy);
 	CU_ADD_TEST(suite, test_raid1_write_error);
 	CU_ADD_TEST(suite, test_raid1_read_error);
 
@@ -0,0 +1,682 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+
+#include "common/lib/ut_multithread.c"
+
+#include "bdev/raid/raid1.c"
+#include "bdev/raid/raid10.c"
+#include "../common.c"
+
+static enum spdk_bdev_io_status g_io_status;
+static struct spdk_bdev_desc *g_last_io_desc;
+static spdk_bdev_io_completion_cb g_last_io_cb;
+static uint64_t g_last_io_offset;
+static uint64_t g_last_io_num_blocks;
+static int g_process_status;
+static int g_process_completions;
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(raid_bdev_queue_io_wait, (struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+					struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn));
+DEFINE_STUB(raid_bdev_remap_dix_reftag, int, (void *md_buf, uint64_t num_blocks,
+		struct spdk_bdev *bdev, uint32_t remapped_offset), -1);
+DEFINE_STUB(spdk_bdev_notify_blockcnt_change, int, (struct spdk_bdev *bdev, uint64_t size), 0);
+DEFINE_STUB(spdk_bdev_io_get_submit_tsc, uint64_t, (struct spdk_bdev_io *bdev_io), 0);
+
+void
+raid_bdev_process_request_complete(struct raid_bdev_process_request *process_req, int status)
+{
+	g_process_status = status;
+	g_process_completions++;
+}
+
+void
+raid_bdev_io_init(struct raid_bdev_io *raid_io, struct raid_bdev_io_channel *raid_ch,
+		  enum spdk_bdev_io_type type, uint64_t offset_blocks,
+		  uint64_t num_blocks, struct iovec *iovs, int iovcnt, void *md_buf,
+		  struct spdk_memory_domain *memory_domain, void *memory_domain_ctx)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+
+	raid_test_bdev_io_init(raid_io, raid_bdev, raid_ch, type, offset_blocks, num_blocks,
+			       iovs, iovcnt, md_buf);
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc,
+			   struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	g_last_io_desc = desc;
+	g_last_io_cb = cb;
+	g_last_io_offset = offset_blocks;
+	g_last_io_num_blocks = num_blocks;
+
+	return 0;
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc,
+			    struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			    spdk_bdev_io_completion_cb cb, void *cb_arg, struct spdk_bdev_ext_io_opts *opts)
+{
+	g_last_io_desc = desc;
+	g_last_io_cb = cb;
+	g_last_io_offset = offset_blocks;
+	g_last_io_num_blocks = num_blocks;
+
+	return 0;
+}
+
+void
+raid_bdev_fail_base_bdev(struct raid_base_bdev_info *base_info)
+{
+	base_info->is_failed = true;
+}
+
+static int
+test_setup(void)
+{
+	uint8_t num_base_bdevs_values[] = { 4, 6 };
+	uint64_t base_bdev_blockcnt_values[] = { 1024, 1024 * 1024 };
+	uint32_t base_bdev_blocklen_values[] = { 512, 4096 };
+	uint32_t strip_size_values[] = { 16, 64 };
+	uint8_t *num_base_bdevs;
+	uint64_t *base_bdev_blockcnt;
+	uint32_t *base_bdev_blocklen;
+	uint32_t *strip_size;
+	uint64_t params_count;
+	int rc;
+
+	params_count = SPDK_COUNTOF(num_base_bdevs_values) *
+		       SPDK_COUNTOF(base_bdev_blockcnt_values) *
+		       SPDK_COUNTOF(base_bdev_blocklen_values) *
+		       SPDK_COUNTOF(strip_size_values);
+	rc = raid_test_params_alloc(params_count);
+	if (rc) {
+		return rc;
+	}
+
+	ARRAY_FOR_EACH(num_base_bdevs_values, num_base_bdevs) {
+		ARRAY_FOR_EACH(base_bdev_blockcnt_values, base_bdev_blockcnt) {
+			ARRAY_FOR_EACH(base_bdev_blocklen_values, base_bdev_blocklen) {
+				ARRAY_FOR_EACH(strip_size_values, strip_size) {
+					struct raid_params params = {
+						.num_base_bdevs = *num_base_bdevs,
+						.base_bdev_blockcnt = *base_bdev_blockcnt,
+						.base_bdev_blocklen = *base_bdev_blocklen,
+						.strip_size = *strip_size,
+					};
+					raid_test_params_add(&params);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	raid_test_params_free();
+	return 0;
+}
+
+static struct raid10_info *
+create_raid10(struct raid_params *params)
+{
+	struct raid_bdev *raid_bdev = raid_test_create_raid_bdev(params, &g_raid10_module);
+
+	SPDK_CU_ASSERT_FATAL(raid10_start(raid_bdev) == 0);
+
+	return raid_bdev->module_private;
+}
+
+static void
+delete_raid10(struct raid10_info *r10_info)
+{
+	struct raid_bdev *raid_bdev = r10_info->r1info.raid_bdev;
+
+	raid10_stop(raid_bdev);
+
+	raid_test_delete_raid_bdev(raid_bdev);
+}
+
+static void
+test_raid10_start(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid10_info *r10_info;
+		struct raid_bdev *raid_bdev;
+		uint64_t base_bdev_data_size;
+
+		r10_info = create_raid10(params);
+
+		SPDK_CU_ASSERT_FATAL(r10_info != NULL);
+
+		raid_bdev = r10_info->r1info.raid_bdev;
+		base_bdev_data_size = params->base_bdev_blockcnt / params->strip_size * params->strip_size;
+
+		CU_ASSERT_EQUAL(raid_bdev->level, RAID10);
+		CU_ASSERT_EQUAL(raid_bdev->bdev.blockcnt,
+				base_bdev_data_size * params->num_base_bdevs / RAID10_NUM_MIRRORS);
+		CU_ASSERT_EQUAL(raid_bdev->base_bdev_info[0].data_size, base_bdev_data_size);
+		CU_ASSERT_EQUAL(raid_bdev->bdev.optimal_io_boundary, params->strip_size);
+		CU_ASSERT_TRUE(raid_bdev->bdev.split_on_optimal_io_boundary);
+		CU_ASSERT_PTR_EQUAL(raid_bdev->module, &g_raid10_module);
+
+		delete_raid10(r10_info);
+	}
+
+	/* odd number of base bdevs is rejected */
+	params = &g_params[0];
+	{
+		struct raid_params odd_params = *params;
+		struct raid_bdev *raid_bdev;
+
+		odd_params.num_base_bdevs = 5;
+		raid_bdev = raid_test_create_raid_bdev(&odd_params, &g_raid10_module);
+		CU_ASSERT(raid10_start(raid_bdev) == -EINVAL);
+		raid_test_delete_raid_bdev(raid_bdev);
+	}
+
+	/* a mirror pair with both base bdevs missing is rejected, one missing is not */
+	{
+		struct raid_bdev *raid_bdev;
+		struct spdk_bdev_desc *desc0, *desc1;
+
+		raid_bdev = raid_test_create_raid_bdev(params, &g_raid10_module);
+		desc0 = raid_bdev->base_bdev_info[2].desc;
+		desc1 = raid_bdev->base_bdev_info[3].desc;
+
+		raid_bdev->base_bdev_info[2].desc = NULL;
+		CU_ASSERT(raid10_start(raid_bdev) == 0);
+		raid10_stop(raid_bdev);
+
+		raid_bdev->base_bdev_info[3].desc = NULL;
+		CU_ASSERT(raid10_start(raid_bdev) == -EINVAL);
+
+		raid_bdev->base_bdev_info[2].desc = desc0;
+		raid_bdev->base_bdev_info[3].desc = desc1;
+		raid_test_delete_raid_bdev(raid_bdev);
+	}
+}
+
+static void
+test_raid10_base_bdev_removable(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid10_info *r10_info;
+		struct raid_bdev *raid_bdev;
+		struct raid_base_bdev_info *base_info;
+		uint8_t i;
+
+		r10_info = create_raid10(params);
+		raid_bdev = r10_info->r1info.raid_bdev;
+
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			base_info->is_configured = true;
+		}
+
+		/* one base bdev of each pair can be removed */
+		for (i = 0; i < raid_bdev->num_base_bdevs; i += RAID10_NUM_MIRRORS) {
+			base_info = &raid_bdev->base_bdev_info[i];
+			CU_ASSERT(raid10_base_bdev_removable(base_info) == true);
+			base_info->remove_scheduled = true;
+		}
+
+		/* but not the remaining one */
+		for (i = 0; i < raid_bdev->num_base_bdevs; i += RAID10_NUM_MIRRORS) {
+			base_info = &raid_bdev->base_bdev_info[raid10_mirror_idx(i)];
+			CU_ASSERT(raid10_base_bdev_removable(base_info) == false);
+		}
+
+		/* a removed base bdev counts as missing, too */
+		base_info = &raid_bdev->base_bdev_info[0];
+		base_info->remove_scheduled = false;
+		base_info->is_configured = false;
+		CU_ASSERT(raid10_base_bdev_removable(&raid_bdev->base_bdev_info[1]) == false);
+
+		/* the mirror of a base bdev being rebuilt holds the only copy */
+		base_info->is_configured = true;
+		base_info->is_process_target = true;
+		CU_ASSERT(raid10_base_bdev_removable(&raid_bdev->base_bdev_info[1]) == false);
+		CU_ASSERT(raid10_base_bdev_removable(base_info) == true);
+
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			base_info->is_configured = false;
+			base_info->remove_scheduled = false;
+			base_info->is_process_target = false;
+		}
+
+		delete_raid10(r10_info);
+	}
+}
+
+static struct raid_bdev_io *
+get_raid_io(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+	    enum spdk_bdev_io_type io_type, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev_io *raid_io;
+
+	raid_io = calloc(1, sizeof(*raid_io));
+	SPDK_CU_ASSERT_FATAL(raid_io != NULL);
+
+	raid_test_bdev_io_init(raid_io, raid_bdev, raid_ch, io_type, offset_blocks, num_blocks, NULL, 0,
+			       NULL);
+
+	return raid_io;
+}
+
+static void
+put_raid_io(struct raid_bdev_io *raid_io)
+{
+	free(raid_io);
+}
+
+void
+raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+
+	put_raid_io(raid_io);
+}
+
+static void
+run_for_each_raid10_config(void (*test_fn)(struct raid_bdev *raid_bdev,
+			   struct raid_bdev_io_channel *raid_ch))
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid10_info *r10_info;
+		struct raid_bdev_io_channel *raid_ch;
+
+		r10_info = create_raid10(params);
+		raid_ch = raid_test_create_io_channel(r10_info->r1info.raid_bdev);
+
+		test_fn(r10_info->r1info.raid_bdev, raid_ch);
+
+		raid_test_destroy_io_channel(raid_ch);
+		delete_raid10(r10_info);
+	}
+}
+
+static void
+_test_raid10_io_mapping(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint8_t num_pairs = raid10_num_pairs(raid_bdev);
+	struct raid_bdev_io *raid_io;
+	uint64_t strip;
+	uint64_t offset_blocks;
+	uint8_t pair_idx;
+	uint8_t i;
+
+	for (strip = 0; strip < num_pairs * 3; strip++) {
+		pair_idx = strip % num_pairs;
+		offset_blocks = strip * raid_bdev->strip_size + 1;
+
+		/* reads go to one of the base bdevs of the pair holding the strip */
+		raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1);
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted / RAID10_NUM_MIRRORS == pair_idx);
+		CU_ASSERT(g_last_io_desc == raid_bdev->base_bdev_info[raid_io->base_bdev_io_submitted].desc);
+		CU_ASSERT(g_last_io_offset == (strip / num_pairs) * raid_bdev->strip_size + 1);
+		CU_ASSERT(g_last_io_num_blocks == 1);
+		put_raid_io(raid_io);
+
+		/* writes go to both base bdevs of the pair */
+		g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+		raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, offset_blocks, 1);
+		raid1_submit_write_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == RAID10_NUM_MIRRORS);
+		CU_ASSERT(raid_io->base_bdev_io_remaining == RAID10_NUM_MIRRORS);
+		CU_ASSERT(g_last_io_desc == raid_bdev->base_bdev_info[pair_idx * 2 + 1].desc);
+		CU_ASSERT(g_last_io_offset == (strip / num_pairs) * raid_bdev->strip_size + 1);
+		put_raid_io(raid_io);
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+}
+
+static void
+test_raid10_io_mapping(void)
+{
+	run_for_each_raid10_config(_test_raid10_io_mapping);
+}
+
+static void
+_test_raid10_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	const uint64_t big_io_blocks = 8;
+	const uint64_t small_io_blocks = 1;
+	struct raid_bdev_io *raid_io;
+	uint8_t big_io_base_bdev_idx;
+	uint8_t i;
+	int n;
+
+	/* same sized IOs to one strip should alternate between the mirrors */
+	for (n = 0; n < 3; n++) {
+		for (i = 0; i < RAID10_NUM_MIRRORS; i++) {
+			raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, small_io_blocks);
+			raid1_submit_read_request(raid_io);
+			CU_ASSERT(raid_io->base_bdev_io_submitted == i);
+			put_raid_io(raid_io);
+		}
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding ==
+			  (i < RAID10_NUM_MIRRORS ? n * small_io_blocks : 0));
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+
+	/* small IOs avoid the mirror with the big IO until the block counts are matched */
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, big_io_blocks);
+	raid1_submit_read_request(raid_io);
+	big_io_base_bdev_idx = raid_io->base_bdev_io_submitted;
+	put_raid_io(raid_io);
+
+	for (n = 0; n < (int)(big_io_blocks / small_io_blocks); n++) {
+		raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, small_io_blocks);
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == raid10_mirror_idx(big_io_base_bdev_idx));
+		put_raid_io(raid_io);
+	}
+
+	/* a missing mirror is never selected */
+	raid1_ch->base[0].read_blocks_outstanding = 0;
+	raid1_ch->base[1].read_blocks_outstanding = UINT32_MAX;
+	raid_ch->_base_channels[0] = NULL;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, small_io_blocks);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 1);
+	put_raid_io(raid_io);
+
+	/* read fails if both mirrors are missing */
+	raid_ch->_base_channels[1] = NULL;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0, small_io_blocks);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	raid_ch->_base_channels[0] = (void *)1;
+	raid_ch->_base_channels[1] = (void *)1;
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+}
+
+static void
+test_raid10_read_balancing(void)
+{
+	run_for_each_raid10_config(_test_raid10_read_balancing);
+}
+
+static void
+_test_raid10_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_io *raid_io;
+	struct raid_base_bdev_info *base_info;
+	struct spdk_bdev_io bdev_io = {};
+	uint8_t i;
+
+	/* one mirror fails, the write succeeds */
+	for (i = 0; i < RAID10_NUM_MIRRORS; i++) {
+		g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+		raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 1);
+		raid1_submit_write_request(raid_io);
+
+		base_info = &raid_bdev->base_bdev_info[i];
+		base_info->is_failed = false;
+		bdev_io.bdev = base_info->desc->bdev;
+		raid1_write_bdev_io_completion(&bdev_io, false, raid_io);
+		CU_ASSERT(base_info->is_failed == true);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_PENDING);
+
+		base_info = &raid_bdev->base_bdev_info[raid10_mirror_idx(i)];
+		base_info->is_failed = false;
+		bdev_io.bdev = base_info->desc->bdev;
+		raid1_write_bdev_io_completion(&bdev_io, true, raid_io);
+		CU_ASSERT(base_info->is_failed == false);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* both mirrors fail */
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 1);
+	raid1_submit_write_request(raid_io);
+	for (i = 0; i < RAID10_NUM_MIRRORS; i++) {
+		base_info = &raid_bdev->base_bdev_info[i];
+		bdev_io.bdev = base_info->desc->bdev;
+		raid1_write_bdev_io_completion(&bdev_io, false, raid_io);
+	}
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	/* degraded pair, the remaining mirror succeeds */
+	raid_ch->_base_channels[0] = NULL;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 1);
+	raid1_submit_write_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_remaining == 1);
+	CU_ASSERT(g_last_io_desc == raid_bdev->base_bdev_info[1].desc);
+	bdev_io.bdev = raid_bdev->base_bdev_info[1].desc->bdev;
+	raid1_write_bdev_io_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* both mirrors missing */
+	raid_ch->_base_channels[1] = NULL;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 1);
+	raid1_submit_write_request(raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+
+	raid_ch->_base_channels[0] = (void *)1;
+	raid_ch->_base_channels[1] = (void *)1;
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		base_info->is_failed = false;
+	}
+}
+
+static void
+test_raid10_write_error(void)
+{
+	run_for_each_raid10_config(_test_raid10_write_error);
+}
+
+static void
+_test_raid10_read_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[2];
+	struct raid_bdev_io *raid_io;
+	struct spdk_bdev_io bdev_io = {};
+	uint64_t offset_blocks = raid_bdev->strip_size;
+
+	/* the read fails, the read from the mirror succeeds and the data is rewritten */
+	base_info->is_failed = false;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 2);
+	CU_ASSERT(g_last_io_desc == base_info->desc);
+	CU_ASSERT(g_last_io_cb == raid1_read_bdev_io_completion);
+	raid1_read_bdev_io_completion(&bdev_io, false, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_PENDING);
+
+	CU_ASSERT(g_last_io_desc == raid_bdev->base_bdev_info[3].desc);
+	CU_ASSERT(g_last_io_cb == raid1_read_other_completion);
+	CU_ASSERT(g_last_io_offset == 0);
+	raid1_read_other_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_PENDING);
+
+	CU_ASSERT(g_last_io_desc == base_info->desc);
+	CU_ASSERT(g_last_io_cb == raid1_correct_read_error_completion);
+	raid1_correct_read_error_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(base_info->is_failed == false);
+
+	/* the rewrite fails */
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1);
+	raid1_submit_read_request(raid_io);
+	raid1_read_bdev_io_completion(&bdev_io, false, raid_io);
+	raid1_read_other_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(g_last_io_cb == raid1_correct_read_error_completion);
+	raid1_correct_read_error_completion(&bdev_io, false, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(base_info->is_failed == true);
+
+	/* both reads fail */
+	base_info->is_failed = false;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1);
+	raid1_submit_read_request(raid_io);
+	raid1_read_bdev_io_completion(&bdev_io, false, raid_io);
+	raid1_read_other_completion(&bdev_io, false, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(base_info->is_failed == true);
+
+	/* the mirror is missing */
+	base_info->is_failed = false;
+	raid_ch->_base_channels[3] = NULL;
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, offset_blocks, 1);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 2);
+	raid1_read_bdev_io_completion(&bdev_io, false, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(base_info->is_failed == true);
+
+	raid_ch->_base_channels[3] = (void *)1;
+	base_info->is_failed = false;
+}
+
+static void
+test_raid10_read_error(void)
+{
+	run_for_each_raid10_config(_test_raid10_read_error);
+}
+
+static void
+_test_raid10_process_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_bdev_process_request process_req = {};
+	uint8_t num_pairs = raid10_num_pairs(raid_bdev);
+	uint32_t strip_size = raid_bdev->strip_size;
+	struct spdk_bdev_io bdev_io = {};
+	uint8_t target_idx;
+	uint8_t target_pair_idx;
+	int ret;
+
+	process_req.raid_io.raid_bdev = raid_bdev;
+	process_req.target_ch = (void *)1;
+
+	for (target_idx = 0; target_idx < raid_bdev->num_base_bdevs; target_idx++) {
+		uint8_t mirror_idx = raid10_mirror_idx(target_idx);
+		uint64_t offset_blocks = 0;
+		uint64_t window_end = strip_size * num_pairs * 2;
+
+		target_pair_idx = target_idx / RAID10_NUM_MIRRORS;
+		process_req.target = &raid_bdev->base_bdev_info[target_idx];
+		raid_ch->_base_channels[target_idx] = NULL;
+
+		while (offset_blocks < window_end) {
+			uint64_t strip = offset_blocks / strip_size;
+
+			process_req.offset_blocks = offset_blocks;
+			process_req.num_blocks = window_end - offset_blocks;
+			g_process_completions = 0;
+			g_last_io_desc = NULL;
+
+			ret = raid10_submit_process_request(&process_req, raid_ch);
+			SPDK_CU_ASSERT_FATAL(ret > 0);
+
+			if (strip / num_pairs == 1 && strip % num_pairs > target_pair_idx) {
+				/* nothing left to copy in this window */
+				CU_ASSERT(ret == (int)(window_end - offset_blocks));
+				CU_ASSERT(g_last_io_desc == NULL);
+				poll_threads();
+				CU_ASSERT(g_process_completions == 1);
+				CU_ASSERT(g_process_status == 0);
+				offset_blocks += ret;
+				continue;
+			}
+
+			/* only the target's strip is read from the mirror and written to the target */
+			process_req.num_blocks = ret;
+			CU_ASSERT(g_last_io_desc == raid_bdev->base_bdev_info[mirror_idx].desc);
+			CU_ASSERT(g_last_io_cb == raid1_read_bdev_io_completion);
+			CU_ASSERT(g_last_io_num_blocks == strip_size);
+			CU_ASSERT(process_req.raid_io.offset_blocks / strip_size % num_pairs == target_pair_idx);
+			CU_ASSERT(offset_blocks + ret == process_req.raid_io.offset_blocks + strip_size);
+
+			raid1_read_bdev_io_completion(&bdev_io, true, &process_req.raid_io);
+			CU_ASSERT(g_last_io_desc == process_req.target->desc);
+			CU_ASSERT(g_last_io_cb == raid1_process_write_completed);
+			CU_ASSERT(g_last_io_offset == process_req.raid_io.offset_blocks / strip_size / num_pairs *
+				  strip_size);
+			CU_ASSERT(g_process_completions == 0);
+
+			raid1_process_write_completed(&bdev_io, true, &process_req);
+			CU_ASSERT(g_process_completions == 1);
+			CU_ASSERT(g_process_status == 0);
+
+			offset_blocks += ret;
+		}
+
+		raid_ch->_base_channels[target_idx] = (void *)1;
+	}
+}
+
+static void
+test_raid10_process_request(void)
+{
+	run_for_each_raid10_config(_test_raid10_process_request);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("raid10", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_raid10_start);
+	CU_ADD_TEST(suite, test_raid10_base_bdev_removable);
+	CU_ADD_TEST(suite, test_raid10_io_mapping);
+	CU_ADD_TEST(suite, test_raid10_read_balancing);
+	CU_ADD_TEST(suite, test_raid10_write_error);
+	CU_ADD_TEST(suite, test_raid10_read_error);
+	CU_ADD_TEST(suite, test_raid10_process_request);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
@@ -187,9 +187,17 @@ test_raid5f_start(void)
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.blockcnt,
 				(params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size) *
 				(params->num_base_bdevs - 1));
-		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
 		CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_optimal_io_boundary);
-		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+		if (params->md_type == RAID_PARAMS_MD_SEPARATE) {
+			CU_ASSERT_FALSE(r5f_info->partial_stripe_writes);
+			CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
+			CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+			CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_write_unit);
+		} else {
+			CU_ASSERT_TRUE(r5f_info->partial_stripe_writes);
+			CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, r5f_info->stripe_blocks);
+			CU_ASSERT_FALSE(r5f_info->raid_bdev->bdev.split_on_write_unit);
+		}
 
 		delete_raid5f(r5f_info);
 	}
@@ -224,6 +232,7 @@ struct raid_io_info {
 	size_t parity_md_buf_size;
 	void *degraded_buf;
 	void *degraded_md_buf;
+	void **chunk_bufs;
 	enum spdk_bdev_io_status status;
 	TAILQ_HEAD(, spdk_bdev_io) bdev_io_queue;
 	TAILQ_HEAD(, spdk_bdev_io_wait_entry) bdev_io_wait_queue;
@@ -356,6 +365,38 @@ submit_io(struct raid_io_info *io_info, struct spdk_bdev_desc *desc,
 	return 0;
 }
 
+static int
+submit_partial_io(struct spdk_bdev_desc *desc, struct iovec *iov, int iovcnt,
+		  uint64_t offset_blocks, uint64_t num_blocks,
+		  spdk_bdev_io_completion_cb cb, void *cb_arg, bool write)
+{
+	struct chunk *chunk = cb_arg;
+	struct stripe_request *stripe_req = raid5f_chunk_stripe_req(chunk);
+	struct test_raid_bdev_io *test_raid_bdev_io;
+	struct raid_io_info *io_info;
+	struct raid_bdev *raid_bdev;
+	struct iovec buf;
+
+	test_raid_bdev_io = SPDK_CONTAINEROF(stripe_req->raid_io, struct test_raid_bdev_io, raid_io);
+	io_info = test_raid_bdev_io->io_info;
+	raid_bdev = io_info->r5f_info->raid_bdev;
+
+	CU_ASSERT(offset_blocks >> raid_bdev->strip_size_shift == io_info->stripe_index);
+	CU_ASSERT(raid_bdev_channel_get_base_channel(io_info->raid_ch, chunk->index) != NULL);
+
+	buf.iov_base = io_info->chunk_bufs[chunk->index] +
+		       (offset_blocks % raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+	buf.iov_len = num_blocks * raid_bdev->bdev.blocklen;
+
+	if (write) {
+		spdk_iovcpy(iov, iovcnt, &buf, 1);
+	} else {
+		spdk_iovcpy(&buf, 1, iov, iovcnt);
+	}
+
+	return submit_io(io_info, desc, cb, cb_arg);
+}
+
 static void
 process_io_completions(struct raid_io_info *io_info)
 {
@@ -417,6 +458,10 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	SPDK_CU_ASSERT_FATAL(cb == raid5f_chunk_complete_bdev_io);
 
 	stripe_req = raid5f_chunk_stripe_req(chunk);
+	if (stripe_req->type == STRIPE_REQ_PARTIAL) {
+		return submit_partial_io(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, true);
+	}
+
 	test_raid_bdev_io = SPDK_CONTAINEROF(stripe_req->raid_io, struct test_raid_bdev_io, raid_io);
 	io_info = test_raid_bdev_io->io_info;
 	r5f_info = io_info->r5f_info;
@@ -533,6 +578,9 @@ spdk_bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chann
 	struct iovec src;
 
 	if (cb == raid5f_chunk_complete_bdev_io) {
+		if (raid5f_chunk_stripe_req((struct chunk *)cb_arg)->type == STRIPE_REQ_PARTIAL) {
+			return submit_partial_io(desc, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, false);
+		}
 		return spdk_bdev_readv_blocks_degraded(desc, ch, iov, iovcnt, md_buf, offset_blocks,
 						       num_blocks, cb, cb_arg);
 	}
@@ -948,6 +996,10 @@ __test_raid5f_stripe_request_map_iovecs(struct raid_bdev *raid_bdev,
 	stripe_req->parity_chunk = &stripe_req->chunks[raid5f_stripe_data_chunks_num(raid_bdev)];
 	stripe_req->raid_io = &raid_io;
 
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		chunk->req_blocks = raid_bdev->strip_size;
+	}
+
 	ret = raid5f_stripe_request_map_iovecs(stripe_req);
 	CU_ASSERT(ret == 0);
 
@@ -1101,6 +1153,195 @@ test_raid5f_chunk_write_error_with_enomem(void)
 	run_for_each_raid5f_config(__test_raid5f_chunk_write_error_with_enomem);
 }
 
+static void
+test_raid5f_partial_request(struct raid5f_info *r5f_info, struct raid_bdev_io_channel *raid_ch,
+			    enum spdk_bdev_io_type io_type, uint64_t stripe_index,
+			    uint64_t stripe_offset_blocks, uint64_t num_blocks)
+{
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+	uint8_t missing_idx = UINT8_MAX;
+	struct raid_bdev_io *raid_io;
+	struct raid_io_info io_info;
+	void **expected;
+	uint64_t block;
+	size_t j;
+	uint8_t i;
+
+	init_io_info(&io_info, r5f_info, raid_ch, io_type, stripe_index, stripe_offset_blocks,
+		     num_blocks);
+
+	io_info.chunk_bufs = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	SPDK_CU_ASSERT_FATAL(io_info.chunk_bufs != NULL);
+	expected = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+	SPDK_CU_ASSERT_FATAL(expected != NULL);
+
+	/* Initialize the stripe on the base bdevs with consistent parity */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		io_info.chunk_bufs[i] = calloc(1, strip_len);
+		SPDK_CU_ASSERT_FATAL(io_info.chunk_bufs[i] != NULL);
+		expected[i] = calloc(1, strip_len);
+		SPDK_CU_ASSERT_FATAL(expected[i] != NULL);
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (i == p_idx) {
+			continue;
+		}
+		for (j = 0; j < strip_len; j++) {
+			*((uint8_t *)io_info.chunk_bufs[i] + j) = rand();
+		}
+		xor_block(io_info.chunk_bufs[p_idx], io_info.chunk_bufs[i], strip_len);
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		memcpy(expected[i], io_info.chunk_bufs[i], strip_len);
+	}
+
+	for (block = 0; block < num_blocks; block++) {
+		uint64_t stripe_block = stripe_offset_blocks + block;
+		uint8_t data_idx = stripe_block >> raid_bdev->strip_size_shift;
+		uint8_t chunk_idx = data_idx < p_idx ? data_idx : data_idx + 1;
+		void *chunk_block = expected[chunk_idx] +
+				    (stripe_block & (raid_bdev->strip_size - 1)) * blocklen;
+
+		if (io_type == SPDK_BDEV_IO_TYPE_WRITE) {
+			memcpy(chunk_block, io_info.src_buf + block * blocklen, blocklen);
+		} else {
+			memcpy(io_info.src_buf + block * blocklen, chunk_block, blocklen);
+		}
+	}
+
+	if (io_type == SPDK_BDEV_IO_TYPE_WRITE) {
+		memset(expected[p_idx], 0, strip_len);
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			if (i != p_idx) {
+				xor_block(expected[p_idx], expected[i], strip_len);
+			}
+		}
+	}
+
+	raid_io = get_raid_io(&io_info);
+
+	raid5f_submit_rw_request(raid_io);
+
+	/* pre-reads, xor and writes */
+	for (j = 0; j < 8 && io_info.status == SPDK_BDEV_IO_STATUS_PENDING; j++) {
+		process_io_completions(&io_info);
+		poll_threads();
+	}
+
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	if (io_type == SPDK_BDEV_IO_TYPE_READ) {
+		CU_ASSERT(memcmp(io_info.src_buf, io_info.dest_buf, io_info.buf_size) == 0);
+	} else {
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL) {
+				missing_idx = i;
+				continue;
+			}
+			CU_ASSERT(memcmp(io_info.chunk_bufs[i], expected[i], strip_len) == 0);
+		}
+
+		if (missing_idx != UINT8_MAX && missing_idx != p_idx) {
+			/* The data of the missing chunk must be reconstructable from the others */
+			memset(io_info.chunk_bufs[missing_idx], 0, strip_len);
+			for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+				if (i != missing_idx) {
+					xor_block(io_info.chunk_bufs[missing_idx], io_info.chunk_bufs[i], strip_len);
+				}
+			}
+			CU_ASSERT(memcmp(io_info.chunk_bufs[missing_idx], expected[missing_idx], strip_len) == 0);
+		}
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		free(io_info.chunk_bufs[i]);
+		free(expected[i]);
+	}
+	free(io_info.chunk_bufs);
+	free(expected);
+	deinit_io_info(&io_info);
+}
+
+static void
+__test_raid5f_submit_partial_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t stripe_index;
+
+	if (!r5f_info->partial_stripe_writes) {
+		return;
+	}
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, 0, 1);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, r5f_info->stripe_blocks - 1, 1);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, strip_size, strip_size);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, strip_size / 2, strip_size);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, 1, r5f_info->stripe_blocks - 1);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, 0, r5f_info->stripe_blocks - 1);
+		if (strip_size <= 2) {
+			continue;
+		}
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					    stripe_index, 1, strip_size - 2);
+	}
+}
+static void
+test_raid5f_submit_partial_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_write_request);
+}
+
+static void
+__test_raid5f_submit_multi_chunk_read_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t stripe_index;
+
+	if (!r5f_info->partial_stripe_writes) {
+		return;
+	}
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+					    stripe_index, strip_size - 1, 2);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+					    stripe_index, strip_size - 1, strip_size + 1);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+					    stripe_index, 1, r5f_info->stripe_blocks - 1);
+
+		test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+					    stripe_index, 0, r5f_info->stripe_blocks);
+	}
+}
+static void
+test_raid5f_submit_multi_chunk_read_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_multi_chunk_read_request);
+}
+
 static void
 test_raid5f_submit_full_stripe_write_request_degraded(void)
 {
@@ -1115,6 +1356,65 @@ test_raid5f_submit_read_request_degraded(void)
 	run_for_each_raid5f_config(__test_raid5f_submit_read_request);
 }
 
+static void
+test_raid5f_submit_partial_write_request_degraded(void)
+{
+	g_test_degraded = true;
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_write_request);
+}
+
+static void
+test_raid5f_submit_multi_chunk_read_request_degraded(void)
+{
+	g_test_degraded = true;
+	run_for_each_raid5f_config(__test_raid5f_submit_multi_chunk_read_request);
+}
+
+static void
+test_raid5f_submit_partial_write_request_degraded_wide(void)
+{
+	struct raid_params params = {
+		.num_base_bdevs = 255,
+		.base_bdev_blockcnt = 64,
+		.base_bdev_blocklen = 512,
+		.strip_size = 2,
+		.md_type = RAID_PARAMS_MD_NONE,
+	};
+	struct raid5f_info *r5f_info;
+	struct raid_bdev_io_channel *raid_ch;
+	struct raid_bdev *raid_bdev;
+	uint32_t strip_size;
+	uint64_t stripe_index;
+
+	r5f_info = create_raid5f(&params);
+	raid_bdev = r5f_info->raid_bdev;
+	strip_size = raid_bdev->strip_size;
+	raid_ch = raid_test_create_io_channel(raid_bdev);
+	raid_ch->_base_channels[0] = NULL;
+
+	/* Find a stripe where the missing chunk holds data */
+	for (stripe_index = 0; stripe_index < r5f_info->total_stripes; stripe_index++) {
+		if (raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index) != 0) {
+			break;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(stripe_index < r5f_info->total_stripes);
+
+	/*
+	 * Write all data chunks but the missing one - too many xor sources for read-modify-write,
+	 * the old data of the missing chunk has to be reconstructed.
+	 */
+	test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, stripe_index,
+				    strip_size, r5f_info->stripe_blocks - strip_size);
+
+	/* The same with only a part of the range written in the first and last chunk */
+	test_raid5f_partial_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, stripe_index,
+				    strip_size + 1, r5f_info->stripe_blocks - strip_size - 2);
+
+	raid_test_destroy_io_channel(raid_ch);
+	delete_raid5f(r5f_info);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1133,6 +1433,11 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error_with_enomem);
 	CU_ADD_TEST(suite, test_raid5f_submit_full_stripe_write_request_degraded);
 	CU_ADD_TEST(suite, test_raid5f_submit_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_multi_chunk_read_request);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_submit_multi_chunk_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_write_request_degraded_wide);
 
 	allocate_threads(1);
 	set_thread(0);
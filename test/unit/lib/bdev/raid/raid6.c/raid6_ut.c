@@ -0,0 +1,886 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+#include "spdk/xor.h"
+
+#include "common/lib/ut_multithread.c"
+
+#include "bdev/raid/raid6.c"
+#include "../common.c"
+
+static void *g_accel_p = (void *)0xdeadbeaf;
+
+/* Contents of each base bdev's strip in the stripe under test */
+static void **g_chunk_bufs;
+static uint64_t g_stripe_index;
+static TAILQ_HEAD(, spdk_bdev_io) g_bdev_io_queue = TAILQ_HEAD_INITIALIZER(g_bdev_io_queue);
+static struct spdk_bdev *g_submit_error_bdev;
+static enum spdk_bdev_io_status g_io_status;
+static bool g_io_done;
+static int g_reconstruct_status;
+static bool g_reconstruct_done;
+static int g_pq_gen_enomem;
+static int g_pq_done;
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
+DEFINE_STUB(accel_channel_create, int, (void *io_device, void *ctx_buf), 0);
+DEFINE_STUB_V(accel_channel_destroy, (void *io_device, void *ctx_buf));
+DEFINE_STUB_V(raid_bdev_process_request_complete, (struct raid_bdev_process_request *process_req,
+		int status));
+DEFINE_STUB_V(raid_bdev_io_init, (struct raid_bdev_io *raid_io,
+				  struct raid_bdev_io_channel *raid_ch,
+				  enum spdk_bdev_io_type type, uint64_t offset_blocks,
+				  uint64_t num_blocks, struct iovec *iovs, int iovcnt, void *md_buf,
+				  struct spdk_memory_domain *memory_domain, void *memory_domain_ctx));
+DEFINE_STUB(raid_bdev_remap_dix_reftag, int, (void *md_buf, uint64_t num_blocks,
+		struct spdk_bdev *bdev, uint32_t remapped_offset), -1);
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(g_accel_p);
+}
+
+struct pq_ctx {
+	spdk_accel_completion_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+finish_pq_gen(void *_ctx)
+{
+	struct pq_ctx *ctx = _ctx;
+
+	ctx->cb_fn(ctx->cb_arg, 0);
+
+	free(ctx);
+}
+
+int
+spdk_accel_submit_pq_gen(struct spdk_io_channel *ch, void *p, void *q, void **sources,
+			 uint32_t nsrcs, uint64_t nbytes, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct pq_ctx *ctx;
+
+	if (g_pq_gen_enomem > 0) {
+		g_pq_gen_enomem--;
+		return -ENOMEM;
+	}
+
+	ctx = malloc(sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	SPDK_CU_ASSERT_FATAL(spdk_xor_gen_pq(p, q, sources, nsrcs, nbytes) == 0);
+
+	spdk_thread_send_msg(spdk_get_thread(), finish_pq_gen, ctx);
+
+	return 0;
+}
+
+static void
+init_accel(void)
+{
+	spdk_io_device_register(g_accel_p, accel_channel_create, accel_channel_destroy,
+				sizeof(int), "accel_p");
+}
+
+static void
+fini_accel(void)
+{
+	spdk_io_device_unregister(g_accel_p, NULL);
+}
+
+static int
+test_suite_init(void)
+{
+	uint8_t num_base_bdevs_values[] = { 4, 5, 6 };
+	uint64_t base_bdev_blockcnt_values[] = { 1, 1024 };
+	uint32_t base_bdev_blocklen_values[] = { 512, 4096 };
+	uint32_t strip_size_kb_values[] = { 1, 4 };
+	enum raid_params_md_type md_type_values[] = { RAID_PARAMS_MD_NONE, RAID_PARAMS_MD_INTERLEAVED };
+	uint8_t *num_base_bdevs;
+	uint64_t *base_bdev_blockcnt;
+	uint32_t *base_bdev_blocklen;
+	uint32_t *strip_size_kb;
+	enum raid_params_md_type *md_type;
+	uint64_t params_count;
+	int rc;
+
+	params_count = SPDK_COUNTOF(num_base_bdevs_values) *
+		       SPDK_COUNTOF(base_bdev_blockcnt_values) *
+		       SPDK_COUNTOF(base_bdev_blocklen_values) *
+		       SPDK_COUNTOF(strip_size_kb_values) *
+		       SPDK_COUNTOF(md_type_values);
+	rc = raid_test_params_alloc(params_count);
+	if (rc) {
+		return rc;
+	}
+
+	ARRAY_FOR_EACH(num_base_bdevs_values, num_base_bdevs) {
+		ARRAY_FOR_EACH(base_bdev_blockcnt_values, base_bdev_blockcnt) {
+			ARRAY_FOR_EACH(base_bdev_blocklen_values, base_bdev_blocklen) {
+				ARRAY_FOR_EACH(strip_size_kb_values, strip_size_kb) {
+					ARRAY_FOR_EACH(md_type_values, md_type) {
+						struct raid_params params = {
+							.num_base_bdevs = *num_base_bdevs,
+							.base_bdev_blockcnt = *base_bdev_blockcnt,
+							.base_bdev_blocklen = *base_bdev_blocklen,
+							.strip_size = *strip_size_kb * 1024 / *base_bdev_blocklen,
+							.md_type = *md_type,
+						};
+						if (params.strip_size == 0 ||
+						    params.strip_size > params.base_bdev_blockcnt) {
+							continue;
+						}
+						raid_test_params_add(&params);
+					}
+				}
+			}
+		}
+	}
+
+	init_accel();
+
+	return 0;
+}
+
+static int
+test_suite_cleanup(void)
+{
+	fini_accel();
+	raid_test_params_free();
+	return 0;
+}
+
+static void
+test_setup(void)
+{
+	g_submit_error_bdev = NULL;
+}
+
+static struct raid6_info *
+create_raid6(struct raid_params *params)
+{
+	struct raid_bdev *raid_bdev = raid_test_create_raid_bdev(params, &g_raid6_module);
+
+	SPDK_CU_ASSERT_FATAL(raid6_start(raid_bdev) == 0);
+
+	return raid_bdev->module_private;
+}
+
+static void
+delete_raid6(struct raid6_info *r6_info)
+{
+	struct raid_bdev *raid_bdev = r6_info->raid_bdev;
+
+	raid6_stop(raid_bdev);
+
+	raid_test_delete_raid_bdev(raid_bdev);
+}
+
+static void
+test_raid6_start(void)
+{
+	struct raid_params *params;
+	struct raid_params md_separate_params;
+	struct raid_bdev *raid_bdev;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6_info;
+
+		r6_info = create_raid6(params);
+
+		SPDK_CU_ASSERT_FATAL(r6_info != NULL);
+
+		CU_ASSERT_EQUAL(r6_info->stripe_blocks, params->strip_size * (params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6_info->total_stripes, params->base_bdev_blockcnt / params->strip_size);
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.blockcnt,
+				(params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size) *
+				(params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
+		CU_ASSERT_TRUE(r6_info->raid_bdev->bdev.split_on_optimal_io_boundary);
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.write_unit_size, r6_info->stripe_blocks);
+		CU_ASSERT_TRUE(r6_info->raid_bdev->bdev.split_on_write_unit);
+
+		delete_raid6(r6_info);
+	}
+
+	/* Separate metadata is not supported */
+	md_separate_params = g_params[0];
+	md_separate_params.md_type = RAID_PARAMS_MD_SEPARATE;
+	raid_bdev = raid_test_create_raid_bdev(&md_separate_params, &g_raid6_module);
+	CU_ASSERT(raid6_start(raid_bdev) == -EINVAL);
+	raid_test_delete_raid_bdev(raid_bdev);
+}
+
+void
+raid_bdev_queue_io_wait(struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+			struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn)
+{
+	CU_FAIL("unexpected io wait");
+}
+
+void
+raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	CU_ASSERT(!g_io_done);
+	g_io_status = status;
+	g_io_done = true;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static int
+submit_io(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, struct iovec *iov, int iovcnt,
+	  uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+	  bool write)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	struct raid_base_bdev_info *base_info = bdev->ctxt;
+	struct raid_bdev *raid_bdev = base_info->raid_bdev;
+	uint8_t idx = raid_bdev_base_bdev_slot(base_info);
+	struct spdk_bdev_io *bdev_io;
+	struct iovec buf;
+
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	CU_ASSERT(offset_blocks >> raid_bdev->strip_size_shift == g_stripe_index);
+
+	if (bdev == g_submit_error_bdev) {
+		return -EINVAL;
+	}
+
+	buf.iov_base = g_chunk_bufs[idx] + (offset_blocks % raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+	buf.iov_len = num_blocks * raid_bdev->bdev.blocklen;
+
+	if (write) {
+		spdk_iovcpy(iov, iovcnt, &buf, 1);
+	} else {
+		spdk_iovcpy(&buf, 1, iov, iovcnt);
+	}
+
+	bdev_io = calloc(1, sizeof(*bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = bdev;
+	bdev_io->internal.cb = cb;
+	bdev_io->internal.caller_ctx = cb_arg;
+
+	TAILQ_INSERT_TAIL(&g_bdev_io_queue, bdev_io, internal.link);
+
+	return 0;
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			    uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			    struct spdk_bdev_ext_io_opts *opts)
+{
+	CU_ASSERT_PTR_NULL(opts->memory_domain);
+	CU_ASSERT_PTR_NULL(opts->metadata);
+
+	return submit_io(desc, ch, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, true);
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			   uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	CU_ASSERT_PTR_NULL(opts->memory_domain);
+	CU_ASSERT_PTR_NULL(opts->metadata);
+
+	return submit_io(desc, ch, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg, false);
+}
+
+static void
+process_io_completions(void)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	poll_threads();
+
+	while ((bdev_io = TAILQ_FIRST(&g_bdev_io_queue))) {
+		TAILQ_REMOVE(&g_bdev_io_queue, bdev_io, internal.link);
+		bdev_io->internal.cb(bdev_io, true, bdev_io->internal.caller_ctx);
+
+		poll_threads();
+	}
+}
+
+static uint8_t
+gf_mul_ref(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+
+	while (b) {
+		if (b & 1) {
+			r ^= a;
+		}
+		a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+		b >>= 1;
+	}
+
+	return r;
+}
+
+/* Fill the data chunks of the stripe with a pattern and calculate P and Q in a naive way */
+static void
+init_stripe(struct raid_bdev *raid_bdev, uint64_t stripe_index, void *data)
+{
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	uint8_t p_idx = raid6_stripe_p_chunk_index(raid_bdev, stripe_index);
+	uint8_t q_idx = raid6_stripe_q_chunk_index(raid_bdev, stripe_index);
+	uint8_t *p = g_chunk_bufs[p_idx];
+	uint8_t *q = g_chunk_bufs[q_idx];
+	uint8_t coef = 1;
+	uint8_t d;
+	size_t i;
+
+	for (i = 0; i < strip_len * raid6_stripe_data_chunks_num(raid_bdev); i++) {
+		((uint8_t *)data)[i] = rand();
+	}
+
+	memset(p, 0, strip_len);
+	memset(q, 0, strip_len);
+
+	for (d = 0; d < raid6_stripe_data_chunks_num(raid_bdev); d++) {
+		uint8_t idx = raid6_stripe_data_chunk_index(raid_bdev, stripe_index, d);
+		uint8_t *src = data + d * strip_len;
+
+		CU_ASSERT(idx != p_idx && idx != q_idx);
+		memcpy(g_chunk_bufs[idx], src, strip_len);
+
+		for (i = 0; i < strip_len; i++) {
+			p[i] ^= src[i];
+			q[i] ^= gf_mul_ref(coef, src[i]);
+		}
+		coef = gf_mul_ref(coef, 2);
+	}
+}
+
+static void
+alloc_chunk_bufs(struct raid_bdev *raid_bdev)
+{
+	uint8_t i;
+
+	g_chunk_bufs = calloc(raid_bdev->num_base_bdevs, sizeof(*g_chunk_bufs));
+	SPDK_CU_ASSERT_FATAL(g_chunk_bufs != NULL);
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		g_chunk_bufs[i] = malloc(raid_bdev->strip_size * raid_bdev->bdev.blocklen);
+		SPDK_CU_ASSERT_FATAL(g_chunk_bufs[i] != NULL);
+	}
+}
+
+static void
+free_chunk_bufs(struct raid_bdev *raid_bdev)
+{
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		free(g_chunk_bufs[i]);
+	}
+	free(g_chunk_bufs);
+	g_chunk_bufs = NULL;
+}
+
+static void
+set_iovs(struct iovec *iovs, int iovcnt, void *buf, size_t len)
+{
+	size_t iov_len = len / iovcnt;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		iovs[i].iov_base = buf + i * iov_len;
+		iovs[i].iov_len = iov_len;
+	}
+	iovs[iovcnt - 1].iov_len += len - iov_len * iovcnt;
+}
+
+static void
+submit_rw_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+		  enum spdk_bdev_io_type io_type, uint64_t offset_blocks, uint64_t num_blocks,
+		  void *buf)
+{
+	struct raid_bdev_io raid_io;
+	struct iovec iovs[3];
+
+	set_iovs(iovs, SPDK_COUNTOF(iovs), buf, num_blocks * raid_bdev->bdev.blocklen);
+
+	raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, io_type, offset_blocks, num_blocks,
+			       iovs, SPDK_COUNTOF(iovs), NULL);
+
+	g_io_done = false;
+	raid6_submit_rw_request(&raid_io);
+	process_io_completions();
+
+	CU_ASSERT(g_io_done);
+}
+
+static void
+run_for_each_raid6_config(void (*test_fn)(struct raid_bdev *raid_bdev,
+			  struct raid_bdev_io_channel *raid_ch))
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6_info;
+		struct raid_bdev_io_channel *raid_ch;
+
+		r6_info = create_raid6(params);
+		raid_ch = raid_test_create_io_channel(r6_info->raid_bdev);
+		alloc_chunk_bufs(r6_info->raid_bdev);
+
+		test_fn(r6_info->raid_bdev, raid_ch);
+
+		free_chunk_bufs(r6_info->raid_bdev);
+		raid_test_destroy_io_channel(raid_ch);
+		delete_raid6(r6_info);
+	}
+}
+
+#define RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, i) \
+	for (i = 0; i < spdk_min(raid_bdev->num_base_bdevs, ((struct raid6_info *)raid_bdev->module_private)->total_stripes); i++)
+
+/* Iterate over all combinations of up to two missing base bdevs, a == b means one missing */
+#define RAID6_TEST_FOR_EACH_MISSING(raid_bdev, a, b) \
+	for (a = 0; a < raid_bdev->num_base_bdevs; a++) \
+		for (b = a; b < raid_bdev->num_base_bdevs; b++)
+
+static void
+set_missing(struct raid_bdev_io_channel *raid_ch, uint8_t a, uint8_t b, bool missing)
+{
+	raid_ch->_base_channels[a] = missing ? NULL : (void *)1;
+	raid_ch->_base_channels[b] = missing ? NULL : (void *)1;
+}
+
+static void
+__test_raid6_submit_full_stripe_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch, bool degraded)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	uint8_t n = raid_bdev->num_base_bdevs;
+	void *data, *reference[n];
+	uint64_t stripe_index;
+	uint8_t a, b, i;
+
+	data = malloc(r6_info->stripe_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(data != NULL);
+	for (i = 0; i < n; i++) {
+		reference[i] = malloc(strip_len);
+		SPDK_CU_ASSERT_FATAL(reference[i] != NULL);
+	}
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		g_stripe_index = stripe_index;
+
+		/* Calculate the expected on-disk contents of the stripe */
+		init_stripe(raid_bdev, stripe_index, data);
+		for (i = 0; i < n; i++) {
+			memcpy(reference[i], g_chunk_bufs[i], strip_len);
+		}
+
+		RAID6_TEST_FOR_EACH_MISSING(raid_bdev, a, b) {
+			if (!degraded && (a != 0 || b != 0)) {
+				continue;
+			}
+
+			for (i = 0; i < n; i++) {
+				memset(g_chunk_bufs[i], 0xa5, strip_len);
+			}
+			if (degraded) {
+				set_missing(raid_ch, a, b, true);
+			}
+
+			submit_rw_request(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					  stripe_index * r6_info->stripe_blocks, r6_info->stripe_blocks, data);
+			CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+			for (i = 0; i < n; i++) {
+				if (degraded && (i == a || i == b)) {
+					continue;
+				}
+				CU_ASSERT(memcmp(g_chunk_bufs[i], reference[i], strip_len) == 0);
+			}
+
+			if (degraded) {
+				set_missing(raid_ch, a, b, false);
+			}
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		free(reference[i]);
+	}
+	free(data);
+}
+
+static void
+_test_raid6_submit_full_stripe_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	__test_raid6_submit_full_stripe_write_request(raid_bdev, raid_ch, false);
+}
+
+static void
+test_raid6_submit_full_stripe_write_request(void)
+{
+	run_for_each_raid6_config(_test_raid6_submit_full_stripe_write_request);
+}
+
+static void
+_test_raid6_submit_full_stripe_write_request_degraded(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	__test_raid6_submit_full_stripe_write_request(raid_bdev, raid_ch, true);
+}
+
+static void
+test_raid6_submit_full_stripe_write_request_degraded(void)
+{
+	run_for_each_raid6_config(_test_raid6_submit_full_stripe_write_request_degraded);
+}
+
+static void
+test_raid6_read_chunk(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+		      uint64_t stripe_index, uint8_t data_idx, void *data)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t offsets[] = { 0, 0, strip_size - 1, 1 };
+	uint64_t lengths[] = { 1, strip_size, 1, strip_size - 2 };
+	uint64_t stripe_offset;
+	void *buf;
+	size_t i;
+
+	buf = malloc(strip_size * blocklen);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	for (i = 0; i < SPDK_COUNTOF(offsets); i++) {
+		if (lengths[i] == 0 || lengths[i] > strip_size) {
+			continue;
+		}
+		stripe_offset = data_idx * strip_size + offsets[i];
+
+		memset(buf, 0, strip_size * blocklen);
+		submit_rw_request(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+				  stripe_index * r6_info->stripe_blocks + stripe_offset, lengths[i], buf);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(memcmp(buf, data + stripe_offset * blocklen, lengths[i] * blocklen) == 0);
+	}
+
+	free(buf);
+}
+
+static void
+__test_raid6_submit_read_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+				 bool degraded)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	uint64_t stripe_index;
+	void *data;
+	uint8_t a, b, d;
+
+	data = malloc(r6_info->stripe_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(data != NULL);
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		g_stripe_index = stripe_index;
+		init_stripe(raid_bdev, stripe_index, data);
+
+		RAID6_TEST_FOR_EACH_MISSING(raid_bdev, a, b) {
+			if (!degraded && (a != 0 || b != 0)) {
+				continue;
+			}
+
+			if (degraded) {
+				set_missing(raid_ch, a, b, true);
+			}
+
+			for (d = 0; d < raid6_stripe_data_chunks_num(raid_bdev); d++) {
+				test_raid6_read_chunk(raid_bdev, raid_ch, stripe_index, d, data);
+			}
+
+			if (degraded) {
+				set_missing(raid_ch, a, b, false);
+			}
+		}
+	}
+
+	free(data);
+}
+
+static void
+_test_raid6_submit_read_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	__test_raid6_submit_read_request(raid_bdev, raid_ch, false);
+}
+
+static void
+test_raid6_submit_read_request(void)
+{
+	run_for_each_raid6_config(_test_raid6_submit_read_request);
+}
+
+static void
+_test_raid6_submit_read_request_degraded(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	__test_raid6_submit_read_request(raid_bdev, raid_ch, true);
+}
+
+static void
+test_raid6_submit_read_request_degraded(void)
+{
+	run_for_each_raid6_config(_test_raid6_submit_read_request_degraded);
+}
+
+static void
+reconstruct_done(struct stripe_request *stripe_req, int status)
+{
+	raid6_stripe_request_release(stripe_req);
+
+	g_reconstruct_status = status;
+	g_reconstruct_done = true;
+}
+
+static void
+_test_raid6_reconstruct_chunk(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	struct raid_bdev_io raid_io;
+	uint64_t stripe_index;
+	struct iovec iov;
+	void *data, *buf;
+	uint8_t target, other;
+	int ret;
+
+	data = malloc(r6_info->stripe_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(data != NULL);
+	buf = malloc(strip_len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		g_stripe_index = stripe_index;
+		init_stripe(raid_bdev, stripe_index, data);
+
+		/* Rebuild each chunk (data, P or Q), optionally with another member missing */
+		RAID6_TEST_FOR_EACH_MISSING(raid_bdev, target, other) {
+			uint8_t t, o;
+
+			for (t = 0; t < 2; t++) {
+				uint8_t tgt = t ? other : target;
+				uint8_t oth = t ? target : other;
+
+				if (t == 1 && target == other) {
+					break;
+				}
+
+				for (o = 0; o < 2; o++) {
+					set_missing(raid_ch, tgt, o ? oth : tgt, true);
+
+					memset(buf, 0, strip_len);
+					iov.iov_base = buf;
+					iov.iov_len = strip_len;
+					raid_test_bdev_io_init(&raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+							       stripe_index * r6_info->stripe_blocks,
+							       raid_bdev->strip_size, &iov, 1, NULL);
+
+					g_reconstruct_done = false;
+					ret = raid6_submit_reconstruct_read(&raid_io, stripe_index, tgt, 0,
+									    reconstruct_done);
+					CU_ASSERT(ret == 0);
+					process_io_completions();
+
+					CU_ASSERT(g_reconstruct_done);
+					CU_ASSERT(g_reconstruct_status == 0);
+					CU_ASSERT(memcmp(buf, g_chunk_bufs[tgt], strip_len) == 0);
+
+					set_missing(raid_ch, tgt, o ? oth : tgt, false);
+				}
+			}
+		}
+	}
+
+	free(buf);
+	free(data);
+}
+
+static void
+test_raid6_reconstruct_chunk(void)
+{
+	run_for_each_raid6_config(_test_raid6_reconstruct_chunk);
+}
+
+static void
+_test_raid6_chunk_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	struct raid6_io_channel *r6ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct stripe_request *stripe_req;
+	struct raid_base_bdev_info *base_info;
+	uint64_t stripe_index = 0;
+	size_t free_cnt = 0;
+	void *data;
+
+	data = malloc(r6_info->stripe_blocks * raid_bdev->bdev.blocklen);
+	SPDK_CU_ASSERT_FATAL(data != NULL);
+
+	g_stripe_index = stripe_index;
+	init_stripe(raid_bdev, stripe_index, data);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		g_submit_error_bdev = spdk_bdev_desc_get_bdev(base_info->desc);
+
+		submit_rw_request(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+				  stripe_index * r6_info->stripe_blocks, r6_info->stripe_blocks, data);
+		CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	}
+	g_submit_error_bdev = NULL;
+
+	/* All stripe requests should be back on the free list */
+	TAILQ_FOREACH(stripe_req, &r6ch->free_stripe_requests.write, link) {
+		free_cnt++;
+	}
+	CU_ASSERT(free_cnt == RAID6_MAX_STRIPES);
+
+	free(data);
+}
+
+static void
+test_raid6_chunk_write_error(void)
+{
+	run_for_each_raid6_config(_test_raid6_chunk_write_error);
+}
+
+static void
+pq_stripe_done(struct stripe_request *stripe_req, int status)
+{
+	CU_ASSERT(status == 0);
+	g_pq_done++;
+}
+
+static void
+_test_raid6_pq_stripe_retry(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid6_io_channel *r6ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	uint8_t n = raid_bdev->num_base_bdevs;
+	struct stripe_request *stripe_reqs[2], *stripe_req;
+	struct raid_bdev_io raid_io[2] = {};
+	uint8_t *bufs[2][n], *p, *q, *src, coef;
+	struct chunk *chunk;
+	size_t j;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		stripe_req = TAILQ_FIRST(&r6ch->free_stripe_requests.write);
+		SPDK_CU_ASSERT_FATAL(stripe_req != NULL);
+		TAILQ_REMOVE(&r6ch->free_stripe_requests.write, stripe_req, link);
+
+		raid_io[i].raid_bdev = raid_bdev;
+		raid6_stripe_request_init(stripe_req, &raid_io[i], i);
+
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			bufs[i][chunk->index] = malloc(strip_len);
+			SPDK_CU_ASSERT_FATAL(bufs[i][chunk->index] != NULL);
+			for (j = 0; j < strip_len; j++) {
+				bufs[i][chunk->index][j] = rand();
+			}
+			chunk->iovs[0].iov_base = bufs[i][chunk->index];
+			chunk->iovs[0].iov_len = strip_len;
+			chunk->iovcnt = 1;
+		}
+		stripe_reqs[i] = stripe_req;
+	}
+
+	/* The first stripe waits for accel resources while the second one is calculated */
+	g_pq_done = 0;
+	g_pq_gen_enomem = 1;
+	raid6_pq_stripe(stripe_reqs[0], pq_stripe_done);
+	CU_ASSERT(TAILQ_FIRST(&r6ch->pq_retry_queue) == stripe_reqs[0]);
+	raid6_pq_stripe(stripe_reqs[1], pq_stripe_done);
+	poll_threads();
+	CU_ASSERT(g_pq_done == 2);
+	CU_ASSERT(TAILQ_EMPTY(&r6ch->pq_retry_queue));
+
+	/* Each stripe got the parity of its own data */
+	p = malloc(strip_len);
+	q = malloc(strip_len);
+	SPDK_CU_ASSERT_FATAL(p != NULL && q != NULL);
+	for (i = 0; i < 2; i++) {
+		stripe_req = stripe_reqs[i];
+		memset(p, 0, strip_len);
+		memset(q, 0, strip_len);
+		coef = 1;
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			src = bufs[i][chunk->index];
+			for (j = 0; j < strip_len; j++) {
+				p[j] ^= src[j];
+				q[j] ^= gf_mul_ref(coef, src[j]);
+			}
+			coef = gf_mul_ref(coef, 2);
+		}
+		CU_ASSERT(memcmp(p, bufs[i][stripe_req->p_chunk->index], strip_len) == 0);
+		CU_ASSERT(memcmp(q, bufs[i][stripe_req->q_chunk->index], strip_len) == 0);
+
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			free(bufs[i][chunk->index]);
+		}
+		TAILQ_INSERT_HEAD(&r6ch->free_stripe_requests.write, stripe_req, link);
+	}
+	free(p);
+	free(q);
+}
+
+static void
+test_raid6_pq_stripe_retry(void)
+{
+	run_for_each_raid6_config(_test_raid6_pq_stripe_retry);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite_with_setup_and_teardown("raid6", test_suite_init, test_suite_cleanup,
+			test_setup, NULL);
+	CU_ADD_TEST(suite, test_raid6_start);
+	CU_ADD_TEST(suite, test_raid6_submit_read_request);
+	CU_ADD_TEST(suite, test_raid6_submit_full_stripe_write_request);
+	CU_ADD_TEST(suite, test_raid6_chunk_write_error);
+	CU_ADD_TEST(suite, test_raid6_submit_full_stripe_write_request_degraded);
+	CU_ADD_TEST(suite, test_raid6_submit_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid6_reconstruct_chunk);
+	CU_ADD_TEST(suite, test_raid6_pq_stripe_retry);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
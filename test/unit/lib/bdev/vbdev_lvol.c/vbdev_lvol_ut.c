@@ -18,6 +18,7 @@ int g_lvolerrno;
 int g_lvserrno;
 int g_cluster_size;
 int g_num_clusters = 0;
+uint32_t g_sub_cluster_sz = 0;
 int g_registered_bdevs;
 int g_num_lvols = 0;
 int g_lvol_open_enomem = -1;
@@ -838,15 +839,16 @@ _lvol_create(struct spdk_lvol_store *lvs)
 }
 
 int
-spdk_lvol_create(struct spdk_lvol_store *lvs, const char *name, size_t sz,
-		 bool thin_provision, enum lvol_clear_method clear_method, spdk_lvol_op_with_handle_complete cb_fn,
-		 void *cb_arg)
+spdk_lvol_create_ext(struct spdk_lvol_store *lvs, const char *name, uint64_t sz,
+		     bool thin_provision, enum lvol_clear_method clear_method, uint32_t sub_cluster_sz,
+		     spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol *lvol;
 
 	lvol = _lvol_create(lvs);
 	snprintf(lvol->name, sizeof(lvol->name), "%s", name);
 	g_num_clusters = spdk_divide_round_up(sz, spdk_bs_get_cluster_size(lvol->lvol_store->blobstore));
+	g_sub_cluster_sz = sub_cluster_sz;
 	cb_fn(cb_arg, lvol, 0);
 
 	return 0;
@@ -864,13 +866,14 @@ spdk_lvol_create_snapshot(struct spdk_lvol *lvol, const char *snapshot_name,
 }
 
 void
-spdk_lvol_create_clone(struct spdk_lvol *lvol, const char *clone_name,
-		       spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
+spdk_lvol_create_clone_ext(struct spdk_lvol *lvol, const char *clone_name, uint32_t sub_cluster_sz,
+			   spdk_lvol_op_with_handle_complete cb_fn, void *cb_arg)
 {
 	struct spdk_lvol *clone;
 
 	clone = _lvol_create(lvol->lvol_store);
 	snprintf(clone->name, sizeof(clone->name), "%s", clone_name);
+	g_sub_cluster_sz = sub_cluster_sz;
 	cb_fn(cb_arg, clone, 0);
 }
 
@@ -1134,6 +1137,7 @@ ut_lvol_clone(void)
 	SPDK_CU_ASSERT_FATAL(rc == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
 	CU_ASSERT(g_lvolerrno == 0);
+	CU_ASSERT(g_sub_cluster_sz == 0);
 
 	lvol = g_lvol;
 
@@ -1145,12 +1149,13 @@ ut_lvol_clone(void)
 
 	snap = g_lvol;
 
-	/* Successful clone create */
-	vbdev_lvol_create_clone(snap, "clone", vbdev_lvol_create_complete, NULL);
+	/* Successful clone create, with its own sub-cluster size */
+	vbdev_lvol_create_clone_ext(snap, "clone", 16 * 1024, vbdev_lvol_create_complete, NULL);
 
 	SPDK_CU_ASSERT_FATAL(rc == 0);
 	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
 	CU_ASSERT(g_lvolerrno == 0);
+	CU_ASSERT(g_sub_cluster_sz == 16 * 1024);
 
 	clone = g_lvol;
 
@@ -4359,16 +4359,6 @@ blob_insert_cluster_msg_test(void)
 	struct spdk_blob_store *bs = g_bs;
 	struct spdk_blob *blob;
 	struct spdk_blob_opts opts;
-	/* For now, even if md_page_size is > 4KB, we still only use the first
-	 * 4KB of it. The rest is left unused. Future changes may allow using the
-	 * rest of the md_page, but that will require more extensive changes since
-	 * then the struct spdk_blob_md_page cannot be used directly (since some
-	 * fields such as crc would have variable placement in the struct).
-	 */
-	struct {
-		struct spdk_blob_md_page page;
-		uint8_t pad[DEV_MAX_PHYS_BLOCKLEN - sizeof(struct spdk_blob_md_page)];
-	} md = {};
 	spdk_blob_id blobid;
 	uint64_t free_clusters;
 	uint64_t new_cluster = 0;
@@ -4398,8 +4388,8 @@ blob_insert_cluster_msg_test(void)
 	CU_ASSERT(blob->active.clusters[cluster_num] == 0);
 	spdk_spin_unlock(&bs->used_lock);
 
-	blob_insert_cluster_on_md_thread(blob, cluster_num, new_cluster, extent_page, &md.page,
-					 blob_op_complete, NULL);
+	blob_insert_cluster_persist(blob, NULL, cluster_num, new_cluster, 0, extent_page, NULL,
+				    blob_op_complete, NULL);
 	poll_threads();
 
 	CU_ASSERT(blob->active.clusters[cluster_num] != 0);
@@ -4526,6 +4516,432 @@ blob_thin_prov_rw(void)
 	g_blobid = 0;
 }
 
+static void
+blob_thin_prov_reserve_clusters(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *thick_blob;
+	struct spdk_io_channel *channel0, *channel1;
+	struct spdk_bs_channel *ch0, *ch1;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters, cluster0, cluster1;
+	uint64_t io_units_per_cluster;
+	uint32_t batch, i;
+	uint8_t payload[BLOCKLEN];
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	io_units_per_cluster = bs->io_units_per_cluster;
+	memset(payload, 0xE5, sizeof(payload));
+
+	channel0 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel0 != NULL);
+	ch0 = spdk_io_channel_get_ctx(channel0);
+
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	ch1 = spdk_io_channel_get_ctx(channel1);
+	set_thread(0);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = free_clusters;
+	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	/* First write reserves a batch of clusters for the channel and uses the first one.
+	 * Reserved clusters are still reported as free.
+	 */
+	spdk_blob_io_write(blob, channel0, payload, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	batch = spdk_min(free_clusters / SPDK_BS_CHANNEL_CLUSTER_BATCH, SPDK_BS_CHANNEL_CLUSTER_BATCH);
+	SPDK_CU_ASSERT_FATAL(batch > 1);
+	CU_ASSERT(ch0->num_cached_clusters == batch);
+	CU_ASSERT(ch0->cluster_cache_idx == 1);
+	CU_ASSERT(bs->num_reserved_clusters == batch - 1);
+	CU_ASSERT(free_clusters - 1 == spdk_bs_free_cluster_count(bs));
+	cluster0 = bs_lba_to_cluster(bs, blob->active.clusters[0]);
+	CU_ASSERT(cluster0 == ch0->cluster_cache[0]);
+
+	/* The next first write on the same channel uses the next reserved cluster. */
+	spdk_blob_io_write(blob, channel0, payload, io_units_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ch0->cluster_cache_idx == 2);
+	CU_ASSERT(bs_lba_to_cluster(bs, blob->active.clusters[1]) == ch0->cluster_cache[1]);
+	CU_ASSERT(free_clusters - 2 == spdk_bs_free_cluster_count(bs));
+
+	/* Another channel reserves its own batch. */
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, 2 * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(ch1->cluster_cache_idx == 1);
+	cluster1 = bs_lba_to_cluster(bs, blob->active.clusters[2]);
+	CU_ASSERT(cluster1 == ch1->cluster_cache[0]);
+	for (i = 0; i < ch0->num_cached_clusters; i++) {
+		CU_ASSERT(ch0->cluster_cache[i] != cluster1);
+	}
+	CU_ASSERT(free_clusters - 3 == spdk_bs_free_cluster_count(bs));
+	set_thread(0);
+
+	/* Use up all clusters which are not reserved. */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = bs->num_free_clusters;
+	thick_blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(bs->num_free_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == bs->num_reserved_clusters);
+
+	/* Once channel 1 runs out of reserved clusters, the clusters reserved by channel 0
+	 * are reclaimed for it.
+	 */
+	set_thread(1);
+	for (i = 3; ch1->cluster_cache_idx < ch1->num_cached_clusters; i++) {
+		spdk_blob_io_write(blob, channel1, payload, i * io_units_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	spdk_blob_io_write(blob, channel1, payload, i * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.clusters[i] != 0);
+	CU_ASSERT(ch0->cluster_cache_idx == ch0->num_cached_clusters);
+
+	/* Use up the remaining clusters. Then allocation fails without reclaiming again. */
+	while (spdk_bs_free_cluster_count(bs) > 0) {
+		i++;
+		spdk_blob_io_write(blob, channel1, payload, i * io_units_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	i++;
+	spdk_blob_io_write(blob, channel1, payload, i * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOSPC);
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+	set_thread(0);
+
+	ut_blob_close_and_delete(bs, thick_blob);
+
+	/* Clusters reserved by channels are not persisted as used when the blobstore is
+	 * unloaded.
+	 */
+	spdk_blob_io_write(blob, channel0, payload, (i + 1) * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_reserved_clusters > 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	set_thread(1);
+	spdk_bs_free_io_channel(channel1);
+	set_thread(0);
+	poll_threads();
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+
+	spdk_bs_free_io_channel(channel0);
+	poll_threads();
+
+	spdk_bs_load(init_dev(), NULL, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+blob_thick_reclaim_reserved_clusters(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *thick_blob;
+	struct spdk_io_channel *channel0, *channel1;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters, io_units_per_cluster;
+	uint8_t payload[BLOCKLEN];
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	io_units_per_cluster = bs->io_units_per_cluster;
+	memset(payload, 0xE5, sizeof(payload));
+
+	channel0 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel0 != NULL);
+
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	set_thread(0);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = free_clusters;
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	/* Both channels reserve clusters with their first write */
+	spdk_blob_io_write(blob, channel0, payload, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, io_units_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	set_thread(0);
+	CU_ASSERT(bs->num_reserved_clusters > 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	CU_ASSERT(free_clusters > bs->num_free_clusters);
+
+	/* A thick blob can use all clusters reported as free, the reservations are returned */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = free_clusters;
+	thick_blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+	ut_blob_close_and_delete(bs, thick_blob);
+
+	/* Reserve clusters again */
+	spdk_blob_io_write(blob, channel0, payload, 2 * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_reserved_clusters > 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	/* Same when resizing a thick blob */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 1;
+	thick_blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 1);
+
+	spdk_blob_resize(thick_blob, free_clusters + 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOSPC);
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+	CU_ASSERT(spdk_blob_get_num_clusters(thick_blob) == 1);
+
+	spdk_blob_resize(thick_blob, free_clusters, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_clusters(thick_blob) == free_clusters);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+
+	ut_blob_close_and_delete(bs, thick_blob);
+	ut_blob_close_and_delete(bs, blob);
+
+	set_thread(1);
+	spdk_bs_free_io_channel(channel1);
+	set_thread(0);
+	spdk_bs_free_io_channel(channel0);
+	poll_threads();
+}
+
+static void
+blob_thin_prov_write_md_overlap(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel0, *channel1;
+	struct spdk_blob_ep_flush *flush;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid;
+	uint64_t io_units_per_cluster, offset;
+	uint8_t payload[BLOCKLEN];
+	uint8_t payload_read[BLOCKLEN];
+	int bserrno0, bserrno1;
+
+	io_units_per_cluster = bs->io_units_per_cluster;
+	memset(payload, 0xA5, sizeof(payload));
+
+	channel0 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel0 != NULL);
+
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	set_thread(0);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* The first write to a cluster is issued as soon as the cluster is in the in-memory
+	 * cluster map, before its metadata is persisted. It completes only once both are done.
+	 */
+	g_bserrno = -1;
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, 0, 1, blob_op_complete, NULL);
+	set_thread(0);
+	CU_ASSERT(blob->active.clusters[0] == 0);
+
+	/* Insert the cluster on the md thread, which starts persisting the metadata. */
+	poll_thread_times(0, 1);
+	SPDK_CU_ASSERT_FATAL(blob->active.clusters[0] != 0);
+	offset = blob->active.clusters[0] * bs->dev->blocklen;
+	CU_ASSERT(memcmp(&g_dev_buffer[offset], payload, sizeof(payload)) != 0);
+
+	/* The data write is issued and completes while the metadata write is outstanding. */
+	poll_thread(1);
+	CU_ASSERT(memcmp(&g_dev_buffer[offset], payload, sizeof(payload)) == 0);
+	CU_ASSERT(g_bserrno == -1);
+
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Cluster insertions to the same extent page are persisted by a single write,
+	 * when they arrive while a write of that page is in progress.
+	 */
+	bserrno0 = bserrno1 = -1;
+	spdk_blob_io_write(blob, channel0, payload, io_units_per_cluster, 1,
+			   blob_op_complete, &bserrno0);
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, 2 * io_units_per_cluster, 1,
+			   blob_op_complete, &bserrno1);
+	set_thread(0);
+
+	poll_thread_times(0, 2);
+	CU_ASSERT(blob->active.clusters[1] != 0);
+	CU_ASSERT(blob->active.clusters[2] != 0);
+	if (blob->use_extent_table) {
+		flush = TAILQ_FIRST(&blob->ep_flushes);
+		SPDK_CU_ASSERT_FATAL(flush != NULL);
+		CU_ASSERT(TAILQ_NEXT(flush, link) == NULL);
+		CU_ASSERT(!TAILQ_EMPTY(&flush->writing));
+		CU_ASSERT(!TAILQ_EMPTY(&flush->queued));
+	}
+
+	poll_threads();
+	CU_ASSERT(bserrno0 == 0);
+	CU_ASSERT(bserrno1 == 0);
+	CU_ASSERT(TAILQ_EMPTY(&blob->ep_flushes));
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	set_thread(1);
+	spdk_bs_free_io_channel(channel1);
+	set_thread(0);
+	spdk_bs_free_io_channel(channel0);
+	poll_threads();
+
+	/* All three clusters and their data are persisted. */
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	channel0 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel0 != NULL);
+
+	CU_ASSERT(blob->active.num_allocated_clusters == 3);
+	for (offset = 0; offset < 3; offset++) {
+		memset(payload_read, 0, sizeof(payload_read));
+		spdk_blob_io_read(blob, channel0, payload_read, offset * io_units_per_cluster, 1,
+				  blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_read, payload, sizeof(payload)) == 0);
+	}
+
+	spdk_bs_free_io_channel(channel0);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	g_bs = bs;
+}
+
+static void
+blob_thin_prov_write_in_place(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel1;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid;
+	uint64_t io_units_per_cluster;
+	uint8_t payload[BLOCKLEN];
+	int bserrno1;
+
+	io_units_per_cluster = bs->io_units_per_cluster;
+	memset(payload, 0xA5, sizeof(payload));
+
+	set_thread(1);
+	channel1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel1 != NULL);
+	set_thread(0);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* The first write allocates the extent page, which is done on the md thread. */
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, 0, 1, blob_op_complete, &bserrno1);
+	set_thread(0);
+	poll_threads();
+	CU_ASSERT(bserrno1 == 0);
+
+	/* Clusters inserted into an existing extent page are persisted on the allocating
+	 * thread, without involving the md thread.
+	 */
+	bserrno1 = -1;
+	set_thread(1);
+	spdk_blob_io_write(blob, channel1, payload, io_units_per_cluster, 1,
+			   blob_op_complete, &bserrno1);
+	poll_thread(1);
+	if (blob->use_extent_table) {
+		CU_ASSERT(bserrno1 == 0);
+		CU_ASSERT(blob->active.clusters[1] != 0);
+		CU_ASSERT(TAILQ_EMPTY(&blob->ep_flushes));
+	}
+	set_thread(0);
+	poll_threads();
+	CU_ASSERT(bserrno1 == 0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	set_thread(1);
+	spdk_bs_free_io_channel(channel1);
+	set_thread(0);
+	poll_threads();
+
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->active.num_allocated_clusters == 2);
+
+	ut_blob_close_and_delete(bs, blob);
+	g_bs = bs;
+}
+
 static void
 blob_thin_prov_write_count_io(void)
 {
@@ -4682,10 +5098,206 @@ blob_thin_prov_write_count_io(void)
 }
 
 static void
-blob_thin_prov_unmap_cluster(void)
+blob_ep_on_demand(void)
 {
 	struct spdk_blob_store *bs;
-	struct spdk_blob *blob, *snapshot;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	struct spdk_bs_extent_page_cache_stats stats;
+	spdk_blob_id blobid;
+	uint8_t payload_write[BLOCKLEN];
+	uint8_t payload_read[BLOCKLEN];
+	uint8_t zero[BLOCKLEN];
+	const uint32_t CLUSTER_SZ = g_phys_blocklen * 4;
+	uint64_t io_units_per_cluster;
+	uint64_t io_units_per_extent_page;
+	uint64_t free_clusters;
+	uint64_t offsets[3];
+	uint32_t i;
+
+	/* Use a small cluster size, so that the blob needs several extent pages, and keep
+	 * only one of them in memory.
+	 */
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = CLUSTER_SZ;
+	bs_opts.extent_page_cache_size = 1;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	io_units_per_cluster = CLUSTER_SZ / spdk_bs_get_io_unit_size(bs);
+	io_units_per_extent_page = SPDK_EXTENTS_PER_EP * io_units_per_cluster;
+	offsets[0] = 0;
+	offsets[1] = io_units_per_extent_page + 2 * io_units_per_cluster;
+	offsets[2] = 2 * io_units_per_extent_page + 5 * io_units_per_cluster;
+
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = SPDK_EXTENTS_PER_EP * 3;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Allocate a cluster in each extent page */
+	memset(zero, 0, sizeof(zero));
+	for (i = 0; i < 3; i++) {
+		memset(payload_write, 0xA0 + i, sizeof(payload_write));
+		spdk_blob_io_write(blob, ch, payload_write, offsets[i], 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+
+	ut_bs_reload(&bs, &bs_opts);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	CU_ASSERT(blob->ep_on_demand == blob->use_extent_table);
+	if (blob->ep_on_demand) {
+		/* Only the allocated clusters are known, the cluster map is not in memory */
+		CU_ASSERT(blob->active.clusters == NULL);
+		spdk_bs_get_extent_page_cache_stats(bs, &stats);
+		CU_ASSERT(stats.num_pages == 1);
+		CU_ASSERT(stats.max_pages == 1);
+		CU_ASSERT(stats.misses == 0);
+	}
+	CU_ASSERT(spdk_blob_get_num_clusters(blob) == SPDK_EXTENTS_PER_EP * 3);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 3);
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, 0) == offsets[0]);
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, io_units_per_cluster) == offsets[1]);
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, offsets[1] + io_units_per_cluster) ==
+		  offsets[2]);
+
+	/* Reading the clusters reads their extent pages, and evicts the least recently used */
+	for (i = 0; i < 3; i++) {
+		memset(payload_write, 0xA0 + i, sizeof(payload_write));
+		spdk_blob_io_read(blob, ch, payload_read, offsets[i], 1, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_read)) == 0);
+	}
+	spdk_blob_io_read(blob, ch, payload_read, offsets[2] + io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, zero, sizeof(payload_read)) == 0);
+	if (blob->ep_on_demand) {
+		spdk_bs_get_extent_page_cache_stats(bs, &stats);
+		CU_ASSERT(stats.misses == 2);
+		CU_ASSERT(stats.evictions == 2);
+		CU_ASSERT(stats.hits == 2);
+		CU_ASSERT(stats.num_pages == 1);
+	}
+
+	/* Allocate a cluster in an extent page that was evicted, and free the one in the last */
+	memset(payload_write, 0xB0, sizeof(payload_write));
+	spdk_blob_io_write(blob, ch, payload_write, offsets[1] + io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_unmap(blob, ch, offsets[2], io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 3);
+	CU_ASSERT(free_clusters - 3 == spdk_bs_free_cluster_count(bs));
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, offsets[1] + io_units_per_cluster) ==
+		  offsets[1] + io_units_per_cluster);
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, offsets[1] + 2 * io_units_per_cluster) ==
+		  UINT64_MAX);
+	if (blob->ep_on_demand) {
+		spdk_bs_get_extent_page_cache_stats(bs, &stats);
+		CU_ASSERT(stats.num_pages == 1);
+	}
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+
+	/* The updates of the extent pages are persisted */
+	ut_bs_reload(&bs, &bs_opts);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 3);
+	CU_ASSERT(spdk_blob_get_next_allocated_io_unit(blob, offsets[1] + 2 * io_units_per_cluster) ==
+		  UINT64_MAX);
+	spdk_blob_io_read(blob, ch, payload_read, offsets[1] + io_units_per_cluster, 1,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_read)) == 0);
+	spdk_blob_io_read(blob, ch, payload_read, offsets[2], 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, zero, sizeof(payload_read)) == 0);
+
+	/* Resizing needs the whole cluster map in memory, it is kept there until the blob is closed */
+	spdk_blob_resize(blob, SPDK_EXTENTS_PER_EP * 4, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->ep_on_demand == false);
+	SPDK_CU_ASSERT_FATAL(blob->active.clusters != NULL);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	CU_ASSERT(blob->active.clusters[SPDK_EXTENTS_PER_EP + 2] != 0);
+	CU_ASSERT(blob->active.clusters[SPDK_EXTENTS_PER_EP + 3] != 0);
+	CU_ASSERT(blob->active.clusters[SPDK_EXTENTS_PER_EP * 2 + 5] == 0);
+	spdk_bs_get_extent_page_cache_stats(bs, &stats);
+	CU_ASSERT(stats.num_pages == 0);
+
+	memset(payload_write, 0xA1, sizeof(payload_write));
+	spdk_blob_io_read(blob, ch, payload_read, offsets[1], 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_write, sizeof(payload_read)) == 0);
+
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+	g_blob = NULL;
+	g_blobid = 0;
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_thin_prov_unmap_cluster(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob, *snapshot;
 	struct spdk_io_channel *ch;
 	struct spdk_bs_dev *dev;
 	struct spdk_bs_opts bs_opts;
@@ -5324,6 +5936,667 @@ blob_snapshot_rw(void)
 	g_blobid = 0;
 }
 
+static void
+blob_sub_cluster_clone(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *clone;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t cluster_size, io_unit_size;
+	uint64_t io_units_per_cluster, io_units_per_sub_cluster;
+	uint64_t read_bytes_start, copy_bytes_start;
+	uint8_t *payload_read, *payload_expected;
+	uint8_t payload_write[BLOCKLEN];
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	io_unit_size = spdk_bs_get_io_unit_size(bs);
+	io_units_per_cluster = cluster_size / io_unit_size;
+	io_units_per_sub_cluster = io_units_per_cluster / 4;
+
+	payload_read = calloc(1, cluster_size);
+	payload_expected = calloc(1, cluster_size);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL && payload_expected != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* Sub-cluster size must divide the cluster */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 2;
+	opts.sub_cluster_sz = cluster_size / 3;
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+
+	opts.sub_cluster_sz = cluster_size / 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(blob->io_units_per_sub_cluster == io_units_per_sub_cluster);
+
+	/* Fill the first cluster, then make the blob a clone of a snapshot of it */
+	memset(payload_expected, 0xE5, cluster_size);
+	spdk_blob_io_write(blob, channel, payload_expected, 0, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 0) == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+	CU_ASSERT(blob->io_units_per_sub_cluster == io_units_per_sub_cluster);
+
+	/* A clone inherits the sub-cluster size of the snapshot, unless another one is given */
+	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_open_blob(bs, g_blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	clone = g_blob;
+	CU_ASSERT(clone->io_units_per_sub_cluster == io_units_per_sub_cluster);
+	ut_blob_close_and_delete(bs, clone);
+
+	spdk_bs_create_clone_ext(bs, snapshotid, NULL, cluster_size / 2, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_open_blob(bs, g_blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	clone = g_blob;
+	CU_ASSERT(clone->io_units_per_sub_cluster == io_units_per_cluster / 2);
+	ut_blob_close_and_delete(bs, clone);
+
+	spdk_bs_create_clone_ext(bs, snapshotid, NULL, cluster_size / 3, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+
+	/* The first write to the cluster copies just the sub-cluster it touches */
+	read_bytes_start = g_dev_read_bytes;
+	copy_bytes_start = g_dev_copy_bytes;
+	memset(payload_write, 0xAA, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, io_units_per_sub_cluster + 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 0) == 0xD);
+	CU_ASSERT((g_dev_read_bytes - read_bytes_start) + (g_dev_copy_bytes - copy_bytes_start) ==
+		  io_units_per_sub_cluster * io_unit_size);
+	memcpy(payload_expected + (io_units_per_sub_cluster + 1) * io_unit_size, payload_write,
+	       io_unit_size);
+
+	/* The sub-clusters left in the snapshot are read from there */
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_expected, payload_read, cluster_size) == 0);
+
+	/* A write to another sub-cluster of the allocated cluster copies that one in */
+	read_bytes_start = g_dev_read_bytes;
+	memset(payload_write, 0xBB, sizeof(payload_write));
+	spdk_blob_io_write(blob, channel, payload_write, io_units_per_cluster - 1, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 0) == 0x5);
+	CU_ASSERT(g_dev_read_bytes - read_bytes_start == io_units_per_sub_cluster * io_unit_size);
+	memcpy(payload_expected + (io_units_per_cluster - 1) * io_unit_size, payload_write,
+	       io_unit_size);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_expected, payload_read, cluster_size) == 0);
+
+	/* The sub-cluster masks persist */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_bs_reload(&bs, NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->io_units_per_sub_cluster == io_units_per_sub_cluster);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 0) == 0x5);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 1) == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_expected, payload_read, cluster_size) == 0);
+
+	/* Deleting the snapshot copies the rest of the cluster to the clone */
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->parent_id == SPDK_BLOBID_INVALID);
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, 0) == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_expected, payload_read, cluster_size) == 0);
+
+	ut_blob_close_and_delete(bs, blob);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(payload_read);
+	free(payload_expected);
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+blob_sub_cluster_persist(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t cluster_size, io_unit_size;
+	uint64_t io_units_per_cluster, io_units_per_sub_cluster;
+	uint64_t expected_masks[4];
+	uint64_t sub_clusters[2];
+	uint64_t io_unit;
+	uint8_t *payload_read, *payload_expected;
+	unsigned int i, j;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	io_unit_size = spdk_bs_get_io_unit_size(bs);
+	io_units_per_cluster = cluster_size / io_unit_size;
+	io_units_per_sub_cluster = io_units_per_cluster / 64;
+	SPDK_CU_ASSERT_FATAL(io_units_per_sub_cluster != 0);
+
+	payload_read = calloc(SPDK_COUNTOF(expected_masks) + 1, cluster_size);
+	payload_expected = calloc(SPDK_COUNTOF(expected_masks) + 1, cluster_size);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL && payload_expected != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	/* 64 sub-clusters per cluster, so all bits of the masks are used */
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = SPDK_COUNTOF(expected_masks) + 1;
+	opts.sub_cluster_sz = cluster_size / 64;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	CU_ASSERT(blob->io_units_per_sub_cluster == io_units_per_sub_cluster);
+
+	memset(payload_expected, 0xE5, SPDK_COUNTOF(expected_masks) * cluster_size);
+	spdk_blob_io_write(blob, channel, payload_expected, 0,
+			   SPDK_COUNTOF(expected_masks) * io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	/* Dirty a low and a high sub-cluster of each of the first clusters, the last
+	 * cluster stays in the snapshot */
+	for (i = 0; i < SPDK_COUNTOF(expected_masks); i++) {
+		sub_clusters[0] = i;
+		sub_clusters[1] = 63 - i;
+		expected_masks[i] = UINT64_MAX;
+
+		for (j = 0; j < SPDK_COUNTOF(sub_clusters); j++) {
+			io_unit = i * io_units_per_cluster + sub_clusters[j] * io_units_per_sub_cluster;
+			memset(payload_expected + io_unit * io_unit_size, 0x10 + i * 2 + j, io_unit_size);
+			spdk_blob_io_write(blob, channel, payload_expected + io_unit * io_unit_size,
+					   io_unit, 1, blob_op_complete, NULL);
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+			expected_masks[i] &= ~(1ULL << sub_clusters[j]);
+		}
+
+		CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, i) == expected_masks[i]);
+	}
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_bs_reload(&bs, NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->io_units_per_sub_cluster == io_units_per_sub_cluster);
+	for (i = 0; i < SPDK_COUNTOF(expected_masks); i++) {
+		CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, i) == expected_masks[i]);
+	}
+	CU_ASSERT(bs_cluster_invalid_sub_clusters(blob, SPDK_COUNTOF(expected_masks)) == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0,
+			  (SPDK_COUNTOF(expected_masks) + 1) * io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_expected, payload_read,
+			 (SPDK_COUNTOF(expected_masks) + 1) * cluster_size) == 0);
+
+	ut_blob_close_and_delete(bs, blob);
+
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	free(payload_read);
+	free(payload_expected);
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+blob_dedup(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_bs_dedup_stats stats;
+	struct spdk_blob *blob, *snapshot, *snapshot2, *thick;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid, snapshotid2;
+	uint64_t cluster_size, io_units_per_cluster;
+	uint64_t free_clusters;
+	uint8_t *payload_read, *payload_a, *payload_b, *zeroes;
+	int write_rc, dedup_rc;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	io_units_per_cluster = cluster_size / spdk_bs_get_io_unit_size(bs);
+
+	payload_read = calloc(1, cluster_size);
+	payload_a = calloc(1, cluster_size);
+	payload_b = calloc(1, cluster_size);
+	zeroes = calloc(1, cluster_size);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL && payload_a != NULL && payload_b != NULL &&
+			     zeroes != NULL);
+	memset(payload_a, 0xE5, cluster_size);
+	memset(payload_b, 0xAA, cluster_size);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Fill the first three clusters, then make the blob a clone of a snapshot of them */
+	spdk_blob_io_write(blob, channel, payload_a, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_a, io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_a, 2 * io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+
+	/* Rewrite the first cluster with the same data, the second one with other data,
+	 * a part of the third one with the same data and the fourth one with zeroes */
+	spdk_blob_io_write(blob, channel, payload_a, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_b, io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload_a, 2 * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, zeroes, 3 * io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 4);
+
+	/* Only the cluster that differs from the snapshot is left allocated */
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 1);
+	CU_ASSERT(blob->active.clusters[1] != 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters + 3);
+
+	spdk_bs_get_dedup_stats(bs, &stats);
+	CU_ASSERT(stats.clusters_scanned == 4);
+	CU_ASSERT(stats.clusters_released == 3);
+	CU_ASSERT(stats.io_freeze_count == 3);
+	CU_ASSERT(stats.io_freeze_max_us <= stats.io_freeze_total_us);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_b, cluster_size) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, 2 * io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, 3 * io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, zeroes, cluster_size) == 0);
+
+	/* Clusters of a read only snapshot are compared with its own parent */
+	spdk_blob_io_write(blob, channel, zeroes, 4 * io_units_per_cluster, io_units_per_cluster,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid2 = g_blobid;
+
+	spdk_bs_open_blob(bs, snapshotid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot2 = g_blob;
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(snapshot2) == 2);
+
+	/* Snapshot with a clone is not deduplicated, the clone copies its clusters on write */
+	write_rc = -1;
+	dedup_rc = -1;
+	spdk_blob_io_write(blob, channel, payload_b, io_units_per_cluster, 1,
+			   blob_op_complete, &write_rc);
+	spdk_bs_blob_dedup(bs, channel, snapshotid2, blob_op_complete, &dedup_rc);
+	poll_threads();
+	CU_ASSERT(write_rc == 0);
+	CU_ASSERT(dedup_rc == -EBUSY);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(snapshot2) == 2);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 1);
+	CU_ASSERT(snapshot2->locked_operation_in_progress == false);
+
+	spdk_bs_get_dedup_stats(bs, &stats);
+	CU_ASSERT(stats.clusters_scanned == 4);
+	CU_ASSERT(stats.clusters_released == 3);
+
+	spdk_blob_io_read(blob, channel, payload_read, io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_b, cluster_size) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_close(snapshot, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_close(snapshot2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Released clusters stay released after reload */
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, snapshotid2, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot2 = g_blob;
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(snapshot2) == 2);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_b, cluster_size) == 0);
+	spdk_blob_io_read(blob, channel, payload_read, 4 * io_units_per_cluster, io_units_per_cluster,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, zeroes, cluster_size) == 0);
+
+	/* Nothing is released from thick provisioned blobs */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 1;
+	thick = ut_blob_create_and_open(bs, &opts);
+
+	spdk_bs_blob_dedup(bs, channel, spdk_blob_get_id(thick), blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(thick) == 1);
+
+	spdk_bs_get_dedup_stats(bs, &stats);
+	CU_ASSERT(stats.clusters_scanned == 0);
+	CU_ASSERT(stats.clusters_released == 0);
+
+	/* Write racing with the dedup of the cluster it targets is not lost */
+	spdk_blob_io_write(blob, channel, payload_a, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, NULL);
+	spdk_blob_io_write(blob, channel, payload_b, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_b, cluster_size) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, thick);
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot2);
+
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	free(payload_read);
+	free(payload_a);
+	free(payload_b);
+	free(zeroes);
+}
+
+static void
+blob_dedup_persist_failure(void)
+{
+	struct spdk_power_failure_thresholds thresholds = {};
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_bs_dedup_stats stats;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid;
+	uint64_t cluster_size, io_units_per_cluster;
+	uint64_t free_clusters, cluster_lba;
+	uint8_t *payload_read, *payload_a;
+	int dedup_rc;
+
+	cluster_size = spdk_bs_get_cluster_size(bs);
+	io_units_per_cluster = cluster_size / spdk_bs_get_io_unit_size(bs);
+
+	payload_read = calloc(1, cluster_size);
+	payload_a = calloc(1, cluster_size);
+	SPDK_CU_ASSERT_FATAL(payload_read != NULL && payload_a != NULL);
+	memset(payload_a, 0xE5, cluster_size);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 1;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* Write the same data to the cluster before and after taking a snapshot */
+	spdk_blob_io_write(blob, channel, payload_a, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	snapshotid = g_blobid;
+
+	spdk_blob_io_write(blob, channel, payload_a, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	cluster_lba = blob->active.clusters[0];
+	CU_ASSERT(cluster_lba != 0);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	/* Fail the metadata write that releases the cluster. Power is restored once the
+	 * cluster is mapped back, so that the blob can still be closed. */
+	dedup_rc = 1;
+	thresholds.write_threshold = 1;
+	dev_set_power_failure_thresholds(thresholds);
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, &dedup_rc);
+	while (g_power_failure_counters.write_counter == 0) {
+		poll_thread_times(0, 1);
+	}
+	CU_ASSERT(blob->active.clusters[0] == 0);
+	while (blob->active.clusters[0] == 0 && dedup_rc == 1) {
+		poll_thread_times(0, 1);
+	}
+	dev_reset_power_failure_event();
+	poll_threads();
+	CU_ASSERT(dedup_rc == -EIO);
+
+	/* The cluster is still mapped and allocated, and its data was not unmapped */
+	CU_ASSERT(blob->active.clusters[0] == cluster_lba);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 1);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+	CU_ASSERT(memcmp(&g_dev_buffer[cluster_lba * DEV_BUFFER_BLOCKLEN], payload_a,
+			 cluster_size) == 0);
+
+	spdk_bs_get_dedup_stats(bs, &stats);
+	CU_ASSERT(stats.clusters_scanned == 1);
+	CU_ASSERT(stats.clusters_released == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* The cluster is still mapped after reload, and can be released then */
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->active.clusters[0] == cluster_lba);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+
+	spdk_bs_blob_dedup(bs, channel, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_blob_get_num_allocated_clusters(blob) == 0);
+
+	spdk_blob_io_read(blob, channel, payload_read, 0, io_units_per_cluster, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(memcmp(payload_read, payload_a, cluster_size) == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+
+	spdk_bs_delete_blob(bs, snapshotid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	free(payload_read);
+	free(payload_a);
+}
+
 static void
 blob_snapshot_rw_iov(void)
 {
@@ -10164,12 +11437,21 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite_bs, blob_thin_prov_alloc);
 		CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_reserve_clusters);
+		CU_ADD_TEST(suite_bs, blob_thick_reclaim_reserved_clusters);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_write_md_overlap);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_write_in_place);
 		CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
+		CU_ADD_TEST(suite, blob_ep_on_demand);
 		CU_ADD_TEST(suite, blob_thin_prov_unmap_cluster);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
 		CU_ADD_TEST(suite, bs_load_iter_test);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw);
+		CU_ADD_TEST(suite_bs, blob_sub_cluster_clone);
+		CU_ADD_TEST(suite_bs, blob_sub_cluster_persist);
+		CU_ADD_TEST(suite_bs, blob_dedup);
+		CU_ADD_TEST(suite_bs, blob_dedup_persist_failure);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw_iov);
 		CU_ADD_TEST(suite, blob_relations);
 		CU_ADD_TEST(suite, blob_relations2);
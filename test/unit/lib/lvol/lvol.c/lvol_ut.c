@@ -55,6 +55,7 @@ struct spdk_blob {
 	bool			thin_provisioned;
 	struct spdk_bs_dev	*back_bs_dev;
 	uint64_t		num_clusters;
+	uint32_t		sub_cluster_sz;
 };
 
 int g_lvserrno;
@@ -105,6 +106,13 @@ spdk_bs_blob_decouple_parent(struct spdk_blob_store *bs, struct spdk_io_channel
 	cb_fn(cb_arg, g_inflate_rc);
 }
 
+void
+spdk_bs_blob_dedup(struct spdk_blob_store *bs, struct spdk_io_channel *channel,
+		   spdk_blob_id blobid, spdk_blob_op_complete cb_fn, void *cb_arg)
+{
+	cb_fn(cb_arg, g_inflate_rc);
+}
+
 void
 spdk_bs_iter_next(struct spdk_blob_store *bs, struct spdk_blob *b,
 		  spdk_blob_op_with_handle_complete cb_fn, void *cb_arg)
@@ -479,6 +487,7 @@ spdk_blob_opts_init(struct spdk_blob_opts *opts, size_t opts_size)
 	opts->opts_size = opts_size;
 	opts->num_clusters = 0;
 	opts->thin_provision = false;
+	opts->sub_cluster_sz = 0;
 	opts->xattrs.count = 0;
 	opts->xattrs.names = NULL;
 	opts->xattrs.ctx = NULL;
@@ -527,6 +536,7 @@ spdk_bs_create_blob_ext(struct spdk_blob_store *bs, const struct spdk_blob_opts
 
 	if (opts != NULL) {
 		b->num_clusters = opts->num_clusters;
+		b->sub_cluster_sz = opts->sub_cluster_sz;
 	} else {
 		b->num_clusters = 1;
 	}
@@ -544,11 +554,16 @@ spdk_bs_create_snapshot(struct spdk_blob_store *bs, spdk_blob_id blobid,
 }
 
 void
-spdk_bs_create_clone(struct spdk_blob_store *bs, spdk_blob_id blobid,
-		     const struct spdk_blob_xattr_opts *clone_xattrs,
-		     spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+spdk_bs_create_clone_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
+			 const struct spdk_blob_xattr_opts *clone_xattrs, uint32_t sub_cluster_sz,
+			 spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
 {
-	spdk_bs_create_blob_ext(bs, NULL, cb_fn, cb_arg);
+	struct spdk_blob_opts opts;
+
+	spdk_blob_opts_init(&opts, sizeof(opts));
+	opts.num_clusters = 1;
+	opts.sub_cluster_sz = sub_cluster_sz;
+	spdk_bs_create_blob_ext(bs, &opts, cb_fn, cb_arg);
 }
 
 static int g_spdk_blob_get_esnap_id_errno;
@@ -2227,6 +2242,69 @@ lvol_create_thin_provisioned(void)
 	free_dev(&dev);
 }
 
+static void
+lvol_create_sub_cluster(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvol *lvol, *snap;
+	struct spdk_lvs_opts opts;
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	/* The sub-cluster size is passed to the blob of the lvol */
+	rc = spdk_lvol_create_ext(g_lvol_store, "lvol", 10, true, LVOL_CLEAR_WITH_DEFAULT, 16 * 1024,
+				  lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	CU_ASSERT(g_lvol->blob->sub_cluster_sz == 16 * 1024);
+	lvol = g_lvol;
+
+	spdk_lvol_create_snapshot(lvol, "snap", lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	snap = g_lvol;
+
+	/* And to the blob of a clone */
+	spdk_lvol_create_clone_ext(snap, "clone", 4096, lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	CU_ASSERT(g_lvol->blob->sub_cluster_sz == 4096);
+
+	/* A plain clone asks the blobstore to inherit it from the snapshot */
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_create_clone(snap, "clone2", lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	CU_ASSERT(g_lvol->blob->sub_cluster_sz == 0);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_close(snap, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_close(lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+}
+
 static void
 lvol_inflate(void)
 {
@@ -2327,6 +2405,56 @@ lvol_decouple_parent(void)
 	CU_ASSERT(g_io_channel == NULL);
 }
 
+static void
+lvol_dedup(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	spdk_lvol_create(g_lvol_store, "lvol", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+
+	g_inflate_rc = -1;
+	spdk_lvol_dedup(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno != 0);
+
+	g_inflate_rc = 0;
+	spdk_lvol_dedup(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+
+	/* Make sure that all references to the io_channel was closed after
+	 * dedup call
+	 */
+	CU_ASSERT(g_io_channel == NULL);
+}
+
 static void
 lvol_get_xattr(void)
 {
@@ -3586,10 +3714,12 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, lvol_refcnt);
 	CU_ADD_TEST(suite, lvol_names);
 	CU_ADD_TEST(suite, lvol_create_thin_provisioned);
+	CU_ADD_TEST(suite, lvol_create_sub_cluster);
 	CU_ADD_TEST(suite, lvol_rename);
 	CU_ADD_TEST(suite, lvs_rename);
 	CU_ADD_TEST(suite, lvol_inflate);
 	CU_ADD_TEST(suite, lvol_decouple_parent);
+	CU_ADD_TEST(suite, lvol_dedup);
 	CU_ADD_TEST(suite, lvol_get_xattr);
 	CU_ADD_TEST(suite, lvol_esnap_reload);
 	CU_ADD_TEST(suite, lvol_esnap_create_bad_args);
@@ -37,8 +37,33 @@ DEFINE_STUB_V(nvme_qpair_deinit, (struct spdk_nvme_qpair *qpair));
 DEFINE_STUB(nvme_ctrlr_get_current_process, struct spdk_nvme_ctrlr_process *,
 	    (struct spdk_nvme_ctrlr *ctrlr), NULL);
 
-DEFINE_STUB(spdk_nvme_qpair_process_completions, int32_t,
-	    (struct spdk_nvme_qpair *qpair, uint32_t max_completions), 0);
+static struct spdk_nvme_qpair *g_polled_qpairs[8];
+static uint32_t g_polled_max_completions[8];
+static uint32_t g_num_polled_qpairs;
+
+int32_t
+spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	uint32_t num_completions = 0;
+
+	if (g_num_polled_qpairs < SPDK_COUNTOF(g_polled_qpairs)) {
+		g_polled_qpairs[g_num_polled_qpairs] = qpair;
+		g_polled_max_completions[g_num_polled_qpairs] = max_completions;
+		g_num_polled_qpairs++;
+	}
+
+	/* Consume the completions posted by the test, one per entry */
+	while (pqpair->cpl != NULL && pqpair->cpl[pqpair->cq_head].status.p == pqpair->flags.phase) {
+		pqpair->cpl[pqpair->cq_head].status.p = !pqpair->flags.phase;
+		pqpair->cq_head = (pqpair->cq_head + 1) % pqpair->num_entries;
+		if (++num_completions == max_completions) {
+			break;
+		}
+	}
+
+	return num_completions;
+}
 
 DEFINE_STUB(nvme_request_check_timeout, int, (struct nvme_request *req, uint16_t cid,
 		struct spdk_nvme_ctrlr_process *active_proc, uint64_t now_tick), 0);
@@ -578,6 +603,123 @@ test_nvme_pcie_poll_group_get_stats(void)
 	CU_ASSERT(rc == 0);
 }
 
+static void
+disconnected_qpair_cb(struct spdk_nvme_qpair *qpair, void *poll_group_ctx)
+{
+}
+
+static void
+post_completions(struct nvme_pcie_qpair *pqpair, uint16_t num_completions)
+{
+	uint16_t i;
+
+	for (i = 0; i < num_completions; i++) {
+		pqpair->cpl[(pqpair->cq_head + i) % pqpair->num_entries].status.p = pqpair->flags.phase;
+	}
+}
+
+static void
+test_nvme_pcie_poll_group_completion_budget(void)
+{
+	struct spdk_nvme_poll_group group = {};
+	struct spdk_nvme_ctrlr ctrlr = {};
+	struct spdk_nvme_transport_poll_group *tgroup;
+	struct nvme_pcie_poll_group *pgroup;
+	struct nvme_pcie_qpair pqpair[3] = {};
+	struct spdk_nvme_cpl cpl[3][8] = {};
+	int64_t rc;
+	int i;
+
+	tgroup = nvme_pcie_poll_group_create();
+	SPDK_CU_ASSERT_FATAL(tgroup != NULL);
+	pgroup = SPDK_CONTAINEROF(tgroup, struct nvme_pcie_poll_group, group);
+	tgroup->group = &group;
+	STAILQ_INIT(&tgroup->connected_qpairs);
+	STAILQ_INIT(&tgroup->disconnected_qpairs);
+
+	for (i = 0; i < 3; i++) {
+		pqpair[i].cpl = cpl[i];
+		pqpair[i].num_entries = 8;
+		pqpair[i].flags.phase = 1;
+		pqpair[i].stat = &pgroup->stats;
+		pqpair[i].qpair.ctrlr = &ctrlr;
+		STAILQ_INIT(&pqpair[i].qpair.err_req_head);
+		STAILQ_INIT(&pqpair[i].qpair.aborting_queued_req);
+		nvme_qpair_set_state(&pqpair[i].qpair, NVME_QPAIR_ENABLED);
+		STAILQ_INSERT_TAIL(&tgroup->connected_qpairs, &pqpair[i].qpair, poll_group_stailq);
+		tgroup->num_connected_qpairs++;
+	}
+
+	/* Without a budget, every qpair is polled, idle or not */
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, disconnected_qpair_cb);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_num_polled_qpairs == 3);
+	CU_ASSERT(pgroup->stats.idle_polls == 0);
+
+	/* Idle qpairs are skipped and counted as idle polls */
+	group.completion_budget = 4;
+	post_completions(&pqpair[1], 2);
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, disconnected_qpair_cb);
+	CU_ASSERT(rc == 2);
+	CU_ASSERT(g_num_polled_qpairs == 1);
+	CU_ASSERT(g_polled_qpairs[0] == &pqpair[1].qpair);
+	CU_ASSERT(g_polled_max_completions[0] == 4);
+	CU_ASSERT(pgroup->stats.polls == 2);
+	CU_ASSERT(pgroup->stats.idle_polls == 2);
+
+	/* Both the budget and the per-qpair limit apply.  Once the budget is consumed, the
+	 * next call starts with the first qpair that was not polled.
+	 */
+	post_completions(&pqpair[0], 3);
+	post_completions(&pqpair[1], 3);
+	post_completions(&pqpair[2], 3);
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 3, disconnected_qpair_cb);
+	CU_ASSERT(rc == 4);
+	CU_ASSERT(g_num_polled_qpairs == 2);
+	CU_ASSERT(g_polled_qpairs[0] == &pqpair[0].qpair);
+	CU_ASSERT(g_polled_max_completions[0] == 3);
+	CU_ASSERT(g_polled_qpairs[1] == &pqpair[1].qpair);
+	CU_ASSERT(g_polled_max_completions[1] == 1);
+	CU_ASSERT(STAILQ_FIRST(&tgroup->connected_qpairs) == &pqpair[2].qpair);
+
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, disconnected_qpair_cb);
+	CU_ASSERT(rc == 4);
+	CU_ASSERT(g_num_polled_qpairs == 2);
+	CU_ASSERT(g_polled_qpairs[0] == &pqpair[2].qpair);
+	CU_ASSERT(g_polled_max_completions[0] == 4);
+	CU_ASSERT(g_polled_qpairs[1] == &pqpair[1].qpair);
+	CU_ASSERT(g_polled_max_completions[1] == 1);
+	CU_ASSERT(STAILQ_FIRST(&tgroup->connected_qpairs) == &pqpair[2].qpair);
+
+	/* A qpair that is not enabled goes through the regular path even if its queue is empty */
+	nvme_qpair_set_state(&pqpair[0].qpair, NVME_QPAIR_CONNECTING);
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, disconnected_qpair_cb);
+	CU_ASSERT(rc == 1);
+	CU_ASSERT(g_num_polled_qpairs == 2);
+	CU_ASSERT(g_polled_qpairs[0] == &pqpair[0].qpair);
+	CU_ASSERT(g_polled_qpairs[1] == &pqpair[1].qpair);
+
+	/* So does a qpair with a delayed submission queue doorbell */
+	nvme_qpair_set_state(&pqpair[0].qpair, NVME_QPAIR_ENABLED);
+	pqpair[2].flags.delay_cmd_submit = 1;
+	pqpair[2].sq_tail = 1;
+	g_num_polled_qpairs = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, disconnected_qpair_cb);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_num_polled_qpairs == 1);
+	CU_ASSERT(g_polled_qpairs[0] == &pqpair[2].qpair);
+
+	STAILQ_INIT(&tgroup->connected_qpairs);
+	tgroup->num_connected_qpairs = 0;
+	rc = nvme_pcie_poll_group_destroy(tgroup);
+	CU_ASSERT(rc == 0);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -593,6 +735,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_connect_qpair);
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_construct_admin_qpair);
 	CU_ADD_TEST(suite, test_nvme_pcie_poll_group_get_stats);
+	CU_ADD_TEST(suite, test_nvme_pcie_poll_group_completion_budget);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -56,6 +56,8 @@ DEFINE_STUB(spdk_bdev_is_md_interleaved, bool,
 DEFINE_STUB(spdk_bdev_module_claim_bdev, int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 	     struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_desc_set_qos, int,
+	    (struct spdk_bdev_desc *desc, const struct spdk_bdev_desc_qos_opts *opts), 0);
 
 DEFINE_STUB(spdk_bdev_io_type_supported, bool,
 	    (struct spdk_bdev *bdev, enum spdk_bdev_io_type io_type), false);
@@ -21,6 +21,7 @@ DEFINE_STUB(nvmf_transport_poll_group_create, struct spdk_nvmf_transport_poll_gr
 	     struct spdk_nvmf_poll_group *group), NULL);
 DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc),
 	    NULL);
+DEFINE_STUB_V(spdk_bdev_channel_unplug, (struct spdk_io_channel *ch));
 DEFINE_STUB(nvmf_ctrlr_async_event_ns_notice, int, (struct spdk_nvmf_ctrlr *ctrlr), 0);
 DEFINE_STUB(nvmf_ctrlr_async_event_ana_change_notice, int,
 	    (struct spdk_nvmf_ctrlr *ctrlr), 0);
@@ -28,6 +29,10 @@ DEFINE_STUB(nvmf_transport_poll_group_remove, int, (struct spdk_nvmf_transport_p
 		struct spdk_nvmf_qpair *qpair), 0);
 DEFINE_STUB(nvmf_transport_req_free, int, (struct spdk_nvmf_request *req), 0);
 DEFINE_STUB(nvmf_transport_poll_group_poll, int, (struct spdk_nvmf_transport_poll_group *group), 0);
+DEFINE_STUB(nvmf_transport_poll_group_migrate_out, int,
+	    (struct spdk_nvmf_transport_poll_group *group, struct spdk_nvmf_qpair *qpair), 0);
+DEFINE_STUB(nvmf_transport_poll_group_migrate_in, int,
+	    (struct spdk_nvmf_transport_poll_group *group, struct spdk_nvmf_qpair *qpair), 0);
 DEFINE_STUB_V(nvmf_subsystem_remove_all_listeners, (struct spdk_nvmf_subsystem *subsystem,
 		bool stop));
 DEFINE_STUB(spdk_nvmf_subsystem_destroy, int, (struct spdk_nvmf_subsystem *subsystem,
@@ -224,6 +229,157 @@ test_nvmf_tgt_create_poll_group(void)
 	MOCK_CLEAR(spdk_bdev_get_io_channel);
 }
 
+static int
+ut_poll_group_migrate(struct spdk_nvmf_transport_poll_group *group, struct spdk_nvmf_qpair *qpair)
+{
+	return 0;
+}
+
+static const struct spdk_nvmf_transport_ops g_ut_migrate_ops = {
+	.poll_group_migrate_out = ut_poll_group_migrate,
+	.poll_group_migrate_in = ut_poll_group_migrate,
+};
+
+static void
+test_nvmf_poll_group_migrate(void)
+{
+	struct spdk_thread *thread;
+	struct spdk_nvmf_tgt tgt = {};
+	struct spdk_nvmf_transport transport = { .ops = &g_ut_migrate_ops, .tgt = &tgt };
+	struct spdk_nvmf_poll_group group1 = {}, group2 = {};
+	struct spdk_nvmf_transport_poll_group tgroup1 = {}, tgroup2 = {};
+	struct spdk_nvmf_ctrlr ctrlr = {};
+	struct spdk_nvmf_qpair admin_qpair = {}, qpair1 = {}, qpair2 = {};
+	struct spdk_nvmf_poll_group_policy_opts opts;
+	struct nvmf_migrate_select_ctx *ctx;
+
+	thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+
+	TAILQ_INIT(&tgt.poll_groups);
+	pthread_mutex_init(&tgt.mutex, NULL);
+	TAILQ_INIT(&group1.tgroups);
+	TAILQ_INIT(&group1.qpairs);
+	TAILQ_INIT(&group2.tgroups);
+	TAILQ_INIT(&group2.qpairs);
+	pthread_mutex_init(&group1.mutex, NULL);
+	pthread_mutex_init(&group2.mutex, NULL);
+	group1.thread = thread;
+	group2.thread = thread;
+	tgroup1.transport = &transport;
+	tgroup1.group = &group1;
+	tgroup2.transport = &transport;
+	tgroup2.group = &group2;
+	TAILQ_INSERT_TAIL(&group1.tgroups, &tgroup1, link);
+	TAILQ_INSERT_TAIL(&group2.tgroups, &tgroup2, link);
+
+	admin_qpair.qid = 0;
+	qpair1.qid = 1;
+	qpair2.qid = 2;
+	admin_qpair.last_period_nvme_io = 1;
+	qpair1.last_period_nvme_io = 10;
+	qpair2.last_period_nvme_io = 100;
+	admin_qpair.transport = &transport;
+	qpair1.transport = &transport;
+	qpair2.transport = &transport;
+	admin_qpair.ctrlr = &ctrlr;
+	qpair1.ctrlr = &ctrlr;
+	qpair2.ctrlr = &ctrlr;
+	admin_qpair.group = &group1;
+	qpair1.group = &group1;
+	qpair2.group = &group1;
+	admin_qpair.state = SPDK_NVMF_QPAIR_ENABLED;
+	qpair1.state = SPDK_NVMF_QPAIR_ENABLED;
+	qpair2.state = SPDK_NVMF_QPAIR_ENABLED;
+	TAILQ_INIT(&admin_qpair.outstanding);
+	TAILQ_INIT(&qpair1.outstanding);
+	TAILQ_INIT(&qpair2.outstanding);
+	TAILQ_INSERT_TAIL(&group1.qpairs, &admin_qpair, link);
+	TAILQ_INSERT_TAIL(&group1.qpairs, &qpair1, link);
+	TAILQ_INSERT_TAIL(&group1.qpairs, &qpair2, link);
+	group1.stat.current_io_qpairs = 2;
+
+	/* The busy percentage decides first, then outstanding I/O, then the number of qpairs */
+	group1.load.busy_pct = 89;
+	group2.load.busy_pct = 10;
+	CU_ASSERT(nvmf_poll_group_cmp_load(&group1, &group2) > 0);
+	group2.load.busy_pct = 86;
+	group2.load.outstanding = 1;
+	CU_ASSERT(nvmf_poll_group_cmp_load(&group1, &group2) < 0);
+	group1.load.outstanding = 1;
+	CU_ASSERT(nvmf_poll_group_cmp_load(&group1, &group2) > 0);
+	group2.current_unassociated_qpairs = 2;
+	CU_ASSERT(nvmf_poll_group_cmp_load(&group1, &group2) == 0);
+
+	/* The qpair moving at most half of the difference in I/O is selected */
+	ctx = calloc(1, sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ctx->group = &group1;
+	ctx->dst = &group2;
+	ctx->max_nvme_io = 55;
+	_nvmf_poll_group_select_migration(ctx);
+	CU_ASSERT(group1.migrate_qpair == &qpair1);
+	CU_ASSERT(group1.migrate_dst == &group2);
+
+	/* Nothing moves while the transport has work in progress */
+	MOCK_SET(nvmf_transport_poll_group_migrate_out, -EBUSY);
+	nvmf_poll_group_poll(&group1);
+	CU_ASSERT(group1.migrate_qpair == &qpair1);
+	CU_ASSERT(qpair1.group == &group1);
+
+	MOCK_SET(nvmf_transport_poll_group_migrate_out, 0);
+	nvmf_poll_group_poll(&group1);
+	CU_ASSERT(group1.migrate_qpair == NULL);
+	CU_ASSERT(qpair1.group == &group2);
+	CU_ASSERT(group1.stat.current_io_qpairs == 1);
+	CU_ASSERT(group1.stat.migrated_out_qpairs == 1);
+	CU_ASSERT(TAILQ_FIRST(&group2.qpairs) == NULL);
+
+	spdk_thread_poll(thread, 0, 0);
+	CU_ASSERT(TAILQ_FIRST(&group2.qpairs) == &qpair1);
+	CU_ASSERT(group2.stat.current_io_qpairs == 1);
+	CU_ASSERT(group2.stat.migrated_in_qpairs == 1);
+	CU_ASSERT(qpair1.state == SPDK_NVMF_QPAIR_ENABLED);
+	MOCK_CLEAR(nvmf_transport_poll_group_migrate_out);
+
+	/* Nothing is selected if every I/O qpair is too busy */
+	ctx = calloc(1, sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ctx->group = &group1;
+	ctx->dst = &group2;
+	ctx->max_nvme_io = 50;
+	_nvmf_poll_group_select_migration(ctx);
+	CU_ASSERT(group1.migrate_qpair == NULL);
+
+	/* The policy options are validated and the balancer only runs with the load policy */
+	spdk_nvmf_poll_group_policy_opts_init(&opts, sizeof(opts));
+	CU_ASSERT(opts.policy == SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT);
+	opts.policy = SPDK_NVMF_POLL_GROUP_POLICY_LOAD;
+	opts.imbalance_threshold = 101;
+	CU_ASSERT(spdk_nvmf_tgt_set_poll_group_policy(&tgt, &opts) == -EINVAL);
+	CU_ASSERT(tgt.balance_poller == NULL);
+	opts.imbalance_threshold = 30;
+	CU_ASSERT(spdk_nvmf_tgt_set_poll_group_policy(&tgt, &opts) == 0);
+	CU_ASSERT(tgt.balance_poller != NULL);
+	CU_ASSERT(nvmf_tgt_placement_is_load_aware(&tgt));
+	memset(&opts, 0, sizeof(opts));
+	spdk_nvmf_tgt_get_poll_group_policy(&tgt, &opts, sizeof(opts));
+	CU_ASSERT(opts.imbalance_threshold == 30);
+	opts.policy = SPDK_NVMF_POLL_GROUP_POLICY_TRANSPORT;
+	CU_ASSERT(spdk_nvmf_tgt_set_poll_group_policy(&tgt, &opts) == 0);
+	CU_ASSERT(tgt.balance_poller == NULL);
+
+	pthread_mutex_destroy(&group1.mutex);
+	pthread_mutex_destroy(&group2.mutex);
+	pthread_mutex_destroy(&tgt.mutex);
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -235,6 +391,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("nvmf", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_nvmf_tgt_create_poll_group);
+	CU_ADD_TEST(suite, test_nvmf_poll_group_migrate);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -32,6 +32,8 @@ DEFINE_STUB(spdk_mem_map_clear_translation, int, (struct spdk_mem_map *map, uint
 DEFINE_STUB(spdk_mem_map_alloc, struct spdk_mem_map *, (uint64_t default_translation,
 		const struct spdk_mem_map_ops *ops, void *cb_ctx), NULL);
 DEFINE_STUB(spdk_nvmf_qpair_disconnect, int, (struct spdk_nvmf_qpair *qpair), 0);
+DEFINE_STUB(nvmf_poll_group_cmp_load, int, (struct spdk_nvmf_poll_group *pg1,
+		struct spdk_nvmf_poll_group *pg2), 0);
 DEFINE_STUB(spdk_nvmf_qpair_get_listen_trid, int,
 	    (struct spdk_nvmf_qpair *qpair, struct spdk_nvme_transport_id *trid), 0);
 DEFINE_STUB_V(spdk_mem_map_free, (struct spdk_mem_map **pmap));
@@ -755,9 +757,11 @@ test_nvmf_rdma_get_optimal_poll_group(void)
 	struct spdk_nvmf_rdma_poll_group *rgroups[TEST_GROUPS_COUNT];
 	struct spdk_nvmf_transport_poll_group *result;
 	struct spdk_nvmf_poll_group group = {};
+	struct spdk_nvmf_tgt tgt = {};
 	uint32_t i;
 
 	rqpair.qpair.transport = transport;
+	transport->tgt = &tgt;
 	TAILQ_INIT(&rtransport.poll_groups);
 
 	for (i = 0; i < TEST_GROUPS_COUNT; i++) {
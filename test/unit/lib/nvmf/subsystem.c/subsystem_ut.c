@@ -20,6 +20,8 @@ DEFINE_STUB(spdk_bdev_module_claim_bdev,
 	    int,
 	    (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
 	     struct spdk_bdev_module *module), 0);
+DEFINE_STUB(spdk_bdev_desc_set_qos, int,
+	    (struct spdk_bdev_desc *desc, const struct spdk_bdev_desc_qos_opts *opts), 0);
 
 DEFINE_STUB_V(spdk_bdev_module_release_bdev,
 	      (struct spdk_bdev *bdev));
@@ -38,6 +38,8 @@ DEFINE_STUB(spdk_nvmf_qpair_get_listen_trid,
 	    (struct spdk_nvmf_qpair *qpair, struct spdk_nvme_transport_id *trid),
 	    0);
 DEFINE_STUB(spdk_nvmf_qpair_disconnect, int, (struct spdk_nvmf_qpair *qpair), 0);
+DEFINE_STUB(nvmf_poll_group_cmp_load, int, (struct spdk_nvmf_poll_group *pg1,
+		struct spdk_nvmf_poll_group *pg2), 0);
 
 DEFINE_STUB(nvmf_subsystem_add_ctrlr,
 	    int,
@@ -236,6 +238,7 @@ DEFINE_STUB_V(accel_channel_destroy, (void *io_device, void *ctx_buf));
 DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
 DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(spdk_bdev_channel_plug, (struct spdk_io_channel *ch));
 
 DEFINE_STUB(spdk_bdev_get_max_active_zones, uint32_t,
 	    (const struct spdk_bdev *bdev), 0);
@@ -273,11 +276,52 @@ spdk_accel_get_io_channel(void)
 	return spdk_get_io_channel(g_accel_p);
 }
 
-DEFINE_STUB(spdk_accel_submit_crc32cv,
-	    int,
-	    (struct spdk_io_channel *ch, uint32_t *dst, struct iovec *iovs,
-	     uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg),
-	    0);
+struct ut_crc32c_op {
+	uint32_t			*dst;
+	struct iovec			*iovs;
+	uint32_t			iovcnt;
+	uint32_t			seed;
+	spdk_accel_completion_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static struct ut_crc32c_op g_ut_crc32c_ops[2];
+static uint32_t g_ut_num_crc32c_ops;
+
+DEFINE_RETURN_MOCK(spdk_accel_submit_crc32cv, int);
+int
+spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *dst, struct iovec *iovs,
+			  uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct ut_crc32c_op *op;
+
+	HANDLE_RETURN_MOCK(spdk_accel_submit_crc32cv);
+
+	SPDK_CU_ASSERT_FATAL(g_ut_num_crc32c_ops < SPDK_COUNTOF(g_ut_crc32c_ops));
+	op = &g_ut_crc32c_ops[g_ut_num_crc32c_ops++];
+	op->dst = dst;
+	op->iovs = iovs;
+	op->iovcnt = iovcnt;
+	op->seed = seed;
+	op->cb_fn = cb_fn;
+	op->cb_arg = cb_arg;
+
+	return 0;
+}
+
+static void
+ut_complete_crc32c_ops(void)
+{
+	struct ut_crc32c_op *op;
+	uint32_t i, num_ops = g_ut_num_crc32c_ops;
+
+	g_ut_num_crc32c_ops = 0;
+	for (i = 0; i < num_ops; i++) {
+		op = &g_ut_crc32c_ops[i];
+		*op->dst = spdk_crc32c_iov_update(op->iovs, op->iovcnt, ~op->seed);
+		op->cb_fn(op->cb_arg, 0);
+	}
+}
 
 DEFINE_STUB(spdk_nvmf_bdev_ctrlr_nvme_passthru_admin,
 	    int,
@@ -675,6 +719,291 @@ test_nvmf_tcp_send_c2h_data(void)
 	spdk_thread_destroy(thread);
 }
 
+static void
+test_nvmf_tcp_ddgst_compute(void)
+{
+	struct spdk_thread *thread;
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_poll_group tgroup = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req[2] = {};
+	struct nvme_tcp_pdu pdu[2] = {};
+	uint8_t data[2][512];
+	uint32_t crc32c;
+	int i;
+
+	thread = spdk_thread_create(NULL, NULL);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	spdk_set_thread(thread);
+
+	tqpair.group = &tgroup;
+	tqpair.qpair.transport = &ttransport.transport;
+	tqpair.host_ddgst_enable = true;
+	/* Set qpair state to make unrelated operations NOP */
+	tqpair.state = NVMF_TCP_QPAIR_STATE_RUNNING;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_ERROR;
+
+	for (i = 0; i < 2; i++) {
+		memset(data[i], i + 1, sizeof(data[i]));
+		tcp_req[i].pdu = &pdu[i];
+		tcp_req[i].req.qpair = &tqpair.qpair;
+		tcp_req[i].req.cmd = (union nvmf_h2c_msg *)&tcp_req[i].cmd;
+		tcp_req[i].req.iov[0].iov_base = data[i];
+		tcp_req[i].req.iov[0].iov_len = sizeof(data[i]);
+		tcp_req[i].req.iovcnt = 1;
+		tcp_req[i].req.length = sizeof(data[i]);
+	}
+
+	/* Each digest is submitted as a separate operation right away */
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req[0]);
+	CU_ASSERT(g_ut_num_crc32c_ops == 1);
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req[1]);
+	CU_ASSERT(g_ut_num_crc32c_ops == 2);
+	ut_complete_crc32c_ops();
+	for (i = 0; i < 2; i++) {
+		crc32c = spdk_crc32c_update(data[i], sizeof(data[i]), ~0) ^ SPDK_CRC32C_XOR;
+		CU_ASSERT(from_le32(pdu[i].data_digest) == crc32c);
+	}
+
+	/* The digest is computed on the CPU if it cannot be submitted */
+	MOCK_SET(spdk_accel_submit_crc32cv, -ENOMEM);
+	memset(pdu[0].data_digest, 0, sizeof(pdu[0].data_digest));
+	tcp_req[0].pdu_in_use = false;
+	nvmf_tcp_send_c2h_data(&tqpair, &tcp_req[0]);
+	CU_ASSERT(g_ut_num_crc32c_ops == 0);
+	crc32c = spdk_crc32c_update(data[0], sizeof(data[0]), ~0) ^ SPDK_CRC32C_XOR;
+	CU_ASSERT(from_le32(pdu[0].data_digest) == crc32c);
+	MOCK_CLEAR(spdk_accel_submit_crc32cv);
+
+	spdk_thread_exit(thread);
+	while (!spdk_thread_is_exited(thread)) {
+		spdk_thread_poll(thread, 0, 0);
+	}
+	spdk_thread_destroy(thread);
+}
+
+static void
+test_nvmf_tcp_recv_zcopy(void)
+{
+	struct spdk_nvmf_tcp_transport ttransport = {};
+	struct spdk_nvmf_tcp_poll_group tgroup = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	struct spdk_nvmf_tcp_req tcp_req = {};
+	struct nvme_tcp_pdu pdu = {};
+	struct nvmf_tcp_recv_buf rbuf = {};
+	struct spdk_sock_group grp = {};
+	struct spdk_nvmf_tgt tgt = {};
+	struct spdk_nvmf_poll_group group = {};
+	uint8_t data[1024], icd[512], hdr[8];
+	int rc;
+
+	memset(data, 0xa5, sizeof(data));
+	ttransport.transport.opts.io_unit_size = sizeof(data);
+	tgroup.group.transport = &ttransport.transport;
+	tgroup.sock_group = &grp;
+	STAILQ_INIT(&tgroup.free_recv_bufs);
+	tqpair.group = &tgroup;
+	tqpair.qpair.transport = &ttransport.transport;
+	tqpair.recv_zcopy = true;
+
+	/* Pretend spdk_sock_recv_next() returned a header followed by a 512B in-capsule payload */
+	rbuf.tgroup = &tgroup;
+	rbuf.buf = data;
+	rbuf.refs = 1;
+	tqpair.rx_buf = &rbuf;
+	tqpair.rx_data = data;
+	tqpair.rx_len = sizeof(hdr) + sizeof(icd);
+
+	/* Headers are always copied, but aren't accounted as request data */
+	rc = nvmf_tcp_read_data(&tqpair, sizeof(hdr), hdr);
+	CU_ASSERT(rc == sizeof(hdr));
+	CU_ASSERT(tqpair.rx_data == data + sizeof(hdr));
+	CU_ASSERT(tgroup.stat.recv_copy_bytes == 0);
+
+	tcp_req.buf = icd;
+	tcp_req.req.iov[0].iov_base = icd;
+	tcp_req.req.iov[0].iov_len = sizeof(icd);
+	tcp_req.req.iovcnt = 1;
+	tcp_req.req.length = sizeof(icd);
+	pdu.req = &tcp_req;
+	pdu.hdr.common.pdu_type = SPDK_NVME_TCP_PDU_TYPE_CAPSULE_CMD;
+	nvme_tcp_pdu_set_data(&pdu, icd, sizeof(icd));
+
+	/* The whole payload is in the receive buffer, so the request points to it */
+	rc = nvmf_tcp_read_payload_data(&tqpair, &pdu);
+	CU_ASSERT(rc == sizeof(icd));
+	CU_ASSERT(tcp_req.req.iov[0].iov_base == data + sizeof(hdr));
+	CU_ASSERT(pdu.data_iov[0].iov_base == data + sizeof(hdr));
+	CU_ASSERT(tcp_req.recv_buf == &rbuf);
+	CU_ASSERT(tgroup.stat.recv_zcopy_bytes == sizeof(icd));
+	CU_ASSERT(tgroup.stat.recv_copy_bytes == 0);
+	/* The buffer is fully consumed, but is still referenced by the request */
+	CU_ASSERT(tqpair.rx_buf == NULL);
+	CU_ASSERT(rbuf.refs == 1);
+
+	nvmf_tcp_recv_buf_put(tcp_req.recv_buf);
+	tcp_req.recv_buf = NULL;
+	CU_ASSERT(rbuf.refs == 0);
+
+	/* Only part of the payload has been received, so it's copied into the request's buffer */
+	rbuf.refs = 1;
+	tqpair.rx_buf = &rbuf;
+	tqpair.rx_data = data;
+	tqpair.rx_len = 100;
+	tcp_req.req.iov[0].iov_base = icd;
+	nvme_tcp_pdu_set_data(&pdu, icd, sizeof(icd));
+	MOCK_SET(spdk_sock_recv_next, -1);
+	errno = EAGAIN;
+
+	rc = nvmf_tcp_read_payload_data(&tqpair, &pdu);
+	CU_ASSERT(rc == 100);
+	CU_ASSERT(tcp_req.req.iov[0].iov_base == icd);
+	CU_ASSERT(tcp_req.recv_buf == NULL);
+	CU_ASSERT(memcmp(icd, data, 100) == 0);
+	CU_ASSERT(tgroup.stat.recv_copy_bytes == 100);
+	CU_ASSERT(tgroup.stat.recv_zcopy_bytes == sizeof(icd));
+	CU_ASSERT(tqpair.rx_buf == NULL);
+	CU_ASSERT(rbuf.refs == 0);
+
+	/* A small payload is copied even if it has been received in whole */
+	rbuf.refs = 1;
+	tqpair.rx_buf = &rbuf;
+	tqpair.rx_data = data;
+	tqpair.rx_len = 200;
+	tcp_req.req.length = 200;
+	nvme_tcp_pdu_set_data(&pdu, icd, 200);
+
+	rc = nvmf_tcp_read_payload_data(&tqpair, &pdu);
+	CU_ASSERT(rc == 200);
+	CU_ASSERT(tcp_req.req.iov[0].iov_base == icd);
+	CU_ASSERT(tcp_req.recv_buf == NULL);
+	CU_ASSERT(memcmp(icd, data, 200) == 0);
+	CU_ASSERT(tgroup.stat.recv_copy_bytes == 300);
+	CU_ASSERT(tgroup.stat.recv_zcopy_bytes == sizeof(icd));
+	CU_ASSERT(rbuf.refs == 0);
+
+	/* Nothing has been received yet */
+	rc = nvmf_tcp_read_data(&tqpair, sizeof(hdr), hdr);
+	CU_ASSERT(rc == 0);
+
+	MOCK_CLEAR(spdk_sock_recv_next);
+
+	/* By default, the number of receive buffers follows the poll group's share of the pool */
+	tgt.num_poll_groups = 8;
+	group.tgt = &tgt;
+	ttransport.transport.opts.num_shared_buffers = 511;
+	ttransport.tcp_opts.recv_buf_count = SPDK_NVMF_TCP_DEFAULT_RECV_BUF_COUNT;
+	CU_ASSERT(nvmf_tcp_recv_buf_count(&ttransport, &group) == 15);
+	tgt.num_poll_groups = 2;
+	CU_ASSERT(nvmf_tcp_recv_buf_count(&ttransport, &group) == NVMF_TCP_MAX_RECV_BUF_COUNT);
+	ttransport.transport.opts.num_shared_buffers = 3;
+	CU_ASSERT(nvmf_tcp_recv_buf_count(&ttransport, &group) == 1);
+	ttransport.tcp_opts.recv_buf_count = 5;
+	CU_ASSERT(nvmf_tcp_recv_buf_count(&ttransport, &group) == 5);
+}
+
+static void
+test_nvmf_tcp_send_batch(void)
+{
+	struct spdk_nvmf_tcp_poll_group tgroup = {};
+	struct spdk_nvmf_tcp_qpair tqpair[2] = {};
+	int i;
+
+	TAILQ_INIT(&tgroup.send_qpairs);
+	tgroup.send_batch_size = 1024;
+	for (i = 0; i < 2; i++) {
+		tqpair[i].group = &tgroup;
+		tqpair[i].send_batch = true;
+	}
+
+	/* PDUs are only queued, and each qpair is put on the list once */
+	nvmf_tcp_send_queue(&tqpair[0], 100);
+	nvmf_tcp_send_queue(&tqpair[1], 100);
+	nvmf_tcp_send_queue(&tqpair[0], 100);
+	CU_ASSERT(tgroup.stat.send_pdus == 3);
+	CU_ASSERT(tgroup.stat.send_flushes == 0);
+	CU_ASSERT(TAILQ_FIRST(&tgroup.send_qpairs) == &tqpair[0]);
+	CU_ASSERT(TAILQ_NEXT(&tqpair[0], send_link) == &tqpair[1]);
+	CU_ASSERT(TAILQ_NEXT(&tqpair[1], send_link) == NULL);
+	CU_ASSERT(tqpair[0].send_queued_bytes == 200);
+
+	/* Each socket is flushed once at the end of the poll */
+	nvmf_tcp_send_flush(&tgroup);
+	CU_ASSERT(tgroup.stat.send_flushes == 2);
+	CU_ASSERT(TAILQ_EMPTY(&tgroup.send_qpairs));
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT(!tqpair[i].send_queued);
+		CU_ASSERT(tqpair[i].send_queued_bytes == 0);
+	}
+
+	/* A socket that exceeds the budget is flushed right away */
+	nvmf_tcp_send_queue(&tqpair[0], 1000);
+	CU_ASSERT(tqpair[0].send_queued);
+	nvmf_tcp_send_queue(&tqpair[0], 100);
+	CU_ASSERT(tgroup.stat.send_flushes == 3);
+	CU_ASSERT(!tqpair[0].send_queued);
+	CU_ASSERT(tqpair[0].send_queued_bytes == 0);
+	CU_ASSERT(TAILQ_EMPTY(&tgroup.send_qpairs));
+}
+
+static void
+test_nvmf_tcp_poll_group_migrate(void)
+{
+	struct spdk_nvmf_tcp_poll_group tgroup1 = {}, tgroup2 = {};
+	struct spdk_nvmf_tcp_qpair tqpair = {};
+	int rc;
+
+	TAILQ_INIT(&tgroup1.qpairs);
+	TAILQ_INIT(&tgroup1.send_qpairs);
+	TAILQ_INIT(&tgroup2.qpairs);
+	TAILQ_INIT(&tgroup2.send_qpairs);
+	tgroup2.send_batch_size = 1024;
+
+	tqpair.group = &tgroup1;
+	tqpair.state = NVMF_TCP_QPAIR_STATE_RUNNING;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_READY;
+	tqpair.resource_count = 2;
+	tqpair.state_cntr[TCP_REQUEST_STATE_FREE] = 1;
+	tqpair.state_cntr[TCP_REQUEST_STATE_EXECUTING] = 1;
+	TAILQ_INSERT_TAIL(&tgroup1.qpairs, &tqpair, link);
+
+	/* A request in progress keeps the qpair in its poll group */
+	rc = nvmf_tcp_poll_group_migrate_out(&tgroup1.group, &tqpair.qpair);
+	CU_ASSERT(rc == -EBUSY);
+	CU_ASSERT(tqpair.group == &tgroup1);
+
+	/* So does a PDU being received past its common header */
+	tqpair.state_cntr[TCP_REQUEST_STATE_EXECUTING] = 0;
+	tqpair.state_cntr[TCP_REQUEST_STATE_FREE] = 2;
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_PAYLOAD;
+	rc = nvmf_tcp_poll_group_migrate_out(&tgroup1.group, &tqpair.qpair);
+	CU_ASSERT(rc == -EBUSY);
+
+	/* Queued PDUs are flushed before the socket leaves the sock group */
+	tqpair.recv_state = NVME_TCP_PDU_RECV_STATE_AWAIT_PDU_CH;
+	TAILQ_INSERT_TAIL(&tgroup1.send_qpairs, &tqpair, send_link);
+	tqpair.send_queued = true;
+	rc = nvmf_tcp_poll_group_migrate_out(&tgroup1.group, &tqpair.qpair);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(tqpair.group == NULL);
+	CU_ASSERT(!tqpair.send_queued);
+	CU_ASSERT(tgroup1.stat.send_flushes == 1);
+	CU_ASSERT(TAILQ_EMPTY(&tgroup1.qpairs));
+	CU_ASSERT(TAILQ_EMPTY(&tgroup1.send_qpairs));
+
+	rc = nvmf_tcp_poll_group_migrate_in(&tgroup2.group, &tqpair.qpair);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(tqpair.group == &tgroup2);
+	CU_ASSERT(tqpair.send_batch);
+	CU_ASSERT(TAILQ_FIRST(&tgroup2.qpairs) == &tqpair);
+
+	/* Data received into buffers of the sock group can't be migrated */
+	tqpair.recv_zcopy = true;
+	rc = nvmf_tcp_poll_group_migrate_out(&tgroup2.group, &tqpair.qpair);
+	CU_ASSERT(rc == -ENOTSUP);
+	CU_ASSERT(tqpair.group == &tgroup2);
+}
+
 #define NVMF_TCP_PDU_MAX_H2C_DATA_SIZE (128 * 1024)
 
 static void
@@ -1536,6 +1865,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvmf_tcp_destroy);
 	CU_ADD_TEST(suite, test_nvmf_tcp_poll_group_create);
 	CU_ADD_TEST(suite, test_nvmf_tcp_send_c2h_data);
+	CU_ADD_TEST(suite, test_nvmf_tcp_ddgst_compute);
+	CU_ADD_TEST(suite, test_nvmf_tcp_recv_zcopy);
+	CU_ADD_TEST(suite, test_nvmf_tcp_send_batch);
+	CU_ADD_TEST(suite, test_nvmf_tcp_poll_group_migrate);
 	CU_ADD_TEST(suite, test_nvmf_tcp_h2c_data_hdr_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_in_capsule_data_handle);
 	CU_ADD_TEST(suite, test_nvmf_tcp_qpair_init_mem_resource);
@@ -136,6 +136,51 @@ flush(void)
 	free(req2);
 }
 
+static void
+flush_more_data(void)
+{
+	struct spdk_posix_sock psock = {};
+	struct spdk_sock *sock = &psock.base;
+	struct spdk_sock_request *req1, *req2;
+	int i;
+
+	TAILQ_INIT(&sock->queued_reqs);
+	TAILQ_INIT(&sock->pending_reqs);
+
+	req1 = calloc(1, sizeof(struct spdk_sock_request) + IOV_BATCH_SIZE * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req1 != NULL);
+	for (i = 0; i < IOV_BATCH_SIZE; i++) {
+		SPDK_SOCK_REQUEST_IOV(req1, i)->iov_base = (void *)100;
+		SPDK_SOCK_REQUEST_IOV(req1, i)->iov_len = 32;
+	}
+	req1->iovcnt = IOV_BATCH_SIZE;
+	req1->cb_fn = _req_cb;
+
+	req2 = calloc(1, sizeof(struct spdk_sock_request) + sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req2 != NULL);
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_base = (void *)200;
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_len = 32;
+	req2->iovcnt = 1;
+	req2->cb_fn = _req_cb;
+
+	/* Everything fits into a single sendmsg() */
+	spdk_sock_request_queue(sock, req1);
+	CU_ASSERT(!_sock_has_more_data(sock));
+
+	/* One more iovec than fits */
+	spdk_sock_request_queue(sock, req2);
+	CU_ASSERT(_sock_has_more_data(sock));
+
+	/* Part of the first request has already been sent */
+	req1->internal.offset = 32;
+	CU_ASSERT(!_sock_has_more_data(sock));
+
+	TAILQ_REMOVE(&sock->queued_reqs, req1, internal.link);
+	TAILQ_REMOVE(&sock->queued_reqs, req2, internal.link);
+	free(req1);
+	free(req2);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -147,6 +192,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("posix", NULL, NULL);
 
 	CU_ADD_TEST(suite, flush);
+	CU_ADD_TEST(suite, flush_more_data);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
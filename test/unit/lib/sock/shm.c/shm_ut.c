@@ -0,0 +1,501 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 agent <agent@local>.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/util.h"
+
+#include "spdk_internal/mock.h"
+
+#include "spdk_internal/cunit.h"
+
+#include "common/lib/test_env.c"
+#include "sock/shm/shm.c"
+
+DEFINE_STUB_V(spdk_net_impl_register, (struct spdk_net_impl *impl));
+DEFINE_STUB(spdk_sock_close, int, (struct spdk_sock **s), 0);
+DEFINE_STUB(spdk_sock_listen_ext, struct spdk_sock *, (const char *ip, int port,
+		const char *impl_name, struct spdk_sock_opts *opts),
+	    (struct spdk_sock *)0xDEADBEEF);
+DEFINE_STUB(spdk_sock_connect_ext, struct spdk_sock *, (const char *ip, int port,
+		const char *impl_name, struct spdk_sock_opts *opts),
+	    (struct spdk_sock *)0xDEADBEEF);
+DEFINE_STUB(spdk_sock_accept, struct spdk_sock *, (struct spdk_sock *sock), NULL);
+DEFINE_STUB(spdk_sock_get_interface_name, const char *, (struct spdk_sock *sock), NULL);
+DEFINE_STUB(spdk_sock_get_numa_id, int32_t, (struct spdk_sock *sock), 0);
+DEFINE_STUB(spdk_sock_readv, ssize_t, (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
+DEFINE_STUB(spdk_sock_writev, ssize_t, (struct spdk_sock *sock, struct iovec *iov, int iovcnt), 0);
+DEFINE_STUB_V(spdk_sock_writev_async, (struct spdk_sock *sock, struct spdk_sock_request *req));
+DEFINE_STUB(spdk_sock_flush, int, (struct spdk_sock *sock), 0);
+DEFINE_STUB(spdk_sock_set_recvlowat, int, (struct spdk_sock *s, int nbytes), 0);
+DEFINE_STUB(spdk_sock_set_recvbuf, int, (struct spdk_sock *sock, int sz), 0);
+DEFINE_STUB(spdk_sock_set_sendbuf, int, (struct spdk_sock *sock, int sz), 0);
+DEFINE_STUB(spdk_sock_is_ipv6, bool, (struct spdk_sock *sock), false);
+DEFINE_STUB(spdk_sock_is_ipv4, bool, (struct spdk_sock *sock), true);
+DEFINE_STUB(spdk_sock_is_connected, bool, (struct spdk_sock *sock), true);
+DEFINE_STUB(spdk_sock_group_create, struct spdk_sock_group *, (void *ctx), NULL);
+DEFINE_STUB(spdk_sock_group_add_sock, int, (struct spdk_sock_group *group, struct spdk_sock *sock,
+		spdk_sock_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB(spdk_sock_group_remove_sock, int, (struct spdk_sock_group *group,
+		struct spdk_sock *sock), 0);
+DEFINE_STUB(spdk_sock_group_poll_count, int, (struct spdk_sock_group *group, int max_events), 0);
+DEFINE_STUB(spdk_sock_group_close, int, (struct spdk_sock_group **group), 0);
+DEFINE_STUB(spdk_sock_group_provide_buf, int, (struct spdk_sock_group *group, void *buf,
+		size_t len, void *ctx), 0);
+
+static uint16_t g_listen_port;
+static uint8_t g_group_buf[256];
+
+int
+spdk_sock_getaddr(struct spdk_sock *sock, char *saddr, int slen, uint16_t *sport,
+		  char *caddr, int clen, uint16_t *cport)
+{
+	if (sport != NULL) {
+		*sport = g_listen_port;
+	}
+
+	return 0;
+}
+
+size_t
+spdk_sock_group_get_buf(struct spdk_sock_group *group, void **buf, void **ctx)
+{
+	*buf = g_group_buf;
+	*ctx = NULL;
+
+	return sizeof(g_group_buf);
+}
+
+static void
+_req_cb(void *cb_arg, int err)
+{
+	*(int *)cb_arg = err;
+}
+
+static void
+ut_connect(struct spdk_shm_sock **_lsock, struct spdk_shm_sock **_csock,
+	   struct spdk_shm_sock **_asock)
+{
+	struct spdk_sock_opts opts = {};
+	struct spdk_sock *lsock, *csock, *asock;
+
+	/* Pick a port nobody else uses for the abstract socket name */
+	g_listen_port = 10000 + getpid() % 50000;
+
+	lsock = shm_sock_listen("127.0.0.1", 0, &opts);
+	SPDK_CU_ASSERT_FATAL(lsock != NULL);
+	lsock->net_impl = &g_shm_net_impl;
+
+	csock = shm_sock_connect("127.0.0.1", g_listen_port, &opts);
+	SPDK_CU_ASSERT_FATAL(csock != NULL);
+	CU_ASSERT(((struct spdk_shm_sock *)csock)->posix_sock == NULL);
+	TAILQ_INIT(&csock->queued_reqs);
+	TAILQ_INIT(&csock->pending_reqs);
+
+	asock = shm_sock_accept(lsock);
+	SPDK_CU_ASSERT_FATAL(asock != NULL);
+	CU_ASSERT(((struct spdk_shm_sock *)asock)->posix_sock == NULL);
+	TAILQ_INIT(&asock->queued_reqs);
+	TAILQ_INIT(&asock->pending_reqs);
+
+	*_lsock = (struct spdk_shm_sock *)lsock;
+	*_csock = (struct spdk_shm_sock *)csock;
+	*_asock = (struct spdk_shm_sock *)asock;
+}
+
+static void
+local_connection(void)
+{
+	struct spdk_shm_sock *lsock, *csock, *asock;
+	char saddr[64], caddr[64];
+	uint16_t sport, cport, cport2;
+	uint8_t *buf, rbuf[64];
+	struct iovec iov[2];
+	ssize_t rc;
+	size_t i, total;
+
+	ut_connect(&lsock, &csock, &asock);
+
+	/* Both ends report the listen address */
+	rc = shm_sock_getaddr(&asock->base, saddr, sizeof(saddr), &sport, caddr, sizeof(caddr),
+			      &cport);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(strcmp(saddr, "127.0.0.1") == 0);
+	CU_ASSERT(strcmp(caddr, "127.0.0.1") == 0);
+	CU_ASSERT(sport == g_listen_port);
+	rc = shm_sock_getaddr(&csock->base, NULL, 0, NULL, NULL, 0, &cport2);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(cport == cport2);
+	CU_ASSERT(shm_sock_is_ipv4(&asock->base));
+	CU_ASSERT(!shm_sock_is_ipv6(&asock->base));
+	CU_ASSERT(shm_sock_is_connected(&asock->base));
+
+	/* Nothing to read yet */
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == -1 && errno == EAGAIN);
+
+	/* Data goes both ways */
+	iov[0].iov_base = "hello ";
+	iov[0].iov_len = 6;
+	iov[1].iov_base = "world";
+	iov[1].iov_len = 5;
+	rc = shm_sock_writev(&csock->base, iov, 2);
+	CU_ASSERT(rc == 11);
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == 11);
+	CU_ASSERT(memcmp(rbuf, "hello world", 11) == 0);
+
+	rc = shm_sock_writev(&asock->base, iov, 1);
+	CU_ASSERT(rc == 6);
+	rc = shm_sock_recv(&csock->base, rbuf, 3);
+	CU_ASSERT(rc == 3);
+	rc = shm_sock_recv(&csock->base, rbuf + 3, sizeof(rbuf) - 3);
+	CU_ASSERT(rc == 3);
+	CU_ASSERT(memcmp(rbuf, "hello ", 6) == 0);
+
+	/* Fill the ring, which wraps around because of the bytes sent above */
+	buf = malloc(csock->ring_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	for (i = 0; i < csock->ring_size; i++) {
+		buf[i] = i % 251;
+	}
+	iov[0].iov_base = buf;
+	iov[0].iov_len = csock->ring_size;
+	rc = shm_sock_writev(&csock->base, iov, 1);
+	CU_ASSERT(rc == (ssize_t)csock->ring_size);
+	rc = shm_sock_writev(&csock->base, iov, 1);
+	CU_ASSERT(rc == -1 && errno == EAGAIN);
+
+	memset(buf, 0, csock->ring_size);
+	total = 0;
+	while (total < csock->ring_size) {
+		rc = shm_sock_recv(&asock->base, buf + total, csock->ring_size - total);
+		SPDK_CU_ASSERT_FATAL(rc > 0);
+		total += rc;
+	}
+	for (i = 0; i < csock->ring_size; i++) {
+		if (buf[i] != i % 251) {
+			break;
+		}
+	}
+	CU_ASSERT(i == csock->ring_size);
+	free(buf);
+
+	/* Data sent right before closing can still be read, followed by the end of the stream */
+	iov[0].iov_base = "bye";
+	iov[0].iov_len = 3;
+	rc = shm_sock_writev(&csock->base, iov, 1);
+	CU_ASSERT(rc == 3);
+	shm_sock_close(&csock->base);
+
+	CU_ASSERT(!shm_sock_is_connected(&asock->base));
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == 3);
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == 0);
+	rc = shm_sock_writev(&asock->base, iov, 1);
+	CU_ASSERT(rc == -1 && errno == EPIPE);
+
+	shm_sock_close(&asock->base);
+	shm_sock_close(&lsock->base);
+}
+
+static void
+group_poll(void)
+{
+	struct spdk_shm_sock *lsock, *csock, *asock;
+	struct spdk_sock_group_impl *group;
+	struct spdk_sock_group sock_group = {};
+	struct spdk_sock *socks[2];
+	struct spdk_sock_request *req1, *req2;
+	int cb1, cb2;
+	void *buf, *ctx;
+	int rc;
+
+	ut_connect(&lsock, &csock, &asock);
+
+	group = shm_sock_group_impl_create();
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+	group->group = &sock_group;
+
+	rc = shm_sock_group_impl_add_sock(group, &csock->base);
+	CU_ASSERT(rc == 0);
+	csock->base.group_impl = group;
+	rc = shm_sock_group_impl_add_sock(group, &asock->base);
+	CU_ASSERT(rc == 0);
+	asock->base.group_impl = group;
+
+	rc = shm_sock_group_impl_poll(group, 2, socks);
+	CU_ASSERT(rc == 0);
+
+	req1 = calloc(1, sizeof(struct spdk_sock_request) + 2 * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req1 != NULL);
+	SPDK_SOCK_REQUEST_IOV(req1, 0)->iov_base = "abcd";
+	SPDK_SOCK_REQUEST_IOV(req1, 0)->iov_len = 4;
+	SPDK_SOCK_REQUEST_IOV(req1, 1)->iov_base = "efgh";
+	SPDK_SOCK_REQUEST_IOV(req1, 1)->iov_len = 4;
+	req1->iovcnt = 2;
+	req1->cb_fn = _req_cb;
+	req1->cb_arg = &cb1;
+
+	req2 = calloc(1, sizeof(struct spdk_sock_request) + 1 * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req2 != NULL);
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_base = "ijkl";
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_len = 4;
+	req2->iovcnt = 1;
+	req2->cb_fn = _req_cb;
+	req2->cb_arg = &cb2;
+
+	/* Requests complete once the poll copied them into the ring */
+	cb1 = cb2 = 1;
+	shm_sock_writev_async(&csock->base, req1);
+	shm_sock_writev_async(&csock->base, req2);
+	CU_ASSERT(cb1 == 1 && cb2 == 1);
+
+	rc = shm_sock_group_impl_poll(group, 2, socks);
+	CU_ASSERT(cb1 == 0 && cb2 == 0);
+	CU_ASSERT(TAILQ_EMPTY(&csock->base.queued_reqs));
+	CU_ASSERT(TAILQ_EMPTY(&csock->base.pending_reqs));
+	CU_ASSERT(rc == 1);
+	CU_ASSERT(socks[0] == &asock->base);
+
+	/* The low watermark delays the event */
+	shm_sock_set_recvlowat(&asock->base, 16);
+	rc = shm_sock_group_impl_poll(group, 2, socks);
+	CU_ASSERT(rc == 0);
+	shm_sock_set_recvlowat(&asock->base, 1);
+
+	/* Receive into a buffer provided to the group */
+	rc = shm_sock_recv_next(&asock->base, &buf, &ctx);
+	CU_ASSERT(rc == 12);
+	CU_ASSERT(buf == g_group_buf);
+	CU_ASSERT(memcmp(buf, "abcdefghijkl", 12) == 0);
+
+	rc = shm_sock_group_impl_poll(group, 2, socks);
+	CU_ASSERT(rc == 0);
+
+	/* Closing the peer is an event */
+	rc = shm_sock_group_impl_remove_sock(group, &csock->base);
+	CU_ASSERT(rc == 0);
+	shm_sock_close(&csock->base);
+	rc = shm_sock_group_impl_poll(group, 2, socks);
+	CU_ASSERT(rc == 1);
+	CU_ASSERT(socks[0] == &asock->base);
+
+	rc = shm_sock_group_impl_remove_sock(group, &asock->base);
+	CU_ASSERT(rc == 0);
+	rc = shm_sock_group_impl_close(group);
+	CU_ASSERT(rc == 0);
+
+	shm_sock_close(&asock->base);
+	shm_sock_close(&lsock->base);
+	free(req1);
+	free(req2);
+}
+
+static void
+corrupt_ring_positions(void)
+{
+	struct spdk_shm_sock *lsock, *csock, *asock;
+	struct spdk_sock_request *req;
+	uint8_t rbuf[64];
+	struct iovec iov;
+	ssize_t rc;
+	int cb;
+
+	ut_connect(&lsock, &csock, &asock);
+
+	/* The positions published for the peer are not used by this side */
+	iov.iov_base = "abcd";
+	iov.iov_len = 4;
+	rc = shm_sock_writev(&csock->base, &iov, 1);
+	CU_ASSERT(rc == 4);
+	asock->rx->head = 12345;
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == 4);
+	CU_ASSERT(memcmp(rbuf, "abcd", 4) == 0);
+	CU_ASSERT(asock->rx->head == 4);
+
+	/* A write position more than the ring size ahead of the read position */
+	csock->tx->tail = csock->tx_tail + csock->ring_size + 1;
+	CU_ASSERT(shm_sock_has_event(asock));
+	rc = shm_sock_recv(&asock->base, rbuf, sizeof(rbuf));
+	CU_ASSERT(rc == -1 && errno == EIO);
+	CU_ASSERT(asock->connection_status == -EIO);
+	CU_ASSERT(!shm_sock_is_connected(&asock->base));
+	rc = shm_sock_writev(&asock->base, &iov, 1);
+	CU_ASSERT(rc == -1 && errno == EIO);
+
+	req = calloc(1, sizeof(struct spdk_sock_request) + sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req != NULL);
+	*SPDK_SOCK_REQUEST_IOV(req, 0) = iov;
+	req->iovcnt = 1;
+	req->cb_fn = _req_cb;
+	req->cb_arg = &cb;
+	cb = 1;
+	shm_sock_writev_async(&asock->base, req);
+	CU_ASSERT(cb == -EIO);
+	free(req);
+
+	/* A read position ahead of the write position */
+	rc = shm_sock_writev(&csock->base, &iov, 1);
+	CU_ASSERT(rc == 4);
+	csock->tx->head = csock->tx_tail + 1;
+	rc = shm_sock_writev(&csock->base, &iov, 1);
+	CU_ASSERT(rc == -1 && errno == EIO);
+	CU_ASSERT(!shm_sock_is_connected(&csock->base));
+
+	shm_sock_close(&csock->base);
+	shm_sock_close(&asock->base);
+	shm_sock_close(&lsock->base);
+}
+
+/* Pass memory of region_size bytes to the listener, announced as hello_size */
+static int
+ut_send_hello(int fd, size_t region_size, size_t hello_size, uint32_t ring_size, bool seal)
+{
+	struct shm_sock_region *region;
+	int memfd, rc;
+
+	memfd = memfd_create("shm_ut", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	SPDK_CU_ASSERT_FATAL(memfd >= 0);
+	rc = ftruncate(memfd, region_size);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	SPDK_CU_ASSERT_FATAL(region != MAP_FAILED);
+	region->magic = SHM_SOCK_MAGIC;
+	region->version = SHM_SOCK_VERSION;
+	region->ring_size = ring_size;
+	munmap(region, region_size);
+
+	if (seal) {
+		rc = fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+		SPDK_CU_ASSERT_FATAL(rc == 0);
+	}
+
+	rc = shm_sock_send_hello(fd, memfd, hello_size);
+	close(memfd);
+
+	return rc;
+}
+
+static void
+pending_accept(void)
+{
+	struct spdk_sock_opts opts = {};
+	struct spdk_shm_sock *lsock;
+	struct spdk_sock *asock;
+	size_t size = SHM_SOCK_DATA_OFFSET + 2 * SHM_SOCK_MIN_RING_SIZE;
+	int fd, rc;
+
+	g_listen_port = 10000 + getpid() % 50000;
+	lsock = (struct spdk_shm_sock *)shm_sock_listen("127.0.0.1", 0, &opts);
+	SPDK_CU_ASSERT_FATAL(lsock != NULL);
+
+	/* The acceptor doesn't wait for the hello */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(!TAILQ_EMPTY(&lsock->pending_accepts));
+
+	rc = ut_send_hello(fd, size, size, SHM_SOCK_MIN_RING_SIZE, true);
+	CU_ASSERT(rc == 0);
+	asock = shm_sock_accept(&lsock->base);
+	SPDK_CU_ASSERT_FATAL(asock != NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lsock->pending_accepts));
+	CU_ASSERT(((struct spdk_shm_sock *)asock)->ring_size == SHM_SOCK_MIN_RING_SIZE);
+	shm_sock_close(asock);
+	close(fd);
+
+	/* A client that never sends the hello is dropped after the timeout */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(!TAILQ_EMPTY(&lsock->pending_accepts));
+	spdk_delay_us(SHM_SOCK_HELLO_TIMEOUT_MS * 1000);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lsock->pending_accepts));
+	close(fd);
+
+	/* The announced size must match the size of the memory */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	rc = ut_send_hello(fd, size, 2 * size, SHM_SOCK_MIN_RING_SIZE, true);
+	CU_ASSERT(rc == 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lsock->pending_accepts));
+	close(fd);
+
+	/* The memory must hold exactly two rings of the size in the header */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	rc = ut_send_hello(fd, 2 * size, 2 * size, SHM_SOCK_MIN_RING_SIZE, true);
+	CU_ASSERT(rc == 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lsock->pending_accepts));
+	close(fd);
+
+	/* Memory that could shrink under the mapping is refused */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	rc = ut_send_hello(fd, size, size, SHM_SOCK_MIN_RING_SIZE, false);
+	CU_ASSERT(rc == 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&lsock->pending_accepts));
+	close(fd);
+
+	/* Pending connections are released with the listener */
+	fd = shm_sock_connect_unix("127.0.0.1", g_listen_port);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	asock = shm_sock_accept(&lsock->base);
+	CU_ASSERT(asock == NULL);
+	CU_ASSERT(!TAILQ_EMPTY(&lsock->pending_accepts));
+	shm_sock_close(&lsock->base);
+	close(fd);
+}
+
+static void
+remote_connection(void)
+{
+	struct spdk_sock_opts opts = {};
+	struct spdk_shm_sock *sock;
+
+	/* There is no local listener for an address of another host */
+	sock = (struct spdk_shm_sock *)shm_sock_connect("192.0.2.1", 4420, &opts);
+	SPDK_CU_ASSERT_FATAL(sock != NULL);
+	CU_ASSERT(sock->posix_sock == (struct spdk_sock *)0xDEADBEEF);
+	CU_ASSERT(sock->region == NULL);
+
+	shm_sock_close(&sock->base);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("shm", NULL, NULL);
+
+	CU_ADD_TEST(suite, local_connection);
+	CU_ADD_TEST(suite, group_poll);
+	CU_ADD_TEST(suite, corrupt_ring_positions);
+	CU_ADD_TEST(suite, pending_accept);
+	CU_ADD_TEST(suite, remote_connection);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -228,6 +228,150 @@ flush_server(void)
 	free(req2);
 }
 
+#ifdef SPDK_URING_SEND_ZC
+static void
+send_zc(void)
+{
+	struct spdk_uring_sock_group_impl group = {};
+	struct spdk_uring_sock usock = {};
+	struct spdk_sock *sock = &usock.base;
+	struct spdk_uring_task *task = &usock.write_task;
+	struct spdk_uring_zc_notif *notif1, *notif2;
+	struct spdk_sock_request *req1, *req2;
+	bool cb_arg1, cb_arg2;
+	int rc;
+
+	/* Set up data structures */
+	TAILQ_INIT(&sock->queued_reqs);
+	TAILQ_INIT(&sock->pending_reqs);
+	TAILQ_INIT(&usock.zc_notifs);
+	STAILQ_INIT(&group.free_zc_notifs);
+	sock->group_impl = &group.base;
+	task->sock = &usock;
+	usock.group = &group;
+	usock.zcopy = true;
+	usock.send_zc = true;
+
+	req1 = calloc(1, sizeof(struct spdk_sock_request) + 2 * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req1 != NULL);
+	SPDK_SOCK_REQUEST_IOV(req1, 0)->iov_base = (void *)100;
+	SPDK_SOCK_REQUEST_IOV(req1, 0)->iov_len = 64;
+	SPDK_SOCK_REQUEST_IOV(req1, 1)->iov_base = (void *)200;
+	SPDK_SOCK_REQUEST_IOV(req1, 1)->iov_len = 64;
+	req1->iovcnt = 2;
+	req1->cb_fn = _req_cb;
+	req1->cb_arg = &cb_arg1;
+
+	req2 = calloc(1, sizeof(struct spdk_sock_request) + 1 * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(req2 != NULL);
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_base = (void *)300;
+	SPDK_SOCK_REQUEST_IOV(req2, 0)->iov_len = 32;
+	req2->iovcnt = 1;
+	req2->cb_fn = _req_cb;
+	req2->cb_arg = &cb_arg2;
+
+	/* The request completes only after both the send and the notification */
+	spdk_sock_request_queue(sock, req1);
+	cb_arg1 = false;
+	rc = spdk_sock_prep_reqs(sock, task->iovs, 0, NULL, NULL);
+	CU_ASSERT(rc == 2);
+	notif1 = _sock_get_zc_notif(&usock);
+	SPDK_CU_ASSERT_FATAL(notif1 != NULL);
+	task->zc_notif = notif1;
+	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+	CU_ASSERT(usock.zc_notifs_inflight == 1);
+
+	_sock_zc_complete(notif1, 128, IORING_CQE_F_MORE);
+	CU_ASSERT(task->status == SPDK_URING_SOCK_TASK_NOT_IN_USE);
+	CU_ASSERT(task->zc_notif == NULL);
+	CU_ASSERT(cb_arg1 == false);
+	CU_ASSERT(TAILQ_EMPTY(&sock->queued_reqs));
+	CU_ASSERT(TAILQ_FIRST(&sock->pending_reqs) == req1);
+	CU_ASSERT(group.stats.send_zcopy_bytes == 128);
+
+	_sock_zc_complete(notif1, 0, IORING_CQE_F_NOTIF);
+	CU_ASSERT(cb_arg1 == true);
+	CU_ASSERT(TAILQ_EMPTY(&sock->pending_reqs));
+	CU_ASSERT(usock.zc_notifs_inflight == 0);
+	CU_ASSERT(group.stats.send_zcopy_notifications == 1);
+
+	/* Notifications of two sends arriving out of order */
+	spdk_sock_request_queue(sock, req1);
+	cb_arg1 = false;
+	notif1 = _sock_get_zc_notif(&usock);
+	SPDK_CU_ASSERT_FATAL(notif1 != NULL);
+	task->zc_notif = notif1;
+	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+	_sock_zc_complete(notif1, 128, IORING_CQE_F_MORE);
+
+	spdk_sock_request_queue(sock, req2);
+	cb_arg2 = false;
+	notif2 = _sock_get_zc_notif(&usock);
+	SPDK_CU_ASSERT_FATAL(notif2 != NULL);
+	CU_ASSERT(notif2 != notif1);
+	task->zc_notif = notif2;
+	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+	_sock_zc_complete(notif2, 32, IORING_CQE_F_MORE);
+	CU_ASSERT(usock.zc_notifs_inflight == 2);
+
+	_sock_zc_complete(notif2, 0, IORING_CQE_F_NOTIF);
+	CU_ASSERT(cb_arg1 == false);
+	CU_ASSERT(cb_arg2 == true);
+	_sock_zc_complete(notif1, 0, IORING_CQE_F_NOTIF);
+	CU_ASSERT(cb_arg1 == true);
+	CU_ASSERT(TAILQ_EMPTY(&sock->pending_reqs));
+	CU_ASSERT(usock.zc_notifs_inflight == 0);
+
+	/* A send that failed to go out keeps its requests queued */
+	spdk_sock_request_queue(sock, req1);
+	cb_arg1 = false;
+	notif1 = _sock_get_zc_notif(&usock);
+	SPDK_CU_ASSERT_FATAL(notif1 != NULL);
+	task->zc_notif = notif1;
+	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+	_sock_zc_complete(notif1, -EAGAIN, IORING_CQE_F_MORE);
+	_sock_zc_complete(notif1, 0, IORING_CQE_F_NOTIF);
+	CU_ASSERT(cb_arg1 == false);
+	CU_ASSERT(TAILQ_FIRST(&sock->queued_reqs) == req1);
+	CU_ASSERT(usock.zc_notifs_inflight == 0);
+	TAILQ_REMOVE(&sock->queued_reqs, req1, internal.link);
+
+	CU_ASSERT(group.stats.send_zcopy_bytes == 128 * 2 + 32);
+	CU_ASSERT(group.stats.send_copy_bytes == 0);
+
+	/* Removing the socket from the group doesn't wait for the notifications */
+	spdk_sock_request_queue(sock, req2);
+	cb_arg2 = false;
+	notif1 = _sock_get_zc_notif(&usock);
+	SPDK_CU_ASSERT_FATAL(notif1 != NULL);
+	task->zc_notif = notif1;
+	task->status = SPDK_URING_SOCK_TASK_IN_PROCESS;
+	_sock_zc_complete(notif1, 32, IORING_CQE_F_MORE);
+	CU_ASSERT(cb_arg2 == false);
+
+	_sock_orphan_zc_notifs(&usock);
+	CU_ASSERT(cb_arg2 == true);
+	CU_ASSERT(TAILQ_EMPTY(&sock->pending_reqs));
+	CU_ASSERT(TAILQ_EMPTY(&usock.zc_notifs));
+	CU_ASSERT(usock.zc_notifs_inflight == 0);
+	CU_ASSERT(notif1->sock == NULL);
+	CU_ASSERT(notif1->in_use);
+
+	/* The group releases the tracker when the notification arrives */
+	_sock_zc_complete(notif1, 0, IORING_CQE_F_NOTIF);
+	CU_ASSERT(!notif1->in_use);
+	CU_ASSERT(STAILQ_FIRST(&group.free_zc_notifs) == notif1);
+	CU_ASSERT(group.stats.send_zcopy_notifications == 5);
+
+	while ((notif1 = STAILQ_FIRST(&group.free_zc_notifs)) != NULL) {
+		STAILQ_REMOVE_HEAD(&group.free_zc_notifs, free_link);
+		free(notif1);
+	}
+	free(req1);
+	free(req2);
+}
+#endif
+
 int
 main(int argc, char **argv)
 {
@@ -241,6 +385,9 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, flush_client);
 	CU_ADD_TEST(suite, flush_server);
+#ifdef SPDK_URING_SEND_ZC
+	CU_ADD_TEST(suite, send_zc);
+#endif
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -79,6 +79,7 @@ iobuf(void)
 		{ .thread_id = 1, .module = "ut_module1", },
 		{ .thread_id = 1, .module = "ut_module1", },
 	};
+	struct iovec regions[4];
 	int rc, finish = 0;
 	uint32_t i;
 
@@ -125,6 +126,16 @@ iobuf(void)
 	entry = &mod0_entries[1];
 	entry->buf = spdk_iobuf_get(entry->ioch, LARGE_BUFSIZE, &entry->iobuf, ut_iobuf_get_buf_cb);
 	CU_ASSERT_PTR_NOT_NULL(entry->buf);
+	/* Both of them lie within the region of the large pool */
+	CU_ASSERT_EQUAL(spdk_iobuf_get_regions(NULL, 0), 2);
+	CU_ASSERT_EQUAL(spdk_iobuf_get_regions(regions, SPDK_COUNTOF(regions)), 2);
+	CU_ASSERT_EQUAL(regions[0].iov_len, 2 * SMALL_BUFSIZE);
+	CU_ASSERT_EQUAL(regions[1].iov_len, 2 * LARGE_BUFSIZE);
+	for (i = 0; i < 2; ++i) {
+		CU_ASSERT((uintptr_t)mod0_entries[i].buf >= (uintptr_t)regions[1].iov_base);
+		CU_ASSERT((uintptr_t)mod0_entries[i].buf + LARGE_BUFSIZE <=
+			  (uintptr_t)regions[1].iov_base + regions[1].iov_len);
+	}
 	/* The next two should be put onto the large buf wait queue */
 	entry = &mod0_entries[2];
 	entry->buf = spdk_iobuf_get(entry->ioch, LARGE_BUFSIZE, &entry->iobuf, ut_iobuf_get_buf_cb);
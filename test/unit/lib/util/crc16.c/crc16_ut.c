@@ -7,6 +7,9 @@
 
 #include "spdk_internal/cunit.h"
 
+#include "spdk/crc_impl.h"
+#include "spdk/util.h"
+
 #include "util/crc16.c"
 
 static void
@@ -50,6 +53,56 @@ test_crc16_t10dif_copy(void)
 	free(buf3);
 }
 
+static void
+test_crc16_t10dif_impl(void)
+{
+	enum spdk_crc_impl impls[] = { SPDK_CRC_IMPL_CLMUL, SPDK_CRC_IMPL_VPCLMUL };
+	size_t buf_size = 4200, offset, len;
+	uint8_t *buf, *dst;
+	uint16_t seed, expected, crc;
+	unsigned int i, n;
+
+	buf = calloc(1, buf_size);
+	dst = calloc(1, buf_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && dst != NULL);
+	srand(1);
+	for (offset = 0; offset < buf_size; offset++) {
+		buf[offset] = rand();
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(impls); i++) {
+		if (spdk_crc_set_impl(impls[i]) != 0) {
+			continue;
+		}
+		CU_ASSERT(spdk_crc_get_impl() == impls[i]);
+
+		for (n = 0; n < 500; n++) {
+			offset = rand() % 64;
+			len = n < 300 ? n : (size_t)rand() % (buf_size - offset);
+			seed = rand();
+
+			CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_BASE) == 0);
+			expected = spdk_crc16_t10dif(seed, buf + offset, len);
+			CU_ASSERT(spdk_crc_set_impl(impls[i]) == 0);
+
+			crc = spdk_crc16_t10dif(seed, buf + offset, len);
+			CU_ASSERT(crc == expected);
+
+			memset(dst, 0, buf_size);
+			crc = spdk_crc16_t10dif_copy(seed, dst + 1, buf + offset, len);
+			CU_ASSERT(crc == expected);
+			CU_ASSERT(memcmp(dst + 1, buf + offset, len) == 0);
+		}
+	}
+
+	CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_AUTO) == 0);
+	CU_ASSERT(spdk_crc_get_impl() != SPDK_CRC_IMPL_AUTO);
+	CU_ASSERT(strcmp(spdk_crc_impl_get_name(SPDK_CRC_IMPL_VPCLMUL), "vpclmul") == 0);
+
+	free(buf);
+	free(dst);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -63,6 +116,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_crc16_t10dif);
 	CU_ADD_TEST(suite, test_crc16_t10dif_seed);
 	CU_ADD_TEST(suite, test_crc16_t10dif_copy);
+	CU_ADD_TEST(suite, test_crc16_t10dif_impl);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
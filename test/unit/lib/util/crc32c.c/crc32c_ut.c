@@ -7,6 +7,9 @@
 
 #include "spdk_internal/cunit.h"
 
+#include "spdk/crc_impl.h"
+#include "spdk/util.h"
+
 #include "util/crc32.c"
 #include "util/crc32c.c"
 
@@ -164,6 +167,95 @@ test_crc32c_nvme(void)
 	CU_ASSERT(crc == 0x214941A8);
 }
 
+static void
+test_crc32c_impl(void)
+{
+	enum spdk_crc_impl impls[] = { SPDK_CRC_IMPL_CLMUL, SPDK_CRC_IMPL_VPCLMUL };
+	size_t buf_size = 4200, offset, len;
+	uint8_t *buf;
+	uint32_t seed, expected, crc;
+	unsigned int i, n;
+
+	buf = calloc(1, buf_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	srand(1);
+	for (offset = 0; offset < buf_size; offset++) {
+		buf[offset] = rand();
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(impls); i++) {
+		if (spdk_crc_set_impl(impls[i]) != 0) {
+			continue;
+		}
+
+		for (n = 0; n < 500; n++) {
+			offset = rand() % 64;
+			len = n < 300 ? n : (size_t)rand() % (buf_size - offset);
+			seed = ((uint64_t)rand() << 32) ^ rand();
+
+			CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_BASE) == 0);
+			expected = spdk_crc32c_update(buf + offset, len, seed);
+			CU_ASSERT(spdk_crc_set_impl(impls[i]) == 0);
+			crc = spdk_crc32c_update(buf + offset, len, seed);
+			CU_ASSERT(crc == expected);
+		}
+	}
+
+	CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_AUTO) == 0);
+	free(buf);
+}
+
+static uint32_t
+ut_crc32c_bitwise(const uint8_t *buf, size_t len, uint32_t crc)
+{
+	size_t i;
+	int bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? SPDK_CRC32C_POLYNOMIAL_REFLECT : 0);
+		}
+	}
+
+	return crc;
+}
+
+static void
+test_crc32c_unaligned(void)
+{
+	enum spdk_crc_impl impls[] = { SPDK_CRC_IMPL_BASE, SPDK_CRC_IMPL_CLMUL, SPDK_CRC_IMPL_VPCLMUL };
+	size_t buf_size = 600, offset, len;
+	uint8_t *buf;
+	uint32_t expected, crc;
+	unsigned int i;
+
+	buf = calloc(1, buf_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	srand(2);
+	for (offset = 0; offset < buf_size; offset++) {
+		buf[offset] = rand();
+	}
+
+	/* Short buffers and folded lengths with a tail of 0 to 15 bytes, at every alignment */
+	for (i = 0; i < SPDK_COUNTOF(impls); i++) {
+		if (spdk_crc_set_impl(impls[i]) != 0) {
+			continue;
+		}
+
+		for (offset = 0; offset < 16; offset++) {
+			for (len = 0; offset + len <= buf_size; len++) {
+				expected = ut_crc32c_bitwise(buf + offset, len, 0x12345678);
+				crc = spdk_crc32c_update(buf + offset, len, 0x12345678);
+				CU_ASSERT(crc == expected);
+			}
+		}
+	}
+
+	CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_AUTO) == 0);
+	free(buf);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -176,6 +268,8 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, test_crc32c);
 	CU_ADD_TEST(suite, test_crc32c_nvme);
+	CU_ADD_TEST(suite, test_crc32c_impl);
+	CU_ADD_TEST(suite, test_crc32c_unaligned);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -5,6 +5,8 @@
 
 #include "spdk/stdinc.h"
 #include "spdk_internal/cunit.h"
+#include "spdk/crc_impl.h"
+#include "spdk/util.h"
 #include "util/crc64.c"
 
 
@@ -58,6 +60,44 @@ test_crc64_nvme(void)
 	CU_ASSERT(crc == 0x9A2DF64B8E9E517E);
 }
 
+static void
+test_crc64_nvme_impl(void)
+{
+	enum spdk_crc_impl impls[] = { SPDK_CRC_IMPL_CLMUL, SPDK_CRC_IMPL_VPCLMUL };
+	size_t buf_size = 4200, offset, len;
+	uint8_t *buf;
+	uint64_t seed, expected, crc;
+	unsigned int i, n;
+
+	buf = calloc(1, buf_size);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	srand(1);
+	for (offset = 0; offset < buf_size; offset++) {
+		buf[offset] = rand();
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(impls); i++) {
+		if (spdk_crc_set_impl(impls[i]) != 0) {
+			continue;
+		}
+
+		for (n = 0; n < 500; n++) {
+			offset = rand() % 64;
+			len = n < 300 ? n : (size_t)rand() % (buf_size - offset);
+			seed = ((uint64_t)rand() << 32) ^ rand();
+
+			CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_BASE) == 0);
+			expected = spdk_crc64_nvme(buf + offset, len, seed);
+			CU_ASSERT(spdk_crc_set_impl(impls[i]) == 0);
+			crc = spdk_crc64_nvme(buf + offset, len, seed);
+			CU_ASSERT(crc == expected);
+		}
+	}
+
+	CU_ASSERT(spdk_crc_set_impl(SPDK_CRC_IMPL_AUTO) == 0);
+	free(buf);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -70,6 +110,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("crc64", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_crc64_nvme);
+	CU_ADD_TEST(suite, test_crc64_nvme_impl);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 
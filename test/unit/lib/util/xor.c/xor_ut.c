@@ -97,6 +97,111 @@ test_xor_gen(void)
 	free(ref);
 }
 
+static uint8_t
+gf_mul_ref(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+
+	while (b) {
+		if (b & 1) {
+			r ^= a;
+		}
+		a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+		b >>= 1;
+	}
+
+	return r;
+}
+
+static void
+pq_gen_ref(uint8_t *p, uint8_t *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint8_t coef;
+	uint32_t i, j;
+
+	memset(p, 0, len);
+	memset(q, 0, len);
+	for (i = 0, coef = 1; i < n; i++, coef = gf_mul_ref(coef, 2)) {
+		for (j = 0; j < len; j++) {
+			p[j] ^= ((uint8_t *)sources[i])[j];
+			q[j] ^= gf_mul_ref(coef, ((uint8_t *)sources[i])[j]);
+		}
+	}
+}
+
+static void
+test_xor_gen_pq(void)
+{
+	void *bufs[BUF_COUNT + 1];
+	void *bufs2[SRC_BUF_COUNT];
+	uint8_t *ref_p, *ref_q, *p, *q;
+	int ret;
+	size_t i, j;
+	uint32_t *tmp;
+
+	for (i = 0; i < BUF_COUNT + 1; i++) {
+		ret = posix_memalign(&bufs[i], spdk_xor_get_optimal_alignment(), BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+
+		tmp = bufs[i];
+		for (j = 0; j < BUF_SIZE / sizeof(*tmp); j++) {
+			tmp[j] = ((i << 16) + j) * 2654435761u;
+		}
+	}
+	p = bufs[SRC_BUF_COUNT];
+	q = bufs[SRC_BUF_COUNT + 1];
+
+	ref_p = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref_p != NULL);
+	ref_q = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref_q != NULL);
+
+	/* aligned buffers */
+	pq_gen_ref(ref_p, ref_q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	ret = spdk_xor_gen_pq(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE) == 0);
+
+	/* len not multiple of alignment */
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	ret = spdk_xor_gen_pq(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE - 1) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE - 1) == 0);
+
+	/* unaligned buffers */
+	memcpy(bufs2, bufs, sizeof(bufs2));
+	bufs2[1] += 1;
+	bufs2[2] += 2;
+	bufs2[3] += 3;
+
+	pq_gen_ref(ref_p, ref_q, bufs2, SRC_BUF_COUNT, BUF_SIZE - SRC_BUF_COUNT);
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	ret = spdk_xor_gen_pq(p, q, bufs2, SRC_BUF_COUNT, BUF_SIZE - SRC_BUF_COUNT);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE - SRC_BUF_COUNT) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE - SRC_BUF_COUNT) == 0);
+
+	/* two sources is the minimum */
+	pq_gen_ref(ref_p, ref_q, bufs, 2, BUF_SIZE);
+	ret = spdk_xor_gen_pq(p, q, bufs, 2, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE) == 0);
+
+	ret = spdk_xor_gen_pq(p, q, bufs, 1, BUF_SIZE);
+	CU_ASSERT(ret == -EINVAL);
+
+	for (i = 0; i < BUF_COUNT + 1; i++) {
+		free(bufs[i]);
+	}
+	free(ref_p);
+	free(ref_q);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -108,6 +213,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("xor", NULL, NULL);
 
 	CU_ADD_TEST(suite, test_xor_gen);
+	CU_ADD_TEST(suite, test_xor_gen_pq);
 
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
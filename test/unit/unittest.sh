@@ -24,6 +24,7 @@ function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/raid/concat.c/concat_ut
 	$valgrind $testdir/lib/bdev/raid/raid0.c/raid0_ut
 	$valgrind $testdir/lib/bdev/raid/raid1.c/raid1_ut
+	$valgrind $testdir/lib/bdev/raid/raid10.c/raid10_ut
 	$valgrind $testdir/lib/bdev/bdev_zone.c/bdev_zone_ut
 	$valgrind $testdir/lib/bdev/gpt/gpt.c/gpt_ut
 	$valgrind $testdir/lib/bdev/part.c/part_ut
@@ -124,6 +125,9 @@ function unittest_scsi() {
 function unittest_sock() {
 	$valgrind $testdir/lib/sock/sock.c/sock_ut
 	$valgrind $testdir/lib/sock/posix.c/posix_ut
+	if [ $(uname -s) = Linux ]; then
+		$valgrind $testdir/lib/sock/shm.c/shm_ut
+	fi
 	# Check whether uring is configured
 	if [[ $CONFIG_URING == y ]]; then
 		$valgrind $testdir/lib/sock/uring.c/uring_ut
@@ -212,6 +216,10 @@ if [[ $CONFIG_RAID5F == y ]]; then
 	run_test "unittest_bdev_raid5f" $valgrind $testdir/lib/bdev/raid/raid5f.c/raid5f_ut
 fi
 
+if [[ $CONFIG_RAID6 == y ]]; then
+	run_test "unittest_bdev_raid6" $valgrind $testdir/lib/bdev/raid/raid6.c/raid6_ut
+fi
+
 run_test "unittest_blob_blobfs" unittest_blob
 run_test "unittest_event" unittest_event
 if [ $(uname -s) = Linux ]; then